@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// File: DDSTextureStreamer.h
+//
+// Streams the mip levels of a DDS texture in from a mapped file. The texture starts out
+// with only its smallest mips and is upgraded one level at a time, within a per-call
+// upload budget, as more detail is requested.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#if defined(_XBOX_ONE) && defined(_TITLE)
+#include <d3d11_x.h>
+#else
+#include <d3d11_1.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "DDSTextureLoader.h"
+
+
+namespace DirectX
+{
+    class DDSTextureStreamer
+    {
+    public:
+        // Maps the file and creates the texture from the smallest mips that fit in
+        // initialBytes (the smallest mip is always resident). Supports 2D textures,
+        // texture arrays and cubemaps.
+        DDSTextureStreamer(_In_ ID3D11Device* device, _In_z_ wchar_t const* fileName, size_t initialBytes = 64 * 1024, bool forceSRGB = false);
+
+        DDSTextureStreamer(DDSTextureStreamer&& moveFrom) noexcept;
+        DDSTextureStreamer& operator= (DDSTextureStreamer&& moveFrom) noexcept;
+
+        DDSTextureStreamer(DDSTextureStreamer const&) = delete;
+        DDSTextureStreamer& operator= (DDSTextureStreamer const&) = delete;
+
+        virtual ~DDSTextureStreamer();
+
+        // Most detailed mip wanted, 0 being the full texture. Requesting less detail than
+        // is resident drops the extra levels on the next Update.
+        void __cdecl RequestMip(uint32_t mostDetailedMip) noexcept;
+
+        // Uploads at most budgetBytes of pending mip data and returns how much was uploaded.
+        // At least one row of texels (or blocks) goes up per call so streaming always
+        // progresses. The shader resource view changes when a level completes.
+        size_t __cdecl Update(_In_ ID3D11DeviceContext* context, size_t budgetBytes);
+
+        ID3D11ShaderResourceView* __cdecl GetShaderResourceView() const noexcept;
+        void __cdecl GetShaderResourceView(_Outptr_ ID3D11ShaderResourceView** textureView) const noexcept;
+
+        // Mip indices are into the full chain stored in the file
+        uint32_t __cdecl GetResidentMip() const noexcept;
+        uint32_t __cdecl GetRequestedMip() const noexcept;
+        uint32_t __cdecl GetMipCount() const noexcept;
+        bool __cdecl IsStreaming() const noexcept;
+
+        size_t __cdecl GetResidentBytes() const noexcept;
+        DDS_ALPHA_MODE __cdecl GetAlphaMode() const noexcept;
+
+    private:
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+}
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// File: DynamicSpriteFont.h
+//
+// A sprite font that rasterizes glyphs with DirectWrite the first time they are drawn,
+// for character sets too large to bake up front. Glyphs are rendered on a background
+// thread into a bounded set of atlas pages, uploaded within a per-frame budget, and the
+// least recently used ones are evicted when the pages fill.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpriteBatch.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace DirectX
+{
+    class DynamicSpriteFont
+    {
+    public:
+        struct Statistics
+        {
+            size_t pages;               // Atlas pages created so far
+            size_t residentGlyphs;      // Glyphs in the atlas
+            size_t pendingGlyphs;       // Requested glyphs not yet in the atlas
+            uint64_t rasterized;        // Glyphs rendered by the background thread
+            uint64_t uploaded;
+            uint64_t uploadedBytes;
+            uint64_t evictions;
+            uint64_t atlasFull;         // Updates that left glyphs waiting because every slot was in use
+        };
+
+        // fontName is an installed font family, or failing that the path of a font file, and
+        // fontSize is the em size in pixels. Pages are pageSize square RGBA textures created as
+        // needed, at most maxPages of them, which bounds the memory used whatever the text.
+        DynamicSpriteFont(_In_ ID3D11Device* device, _In_z_ wchar_t const* fontName, float fontSize, uint32_t pageSize = 1024, uint32_t maxPages = 2);
+
+        DynamicSpriteFont(DynamicSpriteFont&& moveFrom) noexcept;
+        DynamicSpriteFont& operator= (DynamicSpriteFont&& moveFrom) noexcept;
+
+        DynamicSpriteFont(DynamicSpriteFont const&) = delete;
+        DynamicSpriteFont& operator= (DynamicSpriteFont const&) = delete;
+
+        virtual ~DynamicSpriteFont();
+
+        // Call once per frame, outside SpriteBatch Begin/End. Uploads glyphs the background thread
+        // has finished, at most budgetBytes of them but at least one, and returns the bytes uploaded.
+        // Only glyphs not drawn since the previous Update are evicted to make room.
+        size_t __cdecl Update(_In_ ID3D11DeviceContext* context, size_t budgetBytes = 256 * 1024);
+
+        // Text is laid out with every glyph's final advance, but glyphs still being rasterized
+        // are left out until an Update uploads them. Characters the font lacks are drawn as the
+        // default character if one is set, otherwise as the font's missing glyph box. Wide
+        // strings are UTF-16, so surrogate pairs draw characters beyond the BMP, and char
+        // strings are UTF-8.
+        void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color = Colors::White, float rotation = 0, FXMVECTOR origin = g_XMZero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
+        void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, XMFLOAT2 const& position, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color = Colors::White, float rotation = 0, FXMVECTOR origin = g_XMZero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
+        // Width is the widest line's advance and height is one line spacing per line.
+        XMVECTOR XM_CALLCONV MeasureString(_In_z_ wchar_t const* text);
+        XMVECTOR XM_CALLCONV MeasureString(_In_z_ char const* text);
+
+        // Starts rasterizing the glyphs of a string without drawing it, e.g. on a loading screen.
+        void __cdecl RequestGlyphs(_In_z_ wchar_t const* text);
+        void __cdecl RequestGlyphs(_In_z_ char const* text);
+
+        // Spacing properties
+        float __cdecl GetLineSpacing() const noexcept;
+        void __cdecl SetLineSpacing(float spacing) noexcept;
+
+        // Font properties
+        wchar_t __cdecl GetDefaultCharacter() const noexcept;
+        void __cdecl SetDefaultCharacter(wchar_t character);
+
+        bool __cdecl ContainsCharacter(wchar_t character);
+
+        Statistics __cdecl GetStatistics() const;
+
+    private:
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+
+        static const XMFLOAT2 Float2Zero;
+    };
+}
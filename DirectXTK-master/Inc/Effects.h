@@ -847,6 +847,20 @@ namespace DirectX
         // Properties.
         ID3D11Device* GetDevice() const noexcept;
 
+        // Texture cache counters, shared by every EffectFactory of the device. CreateTexture may
+        // be called from several threads; a texture already being loaded by another thread is
+        // waited for instead of loaded twice.
+        struct TextureCacheStats
+        {
+            size_t requests;
+            size_t hits;        // Already loaded
+            size_t waits;       // Still loading on another thread
+            size_t loads;
+            size_t failures;
+        };
+
+        TextureCacheStats __cdecl GetTextureCacheStats() const noexcept;
+
     private:
         // Private implementation.
         class Impl;
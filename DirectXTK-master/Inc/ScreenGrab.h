@@ -23,6 +23,8 @@
 #include <d3d11_1.h>
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 #ifdef NTDDI_WIN10_FE
@@ -36,6 +38,17 @@
 
 namespace DirectX
 {
+    // CPU copy of the top level of a 2D texture, for saving images that were read back
+    // earlier (see ScreenGrabQueue) or generated on the CPU
+    struct ScreenGrabImage
+    {
+        DXGI_FORMAT     format;
+        uint32_t        width;
+        uint32_t        height;
+        size_t          rowPitch;
+        const uint8_t*  pixels;
+    };
+
     HRESULT __cdecl SaveDDSTextureToFile(
         _In_ ID3D11DeviceContext* pContext,
         _In_ ID3D11Resource* pSource,
@@ -49,4 +62,16 @@ namespace DirectX
         _In_opt_ const GUID* targetFormat = nullptr,
         _In_opt_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
         _In_ bool forceSRGB = false);
+
+    HRESULT __cdecl SaveDDSImageToFile(
+        const ScreenGrabImage& image,
+        _In_z_ const wchar_t* fileName) noexcept;
+
+    HRESULT __cdecl SaveWICImageToFile(
+        const ScreenGrabImage& image,
+        _In_ REFGUID guidContainerFormat,
+        _In_z_ const wchar_t* fileName,
+        _In_opt_ const GUID* targetFormat = nullptr,
+        _In_opt_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
+        _In_ bool forceSRGB = false);
 }
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// File: ScreenGrabQueue.h
+//
+// Asynchronous version of ScreenGrab for continuous capture. Captures are copied to
+// pooled staging textures and only mapped a few frames later, once the GPU is done
+// with them, and the files are written on a background thread.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "ScreenGrab.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+
+namespace DirectX
+{
+    class ScreenGrabQueue
+    {
+    public:
+        enum class Encoding
+        {
+            DDS,        // SaveDDSImageToFile
+            WIC,        // SaveWICImageToFile with the given container format
+            Raw,        // Tightly packed rows and no header, for frame sequences
+            Callback,   // Handed to the callback, on the encode thread. Exceptions count as failed
+        };
+
+        struct Target
+        {
+            Encoding encoding;
+            std::wstring fileName;
+            GUID container;
+            bool forceSRGB;
+            std::function<void __cdecl(const ScreenGrabImage&)> callback;
+        };
+
+        struct Statistics
+        {
+            uint64_t captured;          // Capture and Submit calls accepted
+            uint64_t written;
+            uint64_t failed;
+            uint64_t gpuWaits;          // Readbacks that had to block on the GPU
+            uint64_t encodeWaits;       // Readbacks that had to block on the encode thread
+            uint64_t stagingCreated;    // Staging textures created, each capture size or format needs its own
+            size_t readbacksInFlight;
+            size_t encodesPending;
+            double encodeMilliseconds;  // Total time spent encoding and writing
+        };
+
+        // Captures are mapped once they are latency frames old. Capture blocks on the oldest
+        // readback when maxInFlight are outstanding, and readbacks block when
+        // maxPendingEncodes frames are already waiting for the encode thread.
+        explicit ScreenGrabQueue(_In_ ID3D11Device* device, uint32_t latency = 2, uint32_t maxInFlight = 4, uint32_t maxPendingEncodes = 8);
+
+        ScreenGrabQueue(ScreenGrabQueue&& moveFrom) noexcept;
+        ScreenGrabQueue& operator= (ScreenGrabQueue&& moveFrom) noexcept;
+
+        ScreenGrabQueue(ScreenGrabQueue const&) = delete;
+        ScreenGrabQueue& operator= (ScreenGrabQueue const&) = delete;
+
+        // Finishes queued encodes. Readbacks still on the GPU are dropped, call Flush first
+        // to keep them.
+        virtual ~ScreenGrabQueue();
+
+        // Copies the top level of the first surface of a 2D texture, resolving MSAA. Nothing
+        // is mapped here.
+        HRESULT __cdecl Capture(_In_ ID3D11DeviceContext* context, _In_ ID3D11Resource* source, const Target& target);
+
+        HRESULT __cdecl CaptureDDS(_In_ ID3D11DeviceContext* context, _In_ ID3D11Resource* source, _In_z_ const wchar_t* fileName);
+        HRESULT __cdecl CaptureWIC(_In_ ID3D11DeviceContext* context, _In_ ID3D11Resource* source, _In_ REFGUID guidContainerFormat, _In_z_ const wchar_t* fileName, bool forceSRGB = false);
+
+        // Queues a CPU image for the encode stage directly, the pixels are copied
+        void __cdecl Submit(const ScreenGrabImage& image, const Target& target);
+
+        // Call once per frame. Maps the captures that are old enough without waiting on the GPU.
+        void __cdecl Update(_In_ ID3D11DeviceContext* context);
+
+        // Waits until every capture has been read back and written
+        void __cdecl Flush(_In_ ID3D11DeviceContext* context);
+
+        Statistics __cdecl GetStatistics() const;
+
+    private:
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+}
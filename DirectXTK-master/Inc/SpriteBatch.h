@@ -45,9 +45,26 @@ namespace DirectX
     };
 
 
+    enum SpriteRenderMode
+    {
+        // Four vertices per sprite, up to 2048 sprites per draw.
+        SpriteRenderMode_Vertices,
+
+        // One compact record per sprite, expanded by the vertex shader. A run of sprites sharing
+        // a texture is a single draw however long it is. Needs feature level 9.3 and cannot be
+        // combined with custom vertex shaders, custom pixel shaders still work.
+        SpriteRenderMode_Instanced,
+    };
+
+
+    class SpriteLayer;
+
+
     class SpriteBatch
     {
     public:
+        class ThreadQueue;
+
         explicit SpriteBatch(_In_ ID3D11DeviceContext* deviceContext);
         SpriteBatch(SpriteBatch&& moveFrom) noexcept;
         SpriteBatch& operator= (SpriteBatch&& moveFrom) noexcept;
@@ -81,6 +98,18 @@ namespace DirectX
         void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, FXMVECTOR color = Colors::White);
         void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
 
+        // Parallel recording. Call on the thread that called Begin to get one queue per worker,
+        // then each worker can Draw into its own queue while the others fill theirs. End merges
+        // the queues in index order after the sprites drawn directly, each keeping its own
+        // order, so SpriteSortMode_Deferred output does not depend on thread timing, and the
+        // other sort modes sort the merged list. Not available with SpriteSortMode_Immediate.
+        ThreadQueue& __cdecl GetThreadQueue(size_t index);
+
+        // Draws the on-screen chunks of a retained layer with the current states and transform.
+        // Sprites queued before the call are drawn first, and sorting applies separately to
+        // the sprites on either side of it. Thread queues are still merged at End.
+        void __cdecl DrawLayer(SpriteLayer& layer);
+
         // Rotation mode to be applied to the sprite transformation
         void __cdecl SetRotation(DXGI_MODE_ROTATION mode);
         DXGI_MODE_ROTATION __cdecl GetRotation() const noexcept;
@@ -88,7 +117,25 @@ namespace DirectX
         // Set viewport for sprite transformation
         void __cdecl SetViewport(const D3D11_VIEWPORT& viewPort);
 
+        // How sprites are sent to the GPU, can only be changed outside Begin/End
+        void __cdecl SetRenderMode(SpriteRenderMode mode);
+        SpriteRenderMode __cdecl GetRenderMode() const noexcept;
+
+        // Draws textures as signed distance fields, such as the SpriteFonts SpriteFontBaker makes
+        // with -DistanceField, instead of as colors. Can only be changed outside Begin/End, needs
+        // feature level 10.0, and is replaced by a custom pixel shader if Begin is given one.
+        void __cdecl SetDistanceFieldMode(bool enable);
+        bool __cdecl GetDistanceFieldMode() const noexcept;
+
     private:
+        friend class SpriteFont;
+
+        // Queues one string of SpriteFont glyphs, which share everything but their source rectangle
+        // (x, y, width, height in texels) and their offset from the start of the string. Checks the
+        // arguments and grows the queue once for the whole run. With effects the run is mirrored as
+        // a whole, and origin must already allow for the mirrored string's size.
+        void XM_CALLCONV DrawGlyphRun(_In_ ID3D11ShaderResourceView* texture, _In_reads_(count) XMFLOAT4 const* sources, _In_reads_(count) XMFLOAT2 const* offsets, size_t count, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth);
+
         // Private implementation.
         struct Impl;
 
@@ -97,4 +144,37 @@ namespace DirectX
         static const XMMATRIX MatrixIdentity;
         static const XMFLOAT2 Float2Zero;
     };
+
+
+    // Sprites one worker thread records for the current SpriteBatch Begin/End.
+    class SpriteBatch::ThreadQueue
+    {
+    public:
+        ThreadQueue(ThreadQueue const&) = delete;
+        ThreadQueue& operator= (ThreadQueue const&) = delete;
+
+        ~ThreadQueue();
+
+        // Same overloads as SpriteBatch::Draw.
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, XMFLOAT2 const& position, FXMVECTOR color = Colors::White);
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, XMFLOAT2 const& position, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, XMFLOAT2 const& position, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, FXMVECTOR position, FXMVECTOR color = Colors::White);
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, FXMVECTOR position, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color = Colors::White, float rotation = 0, FXMVECTOR origin = g_XMZero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, FXMVECTOR position, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, FXMVECTOR color = Colors::White);
+        void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
+    private:
+        friend struct SpriteBatch::Impl;
+
+        explicit ThreadQueue(_In_ SpriteBatch::Impl const* owner);
+
+        // Private implementation.
+        struct Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
 }
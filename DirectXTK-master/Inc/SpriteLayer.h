@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteLayer.h
+//
+// Retained sprites for content that rarely changes, such as tilemaps and static UI
+// frames. Vertices are built once into per-chunk vertex buffers that stay on the GPU,
+// and SpriteBatch::DrawLayer only draws the chunks that are on screen.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpriteBatch.h"
+
+#include <cstddef>
+#include <memory>
+
+
+namespace DirectX
+{
+    class SpriteLayer
+    {
+    public:
+        // Sprites are grouped into square chunks of chunkSize pixels by their position, each
+        // with its own vertex buffer. All sprites in a layer share one texture, typically an atlas.
+        SpriteLayer(_In_ ID3D11Device* device, _In_ ID3D11ShaderResourceView* texture, float chunkSize = 512);
+
+        SpriteLayer(SpriteLayer&& moveFrom) noexcept;
+        SpriteLayer& operator= (SpriteLayer&& moveFrom) noexcept;
+
+        SpriteLayer(SpriteLayer const&) = delete;
+        SpriteLayer& operator= (SpriteLayer const&) = delete;
+
+        virtual ~SpriteLayer();
+
+        // Adds a sprite, taking the same parameters as SpriteBatch::Draw. Returns its index for
+        // the Set methods. Within a chunk sprites are drawn in the order they were added.
+        size_t XM_CALLCONV Add(XMFLOAT2 const& position, _In_opt_ RECT const* sourceRectangle = nullptr, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        size_t XM_CALLCONV Add(XMFLOAT2 const& position, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+        size_t XM_CALLCONV Add(RECT const& destinationRectangle, _In_opt_ RECT const* sourceRectangle = nullptr, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
+        // Changing a sprite marks its chunk dirty, and the chunk is rebuilt the next time it is
+        // drawn. A sprite keeps its position and size, so swapping between equally sized
+        // tiles is the intended use of SetSourceRectangle.
+        void __cdecl SetSourceRectangle(size_t index, RECT const& sourceRectangle);
+        void XM_CALLCONV SetColor(size_t index, FXMVECTOR color);
+
+        void __cdecl Clear();
+
+        size_t __cdecl GetSpriteCount() const noexcept;
+        size_t __cdecl GetChunkCount() const noexcept;
+
+        // Chunks drawn and rebuilt by the most recent SpriteBatch::DrawLayer call.
+        size_t __cdecl GetDrawnChunkCount() const noexcept;
+        size_t __cdecl GetRebuiltChunkCount() const noexcept;
+
+    private:
+        friend class SpriteBatch;
+
+        // Culls chunks against the clip volume of transform, rebuilds the dirty ones that are
+        // visible, and draws them. Called by SpriteBatch with its shaders and index buffer bound.
+        void __cdecl Render(_In_ ID3D11DeviceContext* deviceContext, CXMMATRIX transform, size_t maxSpritesPerDraw);
+
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+
+        static const XMFLOAT2 Float2Zero;
+    };
+}
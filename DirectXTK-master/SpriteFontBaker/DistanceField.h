@@ -0,0 +1,185 @@
+//--------------------------------------------------------------------------------------
+// File: DistanceField.h
+//
+// Signed distance field generation for SpriteFontBaker. Glyphs are rasterized at several
+// times the output size, and an exact Euclidean distance transform of that bitmap gives
+// the distance from every output pixel to the outline.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+namespace DistanceField
+{
+    // Builds 8 bit distance fields. Holds scratch buffers, so keep one per thread and reuse it.
+    class Generator
+    {
+    public:
+        // coverage is outputWidth * supersample by outputHeight * supersample pixels, and a pixel
+        // is inside the glyph when its coverage is at least half. Output pixels hold 0.5 on the
+        // outline, rising inside and falling outside to reach 1 and 0 at spread output pixels.
+        void Generate(const uint8_t* coverage, int outputWidth, int outputHeight, int supersample, float spread, uint8_t* output)
+        {
+            const size_t width = size_t(outputWidth) * size_t(supersample);
+            const size_t height = size_t(outputHeight) * size_t(supersample);
+
+            // An output pixel center falls between the middle two supersamples, or on the
+            // middle one when supersample is odd, so those are the rows and columns we sample.
+            const size_t first = size_t(supersample - 1) / 2;
+            const size_t last = size_t(supersample) / 2;
+
+            ComputeDistances(coverage, width, height, supersample, first, last, true, mToInside);
+            ComputeDistances(coverage, width, height, supersample, first, last, false, mToOutside);
+
+            const float samples = float((last - first + 1) * (last - first + 1));
+            const float scale = 1.0f / (float(supersample) * samples * 2 * spread);
+
+            for (size_t y = 0; y < size_t(outputHeight); y++)
+            {
+                for (size_t x = 0; x < size_t(outputWidth); x++)
+                {
+                    float distance = 0;
+
+                    for (size_t sy = y * size_t(supersample) + first; sy <= y * size_t(supersample) + last; sy++)
+                    {
+                        for (size_t sx = x * size_t(supersample) + first; sx <= x * size_t(supersample) + last; sx++)
+                        {
+                            distance += SignedDistance(sy * width + sx);
+                        }
+                    }
+
+                    const float value = std::min(std::max(0.5f - distance * scale, 0.0f), 1.0f);
+
+                    output[y * size_t(outputWidth) + x] = uint8_t(value * 255 + 0.5f);
+                }
+            }
+        }
+
+    private:
+        // Marks pixels with nothing to measure from. Never added to, so float is enough.
+        static constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+        // Distance in supersamples from a pixel center to the outline, negative inside. The
+        // outline runs half a pixel from the centers on either side of it.
+        float SignedDistance(size_t index) const noexcept
+        {
+            if (mToInside[index] > 0)
+                return std::sqrt(mToInside[index]) - 0.5f;
+
+            return 0.5f - std::sqrt(mToOutside[index]);
+        }
+
+        // Squared distance from each pixel to the nearest one that is inside, or outside. The
+        // row pass has to cover every pixel, but only the sampled columns need the column pass,
+        // which keeps the strided memory accesses to a quarter of the pixels.
+        void ComputeDistances(const uint8_t* coverage, size_t width, size_t height, int supersample, size_t first, size_t last, bool inside, std::vector<float>& distances)
+        {
+            distances.resize(width * height);
+
+            for (size_t j = 0; j < width * height; j++)
+            {
+                distances[j] = ((coverage[j] >= 128) == inside) ? 0.0f : Infinity;
+            }
+
+            for (size_t y = 0; y < height; y++)
+            {
+                Transform(&distances[y * width], width, 1);
+            }
+
+            for (size_t x = 0; x < width; x += size_t(supersample))
+            {
+                for (size_t column = x + first; column <= x + last; column++)
+                {
+                    Transform(&distances[column], height, width);
+                }
+            }
+        }
+
+        // One dimensional squared distance transform from Felzenszwalb and Huttenlocher,
+        // "Distance Transforms of Sampled Functions": the lower envelope of the parabolas
+        // rooted at each value, in linear time. Infinite values cannot be on the envelope,
+        // so they are skipped, which also makes the empty margins around a glyph cheap.
+        void Transform(float* values, size_t count, size_t stride)
+        {
+            mValues.resize(count);
+            mRoots.resize(count);
+            mBounds.resize(count + 1);
+
+            size_t k = 0;
+            size_t roots = 0;
+
+            for (size_t q = 0; q < count; q++)
+            {
+                const float value = values[q * stride];
+
+                mValues[q] = value;
+
+                if (value == Infinity)
+                    continue;
+
+                const float square = value + float(q) * float(q);
+
+                float s = -Infinity;
+
+                if (roots)
+                {
+                    // Drop the parabolas the new one hides. The first bound is -Infinity, so
+                    // the first parabola is never dropped.
+                    for (;;)
+                    {
+                        const size_t p = mRoots[k];
+
+                        s = (square - (mValues[p] + float(p) * float(p))) / (2 * float(q) - 2 * float(p));
+
+                        if (s > mBounds[k])
+                            break;
+
+                        k--;
+                    }
+
+                    k++;
+                }
+
+                roots = k + 1;
+
+                mRoots[k] = q;
+                mBounds[k] = s;
+                mBounds[k + 1] = Infinity;
+            }
+
+            if (!roots)
+                return;
+
+            k = 0;
+
+            for (size_t q = 0; q < count; q++)
+            {
+                while (mBounds[k + 1] < float(q))
+                    k++;
+
+                const float offset = float(q) - float(mRoots[k]);
+
+                values[q * stride] = offset * offset + mValues[mRoots[k]];
+            }
+        }
+
+        std::vector<float> mToInside;
+        std::vector<float> mToOutside;
+
+        std::vector<float> mValues;
+        std::vector<size_t> mRoots;
+        std::vector<float> mBounds;
+    };
+}
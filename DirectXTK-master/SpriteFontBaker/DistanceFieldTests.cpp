@@ -0,0 +1,257 @@
+//--------------------------------------------------------------------------------------
+// File: DistanceFieldTests.cpp
+//
+// Checks DistanceField::Generator, which SpriteFontBaker uses for -DistanceField. Small
+// random bitmaps must match a brute force search for the nearest inside and outside pixel,
+// and a rasterized half-plane and circle must give the analytic distance to their edge to
+// within the error of rasterizing the edge. Then reports how fast glyph sized fields build.
+//
+// Usage: distancefieldtests [glyphs]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Supersampling and spread of the baker's distance fields
+    constexpr int Supersample = 8;
+    constexpr float Spread = 4.0f;
+
+    // Rasterizes a shape as the baker's coverage bitmaps are: a supersample is inside, 255,
+    // when its center is inside. signedDistance is in output pixels, negative inside.
+    std::vector<uint8_t> Rasterize(int outputWidth, int outputHeight, int supersample, const std::function<double(double, double)>& signedDistance)
+    {
+        const int width = outputWidth * supersample;
+        const int height = outputHeight * supersample;
+
+        std::vector<uint8_t> coverage(size_t(width) * size_t(height));
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const double px = (x + 0.5) / supersample;
+                const double py = (y + 0.5) / supersample;
+                coverage[size_t(y) * size_t(width) + size_t(x)] = signedDistance(px, py) < 0 ? 255 : 0;
+            }
+        }
+        return coverage;
+    }
+
+    // The same field as Generator::Generate, with every distance found by checking every pixel
+    std::vector<uint8_t> BruteForce(const uint8_t* coverage, int outputWidth, int outputHeight, int supersample, float spread)
+    {
+        const int width = outputWidth * supersample;
+        const int height = outputHeight * supersample;
+        const int first = (supersample - 1) / 2;
+        const int last = supersample / 2;
+
+        auto nearest = [&](int x, int y, bool inside)
+        {
+            double best = INFINITY;
+            for (int j = 0; j < height; j++)
+            {
+                for (int i = 0; i < width; i++)
+                {
+                    if ((coverage[size_t(j) * size_t(width) + size_t(i)] >= 128) == inside)
+                    {
+                        best = std::min(best, double(i - x) * double(i - x) + double(j - y) * double(j - y));
+                    }
+                }
+            }
+            return best;
+        };
+
+        const double samples = double((last - first + 1) * (last - first + 1));
+
+        std::vector<uint8_t> output(size_t(outputWidth) * size_t(outputHeight));
+        for (int y = 0; y < outputHeight; y++)
+        {
+            for (int x = 0; x < outputWidth; x++)
+            {
+                double distance = 0;
+                for (int sy = y * supersample + first; sy <= y * supersample + last; sy++)
+                {
+                    for (int sx = x * supersample + first; sx <= x * supersample + last; sx++)
+                    {
+                        const double toInside = nearest(sx, sy, true);
+                        distance += (toInside > 0) ? std::sqrt(toInside) - 0.5 : 0.5 - std::sqrt(nearest(sx, sy, false));
+                    }
+                }
+
+                const double value = std::min(std::max(0.5 - distance / (supersample * samples * 2 * spread), 0.0), 1.0);
+                output[size_t(y) * size_t(outputWidth) + size_t(x)] = uint8_t(value * 255 + 0.5);
+            }
+        }
+        return output;
+    }
+
+    // Float and double rounding can move a value that lands on a half by one step
+    bool TestBruteForce(DistanceField::Generator& generator)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        int worst = 0;
+
+        for (int trial = 0; trial < 24; trial++)
+        {
+            const int supersample = 1 + trial % 4;
+            const int outputWidth = 4 + trial % 7;
+            const int outputHeight = 3 + trial % 5;
+            const float spread = 1.0f + float(trial % 3);
+
+            // Random discs, which gives holes, thin parts and separate pieces
+            std::vector<double> discs;
+            for (int i = 0; i < 1 + trial % 4; i++)
+            {
+                discs.push_back(unit(random) * outputWidth);
+                discs.push_back(unit(random) * outputHeight);
+                discs.push_back(0.3 + unit(random) * 2.0);
+            }
+
+            std::vector<uint8_t> coverage;
+            if (trial == 0)
+            {
+                // Nothing inside
+                coverage.assign(size_t(outputWidth * supersample) * size_t(outputHeight * supersample), 0);
+            }
+            else if (trial == 1)
+            {
+                // Nothing outside
+                coverage.assign(size_t(outputWidth * supersample) * size_t(outputHeight * supersample), 255);
+            }
+            else
+            {
+                coverage = Rasterize(outputWidth, outputHeight, supersample, [&](double x, double y)
+                {
+                    double distance = INFINITY;
+                    for (size_t i = 0; i < discs.size(); i += 3)
+                    {
+                        distance = std::min(distance, std::hypot(x - discs[i], y - discs[i + 1]) - discs[i + 2]);
+                    }
+                    return distance;
+                });
+            }
+
+            std::vector<uint8_t> output(size_t(outputWidth) * size_t(outputHeight));
+            generator.Generate(coverage.data(), outputWidth, outputHeight, supersample, spread, output.data());
+
+            const std::vector<uint8_t> expected = BruteForce(coverage.data(), outputWidth, outputHeight, supersample, spread);
+
+            for (size_t i = 0; i < output.size(); i++)
+            {
+                worst = std::max(worst, std::abs(int(output[i]) - int(expected[i])));
+            }
+        }
+
+        const bool ok = worst <= 1;
+        printf("%-24s largest difference %d/255 %s\n", "brute force", worst, ok ? "ok" : "FAILED");
+        return ok;
+    }
+
+    // Measuring between supersample centers puts an edge off by up to half a supersample
+    // diagonal, which is under 1/11 of an output pixel at the baker's supersampling, or under
+    // 3 steps of 255 over the spread. Rounding to 8 bits adds another half step.
+    bool TestShape(DistanceField::Generator& generator, const char* name, int size, const std::function<double(double, double)>& signedDistance)
+    {
+        const std::vector<uint8_t> coverage = Rasterize(size, size, Supersample, signedDistance);
+
+        std::vector<uint8_t> output(size_t(size) * size_t(size));
+        generator.Generate(coverage.data(), size, size, Supersample, Spread, output.data());
+
+        const double tolerance = (std::sqrt(0.5) / Supersample) / (2 * Spread) + 0.5 / 255;
+
+        double worst = 0;
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                const double distance = signedDistance(x + 0.5, y + 0.5);
+                const double expected = std::min(std::max(0.5 - distance / (2 * Spread), 0.0), 1.0);
+                const double actual = output[size_t(y) * size_t(size) + size_t(x)] / 255.0;
+
+                worst = std::max(worst, std::abs(actual - expected));
+            }
+        }
+
+        const bool ok = worst <= tolerance;
+        printf("%-24s largest error %.2f/255, allowed %.2f/255 %s\n", name, worst * 255, tolerance * 255, ok ? "ok" : "FAILED");
+        return ok;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int glyphs = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+    DistanceField::Generator generator;
+
+    bool ok = TestBruteForce(generator);
+
+    // Not axis aligned, so the edge crosses supersamples at every offset
+    ok &= TestShape(generator, "half-plane", 48, [](double x, double y)
+    {
+        const double angle = 0.3;
+        return (x - 20.3) * std::cos(angle) + (y - 24.7) * std::sin(angle);
+    });
+
+    ok &= TestShape(generator, "circle", 48, [](double x, double y)
+    {
+        return std::hypot(x - 24.2, y - 23.9) - 13.6;
+    });
+
+    ok &= TestShape(generator, "ring", 48, [](double x, double y)
+    {
+        return std::abs(std::hypot(x - 23.7, y - 24.4) - 14.3) - 4.1;
+    });
+
+    // Throughput on a glyph of a 32 pixel font with the spread on each side
+    const int size = 32 + 2 * int(Spread);
+    const std::vector<uint8_t> coverage = Rasterize(size, size, Supersample, [](double x, double y)
+    {
+        return std::abs(std::hypot(x - 20.0, y - 20.0) - 10.0) - 2.5;
+    });
+
+    std::vector<uint8_t> output(size_t(size) * size_t(size));
+
+    double best = 1e30;
+    for (int trial = 0; trial < 5; trial++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < glyphs; i++)
+        {
+            generator.Generate(coverage.data(), size, size, Supersample, Spread, output.data());
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    const double samples = double(coverage.size()) * glyphs;
+    printf("%dx%d glyphs at %dx supersampling: %.3f ms per glyph, %.0f glyphs/s, %.1f Msamples/s, best of 5\n",
+        size, size, Supersample, best * 1000 / glyphs, glyphs / best, samples / best / 1e6);
+
+    if (!ok)
+    {
+        printf("Distance fields are wrong\n");
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
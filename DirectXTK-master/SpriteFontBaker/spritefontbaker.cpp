@@ -0,0 +1,1152 @@
+//--------------------------------------------------------------------------------------
+// File: spritefontbaker.cpp
+//
+// Command-line tool for building .spritefont files from TrueType fonts. It writes the
+// same binary format as the MakeSpriteFont C# tool, but reads font files directly with
+// stb_truetype instead of asking GDI+ for an installed font, so it also runs on Linux.
+// Glyphs are rasterized on all cores and packed with stb_rect_pack's skyline packer.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// stb is third party code, built with its unused functions and without our warning levels.
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#endif
+
+// stb_truetype has its own fallback packer unless stb_rect_pack comes first.
+#define STBRP_STATIC
+#define STBRP_LARGE_RECTS
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imstb_truetype.h"
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include "DistanceField.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+enum OPTIONS : uint32_t
+{
+    OPT_CHARACTER_REGION = 1,
+    OPT_DEFAULT_CHARACTER,
+    OPT_FONT_SIZE,
+    OPT_FONT_INDEX,
+    OPT_LINE_SPACING,
+    OPT_CHARACTER_SPACING,
+    OPT_TEXTURE_FORMAT,
+    OPT_NO_PREMULTIPLY,
+    OPT_DEBUG_OUTPUT,
+    OPT_DISTANCE_FIELD,
+    OPT_FEATURE_LEVEL,
+    OPT_THREADS,
+    OPT_NOLOGO,
+    OPT_MAX
+};
+
+static_assert(OPT_MAX <= 32, "dwOptions is a unsigned int bitfield");
+
+enum TEXTURE_FORMAT : uint32_t
+{
+    FORMAT_AUTO = 1,
+    FORMAT_RGBA32,
+    FORMAT_BGRA4444,
+    FORMAT_COMPRESSED_MONO,
+    FORMAT_DISTANCE_FIELD,
+};
+
+struct SValue
+{
+    const char*     name;
+    uint32_t        value;
+};
+
+const SValue g_pOptions[] =
+{
+    { "CharacterRegion",        OPT_CHARACTER_REGION },
+    { "DefaultCharacter",       OPT_DEFAULT_CHARACTER },
+    { "FontSize",               OPT_FONT_SIZE },
+    { "FontIndex",              OPT_FONT_INDEX },
+    { "LineSpacing",            OPT_LINE_SPACING },
+    { "CharacterSpacing",       OPT_CHARACTER_SPACING },
+    { "TextureFormat",          OPT_TEXTURE_FORMAT },
+    { "NoPremultiply",          OPT_NO_PREMULTIPLY },
+    { "DebugOutputSpriteSheet", OPT_DEBUG_OUTPUT },
+    { "DistanceField",          OPT_DISTANCE_FIELD },
+    { "FeatureLevel",           OPT_FEATURE_LEVEL },
+    { "Threads",                OPT_THREADS },
+    { "nologo",                 OPT_NOLOGO },
+    { nullptr,                  0 }
+};
+
+const SValue g_pFormats[] =
+{
+    { "Auto",           FORMAT_AUTO },
+    { "Rgba32",         FORMAT_RGBA32 },
+    { "Bgra4444",       FORMAT_BGRA4444 },
+    { "CompressedMono", FORMAT_COMPRESSED_MONO },
+    { nullptr,          0 }
+};
+
+const SValue g_pFeatureLevels[] =   // Maximum texture size
+{
+    { "FL9_1",  2048 },
+    { "FL9_2",  2048 },
+    { "FL9_3",  4096 },
+    { "FL10_0", 8192 },
+    { "FL10_1", 8192 },
+    { "FL11_0", 16384 },
+    { "FL11_1", 16384 },
+    { "FL12_0", 16384 },
+    { "FL12_1", 16384 },
+    { nullptr,  0 }
+};
+
+struct Options
+{
+    std::string sourceFont;
+    std::string outputFile;
+    std::string debugOutputFile;
+    std::vector<std::pair<uint32_t, uint32_t>> characterRegions;
+    uint32_t defaultCharacter = 0;
+    float fontSize = 23;
+    int fontIndex = 0;
+    float lineSpacing = 0;
+    float characterSpacing = 0;
+    uint32_t textureFormat = FORMAT_AUTO;
+    bool noPremultiply = false;
+    uint32_t maxTextureSize = 2048;
+    unsigned threads = 0;
+    float distanceFieldSpread = 0;
+};
+
+// How glyphs are rasterized, shared by all the threads.
+struct RasterSettings
+{
+    const stbtt_fontinfo* font;
+    float scale;
+    float baseline;
+    float distanceFieldSpread;
+};
+
+// A rasterized glyph. Until the sprite sheet is assembled the pixels are a tight alpha-only
+// bitmap of width x height, afterwards subrect locates the glyph in the sheet.
+struct BakedGlyph
+{
+    uint32_t character;
+    int width;
+    int height;
+    float xOffset;
+    float yOffset;
+    float xAdvance;
+    std::vector<uint8_t> alpha;
+    int32_t subrect[4];
+};
+
+struct SpriteSheet
+{
+    int width;
+    int height;
+    std::vector<uint8_t> alpha;
+};
+
+namespace
+{
+    bool EqualsIgnoreCase(const char* a, const char* b) noexcept
+    {
+        for (; *a && *b; a++, b++)
+        {
+            if (tolower(static_cast<unsigned char>(*a)) != tolower(static_cast<unsigned char>(*b)))
+                return false;
+        }
+
+        return *a == *b;
+    }
+
+    uint32_t LookupByName(const char* pName, const SValue* pArray) noexcept
+    {
+        while (pArray->name)
+        {
+            if (EqualsIgnoreCase(pName, pArray->name))
+                return pArray->value;
+
+            pArray++;
+        }
+
+        return 0;
+    }
+
+    const char* LookupByValue(uint32_t value, const SValue* pArray) noexcept
+    {
+        while (pArray->name)
+        {
+            if (value == pArray->value)
+                return pArray->name;
+
+            pArray++;
+        }
+
+        return "";
+    }
+
+    // Parses a character as used by -CharacterRegion and -DefaultCharacter: either the
+    // character itself in UTF-8, or its code point in decimal or 0x prefixed hex.
+    bool ParseCharacter(const std::string& value, uint32_t& character)
+    {
+        if (value.empty())
+            return false;
+
+        auto bytes = reinterpret_cast<const unsigned char*>(value.c_str());
+        size_t length = (bytes[0] < 0x80) ? 1 : (bytes[0] >= 0xF0) ? 4 : (bytes[0] >= 0xE0) ? 3 : (bytes[0] >= 0xC0) ? 2 : 0;
+
+        if (length == value.size() && (length != 1 || !isdigit(bytes[0])))
+        {
+            static const uint32_t leadMasks[] = { 0, 0x7F, 0x1F, 0x0F, 0x07 };
+
+            character = bytes[0] & leadMasks[length];
+
+            for (size_t j = 1; j < length; j++)
+            {
+                if ((bytes[j] & 0xC0) != 0x80)
+                    return false;
+
+                character = (character << 6) | (bytes[j] & 0x3F);
+            }
+        }
+        else
+        {
+            char* end = nullptr;
+            unsigned long number = strtoul(value.c_str(), &end, 0);
+
+            if (*end || number > 0x10FFFF)
+                return false;
+
+            character = static_cast<uint32_t>(number);
+        }
+
+        return true;
+    }
+
+    // Accepts "A", "A-Z", "32-127" or "0x20-0x7F".
+    bool ParseCharacterRegion(const char* value, std::pair<uint32_t, uint32_t>& region)
+    {
+        std::string text(value);
+
+        // Skip the first character when splitting, so a lone "-" is a character too.
+        size_t split = (text.size() > 1) ? text.find('-', 1) : std::string::npos;
+
+        if (split == std::string::npos)
+        {
+            if (!ParseCharacter(text, region.first))
+                return false;
+
+            region.second = region.first;
+            return true;
+        }
+
+        return ParseCharacter(text.substr(0, split), region.first)
+            && ParseCharacter(text.substr(split + 1), region.second)
+            && region.first <= region.second;
+    }
+
+    bool ParseFloat(const char* value, float& result)
+    {
+        char* end = nullptr;
+        result = strtof(value, &end);
+        return (end != value) && !*end && std::isfinite(result);
+    }
+
+    void PrintLogo()
+    {
+        printf("Microsoft (R) SpriteFont Baker [DirectXTK]\n");
+        printf("Copyright (C) Microsoft Corp.\n");
+#ifdef _DEBUG
+        printf("*** Debug build ***\n");
+#endif
+        printf("\n");
+    }
+
+    void PrintUsage()
+    {
+        PrintLogo();
+
+        printf("Usage: spritefontbaker <options> <font-file> <spritefont-file>\n");
+        printf("\n");
+        printf("   -CharacterRegion:<region>     characters to include, as A, A-Z, 32-127 or\n");
+        printf("                                 0x20-0x7F, may be repeated (default ' '-'~')\n");
+        printf("   -DefaultCharacter:<char>      fallback for characters missing from the font\n");
+        printf("   -FontSize:<points>            size in points at 96 DPI (default 23)\n");
+        printf("   -FontIndex:<index>            font to use from a .ttc collection\n");
+        printf("   -LineSpacing:<pixels>         added to the font's line spacing\n");
+        printf("   -CharacterSpacing:<pixels>    added to every character's advance\n");
+        printf("   -TextureFormat:<format>       Auto, Rgba32, Bgra4444 or CompressedMono\n");
+        printf("   -NoPremultiply                write straight instead of premultiplied alpha\n");
+        printf("   -DebugOutputSpriteSheet:<tga> also save the sprite sheet as a .tga image\n");
+        printf("   -DistanceField:<pixels>       bake a signed distance field reaching <pixels>\n");
+        printf("                                 beyond the outline, drawn at any size with\n");
+        printf("                                 SpriteBatch::SetDistanceFieldMode\n");
+        printf("   -FeatureLevel:<level>         warn if the texture is too large for FL9_1\n");
+        printf("                                 through FL12_1 (default FL9_1)\n");
+        printf("   -Threads:<count>              rasterization threads (default all cores)\n");
+        printf("   -nologo                       suppress copyright message\n");
+    }
+
+    double Milliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<uint8_t> ReadFile(const std::string& fileName)
+    {
+        std::ifstream inFile(fileName, std::ios::binary);
+        if (!inFile)
+            throw std::runtime_error("Can't open font file '" + fileName + "'.");
+
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+    }
+
+    // Shrinks a glyph to the bounds of its non-zero pixels, adjusting the offsets so it
+    // draws in the same place. Empty glyphs such as spaces become a single clear pixel.
+    void CropGlyph(BakedGlyph& glyph, int left, int top)
+    {
+        int x0 = glyph.width;
+        int y0 = glyph.height;
+        int x1 = 0;
+        int y1 = 0;
+
+        for (int y = 0; y < glyph.height; y++)
+        {
+            for (int x = 0; x < glyph.width; x++)
+            {
+                if (glyph.alpha[size_t(y) * size_t(glyph.width) + size_t(x)])
+                {
+                    x0 = std::min(x0, x);
+                    y0 = std::min(y0, y);
+                    x1 = std::max(x1, x + 1);
+                    y1 = std::max(y1, y + 1);
+                }
+            }
+        }
+
+        if (x0 >= x1)
+        {
+            glyph.width = 1;
+            glyph.height = 1;
+            glyph.alpha.assign(1, 0);
+            return;
+        }
+
+        std::vector<uint8_t> cropped(size_t(x1 - x0) * size_t(y1 - y0));
+
+        for (int y = y0; y < y1; y++)
+        {
+            memcpy(&cropped[size_t(y - y0) * size_t(x1 - x0)], &glyph.alpha[size_t(y) * size_t(glyph.width) + size_t(x0)], size_t(x1 - x0));
+        }
+
+        glyph.alpha.swap(cropped);
+        glyph.width = x1 - x0;
+        glyph.height = y1 - y0;
+        glyph.xOffset = float(left + x0);
+        glyph.yOffset += float(top + y0);
+    }
+
+    int FloorDivide(int value, int divisor) noexcept
+    {
+        return (value >= 0) ? value / divisor : -((divisor - 1 - value) / divisor);
+    }
+
+    // Rasterizes a glyph at DistanceFieldSupersample times the output size, padded by the
+    // spread on each side, and turns it into a distance field. Not cropped, as the field
+    // is non-zero up to the spread beyond the outline.
+    void BakeDistanceField(const RasterSettings& settings, int glyphIndex, DistanceField::Generator& generator, std::vector<uint8_t>& coverage, BakedGlyph& glyph)
+    {
+        constexpr int DistanceFieldSupersample = 8;
+
+        const float scale = settings.scale * DistanceFieldSupersample;
+
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBox(settings.font, glyphIndex, scale, scale, &x0, &y0, &x1, &y1);
+
+        if (x1 <= x0 || y1 <= y0)
+        {
+            glyph.width = 1;
+            glyph.height = 1;
+            glyph.alpha.assign(1, 0);
+            return;
+        }
+
+        // Align the supersampled bitmap to the output pixel grid.
+        const int padding = int(std::ceil(settings.distanceFieldSpread));
+        const int left = FloorDivide(x0, DistanceFieldSupersample) - padding;
+        const int top = FloorDivide(y0, DistanceFieldSupersample) - padding;
+
+        glyph.width = FloorDivide(x1 - 1, DistanceFieldSupersample) + 1 + padding - left;
+        glyph.height = FloorDivide(y1 - 1, DistanceFieldSupersample) + 1 + padding - top;
+        glyph.xOffset = float(left);
+        glyph.yOffset += float(top);
+
+        const size_t stride = size_t(glyph.width) * DistanceFieldSupersample;
+        const size_t offsetX = size_t(x0 - left * DistanceFieldSupersample);
+        const size_t offsetY = size_t(y0 - top * DistanceFieldSupersample);
+
+        coverage.assign(stride * size_t(glyph.height) * DistanceFieldSupersample, 0);
+
+        stbtt_MakeGlyphBitmap(settings.font, &coverage[offsetY * stride + offsetX], x1 - x0, y1 - y0, int(stride), scale, scale, glyphIndex);
+
+        glyph.alpha.resize(size_t(glyph.width) * size_t(glyph.height));
+
+        generator.Generate(coverage.data(), glyph.width, glyph.height, DistanceFieldSupersample, settings.distanceFieldSpread, glyph.alpha.data());
+    }
+
+    // Rasterizes one character. Returns false if the font does not contain it.
+    bool BakeGlyph(const RasterSettings& settings, uint32_t character, DistanceField::Generator& generator, std::vector<uint8_t>& coverage, BakedGlyph& glyph)
+    {
+        int glyphIndex = stbtt_FindGlyphIndex(settings.font, int(character));
+        if (!glyphIndex)
+            return false;
+
+        int advance, leftSideBearing;
+        stbtt_GetGlyphHMetrics(settings.font, glyphIndex, &advance, &leftSideBearing);
+
+        glyph.character = character;
+        glyph.xOffset = 0;
+        glyph.yOffset = settings.baseline;
+
+        if (settings.distanceFieldSpread > 0)
+        {
+            BakeDistanceField(settings, glyphIndex, generator, coverage, glyph);
+        }
+        else
+        {
+            int x0, y0, x1, y1;
+            stbtt_GetGlyphBitmapBox(settings.font, glyphIndex, settings.scale, settings.scale, &x0, &y0, &x1, &y1);
+
+            glyph.width = std::max(x1 - x0, 0);
+            glyph.height = std::max(y1 - y0, 0);
+            glyph.alpha.assign(size_t(glyph.width) * size_t(glyph.height), 0);
+
+            if (!glyph.alpha.empty())
+            {
+                stbtt_MakeGlyphBitmap(settings.font, glyph.alpha.data(), glyph.width, glyph.height, glyph.width, settings.scale, settings.scale, glyphIndex);
+            }
+
+            CropGlyph(glyph, x0, y0);
+        }
+
+        // SpriteFont advances by xOffset + width + xAdvance.
+        glyph.xAdvance = float(advance) * settings.scale - glyph.xOffset - float(glyph.width);
+
+        return true;
+    }
+
+    // Rasterizes every character on a pool of threads. Characters are handed out in small
+    // batches, so a thread that draws big CJK glyphs does not hold up the others.
+    std::vector<BakedGlyph> BakeGlyphs(const RasterSettings& settings, const std::vector<uint32_t>& characters, unsigned threadCount, size_t& missing)
+    {
+        constexpr size_t BatchSize = 32;
+
+        std::vector<BakedGlyph> glyphs(characters.size());
+        std::vector<uint8_t> found(characters.size());
+
+        std::atomic<size_t> next(0);
+        std::exception_ptr failure;
+        std::mutex failureLock;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                DistanceField::Generator generator;
+                std::vector<uint8_t> coverage;
+
+                for (size_t start = next.fetch_add(BatchSize); start < characters.size(); start = next.fetch_add(BatchSize))
+                {
+                    size_t end = std::min(start + BatchSize, characters.size());
+
+                    for (size_t j = start; j < end; j++)
+                    {
+                        found[j] = BakeGlyph(settings, characters[j], generator, coverage, glyphs[j]) ? 1 : 0;
+                    }
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(failureLock);
+
+                if (!failure)
+                    failure = std::current_exception();
+
+                next = characters.size();
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for (unsigned j = 1; j < threadCount; j++)
+        {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        if (failure)
+            std::rethrow_exception(failure);
+
+        // Drop the characters the font does not have, keeping code point order.
+        size_t count = 0;
+
+        for (size_t j = 0; j < glyphs.size(); j++)
+        {
+            if (found[j])
+            {
+                if (count != j)
+                    glyphs[count] = std::move(glyphs[j]);
+
+                count++;
+            }
+        }
+
+        missing = glyphs.size() - count;
+        glyphs.resize(count);
+
+        return glyphs;
+    }
+
+    // Rounds a value up to the next larger valid texture size, a multiple of 4 in case we
+    // want to block compress, optionally a power of two.
+    int MakeValidTextureSize(int value, bool requirePowerOfTwo) noexcept
+    {
+        constexpr int blockSize = 4;
+
+        if (requirePowerOfTwo)
+        {
+            int powerOfTwo = blockSize;
+
+            while (powerOfTwo < value)
+                powerOfTwo <<= 1;
+
+            return powerOfTwo;
+        }
+
+        return (value + blockSize - 1) & ~(blockSize - 1);
+    }
+
+    // Packs the glyphs into a sprite sheet with a one pixel border around each, replicating
+    // edge pixels into the border so bilinear filtering does not bleed in neighbours.
+    SpriteSheet ArrangeGlyphs(std::vector<BakedGlyph>& glyphs)
+    {
+        std::vector<stbrp_rect> rects(glyphs.size());
+
+        int maxWidth = 0;
+        uint64_t totalSize = 0;
+
+        for (size_t j = 0; j < glyphs.size(); j++)
+        {
+            rects[j].id = int(j);
+            rects[j].w = glyphs[j].width + 2;
+            rects[j].h = glyphs[j].height + 2;
+
+            maxWidth = std::max(maxWidth, int(rects[j].w));
+            totalSize += uint64_t(rects[j].w) * uint64_t(rects[j].h);
+        }
+
+        // Aim for a roughly square sheet, growing it if the skyline cannot fit everything.
+        SpriteSheet sheet = {};
+        sheet.width = MakeValidTextureSize(std::max(int(std::sqrt(double(totalSize))), maxWidth), true);
+
+        for (;;)
+        {
+            std::vector<stbrp_node> nodes(size_t(sheet.width));
+
+            stbrp_context context;
+            stbrp_init_target(&context, sheet.width, sheet.width * 2, nodes.data(), int(nodes.size()));
+            stbrp_setup_heuristic(&context, STBRP_HEURISTIC_Skyline_BF_sortHeight);
+
+            if (stbrp_pack_rects(&context, rects.data(), int(rects.size())))
+                break;
+
+            sheet.width *= 2;
+        }
+
+        for (auto& rect : rects)
+        {
+            sheet.height = std::max(sheet.height, int(rect.y + rect.h));
+        }
+
+        sheet.height = MakeValidTextureSize(sheet.height, false);
+        sheet.alpha.assign(size_t(sheet.width) * size_t(sheet.height), 0);
+
+        for (auto& rect : rects)
+        {
+            auto& glyph = glyphs[size_t(rect.id)];
+
+            const int left = rect.x + 1;
+            const int top = rect.y + 1;
+
+            for (int y = -1; y <= glyph.height; y++)
+            {
+                const int sourceY = std::min(std::max(y, 0), glyph.height - 1);
+
+                for (int x = -1; x <= glyph.width; x++)
+                {
+                    const int sourceX = std::min(std::max(x, 0), glyph.width - 1);
+
+                    sheet.alpha[size_t(top + y) * size_t(sheet.width) + size_t(left + x)] = glyph.alpha[size_t(sourceY) * size_t(glyph.width) + size_t(sourceX)];
+                }
+            }
+
+            glyph.subrect[0] = left;
+            glyph.subrect[1] = top;
+            glyph.subrect[2] = left + glyph.width;
+            glyph.subrect[3] = top + glyph.height;
+
+            glyph.alpha.clear();
+            glyph.alpha.shrink_to_fit();
+        }
+
+        printf("Packing efficiency %.1f%%\n", 100.0 * double(totalSize) / (double(sheet.width) * double(sheet.height)));
+
+        return sheet;
+    }
+
+    // The file format is little-endian, as are all the platforms we build on.
+    template<typename T>
+    void Write(std::ofstream& outFile, T value)
+    {
+        outFile.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // The rasterized sheet is white text with alpha coverage, this expands it to RGBA.
+    void GetPixel(const SpriteSheet& sheet, size_t index, bool premultiply, uint8_t rgba[4]) noexcept
+    {
+        const uint8_t a = sheet.alpha[index];
+        const uint8_t c = premultiply ? a : uint8_t(255);
+
+        rgba[0] = c;
+        rgba[1] = c;
+        rgba[2] = c;
+        rgba[3] = a;
+    }
+
+    // Block compresses a monochrome sprite sheet as BC2 (DXT3), with the endpoints fixed
+    // at black and white so solid areas stay exact. See SpriteFontWriter.cs for details.
+    void WriteCompressedMono(std::ofstream& outFile, const SpriteSheet& sheet, bool premultiply)
+    {
+        for (int blockY = 0; blockY < sheet.height; blockY += 4)
+        {
+            for (int blockX = 0; blockX < sheet.width; blockX += 4)
+            {
+                uint64_t alphaBits = 0;
+                uint32_t rgbBits = 0;
+
+                int pixelCount = 0;
+
+                for (int y = 0; y < 4; y++)
+                {
+                    for (int x = 0; x < 4; x++)
+                    {
+                        const int value = sheet.alpha[size_t(blockY + y) * size_t(sheet.width) + size_t(blockX + x)];
+
+                        uint64_t alpha;
+                        uint32_t rgb;
+
+                        if (!premultiply)
+                        {
+                            // If we are not premultiplied, RGB is always white and we have 4 bit alpha.
+                            alpha = uint64_t(value >> 4);
+                            rgb = 0;
+                        }
+                        else if (value < 256 / 6)
+                        {
+                            alpha = 0;
+                            rgb = 1;
+                        }
+                        else if (value < 256 / 2)
+                        {
+                            alpha = 5;
+                            rgb = 3;
+                        }
+                        else if (value < 256 * 5 / 6)
+                        {
+                            alpha = 10;
+                            rgb = 2;
+                        }
+                        else
+                        {
+                            alpha = 15;
+                            rgb = 0;
+                        }
+
+                        alphaBits |= alpha << (pixelCount * 4);
+                        rgbBits |= rgb << (pixelCount * 2);
+
+                        pixelCount++;
+                    }
+                }
+
+                Write<uint64_t>(outFile, alphaBits);
+                Write<uint16_t>(outFile, 0xFFFF);
+                Write<uint16_t>(outFile, 0);
+                Write<uint32_t>(outFile, rgbBits);
+            }
+        }
+    }
+
+    void WriteSpriteFont(const Options& options, const std::vector<BakedGlyph>& glyphs, float lineSpacing, const SpriteSheet& sheet, uint32_t textureFormat)
+    {
+        constexpr uint32_t DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+        constexpr uint32_t DXGI_FORMAT_R8_UNORM = 61;
+        constexpr uint32_t DXGI_FORMAT_BC2_UNORM = 74;
+        constexpr uint32_t DXGI_FORMAT_B4G4R4A4_UNORM = 115;
+
+        std::ofstream outFile(options.outputFile, std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            throw std::runtime_error("Can't create output file '" + options.outputFile + "'.");
+
+        outFile.write("DXTKfont", 8);
+
+        Write<uint32_t>(outFile, uint32_t(glyphs.size()));
+
+        for (auto& glyph : glyphs)
+        {
+            Write<uint32_t>(outFile, glyph.character);
+
+            for (auto edge : glyph.subrect)
+            {
+                Write<int32_t>(outFile, edge);
+            }
+
+            Write<float>(outFile, glyph.xOffset);
+            Write<float>(outFile, glyph.yOffset);
+            Write<float>(outFile, glyph.xAdvance);
+        }
+
+        Write<float>(outFile, lineSpacing);
+        Write<uint32_t>(outFile, options.defaultCharacter);
+
+        Write<uint32_t>(outFile, uint32_t(sheet.width));
+        Write<uint32_t>(outFile, uint32_t(sheet.height));
+
+        const bool premultiply = !options.noPremultiply;
+        const size_t pixelCount = sheet.alpha.size();
+
+        switch (textureFormat)
+        {
+        case FORMAT_RGBA32:
+            Write<uint32_t>(outFile, DXGI_FORMAT_R8G8B8A8_UNORM);
+            Write<uint32_t>(outFile, uint32_t(sheet.width) * 4);
+            Write<uint32_t>(outFile, uint32_t(sheet.height));
+
+            for (size_t j = 0; j < pixelCount; j++)
+            {
+                uint8_t rgba[4];
+                GetPixel(sheet, j, premultiply, rgba);
+
+                outFile.write(reinterpret_cast<const char*>(rgba), sizeof(rgba));
+            }
+            break;
+
+        case FORMAT_BGRA4444:
+            Write<uint32_t>(outFile, DXGI_FORMAT_B4G4R4A4_UNORM);
+            Write<uint32_t>(outFile, uint32_t(sheet.width) * sizeof(uint16_t));
+            Write<uint32_t>(outFile, uint32_t(sheet.height));
+
+            for (size_t j = 0; j < pixelCount; j++)
+            {
+                uint8_t rgba[4];
+                GetPixel(sheet, j, premultiply, rgba);
+
+                Write<uint16_t>(outFile, uint16_t((rgba[2] >> 4) | ((rgba[1] >> 4) << 4) | ((rgba[0] >> 4) << 8) | ((rgba[3] >> 4) << 12)));
+            }
+            break;
+
+        case FORMAT_DISTANCE_FIELD:
+            // Distances are not colors, so these are neither premultiplied nor block compressed.
+            Write<uint32_t>(outFile, DXGI_FORMAT_R8_UNORM);
+            Write<uint32_t>(outFile, uint32_t(sheet.width));
+            Write<uint32_t>(outFile, uint32_t(sheet.height));
+
+            outFile.write(reinterpret_cast<const char*>(sheet.alpha.data()), std::streamsize(pixelCount));
+            break;
+
+        default:
+            Write<uint32_t>(outFile, DXGI_FORMAT_BC2_UNORM);
+            Write<uint32_t>(outFile, uint32_t(sheet.width) * 4);
+            Write<uint32_t>(outFile, uint32_t(sheet.height) / 4);
+
+            WriteCompressedMono(outFile, sheet, premultiply);
+            break;
+        }
+
+        // Older SpriteFont versions stop reading after the texture, newer ones look for this
+        // trailer to tell distance field fonts apart.
+        if (textureFormat == FORMAT_DISTANCE_FIELD)
+        {
+            outFile.write("DXTKdist", 8);
+
+            Write<float>(outFile, options.distanceFieldSpread);
+        }
+
+        if (!outFile)
+            throw std::runtime_error("Failed writing output file '" + options.outputFile + "'.");
+    }
+
+    // Saves the sprite sheet as an uncompressed 32 bit .tga, which most image viewers open.
+    void WriteDebugSpriteSheet(const std::string& fileName, const SpriteSheet& sheet, bool premultiply)
+    {
+        std::ofstream outFile(fileName, std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            throw std::runtime_error("Can't create debug output file '" + fileName + "'.");
+
+        const uint8_t header[18] =
+        {
+            0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            uint8_t(sheet.width), uint8_t(sheet.width >> 8),
+            uint8_t(sheet.height), uint8_t(sheet.height >> 8),
+            32, 0x28 // Top-down rows with 8 bits of alpha
+        };
+
+        outFile.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+        for (size_t j = 0; j < sheet.alpha.size(); j++)
+        {
+            uint8_t rgba[4];
+            GetPixel(sheet, j, premultiply, rgba);
+
+            const uint8_t bgra[4] = { rgba[2], rgba[1], rgba[0], rgba[3] };
+            outFile.write(reinterpret_cast<const char*>(bgra), sizeof(bgra));
+        }
+    }
+
+    void MakeSpriteFont(Options& options)
+    {
+        printf("Importing %s\n", options.sourceFont.c_str());
+
+        auto fontData = ReadFile(options.sourceFont);
+
+        const int fontOffset = stbtt_GetFontOffsetForIndex(fontData.data(), options.fontIndex);
+
+        stbtt_fontinfo font = {};
+        if (fontOffset < 0 || !stbtt_InitFont(&font, fontData.data(), fontOffset))
+            throw std::runtime_error("'" + options.sourceFont + "' is not a TrueType font, or has no font at that index.");
+
+        // Sizes are in points at 96 DPI, matching MakeSpriteFont.
+        const float scale = stbtt_ScaleForMappingEmToPixels(&font, options.fontSize * 96 / 72);
+
+        int ascent, descent, lineGap;
+        stbtt_GetFontVMetrics(&font, &ascent, &descent, &lineGap);
+
+        const float baseline = std::round(float(ascent) * scale);
+        const float lineSpacing = float(ascent - descent + lineGap) * scale + options.lineSpacing;
+
+        // Which characters do we want to include?
+        if (options.characterRegions.empty())
+        {
+            options.characterRegions.emplace_back(uint32_t(' '), uint32_t('~'));
+        }
+
+        std::vector<uint32_t> characters;
+
+        for (auto& region : options.characterRegions)
+        {
+            for (uint64_t character = region.first; character <= region.second; character++)
+            {
+                characters.push_back(uint32_t(character));
+            }
+        }
+
+        std::sort(characters.begin(), characters.end());
+        characters.erase(std::unique(characters.begin(), characters.end()), characters.end());
+
+        // Rasterize.
+        unsigned threadCount = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+        threadCount = unsigned(std::min<size_t>(threadCount, (characters.size() + 31) / 32));
+
+        auto start = std::chrono::steady_clock::now();
+
+        size_t missing = 0;
+        const RasterSettings settings = { &font, scale, baseline, options.distanceFieldSpread };
+
+        auto glyphs = BakeGlyphs(settings, characters, threadCount, missing);
+
+        printf("Captured %zu glyphs on %u threads in %.1f ms\n", glyphs.size(), threadCount, Milliseconds(start));
+
+        if (missing)
+        {
+            printf("WARNING: %zu requested characters are not in the font and were skipped\n", missing);
+        }
+
+        if (glyphs.empty())
+            throw std::runtime_error("Font does not contain any glyphs.");
+
+        auto defaultGlyph = std::lower_bound(glyphs.begin(), glyphs.end(), options.defaultCharacter,
+            [](const BakedGlyph& glyph, uint32_t character) { return glyph.character < character; });
+
+        if (options.defaultCharacter
+            && (defaultGlyph == glyphs.end() || defaultGlyph->character != options.defaultCharacter))
+        {
+            throw std::runtime_error("The specified DefaultCharacter is not part of this font.");
+        }
+
+        for (auto& glyph : glyphs)
+        {
+            glyph.xAdvance += options.characterSpacing;
+        }
+
+        // Pack.
+        printf("Packing glyphs into sprite sheet\n");
+
+        start = std::chrono::steady_clock::now();
+
+        auto sheet = ArrangeGlyphs(glyphs);
+
+        printf("Packed %d x %d sprite sheet in %.1f ms\n", sheet.width, sheet.height, Milliseconds(start));
+
+        // Emit texture size warning based on known Feature Level limits.
+        if (sheet.width > 16384 || sheet.height > 16384)
+        {
+            printf("WARNING: Resulting texture is too large for all known Feature Levels (9.1 - 12.1)\n");
+        }
+        else if (sheet.width > int(options.maxTextureSize) || sheet.height > int(options.maxTextureSize))
+        {
+            printf("WARNING: Resulting texture is larger than %u, the limit of the requested Feature Level\n", options.maxTextureSize);
+        }
+
+        // Glyphs are rasterized white, so the automatic choice is always the monochrome format.
+        uint32_t textureFormat = (options.textureFormat == FORMAT_AUTO) ? uint32_t(FORMAT_COMPRESSED_MONO) : options.textureFormat;
+
+        if (options.distanceFieldSpread > 0)
+        {
+            textureFormat = FORMAT_DISTANCE_FIELD;
+        }
+        else if (!options.noPremultiply)
+        {
+            printf("Premultiplying alpha\n");
+        }
+
+        if (!options.debugOutputFile.empty())
+        {
+            printf("Saving debug output spritesheet %s\n", options.debugOutputFile.c_str());
+
+            WriteDebugSpriteSheet(options.debugOutputFile, sheet, !options.noPremultiply);
+        }
+
+        printf("Writing %s (%s format)\n", options.outputFile.c_str(),
+            (textureFormat == FORMAT_DISTANCE_FIELD) ? "DistanceField" : LookupByValue(textureFormat, g_pFormats));
+
+        WriteSpriteFont(options, glyphs, lineSpacing, sheet, textureFormat);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    Options options;
+
+    // Process command line
+    uint32_t dwOptions = 0;
+    std::vector<std::string> files;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        char* pArg = argv[iArg];
+
+#ifdef _WIN32
+        if (('-' == pArg[0]) || ('/' == pArg[0]))
+#else
+        if ('-' == pArg[0])
+#endif
+        {
+            pArg++;
+            char* pValue;
+
+            for (pValue = pArg; *pValue && (':' != *pValue); pValue++);
+
+            if (*pValue)
+                *pValue++ = 0;
+
+            uint32_t dwOption = LookupByName(pArg, g_pOptions);
+
+            if (!dwOption || ((dwOptions & (1 << dwOption)) && dwOption != OPT_CHARACTER_REGION))
+            {
+                PrintUsage();
+                return 1;
+            }
+
+            dwOptions |= 1 << dwOption;
+
+            // Handle options with additional value parameter
+            switch (dwOption)
+            {
+            case OPT_NO_PREMULTIPLY:
+            case OPT_NOLOGO:
+                break;
+
+            default:
+                if (!*pValue)
+                {
+                    if ((iArg + 1 >= argc))
+                    {
+                        PrintUsage();
+                        return 1;
+                    }
+
+                    iArg++;
+                    pValue = argv[iArg];
+                }
+                break;
+            }
+
+            bool valid = true;
+
+            switch (dwOption)
+            {
+            case OPT_CHARACTER_REGION:
+            {
+                std::pair<uint32_t, uint32_t> region;
+                valid = ParseCharacterRegion(pValue, region);
+                options.characterRegions.push_back(region);
+            }
+            break;
+
+            case OPT_DEFAULT_CHARACTER:
+                // SpriteFont reads the default character as a wchar_t.
+                valid = ParseCharacter(pValue, options.defaultCharacter) && options.defaultCharacter <= 0xFFFF;
+                break;
+
+            case OPT_FONT_SIZE:
+                valid = ParseFloat(pValue, options.fontSize) && options.fontSize > 0;
+                break;
+
+            case OPT_FONT_INDEX:
+                options.fontIndex = atoi(pValue);
+                valid = options.fontIndex >= 0;
+                break;
+
+            case OPT_LINE_SPACING:
+                valid = ParseFloat(pValue, options.lineSpacing);
+                break;
+
+            case OPT_CHARACTER_SPACING:
+                valid = ParseFloat(pValue, options.characterSpacing);
+                break;
+
+            case OPT_TEXTURE_FORMAT:
+                options.textureFormat = LookupByName(pValue, g_pFormats);
+                valid = options.textureFormat != 0;
+                break;
+
+            case OPT_NO_PREMULTIPLY:
+                options.noPremultiply = true;
+                break;
+
+            case OPT_DEBUG_OUTPUT:
+                options.debugOutputFile = pValue;
+                break;
+
+            case OPT_FEATURE_LEVEL:
+                options.maxTextureSize = LookupByName(pValue, g_pFeatureLevels);
+                valid = options.maxTextureSize != 0;
+                break;
+
+            case OPT_THREADS:
+                options.threads = unsigned(atoi(pValue));
+                valid = options.threads > 0;
+                break;
+
+            case OPT_DISTANCE_FIELD:
+                valid = ParseFloat(pValue, options.distanceFieldSpread) && options.distanceFieldSpread > 0;
+                break;
+            }
+
+            if (!valid)
+            {
+                printf("Invalid value specified with -%s (%s)\n\n", pArg, pValue);
+                PrintUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            files.emplace_back(pArg);
+        }
+    }
+
+    if (files.size() != 2)
+    {
+        printf("ERROR: Need a font file and an output file\n\n");
+        PrintUsage();
+        return 1;
+    }
+
+    if ((dwOptions & (1 << OPT_DISTANCE_FIELD)) && (dwOptions & ((1 << OPT_TEXTURE_FORMAT) | (1 << OPT_NO_PREMULTIPLY))))
+    {
+        printf("-DistanceField cannot be combined with -TextureFormat or -NoPremultiply\n");
+        return 1;
+    }
+
+    options.sourceFont = files[0];
+    options.outputFile = files[1];
+
+    if (~dwOptions & (1 << OPT_NOLOGO))
+        PrintLogo();
+
+    try
+    {
+        MakeSpriteFont(options);
+    }
+    catch (const std::exception& e)
+    {
+        printf("\n");
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -96,3 +96,84 @@ HRESULT BinaryReader::ReadEntireFile(
 
     return S_OK;
 }
+
+
+//--------------------------------------------------------------------------------------
+MappedFile::MappedFile() noexcept :
+    mData(nullptr),
+    mSize(0),
+    mView(nullptr)
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+void MappedFile::Close() noexcept
+{
+    if (mView)
+    {
+        UnmapViewOfFile(mView);
+        mView = nullptr;
+    }
+
+    mOwnedData.reset();
+    mData = nullptr;
+    mSize = 0;
+}
+
+
+// Maps the file into memory, or reads it in where mapping is not available.
+HRESULT MappedFile::Open(_In_z_ wchar_t const* fileName)
+{
+    Close();
+
+    if (!fileName)
+        return E_INVALIDARG;
+
+#if !defined(WINAPI_FAMILY) || (WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP)
+    ScopedHandle hFile(safe_handle(CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+
+    if (!hFile)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // Same 32-bit limit as ReadEntireFile; empty files cannot be mapped
+    if (fileInfo.EndOfFile.HighPart > 0)
+        return E_FAIL;
+
+    if (!fileInfo.EndOfFile.LowPart)
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    // The mapping object can be closed as soon as the view exists, the view keeps the file alive
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!hMapping)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    mView = MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0);
+    if (!mView)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    mData = static_cast<uint8_t const*>(mView);
+    mSize = fileInfo.EndOfFile.LowPart;
+
+    return S_OK;
+#else
+    HRESULT hr = BinaryReader::ReadEntireFile(fileName, mOwnedData, &mSize);
+    if (FAILED(hr))
+        return hr;
+
+    mData = mOwnedData.get();
+
+    return S_OK;
+#endif
+}
@@ -58,6 +58,12 @@ namespace DirectX
         }
 
 
+        bool EndOfFile() const noexcept
+        {
+            return mPos >= mEnd;
+        }
+
+
         // Lower level helper reads directly from the filesystem into memory.
         static HRESULT ReadEntireFile(_In_z_ wchar_t const* fileName, _Inout_ std::unique_ptr<uint8_t[]>& data, _Out_ size_t* dataSize);
 
@@ -69,4 +75,30 @@ namespace DirectX
 
         std::unique_ptr<uint8_t[]> mOwnedData;
     };
+
+
+    // Read-only view of an entire file. The file is memory mapped where the platform allows it,
+    // so loaders can hand spans of it straight to CreateBuffer without a heap copy.
+    class MappedFile
+    {
+    public:
+        MappedFile() noexcept;
+        ~MappedFile();
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator= (MappedFile const&) = delete;
+
+        HRESULT Open(_In_z_ wchar_t const* fileName);
+        void Close() noexcept;
+
+        uint8_t const* GetData() const noexcept { return mData; }
+        size_t GetSize() const noexcept { return mSize; }
+
+    private:
+        uint8_t const* mData;
+        size_t mSize;
+        void* mView;
+
+        std::unique_ptr<uint8_t[]> mOwnedData;
+    };
 }
@@ -0,0 +1,491 @@
+//--------------------------------------------------------------------------------------
+// File: DDSStreamLayout.h
+//
+// Offsets of every mip level inside a DDS file, used to stream textures one level at a
+// time straight out of a mapped file. Only needs the DDS structures and the DXGI_FORMAT
+// enumeration, so the layout can be computed and tested without Direct3D.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <dxgiformat.h>
+
+#include "DDS.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+namespace DirectX
+{
+    namespace DDSStreaming
+    {
+        enum class DDSLayoutResult
+        {
+            Ok,
+            InvalidData,    // Not a DDS file, or a malformed header
+            NotSupported,   // Valid, but not a 2D texture of a fixed block size format
+            Truncated,      // The file ends before the last mip
+        };
+
+        struct DDSMipLayout
+        {
+            size_t  width;
+            size_t  height;
+            size_t  rowBytes;
+            size_t  numRows;        // Rows of blocks for BC formats
+            size_t  numBytes;
+            size_t  offset;         // From the start of the file data, for array item 0
+        };
+
+        struct DDSTextureLayout
+        {
+            static constexpr size_t MaxMips = 15;             // D3D11_REQ_MIP_LEVELS
+            static constexpr size_t MaxArraySize = 2048;      // D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION
+            static constexpr size_t MaxDimension = 16384;     // D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+
+            DXGI_FORMAT     format;
+            bool            compressed;     // 4x4 blocks
+            size_t          width;
+            size_t          height;
+            size_t          arraySize;      // Includes the 6 faces of each cubemap
+            size_t          mipCount;
+            bool            isCubeMap;
+            DDS_ALPHA_MODE  alphaMode;
+            size_t          itemBytes;      // Distance between two array items (full mip chains)
+            DDSMipLayout    mips[MaxMips];
+
+            size_t GetOffset(size_t item, size_t mip) const noexcept
+            {
+                return mips[mip].offset + item * itemBytes;
+            }
+        };
+
+        constexpr uint32_t MakeFourCC(char a, char b, char c, char d) noexcept
+        {
+            return static_cast<uint32_t>(static_cast<uint8_t>(a))
+                | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8)
+                | (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16)
+                | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Bytes per texel, or per 4x4 block for BC formats. 0 for formats that cannot be
+        // streamed a row at a time (packed and planar video formats, 1 bit per pixel).
+        //--------------------------------------------------------------------------------------
+        inline size_t GetStreamElementBytes(DXGI_FORMAT fmt, bool& compressed) noexcept
+        {
+            compressed = false;
+            switch (fmt)
+            {
+                case DXGI_FORMAT_BC1_TYPELESS:
+                case DXGI_FORMAT_BC1_UNORM:
+                case DXGI_FORMAT_BC1_UNORM_SRGB:
+                case DXGI_FORMAT_BC4_TYPELESS:
+                case DXGI_FORMAT_BC4_UNORM:
+                case DXGI_FORMAT_BC4_SNORM:
+                    compressed = true;
+                    return 8;
+
+                case DXGI_FORMAT_BC2_TYPELESS:
+                case DXGI_FORMAT_BC2_UNORM:
+                case DXGI_FORMAT_BC2_UNORM_SRGB:
+                case DXGI_FORMAT_BC3_TYPELESS:
+                case DXGI_FORMAT_BC3_UNORM:
+                case DXGI_FORMAT_BC3_UNORM_SRGB:
+                case DXGI_FORMAT_BC5_TYPELESS:
+                case DXGI_FORMAT_BC5_UNORM:
+                case DXGI_FORMAT_BC5_SNORM:
+                case DXGI_FORMAT_BC6H_TYPELESS:
+                case DXGI_FORMAT_BC6H_UF16:
+                case DXGI_FORMAT_BC6H_SF16:
+                case DXGI_FORMAT_BC7_TYPELESS:
+                case DXGI_FORMAT_BC7_UNORM:
+                case DXGI_FORMAT_BC7_UNORM_SRGB:
+                    compressed = true;
+                    return 16;
+
+                case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+                case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                case DXGI_FORMAT_R32G32B32A32_UINT:
+                case DXGI_FORMAT_R32G32B32A32_SINT:
+                    return 16;
+
+                case DXGI_FORMAT_R32G32B32_TYPELESS:
+                case DXGI_FORMAT_R32G32B32_FLOAT:
+                case DXGI_FORMAT_R32G32B32_UINT:
+                case DXGI_FORMAT_R32G32B32_SINT:
+                    return 12;
+
+                case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+                case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                case DXGI_FORMAT_R16G16B16A16_UNORM:
+                case DXGI_FORMAT_R16G16B16A16_UINT:
+                case DXGI_FORMAT_R16G16B16A16_SNORM:
+                case DXGI_FORMAT_R16G16B16A16_SINT:
+                case DXGI_FORMAT_R32G32_TYPELESS:
+                case DXGI_FORMAT_R32G32_FLOAT:
+                case DXGI_FORMAT_R32G32_UINT:
+                case DXGI_FORMAT_R32G32_SINT:
+                case DXGI_FORMAT_R32G8X24_TYPELESS:
+                case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+                case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+                case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+                case DXGI_FORMAT_Y416:
+                    return 8;
+
+                case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+                case DXGI_FORMAT_R10G10B10A2_UNORM:
+                case DXGI_FORMAT_R10G10B10A2_UINT:
+                case DXGI_FORMAT_R11G11B10_FLOAT:
+                case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+                case DXGI_FORMAT_R8G8B8A8_UNORM:
+                case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                case DXGI_FORMAT_R8G8B8A8_UINT:
+                case DXGI_FORMAT_R8G8B8A8_SNORM:
+                case DXGI_FORMAT_R8G8B8A8_SINT:
+                case DXGI_FORMAT_R16G16_TYPELESS:
+                case DXGI_FORMAT_R16G16_FLOAT:
+                case DXGI_FORMAT_R16G16_UNORM:
+                case DXGI_FORMAT_R16G16_UINT:
+                case DXGI_FORMAT_R16G16_SNORM:
+                case DXGI_FORMAT_R16G16_SINT:
+                case DXGI_FORMAT_R32_TYPELESS:
+                case DXGI_FORMAT_D32_FLOAT:
+                case DXGI_FORMAT_R32_FLOAT:
+                case DXGI_FORMAT_R32_UINT:
+                case DXGI_FORMAT_R32_SINT:
+                case DXGI_FORMAT_R24G8_TYPELESS:
+                case DXGI_FORMAT_D24_UNORM_S8_UINT:
+                case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+                case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+                case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+                case DXGI_FORMAT_B8G8R8A8_UNORM:
+                case DXGI_FORMAT_B8G8R8X8_UNORM:
+                case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+                case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+                case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+                case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+                case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+                case DXGI_FORMAT_AYUV:
+                case DXGI_FORMAT_Y410:
+                    return 4;
+
+                case DXGI_FORMAT_R8G8_TYPELESS:
+                case DXGI_FORMAT_R8G8_UNORM:
+                case DXGI_FORMAT_R8G8_UINT:
+                case DXGI_FORMAT_R8G8_SNORM:
+                case DXGI_FORMAT_R8G8_SINT:
+                case DXGI_FORMAT_R16_TYPELESS:
+                case DXGI_FORMAT_R16_FLOAT:
+                case DXGI_FORMAT_D16_UNORM:
+                case DXGI_FORMAT_R16_UNORM:
+                case DXGI_FORMAT_R16_UINT:
+                case DXGI_FORMAT_R16_SNORM:
+                case DXGI_FORMAT_R16_SINT:
+                case DXGI_FORMAT_B5G6R5_UNORM:
+                case DXGI_FORMAT_B5G5R5A1_UNORM:
+                case DXGI_FORMAT_A8P8:
+                case DXGI_FORMAT_B4G4R4A4_UNORM:
+                    return 2;
+
+                case DXGI_FORMAT_R8_TYPELESS:
+                case DXGI_FORMAT_R8_UNORM:
+                case DXGI_FORMAT_R8_UINT:
+                case DXGI_FORMAT_R8_SNORM:
+                case DXGI_FORMAT_R8_SINT:
+                case DXGI_FORMAT_A8_UNORM:
+                case DXGI_FORMAT_AI44:
+                case DXGI_FORMAT_IA44:
+                case DXGI_FORMAT_P8:
+                    return 1;
+
+                default:
+                    return 0;
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Legacy (non-DX10) pixel formats, the same mapping as LoaderHelpers::GetDXGIFormat
+        //--------------------------------------------------------------------------------------
+        inline DXGI_FORMAT GetLegacyDXGIFormat(const DDS_PIXELFORMAT& ddpf) noexcept
+        {
+            auto isBitMask = [&ddpf](uint32_t r, uint32_t g, uint32_t b, uint32_t a) noexcept
+            {
+                return ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a;
+            };
+
+            if (ddpf.flags & DDS_RGB)
+            {
+                switch (ddpf.RGBBitCount)
+                {
+                    case 32:
+                        if (isBitMask(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+                            return DXGI_FORMAT_R8G8B8A8_UNORM;
+                        if (isBitMask(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+                            return DXGI_FORMAT_B8G8R8A8_UNORM;
+                        if (isBitMask(0x00ff0000, 0x0000ff00, 0x000000ff, 0))
+                            return DXGI_FORMAT_B8G8R8X8_UNORM;
+                        // D3DX writes 10:10:10:2 with the red and blue masks swapped
+                        if (isBitMask(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+                            return DXGI_FORMAT_R10G10B10A2_UNORM;
+                        if (isBitMask(0x0000ffff, 0xffff0000, 0, 0))
+                            return DXGI_FORMAT_R16G16_UNORM;
+                        if (isBitMask(0xffffffff, 0, 0, 0))
+                            return DXGI_FORMAT_R32_FLOAT;
+                        break;
+
+                    case 16:
+                        if (isBitMask(0x7c00, 0x03e0, 0x001f, 0x8000))
+                            return DXGI_FORMAT_B5G5R5A1_UNORM;
+                        if (isBitMask(0xf800, 0x07e0, 0x001f, 0))
+                            return DXGI_FORMAT_B5G6R5_UNORM;
+                        if (isBitMask(0x0f00, 0x00f0, 0x000f, 0xf000))
+                            return DXGI_FORMAT_B4G4R4A4_UNORM;
+                        if (isBitMask(0x00ff, 0, 0, 0xff00))
+                            return DXGI_FORMAT_R8G8_UNORM;
+                        if (isBitMask(0xffff, 0, 0, 0))
+                            return DXGI_FORMAT_R16_UNORM;
+                        break;
+
+                    case 8:
+                        if (isBitMask(0xff, 0, 0, 0))
+                            return DXGI_FORMAT_R8_UNORM;
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+            else if (ddpf.flags & DDS_LUMINANCE)
+            {
+                switch (ddpf.RGBBitCount)
+                {
+                    case 16:
+                        if (isBitMask(0xffff, 0, 0, 0))
+                            return DXGI_FORMAT_R16_UNORM;
+                        if (isBitMask(0x00ff, 0, 0, 0xff00))
+                            return DXGI_FORMAT_R8G8_UNORM;
+                        break;
+
+                    case 8:
+                        if (isBitMask(0xff, 0, 0, 0))
+                            return DXGI_FORMAT_R8_UNORM;
+                        if (isBitMask(0x00ff, 0, 0, 0xff00))
+                            return DXGI_FORMAT_R8G8_UNORM;
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+            else if (ddpf.flags & DDS_ALPHA)
+            {
+                if (ddpf.RGBBitCount == 8)
+                    return DXGI_FORMAT_A8_UNORM;
+            }
+            else if (ddpf.flags & DDS_BUMPDUDV)
+            {
+                switch (ddpf.RGBBitCount)
+                {
+                    case 32:
+                        if (isBitMask(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+                            return DXGI_FORMAT_R8G8B8A8_SNORM;
+                        if (isBitMask(0x0000ffff, 0xffff0000, 0, 0))
+                            return DXGI_FORMAT_R16G16_SNORM;
+                        break;
+
+                    case 16:
+                        if (isBitMask(0x00ff, 0xff00, 0, 0))
+                            return DXGI_FORMAT_R8G8_SNORM;
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+            else if (ddpf.flags & DDS_FOURCC)
+            {
+                switch (ddpf.fourCC)
+                {
+                    case MakeFourCC('D', 'X', 'T', '1'):    return DXGI_FORMAT_BC1_UNORM;
+                    case MakeFourCC('D', 'X', 'T', '2'):    return DXGI_FORMAT_BC2_UNORM;
+                    case MakeFourCC('D', 'X', 'T', '3'):    return DXGI_FORMAT_BC2_UNORM;
+                    case MakeFourCC('D', 'X', 'T', '4'):    return DXGI_FORMAT_BC3_UNORM;
+                    case MakeFourCC('D', 'X', 'T', '5'):    return DXGI_FORMAT_BC3_UNORM;
+                    case MakeFourCC('A', 'T', 'I', '1'):    return DXGI_FORMAT_BC4_UNORM;
+                    case MakeFourCC('B', 'C', '4', 'U'):    return DXGI_FORMAT_BC4_UNORM;
+                    case MakeFourCC('B', 'C', '4', 'S'):    return DXGI_FORMAT_BC4_SNORM;
+                    case MakeFourCC('A', 'T', 'I', '2'):    return DXGI_FORMAT_BC5_UNORM;
+                    case MakeFourCC('B', 'C', '5', 'U'):    return DXGI_FORMAT_BC5_UNORM;
+                    case MakeFourCC('B', 'C', '5', 'S'):    return DXGI_FORMAT_BC5_SNORM;
+                    case MakeFourCC('R', 'G', 'B', 'G'):    return DXGI_FORMAT_R8G8_B8G8_UNORM;
+                    case MakeFourCC('G', 'R', 'G', 'B'):    return DXGI_FORMAT_G8R8_G8B8_UNORM;
+                    case MakeFourCC('Y', 'U', 'Y', '2'):    return DXGI_FORMAT_YUY2;
+
+                    // D3DFORMAT enums
+                    case 36:    return DXGI_FORMAT_R16G16B16A16_UNORM;
+                    case 110:   return DXGI_FORMAT_R16G16B16A16_SNORM;
+                    case 111:   return DXGI_FORMAT_R16_FLOAT;
+                    case 112:   return DXGI_FORMAT_R16G16_FLOAT;
+                    case 113:   return DXGI_FORMAT_R16G16B16A16_FLOAT;
+                    case 114:   return DXGI_FORMAT_R32_FLOAT;
+                    case 115:   return DXGI_FORMAT_R32G32_FLOAT;
+                    case 116:   return DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+                    default:
+                        break;
+                }
+            }
+
+            return DXGI_FORMAT_UNKNOWN;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Parses the header of a 2D, 2D array or cubemap DDS and computes where each mip of each
+        // array item lives. Only the header is read, so this works on a mapped file before any
+        // texture is created. Volume and 1D textures and formats without a fixed block size
+        // (planar, packed YUV) are not supported.
+        //--------------------------------------------------------------------------------------
+        inline DDSLayoutResult GetDDSTextureLayout(
+            const uint8_t* ddsData,
+            size_t ddsDataSize,
+            DDSTextureLayout& layout) noexcept
+        {
+            layout = {};
+
+            if (!ddsData || ddsDataSize < sizeof(uint32_t) + sizeof(DDS_HEADER))
+                return DDSLayoutResult::InvalidData;
+
+            // DDS files always start with the same magic number ("DDS ")
+            uint32_t magic = 0;
+            memcpy(&magic, ddsData, sizeof(uint32_t));
+            if (magic != DDS_MAGIC)
+                return DDSLayoutResult::InvalidData;
+
+            auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+            if (header->size != sizeof(DDS_HEADER) || header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+                return DDSLayoutResult::InvalidData;
+
+            const DDS_HEADER_DXT10* d3d10ext = nullptr;
+            if ((header->ddspf.flags & DDS_FOURCC) && header->ddspf.fourCC == MakeFourCC('D', 'X', '1', '0'))
+            {
+                if (ddsDataSize < sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10))
+                    return DDSLayoutResult::InvalidData;
+
+                d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>(ddsData + sizeof(uint32_t) + sizeof(DDS_HEADER));
+            }
+
+            const size_t baseOffset = sizeof(uint32_t) + sizeof(DDS_HEADER) + (d3d10ext ? sizeof(DDS_HEADER_DXT10) : 0u);
+            const size_t bitSize = ddsDataSize - baseOffset;
+
+            layout.width = header->width;
+            layout.height = header->height;
+            layout.mipCount = header->mipMapCount ? header->mipMapCount : 1;
+            layout.arraySize = 1;
+            layout.alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+
+            if (d3d10ext)
+            {
+                if (d3d10ext->resourceDimension != DDS_DIMENSION_TEXTURE2D)
+                    return DDSLayoutResult::NotSupported;
+
+                if (!d3d10ext->arraySize)
+                    return DDSLayoutResult::InvalidData;
+
+                layout.format = d3d10ext->dxgiFormat;
+                layout.arraySize = d3d10ext->arraySize;
+
+                if (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+                {
+                    layout.isCubeMap = true;
+                    layout.arraySize *= 6;
+                }
+
+                const auto mode = static_cast<DDS_ALPHA_MODE>(d3d10ext->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK);
+                if (mode <= DDS_ALPHA_MODE_CUSTOM)
+                    layout.alphaMode = mode;
+            }
+            else
+            {
+                layout.format = GetLegacyDXGIFormat(header->ddspf);
+
+                if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+                    return DDSLayoutResult::NotSupported;
+
+                if (header->caps2 & DDS_CUBEMAP)
+                {
+                    // We require all six faces to be defined
+                    if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+                        return DDSLayoutResult::NotSupported;
+
+                    layout.isCubeMap = true;
+                    layout.arraySize = 6;
+                }
+
+                if ((header->ddspf.flags & DDS_FOURCC)
+                    && (header->ddspf.fourCC == MakeFourCC('D', 'X', 'T', '2') || header->ddspf.fourCC == MakeFourCC('D', 'X', 'T', '4')))
+                {
+                    layout.alphaMode = DDS_ALPHA_MODE_PREMULTIPLIED;
+                }
+            }
+
+            const size_t elementBytes = GetStreamElementBytes(layout.format, layout.compressed);
+            if (!elementBytes)
+                return DDSLayoutResult::NotSupported;
+
+            if (!layout.width || !layout.height
+                || layout.mipCount > DDSTextureLayout::MaxMips
+                || layout.arraySize > DDSTextureLayout::MaxArraySize
+                || layout.width > DDSTextureLayout::MaxDimension
+                || layout.height > DDSTextureLayout::MaxDimension)
+            {
+                return DDSLayoutResult::NotSupported;
+            }
+
+            // Within those limits a whole array item fits 64 bits with room to spare
+            uint64_t w = layout.width;
+            uint64_t h = layout.height;
+            uint64_t itemBytes = 0;
+            for (size_t mip = 0; mip < layout.mipCount; ++mip)
+            {
+                auto& info = layout.mips[mip];
+                info.width = static_cast<size_t>(w);
+                info.height = static_cast<size_t>(h);
+
+                const uint64_t columns = layout.compressed ? (w + 3u) / 4u : w;
+                const uint64_t rows = layout.compressed ? (h + 3u) / 4u : h;
+                const uint64_t rowBytes = columns * elementBytes;
+                const uint64_t numBytes = rowBytes * rows;
+                if (numBytes > SIZE_MAX || baseOffset + itemBytes > SIZE_MAX)
+                    return DDSLayoutResult::NotSupported;
+
+                info.rowBytes = static_cast<size_t>(rowBytes);
+                info.numRows = static_cast<size_t>(rows);
+                info.numBytes = static_cast<size_t>(numBytes);
+                info.offset = baseOffset + static_cast<size_t>(itemBytes);
+                itemBytes += numBytes;
+
+                w = std::max<uint64_t>(w >> 1, 1);
+                h = std::max<uint64_t>(h >> 1, 1);
+            }
+
+            if (itemBytes > SIZE_MAX)
+                return DDSLayoutResult::NotSupported;
+
+            layout.itemBytes = static_cast<size_t>(itemBytes);
+
+            if (itemBytes * layout.arraySize > bitSize)
+                return DDSLayoutResult::Truncated;
+
+            return DDSLayoutResult::Ok;
+        }
+    }
+}
@@ -0,0 +1,439 @@
+//--------------------------------------------------------------------------------------
+// File: DDSTextureStreamer.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "DDSTextureStreamer.h"
+#include "BinaryReader.h"
+#include "DDSStreamLayout.h"
+#include "DirectXHelpers.h"
+#include "LoaderHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+
+// Internal DDSTextureStreamer implementation class.
+class DDSTextureStreamer::Impl
+{
+public:
+    Impl(_In_ ID3D11Device* device, _In_z_ wchar_t const* fileName, size_t initialBytes, bool forceSRGB);
+
+    void RequestMip(uint32_t mostDetailedMip) noexcept;
+    size_t Update(_In_ ID3D11DeviceContext* context, size_t budgetBytes);
+    size_t GetResidentBytes() const noexcept;
+
+    DDSStreaming::DDSTextureLayout layout;
+    ComPtr<ID3D11ShaderResourceView> textureView;
+    uint32_t residentMip;
+    uint32_t requestedMip;
+
+private:
+    ComPtr<ID3D11Texture2D> CreateTexture(uint32_t firstMip, bool initialData) const;
+    void CopyResidentMips(_In_ ID3D11DeviceContext* context, _In_ ID3D11Texture2D* dest, uint32_t destFirstMip, uint32_t copyFirstMip) const;
+    void CreateView();
+
+    ComPtr<ID3D11Device> mDevice;
+    MappedFile mFile;
+    DXGI_FORMAT mFormat;
+    uint32_t mCoarsestMip;
+
+    // Texture for residentMip - 1 and coarser while that level is uploaded
+    ComPtr<ID3D11Texture2D> mTexture;
+    ComPtr<ID3D11Texture2D> mPending;
+    size_t mPendingItem;
+    size_t mPendingRow;
+};
+
+
+_Use_decl_annotations_
+DDSTextureStreamer::Impl::Impl(ID3D11Device* device, wchar_t const* fileName, size_t initialBytes, bool forceSRGB) :
+    layout{},
+    residentMip(0),
+    requestedMip(0),
+    mDevice(device),
+    mFormat(DXGI_FORMAT_UNKNOWN),
+    mCoarsestMip(0),
+    mPendingItem(0),
+    mPendingRow(0)
+{
+    if (!device || !fileName)
+        throw std::invalid_argument("DDSTextureStreamer");
+
+    HRESULT hr = mFile.Open(fileName);
+    if (SUCCEEDED(hr))
+    {
+        switch (DDSStreaming::GetDDSTextureLayout(mFile.GetData(), mFile.GetSize(), layout))
+        {
+            case DDSStreaming::DDSLayoutResult::Ok:             break;
+            case DDSStreaming::DDSLayoutResult::NotSupported:   hr = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED); break;
+            case DDSStreaming::DDSLayoutResult::Truncated:      hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF); break;
+            default:                                            hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA); break;
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: DDSTextureStreamer failed (%08X) to load '%ls'\n",
+            static_cast<unsigned int>(hr), fileName);
+        throw std::runtime_error("DDSTextureStreamer");
+    }
+
+    mFormat = forceSRGB ? LoaderHelpers::MakeSRGB(layout.format) : layout.format;
+
+    // Block compressed textures need the top level of the created resource to be a whole
+    // number of blocks, which limits how small the resident chain can get
+    const auto mipCount = static_cast<uint32_t>(layout.mipCount);
+    if (layout.compressed)
+    {
+        for (uint32_t mip = 0; mip < mipCount; ++mip)
+        {
+            if ((layout.mips[mip].width % 4) || (layout.mips[mip].height % 4))
+                break;
+
+            mCoarsestMip = mip;
+        }
+    }
+    else
+    {
+        mCoarsestMip = mipCount - 1;
+    }
+
+    // Start from the coarsest allowed level and add finer ones while they fit the budget
+    residentMip = mCoarsestMip;
+    size_t bytes = GetResidentBytes();
+    while (residentMip > 0)
+    {
+        const size_t levelBytes = layout.mips[residentMip - 1].numBytes * layout.arraySize;
+        if (bytes + levelBytes > initialBytes)
+            break;
+
+        bytes += levelBytes;
+        --residentMip;
+    }
+
+    requestedMip = residentMip;
+
+    mTexture = CreateTexture(residentMip, true);
+    CreateView();
+}
+
+
+void DDSTextureStreamer::Impl::RequestMip(uint32_t mostDetailedMip) noexcept
+{
+    requestedMip = std::min(mostDetailedMip, mCoarsestMip);
+}
+
+
+_Use_decl_annotations_
+size_t DDSTextureStreamer::Impl::Update(ID3D11DeviceContext* context, size_t budgetBytes)
+{
+    if (!context)
+        throw std::invalid_argument("DDSTextureStreamer");
+
+    if (requestedMip > residentMip)
+    {
+        // Dropping detail is a GPU copy of the levels we keep, no upload involved
+        mPending.Reset();
+
+        auto texture = CreateTexture(requestedMip, false);
+        CopyResidentMips(context, texture.Get(), requestedMip, requestedMip);
+
+        mTexture.Swap(texture);
+        residentMip = requestedMip;
+        CreateView();
+        return 0;
+    }
+
+    const bool compressed = layout.compressed;
+
+    size_t uploaded = 0;
+    while (requestedMip < residentMip)
+    {
+        const uint32_t mip = residentMip - 1;
+        const auto& info = layout.mips[mip];
+
+        size_t rows = (budgetBytes > uploaded) ? (budgetBytes - uploaded) / info.rowBytes : 0;
+        if (!rows)
+        {
+            if (uploaded)
+                break;
+
+            rows = 1;
+        }
+
+        if (!mPending)
+        {
+            mPending = CreateTexture(mip, false);
+            CopyResidentMips(context, mPending.Get(), mip, residentMip);
+            mPendingItem = 0;
+            mPendingRow = 0;
+        }
+
+        rows = std::min(rows, info.numRows - mPendingRow);
+
+        // Boxes on BC formats are in texels but must cover whole blocks, the last row
+        // of blocks is clipped to the level's height
+        const size_t blockHeight = compressed ? 4 : 1;
+
+        D3D11_BOX box;
+        box.left = 0;
+        box.right = static_cast<UINT>(info.width);
+        box.top = static_cast<UINT>(mPendingRow * blockHeight);
+        box.bottom = static_cast<UINT>(std::min((mPendingRow + rows) * blockHeight, info.height));
+        box.front = 0;
+        box.back = 1;
+
+        const uint8_t* src = mFile.GetData() + layout.GetOffset(mPendingItem, mip) + mPendingRow * info.rowBytes;
+        const UINT levels = static_cast<UINT>(layout.mipCount - mip);
+
+        // Uses the box, so this should be the immediate context unless the driver supports
+        // command lists (see the UpdateSubresource remarks on deferred contexts)
+        context->UpdateSubresource(mPending.Get(),
+            D3D11CalcSubresource(0, static_cast<UINT>(mPendingItem), levels),
+            &box, src,
+            static_cast<UINT>(info.rowBytes),
+            static_cast<UINT>(rows * info.rowBytes));
+
+        uploaded += rows * info.rowBytes;
+        mPendingRow += rows;
+
+        if (mPendingRow < info.numRows)
+            continue;
+
+        mPendingRow = 0;
+        if (++mPendingItem < layout.arraySize)
+            continue;
+
+        // The level is complete, swap it in
+        mTexture.Swap(mPending);
+        mPending.Reset();
+        residentMip = mip;
+        CreateView();
+    }
+
+    return uploaded;
+}
+
+
+size_t DDSTextureStreamer::Impl::GetResidentBytes() const noexcept
+{
+    size_t bytes = 0;
+    for (size_t mip = residentMip; mip < layout.mipCount; ++mip)
+    {
+        bytes += layout.mips[mip].numBytes;
+    }
+
+    return bytes * layout.arraySize;
+}
+
+
+ComPtr<ID3D11Texture2D> DDSTextureStreamer::Impl::CreateTexture(uint32_t firstMip, bool initialData) const
+{
+    const size_t levels = layout.mipCount - firstMip;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = static_cast<UINT>(layout.mips[firstMip].width);
+    desc.Height = static_cast<UINT>(layout.mips[firstMip].height);
+    desc.MipLevels = static_cast<UINT>(levels);
+    desc.ArraySize = static_cast<UINT>(layout.arraySize);
+    desc.Format = mFormat;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.MiscFlags = layout.isCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0u;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> initData;
+    if (initialData)
+    {
+        // Straight from the mapped file, no staging copy
+        initData.resize(levels * layout.arraySize);
+        for (size_t item = 0; item < layout.arraySize; ++item)
+        {
+            for (size_t mip = firstMip; mip < layout.mipCount; ++mip)
+            {
+                auto& subresource = initData[item * levels + (mip - firstMip)];
+                subresource.pSysMem = mFile.GetData() + layout.GetOffset(item, mip);
+                subresource.SysMemPitch = static_cast<UINT>(layout.mips[mip].rowBytes);
+                subresource.SysMemSlicePitch = static_cast<UINT>(layout.mips[mip].numBytes);
+            }
+        }
+    }
+
+    ComPtr<ID3D11Texture2D> texture;
+    ThrowIfFailed(
+        mDevice->CreateTexture2D(&desc, initialData ? initData.data() : nullptr, texture.GetAddressOf())
+    );
+
+    SetDebugObjectName(texture.Get(), "DDSTextureStreamer");
+
+    return texture;
+}
+
+
+// Copies the resident levels from copyFirstMip down into dest, whose top level is destFirstMip.
+_Use_decl_annotations_
+void DDSTextureStreamer::Impl::CopyResidentMips(ID3D11DeviceContext* context, ID3D11Texture2D* dest, uint32_t destFirstMip, uint32_t copyFirstMip) const
+{
+    const auto mipCount = static_cast<UINT>(layout.mipCount);
+    const UINT srcLevels = mipCount - residentMip;
+    const UINT destLevels = mipCount - destFirstMip;
+
+    for (UINT item = 0; item < layout.arraySize; ++item)
+    {
+        for (UINT mip = copyFirstMip; mip < mipCount; ++mip)
+        {
+            context->CopySubresourceRegion(
+                dest, D3D11CalcSubresource(mip - destFirstMip, item, destLevels),
+                0, 0, 0,
+                mTexture.Get(), D3D11CalcSubresource(mip - residentMip, item, srcLevels),
+                nullptr);
+        }
+    }
+}
+
+
+void DDSTextureStreamer::Impl::CreateView()
+{
+    D3D11_SHADER_RESOURCE_VIEW_DESC desc = {};
+    desc.Format = mFormat;
+
+    const auto arraySize = static_cast<UINT>(layout.arraySize);
+    if (layout.isCubeMap)
+    {
+        if (arraySize > 6)
+        {
+            desc.ViewDimension = D3D_SRV_DIMENSION_TEXTURECUBEARRAY;
+            desc.TextureCubeArray.MipLevels = UINT(-1);
+            desc.TextureCubeArray.NumCubes = arraySize / 6;
+        }
+        else
+        {
+            desc.ViewDimension = D3D_SRV_DIMENSION_TEXTURECUBE;
+            desc.TextureCube.MipLevels = UINT(-1);
+        }
+    }
+    else if (arraySize > 1)
+    {
+        desc.ViewDimension = D3D_SRV_DIMENSION_TEXTURE2DARRAY;
+        desc.Texture2DArray.MipLevels = UINT(-1);
+        desc.Texture2DArray.ArraySize = arraySize;
+    }
+    else
+    {
+        desc.ViewDimension = D3D_SRV_DIMENSION_TEXTURE2D;
+        desc.Texture2D.MipLevels = UINT(-1);
+    }
+
+    ComPtr<ID3D11ShaderResourceView> view;
+    ThrowIfFailed(
+        mDevice->CreateShaderResourceView(mTexture.Get(), &desc, view.GetAddressOf())
+    );
+
+    SetDebugObjectName(view.Get(), "DDSTextureStreamer");
+
+    textureView.Swap(view);
+}
+
+
+// Public constructor.
+_Use_decl_annotations_
+DDSTextureStreamer::DDSTextureStreamer(ID3D11Device* device, wchar_t const* fileName, size_t initialBytes, bool forceSRGB)
+    : pImpl(std::make_unique<Impl>(device, fileName, initialBytes, forceSRGB))
+{
+}
+
+
+// Move constructor.
+DDSTextureStreamer::DDSTextureStreamer(DDSTextureStreamer&& moveFrom) noexcept
+    : pImpl(std::move(moveFrom.pImpl))
+{
+}
+
+
+// Move assignment.
+DDSTextureStreamer& DDSTextureStreamer::operator= (DDSTextureStreamer&& moveFrom) noexcept
+{
+    pImpl = std::move(moveFrom.pImpl);
+    return *this;
+}
+
+
+// Public destructor.
+DDSTextureStreamer::~DDSTextureStreamer()
+{
+}
+
+
+void DDSTextureStreamer::RequestMip(uint32_t mostDetailedMip) noexcept
+{
+    pImpl->RequestMip(mostDetailedMip);
+}
+
+
+_Use_decl_annotations_
+size_t DDSTextureStreamer::Update(ID3D11DeviceContext* context, size_t budgetBytes)
+{
+    return pImpl->Update(context, budgetBytes);
+}
+
+
+ID3D11ShaderResourceView* DDSTextureStreamer::GetShaderResourceView() const noexcept
+{
+    return pImpl->textureView.Get();
+}
+
+
+_Use_decl_annotations_
+void DDSTextureStreamer::GetShaderResourceView(ID3D11ShaderResourceView** textureView) const noexcept
+{
+    if (textureView)
+    {
+        *textureView = pImpl->textureView.Get();
+        if (*textureView)
+            (*textureView)->AddRef();
+    }
+}
+
+
+uint32_t DDSTextureStreamer::GetResidentMip() const noexcept
+{
+    return pImpl->residentMip;
+}
+
+
+uint32_t DDSTextureStreamer::GetRequestedMip() const noexcept
+{
+    return pImpl->requestedMip;
+}
+
+
+uint32_t DDSTextureStreamer::GetMipCount() const noexcept
+{
+    return static_cast<uint32_t>(pImpl->layout.mipCount);
+}
+
+
+bool DDSTextureStreamer::IsStreaming() const noexcept
+{
+    return pImpl->requestedMip != pImpl->residentMip;
+}
+
+
+size_t DDSTextureStreamer::GetResidentBytes() const noexcept
+{
+    return pImpl->GetResidentBytes();
+}
+
+
+DDS_ALPHA_MODE DDSTextureStreamer::GetAlphaMode() const noexcept
+{
+    return pImpl->layout.alphaMode;
+}
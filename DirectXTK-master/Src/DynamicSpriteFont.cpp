@@ -0,0 +1,905 @@
+//--------------------------------------------------------------------------------------
+// File: DynamicSpriteFont.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+// pch.h defines NOGDI, but dwrite.h names LOGFONTW in its GDI interop interface, which is
+// never used here.
+#ifdef NOGDI
+struct tagLOGFONTW;
+typedef struct tagLOGFONTW LOGFONTW;
+#endif
+
+#include <dwrite.h>
+
+#include "DynamicSpriteFont.h"
+#include "DirectXHelpers.h"
+#include "GlyphAtlas.h"
+#include "GlyphTable.h"
+#include "PlatformHelpers.h"
+#include "TextHelpers.h"
+
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#pragma comment(lib,"dwrite.lib")
+
+using namespace DirectX;
+using namespace DirectX::TextHelpers;
+using Microsoft::WRL::ComPtr;
+
+
+namespace
+{
+    // Slot sizes are rounded up to a multiple of this, which keeps the number of size classes,
+    // and so the number of partly used regions, small.
+    constexpr uint32_t SlotGranularity = 4;
+
+    // Empty texels around each glyph, so bilinear filtering never reaches a neighbour.
+    constexpr uint32_t SlotPadding = 1;
+
+    enum class GlyphState : uint8_t
+    {
+        Unrequested,
+        Pending,        // Queued for the background thread, or waiting to be uploaded
+        Resident,
+        Empty,          // Nothing to draw, e.g. a space
+        Oversized,      // Larger than an atlas region, never drawn
+    };
+
+    struct RasterRequest
+    {
+        uint32_t entry;
+        uint16_t glyphIndex;
+    };
+
+    // Coverage of a glyph rendered with its origin on the baseline, so left and top are
+    // usually small and negative respectively.
+    struct RasterizedGlyph
+    {
+        uint32_t entry;
+        int32_t left;
+        int32_t top;
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> coverage;
+    };
+
+    inline uint32_t RoundUpToSlot(uint32_t value) noexcept
+    {
+        return (value + SlotGranularity - 1) & ~(SlotGranularity - 1);
+    }
+}
+
+
+// Internal DynamicSpriteFont implementation class.
+class DynamicSpriteFont::Impl
+{
+public:
+    Impl(_In_ ID3D11Device* device, _In_z_ wchar_t const* fontName, float fontSize, uint32_t pageSize, uint32_t maxPages);
+
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
+
+    ~Impl();
+
+    size_t Update(_In_ ID3D11DeviceContext* context, size_t budgetBytes);
+
+    template<typename TChar>
+    void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ TChar const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth);
+
+    template<typename TChar>
+    XMVECTOR MeasureString(_In_z_ TChar const* text);
+
+    template<typename TChar>
+    void RequestGlyphs(_In_z_ TChar const* text);
+
+    uint16_t FindGlyphIndex(uint32_t character);
+    void SetDefaultCharacter(wchar_t character);
+    Statistics GetStatistics() const;
+
+    float lineSpacing;
+    wchar_t defaultCharacter;
+
+private:
+    // Metrics for every glyph the font has been asked for, and where it is in the atlas.
+    struct Entry
+    {
+        uint16_t glyphIndex;
+        GlyphState state;
+        float advance;
+        float xOffset;          // From the pen position to the top left of the subrect
+        float yOffset;
+        RECT subrect;
+        uint32_t page;
+    };
+
+    template<typename TChar, typename TAction>
+    void LayoutGlyphs(_In_z_ TChar const* text, TAction action);
+
+    uint32_t FindEntry(uint32_t character);
+    void MarkUsed(uint32_t index);
+    void Request(uint32_t index);
+
+    void AddPage(uint32_t page);
+    void Upload(_In_ ID3D11DeviceContext* context, RasterizedGlyph const& glyph, uint32_t slotWidth, uint32_t slotHeight, Entry& entry);
+
+    HRESULT Rasterize(uint16_t glyphIndex, RasterizedGlyph& glyph);
+    void RasterThread();
+
+    ComPtr<ID3D11Device> mDevice;
+
+    // DirectWrite factories and font faces are free threaded, so the background thread
+    // rasterizes from the same face the drawing thread reads metrics from.
+    ComPtr<IDWriteFactory> mFactory;
+    ComPtr<IDWriteFontFace> mFontFace;
+    float mFontSize;
+    float mDesignScale;
+    float mAscent;
+    uint16_t mDefaultGlyph;
+
+    GlyphTable mCharacters;     // Code point to glyph index
+    GlyphTable mGlyphs;         // Glyph index to entry
+    std::vector<Entry> mEntries;
+
+    uint32_t mPageSize;
+    GlyphAtlas mAtlas;          // Where each entry is, by entry index
+    std::vector<ComPtr<ID3D11Texture2D>> mPageTextures;
+    std::vector<ComPtr<ID3D11ShaderResourceView>> mPages;
+
+    uint64_t mFrame;
+    std::deque<RasterizedGlyph> mReady;
+    std::vector<uint32_t> mUploadScratch;
+    Statistics mStats;
+
+    // Shared with the background thread
+    mutable std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::deque<RasterRequest> mRequests;
+    std::vector<RasterizedGlyph> mCompleted;
+    uint64_t mRasterized;
+    bool mStopping;
+    std::thread mThread;
+
+    // Only touched by the background thread
+    std::vector<uint8_t> mRasterScratch;
+};
+
+
+// Constants.
+const XMFLOAT2 DynamicSpriteFont::Float2Zero(0, 0);
+
+
+_Use_decl_annotations_
+DynamicSpriteFont::Impl::Impl(ID3D11Device* device, wchar_t const* fontName, float fontSize, uint32_t pageSize, uint32_t maxPages) :
+    lineSpacing(0),
+    defaultCharacter(0),
+    mDevice(device),
+    mFontSize(fontSize),
+    mDesignScale(0),
+    mAscent(0),
+    mDefaultGlyph(0),
+    mPageSize(pageSize),
+    mAtlas(pageSize, maxPages),
+    mFrame(1),
+    mStats{},
+    mRasterized(0),
+    mStopping(false)
+{
+    if (!device || !fontName)
+        throw std::invalid_argument("DynamicSpriteFont requires a device and a font name");
+
+    if (!(fontSize > 0) || !maxPages || pageSize > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+        throw std::invalid_argument("Invalid DynamicSpriteFont size");
+
+    ThrowIfFailed(DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), reinterpret_cast<IUnknown**>(mFactory.GetAddressOf())));
+
+    // Installed families come first, then the name is tried as a file.
+    ComPtr<IDWriteFontCollection> collection;
+    ThrowIfFailed(mFactory->GetSystemFontCollection(collection.GetAddressOf()));
+
+    UINT32 familyIndex = 0;
+    BOOL exists = FALSE;
+    ThrowIfFailed(collection->FindFamilyName(fontName, &familyIndex, &exists));
+
+    if (exists)
+    {
+        ComPtr<IDWriteFontFamily> family;
+        ThrowIfFailed(collection->GetFontFamily(familyIndex, family.GetAddressOf()));
+
+        ComPtr<IDWriteFont> font;
+        ThrowIfFailed(family->GetFirstMatchingFont(DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STRETCH_NORMAL, DWRITE_FONT_STYLE_NORMAL, font.GetAddressOf()));
+
+        ThrowIfFailed(font->CreateFontFace(mFontFace.GetAddressOf()));
+    }
+    else
+    {
+        ComPtr<IDWriteFontFile> file;
+        HRESULT hr = mFactory->CreateFontFileReference(fontName, nullptr, file.GetAddressOf());
+
+        BOOL supported = FALSE;
+        DWRITE_FONT_FILE_TYPE fileType = DWRITE_FONT_FILE_TYPE_UNKNOWN;
+        DWRITE_FONT_FACE_TYPE faceType = DWRITE_FONT_FACE_TYPE_UNKNOWN;
+        UINT32 faceCount = 0;
+
+        if (SUCCEEDED(hr))
+        {
+            hr = file->Analyze(&supported, &fileType, &faceType, &faceCount);
+        }
+
+        if (FAILED(hr) || !supported)
+        {
+            DebugTrace("ERROR: DynamicSpriteFont could not find an installed font or font file named '%ls'\n", fontName);
+            throw std::runtime_error("DynamicSpriteFont font not found");
+        }
+
+        IDWriteFontFile* files[] = { file.Get() };
+        ThrowIfFailed(mFactory->CreateFontFace(faceType, 1, files, 0, DWRITE_FONT_SIMULATIONS_NONE, mFontFace.GetAddressOf()));
+    }
+
+    DWRITE_FONT_METRICS metrics = {};
+    mFontFace->GetMetrics(&metrics);
+
+    mDesignScale = fontSize / float(metrics.designUnitsPerEm);
+    mAscent = float(metrics.ascent) * mDesignScale;
+    lineSpacing = float(metrics.ascent + metrics.descent + metrics.lineGap) * mDesignScale;
+
+    // Regions hold glyphs up to twice the line height, and at least a few smaller ones.
+    const auto largestSlot = RoundUpToSlot(static_cast<uint32_t>(std::ceil(lineSpacing * 2)) + SlotPadding * 2);
+
+    uint32_t regionSize = 64;
+
+    while (regionSize < largestSlot)
+    {
+        regionSize *= 2;
+    }
+
+    if (regionSize > pageSize)
+    {
+        DebugTrace("ERROR: DynamicSpriteFont pages of %u pixels are too small for a %f pixel font\n", pageSize, double(fontSize));
+        throw std::invalid_argument("DynamicSpriteFont pageSize is too small for the font size");
+    }
+
+    mAtlas.SetRegionSize(regionSize);
+
+    mThread = std::thread(&Impl::RasterThread, this);
+}
+
+
+DynamicSpriteFont::Impl::~Impl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWorkAvailable.notify_all();
+
+    if (mThread.joinable())
+        mThread.join();
+}
+
+
+// Uploads finished glyphs, evicting glyphs not drawn since the previous Update when the atlas is full.
+_Use_decl_annotations_
+size_t DynamicSpriteFont::Impl::Update(ID3D11DeviceContext* context, size_t budgetBytes)
+{
+    if (!context)
+        throw std::invalid_argument("DynamicSpriteFont::Update requires a context");
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto& glyph : mCompleted)
+        {
+            mReady.push_back(std::move(glyph));
+        }
+
+        mCompleted.clear();
+    }
+
+    size_t uploadedBytes = 0;
+    size_t uploaded = 0;
+
+    while (!mReady.empty())
+    {
+        if (uploaded && uploadedBytes >= budgetBytes)
+            break;
+
+        auto& glyph = mReady.front();
+        auto& entry = mEntries[glyph.entry];
+
+        if (!glyph.width || !glyph.height)
+        {
+            entry.state = GlyphState::Empty;
+            mStats.pendingGlyphs--;
+            mReady.pop_front();
+            continue;
+        }
+
+        const uint32_t slotWidth = RoundUpToSlot(glyph.width + SlotPadding * 2);
+        const uint32_t slotHeight = RoundUpToSlot(glyph.height + SlotPadding * 2);
+
+        if (slotWidth > mAtlas.GetRegionSize() || slotHeight > mAtlas.GetRegionSize())
+        {
+            DebugTrace("WARNING: DynamicSpriteFont glyph %u is %ux%u pixels, too large for the atlas\n", entry.glyphIndex, glyph.width, glyph.height);
+
+            entry.state = GlyphState::Oversized;
+            mStats.pendingGlyphs--;
+            mReady.pop_front();
+            continue;
+        }
+
+        GlyphAtlas::Location location;
+
+        const bool allocated = mAtlas.Allocate(glyph.entry, slotWidth, slotHeight, mFrame,
+            [this](uint32_t page) { AddPage(page); },
+            [this](uint32_t evicted) { mEntries[evicted].state = GlyphState::Unrequested; },
+            location);
+
+        if (!allocated)
+        {
+            // Every slot holds a glyph that is still being drawn, so the rest wait.
+            mStats.atlasFull++;
+            break;
+        }
+
+        const auto x = static_cast<LONG>(location.x + SlotPadding);
+        const auto y = static_cast<LONG>(location.y + SlotPadding);
+
+        entry.page = location.page;
+        entry.subrect = { x, y, x, y };
+
+        Upload(context, glyph, slotWidth, slotHeight, entry);
+
+        entry.state = GlyphState::Resident;
+
+        const size_t bytes = size_t(slotWidth) * size_t(slotHeight) * sizeof(uint32_t);
+
+        uploadedBytes += bytes;
+        uploaded++;
+
+        mStats.pendingGlyphs--;
+        mStats.uploaded++;
+        mStats.uploadedBytes += bytes;
+
+        mReady.pop_front();
+    }
+
+    mFrame++;
+
+    return uploadedBytes;
+}
+
+
+// Creates the texture for a page of the atlas.
+void DynamicSpriteFont::Impl::AddPage(uint32_t page)
+{
+    const CD3D11_TEXTURE2D_DESC desc(DXGI_FORMAT_R8G8B8A8_UNORM, mPageSize, mPageSize, 1, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_DEFAULT);
+
+    ComPtr<ID3D11Texture2D> texture;
+    ThrowIfFailed(mDevice->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()));
+
+    ComPtr<ID3D11ShaderResourceView> view;
+    ThrowIfFailed(mDevice->CreateShaderResourceView(texture.Get(), nullptr, view.GetAddressOf()));
+
+    SetDebugObjectName(texture.Get(), "DirectXTK:DynamicSpriteFont");
+    SetDebugObjectName(view.Get(), "DirectXTK:DynamicSpriteFont");
+
+    // The atlas adds pages in order, and only once this has succeeded.
+    assert(page == mPages.size());
+    UNREFERENCED_PARAMETER(page);
+
+    mPageTextures.push_back(std::move(texture));
+    mPages.push_back(std::move(view));
+}
+
+
+// Writes the whole slot, so the padding around the glyph is cleared of whatever was there before.
+_Use_decl_annotations_
+void DynamicSpriteFont::Impl::Upload(ID3D11DeviceContext* context, RasterizedGlyph const& glyph, uint32_t slotWidth, uint32_t slotHeight, Entry& entry)
+{
+    mUploadScratch.assign(size_t(slotWidth) * size_t(slotHeight), 0);
+
+    // Premultiplied white, tinted by the SpriteBatch color.
+    for (uint32_t y = 0; y < glyph.height; y++)
+    {
+        auto source = glyph.coverage.data() + size_t(y) * glyph.width;
+        auto dest = mUploadScratch.data() + size_t(y + SlotPadding) * slotWidth + SlotPadding;
+
+        for (uint32_t x = 0; x < glyph.width; x++)
+        {
+            dest[x] = source[x] * 0x01010101u;
+        }
+    }
+
+    const auto left = static_cast<UINT>(entry.subrect.left) - SlotPadding;
+    const auto top = static_cast<UINT>(entry.subrect.top) - SlotPadding;
+
+    const D3D11_BOX box = { left, top, 0, left + slotWidth, top + slotHeight, 1 };
+
+    context->UpdateSubresource(mPageTextures[entry.page].Get(), 0, &box, mUploadScratch.data(), slotWidth * sizeof(uint32_t), 0);
+
+    entry.subrect.right = entry.subrect.left + static_cast<LONG>(glyph.width);
+    entry.subrect.bottom = entry.subrect.top + static_cast<LONG>(glyph.height);
+    entry.xOffset = float(glyph.left);
+    entry.yOffset = mAscent + float(glyph.top);
+}
+
+
+// Looks up the glyph index of a code point, zero being the font's missing glyph.
+uint16_t DynamicSpriteFont::Impl::FindGlyphIndex(uint32_t character)
+{
+    uint32_t glyphIndex = mCharacters.Find(character);
+
+    if (glyphIndex == GlyphTable::NotFound)
+    {
+        UINT16 index = 0;
+        ThrowIfFailed(mFontFace->GetGlyphIndices(&character, 1, &index));
+
+        glyphIndex = index;
+        mCharacters.Insert(character, glyphIndex);
+    }
+
+    return static_cast<uint16_t>(glyphIndex);
+}
+
+
+// Returns the entry for a character, reading its metrics the first time it is seen.
+uint32_t DynamicSpriteFont::Impl::FindEntry(uint32_t character)
+{
+    uint16_t glyphIndex = FindGlyphIndex(character);
+
+    if (!glyphIndex)
+    {
+        glyphIndex = mDefaultGlyph;
+    }
+
+    uint32_t index = mGlyphs.Find(glyphIndex);
+
+    if (index == GlyphTable::NotFound)
+    {
+        DWRITE_GLYPH_METRICS metrics = {};
+        ThrowIfFailed(mFontFace->GetDesignGlyphMetrics(&glyphIndex, 1, &metrics, FALSE));
+
+        index = static_cast<uint32_t>(mEntries.size());
+
+        Entry entry = {};
+        entry.glyphIndex = glyphIndex;
+        entry.state = GlyphState::Unrequested;
+        entry.advance = float(metrics.advanceWidth) * mDesignScale;
+
+        mEntries.push_back(entry);
+        mGlyphs.Insert(glyphIndex, index);
+    }
+
+    return index;
+}
+
+
+void DynamicSpriteFont::Impl::MarkUsed(uint32_t index)
+{
+    auto& entry = mEntries[index];
+
+    if (entry.state == GlyphState::Unrequested)
+    {
+        Request(index);
+    }
+    else if (entry.state == GlyphState::Resident)
+    {
+        mAtlas.Touch(index, mFrame);
+    }
+}
+
+
+void DynamicSpriteFont::Impl::Request(uint32_t index)
+{
+    auto& entry = mEntries[index];
+
+    entry.state = GlyphState::Pending;
+    mStats.pendingGlyphs++;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.push_back(RasterRequest{ index, entry.glyphIndex });
+    }
+    mWorkAvailable.notify_one();
+}
+
+
+void DynamicSpriteFont::Impl::SetDefaultCharacter(wchar_t character)
+{
+    uint16_t glyphIndex = 0;
+
+    if (character)
+    {
+        glyphIndex = FindGlyphIndex(character);
+
+        if (!glyphIndex)
+        {
+            DebugTrace("ERROR: DynamicSpriteFont default character (%u, %C) is not in the font\n", unsigned(character), character);
+            throw std::runtime_error("Character not in font");
+        }
+    }
+
+    defaultCharacter = character;
+    mDefaultGlyph = glyphIndex;
+}
+
+
+DynamicSpriteFont::Statistics DynamicSpriteFont::Impl::GetStatistics() const
+{
+    auto result = mStats;
+
+    result.pages = mAtlas.GetPageCount();
+    result.residentGlyphs = mAtlas.GetResidentCount();
+    result.evictions = mAtlas.GetEvictionCount();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    result.rasterized = mRasterized;
+
+    return result;
+}
+
+
+// Lays out one glyph per code point, calling action with its entry and pen position.
+template<typename TChar, typename TAction>
+void DynamicSpriteFont::Impl::LayoutGlyphs(_In_z_ TChar const* text, TAction action)
+{
+    float x = 0;
+    float y = 0;
+
+    while (*text)
+    {
+        const uint32_t character = NextCharacter(text);
+
+        switch (character)
+        {
+            case '\r':
+                // Skip carriage returns.
+                continue;
+
+            case '\n':
+                // New line.
+                x = 0;
+                y += lineSpacing;
+                break;
+
+            default:
+                const uint32_t index = FindEntry(character);
+
+                action(index, x, y);
+
+                x += mEntries[index].advance;
+                break;
+        }
+    }
+}
+
+
+// Draws the resident glyphs of a string and requests the rest.
+template<typename TChar>
+void XM_CALLCONV DynamicSpriteFont::Impl::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ TChar const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth)
+{
+    static_assert(SpriteEffects_FlipHorizontally == 1 &&
+                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
+
+    // Lookup table indicates which way to move along each axis per SpriteEffects enum value.
+    static XMVECTORF32 axisDirectionTable[4] =
+    {
+        { { { -1, -1, 0, 0 } } },
+        { { {  1, -1, 0, 0 } } },
+        { { { -1,  1, 0, 0 } } },
+        { { {  1,  1, 0, 0 } } },
+    };
+
+    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
+    static XMVECTORF32 axisIsMirroredTable[4] =
+    {
+        { { { 0, 0, 0, 0 } } },
+        { { { 1, 0, 0, 0 } } },
+        { { { 0, 1, 0, 0 } } },
+        { { { 1, 1, 0, 0 } } },
+    };
+
+    XMVECTOR baseOffset = origin;
+
+    // If the text is mirrored, offset the start position accordingly.
+    if (effects)
+    {
+        baseOffset = XMVectorNegativeMultiplySubtract(
+            MeasureString(text),
+            axisIsMirroredTable[effects & 3],
+            baseOffset);
+    }
+
+    LayoutGlyphs(text, [&](uint32_t index, float x, float y)
+    {
+        MarkUsed(index);
+
+        auto& entry = mEntries[index];
+
+        if (entry.state != GlyphState::Resident)
+            return;
+
+        XMVECTOR offset = XMVectorMultiplyAdd(XMVectorSet(x + entry.xOffset, y + entry.yOffset, 0, 0), axisDirectionTable[effects & 3], baseOffset);
+
+        if (effects)
+        {
+            // For mirrored characters, specify bottom and/or right instead of top left.
+            XMVECTOR glyphRect = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&entry.subrect)), 0);
+
+            // xy = glyph width/height.
+            glyphRect = XMVectorSubtract(XMVectorSwizzle<2, 3, 0, 1>(glyphRect), glyphRect);
+
+            offset = XMVectorMultiplyAdd(glyphRect, axisIsMirroredTable[effects & 3], offset);
+        }
+
+        spriteBatch->Draw(mPages[entry.page].Get(), position, &entry.subrect, color, rotation, offset, scale, effects, layerDepth);
+    });
+}
+
+
+template<typename TChar>
+XMVECTOR DynamicSpriteFont::Impl::MeasureString(_In_z_ TChar const* text)
+{
+    XMVECTOR result = XMVectorZero();
+
+    LayoutGlyphs(text, [&](uint32_t index, float x, float y)
+    {
+        result = XMVectorMax(result, XMVectorSet(x + mEntries[index].advance, y + lineSpacing, 0, 0));
+    });
+
+    return result;
+}
+
+
+template<typename TChar>
+void DynamicSpriteFont::Impl::RequestGlyphs(_In_z_ TChar const* text)
+{
+    LayoutGlyphs(text, [&](uint32_t index, float, float)
+    {
+        if (mEntries[index].state == GlyphState::Unrequested)
+        {
+            Request(index);
+        }
+    });
+}
+
+
+// Renders one glyph with DirectWrite. Grayscale antialiasing needs IDWriteFactory2, so the
+// ClearType texture, which every version can produce, is averaged down to coverage.
+HRESULT DynamicSpriteFont::Impl::Rasterize(uint16_t glyphIndex, RasterizedGlyph& glyph)
+{
+    const FLOAT advance = 0;
+    const DWRITE_GLYPH_OFFSET offset = {};
+
+    DWRITE_GLYPH_RUN run = {};
+    run.fontFace = mFontFace.Get();
+    run.fontEmSize = mFontSize;
+    run.glyphCount = 1;
+    run.glyphIndices = &glyphIndex;
+    run.glyphAdvances = &advance;
+    run.glyphOffsets = &offset;
+
+    ComPtr<IDWriteGlyphRunAnalysis> analysis;
+    HRESULT hr = mFactory->CreateGlyphRunAnalysis(&run, 1.0f, nullptr,
+        DWRITE_RENDERING_MODE_NATURAL_SYMMETRIC, DWRITE_MEASURING_MODE_NATURAL,
+        0.0f, 0.0f, analysis.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    RECT bounds = {};
+    hr = analysis->GetAlphaTextureBounds(DWRITE_TEXTURE_CLEARTYPE_3x1, &bounds);
+    if (FAILED(hr))
+        return hr;
+
+    if (bounds.right <= bounds.left || bounds.bottom <= bounds.top)
+        return S_OK;
+
+    const auto width = static_cast<uint32_t>(bounds.right - bounds.left);
+    const auto height = static_cast<uint32_t>(bounds.bottom - bounds.top);
+    const size_t pixels = size_t(width) * size_t(height);
+
+    mRasterScratch.resize(pixels * 3);
+
+    hr = analysis->CreateAlphaTexture(DWRITE_TEXTURE_CLEARTYPE_3x1, &bounds, mRasterScratch.data(), static_cast<UINT32>(mRasterScratch.size()));
+    if (FAILED(hr))
+        return hr;
+
+    glyph.coverage.resize(pixels);
+
+    for (size_t j = 0; j < pixels; j++)
+    {
+        auto rgb = &mRasterScratch[j * 3];
+
+        glyph.coverage[j] = static_cast<uint8_t>((unsigned(rgb[0]) + unsigned(rgb[1]) + unsigned(rgb[2]) + 1) / 3);
+    }
+
+    glyph.left = bounds.left;
+    glyph.top = bounds.top;
+    glyph.width = width;
+    glyph.height = height;
+
+    return S_OK;
+}
+
+
+void DynamicSpriteFont::Impl::RasterThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mWorkAvailable.wait(lock, [this] { return mStopping || !mRequests.empty(); });
+        if (mStopping)
+            break;
+
+        const RasterRequest request = mRequests.front();
+        mRequests.pop_front();
+        lock.unlock();
+
+        RasterizedGlyph glyph = {};
+        glyph.entry = request.entry;
+
+        const HRESULT hr = Rasterize(request.glyphIndex, glyph);
+        if (FAILED(hr))
+        {
+            // Left empty, so the glyph is laid out but never drawn.
+            DebugTrace("ERROR: DynamicSpriteFont failed to rasterize glyph %u (%08X)\n", unsigned(request.glyphIndex), static_cast<unsigned int>(hr));
+
+            glyph.width = 0;
+            glyph.height = 0;
+        }
+
+        lock.lock();
+        mCompleted.push_back(std::move(glyph));
+        mRasterized++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// DynamicSpriteFont
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+DynamicSpriteFont::DynamicSpriteFont(ID3D11Device* device, wchar_t const* fontName, float fontSize, uint32_t pageSize, uint32_t maxPages)
+    : pImpl(std::make_unique<Impl>(device, fontName, fontSize, pageSize, maxPages))
+{
+}
+
+
+// Move constructor.
+DynamicSpriteFont::DynamicSpriteFont(DynamicSpriteFont&& moveFrom) noexcept
+    : pImpl(std::move(moveFrom.pImpl))
+{
+}
+
+
+// Move assignment.
+DynamicSpriteFont& DynamicSpriteFont::operator= (DynamicSpriteFont&& moveFrom) noexcept
+{
+    pImpl = std::move(moveFrom.pImpl);
+    return *this;
+}
+
+
+// Public destructor.
+DynamicSpriteFont::~DynamicSpriteFont()
+{
+}
+
+
+_Use_decl_annotations_
+size_t DynamicSpriteFont::Update(ID3D11DeviceContext* context, size_t budgetBytes)
+{
+    return pImpl->Update(context, budgetBytes);
+}
+
+
+// Wide-character / UTF-16LE
+void XM_CALLCONV DynamicSpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth)
+{
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV DynamicSpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth)
+{
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV DynamicSpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth)
+{
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects, layerDepth);
+}
+
+
+// UTF-8
+void XM_CALLCONV DynamicSpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth)
+{
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV DynamicSpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth)
+{
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV DynamicSpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth)
+{
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects, layerDepth);
+}
+
+
+XMVECTOR XM_CALLCONV DynamicSpriteFont::MeasureString(_In_z_ wchar_t const* text)
+{
+    return pImpl->MeasureString(text);
+}
+
+
+XMVECTOR XM_CALLCONV DynamicSpriteFont::MeasureString(_In_z_ char const* text)
+{
+    return pImpl->MeasureString(text);
+}
+
+
+void DynamicSpriteFont::RequestGlyphs(_In_z_ wchar_t const* text)
+{
+    pImpl->RequestGlyphs(text);
+}
+
+
+void DynamicSpriteFont::RequestGlyphs(_In_z_ char const* text)
+{
+    pImpl->RequestGlyphs(text);
+}
+
+
+// Spacing properties
+float DynamicSpriteFont::GetLineSpacing() const noexcept
+{
+    return pImpl->lineSpacing;
+}
+
+
+void DynamicSpriteFont::SetLineSpacing(float spacing) noexcept
+{
+    pImpl->lineSpacing = spacing;
+}
+
+
+// Font properties
+wchar_t DynamicSpriteFont::GetDefaultCharacter() const noexcept
+{
+    return pImpl->defaultCharacter;
+}
+
+
+void DynamicSpriteFont::SetDefaultCharacter(wchar_t character)
+{
+    pImpl->SetDefaultCharacter(character);
+}
+
+
+bool DynamicSpriteFont::ContainsCharacter(wchar_t character)
+{
+    return pImpl->FindGlyphIndex(character) != 0;
+}
+
+
+DynamicSpriteFont::Statistics DynamicSpriteFont::GetStatistics() const
+{
+    return pImpl->GetStatistics();
+}
@@ -15,6 +15,10 @@
 #include "DDSTextureLoader.h"
 #include "WICTextureLoader.h"
 
+#include <atomic>
+#include <future>
+#include <unordered_map>
+
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
@@ -28,13 +32,20 @@ public:
         mDevice(device),
         mSharing(true),
         mUseNormalMapEffect(true),
-        mForceSRGB(false)
+        mForceSRGB(false),
+        mNextTextureLoad(0),
+        mTextureRequests(0),
+        mTextureHits(0),
+        mTextureWaits(0),
+        mTextureLoads(0),
+        mTextureFailures(0)
     {}
 
     std::shared_ptr<IEffect> CreateEffect(_In_ IEffectFactory* factory, _In_ const IEffectFactory::EffectInfo& info, _In_opt_ ID3D11DeviceContext* deviceContext);
     void CreateTexture(_In_z_ const wchar_t* texture, _In_opt_ ID3D11DeviceContext* deviceContext, _Outptr_ ID3D11ShaderResourceView** textureView);
 
     void ReleaseCache();
+    EffectFactory::TextureCacheStats GetTextureCacheStats() const noexcept;
     void SetSharing(bool enabled) noexcept { mSharing = enabled; }
     void EnableNormalMapEffect(bool enabled) noexcept { mUseNormalMapEffect = enabled; }
     void EnableForceSRGB(bool forceSRGB) noexcept { mForceSRGB = forceSRGB; }
@@ -47,19 +58,50 @@ public:
 
 private:
     using EffectCache = std::map< std::wstring, std::shared_ptr<IEffect> >;
-    using TextureCache = std::map< std::wstring, ComPtr<ID3D11ShaderResourceView> >;
+
+    // Textures are cached as futures, so a texture that several threads ask for at once is only
+    // loaded by the first of them; the others wait for its result. The cache is split into
+    // stripes by name hash so threads loading different textures do not share a lock.
+    using TextureFuture = std::shared_future<ComPtr<ID3D11ShaderResourceView>>;
+
+    struct TextureEntry
+    {
+        TextureFuture   future;
+        uint64_t        loadId;
+    };
+
+    struct TextureStripe
+    {
+        std::mutex                                      mutex;
+        std::unordered_map<std::wstring, TextureEntry>  textures;
+    };
+
+    static constexpr size_t TextureStripeCount = 16;
+
+    std::shared_ptr<IEffect> FindEffect(const EffectCache& cache, _In_z_ const wchar_t* name);
+    void LoadTexture(_In_z_ const wchar_t* name, _In_opt_ ID3D11DeviceContext* deviceContext, _Outptr_ ID3D11ShaderResourceView** textureView);
 
     EffectCache  mEffectCache;
     EffectCache  mEffectCacheSkinning;
     EffectCache  mEffectCacheDualTexture;
     EffectCache  mEffectNormalMap;
-    TextureCache mTextureCache;
+
+    TextureStripe mTextureStripes[TextureStripeCount];
 
     bool mSharing;
     bool mUseNormalMapEffect;
     bool mForceSRGB;
 
+    std::atomic<uint64_t> mNextTextureLoad;
+    std::atomic<size_t>   mTextureRequests;
+    std::atomic<size_t>   mTextureHits;
+    std::atomic<size_t>   mTextureWaits;
+    std::atomic<size_t>   mTextureLoads;
+    std::atomic<size_t>   mTextureFailures;
+
+    // Guards the effect caches, and the immediate context when WIC generates mips
     std::mutex mutex;
+    std::mutex contextMutex;
 };
 
 
@@ -75,10 +117,10 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(IEffectFactory* facto
         // SkinnedEffect
         if (mSharing && info.name && *info.name)
         {
-            auto it = mEffectCacheSkinning.find(info.name);
-            if (mSharing && it != mEffectCacheSkinning.end())
+            auto cached = FindEffect(mEffectCacheSkinning, info.name);
+            if (cached)
             {
-                return it->second;
+                return cached;
             }
         }
 
@@ -138,10 +180,10 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(IEffectFactory* facto
         // DualTextureEffect
         if (mSharing && info.name && *info.name)
         {
-            auto it = mEffectCacheDualTexture.find(info.name);
-            if (mSharing && it != mEffectCacheDualTexture.end())
+            auto cached = FindEffect(mEffectCacheDualTexture, info.name);
+            if (cached)
             {
-                return it->second;
+                return cached;
             }
         }
 
@@ -200,10 +242,10 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(IEffectFactory* facto
         // NormalMapEffect
         if (mSharing && info.name && *info.name)
         {
-            auto it = mEffectNormalMap.find(info.name);
-            if (mSharing && it != mEffectNormalMap.end())
+            auto cached = FindEffect(mEffectNormalMap, info.name);
+            if (cached)
             {
-                return it->second;
+                return cached;
             }
         }
 
@@ -286,10 +328,10 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(IEffectFactory* facto
         // BasicEffect
         if (mSharing && info.name && *info.name)
         {
-            auto it = mEffectCache.find(info.name);
-            if (mSharing && it != mEffectCache.end())
+            auto cached = FindEffect(mEffectCache, info.name);
+            if (cached)
             {
-                return it->second;
+                return cached;
             }
         }
 
@@ -353,106 +395,196 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(IEffectFactory* facto
     }
 }
 
+_Use_decl_annotations_
+std::shared_ptr<IEffect> EffectFactory::Impl::FindEffect(const EffectCache& cache, const wchar_t* name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = cache.find(name);
+    if (it != cache.end())
+    {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
 _Use_decl_annotations_
 void EffectFactory::Impl::CreateTexture(const wchar_t* name, ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView** textureView)
 {
     if (!name || !textureView)
         throw std::invalid_argument("name and textureView parameters can't be null");
 
-#if defined(_XBOX_ONE) && defined(_TITLE)
-    UNREFERENCED_PARAMETER(deviceContext);
-#endif
+    ++mTextureRequests;
 
-    auto it = mTextureCache.find(name);
+    if (!mSharing || !*name)
+    {
+        ++mTextureLoads;
+        LoadTexture(name, deviceContext, textureView);
+        return;
+    }
+
+    std::wstring key(name);
+    auto& stripe = mTextureStripes[std::hash<std::wstring>()(key) % TextureStripeCount];
 
-    if (mSharing && it != mTextureCache.end())
+    std::promise<ComPtr<ID3D11ShaderResourceView>> promise;
+    uint64_t loadId = 0;
+    TextureFuture future;
     {
-        ID3D11ShaderResourceView* srv = it->second.Get();
-        srv->AddRef();
-        *textureView = srv;
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+
+        auto it = stripe.textures.find(key);
+        if (it != stripe.textures.end())
+        {
+            future = it->second.future;
+        }
+        else
+        {
+            loadId = ++mNextTextureLoad;
+            TextureEntry entry = { promise.get_future().share(), loadId };
+            stripe.textures.emplace(key, entry);
+        }
     }
-    else
+
+    if (!loadId)
     {
-        wchar_t fullName[MAX_PATH] = {};
-        wcscpy_s(fullName, mPath);
-        wcscat_s(fullName, name);
+        // Loaded or being loaded by another thread; get() rethrows if that load failed
+        if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            ++mTextureHits;
+        else
+            ++mTextureWaits;
 
-        WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
-        if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+        ComPtr<ID3D11ShaderResourceView> srv = future.get();
+        *textureView = srv.Detach();
+        return;
+    }
+
+    ++mTextureLoads;
+
+    ComPtr<ID3D11ShaderResourceView> srv;
+    try
+    {
+        LoadTexture(name, deviceContext, srv.GetAddressOf());
+    }
+    catch (...)
+    {
+        ++mTextureFailures;
+
+        // Waiting threads see the failure, later requests retry the load
+        promise.set_exception(std::current_exception());
         {
-            // Try Current Working Directory (CWD)
-            wcscpy_s(fullName, name);
-            if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+
+            auto it = stripe.textures.find(key);
+            if (it != stripe.textures.end() && it->second.loadId == loadId)
             {
-                DebugTrace("ERROR: EffectFactory could not find texture file '%ls'\n", name);
-                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "EffectFactory::CreateTexture");
+                stripe.textures.erase(it);
             }
         }
+        throw;
+    }
 
-        wchar_t ext[_MAX_EXT] = {};
-        _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
-        bool isdds = _wcsicmp(ext, L".dds") == 0;
+    promise.set_value(srv);
+    *textureView = srv.Detach();
+}
 
-        if (isdds)
+_Use_decl_annotations_
+void EffectFactory::Impl::LoadTexture(const wchar_t* name, ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView** textureView)
+{
+#if defined(_XBOX_ONE) && defined(_TITLE)
+    UNREFERENCED_PARAMETER(deviceContext);
+#endif
+
+    wchar_t fullName[MAX_PATH] = {};
+    wcscpy_s(fullName, mPath);
+    wcscat_s(fullName, name);
+
+    WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
+    if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+    {
+        // Try Current Working Directory (CWD)
+        wcscpy_s(fullName, name);
+        if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
         {
-            HRESULT hr = CreateDDSTextureFromFileEx(
-                mDevice.Get(), fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB, nullptr, textureView);
-            if (FAILED(hr))
-            {
-                DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectFactory::CreateDDSTextureFromFile");
-            }
+            DebugTrace("ERROR: EffectFactory could not find texture file '%ls'\n", name);
+            throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "EffectFactory::CreateTexture");
         }
-    #if !defined(_XBOX_ONE) || !defined(_TITLE)
-        else if (deviceContext)
+    }
+
+    wchar_t ext[_MAX_EXT] = {};
+    _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+    bool isdds = _wcsicmp(ext, L".dds") == 0;
+
+    if (isdds)
+    {
+        HRESULT hr = CreateDDSTextureFromFileEx(
+            mDevice.Get(), fullName, 0,
+            D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+            mForceSRGB, nullptr, textureView);
+        if (FAILED(hr))
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            HRESULT hr = CreateWICTextureFromFileEx(
-                mDevice.Get(), deviceContext, fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
-            {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
-            }
+            DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
+                static_cast<unsigned int>(hr), fullName);
+            throw std::runtime_error("EffectFactory::CreateDDSTextureFromFile");
         }
-    #endif
-        else
+    }
+#if !defined(_XBOX_ONE) || !defined(_TITLE)
+    else if (deviceContext)
+    {
+        std::lock_guard<std::mutex> lock(contextMutex);
+        HRESULT hr = CreateWICTextureFromFileEx(
+            mDevice.Get(), deviceContext, fullName, 0,
+            D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+            mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
+        if (FAILED(hr))
         {
-            HRESULT hr = CreateWICTextureFromFileEx(
-                mDevice.Get(), fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
-            {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
-            }
+            DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                static_cast<unsigned int>(hr), fullName);
+            throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
         }
-
-        if (mSharing && *name && it == mTextureCache.end())
+    }
+#endif
+    else
+    {
+        HRESULT hr = CreateWICTextureFromFileEx(
+            mDevice.Get(), fullName, 0,
+            D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+            mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
+        if (FAILED(hr))
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            TextureCache::value_type v(name, *textureView);
-            mTextureCache.insert(v);
+            DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                static_cast<unsigned int>(hr), fullName);
+            throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
         }
     }
 }
 
 void EffectFactory::Impl::ReleaseCache()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    mEffectCache.clear();
-    mEffectCacheSkinning.clear();
-    mEffectCacheDualTexture.clear();
-    mEffectNormalMap.clear();
-    mTextureCache.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mEffectCache.clear();
+        mEffectCacheSkinning.clear();
+        mEffectCacheDualTexture.clear();
+        mEffectNormalMap.clear();
+    }
+
+    for (auto& stripe : mTextureStripes)
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        stripe.textures.clear();
+    }
+}
+
+EffectFactory::TextureCacheStats EffectFactory::Impl::GetTextureCacheStats() const noexcept
+{
+    EffectFactory::TextureCacheStats stats = {};
+    stats.requests = mTextureRequests;
+    stats.hits = mTextureHits;
+    stats.waits = mTextureWaits;
+    stats.loads = mTextureLoads;
+    stats.failures = mTextureFailures;
+    return stats;
 }
 
 
@@ -499,6 +631,11 @@ void EffectFactory::ReleaseCache()
     pImpl->ReleaseCache();
 }
 
+EffectFactory::TextureCacheStats EffectFactory::GetTextureCacheStats() const noexcept
+{
+    return pImpl->GetTextureCacheStats();
+}
+
 void EffectFactory::SetSharing(bool enabled) noexcept
 {
     pImpl->SetSharing(enabled);
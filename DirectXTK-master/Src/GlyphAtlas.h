@@ -0,0 +1,345 @@
+//--------------------------------------------------------------------------------------
+// File: GlyphAtlas.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Slot allocation for the DynamicSpriteFont atlas, and its least recently used list of
+    // resident glyphs. Glyphs are identified by the caller's index, and pages by their number,
+    // so the textures stay with the caller. Nothing here needs Direct3D, so it can be tested
+    // without a device.
+    //
+    // Pages are split into square regions, and each region in use holds a grid of equally
+    // sized slots. Any slot of a region fits any glyph of its size class, and a region whose
+    // last glyph is evicted can take another size class, so the atlas never fragments.
+    class GlyphAtlas
+    {
+    public:
+        static constexpr uint32_t None = UINT32_MAX;
+
+        struct Region
+        {
+            uint32_t page;
+            uint32_t x;
+            uint32_t y;
+            uint32_t slotWidth;     // Zero while the region is free
+            uint32_t slotHeight;
+            uint32_t columns;
+            uint32_t used;
+            std::vector<uint32_t> freeSlots;
+        };
+
+        // Where a resident glyph is, and its links in the least recently used list.
+        struct Glyph
+        {
+            uint32_t region;        // None unless resident
+            uint32_t slot;
+            uint64_t lastUsed;      // Frame of the last Allocate or Touch
+            uint32_t newer;
+            uint32_t older;
+        };
+
+        // The top left of an allocated slot.
+        struct Location
+        {
+            uint32_t page;
+            uint32_t x;
+            uint32_t y;
+        };
+
+        GlyphAtlas(uint32_t pageSize, uint32_t maxPages) noexcept
+            : mPageSize(pageSize),
+            mMaxPages(maxPages),
+            mRegionSize(0),
+            mPageCount(0),
+            mNewest(None),
+            mOldest(None),
+            mResidentCount(0),
+            mEvictionCount(0)
+        {
+        }
+
+        GlyphAtlas(GlyphAtlas const&) = delete;
+        GlyphAtlas& operator= (GlyphAtlas const&) = delete;
+
+        // Set once, before the first Allocate, and no larger than the page size.
+        void SetRegionSize(uint32_t size) noexcept { mRegionSize = size; }
+
+        uint32_t GetRegionSize() const noexcept { return mRegionSize; }
+
+        // Takes a slot for a glyph that is not resident, making it the most recently used. When
+        // no region of its size class has room, takes a free region, then a new page, for which
+        // addPage(page) creates the texture before any of it is handed out, then evicts the
+        // least recently used glyphs, calling evicted(glyph) for each. Glyphs used this frame
+        // are never evicted, so returns false when the atlas is full of them.
+        template<typename TAddPage, typename TEvicted>
+        bool Allocate(uint32_t glyph, uint32_t slotWidth, uint32_t slotHeight, uint64_t frame, TAddPage&& addPage, TEvicted&& evicted, Location& location)
+        {
+            // Unordered map references survive rehashing, so this stays valid as other classes are added.
+            auto& partial = mPartialRegions[SizeClass(slotWidth, slotHeight)];
+
+            while (partial.empty())
+            {
+                if (!mFreeRegions.empty())
+                {
+                    const uint32_t index = mFreeRegions.back();
+                    mFreeRegions.pop_back();
+
+                    auto& region = mRegions[index];
+
+                    region.slotWidth = slotWidth;
+                    region.slotHeight = slotHeight;
+                    region.columns = mRegionSize / slotWidth;
+                    region.used = 0;
+
+                    // Handed out from the back, so slot 0 is used first.
+                    const uint32_t slots = region.columns * (mRegionSize / slotHeight);
+
+                    region.freeSlots.resize(slots);
+
+                    for (uint32_t slot = 0; slot < slots; slot++)
+                    {
+                        region.freeSlots[slot] = slots - slot - 1;
+                    }
+
+                    partial.push_back(index);
+                }
+                else if (mPageCount < mMaxPages)
+                {
+                    addPage(mPageCount);
+
+                    AddPage();
+                }
+                else if (!EvictOldest(frame, evicted))
+                {
+                    return false;
+                }
+            }
+
+            const uint32_t index = partial.back();
+            auto& region = mRegions[index];
+
+            const uint32_t slot = region.freeSlots.back();
+            region.freeSlots.pop_back();
+            region.used++;
+
+            if (region.freeSlots.empty())
+            {
+                partial.pop_back();
+            }
+
+            if (glyph >= mGlyphs.size())
+            {
+                mGlyphs.resize(size_t(glyph) + 1, Glyph{ None, 0, 0, None, None });
+            }
+
+            auto& resident = mGlyphs[glyph];
+
+            resident.region = index;
+            resident.slot = slot;
+            resident.lastUsed = frame;
+
+            LinkNewest(glyph);
+
+            mResidentCount++;
+
+            location.page = region.page;
+            location.x = region.x + (slot % region.columns) * slotWidth;
+            location.y = region.y + (slot / region.columns) * slotHeight;
+
+            return true;
+        }
+
+        // Marks a resident glyph as used this frame, making it the most recently used.
+        void Touch(uint32_t glyph, uint64_t frame) noexcept
+        {
+            auto& resident = mGlyphs[glyph];
+
+            if (resident.lastUsed != frame)
+            {
+                Unlink(glyph);
+                LinkNewest(glyph);
+
+                resident.lastUsed = frame;
+            }
+        }
+
+        bool IsResident(uint32_t glyph) const noexcept
+        {
+            return glyph < mGlyphs.size() && mGlyphs[glyph].region != None;
+        }
+
+        Glyph const& GetGlyph(uint32_t glyph) const noexcept { return mGlyphs[glyph]; }
+
+        uint32_t GetNewest() const noexcept { return mNewest; }
+        uint32_t GetOldest() const noexcept { return mOldest; }
+
+        Region const& GetRegion(uint32_t index) const noexcept { return mRegions[index]; }
+
+        size_t GetRegionCount() const noexcept { return mRegions.size(); }
+
+        std::vector<uint32_t> const& GetFreeRegions() const noexcept { return mFreeRegions; }
+
+        // Regions of a size class with at least one free slot, or nullptr if it was never used.
+        std::vector<uint32_t> const* GetPartialRegions(uint32_t slotWidth, uint32_t slotHeight) const
+        {
+            auto it = mPartialRegions.find(SizeClass(slotWidth, slotHeight));
+
+            return (it != mPartialRegions.end()) ? &it->second : nullptr;
+        }
+
+        uint32_t GetPageCount() const noexcept { return mPageCount; }
+        size_t GetResidentCount() const noexcept { return mResidentCount; }
+        uint64_t GetEvictionCount() const noexcept { return mEvictionCount; }
+
+    private:
+        static uint32_t SizeClass(uint32_t width, uint32_t height) noexcept
+        {
+            return (width << 16) | height;
+        }
+
+        void AddPage()
+        {
+            const uint32_t page = mPageCount;
+            const uint32_t regionsPerSide = mPageSize / mRegionSize;
+
+            for (uint32_t y = 0; y < regionsPerSide; y++)
+            {
+                for (uint32_t x = 0; x < regionsPerSide; x++)
+                {
+                    mFreeRegions.push_back(static_cast<uint32_t>(mRegions.size()));
+                    mRegions.push_back(Region{ page, x * mRegionSize, y * mRegionSize, 0, 0, 0, 0, {} });
+                }
+            }
+
+            mPageCount++;
+        }
+
+        // Evicts the least recently used glyph, unless it has been used this frame.
+        template<typename TEvicted>
+        bool EvictOldest(uint64_t frame, TEvicted&& evicted)
+        {
+            if (mOldest == None)
+                return false;
+
+            const uint32_t glyph = mOldest;
+
+            if (mGlyphs[glyph].lastUsed >= frame)
+                return false;
+
+            Unlink(glyph);
+            FreeSlot(glyph);
+
+            mResidentCount--;
+            mEvictionCount++;
+
+            evicted(glyph);
+
+            return true;
+        }
+
+        // Returns a glyph's slot to its region, and the region to the free list once it is empty.
+        void FreeSlot(uint32_t glyph)
+        {
+            auto& resident = mGlyphs[glyph];
+            auto& region = mRegions[resident.region];
+            auto& partial = mPartialRegions[SizeClass(region.slotWidth, region.slotHeight)];
+
+            region.freeSlots.push_back(resident.slot);
+            region.used--;
+
+            if (!region.used)
+            {
+                // A region with a single slot was full until now, so it is not on the partial list.
+                if (region.freeSlots.size() > 1)
+                {
+                    partial.erase(std::find(partial.begin(), partial.end(), resident.region));
+                }
+
+                region.slotWidth = 0;
+                region.slotHeight = 0;
+                region.freeSlots.clear();
+
+                mFreeRegions.push_back(resident.region);
+            }
+            else if (region.freeSlots.size() == 1)
+            {
+                partial.push_back(resident.region);
+            }
+
+            resident.region = None;
+        }
+
+        void LinkNewest(uint32_t glyph) noexcept
+        {
+            auto& resident = mGlyphs[glyph];
+
+            resident.newer = None;
+            resident.older = mNewest;
+
+            if (mNewest != None)
+            {
+                mGlyphs[mNewest].newer = glyph;
+            }
+            else
+            {
+                mOldest = glyph;
+            }
+
+            mNewest = glyph;
+        }
+
+        void Unlink(uint32_t glyph) noexcept
+        {
+            auto& resident = mGlyphs[glyph];
+
+            if (resident.newer != None)
+            {
+                mGlyphs[resident.newer].older = resident.older;
+            }
+            else
+            {
+                mNewest = resident.older;
+            }
+
+            if (resident.older != None)
+            {
+                mGlyphs[resident.older].newer = resident.newer;
+            }
+            else
+            {
+                mOldest = resident.newer;
+            }
+        }
+
+        uint32_t mPageSize;
+        uint32_t mMaxPages;
+        uint32_t mRegionSize;
+        uint32_t mPageCount;
+
+        std::vector<Region> mRegions;
+        std::vector<uint32_t> mFreeRegions;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> mPartialRegions;
+
+        // Indexed by the caller's glyph index, and grown as glyphs are first allocated.
+        std::vector<Glyph> mGlyphs;
+        uint32_t mNewest;
+        uint32_t mOldest;
+        size_t mResidentCount;
+        uint64_t mEvictionCount;
+    };
+}
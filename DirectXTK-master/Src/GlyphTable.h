@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// File: GlyphTable.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Maps code points to glyph indices in constant time. The Basic Multilingual Plane is
+    // split into 256 pages of 256 characters, and only the pages a font uses get storage,
+    // so Latin fonts cost a few KB while CJK fonts still look up with two loads. Code points
+    // above the BMP are rare and sparse, so they go in a small open addressing hash.
+    class GlyphTable
+    {
+    public:
+        static constexpr uint32_t NotFound = UINT32_MAX;
+
+        GlyphTable() :
+            mPageIndices{},
+            mPages(PageSize, NotFound),
+            mSupplementaryCount(0)
+        {
+        }
+
+        uint32_t Find(uint32_t character) const noexcept
+        {
+            if (character < BMPSize)
+            {
+                // Pages the font does not use point at page 0, which stays empty.
+                return mPages[size_t(mPageIndices[character >> PageBits]) * PageSize + (character & PageMask)];
+            }
+
+            if (!mSupplementaryCount)
+                return NotFound;
+
+            const size_t mask = mSupplementary.size() - 1;
+
+            for (size_t slot = Hash(character) & mask; ; slot = (slot + 1) & mask)
+            {
+                const auto& entry = mSupplementary[slot];
+
+                if (entry.character == character)
+                    return entry.index;
+
+                if (entry.index == NotFound)
+                    return NotFound;
+            }
+        }
+
+        // Adds or replaces the glyph index for a code point.
+        void Insert(uint32_t character, uint32_t index)
+        {
+            if (character < BMPSize)
+            {
+                auto& page = mPageIndices[character >> PageBits];
+
+                if (!page)
+                {
+                    page = static_cast<uint16_t>(mPages.size() / PageSize);
+                    mPages.resize(mPages.size() + PageSize, NotFound);
+                }
+
+                mPages[size_t(page) * PageSize + (character & PageMask)] = index;
+                return;
+            }
+
+            // Keep the hash at most half full so probe sequences stay short.
+            if ((mSupplementaryCount + 1) * 2 > mSupplementary.size())
+            {
+                GrowSupplementary();
+            }
+
+            if (InsertSupplementary(character, index))
+            {
+                mSupplementaryCount++;
+            }
+        }
+
+        void Clear() noexcept
+        {
+            for (auto& page : mPageIndices)
+            {
+                page = 0;
+            }
+
+            mPages.resize(PageSize);
+            mSupplementary.clear();
+            mSupplementaryCount = 0;
+        }
+
+    private:
+        static constexpr uint32_t BMPSize = 0x10000;
+        static constexpr uint32_t PageBits = 8;
+        static constexpr uint32_t PageSize = 1u << PageBits;
+        static constexpr uint32_t PageMask = PageSize - 1;
+
+        struct Entry
+        {
+            uint32_t character;
+            uint32_t index;
+        };
+
+        static size_t Hash(uint32_t character) noexcept
+        {
+            // Fibonacci hashing spreads the runs of neighbouring code points a font tends to have.
+            return (character * 2654435769u) >> 8;
+        }
+
+        // Returns true if the code point was not already present.
+        bool InsertSupplementary(uint32_t character, uint32_t index) noexcept
+        {
+            const size_t mask = mSupplementary.size() - 1;
+
+            for (size_t slot = Hash(character) & mask; ; slot = (slot + 1) & mask)
+            {
+                auto& entry = mSupplementary[slot];
+
+                if (entry.index == NotFound)
+                {
+                    entry.character = character;
+                    entry.index = index;
+                    return true;
+                }
+
+                if (entry.character == character)
+                {
+                    entry.index = index;
+                    return false;
+                }
+            }
+        }
+
+        void GrowSupplementary()
+        {
+            std::vector<Entry> previous(mSupplementary.size() ? mSupplementary.size() * 2 : 16, Entry{ 0, NotFound });
+
+            previous.swap(mSupplementary);
+
+            for (auto& entry : previous)
+            {
+                if (entry.index != NotFound)
+                {
+                    InsertSupplementary(entry.character, entry.index);
+                }
+            }
+        }
+
+        uint16_t mPageIndices[BMPSize / PageSize];
+        std::vector<uint32_t> mPages;
+        std::vector<Entry> mSupplementary;
+        size_t mSupplementaryCount;
+    };
+}
@@ -20,6 +20,143 @@ using namespace DirectX;
 #error Model requires RTTI
 #endif
 
+namespace
+{
+    // The context calls Model::Draw and Model::Submit make, each counted as one state change.
+    // Without a context the calls are only counted, which is how Submit finds how many
+    // Model::Draw would have made for the same list.
+    class StateSetter
+    {
+    public:
+        StateSetter(_In_opt_ ID3D11DeviceContext* deviceContext, size_t& count) noexcept :
+            mDeviceContext(deviceContext),
+            mCount(count)
+        {
+        }
+
+        void SetBlendState(_In_ ID3D11BlendState* blendState)
+        {
+            if (mDeviceContext)
+                mDeviceContext->OMSetBlendState(blendState, nullptr, 0xFFFFFFFF);
+            ++mCount;
+        }
+
+        void SetDepthStencilState(_In_ ID3D11DepthStencilState* depthStencilState)
+        {
+            if (mDeviceContext)
+                mDeviceContext->OMSetDepthStencilState(depthStencilState, 0);
+            ++mCount;
+        }
+
+        void SetRasterizerState(_In_ ID3D11RasterizerState* rasterizerState)
+        {
+            if (mDeviceContext)
+                mDeviceContext->RSSetState(rasterizerState);
+            ++mCount;
+        }
+
+        void SetSamplers(const CommonStates& states)
+        {
+            if (mDeviceContext)
+            {
+                ID3D11SamplerState* samplers[] =
+                {
+                    states.LinearWrap(),
+                    states.LinearWrap(),
+                };
+
+                mDeviceContext->PSSetSamplers(0, 2, samplers);
+            }
+            ++mCount;
+        }
+
+        void SetInputLayout(_In_opt_ ID3D11InputLayout* inputLayout)
+        {
+            if (mDeviceContext)
+                mDeviceContext->IASetInputLayout(inputLayout);
+            ++mCount;
+        }
+
+        void SetVertexBuffer(_In_opt_ ID3D11Buffer* vertexBuffer, UINT vertexStride)
+        {
+            if (mDeviceContext)
+            {
+                UINT vbOffset = 0;
+                mDeviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vbOffset);
+            }
+            ++mCount;
+        }
+
+        void SetIndexBuffer(_In_opt_ ID3D11Buffer* indexBuffer, DXGI_FORMAT indexFormat)
+        {
+            if (mDeviceContext)
+                mDeviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
+            ++mCount;
+        }
+
+        void ApplyEffect(_In_ IEffect* effect)
+        {
+            if (mDeviceContext)
+                effect->Apply(mDeviceContext);
+            ++mCount;
+        }
+
+        void SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY primitiveType)
+        {
+            if (mDeviceContext)
+                mDeviceContext->IASetPrimitiveTopology(primitiveType);
+            ++mCount;
+        }
+
+    private:
+        ID3D11DeviceContext*    mDeviceContext;
+        size_t&                 mCount;
+    };
+
+    ID3D11BlendState* GetBlendState(const ModelMesh& mesh, const CommonStates& states, bool alpha)
+    {
+        if (!alpha)
+            return states.Opaque();
+
+        return mesh.pmalpha ? states.AlphaBlend() : states.NonPremultiplied();
+    }
+
+    ID3D11DepthStencilState* GetDepthStencilState(const CommonStates& states, bool alpha)
+    {
+        return alpha ? states.DepthRead() : states.DepthDefault();
+    }
+
+    ID3D11RasterizerState* GetRasterizerState(const ModelMesh& mesh, const CommonStates& states, bool wireframe)
+    {
+        if (wireframe)
+            return states.Wireframe();
+
+        return mesh.ccw ? states.CullCounterClockwise() : states.CullClockwise();
+    }
+
+    // ModelMesh::PrepareForRendering
+    void PrepareMesh(StateSetter& setter, const ModelMesh& mesh, const CommonStates& states, bool alpha, bool wireframe)
+    {
+        setter.SetBlendState(GetBlendState(mesh, states, alpha));
+        setter.SetDepthStencilState(GetDepthStencilState(states, alpha));
+        setter.SetRasterizerState(GetRasterizerState(mesh, states, wireframe));
+        setter.SetSamplers(states);
+    }
+
+    // ModelMeshPart::Draw up to the custom state hook
+    void PreparePart(StateSetter& setter, const ModelMeshPart& part, _In_ IEffect* ieffect, _In_opt_ ID3D11InputLayout* iinputLayout)
+    {
+        setter.SetInputLayout(iinputLayout);
+        setter.SetVertexBuffer(part.vertexBuffer.Get(), part.vertexStride);
+
+        // Note that if indexFormat is DXGI_FORMAT_R32_UINT, this model mesh part requires a Feature Level 9.2 or greater device
+        setter.SetIndexBuffer(part.indexBuffer.Get(), part.indexFormat);
+
+        assert(ieffect != nullptr);
+        setter.ApplyEffect(ieffect);
+    }
+}
+
 //--------------------------------------------------------------------------------------
 // ModelMeshPart
 //--------------------------------------------------------------------------------------
@@ -48,18 +185,9 @@ void ModelMeshPart::Draw(
     ID3D11InputLayout* iinputLayout,
     std::function<void()> setCustomState) const
 {
-    deviceContext->IASetInputLayout(iinputLayout);
-
-    auto vb = vertexBuffer.Get();
-    UINT vbStride = vertexStride;
-    UINT vbOffset = 0;
-    deviceContext->IASetVertexBuffers(0, 1, &vb, &vbStride, &vbOffset);
-
-    // Note that if indexFormat is DXGI_FORMAT_R32_UINT, this model mesh part requires a Feature Level 9.2 or greater device
-    deviceContext->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
-
-    assert(ieffect != nullptr);
-    ieffect->Apply(deviceContext);
+    size_t calls = 0;
+    StateSetter setter(deviceContext, calls);
+    PreparePart(setter, *this, ieffect, iinputLayout);
 
     // Hook lets the caller replace our shaders or state settings with whatever else they see fit.
     if (setCustomState)
@@ -68,7 +196,7 @@ void ModelMeshPart::Draw(
     }
 
     // Draw the primitive.
-    deviceContext->IASetPrimitiveTopology(primitiveType);
+    setter.SetPrimitiveTopology(primitiveType);
 
     deviceContext->DrawIndexed(indexCount, startIndex, vertexOffset);
 }
@@ -82,18 +210,9 @@ void ModelMeshPart::DrawInstanced(
     uint32_t instanceCount, uint32_t startInstanceLocation,
     std::function<void()> setCustomState) const
 {
-    deviceContext->IASetInputLayout(iinputLayout);
-
-    auto vb = vertexBuffer.Get();
-    UINT vbStride = vertexStride;
-    UINT vbOffset = 0;
-    deviceContext->IASetVertexBuffers(0, 1, &vb, &vbStride, &vbOffset);
-
-    // Note that if indexFormat is DXGI_FORMAT_R32_UINT, this model mesh part requires a Feature Level 9.2 or greater device
-    deviceContext->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
-
-    assert(ieffect != nullptr);
-    ieffect->Apply(deviceContext);
+    size_t calls = 0;
+    StateSetter setter(deviceContext, calls);
+    PreparePart(setter, *this, ieffect, iinputLayout);
 
     // Hook lets the caller replace our shaders or state settings with whatever else they see fit.
     if (setCustomState)
@@ -102,7 +221,7 @@ void ModelMeshPart::DrawInstanced(
     }
 
     // Draw the primitive.
-    deviceContext->IASetPrimitiveTopology(primitiveType);
+    setter.SetPrimitiveTopology(primitiveType);
 
     deviceContext->DrawIndexedInstanced(
         indexCount, instanceCount, startIndex,
@@ -180,46 +299,10 @@ void ModelMesh::PrepareForRendering(
 {
     assert(deviceContext != nullptr);
 
-    // Set the blend and depth stencil state.
-    ID3D11BlendState* blendState;
-    ID3D11DepthStencilState* depthStencilState;
-
-    if (alpha)
-    {
-        if (pmalpha)
-        {
-            blendState = states.AlphaBlend();
-            depthStencilState = states.DepthRead();
-        }
-        else
-        {
-            blendState = states.NonPremultiplied();
-            depthStencilState = states.DepthRead();
-        }
-    }
-    else
-    {
-        blendState = states.Opaque();
-        depthStencilState = states.DepthDefault();
-    }
-
-    deviceContext->OMSetBlendState(blendState, nullptr, 0xFFFFFFFF);
-    deviceContext->OMSetDepthStencilState(depthStencilState, 0);
-
-    // Set the rasterizer state.
-    if (wireframe)
-        deviceContext->RSSetState(states.Wireframe());
-    else
-        deviceContext->RSSetState(ccw ? states.CullCounterClockwise() : states.CullClockwise());
-
-    // Set sampler state.
-    ID3D11SamplerState* samplers[] =
-    {
-        states.LinearWrap(),
-        states.LinearWrap(),
-    };
-
-    deviceContext->PSSetSamplers(0, 2, samplers);
+    // Set the blend, depth stencil, rasterizer and sampler state.
+    size_t calls = 0;
+    StateSetter setter(deviceContext, calls);
+    PrepareMesh(setter, *this, states, alpha, wireframe);
 }
 
 
@@ -300,6 +383,243 @@ void XM_CALLCONV Model::Draw(
 }
 
 
+_Use_decl_annotations_
+void XM_CALLCONV Model::PrepareDrawList(ModelDrawList& list, FXMMATRIX world, CXMMATRIX view) const
+{
+    const auto worldIndex = static_cast<uint32_t>(list.mWorlds.size());
+    list.mWorlds.emplace_back();
+    XMStoreFloat4x4(&list.mWorlds.back(), world);
+
+    const XMMATRIX worldView = XMMatrixMultiply(world, view);
+
+    for (auto mit = meshes.cbegin(); mit != meshes.cend(); ++mit)
+    {
+        auto mesh = mit->get();
+        assert(mesh != nullptr);
+
+        // Alpha parts are ordered by the distance of their mesh from the eye, which does not
+        // depend on the handedness of the view
+        const XMVECTOR center = XMVector3Transform(XMLoadFloat3(&mesh->boundingSphere.Center), worldView);
+        const float viewDistance = XMVectorGetX(XMVector3Length(center));
+
+        for (auto it = mesh->meshParts.cbegin(); it != mesh->meshParts.cend(); ++it)
+        {
+            auto part = it->get();
+            assert(part != nullptr);
+
+            ModelDrawList::Item item = { part, mesh, worldIndex, viewDistance };
+            if (part->isAlpha)
+                list.mAlpha.push_back(item);
+            else
+                list.mOpaque.push_back(item);
+        }
+    }
+
+    list.mModels.push_back(this);
+
+    list.mSorted = false;
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV Model::Submit(
+    ID3D11DeviceContext* deviceContext,
+    const CommonStates& states,
+    ModelDrawList& list,
+    FXMMATRIX view,
+    CXMMATRIX projection,
+    bool wireframe,
+    std::function<void()> setCustomState)
+{
+    assert(deviceContext != nullptr);
+
+    if (!list.mSorted)
+    {
+        std::less<const void*> before;
+
+        std::stable_sort(list.mOpaque.begin(), list.mOpaque.end(),
+            [&before](const ModelDrawList::Item& a, const ModelDrawList::Item& b)
+            {
+                if (a.mesh->ccw != b.mesh->ccw)
+                    return a.mesh->ccw;
+                if (a.part->effect.get() != b.part->effect.get())
+                    return before(a.part->effect.get(), b.part->effect.get());
+                if (a.part->inputLayout.Get() != b.part->inputLayout.Get())
+                    return before(a.part->inputLayout.Get(), b.part->inputLayout.Get());
+                if (a.part->vertexBuffer.Get() != b.part->vertexBuffer.Get())
+                    return before(a.part->vertexBuffer.Get(), b.part->vertexBuffer.Get());
+                if (a.part->indexBuffer.Get() != b.part->indexBuffer.Get())
+                    return before(a.part->indexBuffer.Get(), b.part->indexBuffer.Get());
+                return a.worldIndex < b.worldIndex;
+            });
+
+        std::stable_sort(list.mAlpha.begin(), list.mAlpha.end(),
+            [](const ModelDrawList::Item& a, const ModelDrawList::Item& b)
+            {
+                return a.viewDistance > b.viewDistance;
+            });
+
+        // Replays what Model::Draw calls for each model through a setter with no context,
+        // so the baseline counts the same calls that the state changes below count
+        list.mBaseline = 0;
+        StateSetter baseline(nullptr, list.mBaseline);
+        for (auto model : list.mModels)
+        {
+            for (bool alpha : { false, true })
+            {
+                for (auto mit = model->meshes.cbegin(); mit != model->meshes.cend(); ++mit)
+                {
+                    auto mesh = mit->get();
+                    PrepareMesh(baseline, *mesh, states, alpha, wireframe);
+
+                    for (auto it = mesh->meshParts.cbegin(); it != mesh->meshParts.cend(); ++it)
+                    {
+                        auto part = it->get();
+                        if (part->isAlpha != alpha)
+                            continue;
+
+                        PreparePart(baseline, *part, part->effect.get(), part->inputLayout.Get());
+                        baseline.SetPrimitiveTopology(part->primitiveType);
+                    }
+                }
+            }
+        }
+
+        list.mSorted = true;
+    }
+
+    list.mStats = {};
+    list.mStats.baselineStateChanges = list.mBaseline;
+    StateSetter setter(deviceContext, list.mStats.stateChanges);
+
+    // Everything the last part set; null means unknown
+    ID3D11BlendState* currentBlend = nullptr;
+    ID3D11DepthStencilState* currentDepth = nullptr;
+    ID3D11RasterizerState* currentRasterizer = nullptr;
+    ID3D11InputLayout* currentLayout = nullptr;
+    ID3D11Buffer* currentVB = nullptr;
+    UINT currentStride = 0;
+    ID3D11Buffer* currentIB = nullptr;
+    DXGI_FORMAT currentFormat = DXGI_FORMAT_UNKNOWN;
+    D3D_PRIMITIVE_TOPOLOGY currentTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    IEffect* currentEffect = nullptr;
+    uint32_t currentWorld = UINT32_MAX;
+
+    setter.SetSamplers(states);
+
+    auto drawItems = [&](const std::vector<ModelDrawList::Item>& items, bool alpha)
+    {
+        for (auto& item : items)
+        {
+            auto mesh = item.mesh;
+            auto part = item.part;
+
+            // Same choices as ModelMesh::PrepareForRendering
+            ID3D11BlendState* blendState = GetBlendState(*mesh, states, alpha);
+            ID3D11DepthStencilState* depthStencilState = GetDepthStencilState(states, alpha);
+            ID3D11RasterizerState* rasterizerState = GetRasterizerState(*mesh, states, wireframe);
+
+            if (blendState != currentBlend)
+            {
+                setter.SetBlendState(blendState);
+                currentBlend = blendState;
+            }
+
+            if (depthStencilState != currentDepth)
+            {
+                setter.SetDepthStencilState(depthStencilState);
+                currentDepth = depthStencilState;
+            }
+
+            if (rasterizerState != currentRasterizer)
+            {
+                setter.SetRasterizerState(rasterizerState);
+                currentRasterizer = rasterizerState;
+            }
+
+            if (part->inputLayout.Get() != currentLayout)
+            {
+                currentLayout = part->inputLayout.Get();
+                setter.SetInputLayout(currentLayout);
+            }
+
+            if (part->vertexBuffer.Get() != currentVB || part->vertexStride != currentStride)
+            {
+                currentVB = part->vertexBuffer.Get();
+                currentStride = part->vertexStride;
+                setter.SetVertexBuffer(currentVB, currentStride);
+            }
+
+            if (part->indexBuffer.Get() != currentIB || part->indexFormat != currentFormat)
+            {
+                currentIB = part->indexBuffer.Get();
+                currentFormat = part->indexFormat;
+                setter.SetIndexBuffer(currentIB, currentFormat);
+            }
+
+            // Effects hold the world matrix, so they are applied again when either changes
+            auto effect = part->effect.get();
+            assert(effect != nullptr);
+            if (effect != currentEffect || item.worldIndex != currentWorld)
+            {
+                auto imatrices = dynamic_cast<IEffectMatrices*>(effect);
+                if (imatrices)
+                {
+                    imatrices->SetMatrices(XMLoadFloat4x4(&list.mWorlds[item.worldIndex]), view, projection);
+                }
+
+                setter.ApplyEffect(effect);
+                currentEffect = effect;
+                currentWorld = item.worldIndex;
+            }
+
+            // The hook may change anything, so nothing set before it can be trusted afterwards
+            if (setCustomState)
+            {
+                setCustomState();
+
+                currentBlend = nullptr;
+                currentDepth = nullptr;
+                currentRasterizer = nullptr;
+                currentLayout = nullptr;
+                currentVB = nullptr;
+                currentIB = nullptr;
+                currentTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+                currentEffect = nullptr;
+            }
+
+            if (part->primitiveType != currentTopology)
+            {
+                currentTopology = part->primitiveType;
+                setter.SetPrimitiveTopology(currentTopology);
+            }
+
+            deviceContext->DrawIndexed(part->indexCount, part->startIndex, part->vertexOffset);
+            ++list.mStats.draws;
+        }
+    };
+
+    drawItems(list.mOpaque, false);
+    drawItems(list.mAlpha, true);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelDrawList
+//--------------------------------------------------------------------------------------
+
+void ModelDrawList::Clear() noexcept
+{
+    mOpaque.clear();
+    mAlpha.clear();
+    mWorlds.clear();
+    mModels.clear();
+    mSorted = true;
+    mBaseline = 0;
+    mStats = {};
+}
+
+
 void Model::UpdateEffects(_In_ std::function<void(IEffect*)> setEffect)
 {
     if (mEffectCache.empty())
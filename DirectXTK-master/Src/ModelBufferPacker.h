@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// File: ModelBufferPacker.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+#include "DirectXHelpers.h"
+#include "Model.h"
+#include "PlatformHelpers.h"
+
+
+namespace DirectX
+{
+    // Builds the vertex and index buffers of one model, optionally packing the small ones into
+    // shared buffers (ModelLoader_PackSmallBuffers). Unpacked data gets its own buffer created
+    // straight from the caller's memory. Packed data is copied into an arena per element size
+    // and bind flag; the arenas become buffers in Finalize, which is also when the mesh parts
+    // bound to packed ranges get their buffer pointers.
+    class ModelBufferPacker
+    {
+    public:
+        // Buffers at or below this size are packed, bigger ones are not worth the copy
+        static constexpr size_t MaxPackedBytes = 64 * 1024;
+        static constexpr size_t MaxArenaBytes = 4 * 1024 * 1024;
+
+        static constexpr size_t c_Unpacked = size_t(-1);
+
+        struct Range
+        {
+            Range() noexcept : arena(c_Unpacked), elementOffset(0) {}
+
+            Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;    // Null until Finalize when packed
+            size_t arena;
+            uint32_t elementOffset;                         // In elements (vertices or indices)
+        };
+
+        ModelBufferPacker(_In_ ID3D11Device* device, bool pack) noexcept :
+            mDevice(device),
+            mPack(pack)
+        {
+        }
+
+        ModelBufferPacker(ModelBufferPacker const&) = delete;
+        ModelBufferPacker& operator= (ModelBufferPacker const&) = delete;
+
+        Range Add(_In_reads_bytes_(bytes) const void* data, size_t bytes, uint32_t elementSize, D3D11_BIND_FLAG bindFlags)
+        {
+            Range range;
+
+            if (!mPack || !elementSize || bytes > MaxPackedBytes || (bytes % elementSize) != 0)
+            {
+                D3D11_BUFFER_DESC desc = {};
+                desc.Usage = D3D11_USAGE_DEFAULT;
+                desc.ByteWidth = static_cast<UINT>(bytes);
+                desc.BindFlags = static_cast<UINT>(bindFlags);
+
+                D3D11_SUBRESOURCE_DATA initData = { data, 0, 0 };
+
+                ThrowIfFailed(
+                    mDevice->CreateBuffer(&desc, &initData, range.buffer.GetAddressOf())
+                );
+
+                return range;
+            }
+
+            size_t index = 0;
+            for (; index < mArenas.size(); ++index)
+            {
+                auto& arena = mArenas[index];
+                if (arena.elementSize == elementSize
+                    && arena.bindFlags == bindFlags
+                    && (arena.data.size() + bytes) <= MaxArenaBytes)
+                    break;
+            }
+
+            if (index == mArenas.size())
+            {
+                mArenas.emplace_back();
+                mArenas.back().elementSize = elementSize;
+                mArenas.back().bindFlags = bindFlags;
+            }
+
+            auto& arena = mArenas[index];
+            range.arena = index;
+            range.elementOffset = static_cast<uint32_t>(arena.data.size() / elementSize);
+
+            auto src = static_cast<const uint8_t*>(data);
+            arena.data.insert(arena.data.end(), src, src + bytes);
+
+            return range;
+        }
+
+        // Points the part at its vertex and index ranges. startIndex and vertexOffset must
+        // already hold the values relative to the original buffers.
+        void Bind(_In_ ModelMeshPart* part, const Range& vertices, const Range& indices)
+        {
+            part->vertexBuffer = vertices.buffer;
+            part->indexBuffer = indices.buffer;
+            part->vertexOffset += static_cast<int32_t>(vertices.elementOffset);
+            part->startIndex += indices.elementOffset;
+
+            if (vertices.arena != c_Unpacked || indices.arena != c_Unpacked)
+            {
+                mPendingParts.push_back({ part, vertices.arena, indices.arena });
+            }
+        }
+
+        void Finalize()
+        {
+            for (auto& arena : mArenas)
+            {
+                D3D11_BUFFER_DESC desc = {};
+                desc.Usage = D3D11_USAGE_DEFAULT;
+                desc.ByteWidth = static_cast<UINT>(arena.data.size());
+                desc.BindFlags = static_cast<UINT>(arena.bindFlags);
+
+                D3D11_SUBRESOURCE_DATA initData = { arena.data.data(), 0, 0 };
+
+                ThrowIfFailed(
+                    mDevice->CreateBuffer(&desc, &initData, arena.buffer.GetAddressOf())
+                );
+
+                SetDebugObjectName(arena.buffer.Get(), "ModelPacked");
+
+                // The arena copy is no longer needed once the buffer exists
+                std::vector<uint8_t>().swap(arena.data);
+            }
+
+            for (auto& pending : mPendingParts)
+            {
+                if (pending.vertexArena != c_Unpacked)
+                    pending.part->vertexBuffer = mArenas[pending.vertexArena].buffer;
+                if (pending.indexArena != c_Unpacked)
+                    pending.part->indexBuffer = mArenas[pending.indexArena].buffer;
+            }
+
+            mPendingParts.clear();
+        }
+
+    private:
+        struct Arena
+        {
+            uint32_t                                elementSize;
+            D3D11_BIND_FLAG                         bindFlags;
+            std::vector<uint8_t>                    data;
+            Microsoft::WRL::ComPtr<ID3D11Buffer>    buffer;
+        };
+
+        struct PendingPart
+        {
+            ModelMeshPart*  part;
+            size_t          vertexArena;
+            size_t          indexArena;
+        };
+
+        ID3D11Device*               mDevice;
+        bool                        mPack;
+        std::vector<Arena>          mArenas;
+        std::vector<PendingPart>    mPendingParts;
+    };
+}
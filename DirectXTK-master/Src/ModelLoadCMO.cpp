@@ -15,6 +15,7 @@
 #include "VertexTypes.h"
 #include "BinaryReader.h"
 #include "PlatformHelpers.h"
+#include "ModelBufferPacker.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -235,6 +236,110 @@ namespace
         return TRUE;
     }
 
+    // Decomposes CMO keyframes into per-bone tracks. Clips with the same name from several meshes are merged.
+    void AddAnimationClip(
+        ModelAnimationClip::Collection& animations,
+        const std::wstring& name,
+        const VSD3DStarter::Clip& clip,
+        _In_reads_(clip.keys) const VSD3DStarter::Keyframe* keys,
+        uint32_t boneBase,
+        uint32_t boneCount)
+    {
+        auto anim = std::find_if(animations.begin(), animations.end(),
+            [&](const ModelAnimationClip& a) { return a.name == name; });
+
+        if (anim == animations.end())
+        {
+            animations.emplace_back();
+            anim = animations.end() - 1;
+            anim->name = name;
+            anim->startTime = clip.StartTime;
+            anim->endTime = clip.EndTime;
+        }
+        else
+        {
+            anim->startTime = std::min(anim->startTime, clip.StartTime);
+            anim->endTime = std::max(anim->endTime, clip.EndTime);
+        }
+
+        // Keyframes are stored in time order with bones interleaved
+        std::vector<uint32_t> order(clip.keys);
+        for (uint32_t k = 0; k < clip.keys; ++k)
+        {
+            order[k] = k;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [keys](uint32_t a, uint32_t b)
+            {
+                if (keys[a].BoneIndex != keys[b].BoneIndex)
+                    return keys[a].BoneIndex < keys[b].BoneIndex;
+                return keys[a].Time < keys[b].Time;
+            });
+
+        anim->keyTimes.reserve(anim->keyTimes.size() + clip.keys);
+        anim->keyRotations.reserve(anim->keyRotations.size() + clip.keys);
+        anim->keyTranslations.reserve(anim->keyTranslations.size() + clip.keys);
+        anim->keyScales.reserve(anim->keyScales.size() + clip.keys);
+
+        size_t k = 0;
+        while (k < order.size())
+        {
+            const UINT boneIndex = keys[order[k]].BoneIndex;
+            if (boneIndex >= boneCount)
+                throw std::out_of_range("Invalid keyframe bone index\n");
+
+            ModelAnimationClip::Track track = {};
+            track.boneIndex = boneBase + boneIndex;
+            track.firstKey = static_cast<uint32_t>(anim->keyTimes.size());
+
+            XMVECTOR prevRotation = XMQuaternionIdentity();
+            for (; k < order.size() && keys[order[k]].BoneIndex == boneIndex; ++k)
+            {
+                auto& key = keys[order[k]];
+
+                XMMATRIX transform = XMLoadFloat4x4(&key.Transform);
+
+                XMVECTOR scale, rotation, translation;
+                if (!XMMatrixDecompose(&scale, &rotation, &translation, transform))
+                {
+                    // Degenerate scale, keep the position and drop the rotation
+                    scale = XMVectorSet(
+                        XMVectorGetX(XMVector3Length(transform.r[0])),
+                        XMVectorGetX(XMVector3Length(transform.r[1])),
+                        XMVectorGetX(XMVector3Length(transform.r[2])),
+                        0.f);
+                    rotation = XMQuaternionIdentity();
+                    translation = transform.r[3];
+                }
+
+                // Keep neighboring keys in the same hemisphere so interpolation takes the short arc
+                if (track.keyCount > 0 && XMVectorGetX(XMVector4Dot(prevRotation, rotation)) < 0.f)
+                {
+                    rotation = XMVectorNegate(rotation);
+                }
+                prevRotation = rotation;
+
+                anim->keyTimes.push_back(key.Time);
+
+                XMFLOAT4 r;
+                XMStoreFloat4(&r, rotation);
+                anim->keyRotations.push_back(r);
+
+                XMFLOAT3 t;
+                XMStoreFloat3(&t, translation);
+                anim->keyTranslations.push_back(t);
+
+                XMFLOAT3 sc;
+                XMStoreFloat3(&sc, scale);
+                anim->keyScales.push_back(sc);
+
+                ++track.keyCount;
+            }
+
+            anim->tracks.push_back(track);
+        }
+    }
+
     inline XMFLOAT3 GetMaterialColor(float r, float g, float b, bool srgb)
     {
         if (srgb)
@@ -284,6 +389,8 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
 
     auto model = std::make_unique<Model>();
 
+    ModelBufferPacker packer(device, (flags & ModelLoader_PackSmallBuffers) != 0);
+
     for (UINT meshIndex = 0; meshIndex < *nMesh; ++meshIndex)
     {
         // Mesh name
@@ -419,7 +526,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
         std::vector<IBData> ibData;
         ibData.reserve(*nIBs);
 
-        std::vector<ComPtr<ID3D11Buffer>> ibs;
+        std::vector<ModelBufferPacker::Range> ibs;
         ibs.resize(*nIBs);
 
         for (UINT j = 0; j < *nIBs; ++j)
@@ -455,18 +562,12 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
             ib.ptr = indexes;
             ibData.emplace_back(ib);
 
-            D3D11_BUFFER_DESC desc = {};
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.ByteWidth = static_cast<UINT>(ibBytes);
-            desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-            D3D11_SUBRESOURCE_DATA initData = { indexes, 0, 0 };
+            ibs[j] = packer.Add(indexes, ibBytes, sizeof(USHORT), D3D11_BIND_INDEX_BUFFER);
 
-            ThrowIfFailed(
-                device->CreateBuffer(&desc, &initData, &ibs[j])
-            );
-
-            SetDebugObjectName(ibs[j].Get(), "ModelCMO");
+            if (ibs[j].buffer)
+            {
+                SetDebugObjectName(ibs[j].buffer.Get(), "ModelCMO");
+            }
         }
 
         assert(ibData.size() == *nIBs);
@@ -566,10 +667,11 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
         XMVECTOR max = XMVectorSet(extents->MaxX, extents->MaxY, extents->MaxZ, 0.f);
         BoundingBox::CreateFromPoints(mesh->boundingBox, min, max);
 
-    #if 0
-            // Animation data
+        // Animation data
         if (*bSkeleton)
         {
+            const bool includeBones = (flags & ModelLoader_IncludeBones) != 0;
+
             // Bones
             auto nBones = reinterpret_cast<const UINT*>(meshData + usedSize);
             usedSize += sizeof(UINT);
@@ -579,6 +681,9 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
             if (!*nBones)
                 throw std::runtime_error("Animation bone data is missing\n");
 
+            // Each mesh has its own skeleton, they are appended to the model's bone collection
+            const auto boneBase = static_cast<uint32_t>(model->bones.size());
+
             for (UINT j = 0; j < *nBones; ++j)
             {
                 // Bone name
@@ -593,17 +698,29 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
                 if (dataSize < usedSize)
                     throw std::runtime_error("End of file");
 
-                // TODO - What to do with bone name?
-                boneName;
-
                 // Bone settings
                 auto bones = reinterpret_cast<const VSD3DStarter::Bone*>(meshData + usedSize);
                 usedSize += sizeof(VSD3DStarter::Bone);
                 if (dataSize < usedSize)
                     throw std::runtime_error("End of file");
 
-                // TODO - What to do with bone data?
-                bones;
+                if (includeBones)
+                {
+                    ModelBone bone;
+                    bone.name.assign(boneName, *nName);
+                    if (bones->ParentIndex >= 0)
+                    {
+                        if (static_cast<UINT>(bones->ParentIndex) >= *nBones)
+                            throw std::out_of_range("Invalid bone parent index\n");
+
+                        bone.parentIndex = boneBase + static_cast<uint32_t>(bones->ParentIndex);
+                    }
+                    bone.localTransform = bones->LocalTransform;
+                    bone.invBindPose = bones->InvBindPos;
+                    model->bones.emplace_back(std::move(bone));
+
+                    mesh->boneInfluences.push_back(boneBase + j);
+                }
             }
 
             // Animation Clips
@@ -626,9 +743,6 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
                 if (dataSize < usedSize)
                     throw std::runtime_error("End of file");
 
-                // TODO - What to do with clip name?
-                clipName;
-
                 auto clip = reinterpret_cast<const VSD3DStarter::Clip*>(meshData + usedSize);
                 usedSize += sizeof(VSD3DStarter::Clip);
                 if (dataSize < usedSize)
@@ -642,18 +756,17 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
                 if (dataSize < usedSize)
                     throw std::runtime_error("End of file");
 
-                // TODO - What to do with keys and clip->StartTime, clip->EndTime?
-                keys;
+                if (includeBones)
+                {
+                    AddAnimationClip(model->animations, std::wstring(clipName, *nName), *clip, keys, boneBase, *nBones);
+                }
             }
         }
-    #else
-        UNREFERENCED_PARAMETER(bSkeleton);
-    #endif
 
         bool enableSkinning = (*nSkinVBs) != 0;
 
         // Build vertex buffers
-        std::vector<ComPtr<ID3D11Buffer>> vbs;
+        std::vector<ModelBufferPacker::Range> vbs;
         vbs.resize(*nVBs);
 
         const size_t stride = enableSkinning ? sizeof(VertexPositionNormalTangentColorTextureSkinning)
@@ -676,19 +789,10 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
 
             size_t bytes = static_cast<size_t>(sizeInBytes);
 
-            D3D11_BUFFER_DESC desc = {};
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.ByteWidth = static_cast<UINT>(bytes);
-            desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
             if (fxFactoryDGSL && !enableSkinning)
             {
                 // Can use CMO vertex data directly
-                D3D11_SUBRESOURCE_DATA initData = { vbData[j].ptr, 0, 0 };
-
-                ThrowIfFailed(
-                    device->CreateBuffer(&desc, &initData, &vbs[j])
-                );
+                vbs[j] = packer.Add(vbData[j].ptr, bytes, static_cast<uint32_t>(stride), D3D11_BIND_VERTEX_BUFFER);
             }
             else
             {
@@ -784,14 +888,13 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
                 }
 
                 // Create vertex buffer from temporary buffer
-                D3D11_SUBRESOURCE_DATA initData = { temp.get(), 0, 0 };
-
-                ThrowIfFailed(
-                    device->CreateBuffer(&desc, &initData, &vbs[j])
-                );
+                vbs[j] = packer.Add(temp.get(), bytes, static_cast<uint32_t>(stride), D3D11_BIND_VERTEX_BUFFER);
             }
 
-            SetDebugObjectName(vbs[j].Get(), "ModelCMO");
+            if (vbs[j].buffer)
+            {
+                SetDebugObjectName(vbs[j].buffer.Get(), "ModelCMO");
+            }
         }
 
         assert(vbs.size() == *nVBs);
@@ -873,10 +976,9 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
             part->startIndex = sm.StartIndex;
             part->vertexStride = static_cast<UINT>(stride);
             part->inputLayout = mat.il;
-            part->indexBuffer = ibs[sm.IndexBufferIndex];
-            part->vertexBuffer = vbs[sm.VertexBufferIndex];
             part->effect = mat.effect;
             part->vbDecl = enableSkinning ? g_vbdeclSkinning : g_vbdecl;
+            packer.Bind(part, vbs[sm.VertexBufferIndex], ibs[sm.IndexBufferIndex]);
 
             mesh->meshParts.emplace_back(part);
         }
@@ -884,6 +986,8 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
         model->meshes.emplace_back(mesh);
     }
 
+    packer.Finalize();
+
     return model;
 }
 
@@ -896,9 +1000,9 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
     IEffectFactory& fxFactory,
     ModelLoaderFlags flags)
 {
-    size_t dataSize = 0;
-    std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    // Buffers are created straight from the mapped file
+    MappedFile file;
+    HRESULT hr = file.Open(szFileName);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: CreateFromCMO failed (%08X) loading '%ls'\n",
@@ -906,7 +1010,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO(
         throw std::runtime_error("CreateFromCMO");
     }
 
-    auto model = CreateFromCMO(device, data.get(), dataSize, fxFactory, flags);
+    auto model = CreateFromCMO(device, file.GetData(), file.GetSize(), fxFactory, flags);
 
     model->name = szFileName;
 
@@ -14,6 +14,7 @@
 #include "VertexTypes.h"
 #include "BinaryReader.h"
 #include "PlatformHelpers.h"
+#include "ModelBufferPacker.h"
 #include "SDKMesh.h"
 
 using namespace DirectX;
@@ -475,8 +476,10 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
         throw std::runtime_error("End of file");
     const uint8_t* bufferData = meshData + bufferDataOffset;
 
+    ModelBufferPacker packer(d3dDevice, (flags & ModelLoader_PackSmallBuffers) != 0);
+
     // Create vertex buffers
-    std::vector<ComPtr<ID3D11Buffer>> vbs;
+    std::vector<ModelBufferPacker::Range> vbs;
     vbs.resize(header->NumVertexBuffers);
 
     std::vector<std::shared_ptr<std::vector<D3D11_INPUT_ELEMENT_DESC>>> vbDecls;
@@ -524,18 +527,12 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
 
         auto verts = bufferData + (vh.DataOffset - bufferDataOffset);
 
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.ByteWidth = static_cast<UINT>(vh.SizeBytes);
-        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-        D3D11_SUBRESOURCE_DATA initData = { verts, 0, 0 };
-
-        ThrowIfFailed(
-            d3dDevice->CreateBuffer(&desc, &initData, &vbs[j])
-        );
+        vbs[j] = packer.Add(verts, static_cast<size_t>(vh.SizeBytes), static_cast<uint32_t>(vh.StrideBytes), D3D11_BIND_VERTEX_BUFFER);
 
-        SetDebugObjectName(vbs[j].Get(), "ModelSDKMESH");
+        if (vbs[j].buffer)
+        {
+            SetDebugObjectName(vbs[j].buffer.Get(), "ModelSDKMESH");
+        }
     }
 
     if (dec3nwarning)
@@ -545,7 +542,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
     }
 
     // Create index buffers
-    std::vector<ComPtr<ID3D11Buffer>> ibs;
+    std::vector<ModelBufferPacker::Range> ibs;
     ibs.resize(header->NumIndexBuffers);
 
     for (UINT j = 0; j < header->NumIndexBuffers; ++j)
@@ -570,18 +567,13 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
 
         auto indices = bufferData + (ih.DataOffset - bufferDataOffset);
 
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.ByteWidth = static_cast<UINT>(ih.SizeBytes);
-        desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        const uint32_t indexSize = (ih.IndexType == DXUT::IT_32BIT) ? sizeof(uint32_t) : sizeof(uint16_t);
+        ibs[j] = packer.Add(indices, static_cast<size_t>(ih.SizeBytes), indexSize, D3D11_BIND_INDEX_BUFFER);
 
-        D3D11_SUBRESOURCE_DATA initData = { indices, 0, 0 };
-
-        ThrowIfFailed(
-            d3dDevice->CreateBuffer(&desc, &initData, &ibs[j])
-        );
-
-        SetDebugObjectName(ibs[j].Get(), "ModelSDKMESH");
+        if (ibs[j].buffer)
+        {
+            SetDebugObjectName(ibs[j].buffer.Get(), "ModelSDKMESH");
+        }
     }
 
     // Create meshes
@@ -707,10 +699,9 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
             part->indexFormat = (ibArray[mh.IndexBuffer].IndexType == DXUT::IT_32BIT) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
             part->primitiveType = primType;
             part->inputLayout = il;
-            part->indexBuffer = ibs[mh.IndexBuffer];
-            part->vertexBuffer = vbs[mh.VertexBuffers[0]];
             part->effect = mat.effect;
             part->vbDecl = vbDecls[mh.VertexBuffers[0]];
+            packer.Bind(part, vbs[mh.VertexBuffers[0]], ibs[mh.IndexBuffer]);
 
             mesh->meshParts.emplace_back(part);
         }
@@ -718,6 +709,8 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
         model->meshes.emplace_back(mesh);
     }
 
+    packer.Finalize();
+
     return model;
 }
 
@@ -730,9 +723,9 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
     IEffectFactory& fxFactory,
     ModelLoaderFlags flags)
 {
-    size_t dataSize = 0;
-    std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    // Buffers are created straight from the mapped file
+    MappedFile file;
+    HRESULT hr = file.Open(szFileName);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: CreateFromSDKMESH failed (%08X) loading '%ls'\n",
@@ -740,7 +733,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH(
         throw std::runtime_error("CreateFromSDKMESH");
     }
 
-    auto model = CreateFromSDKMESH(device, data.get(), dataSize, fxFactory, flags);
+    auto model = CreateFromSDKMESH(device, file.GetData(), file.GetSize(), fxFactory, flags);
 
     model->name = szFileName;
 
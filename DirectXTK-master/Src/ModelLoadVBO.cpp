@@ -184,9 +184,9 @@ std::unique_ptr<Model> DirectX::Model::CreateFromVBO(
     std::shared_ptr<IEffect> ieffect,
     ModelLoaderFlags flags)
 {
-    size_t dataSize = 0;
-    std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    // Buffers are created straight from the mapped file
+    MappedFile file;
+    HRESULT hr = file.Open(szFileName);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: CreateFromVBO failed (%08X) loading '%ls'\n",
@@ -194,7 +194,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromVBO(
         throw std::runtime_error("CreateFromVBO");
     }
 
-    auto model = CreateFromVBO(device, data.get(), dataSize, ieffect, flags);
+    auto model = CreateFromVBO(device, file.GetData(), file.GetSize(), ieffect, flags);
 
     model->name = szFileName;
 
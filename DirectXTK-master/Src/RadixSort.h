@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// File: RadixSort.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+
+namespace DirectX
+{
+    namespace RadixSort
+    {
+        // Items are packed as (key << 32) | payload, so the payload (typically an index into
+        // the caller's array) travels with its key through every pass.
+        inline uint64_t MakeItem(uint32_t key, uint32_t payload) noexcept
+        {
+            return (uint64_t(key) << 32) | payload;
+        }
+
+        inline uint32_t GetPayload(uint64_t item) noexcept
+        {
+            return static_cast<uint32_t>(item);
+        }
+
+        // Maps float bits to a key that sorts in the same order as the float values.
+        inline uint32_t FloatKey(float value) noexcept
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+
+            // Negative values have every bit flipped so more negative sorts first, positive
+            // values only the sign so they sort after all negatives.
+            const uint32_t mask = static_cast<uint32_t>(-static_cast<int32_t>(bits >> 31)) | 0x80000000u;
+            return bits ^ mask;
+        }
+
+        // Stable LSD radix sort of count items by their upper 32 bits, one pass per key byte.
+        // count must fit in 32 bits and scratch must hold count items. Passes where every key
+        // has the same byte are skipped, so keys that only differ in their low bytes take few
+        // passes. Returns whichever of items or scratch holds the sorted result.
+        inline uint64_t* SortByKey(_Inout_updates_(count) uint64_t* items, _Out_writes_(count) uint64_t* scratch, size_t count) noexcept
+        {
+            if (!count)
+                return items;
+
+            uint32_t histograms[4][256] = {};
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto key = static_cast<uint32_t>(items[i] >> 32);
+
+                ++histograms[0][key & 0xff];
+                ++histograms[1][(key >> 8) & 0xff];
+                ++histograms[2][(key >> 16) & 0xff];
+                ++histograms[3][key >> 24];
+            }
+
+            uint64_t* src = items;
+            uint64_t* dst = scratch;
+
+            for (unsigned int pass = 0; pass < 4; ++pass)
+            {
+                uint32_t* histogram = histograms[pass];
+                const unsigned int shift = 32 + pass * 8;
+
+                if (histogram[(src[0] >> shift) & 0xff] == count)
+                    continue;
+
+                // Turn the counts into starting offsets.
+                uint32_t offset = 0;
+                for (size_t digit = 0; digit < 256; ++digit)
+                {
+                    const uint32_t digitCount = histogram[digit];
+                    histogram[digit] = offset;
+                    offset += digitCount;
+                }
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const uint64_t item = src[i];
+                    dst[histogram[(item >> shift) & 0xff]++] = item;
+                }
+
+                std::swap(src, dst);
+            }
+
+            return src;
+        }
+    }
+}
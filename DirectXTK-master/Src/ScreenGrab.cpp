@@ -170,20 +170,13 @@ namespace
 
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-HRESULT DirectX::SaveDDSTextureToFile(
-    ID3D11DeviceContext* pContext,
-    ID3D11Resource* pSource,
+HRESULT DirectX::SaveDDSImageToFile(
+    const ScreenGrabImage& image,
     const wchar_t* fileName) noexcept
 {
-    if (!fileName)
+    if (!fileName || !image.pixels || !image.width || !image.height)
         return E_INVALIDARG;
 
-    D3D11_TEXTURE2D_DESC desc = {};
-    ComPtr<ID3D11Texture2D> pStaging;
-    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
-    if (FAILED(hr))
-        return hr;
-
     // Create file
 #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
     ScopedHandle hFile(safe_handle(CreateFile2(fileName,
@@ -197,6 +190,11 @@ HRESULT DirectX::SaveDDSTextureToFile(
 
     auto_delete_file delonfail(hFile.get());
 
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = image.width;
+    desc.Height = image.height;
+    desc.Format = image.format;
+
     // Setup header
     const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
     uint8_t fileHeader[MAX_HEADER_SIZE] = {};
@@ -270,7 +268,7 @@ HRESULT DirectX::SaveDDSTextureToFile(
     }
 
     size_t rowPitch, slicePitch, rowCount;
-    hr = GetSurfaceInfo(desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
+    HRESULT hr = GetSurfaceInfo(desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
     if (FAILED(hr))
         return hr;
 
@@ -288,34 +286,29 @@ HRESULT DirectX::SaveDDSTextureToFile(
         header->pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
     }
 
-    // Setup pixels
-    std::unique_ptr<uint8_t[]> pixels(new (std::nothrow) uint8_t[slicePitch]);
-    if (!pixels)
-        return E_OUTOFMEMORY;
-
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
-    if (FAILED(hr))
-        return hr;
-
-    auto sptr = static_cast<const uint8_t*>(mapped.pData);
-    if (!sptr)
+    // Setup pixels, rows are packed only when the source pitch has padding
+    std::unique_ptr<uint8_t[]> pixels;
+    const uint8_t* packed = image.pixels;
+    if (image.rowPitch != rowPitch)
     {
-        pContext->Unmap(pStaging.Get(), 0);
-        return E_POINTER;
-    }
+        if (image.rowPitch < rowPitch)
+            return E_INVALIDARG;
 
-    uint8_t* dptr = pixels.get();
+        pixels.reset(new (std::nothrow) uint8_t[slicePitch]);
+        if (!pixels)
+            return E_OUTOFMEMORY;
 
-    size_t msize = std::min<size_t>(rowPitch, mapped.RowPitch);
-    for (size_t h = 0; h < rowCount; ++h)
-    {
-        memcpy(dptr, sptr, msize);
-        sptr += mapped.RowPitch;
-        dptr += rowPitch;
-    }
+        auto sptr = image.pixels;
+        uint8_t* dptr = pixels.get();
+        for (size_t h = 0; h < rowCount; ++h)
+        {
+            memcpy(dptr, sptr, rowPitch);
+            sptr += image.rowPitch;
+            dptr += rowPitch;
+        }
 
-    pContext->Unmap(pStaging.Get(), 0);
+        packed = pixels.get();
+    }
 
     // Write header & pixels
     DWORD bytesWritten;
@@ -325,7 +318,7 @@ HRESULT DirectX::SaveDDSTextureToFile(
     if (bytesWritten != headerSize)
         return E_FAIL;
 
-    if (!WriteFile(hFile.get(), pixels.get(), static_cast<DWORD>(slicePitch), &bytesWritten, nullptr))
+    if (!WriteFile(hFile.get(), packed, static_cast<DWORD>(slicePitch), &bytesWritten, nullptr))
         return HRESULT_FROM_WIN32(GetLastError());
 
     if (bytesWritten != slicePitch)
@@ -336,6 +329,41 @@ HRESULT DirectX::SaveDDSTextureToFile(
     return S_OK;
 }
 
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveDDSTextureToFile(
+    ID3D11DeviceContext* pContext,
+    ID3D11Resource* pSource,
+    const wchar_t* fileName) noexcept
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    ComPtr<ID3D11Texture2D> pStaging;
+    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr))
+        return hr;
+
+    if (!mapped.pData)
+    {
+        pContext->Unmap(pStaging.Get(), 0);
+        return E_POINTER;
+    }
+
+    const ScreenGrabImage image = { desc.Format, desc.Width, desc.Height, mapped.RowPitch, static_cast<const uint8_t*>(mapped.pData) };
+    hr = SaveDDSImageToFile(image, fileName);
+
+    pContext->Unmap(pStaging.Get(), 0);
+
+    return hr;
+}
+
 //--------------------------------------------------------------------------------------
 namespace DirectX
 {
@@ -344,23 +372,21 @@ namespace DirectX
 }
 
 _Use_decl_annotations_
-HRESULT DirectX::SaveWICTextureToFile(
-    ID3D11DeviceContext* pContext,
-    ID3D11Resource* pSource,
+HRESULT DirectX::SaveWICImageToFile(
+    const ScreenGrabImage& image,
     REFGUID guidContainerFormat,
     const wchar_t* fileName,
     const GUID* targetFormat,
     std::function<void(IPropertyBag2*)> setCustomProps,
     bool forceSRGB)
 {
-    if (!fileName)
+    if (!fileName || !image.pixels || !image.width || !image.height)
         return E_INVALIDARG;
 
     D3D11_TEXTURE2D_DESC desc = {};
-    ComPtr<ID3D11Texture2D> pStaging;
-    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
-    if (FAILED(hr))
-        return hr;
+    desc.Width = image.width;
+    desc.Height = image.height;
+    desc.Format = image.format;
 
     // Determine source format's WIC equivalent
     WICPixelFormatGUID pfGuid = {};
@@ -417,7 +443,7 @@ HRESULT DirectX::SaveWICTextureToFile(
         return E_NOINTERFACE;
 
     ComPtr<IWICStream> stream;
-    hr = pWIC->CreateStream(stream.GetAddressOf());
+    HRESULT hr = pWIC->CreateStream(stream.GetAddressOf());
     if (FAILED(hr))
         return hr;
 
@@ -601,17 +627,9 @@ HRESULT DirectX::SaveWICTextureToFile(
     #endif
     }
 
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
-    if (FAILED(hr))
-        return hr;
-
-    uint64_t imageSize = uint64_t(mapped.RowPitch) * uint64_t(desc.Height);
-    if (imageSize > UINT32_MAX)
-    {
-        pContext->Unmap(pStaging.Get(), 0);
+    uint64_t imageSize = uint64_t(image.rowPitch) * uint64_t(desc.Height);
+    if (image.rowPitch > UINT32_MAX || imageSize > UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
-    }
 
     if (memcmp(&targetGuid, &pfGuid, sizeof(WICPixelFormatGUID)) != 0)
     {
@@ -619,36 +637,24 @@ HRESULT DirectX::SaveWICTextureToFile(
         ComPtr<IWICBitmap> source;
         hr = pWIC->CreateBitmapFromMemory(desc.Width, desc.Height,
             pfGuid,
-            mapped.RowPitch, static_cast<UINT>(imageSize),
-            static_cast<BYTE*>(mapped.pData), source.GetAddressOf());
+            static_cast<UINT>(image.rowPitch), static_cast<UINT>(imageSize),
+            const_cast<BYTE*>(image.pixels), source.GetAddressOf());
         if (FAILED(hr))
-        {
-            pContext->Unmap(pStaging.Get(), 0);
             return hr;
-        }
 
         ComPtr<IWICFormatConverter> FC;
         hr = pWIC->CreateFormatConverter(FC.GetAddressOf());
         if (FAILED(hr))
-        {
-            pContext->Unmap(pStaging.Get(), 0);
             return hr;
-        }
 
         BOOL canConvert = FALSE;
         hr = FC->CanConvert(pfGuid, targetGuid, &canConvert);
         if (FAILED(hr) || !canConvert)
-        {
-            pContext->Unmap(pStaging.Get(), 0);
             return E_UNEXPECTED;
-        }
 
         hr = FC->Initialize(source.Get(), targetGuid, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeMedianCut);
         if (FAILED(hr))
-        {
-            pContext->Unmap(pStaging.Get(), 0);
             return hr;
-        }
 
         WICRect rect = { 0, 0, static_cast<INT>(desc.Width), static_cast<INT>(desc.Height) };
         hr = frame->WriteSource(FC.Get(), &rect);
@@ -657,12 +663,10 @@ HRESULT DirectX::SaveWICTextureToFile(
     {
         // No conversion required
         hr = frame->WritePixels(desc.Height,
-            mapped.RowPitch, static_cast<UINT>(imageSize),
-            static_cast<BYTE*>(mapped.pData));
+            static_cast<UINT>(image.rowPitch), static_cast<UINT>(imageSize),
+            const_cast<BYTE*>(image.pixels));
     }
 
-    pContext->Unmap(pStaging.Get(), 0);
-
     if (FAILED(hr))
         return hr;
 
@@ -678,3 +682,37 @@ HRESULT DirectX::SaveWICTextureToFile(
 
     return S_OK;
 }
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveWICTextureToFile(
+    ID3D11DeviceContext* pContext,
+    ID3D11Resource* pSource,
+    REFGUID guidContainerFormat,
+    const wchar_t* fileName,
+    const GUID* targetFormat,
+    std::function<void(IPropertyBag2*)> setCustomProps,
+    bool forceSRGB)
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    ComPtr<ID3D11Texture2D> pStaging;
+    HRESULT hr = CaptureTexture(pContext, pSource, desc, pStaging);
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    hr = pContext->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr))
+        return hr;
+
+    const ScreenGrabImage image = { desc.Format, desc.Width, desc.Height, mapped.RowPitch, static_cast<const uint8_t*>(mapped.pData) };
+    hr = SaveWICImageToFile(image, guidContainerFormat, fileName, targetFormat, setCustomProps, forceSRGB);
+
+    pContext->Unmap(pStaging.Get(), 0);
+
+    return hr;
+}
@@ -0,0 +1,620 @@
+//--------------------------------------------------------------------------------------
+// File: ScreenGrabQueue.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "ScreenGrabQueue.h"
+#include "DirectXHelpers.h"
+#include "LoaderHelpers.h"
+#include "PlatformHelpers.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+
+namespace
+{
+    // Staging textures can stand in for each other when these match
+    bool SameStaging(const D3D11_TEXTURE2D_DESC& a, const D3D11_TEXTURE2D_DESC& b) noexcept
+    {
+        return a.Width == b.Width && a.Height == b.Height && a.Format == b.Format;
+    }
+
+    // Packed copy of an image, as handed to the encode thread
+    struct EncodeJob
+    {
+        ScreenGrabQueue::Target target;
+        ScreenGrabImage image;
+        std::unique_ptr<uint8_t[]> pixels;
+    };
+
+    HRESULT PackImage(const ScreenGrabImage& image, EncodeJob& job) noexcept
+    {
+        size_t rowPitch, slicePitch, rowCount;
+        HRESULT hr = LoaderHelpers::GetSurfaceInfo(image.width, image.height, image.format, &slicePitch, &rowPitch, &rowCount);
+        if (FAILED(hr))
+            return hr;
+
+        if (!image.pixels || image.rowPitch < rowPitch)
+            return E_INVALIDARG;
+
+        job.pixels.reset(new (std::nothrow) uint8_t[slicePitch]);
+        if (!job.pixels)
+            return E_OUTOFMEMORY;
+
+        auto sptr = image.pixels;
+        uint8_t* dptr = job.pixels.get();
+        for (size_t h = 0; h < rowCount; ++h)
+        {
+            memcpy(dptr, sptr, rowPitch);
+            sptr += image.rowPitch;
+            dptr += rowPitch;
+        }
+
+        job.image = image;
+        job.image.rowPitch = rowPitch;
+        job.image.pixels = job.pixels.get();
+        return S_OK;
+    }
+
+    HRESULT WriteRawImage(const ScreenGrabImage& image, _In_z_ const wchar_t* fileName) noexcept
+    {
+    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        ScopedHandle hFile(safe_handle(CreateFile2(fileName,
+            GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, nullptr)));
+    #else
+        ScopedHandle hFile(safe_handle(CreateFileW(fileName,
+            GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)));
+    #endif
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        auto_delete_file delonfail(hFile.get());
+
+        // Jobs are packed, so rowPitch covers exactly the rows GetSurfaceInfo counts
+        size_t rowPitch, slicePitch, rowCount;
+        HRESULT hr = LoaderHelpers::GetSurfaceInfo(image.width, image.height, image.format, &slicePitch, &rowPitch, &rowCount);
+        if (FAILED(hr))
+            return hr;
+
+        if (slicePitch > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        DWORD bytesWritten;
+        if (!WriteFile(hFile.get(), image.pixels, static_cast<DWORD>(slicePitch), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != slicePitch)
+            return E_FAIL;
+
+        delonfail.clear();
+
+        return S_OK;
+    }
+}
+
+
+// Internal ScreenGrabQueue implementation class.
+class ScreenGrabQueue::Impl
+{
+public:
+    Impl(_In_ ID3D11Device* device, uint32_t latency, uint32_t maxInFlight, uint32_t maxPendingEncodes);
+
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
+
+    ~Impl();
+
+    HRESULT Capture(_In_ ID3D11DeviceContext* context, _In_ ID3D11Resource* source, const Target& target);
+    void Submit(const ScreenGrabImage& image, const Target& target);
+    void Update(_In_ ID3D11DeviceContext* context);
+    void Flush(_In_ ID3D11DeviceContext* context);
+    Statistics GetStatistics() const;
+
+private:
+    struct Readback
+    {
+        ComPtr<ID3D11Texture2D> staging;
+        D3D11_TEXTURE2D_DESC desc;
+        uint64_t frame;
+        Target target;
+    };
+
+    HRESULT ReadBack(_In_ ID3D11DeviceContext* context, bool wait);
+    bool WaitForEncodeRoom(std::unique_lock<std::mutex>& lock, bool wait);
+    void Enqueue(EncodeJob&& job);
+    void EncodeThread();
+
+    ComPtr<ID3D11Device> mDevice;
+    uint32_t mLatency;
+    uint32_t mMaxInFlight;
+    uint32_t mMaxPendingEncodes;
+    uint64_t mFrame;
+
+    // Only touched by the thread that owns the device context, which changes mReadbacks under
+    // mMutex so GetStatistics can read its size from any thread
+    std::deque<Readback> mReadbacks;
+    std::vector<ComPtr<ID3D11Texture2D>> mFreeStaging;
+    D3D11_TEXTURE2D_DESC mStagingDesc;
+    ComPtr<ID3D11Texture2D> mResolve;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mWorkDone;
+    std::deque<EncodeJob> mEncodes;
+    size_t mEncoding;
+    bool mStopping;
+    Statistics mStats;
+    std::thread mThread;
+};
+
+
+_Use_decl_annotations_
+ScreenGrabQueue::Impl::Impl(ID3D11Device* device, uint32_t latency, uint32_t maxInFlight, uint32_t maxPendingEncodes) :
+    mDevice(device),
+    mLatency(latency),
+    mMaxInFlight(std::max(maxInFlight, 1u)),
+    mMaxPendingEncodes(std::max(maxPendingEncodes, 1u)),
+    mFrame(0),
+    mStagingDesc{},
+    mEncoding(0),
+    mStopping(false),
+    mStats{}
+{
+    if (!device)
+        throw std::invalid_argument("ScreenGrabQueue requires a device");
+
+    mThread = std::thread(&Impl::EncodeThread, this);
+}
+
+
+ScreenGrabQueue::Impl::~Impl()
+{
+    if (!mReadbacks.empty())
+    {
+        DebugTrace("WARNING: ScreenGrabQueue destroyed with %zu captures not read back\n", mReadbacks.size());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWorkAvailable.notify_all();
+
+    if (mThread.joinable())
+        mThread.join();
+}
+
+
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::Impl::Capture(ID3D11DeviceContext* context, ID3D11Resource* source, const Target& target)
+{
+    if (!context || !source)
+        return E_INVALIDARG;
+
+    D3D11_RESOURCE_DIMENSION resType = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    source->GetType(&resType);
+
+    if (resType != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+    {
+        DebugTrace("ERROR: ScreenGrabQueue does not support 1D or volume textures\n");
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    ComPtr<ID3D11Texture2D> texture;
+    HRESULT hr = source->QueryInterface(IID_GRAPHICS_PPV_ARGS(texture.GetAddressOf()));
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    texture->GetDesc(&desc);
+
+    // Only the top level of the first surface is read back
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.MiscFlags = 0;
+
+    if (mReadbacks.size() >= mMaxInFlight)
+    {
+        hr = ReadBack(context, true);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    ID3D11Resource* copySource = source;
+    if (desc.SampleDesc.Count > 1)
+    {
+        // MSAA content must be resolved before being copied to a staging texture
+        desc.SampleDesc.Count = 1;
+        desc.SampleDesc.Quality = 0;
+
+        const DXGI_FORMAT fmt = LoaderHelpers::EnsureNotTypeless(desc.Format);
+
+        UINT support = 0;
+        hr = mDevice->CheckFormatSupport(fmt, &support);
+        if (FAILED(hr))
+            return hr;
+
+        if (!(support & D3D11_FORMAT_SUPPORT_MULTISAMPLE_RESOLVE))
+            return E_FAIL;
+
+        D3D11_TEXTURE2D_DESC resolveDesc = {};
+        if (mResolve)
+            mResolve->GetDesc(&resolveDesc);
+
+        if (!mResolve || resolveDesc.Width != desc.Width || resolveDesc.Height != desc.Height || resolveDesc.Format != desc.Format)
+        {
+            D3D11_TEXTURE2D_DESC tempDesc = desc;
+            tempDesc.BindFlags = 0;
+            tempDesc.CPUAccessFlags = 0;
+            tempDesc.Usage = D3D11_USAGE_DEFAULT;
+
+            hr = mDevice->CreateTexture2D(&tempDesc, nullptr, mResolve.ReleaseAndGetAddressOf());
+            if (FAILED(hr))
+                return hr;
+
+            SetDebugObjectName(mResolve.Get(), "ScreenGrabQueue");
+        }
+
+        context->ResolveSubresource(mResolve.Get(), 0, source, 0, fmt);
+        copySource = mResolve.Get();
+    }
+
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.Usage = D3D11_USAGE_STAGING;
+
+    // Staging textures are recycled as long as the capture size and format stay the same.
+    // After a resize or format change the pooled ones are released, and readbacks still in
+    // flight with the old size are not returned to the pool.
+    if (!SameStaging(desc, mStagingDesc))
+    {
+        mFreeStaging.clear();
+        mStagingDesc = desc;
+    }
+
+    ComPtr<ID3D11Texture2D> staging;
+    bool created = false;
+    if (!mFreeStaging.empty())
+    {
+        staging = std::move(mFreeStaging.back());
+        mFreeStaging.pop_back();
+    }
+    else
+    {
+        hr = mDevice->CreateTexture2D(&desc, nullptr, staging.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        SetDebugObjectName(staging.Get(), "ScreenGrabQueue");
+        created = true;
+    }
+
+    context->CopySubresourceRegion(staging.Get(), 0, 0, 0, 0, copySource, 0, nullptr);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReadbacks.push_back(Readback{ staging, desc, mFrame, target });
+    mStats.captured++;
+    if (created)
+        mStats.stagingCreated++;
+
+    return S_OK;
+}
+
+
+void ScreenGrabQueue::Impl::Submit(const ScreenGrabImage& image, const Target& target)
+{
+    EncodeJob job;
+    HRESULT hr = PackImage(image, job);
+    if (FAILED(hr))
+        throw std::invalid_argument("ScreenGrabQueue::Submit");
+
+    job.target = target;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mStats.captured++;
+    WaitForEncodeRoom(lock, true);
+    lock.unlock();
+
+    Enqueue(std::move(job));
+}
+
+
+_Use_decl_annotations_
+void ScreenGrabQueue::Impl::Update(ID3D11DeviceContext* context)
+{
+    ++mFrame;
+
+    while (!mReadbacks.empty() && (mFrame - mReadbacks.front().frame) >= mLatency)
+    {
+        if (ReadBack(context, false) == DXGI_ERROR_WAS_STILL_DRAWING)
+            break;
+    }
+}
+
+
+_Use_decl_annotations_
+void ScreenGrabQueue::Impl::Flush(ID3D11DeviceContext* context)
+{
+    while (!mReadbacks.empty())
+    {
+        (void)ReadBack(context, true);
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWorkDone.wait(lock, [this] { return mEncodes.empty() && mEncoding == 0; });
+}
+
+
+ScreenGrabQueue::Statistics ScreenGrabQueue::Impl::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Statistics stats = mStats;
+    stats.readbacksInFlight = mReadbacks.size();
+    stats.encodesPending = mEncodes.size() + mEncoding;
+    return stats;
+}
+
+
+// Maps the oldest readback. Without wait, returns DXGI_ERROR_WAS_STILL_DRAWING rather than
+// block on the GPU or on a full encode queue, leaving the readback for a later frame.
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::Impl::ReadBack(ID3D11DeviceContext* context, bool wait)
+{
+    assert(!mReadbacks.empty());
+    Readback& readback = mReadbacks.front();
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!WaitForEncodeRoom(lock, wait))
+            return DXGI_ERROR_WAS_STILL_DRAWING;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    HRESULT hr = context->Map(readback.staging.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+    {
+        if (!wait)
+            return hr;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.gpuWaits++;
+        }
+
+        hr = context->Map(readback.staging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    }
+
+    EncodeJob job;
+    if (SUCCEEDED(hr))
+    {
+        const ScreenGrabImage image = { readback.desc.Format, readback.desc.Width, readback.desc.Height, mapped.RowPitch, static_cast<const uint8_t*>(mapped.pData) };
+        hr = PackImage(image, job);
+
+        context->Unmap(readback.staging.Get(), 0);
+    }
+
+    if (SameStaging(readback.desc, mStagingDesc) && mFreeStaging.size() < mMaxInFlight)
+    {
+        mFreeStaging.push_back(readback.staging);
+    }
+
+    job.target = std::move(readback.target);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReadbacks.pop_front();
+        if (FAILED(hr))
+            mStats.failed++;
+    }
+
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: ScreenGrabQueue failed to read back a capture (%08X)\n", static_cast<unsigned int>(hr));
+        return hr;
+    }
+
+    Enqueue(std::move(job));
+    return S_OK;
+}
+
+
+bool ScreenGrabQueue::Impl::WaitForEncodeRoom(std::unique_lock<std::mutex>& lock, bool wait)
+{
+    if (mEncodes.size() < mMaxPendingEncodes)
+        return true;
+
+    if (!wait)
+        return false;
+
+    mStats.encodeWaits++;
+    mWorkDone.wait(lock, [this] { return mEncodes.size() < mMaxPendingEncodes; });
+    return true;
+}
+
+
+void ScreenGrabQueue::Impl::Enqueue(EncodeJob&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEncodes.push_back(std::move(job));
+    }
+    mWorkAvailable.notify_one();
+}
+
+
+void ScreenGrabQueue::Impl::EncodeThread()
+{
+    // WIC encoders are created on this thread
+    const HRESULT hrCOM = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mWorkAvailable.wait(lock, [this] { return mStopping || !mEncodes.empty(); });
+        if (mEncodes.empty())
+            break;
+
+        EncodeJob job = std::move(mEncodes.front());
+        mEncodes.pop_front();
+        ++mEncoding;
+        lock.unlock();
+
+        // Room has opened up for a blocked readback
+        mWorkDone.notify_all();
+
+        const auto start = std::chrono::steady_clock::now();
+
+        HRESULT hr = S_OK;
+        const Target& target = job.target;
+        switch (target.encoding)
+        {
+            case Encoding::DDS:
+                hr = SaveDDSImageToFile(job.image, target.fileName.c_str());
+                break;
+
+            case Encoding::WIC:
+                hr = SaveWICImageToFile(job.image, target.container, target.fileName.c_str(), nullptr, nullptr, target.forceSRGB);
+                break;
+
+            case Encoding::Raw:
+                hr = WriteRawImage(job.image, target.fileName.c_str());
+                break;
+
+            case Encoding::Callback:
+                // An exception would otherwise end the encode thread, and with it the process
+                if (target.callback)
+                {
+                    try
+                    {
+                        target.callback(job.image);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        DebugTrace("ERROR: ScreenGrabQueue callback threw '%s'\n", e.what());
+                        hr = E_FAIL;
+                    }
+                    catch (...)
+                    {
+                        DebugTrace("ERROR: ScreenGrabQueue callback threw\n");
+                        hr = E_FAIL;
+                    }
+                }
+                break;
+
+            default:
+                hr = E_INVALIDARG;
+                break;
+        }
+
+        if (FAILED(hr) && target.encoding != Encoding::Callback)
+        {
+            DebugTrace("ERROR: ScreenGrabQueue failed to write '%ls' (%08X)\n", target.fileName.c_str(), static_cast<unsigned int>(hr));
+        }
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        lock.lock();
+        if (FAILED(hr))
+            mStats.failed++;
+        else
+            mStats.written++;
+        mStats.encodeMilliseconds += elapsed.count();
+        --mEncoding;
+        mWorkDone.notify_all();
+    }
+    lock.unlock();
+
+    if (SUCCEEDED(hrCOM))
+        CoUninitialize();
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScreenGrabQueue
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+ScreenGrabQueue::ScreenGrabQueue(ID3D11Device* device, uint32_t latency, uint32_t maxInFlight, uint32_t maxPendingEncodes) :
+    pImpl(std::make_unique<Impl>(device, latency, maxInFlight, maxPendingEncodes))
+{
+}
+
+
+ScreenGrabQueue::ScreenGrabQueue(ScreenGrabQueue&&) noexcept = default;
+ScreenGrabQueue& ScreenGrabQueue::operator= (ScreenGrabQueue&&) noexcept = default;
+ScreenGrabQueue::~ScreenGrabQueue() = default;
+
+
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::Capture(ID3D11DeviceContext* context, ID3D11Resource* source, const Target& target)
+{
+    return pImpl->Capture(context, source, target);
+}
+
+
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::CaptureDDS(ID3D11DeviceContext* context, ID3D11Resource* source, const wchar_t* fileName)
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    Target target = {};
+    target.encoding = Encoding::DDS;
+    target.fileName = fileName;
+    return pImpl->Capture(context, source, target);
+}
+
+
+_Use_decl_annotations_
+HRESULT ScreenGrabQueue::CaptureWIC(ID3D11DeviceContext* context, ID3D11Resource* source, REFGUID guidContainerFormat, const wchar_t* fileName, bool forceSRGB)
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    Target target = {};
+    target.encoding = Encoding::WIC;
+    target.fileName = fileName;
+    target.container = guidContainerFormat;
+    target.forceSRGB = forceSRGB;
+    return pImpl->Capture(context, source, target);
+}
+
+
+void ScreenGrabQueue::Submit(const ScreenGrabImage& image, const Target& target)
+{
+    pImpl->Submit(image, target);
+}
+
+
+_Use_decl_annotations_
+void ScreenGrabQueue::Update(ID3D11DeviceContext* context)
+{
+    pImpl->Update(context);
+}
+
+
+_Use_decl_annotations_
+void ScreenGrabQueue::Flush(ID3D11DeviceContext* context)
+{
+    pImpl->Flush(context);
+}
+
+
+ScreenGrabQueue::Statistics ScreenGrabQueue::GetStatistics() const
+{
+    return pImpl->GetStatistics();
+}
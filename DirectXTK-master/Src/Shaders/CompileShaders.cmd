@@ -209,7 +209,9 @@ call :CompileShaderSM4%1 DebugEffect ps PSRGBTangents
 call :CompileShaderSM4%1 DebugEffect ps PSRGBBiTangents
 
 call :CompileShader%1 SpriteEffect vs SpriteVertexShader
+call :CompileShader%1 SpriteEffect vs SpriteInstancedVertexShader
 call :CompileShader%1 SpriteEffect ps SpritePixelShader
+call :CompileShaderSM4%1 SpriteEffect ps SpriteDistanceFieldPixelShader
 
 call :CompileShader%1 DGSLEffect vs main
 call :CompileShader%1 DGSLEffect vs mainVc
@@ -23,8 +23,38 @@ void SpriteVertexShader(inout float4 color    : COLOR0,
 }
 
 
+// Instanced variant, see SpriteInstance. Each instance is one sprite, the per-vertex stream
+// only holds the unit square corner.
+void SpriteInstancedVertexShader(float2 corner      : POSITION,
+                                 float4 placement   : TEXCOORD1,
+                                 float3 axisYDepth  : TEXCOORD2,
+                                 float4 textureRect : TEXCOORD3,
+                                 inout float4 color : COLOR0,
+                                 out float2 texCoord : TEXCOORD0,
+                                 out float4 position : SV_Position)
+{
+    float2 xy = placement.xy + corner.x * placement.zw + corner.y * axisYDepth.xy;
+
+    position = mul(float4(xy, axisYDepth.z, 1), MatrixTransform);
+    texCoord = textureRect.xy + corner * textureRect.zw;
+}
+
+
 float4 SpritePixelShader(float4 color    : COLOR0,
                          float2 texCoord : TEXCOORD0) : SV_Target0
 {
     return Texture.Sample(TextureSampler, texCoord) * color;
 }
+
+
+// Signed distance field textures hold 0.5 on the outline, rising inside. fwidth measures how
+// far the distance moves across one screen pixel, so the antialiased edge stays about a pixel
+// wide at any scale. Needs derivatives, so this one is compiled for shader model 4.
+float4 SpriteDistanceFieldPixelShader(float4 color    : COLOR0,
+                                      float2 texCoord : TEXCOORD0) : SV_Target0
+{
+    float distance = Texture.Sample(TextureSampler, texCoord).r;
+    float edgeWidth = 0.7 * fwidth(distance);
+
+    return smoothstep(0.5 - edgeWidth, 0.5 + edgeWidth, distance) * color;
+}
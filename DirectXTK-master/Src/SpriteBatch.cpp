@@ -15,7 +15,11 @@
 #include "DirectXHelpers.h"
 #include "VertexTypes.h"
 #include "AlignedNew.h"
+#include "RadixSort.h"
 #include "SharedResourcePool.h"
+#include "SpriteInstances.h"
+#include "SpriteLayer.h"
+#include "SpriteVertices.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -25,10 +29,14 @@ namespace
     // Include the precompiled shader code.
     #if defined(_XBOX_ONE) && defined(_TITLE)
     #include "Shaders/Compiled/XboxOneSpriteEffect_SpriteVertexShader.inc"
+    #include "Shaders/Compiled/XboxOneSpriteEffect_SpriteInstancedVertexShader.inc"
     #include "Shaders/Compiled/XboxOneSpriteEffect_SpritePixelShader.inc"
+    #include "Shaders/Compiled/XboxOneSpriteEffect_SpriteDistanceFieldPixelShader.inc"
     #else
     #include "Shaders/Compiled/SpriteEffect_SpriteVertexShader.inc"
+    #include "Shaders/Compiled/SpriteEffect_SpriteInstancedVertexShader.inc"
     #include "Shaders/Compiled/SpriteEffect_SpritePixelShader.inc"
+    #include "Shaders/Compiled/SpriteEffect_SpriteDistanceFieldPixelShader.inc"
     #endif
 
 
@@ -55,6 +63,21 @@ namespace
 
         return v;
     }
+
+
+    // Input layout for SpriteRenderMode_Instanced: the unit square corners in slot 0, one
+    // SpriteInstance per sprite in slot 1.
+    const D3D11_INPUT_ELEMENT_DESC SpriteInstanceElements[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT,       0, 0,                                    D3D11_INPUT_PER_VERTEX_DATA,   0 },
+        { "TEXCOORD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(SpriteInstance, position),    D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 2, DXGI_FORMAT_R32G32B32_FLOAT,    1, offsetof(SpriteInstance, axisY),       D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(SpriteInstance, textureRect), D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "COLOR",    0, DXGI_FORMAT_R16G16B16A16_FLOAT, 1, offsetof(SpriteInstance, color),       D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+
+    static_assert(offsetof(SpriteInstance, axisX) == offsetof(SpriteInstance, position) + 8, "position and axisX are read as one float4");
+    static_assert(offsetof(SpriteInstance, depth) == offsetof(SpriteInstance, axisY) + 8, "axisY and depth are read as one float3");
 }
 
 
@@ -80,6 +103,15 @@ public:
         FXMVECTOR originRotationDepth,
         unsigned int flags);
 
+    void XM_CALLCONV DrawGlyphRun(_In_ ID3D11ShaderResourceView* texture,
+        _In_reads_(count) XMFLOAT4 const* sources,
+        _In_reads_(count) XMFLOAT2 const* offsets,
+        size_t count,
+        FXMVECTOR destination,
+        FXMVECTOR color,
+        FXMVECTOR originRotationDepth,
+        unsigned int flags);
+
 
     // Info about a single sprite that is waiting to be drawn.
     XM_ALIGNED_STRUCT(16) SpriteInfo : public AlignedNew<SpriteInfo>
@@ -97,30 +129,65 @@ public:
         static constexpr unsigned int DestSizeInPixels = 8;
 
         static_assert((SpriteEffects_FlipBoth & (SourceInTexels | DestSizeInPixels)) == 0, "Flag bits must not overlap");
+
+        // SpriteVertices mirrors texture coordinates by xoring the corner index with the low two flag bits.
+        static_assert(SpriteEffects_FlipHorizontally == 1 &&
+                      SpriteEffects_FlipVertically == 2, "If you change these enum values, the mirroring implementation must be updated to match");
     };
 
+    // Fills in a sprite from the Draw parameters, shared with ThreadQueue.
+    static void XM_CALLCONV SetSpriteInfo(_Out_ SpriteInfo* sprite,
+        _In_ ID3D11ShaderResourceView* texture,
+        FXMVECTOR destination,
+        _In_opt_ RECT const* sourceRectangle,
+        FXMVECTOR color,
+        FXMVECTOR originRotationDepth,
+        unsigned int flags);
+
+    void SetRenderMode(SpriteRenderMode mode);
+    void SetDistanceFieldMode(bool enable);
+
+    ThreadQueue& GetThreadQueue(size_t index);
+
+    // Runs render(deviceContext, transform, maxSpritesPerDraw) with the vertex path bound, see SpriteBatch::DrawLayer.
+    template<typename TRender>
+    void DrawLayer(TRender&& render)
+    {
+        XMMATRIX transformMatrix = BeginLayer();
+
+        render(mContextResources->deviceContext.Get(), transformMatrix, MaxBatchSize);
+
+        EndLayer();
+    }
+
     DXGI_MODE_ROTATION mRotation;
+    SpriteRenderMode mRenderMode;
+    bool mDistanceFieldMode;
 
     bool mSetViewport;
     D3D11_VIEWPORT mViewPort;
 
+    // Read by ThreadQueue as well.
+    bool mInBeginEndPair;
+
 private:
     // Implementation helper methods.
     void GrowSpriteQueue();
-    void PrepareForRendering();
+    void MergeThreadQueues();
+    void PrepareForRendering(SpriteRenderMode renderMode);
     void FlushBatch();
     void SortSprites();
     void GrowSortedSprites();
 
-    void RenderBatch(_In_ ID3D11ShaderResourceView* texture, _In_reads_(count) SpriteInfo const* const* sprites, size_t count);
+    XMMATRIX BeginLayer();
+    void EndLayer();
 
-    static void XM_CALLCONV RenderSprite(_In_ SpriteInfo const* sprite,
-        _Out_writes_(VerticesPerSprite) VertexPositionColorTexture* vertices,
-        FXMVECTOR textureSize,
-        FXMVECTOR inverseTextureSize);
+    void RenderBatch(_In_ ID3D11ShaderResourceView* texture, _In_reads_(count) SpriteInfo const* const* sprites, size_t count);
+    void RenderInstancedBatch(_In_reads_(count) SpriteInfo const* const* sprites, size_t count, FXMVECTOR textureSize, FXMVECTOR inverseTextureSize);
 
     static XMVECTOR GetTextureSize(_In_ ID3D11ShaderResourceView* texture);
     XMMATRIX GetViewportTransform(_In_ ID3D11DeviceContext* deviceContext, DXGI_MODE_ROTATION rotation );
+    XMMATRIX GetTransformMatrix(_In_ ID3D11DeviceContext* deviceContext);
 
 
     // Constants.
@@ -145,15 +212,23 @@ private:
     std::vector<SpriteInfo const*> mSortedSprites;
 
 
+    // Sort keys packed with queue indices, and the scratch buffer the radix sort ping-pongs
+    // with. Both keep their capacity from one batch to the next.
+    std::vector<uint64_t> mSortItems;
+    std::vector<uint64_t> mSortScratch;
+
+
     // If each SpriteInfo instance held a refcount on its texture, could end up with
     // many redundant AddRef/Release calls on the same object, so instead we use
     // this separate list to hold just a single refcount each time we change texture.
     std::vector<ComPtr<ID3D11ShaderResourceView>> mSpriteTextureReferences;
 
 
-    // Mode settings from the last Begin call.
-    bool mInBeginEndPair;
+    // Worker queues from GetThreadQueue, kept from one batch to the next so their storage is reused.
+    std::vector<std::unique_ptr<ThreadQueue>> mThreadQueues;
+
 
+    // Mode settings from the last Begin call.
     SpriteSortMode mSortMode;
     ComPtr<ID3D11BlendState> mBlendState;
     ComPtr<ID3D11SamplerState> mSamplerState;
@@ -173,11 +248,20 @@ private:
         ComPtr<ID3D11InputLayout> inputLayout;
         ComPtr<ID3D11Buffer> indexBuffer;
 
+        // SpriteRenderMode_Instanced, only created on feature level 9.3 and up.
+        ComPtr<ID3D11VertexShader> instancedVertexShader;
+        ComPtr<ID3D11InputLayout> instancedInputLayout;
+        ComPtr<ID3D11Buffer> cornerVertexBuffer;
+
+        // Distance field mode, only created on feature level 10.0 and up.
+        ComPtr<ID3D11PixelShader> distanceFieldPixelShader;
+
         CommonStates stateObjects;
 
     private:
         void CreateShaders(_In_ ID3D11Device* device);
         void CreateIndexBuffer(_In_ ID3D11Device* device);
+        void CreateInstancingResources(_In_ ID3D11Device* device);
 
         static std::vector<short> CreateIndexValues();
     };
@@ -200,8 +284,15 @@ private:
 
         size_t vertexBufferPosition;
 
+        // SpriteRenderMode_Instanced. Created on first use and recreated when a run outgrows it.
+        ComPtr<ID3D11Buffer> instanceBuffer;
+
+        SpriteInstanceRing instanceRing;
+
         bool inImmediateMode;
 
+        void CreateInstanceBuffer();
+
     private:
         void CreateVertexBuffer();
     };
@@ -216,6 +307,35 @@ private:
 };
 
 
+// Sprites recorded by one worker thread. Only that worker touches it between Begin and End,
+// then the SpriteBatch thread empties it into the main queue at End.
+struct SpriteBatch::ThreadQueue::Impl
+{
+    explicit Impl(_In_ SpriteBatch::Impl const* owner) noexcept
+      : mOwner(owner),
+        mSpriteCount(0),
+        mSpriteArraySize(0)
+    {
+    }
+
+    void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture,
+        FXMVECTOR destination,
+        _In_opt_ RECT const* sourceRectangle,
+        FXMVECTOR color,
+        FXMVECTOR originRotationDepth,
+        unsigned int flags);
+
+    SpriteBatch::Impl const* mOwner;
+
+    std::unique_ptr<SpriteBatch::Impl::SpriteInfo[]> mSprites;
+
+    size_t mSpriteCount;
+    size_t mSpriteArraySize;
+
+    std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureReferences;
+};
+
+
 // Global pools of per-device and per-context SpriteBatch resources.
 SharedResourcePool<ID3D11Device*, SpriteBatch::Impl::DeviceResources> SpriteBatch::Impl::deviceResourcesPool;
 SharedResourcePool<ID3D11DeviceContext*, SpriteBatch::Impl::ContextResources> SpriteBatch::Impl::contextResourcesPool;
@@ -231,6 +351,23 @@ SpriteBatch::Impl::DeviceResources::DeviceResources(_In_ ID3D11Device* device)
 {
     CreateShaders(device);
     CreateIndexBuffer(device);
+
+    if (device->GetFeatureLevel() >= D3D_FEATURE_LEVEL_9_3)
+    {
+        CreateInstancingResources(device);
+    }
+
+    if (device->GetFeatureLevel() >= D3D_FEATURE_LEVEL_10_0)
+    {
+        ThrowIfFailed(
+            device->CreatePixelShader(SpriteEffect_SpriteDistanceFieldPixelShader,
+                                      sizeof(SpriteEffect_SpriteDistanceFieldPixelShader),
+                                      nullptr,
+                                      &distanceFieldPixelShader)
+        );
+
+        SetDebugObjectName(distanceFieldPixelShader.Get(), "DirectXTK:SpriteBatch");
+    }
 }
 
 
@@ -288,6 +425,51 @@ void SpriteBatch::Impl::DeviceResources::CreateIndexBuffer(_In_ ID3D11Device* de
 }
 
 
+// Creates the shader, input layout and corner vertices used by SpriteRenderMode_Instanced.
+void SpriteBatch::Impl::DeviceResources::CreateInstancingResources(_In_ ID3D11Device* device)
+{
+    ThrowIfFailed(
+        device->CreateVertexShader(SpriteEffect_SpriteInstancedVertexShader,
+                                   sizeof(SpriteEffect_SpriteInstancedVertexShader),
+                                   nullptr,
+                                   &instancedVertexShader)
+    );
+
+    ThrowIfFailed(
+        device->CreateInputLayout(SpriteInstanceElements,
+                                  static_cast<UINT>(std::size(SpriteInstanceElements)),
+                                  SpriteEffect_SpriteInstancedVertexShader,
+                                  sizeof(SpriteEffect_SpriteInstancedVertexShader),
+                                  &instancedInputLayout)
+    );
+
+    // Drawn with the first six indices of the shared index buffer.
+    static const XMFLOAT2 corners[VerticesPerSprite] =
+    {
+        { 0, 0 },
+        { 1, 0 },
+        { 0, 1 },
+        { 1, 1 },
+    };
+
+    D3D11_BUFFER_DESC cornerBufferDesc = {};
+
+    cornerBufferDesc.ByteWidth = sizeof(corners);
+    cornerBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    cornerBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+    D3D11_SUBRESOURCE_DATA cornerDataDesc = { corners, 0, 0 };
+
+    ThrowIfFailed(
+        device->CreateBuffer(&cornerBufferDesc, &cornerDataDesc, &cornerVertexBuffer)
+    );
+
+    SetDebugObjectName(instancedVertexShader.Get(), "DirectXTK:SpriteBatch");
+    SetDebugObjectName(instancedInputLayout.Get(), "DirectXTK:SpriteBatch");
+    SetDebugObjectName(cornerVertexBuffer.Get(), "DirectXTK:SpriteBatch");
+}
+
+
 // Helper for populating the SpriteBatch index buffer.
 std::vector<short> SpriteBatch::Impl::DeviceResources::CreateIndexValues()
 {
@@ -366,14 +548,50 @@ void SpriteBatch::Impl::ContextResources::CreateVertexBuffer()
 }
 
 
+// (Re)creates the instance buffer at the capacity the ring asked for.
+void SpriteBatch::Impl::ContextResources::CreateInstanceBuffer()
+{
+    instanceBuffer.Reset();
+
+    D3D11_BUFFER_DESC instanceBufferDesc = {};
+
+    instanceBufferDesc.ByteWidth = static_cast<UINT>(sizeof(SpriteInstance) * instanceRing.GetCapacity());
+    instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+#if defined(_XBOX_ONE) && defined(_TITLE)
+    instanceBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+
+    auto device = GetDevice(deviceContext.Get());
+
+    ComPtr<ID3D11DeviceX> deviceX;
+    ThrowIfFailed(device.As(&deviceX));
+
+    ThrowIfFailed(
+        deviceX->CreatePlacementBuffer(&instanceBufferDesc, nullptr, &instanceBuffer)
+        );
+#else
+    instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+
+    ThrowIfFailed(
+        GetDevice(deviceContext.Get())->CreateBuffer(&instanceBufferDesc, nullptr, &instanceBuffer)
+    );
+#endif
+
+    SetDebugObjectName(instanceBuffer.Get(), "DirectXTK:SpriteBatch");
+}
+
+
 // Per-SpriteBatch constructor.
 SpriteBatch::Impl::Impl(_In_ ID3D11DeviceContext* deviceContext)
   : mRotation(DXGI_MODE_ROTATION_IDENTITY),
+    mRenderMode(SpriteRenderMode_Vertices),
+    mDistanceFieldMode(false),
     mSetViewport(false),
     mViewPort{},
+    mInBeginEndPair(false),
     mSpriteQueueCount(0),
     mSpriteQueueArraySize(0),
-    mInBeginEndPair(false),
     mSortMode(SpriteSortMode_Deferred),
     mTransformMatrix(MatrixIdentity),
     mDeviceResources(deviceResourcesPool.DemandCreate(GetDevice(deviceContext).Get())),
@@ -409,7 +627,7 @@ void XM_CALLCONV SpriteBatch::Impl::Begin(SpriteSortMode sortMode,
         if (mContextResources->inImmediateMode)
             throw std::logic_error("Only one SpriteBatch at a time can use SpriteSortMode_Immediate");
 
-        PrepareForRendering();
+        PrepareForRendering(mRenderMode);
 
         mContextResources->inImmediateMode = true;
     }
@@ -435,7 +653,9 @@ void SpriteBatch::Impl::End()
         if (mContextResources->inImmediateMode)
             throw std::logic_error("Cannot end one SpriteBatch while another is using SpriteSortMode_Immediate");
 
-        PrepareForRendering();
+        MergeThreadQueues();
+
+        PrepareForRendering(mRenderMode);
         FlushBatch();
     }
 
@@ -447,6 +667,32 @@ void SpriteBatch::Impl::End()
 }
 
 
+// Switches between the vertex and instance paths.
+void SpriteBatch::Impl::SetRenderMode(SpriteRenderMode mode)
+{
+    if (mInBeginEndPair)
+        throw std::logic_error("Cannot change the render mode inside Begin/End");
+
+    if (mode == SpriteRenderMode_Instanced && !mDeviceResources->instancedVertexShader)
+        throw std::runtime_error("SpriteRenderMode_Instanced requires feature level 9.3 or later");
+
+    mRenderMode = mode;
+}
+
+
+// Switches between the color and distance field pixel shaders.
+void SpriteBatch::Impl::SetDistanceFieldMode(bool enable)
+{
+    if (mInBeginEndPair)
+        throw std::logic_error("Cannot change the distance field mode inside Begin/End");
+
+    if (enable && !mDeviceResources->distanceFieldPixelShader)
+        throw std::runtime_error("Distance field mode requires feature level 10.0 or later");
+
+    mDistanceFieldMode = enable;
+}
+
+
 // Adds a single sprite to the queue.
 _Use_decl_annotations_
 void XM_CALLCONV SpriteBatch::Impl::Draw(ID3D11ShaderResourceView* texture,
@@ -470,22 +716,104 @@ void XM_CALLCONV SpriteBatch::Impl::Draw(ID3D11ShaderResourceView* texture,
 
     SpriteInfo* sprite = &mSpriteQueue[mSpriteQueueCount];
 
-    XMVECTOR dest = destination;
+    SetSpriteInfo(sprite, texture, destination, sourceRectangle, color, originRotationDepth, flags);
 
-    if (sourceRectangle)
+    if (mSortMode == SpriteSortMode_Immediate)
     {
-        // User specified an explicit source region.
-        XMVECTOR source = LoadRect(sourceRectangle);
+        // If we are in immediate mode, draw this sprite straight away.
+        RenderBatch(texture, &sprite, 1);
+    }
+    else
+    {
+        // Queue this sprite for later sorting and batched rendering.
+        mSpriteQueueCount++;
 
-        XMStoreFloat4A(&sprite->source, source);
+        // Make sure we hold a refcount on this texture until the sprite has been drawn. Only checking the
+        // back of the vector means we will add duplicate references if the caller switches back and forth
+        // between multiple repeated textures, but calling AddRef more times than strictly necessary hurts
+        // nothing, and is faster than scanning the whole list or using a map to detect all duplicates.
+        if (mSpriteTextureReferences.empty() || texture != mSpriteTextureReferences.back().Get())
+        {
+            mSpriteTextureReferences.emplace_back(texture);
+        }
+    }
+}
+
+
+// Adds the glyphs of one SpriteFont string to the queue. Produces the same sprites as drawing
+// each glyph with Draw, as SpriteFont::Impl::DrawString does, but checks the arguments, grows
+// the queue and holds the texture once for the whole run.
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::Impl::DrawGlyphRun(ID3D11ShaderResourceView* texture,
+    XMFLOAT4 const* sources,
+    XMFLOAT2 const* offsets,
+    size_t count,
+    FXMVECTOR destination,
+    FXMVECTOR color,
+    FXMVECTOR originRotationDepth,
+    unsigned int flags)
+{
+    if (!texture)
+        throw std::invalid_argument("Texture cannot be null");
+
+    if (!mInBeginEndPair)
+        throw std::logic_error("Begin must be called before Draw");
+
+    if (!count)
+        return;
+
+    const bool immediate = (mSortMode == SpriteSortMode_Immediate);
+
+    // Immediate mode draws each glyph from the same slot.
+    while (mSpriteQueueArraySize < mSpriteQueueCount + (immediate ? 1 : count))
+    {
+        GrowSpriteQueue();
+    }
 
-        // If the destination size is relative to the source region, convert it to pixels.
-        if (!(flags & SpriteInfo::DestSizeInPixels))
+    for (size_t i = 0; i < count; i++)
+    {
+        XMVECTOR source = XMLoadFloat4(&sources[i]);
+
+        XMVECTOR origin = SpriteVertices::GlyphOrigin(source, XMLoadFloat2(&offsets[i]), originRotationDepth, flags);
+
+        SpriteInfo* sprite = &mSpriteQueue[mSpriteQueueCount];
+
+        SpriteVertices::SetSprite(sprite, destination, source, color, XMVectorPermute<0, 1, 6, 7>(origin, originRotationDepth), flags);
+
+        sprite->texture = texture;
+
+        if (immediate)
+        {
+            RenderBatch(texture, &sprite, 1);
+        }
+        else
         {
-            dest = XMVectorPermute<0, 1, 6, 7>(dest, XMVectorMultiply(dest, source)); // dest.zw *= source.zw
+            mSpriteQueueCount++;
         }
+    }
+
+    // Hold a refcount on the texture until the glyphs have been drawn, see Draw.
+    if (!immediate && (mSpriteTextureReferences.empty() || texture != mSpriteTextureReferences.back().Get()))
+    {
+        mSpriteTextureReferences.emplace_back(texture);
+    }
+}
+
 
-        flags |= SpriteInfo::SourceInTexels | SpriteInfo::DestSizeInPixels;
+// Converts the Draw parameters into a queued sprite.
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::Impl::SetSpriteInfo(SpriteInfo* sprite,
+    ID3D11ShaderResourceView* texture,
+    FXMVECTOR destination,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    FXMVECTOR originRotationDepth,
+    unsigned int flags)
+{
+    if (sourceRectangle)
+    {
+        // User specified an explicit source region.
+        SpriteVertices::SetSprite(sprite, destination, LoadRect(sourceRectangle), color, originRotationDepth, flags);
     }
     else
     {
@@ -493,34 +821,111 @@ void XM_CALLCONV SpriteBatch::Impl::Draw(ID3D11ShaderResourceView* texture,
         static const XMVECTORF32 wholeTexture = { { { 0, 0, 1, 1 } } };
 
         XMStoreFloat4A(&sprite->source, wholeTexture);
-    }
+        XMStoreFloat4A(&sprite->destination, destination);
+        XMStoreFloat4A(&sprite->color, color);
+        XMStoreFloat4A(&sprite->originRotationDepth, originRotationDepth);
 
-    // Store sprite parameters.
-    XMStoreFloat4A(&sprite->destination, dest);
-    XMStoreFloat4A(&sprite->color, color);
-    XMStoreFloat4A(&sprite->originRotationDepth, originRotationDepth);
+        sprite->flags = flags;
+    }
 
     sprite->texture = texture;
-    sprite->flags = flags;
+}
+
+
+// Returns the worker queue with the given index, creating it on first use.
+SpriteBatch::ThreadQueue& SpriteBatch::Impl::GetThreadQueue(size_t index)
+{
+    if (!mInBeginEndPair)
+        throw std::logic_error("Begin must be called before GetThreadQueue");
 
     if (mSortMode == SpriteSortMode_Immediate)
+        throw std::logic_error("Thread queues cannot be used with SpriteSortMode_Immediate");
+
+    while (mThreadQueues.size() <= index)
     {
-        // If we are in immediate mode, draw this sprite straight away.
-        RenderBatch(texture, &sprite, 1);
+        mThreadQueues.emplace_back(new ThreadQueue(this));
     }
-    else
+
+    return *mThreadQueues[index];
+}
+
+
+// Adds a single sprite to a worker queue.
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Impl::Draw(ID3D11ShaderResourceView* texture,
+    FXMVECTOR destination,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    FXMVECTOR originRotationDepth,
+    unsigned int flags)
+{
+    if (!texture)
+        throw std::invalid_argument("Texture cannot be null");
+
+    if (!mOwner->mInBeginEndPair)
+        throw std::logic_error("Begin must be called before Draw");
+
+    if (mSpriteCount >= mSpriteArraySize)
     {
-        // Queue this sprite for later sorting and batched rendering.
-        mSpriteQueueCount++;
+        // Grow by a factor of 2, as the main queue does.
+        size_t newSize = std::max<size_t>(64, mSpriteArraySize * 2);
 
-        // Make sure we hold a refcount on this texture until the sprite has been drawn. Only checking the
-        // back of the vector means we will add duplicate references if the caller switches back and forth
-        // between multiple repeated textures, but calling AddRef more times than strictly necessary hurts
-        // nothing, and is faster than scanning the whole list or using a map to detect all duplicates.
-        if (mSpriteTextureReferences.empty() || texture != mSpriteTextureReferences.back().Get())
+        auto newArray = std::make_unique<SpriteBatch::Impl::SpriteInfo[]>(newSize);
+
+        for (size_t i = 0; i < mSpriteCount; i++)
         {
-            mSpriteTextureReferences.emplace_back(texture);
+            newArray[i] = mSprites[i];
         }
+
+        mSprites = std::move(newArray);
+        mSpriteArraySize = newSize;
+    }
+
+    SpriteBatch::Impl::SetSpriteInfo(&mSprites[mSpriteCount], texture, destination, sourceRectangle, color, originRotationDepth, flags);
+
+    mSpriteCount++;
+
+    // Hold a refcount on the texture until the sprite has been drawn, see SpriteBatch::Impl::Draw.
+    if (mTextureReferences.empty() || texture != mTextureReferences.back().Get())
+    {
+        mTextureReferences.emplace_back(texture);
+    }
+}
+
+
+// Appends the sprites recorded by worker queues to the main queue, in queue index order.
+void SpriteBatch::Impl::MergeThreadQueues()
+{
+    size_t totalCount = mSpriteQueueCount;
+
+    for (auto& queue : mThreadQueues)
+    {
+        totalCount += queue->pImpl->mSpriteCount;
+    }
+
+    if (totalCount == mSpriteQueueCount)
+        return;
+
+    while (mSpriteQueueArraySize < totalCount)
+    {
+        GrowSpriteQueue();
+    }
+
+    for (auto& queue : mThreadQueues)
+    {
+        auto source = queue->pImpl.get();
+
+        for (size_t i = 0; i < source->mSpriteCount; i++)
+        {
+            mSpriteQueue[mSpriteQueueCount++] = source->mSprites[i];
+        }
+
+        mSpriteTextureReferences.insert(mSpriteTextureReferences.end(),
+            std::make_move_iterator(source->mTextureReferences.begin()),
+            std::make_move_iterator(source->mTextureReferences.end()));
+
+        source->mSpriteCount = 0;
+        source->mTextureReferences.clear();
     }
 }
 
@@ -550,7 +955,7 @@ void SpriteBatch::Impl::GrowSpriteQueue()
 
 
 // Sets up D3D device state ready for drawing sprites.
-void SpriteBatch::Impl::PrepareForRendering()
+void SpriteBatch::Impl::PrepareForRendering(SpriteRenderMode renderMode)
 {
     auto deviceContext = mContextResources->deviceContext.Get();
 
@@ -567,25 +972,47 @@ void SpriteBatch::Impl::PrepareForRendering()
 
     // Set shaders.
     deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    deviceContext->IASetInputLayout(mDeviceResources->inputLayout.Get());
-    deviceContext->VSSetShader(mDeviceResources->vertexShader.Get(), nullptr, 0);
-    deviceContext->PSSetShader(mDeviceResources->pixelShader.Get(), nullptr, 0);
 
-    // Set the vertex and index buffer.
+    if (renderMode == SpriteRenderMode_Instanced)
+    {
+        deviceContext->IASetInputLayout(mDeviceResources->instancedInputLayout.Get());
+        deviceContext->VSSetShader(mDeviceResources->instancedVertexShader.Get(), nullptr, 0);
+    }
+    else
+    {
+        deviceContext->IASetInputLayout(mDeviceResources->inputLayout.Get());
+        deviceContext->VSSetShader(mDeviceResources->vertexShader.Get(), nullptr, 0);
+    }
+
+    auto pixelShader = mDistanceFieldMode ? mDeviceResources->distanceFieldPixelShader.Get() : mDeviceResources->pixelShader.Get();
+
+    deviceContext->PSSetShader(pixelShader, nullptr, 0);
+
+    // Set the vertex and index buffer. The instance buffer is bound per draw, as it can be
+    // recreated or drawn from an offset.
+    if (renderMode == SpriteRenderMode_Instanced)
+    {
+        auto cornerVertexBuffer = mDeviceResources->cornerVertexBuffer.Get();
+        UINT cornerStride = sizeof(XMFLOAT2);
+        UINT cornerOffset = 0;
+
+        deviceContext->IASetVertexBuffers(0, 1, &cornerVertexBuffer, &cornerStride, &cornerOffset);
+    }
+    else
+    {
 #if !defined(_XBOX_ONE) || !defined(_TITLE)
-    auto vertexBuffer = mContextResources->vertexBuffer.Get();
-    UINT vertexStride = sizeof(VertexPositionColorTexture);
-    UINT vertexOffset = 0;
+        auto vertexBuffer = mContextResources->vertexBuffer.Get();
+        UINT vertexStride = sizeof(VertexPositionColorTexture);
+        UINT vertexOffset = 0;
 
-    deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vertexOffset);
+        deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vertexOffset);
 #endif
+    }
 
     deviceContext->IASetIndexBuffer(mDeviceResources->indexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
 
     // Set the transform matrix.
-    XMMATRIX transformMatrix = (mRotation == DXGI_MODE_ROTATION_UNSPECIFIED)
-        ? mTransformMatrix
-        : (mTransformMatrix * GetViewportTransform(deviceContext, mRotation));
+    XMMATRIX transformMatrix = GetTransformMatrix(deviceContext);
 
 #if defined(_XBOX_ONE) && defined(_TITLE)
     void* grfxMemory;
@@ -604,6 +1031,7 @@ void SpriteBatch::Impl::PrepareForRendering()
     if (deviceContext->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED)
     {
         mContextResources->vertexBufferPosition = 0;
+        mContextResources->instanceRing.Reset();
     }
 
     // Hook lets the caller replace our settings with their own custom shaders.
@@ -671,37 +1099,52 @@ void SpriteBatch::Impl::SortSprites()
         GrowSortedSprites();
     }
 
+    if (mSortMode != SpriteSortMode_Texture && mSortMode != SpriteSortMode_BackToFront && mSortMode != SpriteSortMode_FrontToBack)
+        return;
+
+    // Build a 32-bit key per sprite, then radix sort the keys together with the queue indices.
+    // The sort is stable, so sprites with equal keys keep the order they were drawn in.
+    mSortItems.resize(mSpriteQueueCount);
+    mSortScratch.resize(mSpriteQueueCount);
+
+    uint64_t* items = mSortItems.data();
+
     switch (mSortMode)
     {
         case SpriteSortMode_Texture:
-            // Sort by texture.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + static_cast<int>(mSpriteQueueCount),
-                [](SpriteInfo const* x, SpriteInfo const* y) noexcept -> bool
-                {
-                    return x->texture < y->texture;
-                });
+            // Sort by texture. The key is the low bits of the pointer above its alignment, the
+            // radix sort skips the bytes all textures share, so a few textures take one or two
+            // passes. Two textures with equal low bits would only split each other's batches.
+            for (size_t i = 0; i < mSpriteQueueCount; i++)
+            {
+                auto texture = reinterpret_cast<uintptr_t>(mSpriteQueue[i].texture);
+
+                items[i] = RadixSort::MakeItem(static_cast<uint32_t>(texture >> 4), static_cast<uint32_t>(i));
+            }
             break;
 
         case SpriteSortMode_BackToFront:
             // Sort back to front.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + static_cast<int>(mSpriteQueueCount),
-                [](SpriteInfo const* x, SpriteInfo const* y) noexcept -> bool
-                {
-                    return x->originRotationDepth.w > y->originRotationDepth.w;
-                });
+            for (size_t i = 0; i < mSpriteQueueCount; i++)
+            {
+                items[i] = RadixSort::MakeItem(~RadixSort::FloatKey(mSpriteQueue[i].originRotationDepth.w), static_cast<uint32_t>(i));
+            }
             break;
 
-        case SpriteSortMode_FrontToBack:
+        default:
             // Sort front to back.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + static_cast<int>(mSpriteQueueCount),
-                [](SpriteInfo const* x, SpriteInfo const* y) noexcept -> bool
-                {
-                    return x->originRotationDepth.w < y->originRotationDepth.w;
-                });
+            for (size_t i = 0; i < mSpriteQueueCount; i++)
+            {
+                items[i] = RadixSort::MakeItem(RadixSort::FloatKey(mSpriteQueue[i].originRotationDepth.w), static_cast<uint32_t>(i));
+            }
             break;
+    }
 
-        default:
-            break;
+    const uint64_t* sorted = RadixSort::SortByKey(items, mSortScratch.data(), mSpriteQueueCount);
+
+    for (size_t i = 0; i < mSpriteQueueCount; i++)
+    {
+        mSortedSprites[i] = &mSpriteQueue[RadixSort::GetPayload(sorted[i])];
     }
 }
 
@@ -720,6 +1163,41 @@ void SpriteBatch::Impl::GrowSortedSprites()
 }
 
 
+// Draws whatever is queued ahead of a retained layer, then binds the vertex path for it.
+XMMATRIX SpriteBatch::Impl::BeginLayer()
+{
+    if (!mInBeginEndPair)
+        throw std::logic_error("Begin must be called before DrawLayer");
+
+    if (mSortMode != SpriteSortMode_Immediate)
+    {
+        if (mContextResources->inImmediateMode)
+            throw std::logic_error("Cannot draw a layer on one SpriteBatch while another is using SpriteSortMode_Immediate");
+
+        if (mSpriteQueueCount > 0)
+        {
+            PrepareForRendering(mRenderMode);
+            FlushBatch();
+        }
+    }
+
+    // Layers always use the vertex path, whatever the render mode.
+    PrepareForRendering(SpriteRenderMode_Vertices);
+
+    return GetTransformMatrix(mContextResources->deviceContext.Get());
+}
+
+
+// Restores the state immediate mode sprites expect after a layer replaced the vertex buffer.
+void SpriteBatch::Impl::EndLayer()
+{
+    if (mSortMode == SpriteSortMode_Immediate)
+    {
+        PrepareForRendering(mRenderMode);
+    }
+}
+
+
 // Submits a batch of sprites to the GPU.
 _Use_decl_annotations_
 void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInfo const* const* sprites, size_t count)
@@ -731,6 +1209,12 @@ void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInf
 
     XMVECTOR textureSize = GetTextureSize(texture);
     XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+
+    if (mRenderMode == SpriteRenderMode_Instanced)
+    {
+        RenderInstancedBatch(sprites, count, textureSize, inverseTextureSize);
+        return;
+    }
             
     while (count > 0)
     {
@@ -774,14 +1258,9 @@ void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInf
 #endif
 
         // Generate sprite vertex data.
-        for (size_t i = 0; i < batchSize; i++)
-        {
-            assert(i < count);
-            _Analysis_assume_(i < count);
-            RenderSprite(sprites[i], vertices, textureSize, inverseTextureSize);
-
-            vertices += VerticesPerSprite;
-        }
+        assert(batchSize <= count);
+        _Analysis_assume_(batchSize <= count);
+        SpriteVertices::RenderSprites(sprites, batchSize, vertices, textureSize, inverseTextureSize);
 
 #if defined(_XBOX_ONE) && defined(_TITLE)
         deviceContext->IASetPlacementVertexBuffer(0, mContextResources->vertexBuffer.Get(), grfxMemory, sizeof(VertexPositionColorTexture));
@@ -806,117 +1285,57 @@ void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInf
 }
 
 
-// Generates vertex data for drawing a single sprite.
+// Submits a batch of sprites as instances, one draw per run that fits the instance buffer.
 _Use_decl_annotations_
-void XM_CALLCONV SpriteBatch::Impl::RenderSprite(SpriteInfo const* sprite,
-    VertexPositionColorTexture* vertices,
-    FXMVECTOR textureSize,
-    FXMVECTOR inverseTextureSize)
+void SpriteBatch::Impl::RenderInstancedBatch(SpriteInfo const* const* sprites, size_t count, FXMVECTOR textureSize, FXMVECTOR inverseTextureSize)
 {
-    // Load sprite parameters into SIMD registers.
-    XMVECTOR source = XMLoadFloat4A(&sprite->source);
-    XMVECTOR destination = XMLoadFloat4A(&sprite->destination);
-    XMVECTOR color = XMLoadFloat4A(&sprite->color);
-    XMVECTOR originRotationDepth = XMLoadFloat4A(&sprite->originRotationDepth);
-
-    float rotation = sprite->originRotationDepth.z;
-    unsigned int flags = sprite->flags;
-
-    // Extract the source and destination sizes into separate vectors.
-    XMVECTOR sourceSize = XMVectorSwizzle<2, 3, 2, 3>(source);
-    XMVECTOR destinationSize = XMVectorSwizzle<2, 3, 2, 3>(destination);
-
-    // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
-    XMVECTOR isZeroMask = XMVectorEqual(sourceSize, XMVectorZero());
-    XMVECTOR nonZeroSourceSize = XMVectorSelect(sourceSize, g_XMEpsilon, isZeroMask);
-
-    XMVECTOR origin = XMVectorDivide(originRotationDepth, nonZeroSourceSize);
+    auto deviceContext = mContextResources->deviceContext.Get();
 
-    // Convert the source region from texels to mod-1 texture coordinate format.
-    if (flags & SpriteInfo::SourceInTexels)
-    {
-        source = XMVectorMultiply(source, inverseTextureSize);
-        sourceSize = XMVectorMultiply(sourceSize, inverseTextureSize);
-    }
-    else
+    while (count > 0)
     {
-        origin = XMVectorMultiply(origin, inverseTextureSize);
-    }
+        size_t batchSize = (count < SpriteInstanceRing::MaxCapacity) ? count : SpriteInstanceRing::MaxCapacity;
 
-    // If the destination size is relative to the source region, convert it to pixels.
-    if (!(flags & SpriteInfo::DestSizeInPixels))
-    {
-        destinationSize = XMVectorMultiply(destinationSize, textureSize);
-    }
+        auto allocation = mContextResources->instanceRing.Allocate(batchSize);
 
-    // Compute a 2x2 rotation matrix.
-    XMVECTOR rotationMatrix1;
-    XMVECTOR rotationMatrix2;
+        if (allocation.resized || !mContextResources->instanceBuffer)
+        {
+            mContextResources->CreateInstanceBuffer();
+        }
 
-    if (rotation != 0)
-    {
-        float sin, cos;
+        auto instanceBuffer = mContextResources->instanceBuffer.Get();
 
-        XMScalarSinCos(&sin, &cos, rotation);
+#if defined(_XBOX_ONE) && defined(_TITLE)
+        void *grfxMemory = GraphicsMemory::Get().Allocate(deviceContext, sizeof(SpriteInstance) * batchSize, 64);
 
-        XMVECTOR sinV = XMLoadFloat(&sin);
-        XMVECTOR cosV = XMLoadFloat(&cos);
+        SpriteInstances::PackSprites(sprites, batchSize, static_cast<SpriteInstance*>(grfxMemory), textureSize, inverseTextureSize);
 
-        rotationMatrix1 = XMVectorMergeXY(cosV, sinV);
-        rotationMatrix2 = XMVectorMergeXY(XMVectorNegate(sinV), cosV);
-    }
-    else
-    {
-        rotationMatrix1 = g_XMIdentityR0;
-        rotationMatrix2 = g_XMIdentityR1;
-    }
-    
-    // The four corner vertices are computed by transforming these unit-square positions.
-    static XMVECTORF32 cornerOffsets[VerticesPerSprite] =
-    {
-        { { { 0, 0, 0, 0 } } },
-        { { { 1, 0, 0, 0 } } },
-        { { { 0, 1, 0, 0 } } },
-        { { { 1, 1, 0, 0 } } },
-    };
+        deviceContext->IASetPlacementVertexBuffer(1, instanceBuffer, grfxMemory, sizeof(SpriteInstance));
 
-    // Tricksy alert! Texture coordinates are computed from the same cornerOffsets
-    // table as vertex positions, but if the sprite is mirrored, this table
-    // must be indexed in a different order. This is done as follows:
-    //
-    //    position = cornerOffsets[i]
-    //    texcoord = cornerOffsets[i ^ SpriteEffects]
+        UINT instanceOffset = 0;
+#else
+        D3D11_MAP mapType = allocation.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
 
-    static_assert(SpriteEffects_FlipHorizontally == 1 &&
-                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the mirroring implementation must be updated to match");
+        D3D11_MAPPED_SUBRESOURCE mappedBuffer;
 
-    const unsigned int mirrorBits = flags & 3u;
+        ThrowIfFailed(
+            deviceContext->Map(instanceBuffer, 0, mapType, 0, &mappedBuffer)
+        );
 
-    // Generate the four output vertices.
-    for (size_t i = 0; i < VerticesPerSprite; i++)
-    {
-        // Calculate position.
-        XMVECTOR cornerOffset = XMVectorMultiply(XMVectorSubtract(cornerOffsets[i], origin), destinationSize);
-        
-        // Apply 2x2 rotation matrix.
-        XMVECTOR position1 = XMVectorMultiplyAdd(XMVectorSplatX(cornerOffset), rotationMatrix1, destination);
-        XMVECTOR position2 = XMVectorMultiplyAdd(XMVectorSplatY(cornerOffset), rotationMatrix2, position1);
+        SpriteInstances::PackSprites(sprites, batchSize, static_cast<SpriteInstance*>(mappedBuffer.pData) + allocation.offset, textureSize, inverseTextureSize);
 
-        // Set z = depth.
-        XMVECTOR position = XMVectorPermute<0, 1, 7, 6>(position2, originRotationDepth);
+        deviceContext->Unmap(instanceBuffer, 0);
 
-        // Write position as a Float4, even though VertexPositionColor::position is an XMFLOAT3.
-        // This is faster, and harmless as we are just clobbering the first element of the
-        // following color field, which will immediately be overwritten with its correct value.
-        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertices[i].position), position);
+        // Feature level 9.3 has no StartInstanceLocation, so the run is selected by the binding offset.
+        UINT instanceStride = sizeof(SpriteInstance);
+        auto instanceOffset = static_cast<UINT>(sizeof(SpriteInstance) * allocation.offset);
 
-        // Write the color.
-        XMStoreFloat4(&vertices[i].color, color);
+        deviceContext->IASetVertexBuffers(1, 1, &instanceBuffer, &instanceStride, &instanceOffset);
+#endif
 
-        // Compute and write the texture coordinate.
-        XMVECTOR textureCoordinate = XMVectorMultiplyAdd(cornerOffsets[static_cast<unsigned int>(i) ^ mirrorBits], sourceSize, source);
+        deviceContext->DrawIndexedInstanced(IndicesPerSprite, static_cast<UINT>(batchSize), 0, 0, 0);
 
-        XMStoreFloat2(&vertices[i].textureCoordinate, textureCoordinate);
+        sprites += batchSize;
+        count -= batchSize;
     }
 }
 
@@ -1009,6 +1428,15 @@ XMMATRIX SpriteBatch::Impl::GetViewportTransform(_In_ ID3D11DeviceContext* devic
 }
 
 
+// Combines the Begin transform with the viewport transform. With DXGI_MODE_ROTATION_UNSPECIFIED the Begin transform is used as is.
+XMMATRIX SpriteBatch::Impl::GetTransformMatrix(_In_ ID3D11DeviceContext* deviceContext)
+{
+    return (mRotation == DXGI_MODE_ROTATION_UNSPECIFIED)
+        ? mTransformMatrix
+        : (mTransformMatrix * GetViewportTransform(deviceContext, mRotation));
+}
+
+
 // Public constructor.
 SpriteBatch::SpriteBatch(_In_ ID3D11DeviceContext* deviceContext)
   : pImpl(std::make_unique<Impl>(deviceContext))
@@ -1193,8 +1621,207 @@ DXGI_MODE_ROTATION SpriteBatch::GetRotation() const noexcept
 }
 
 
+void SpriteBatch::SetRenderMode(SpriteRenderMode mode)
+{
+    pImpl->SetRenderMode(mode);
+}
+
+
+SpriteRenderMode SpriteBatch::GetRenderMode() const noexcept
+{
+    return pImpl->mRenderMode;
+}
+
+
+void SpriteBatch::SetDistanceFieldMode(bool enable)
+{
+    pImpl->SetDistanceFieldMode(enable);
+}
+
+
+bool SpriteBatch::GetDistanceFieldMode() const noexcept
+{
+    return pImpl->mDistanceFieldMode;
+}
+
+
 void SpriteBatch::SetViewport(const D3D11_VIEWPORT& viewPort)
 {
     pImpl->mSetViewport = true;
     pImpl->mViewPort = viewPort;
 }
+
+
+SpriteBatch::ThreadQueue& SpriteBatch::GetThreadQueue(size_t index)
+{
+    return pImpl->GetThreadQueue(index);
+}
+
+
+void XM_CALLCONV SpriteBatch::DrawGlyphRun(ID3D11ShaderResourceView* texture,
+    XMFLOAT4 const* sources,
+    XMFLOAT2 const* offsets,
+    size_t count,
+    FXMVECTOR position,
+    FXMVECTOR color,
+    float rotation,
+    FXMVECTOR origin,
+    GXMVECTOR scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(position, scale); // x, y, scale.x, scale.y
+
+    XMVECTOR rotationDepth = XMVectorMergeXY(XMVectorReplicate(rotation), XMVectorReplicate(layerDepth));
+
+    XMVECTOR originRotationDepth = XMVectorPermute<0, 1, 4, 5>(origin, rotationDepth);
+
+    pImpl->DrawGlyphRun(texture, sources, offsets, count, destination, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+void SpriteBatch::DrawLayer(SpriteLayer& layer)
+{
+    pImpl->DrawLayer([&](ID3D11DeviceContext* deviceContext, CXMMATRIX transform, size_t maxSpritesPerDraw)
+    {
+        layer.Render(deviceContext, transform, maxSpritesPerDraw);
+    });
+}
+
+
+// Worker queue constructor, only SpriteBatch creates these.
+_Use_decl_annotations_
+SpriteBatch::ThreadQueue::ThreadQueue(SpriteBatch::Impl const* owner)
+  : pImpl(std::make_unique<Impl>(owner))
+{
+}
+
+
+SpriteBatch::ThreadQueue::~ThreadQueue()
+{
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture, XMFLOAT2 const& position, FXMVECTOR color)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(XMLoadFloat2(&position), g_XMOne); // x, y, 1, 1
+    
+    pImpl->Draw(texture, destination, nullptr, color, g_XMZero, 0);
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture,
+    XMFLOAT2 const& position,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    XMFLOAT2 const& origin,
+    float scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 4>(XMLoadFloat2(&position), XMLoadFloat(&scale)); // x, y, scale, scale
+    
+    XMVECTOR originRotationDepth = XMVectorSet(origin.x, origin.y, rotation, layerDepth);
+
+    pImpl->Draw(texture, destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture,
+    XMFLOAT2 const& position,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    XMFLOAT2 const& origin,
+    XMFLOAT2 const& scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(XMLoadFloat2(&position), XMLoadFloat2(&scale)); // x, y, scale.x, scale.y
+    
+    XMVECTOR originRotationDepth = XMVectorSet(origin.x, origin.y, rotation, layerDepth);
+    
+    pImpl->Draw(texture, destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture, FXMVECTOR position, FXMVECTOR color)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(position, g_XMOne); // x, y, 1, 1
+    
+    pImpl->Draw(texture, destination, nullptr, color, g_XMZero, 0);
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture,
+    FXMVECTOR position,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    FXMVECTOR origin,
+    float scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 4>(position, XMLoadFloat(&scale)); // x, y, scale, scale
+
+    XMVECTOR rotationDepth = XMVectorMergeXY(XMVectorReplicate(rotation), XMVectorReplicate(layerDepth));
+
+    XMVECTOR originRotationDepth = XMVectorPermute<0, 1, 4, 5>(origin, rotationDepth);
+    
+    pImpl->Draw(texture, destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture,
+    FXMVECTOR position,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    FXMVECTOR origin,
+    GXMVECTOR scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(position, scale); // x, y, scale.x, scale.y
+    
+    XMVECTOR rotationDepth = XMVectorMergeXY(XMVectorReplicate(rotation), XMVectorReplicate(layerDepth));
+
+    XMVECTOR originRotationDepth = XMVectorPermute<0, 1, 4, 5>(origin, rotationDepth);
+
+    pImpl->Draw(texture, destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, FXMVECTOR color)
+{
+    XMVECTOR destination = LoadRect(&destinationRectangle); // x, y, w, h
+
+    pImpl->Draw(texture, destination, nullptr, color, g_XMZero, SpriteBatch::Impl::SpriteInfo::DestSizeInPixels);
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::ThreadQueue::Draw(ID3D11ShaderResourceView* texture,
+    RECT const& destinationRectangle,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    XMFLOAT2 const& origin,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = LoadRect(&destinationRectangle); // x, y, w, h
+
+    XMVECTOR originRotationDepth = XMVectorSet(origin.x, origin.y, rotation, layerDepth);
+    
+    pImpl->Draw(texture, destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects) | SpriteBatch::Impl::SpriteInfo::DestSizeInPixels);
+}
@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteChunkGrid.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpriteVertices.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace DirectX
+{
+    // The chunks of a SpriteLayer: which square of chunkSize pixels each sprite falls in, the
+    // bounds of every chunk, and which chunks a transform can see. TChunk needs a sprites
+    // vector of a type SpriteVertices can render, an XMFLOAT4 bounds and a bool dirty, and is
+    // value initialized, so it can carry Direct3D resources as well. Nothing here needs
+    // Direct3D, so it can be tested without a device.
+    template<typename TChunk>
+    class SpriteChunkGrid
+    {
+    public:
+        struct Location
+        {
+            uint32_t chunk;
+            uint32_t sprite;
+        };
+
+        explicit SpriteChunkGrid(float chunkSize) noexcept
+            : mChunkSize(chunkSize),
+            mDrawnChunkCount(0),
+            mRebuiltChunkCount(0)
+        {
+        }
+
+        // Stores a sprite in the chunk its position falls in, and grows that chunk's bounds to
+        // cover every corner, so rotated or oversized sprites that reach outside the square
+        // are still culled correctly.
+        template<typename TSprite>
+        Location XM_CALLCONV Add(TSprite const& sprite, FXMVECTOR textureSize, FXMVECTOR inverseTextureSize)
+        {
+            // The corners come from the same code that later builds the vertex buffer.
+            Corner corners[SpriteVertices::VerticesPerSprite];
+
+            SpriteVertices::RenderSprite(&sprite, corners, textureSize, inverseTextureSize);
+
+            Location location;
+
+            location.chunk = FindChunk(XMLoadFloat4A(&sprite.destination));
+
+            TChunk& chunk = mChunks[location.chunk];
+
+            XMVECTOR bounds = XMLoadFloat4(&chunk.bounds);
+
+            XMVECTOR minimum = bounds;
+            XMVECTOR maximum = XMVectorSwizzle<2, 3, 0, 1>(bounds);
+
+            for (size_t i = 0; i < SpriteVertices::VerticesPerSprite; i++)
+            {
+                XMVECTOR corner = XMLoadFloat3(&corners[i].position);
+
+                minimum = XMVectorMin(minimum, corner);
+                maximum = XMVectorMax(maximum, corner);
+            }
+
+            XMStoreFloat4(&chunk.bounds, XMVectorPermute<0, 1, 4, 5>(minimum, maximum));
+
+            location.sprite = static_cast<uint32_t>(chunk.sprites.size());
+
+            chunk.sprites.push_back(sprite);
+            chunk.dirty = true;
+
+            return location;
+        }
+
+        // Returns the chunk covering a position, creating it on first use.
+        uint32_t XM_CALLCONV FindChunk(FXMVECTOR position)
+        {
+            XMFLOAT2 cell;
+
+            XMStoreFloat2(&cell, XMVectorFloor(XMVectorScale(position, 1.0f / mChunkSize)));
+
+            auto x = static_cast<uint32_t>(static_cast<int32_t>(cell.x));
+            auto y = static_cast<uint32_t>(static_cast<int32_t>(cell.y));
+
+            uint64_t key = (uint64_t(x) << 32) | y;
+
+            auto it = mChunkLookup.find(key);
+
+            if (it != mChunkLookup.end())
+                return it->second;
+
+            TChunk chunk{};
+
+            chunk.bounds = XMFLOAT4(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+            chunk.dirty = true;
+
+            mChunks.push_back(std::move(chunk));
+
+            auto chunkIndex = static_cast<uint32_t>(mChunks.size() - 1);
+
+            mChunkLookup.emplace(key, chunkIndex);
+
+            return chunkIndex;
+        }
+
+        // Calls rebuild(chunk) for each visible chunk that is dirty, then draw(chunk) for each
+        // visible chunk. Dirty chunks are only rebuilt once they come into view.
+        template<typename TRebuild, typename TDraw>
+        void XM_CALLCONV Render(FXMMATRIX transform, TRebuild&& rebuild, TDraw&& draw)
+        {
+            mDrawnChunkCount = 0;
+            mRebuiltChunkCount = 0;
+
+            for (auto& chunk : mChunks)
+            {
+                if (chunk.sprites.empty() || !IsVisible(chunk.bounds, transform))
+                    continue;
+
+                if (chunk.dirty)
+                {
+                    rebuild(chunk);
+
+                    chunk.dirty = false;
+
+                    mRebuiltChunkCount++;
+                }
+
+                draw(chunk);
+
+                mDrawnChunkCount++;
+            }
+        }
+
+        // Returns false when all four corners of the (left, top, right, bottom) bounds are beyond
+        // the same side of the clip volume, using the same row vector convention as the shader.
+        static bool XM_CALLCONV IsVisible(XMFLOAT4 const& bounds, FXMMATRIX transform) noexcept
+        {
+            static const XMVECTORF32 planeSigns = { { { -1.f, 1.f, -1.f, 1.f } } };
+
+            const XMFLOAT2 corners[4] =
+            {
+                XMFLOAT2(bounds.x, bounds.y),
+                XMFLOAT2(bounds.z, bounds.y),
+                XMFLOAT2(bounds.x, bounds.w),
+                XMFLOAT2(bounds.z, bounds.w),
+            };
+
+            // One lane per clip plane: left, right, top and bottom.
+            XMVECTOR outside = XMVectorTrueInt();
+
+            for (size_t i = 0; i < 4; i++)
+            {
+                XMVECTOR clip = XMVector2Transform(XMLoadFloat2(&corners[i]), transform);
+
+                XMVECTOR signedCoordinates = XMVectorMultiply(XMVectorSwizzle<0, 0, 1, 1>(clip), planeSigns);
+
+                outside = XMVectorAndInt(outside, XMVectorGreater(signedCoordinates, XMVectorSplatW(clip)));
+            }
+
+            return XMVector4EqualInt(outside, XMVectorZero());
+        }
+
+        void Clear() noexcept
+        {
+            mChunks.clear();
+            mChunkLookup.clear();
+        }
+
+        TChunk& operator[](size_t index) noexcept { return mChunks[index]; }
+        TChunk const& operator[](size_t index) const noexcept { return mChunks[index]; }
+
+        size_t GetChunkCount() const noexcept { return mChunks.size(); }
+
+        // Chunks drawn and rebuilt by the most recent Render call.
+        size_t GetDrawnChunkCount() const noexcept { return mDrawnChunkCount; }
+        size_t GetRebuiltChunkCount() const noexcept { return mRebuiltChunkCount; }
+
+    private:
+        // Laid out like VertexPositionColorTexture, for SpriteVertices.
+        struct Corner
+        {
+            XMFLOAT3 position;
+            XMFLOAT4 color;
+            XMFLOAT2 textureCoordinate;
+        };
+
+        float mChunkSize;
+
+        std::vector<TChunk> mChunks;
+        std::unordered_map<uint64_t, uint32_t> mChunkLookup;
+
+        size_t mDrawnChunkCount;
+        size_t mRebuiltChunkCount;
+    };
+}
@@ -15,12 +15,16 @@
 #include "SpriteFont.h"
 #include "DirectXHelpers.h"
 #include "BinaryReader.h"
+#include "GlyphTable.h"
 #include "LoaderHelpers.h"
+#include "SpriteVertices.h"
+#include "TextHelpers.h"
+#include "TextLayout.h"
 
 using namespace DirectX;
+using namespace DirectX::TextHelpers;
 using Microsoft::WRL::ComPtr;
 
-
 // Internal SpriteFont implementation class.
 class SpriteFont::Impl
 {
@@ -33,12 +37,22 @@ public:
         size_t glyphCount,
         float lineSpacing) noexcept(false);
 
-    Glyph const* FindGlyph(wchar_t character) const;
+    Glyph const* FindGlyph(uint32_t character) const;
 
     void SetDefaultCharacter(wchar_t character);
 
-    template<typename TAction>
-    void ForEachGlyph(_In_z_ wchar_t const* text, TAction action, bool ignoreWhitespace) const;
+    // Text functions are shared between UTF-16 and UTF-8, which is decoded as it goes.
+    template<typename TChar, typename TAction>
+    void ForEachGlyph(_In_z_ TChar const* text, TAction action, bool ignoreWhitespace) const;
+
+    template<typename TChar>
+    void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ TChar const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const;
+
+    template<typename TChar>
+    XMVECTOR MeasureString(_In_z_ TChar const* text, bool ignoreWhitespace) const;
+
+    template<typename TChar>
+    RECT MeasureDrawBounds(_In_z_ TChar const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const;
 
     void CreateTextureResource(_In_ ID3D11Device* device,
         uint32_t width, uint32_t height,
@@ -46,18 +60,30 @@ public:
         uint32_t stride, uint32_t rows,
         _In_reads_(stride * rows) const uint8_t* data) noexcept(false);
 
-    const wchar_t* ConvertUTF8(_In_z_ const char *text) noexcept(false);
-
     // Fields.
     ComPtr<ID3D11ShaderResourceView> texture;
     std::vector<Glyph> glyphs;
-    std::vector<uint32_t> glyphsIndex;
-    Glyph const* defaultGlyph;
-    float lineSpacing;
+    GlyphTable glyphTable;
+    float distanceFieldSpread;
+
+    // Line spacing, default glyph and the layout cache, which drawing and measuring update.
+    mutable TextLayout<Glyph> textLayout;
 
 private:
-    size_t utfBufferSize;
-    std::unique_ptr<wchar_t[]> utfBuffer;
+    using Layout = TextLayout<Glyph>::Layout;
+
+    void BuildGlyphTable();
+
+    // Take the string's cached layout, or nullptr to lay it out as they go, so that DrawString
+    // only looks a string up once.
+    template<typename TChar, typename TAction>
+    void ForEachGlyph(_In_z_ TChar const* text, _In_opt_ Layout const* layout, TAction action, bool ignoreWhitespace) const;
+
+    template<typename TChar>
+    XMVECTOR MeasureString(_In_z_ TChar const* text, _In_opt_ Layout const* layout, bool ignoreWhitespace) const;
+
+    template<typename TChar>
+    Layout const* FindLayout(_In_z_ TChar const* text) const;
 };
 
 
@@ -65,25 +91,16 @@ private:
 const XMFLOAT2 SpriteFont::Float2Zero(0, 0);
 
 static const char spriteFontMagic[] = "DXTKfont";
+static const char spriteFontDistanceFieldMagic[] = "DXTKdist";
 
 
-// Comparison operators make our sorted glyph vector work with std::binary_search and lower_bound.
+// Comparison operator makes our glyph vector work with std::is_sorted.
 namespace DirectX
 {
     static inline bool operator< (SpriteFont::Glyph const& left, SpriteFont::Glyph const& right) noexcept
     {
         return left.Character < right.Character;
     }
-
-    static inline bool operator< (wchar_t left, SpriteFont::Glyph const& right) noexcept
-    {
-        return left < right.Character;
-    }
-
-    static inline bool operator< (SpriteFont::Glyph const& left, wchar_t right) noexcept
-    {
-        return left.Character < right;
-    }
 }
 
 
@@ -93,9 +110,7 @@ SpriteFont::Impl::Impl(
     ID3D11Device* device,
     BinaryReader* reader,
     bool forceSRGB) noexcept(false) :
-        defaultGlyph(nullptr),
-        lineSpacing(0),
-        utfBufferSize(0)
+        distanceFieldSpread(0)
 {
     // Validate the header.
     for (char const* magic = spriteFontMagic; *magic; magic++)
@@ -112,15 +127,11 @@ SpriteFont::Impl::Impl(
     auto glyphData = reader->ReadArray<Glyph>(glyphCount);
 
     glyphs.assign(glyphData, glyphData + glyphCount);
-    glyphsIndex.reserve(glyphs.size());
 
-    for (auto& glyph : glyphs)
-    {
-        glyphsIndex.emplace_back(glyph.Character);
-    }
+    BuildGlyphTable();
 
     // Read font properties.
-    lineSpacing = reader->Read<float>();
+    textLayout.SetLineSpacing(reader->Read<float>());
 
     SetDefaultCharacter(static_cast<wchar_t>(reader->Read<uint32_t>()));
 
@@ -140,6 +151,21 @@ SpriteFont::Impl::Impl(
 
     auto textureData = reader->ReadArray<uint8_t>(static_cast<size_t>(dataSize));
 
+    // Distance field fonts end with a trailer that older versions never read.
+    if (!reader->EndOfFile())
+    {
+        for (char const* magic = spriteFontDistanceFieldMagic; *magic; magic++)
+        {
+            if (reader->Read<uint8_t>() != *magic)
+            {
+                DebugTrace("ERROR: SpriteFont provided with an invalid .spritefont file\n");
+                throw std::runtime_error("Unexpected data after the SpriteFont texture");
+            }
+        }
+
+        distanceFieldSpread = reader->Read<float>();
+    }
+
     if (forceSRGB)
     {
         textureFormat = LoaderHelpers::MakeSRGB(textureFormat);
@@ -164,133 +190,243 @@ SpriteFont::Impl::Impl(
     float ilineSpacing) noexcept(false) :
         texture(itexture),
         glyphs(iglyphs, iglyphs + glyphCount),
-        defaultGlyph(nullptr),
-        lineSpacing(ilineSpacing),
-        utfBufferSize(0)
+        distanceFieldSpread(0)
 {
     if (!std::is_sorted(iglyphs, iglyphs + glyphCount))
     {
         throw std::runtime_error("Glyphs must be in ascending codepoint order");
     }
 
-    glyphsIndex.reserve(glyphs.size());
+    BuildGlyphTable();
 
-    for (auto& glyph : glyphs)
+    textLayout.SetLineSpacing(ilineSpacing);
+}
+
+
+// Indexes the glyphs by code point. If a character appears more than once, the first one wins.
+void SpriteFont::Impl::BuildGlyphTable()
+{
+    if (glyphs.size() >= GlyphTable::NotFound)
+        throw std::out_of_range("Too many glyphs");
+
+    for (size_t i = 0; i < glyphs.size(); i++)
     {
-        glyphsIndex.emplace_back(glyph.Character);
+        const uint32_t character = glyphs[i].Character;
+
+        if (glyphTable.Find(character) == GlyphTable::NotFound)
+        {
+            glyphTable.Insert(character, static_cast<uint32_t>(i));
+        }
     }
 }
 
 
 // Looks up the requested glyph, falling back to the default character if it is not in the font.
-SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
+SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(uint32_t character) const
 {
-    // Rather than use std::lower_bound (which includes a slow debug path when built for _DEBUG),
-    // we implement a binary search inline to ensure sufficient Debug build performance to be useful
-    // for text-heavy applications.
-
-    size_t lower = 0;
-    size_t higher = glyphs.size() - 1;
-    size_t index = higher / 2;
-    const size_t size = glyphs.size();
+    const uint32_t index = glyphTable.Find(character);
 
-    while (index < size)
+    if (index != GlyphTable::NotFound)
     {
-        const auto curChar = glyphsIndex[index];
-        if (curChar == character) { return &glyphs[index]; }
-        if (curChar < character)
-        {
-            lower = index + 1;
-        }
-        else
-        {
-            higher = index - 1;
-        }
-        if (higher < lower) { break; }
-        else if (higher - lower <= 4)
-        {
-            for (index = lower; index <= higher; index++)
-            {
-                if (glyphsIndex[index] == character)
-                {
-                    return &glyphs[index];
-                }
-            }
-        }
-        index = lower + ((higher - lower) / 2);
+        return &glyphs[index];
     }
 
-    if (defaultGlyph)
+    if (auto defaultGlyph = textLayout.GetDefaultGlyph())
     {
         return defaultGlyph;
     }
 
-    DebugTrace("ERROR: SpriteFont encountered a character not in the font (%u, %C), and no default glyph was provided\n", character, character);
+    DebugTrace("ERROR: SpriteFont encountered a character not in the font (%u, %C), and no default glyph was provided\n", character, static_cast<wchar_t>(character));
     throw std::runtime_error("Character not in font");
 }
 
 
-// Sets the missing-character fallback glyph.
+// Sets the missing-character fallback glyph. Cached layouts that used the old one are dropped.
 void SpriteFont::Impl::SetDefaultCharacter(wchar_t character)
 {
-    defaultGlyph = nullptr;
+    textLayout.SetDefaultGlyph(nullptr);
 
     if (character)
     {
-        defaultGlyph = FindGlyph(character);
+        textLayout.SetDefaultGlyph(FindGlyph(character));
     }
 }
 
 
-// The core glyph layout algorithm, shared between DrawString and MeasureString.
-template<typename TAction>
-void SpriteFont::Impl::ForEachGlyph(_In_z_ wchar_t const* text, TAction action, bool ignoreWhitespace) const
+// Calls action for each glyph of a string, from the layout cache when it is enabled.
+template<typename TChar, typename TAction>
+void SpriteFont::Impl::ForEachGlyph(_In_z_ TChar const* text, TAction action, bool ignoreWhitespace) const
 {
-    float x = 0;
-    float y = 0;
+    ForEachGlyph(text, FindLayout(text), action, ignoreWhitespace);
+}
 
-    for (; *text; text++)
-    {
-        wchar_t character = *text;
 
-        switch (character)
+template<typename TChar, typename TAction>
+void SpriteFont::Impl::ForEachGlyph(_In_z_ TChar const* text, _In_opt_ Layout const* layout, TAction action, bool ignoreWhitespace) const
+{
+    if (layout)
+    {
+        for (auto& layoutGlyph : layout->glyphs)
         {
-            case '\r':
-                // Skip carriage returns.
-                continue;
+            if (!ignoreWhitespace || !layoutGlyph.skippable)
+            {
+                action(layoutGlyph.glyph, layoutGlyph.x, layoutGlyph.y, layoutGlyph.advance);
+            }
+        }
+    }
+    else
+    {
+        textLayout.LayoutGlyphs(text, [this](uint32_t character) { return FindGlyph(character); },
+            [&](Glyph const* glyph, float x, float y, float advance, bool skippable)
+            {
+                if (!ignoreWhitespace || !skippable)
+                {
+                    action(glyph, x, y, advance);
+                }
+            });
+    }
+}
+
+
+// Returns the cached layout of a string, or nullptr while the layout cache is off.
+template<typename TChar>
+auto SpriteFont::Impl::FindLayout(_In_z_ TChar const* text) const -> Layout const*
+{
+    return textLayout.Find(text, [this](uint32_t character) { return FindGlyph(character); });
+}
+
+
+// Draws a string, as one glyph run when it has a cached layout and one glyph at a time otherwise.
+template<typename TChar>
+void XM_CALLCONV SpriteFont::Impl::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ TChar const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
+{
+    static_assert(SpriteEffects_FlipHorizontally == 1 &&
+                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the following table must be updated to match");
+
+    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
+    static XMVECTORF32 axisIsMirroredTable[4] =
+    {
+        { { { 0, 0, 0, 0 } } },
+        { { { 1, 0, 0, 0 } } },
+        { { { 0, 1, 0, 0 } } },
+        { { { 1, 1, 0, 0 } } },
+    };
 
-            case '\n':
-                // New line.
-                x = 0;
-                y += lineSpacing;
-                break;
+    // Looked up once, so a draw counts as a single cache hit or miss even when it also measures.
+    Layout const* layout = FindLayout(text);
 
-            default:
-                // Output this character.
-                auto glyph = FindGlyph(character);
+    XMVECTOR baseOffset = origin;
 
-                x += glyph->XOffset;
+    // If the text is mirrored, offset the start position accordingly.
+    if (effects)
+    {
+        baseOffset = XMVectorNegativeMultiplySubtract(
+            MeasureString(text, layout, true),
+            axisIsMirroredTable[effects & 3],
+            baseOffset);
+    }
 
-                if (x < 0)
-                    x = 0;
+    if (layout)
+    {
+        spriteBatch->DrawGlyphRun(texture.Get(), layout->sources.data(), layout->offsets.data(), layout->sources.size(),
+            position, color, rotation, baseOffset, scale, effects, layerDepth);
+        return;
+    }
 
-                float advance = float(glyph->Subrect.right) - float(glyph->Subrect.left) + glyph->XAdvance;
+    // Draw each character in turn.
+    ForEachGlyph(text, nullptr, [&](Glyph const* glyph, float x, float y, float advance)
+    {
+        UNREFERENCED_PARAMETER(advance);
 
-                if (!ignoreWhitespace
-                    || !iswspace(character)
-                    || ((glyph->Subrect.right - glyph->Subrect.left) > 1)
-                    || ((glyph->Subrect.bottom - glyph->Subrect.top) > 1))
-                {
-                    action(glyph, x, y, advance);
-                }
+        // Mirrored characters are placed by their bottom and/or right, which needs their size.
+        XMVECTOR glyphRect = g_XMZero;
+
+        if (effects)
+        {
+            glyphRect = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&glyph->Subrect)), 0);
 
-                x += advance;
-                break;
+            // zw = glyph width/height.
+            glyphRect = XMVectorSubtract(glyphRect, XMVectorPermute<0, 1, 4, 5>(g_XMZero, glyphRect));
         }
-    }
+
+        XMVECTOR offset = SpriteVertices::GlyphOrigin(glyphRect, XMVectorSet(x, y + glyph->YOffset, 0, 0), baseOffset, effects);
+
+        spriteBatch->Draw(texture.Get(), position, &glyph->Subrect, color, rotation, offset, scale, effects, layerDepth);
+    }, true);
+}
+
+
+template<typename TChar>
+XMVECTOR SpriteFont::Impl::MeasureString(_In_z_ TChar const* text, bool ignoreWhitespace) const
+{
+    return MeasureString(text, FindLayout(text), ignoreWhitespace);
 }
 
 
+template<typename TChar>
+XMVECTOR SpriteFont::Impl::MeasureString(_In_z_ TChar const* text, _In_opt_ Layout const* layout, bool ignoreWhitespace) const
+{
+    XMVECTOR result = XMVectorZero();
+
+    ForEachGlyph(text, layout, [&](Glyph const* glyph, float x, float y, float advance)
+        {
+            UNREFERENCED_PARAMETER(advance);
+
+            auto w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
+            auto h = static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top) + glyph->YOffset;
+
+            h = IsWhitespace(glyph->Character) ?
+                textLayout.GetLineSpacing() :
+                std::max(h, textLayout.GetLineSpacing());
+
+            result = XMVectorMax(result, XMVectorSet(x + w, y + h, 0, 0));
+        }, ignoreWhitespace);
+
+    return result;
+}
+
+
+template<typename TChar>
+RECT SpriteFont::Impl::MeasureDrawBounds(_In_z_ TChar const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
+{
+    RECT result = { LONG_MAX, LONG_MAX, 0, 0 };
+
+    ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance) noexcept
+        {
+            auto isWhitespace = IsWhitespace(glyph->Character);
+            auto w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
+            auto h = isWhitespace ?
+                textLayout.GetLineSpacing() :
+                static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top);
+
+            float minX = position.x + x;
+            float minY = position.y + y + (isWhitespace ? 0.0f : glyph->YOffset);
+
+            float maxX = std::max(minX + advance, minX + w);
+            float maxY = minY + h;
+
+            if (minX < float(result.left))
+                result.left = long(minX);
+
+            if (minY < float(result.top))
+                result.top = long(minY);
+
+            if (float(result.right) < maxX)
+                result.right = long(maxX);
+
+            if (float(result.bottom) < maxY)
+                result.bottom = long(maxY);
+        }, ignoreWhitespace);
+
+    if (result.left == LONG_MAX)
+    {
+        result.left = 0;
+        result.top = 0;
+    }
+
+    return result;
+}
+
 _Use_decl_annotations_
 void SpriteFont::Impl::CreateTextureResource(
     ID3D11Device* device,
@@ -333,36 +469,6 @@ void SpriteFont::Impl::CreateTextureResource(
 }
 
 
-const wchar_t* SpriteFont::Impl::ConvertUTF8(_In_z_ const char *text) noexcept(false)
-{
-    if (!utfBuffer)
-    {
-        utfBufferSize = 1024;
-        utfBuffer.reset(new wchar_t[1024]);
-    }
-
-    int result = MultiByteToWideChar(CP_UTF8, 0, text, -1, utfBuffer.get(), static_cast<int>(utfBufferSize));
-    if (!result && (GetLastError() == ERROR_INSUFFICIENT_BUFFER))
-    {
-        // Compute required buffer size
-        result = MultiByteToWideChar(CP_UTF8, 0, text, -1, nullptr, 0);
-        utfBufferSize = AlignUp(static_cast<size_t>(result), 1024u);
-        utfBuffer.reset(new wchar_t[utfBufferSize]);
-
-        // Retry conversion
-        result = MultiByteToWideChar(CP_UTF8, 0, text, -1, utfBuffer.get(), static_cast<int>(utfBufferSize));
-    }
-
-    if (!result)
-    {
-        DebugTrace("ERROR: MultiByteToWideChar failed with error %u.\n", GetLastError());
-        throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "MultiByteToWideChar");
-    }
-
-    return utfBuffer.get();
-}
-
-
 // Construct from a binary file created by the MakeSpriteFont utility.
 _Use_decl_annotations_
 SpriteFont::SpriteFont(ID3D11Device* device, wchar_t const* fileName, bool forceSRGB)
@@ -415,139 +521,37 @@ SpriteFont::~SpriteFont()
 // Wide-character / UTF-16LE
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
 {
-    static_assert(SpriteEffects_FlipHorizontally == 1 &&
-                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
-
-    // Lookup table indicates which way to move along each axis per SpriteEffects enum value.
-    static XMVECTORF32 axisDirectionTable[4] =
-    {
-        { { { -1, -1, 0, 0 } } },
-        { { {  1, -1, 0, 0 } } },
-        { { { -1,  1, 0, 0 } } },
-        { { {  1,  1, 0, 0 } } },
-    };
-
-    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
-    static XMVECTORF32 axisIsMirroredTable[4] =
-    {
-        { { { 0, 0, 0, 0 } } },
-        { { { 1, 0, 0, 0 } } },
-        { { { 0, 1, 0, 0 } } },
-        { { { 1, 1, 0, 0 } } },
-    };
-
-    XMVECTOR baseOffset = origin;
-
-    // If the text is mirrored, offset the start position accordingly.
-    if (effects)
-    {
-        baseOffset = XMVectorNegativeMultiplySubtract(
-            MeasureString(text),
-            axisIsMirroredTable[effects & 3],
-            baseOffset);
-    }
-
-    // Draw each character in turn.
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
-    {
-        UNREFERENCED_PARAMETER(advance);
-
-        XMVECTOR offset = XMVectorMultiplyAdd(XMVectorSet(x, y + glyph->YOffset, 0, 0), axisDirectionTable[effects & 3], baseOffset);
-
-        if (effects)
-        {
-            // For mirrored characters, specify bottom and/or right instead of top left.
-            XMVECTOR glyphRect = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&glyph->Subrect)), 0);
-
-            // xy = glyph width/height.
-            glyphRect = XMVectorSubtract(XMVectorSwizzle<2, 3, 0, 1>(glyphRect), glyphRect);
-
-            offset = XMVectorMultiplyAdd(glyphRect, axisIsMirroredTable[effects & 3], offset);
-        }
-
-        spriteBatch->Draw(pImpl->texture.Get(), position, &glyph->Subrect, color, rotation, offset, scale, effects, layerDepth);
-    }, true);
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects, layerDepth);
 }
 
 
 XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ wchar_t const* text, bool ignoreWhitespace) const
 {
-    XMVECTOR result = XMVectorZero();
-
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
-        {
-            UNREFERENCED_PARAMETER(advance);
-
-            auto w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
-            auto h = static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top) + glyph->YOffset;
-
-            h = iswspace(wchar_t(glyph->Character)) ?
-                pImpl->lineSpacing :
-                std::max(h, pImpl->lineSpacing);
-
-            result = XMVectorMax(result, XMVectorSet(x + w, y + h, 0, 0));
-        }, ignoreWhitespace);
-
-    return result;
+    return pImpl->MeasureString(text, ignoreWhitespace);
 }
 
 
 RECT SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
 {
-    RECT result = { LONG_MAX, LONG_MAX, 0, 0 };
-
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance) noexcept
-        {
-            auto isWhitespace = iswspace(wchar_t(glyph->Character));
-            auto w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
-            auto h = isWhitespace ?
-                pImpl->lineSpacing :
-                static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top);
-
-            float minX = position.x + x;
-            float minY = position.y + y + (isWhitespace ? 0.0f : glyph->YOffset);
-
-            float maxX = std::max(minX + advance, minX + w);
-            float maxY = minY + h;
-
-            if (minX < float(result.left))
-                result.left = long(minX);
-
-            if (minY < float(result.top))
-                result.top = long(minY);
-
-            if (float(result.right) < maxX)
-                result.right = long(maxX);
-
-            if (float(result.bottom) < maxY)
-                result.bottom = long(maxY);
-        }, ignoreWhitespace);
-
-    if (result.left == LONG_MAX)
-    {
-        result.left = 0;
-        result.top = 0;
-    }
-
-    return result;
+    return pImpl->MeasureDrawBounds(text, position, ignoreWhitespace);
 }
 
 
@@ -556,44 +560,44 @@ RECT XM_CALLCONV SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, FXMVE
     XMFLOAT2 pos;
     XMStoreFloat2(&pos, position);
 
-    return MeasureDrawBounds(text, pos, ignoreWhitespace);
+    return pImpl->MeasureDrawBounds(text, pos, ignoreWhitespace);
 }
 
 
-// UTF-8
+// UTF-8, decoded as the glyphs are laid out rather than converted up front.
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), position, color, rotation, origin, scale, effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects, layerDepth);
 }
 
 
 XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ char const* text, bool ignoreWhitespace) const
 {
-    return MeasureString(pImpl->ConvertUTF8(text), ignoreWhitespace);
+    return pImpl->MeasureString(text, ignoreWhitespace);
 }
 
 
 RECT SpriteFont::MeasureDrawBounds(_In_z_ char const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
 {
-    return MeasureDrawBounds(pImpl->ConvertUTF8(text), position, ignoreWhitespace);
+    return pImpl->MeasureDrawBounds(text, position, ignoreWhitespace);
 }
 
 
@@ -602,27 +606,29 @@ RECT XM_CALLCONV SpriteFont::MeasureDrawBounds(_In_z_ char const* text, FXMVECTO
     XMFLOAT2 pos;
     XMStoreFloat2(&pos, position);
 
-    return MeasureDrawBounds(pImpl->ConvertUTF8(text), pos, ignoreWhitespace);
+    return pImpl->MeasureDrawBounds(text, pos, ignoreWhitespace);
 }
 
 
 // Spacing properties
 float SpriteFont::GetLineSpacing() const noexcept
 {
-    return pImpl->lineSpacing;
+    return pImpl->textLayout.GetLineSpacing();
 }
 
 
 void SpriteFont::SetLineSpacing(float spacing)
 {
-    pImpl->lineSpacing = spacing;
+    pImpl->textLayout.SetLineSpacing(spacing);
 }
 
 
 // Font properties
 wchar_t SpriteFont::GetDefaultCharacter() const noexcept
 {
-    return static_cast<wchar_t>(pImpl->defaultGlyph ? pImpl->defaultGlyph->Character : 0);
+    auto defaultGlyph = pImpl->textLayout.GetDefaultGlyph();
+
+    return static_cast<wchar_t>(defaultGlyph ? defaultGlyph->Character : 0);
 }
 
 
@@ -634,7 +640,7 @@ void SpriteFont::SetDefaultCharacter(wchar_t character)
 
 bool SpriteFont::ContainsCharacter(wchar_t character) const
 {
-    return std::binary_search(pImpl->glyphs.begin(), pImpl->glyphs.end(), character);
+    return pImpl->glyphTable.Find(character) != GlyphTable::NotFound;
 }
 
 
@@ -652,3 +658,47 @@ void SpriteFont::GetSpriteSheet(ID3D11ShaderResourceView** texture) const
 
     ThrowIfFailed(pImpl->texture.CopyTo(texture));
 }
+
+
+bool SpriteFont::IsDistanceField() const noexcept
+{
+    return pImpl->distanceFieldSpread > 0;
+}
+
+
+// Layout cache
+void SpriteFont::SetLayoutCacheCapacity(size_t strings)
+{
+    pImpl->textLayout.SetCapacity(strings);
+}
+
+
+size_t SpriteFont::GetLayoutCacheCapacity() const noexcept
+{
+    return pImpl->textLayout.GetCapacity();
+}
+
+
+SpriteFont::LayoutCacheStatistics SpriteFont::GetLayoutCacheStatistics() const noexcept
+{
+    auto& statistics = pImpl->textLayout.GetStatistics();
+
+    LayoutCacheStatistics result;
+
+    result.hits = statistics.hits;
+    result.misses = statistics.misses;
+    result.evictions = statistics.evictions;
+    result.glyphsReused = statistics.glyphsReused;
+    result.glyphsLaidOut = statistics.glyphsLaidOut;
+    result.layoutMilliseconds = statistics.layoutMilliseconds;
+    result.strings = statistics.strings;
+    result.glyphs = statistics.glyphs;
+
+    return result;
+}
+
+
+void SpriteFont::ResetLayoutCacheStatistics() noexcept
+{
+    pImpl->textLayout.ResetStatistics();
+}
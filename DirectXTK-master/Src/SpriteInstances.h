@@ -0,0 +1,220 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteInstances.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DirectX
+{
+    // Record for SpriteRenderMode_Instanced. The vertex shader places corner (u, v) of the unit
+    // square at position + u * axisX + v * axisY, with texture coordinate
+    // textureRect.xy + (u, v) * textureRect.zw. Nothing in this file needs Direct3D, so the
+    // packing and the ring can be tested without a device.
+    struct SpriteInstance
+    {
+        XMFLOAT2 position;              // Corner 0, after origin and rotation, in pixels
+        XMFLOAT2 axisX;                 // Corner 0 to corner 1
+        XMFLOAT2 axisY;                 // Corner 0 to corner 2
+        float depth;
+        XMFLOAT4 textureRect;           // Texture coordinate of corner 0, then the signed extent
+        PackedVector::XMHALF4 color;
+    };
+
+    static_assert(sizeof(SpriteInstance) == 52, "SpriteInstance does not match the input layout");
+
+
+    namespace SpriteInstances
+    {
+        // Converts one queued sprite to its instance record. TSprite has the same requirements
+        // as for SpriteVertices, and the conversions match its RenderSprite, so corner 0 lands
+        // on exactly the same position and texture coordinate as the first vertex would.
+        template<typename TSprite>
+        void XM_CALLCONV PackSprite(_In_ TSprite const* sprite,
+            _Out_ SpriteInstance* instance,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize) noexcept
+        {
+            XMVECTOR source = XMLoadFloat4A(&sprite->source);
+            XMVECTOR destination = XMLoadFloat4A(&sprite->destination);
+            XMVECTOR originRotationDepth = XMLoadFloat4A(&sprite->originRotationDepth);
+
+            float rotation = sprite->originRotationDepth.z;
+            unsigned int flags = sprite->flags;
+
+            XMVECTOR sourceSize = XMVectorSwizzle<2, 3, 2, 3>(source);
+            XMVECTOR destinationSize = XMVectorSwizzle<2, 3, 2, 3>(destination);
+
+            // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
+            XMVECTOR isZeroMask = XMVectorEqual(sourceSize, XMVectorZero());
+            XMVECTOR nonZeroSourceSize = XMVectorSelect(sourceSize, g_XMEpsilon, isZeroMask);
+
+            XMVECTOR origin = XMVectorDivide(originRotationDepth, nonZeroSourceSize);
+
+            // Convert the source region from texels to mod-1 texture coordinate format.
+            if (flags & TSprite::SourceInTexels)
+            {
+                source = XMVectorMultiply(source, inverseTextureSize);
+                sourceSize = XMVectorMultiply(sourceSize, inverseTextureSize);
+            }
+            else
+            {
+                origin = XMVectorMultiply(origin, inverseTextureSize);
+            }
+
+            // If the destination size is relative to the source region, convert it to pixels.
+            if (!(flags & TSprite::DestSizeInPixels))
+            {
+                destinationSize = XMVectorMultiply(destinationSize, textureSize);
+            }
+
+            // Compute a 2x2 rotation matrix.
+            XMVECTOR rotationMatrix1;
+            XMVECTOR rotationMatrix2;
+
+            if (rotation != 0)
+            {
+                float sin, cos;
+
+                XMScalarSinCos(&sin, &cos, rotation);
+
+                XMVECTOR sinV = XMLoadFloat(&sin);
+                XMVECTOR cosV = XMLoadFloat(&cos);
+
+                rotationMatrix1 = XMVectorMergeXY(cosV, sinV);
+                rotationMatrix2 = XMVectorMergeXY(XMVectorNegate(sinV), cosV);
+            }
+            else
+            {
+                rotationMatrix1 = g_XMIdentityR0;
+                rotationMatrix2 = g_XMIdentityR1;
+            }
+
+            // Place corner 0, then the rotated edges to its neighbours.
+            XMVECTOR cornerOffset = XMVectorMultiply(XMVectorSubtract(XMVectorZero(), origin), destinationSize);
+
+            XMVECTOR position = XMVectorMultiplyAdd(XMVectorSplatX(cornerOffset), rotationMatrix1, destination);
+            position = XMVectorMultiplyAdd(XMVectorSplatY(cornerOffset), rotationMatrix2, position);
+
+            XMVECTOR axisX = XMVectorMultiply(XMVectorSplatX(destinationSize), rotationMatrix1);
+            XMVECTOR axisY = XMVectorMultiply(XMVectorSplatY(destinationSize), rotationMatrix2);
+
+            // Mirroring moves corner 0's texture coordinate to the far edge and reverses the extent.
+            static const XMVECTORU32 mirrorMasks[4] =
+            {
+                { { { 0, 0, 0, 0 } } },
+                { { { 0xFFFFFFFF, 0, 0, 0 } } },
+                { { { 0, 0xFFFFFFFF, 0, 0 } } },
+                { { { 0xFFFFFFFF, 0xFFFFFFFF, 0, 0 } } },
+            };
+
+            XMVECTOR mirror = mirrorMasks[flags & 3u];
+
+            XMVECTOR textureOrigin = XMVectorMultiplyAdd(XMVectorSelect(g_XMZero, g_XMOne, mirror), sourceSize, source);
+            XMVECTOR textureExtent = XMVectorSelect(sourceSize, XMVectorNegate(sourceSize), mirror);
+
+            XMStoreFloat2(&instance->position, position);
+            XMStoreFloat2(&instance->axisX, axisX);
+            XMStoreFloat2(&instance->axisY, axisY);
+            instance->depth = sprite->originRotationDepth.w;
+            XMStoreFloat4(&instance->textureRect, XMVectorPermute<0, 1, 4, 5>(textureOrigin, textureExtent));
+            PackedVector::XMStoreHalf4(&instance->color, XMLoadFloat4A(&sprite->color));
+        }
+
+
+        template<typename TSprite>
+        void XM_CALLCONV PackSprites(_In_reads_(count) TSprite const* const* sprites,
+            size_t count,
+            _Out_writes_(count) SpriteInstance* instances,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize) noexcept
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                PackSprite(sprites[i], &instances[i], textureSize, inverseTextureSize);
+            }
+        }
+    }
+
+
+    // Decides where each run of instances goes in the dynamic instance buffer. Runs are
+    // appended until one does not fit, which starts again at the front with a discard, and
+    // the buffer grows whenever a run is longer than the whole buffer, so every run is
+    // contiguous and can be drawn with one call.
+    class SpriteInstanceRing
+    {
+    public:
+        static constexpr size_t InitialCapacity = 2048;
+        static constexpr size_t MaxCapacity = 1 << 20;
+
+        struct Allocation
+        {
+            size_t offset;      // In instances
+            bool discard;       // Map with D3D11_MAP_WRITE_DISCARD rather than NO_OVERWRITE
+            bool resized;       // Recreate the buffer with GetCapacity() instances first
+        };
+
+        SpriteInstanceRing() noexcept
+            : mCapacity(0),
+            mPosition(0)
+        {
+        }
+
+        // count must be between 1 and MaxCapacity, longer runs are split by the caller.
+        Allocation Allocate(size_t count) noexcept
+        {
+            assert(count > 0 && count <= MaxCapacity);
+
+            Allocation result = {};
+
+            if (count > mCapacity)
+            {
+                size_t capacity = (mCapacity > InitialCapacity) ? mCapacity : InitialCapacity;
+
+                while (capacity < count)
+                {
+                    capacity *= 2;
+                }
+
+                mCapacity = (capacity < MaxCapacity) ? capacity : MaxCapacity;
+                mPosition = 0;
+                result.resized = true;
+            }
+            else if (count > mCapacity - mPosition)
+            {
+                mPosition = 0;
+            }
+
+            result.offset = mPosition;
+            result.discard = (mPosition == 0);
+
+            mPosition += count;
+
+            return result;
+        }
+
+        // Makes the next allocation discard, as deferred contexts require.
+        void Reset() noexcept
+        {
+            mPosition = 0;
+        }
+
+        size_t GetCapacity() const noexcept { return mCapacity; }
+
+    private:
+        size_t mCapacity;
+        size_t mPosition;
+    };
+}
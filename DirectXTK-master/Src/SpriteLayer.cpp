@@ -0,0 +1,443 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteLayer.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "SpriteLayer.h"
+#include "BufferHelpers.h"
+#include "DirectXHelpers.h"
+#include "PlatformHelpers.h"
+#include "SpriteChunkGrid.h"
+#include "VertexTypes.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    // A retained sprite, in the form SpriteVertices expects. Sources are always stored in
+    // texels and destination sizes in pixels, so a sprite does not depend on its texture.
+    XM_ALIGNED_STRUCT(16) LayerSprite
+    {
+        XMFLOAT4A source;
+        XMFLOAT4A destination;
+        XMFLOAT4A color;
+        XMFLOAT4A originRotationDepth;
+        unsigned int flags;
+
+        static constexpr unsigned int SourceInTexels = 4;
+        static constexpr unsigned int DestSizeInPixels = 8;
+
+        static_assert((SpriteEffects_FlipBoth & (SourceInTexels | DestSizeInPixels)) == 0, "Flag bits must not overlap");
+    };
+
+
+    // Helper converts a RECT to XMVECTOR.
+    inline XMVECTOR LoadRect(_In_ RECT const* rect)
+    {
+        XMVECTOR v = XMLoadInt4(reinterpret_cast<uint32_t const*>(rect));
+
+        v = XMConvertVectorIntToFloat(v, 0);
+
+        // Convert right/bottom to width/height.
+        v = XMVectorSubtract(v, XMVectorPermute<0, 1, 4, 5>(g_XMZero, v));
+
+        return v;
+    }
+
+
+    // Helper looks up the size of the layer texture.
+    XMFLOAT2 GetTextureSize(_In_ ID3D11ShaderResourceView* texture)
+    {
+        ComPtr<ID3D11Resource> resource;
+
+        texture->GetResource(&resource);
+
+        ComPtr<ID3D11Texture2D> texture2D;
+
+        if (FAILED(resource.As(&texture2D)))
+        {
+            throw std::invalid_argument("SpriteLayer can only draw Texture2D resources");
+        }
+
+        D3D11_TEXTURE2D_DESC desc;
+
+        texture2D->GetDesc(&desc);
+
+        return XMFLOAT2(static_cast<float>(desc.Width), static_cast<float>(desc.Height));
+    }
+}
+
+
+// Internal SpriteLayer implementation class.
+class SpriteLayer::Impl
+{
+public:
+    Impl(_In_ ID3D11Device* device, _In_ ID3D11ShaderResourceView* texture, float chunkSize);
+
+    size_t XM_CALLCONV Add(FXMVECTOR destination,
+        _In_opt_ RECT const* sourceRectangle,
+        FXMVECTOR color,
+        FXMVECTOR originRotationDepth,
+        unsigned int flags);
+
+    void SetSourceRectangle(size_t index, RECT const& sourceRectangle);
+    void XM_CALLCONV SetColor(size_t index, FXMVECTOR color);
+
+    void Clear() noexcept;
+
+    void Render(_In_ ID3D11DeviceContext* deviceContext, CXMMATRIX transform, size_t maxSpritesPerDraw);
+
+    size_t GetSpriteCount() const noexcept { return mLocations.size(); }
+    size_t GetChunkCount() const noexcept { return mChunks.GetChunkCount(); }
+
+    size_t GetDrawnChunkCount() const noexcept { return mChunks.GetDrawnChunkCount(); }
+    size_t GetRebuiltChunkCount() const noexcept { return mChunks.GetRebuiltChunkCount(); }
+
+private:
+    // Sprites whose position falls in one chunkSize square, and the vertex buffer built from them.
+    struct Chunk
+    {
+        std::vector<LayerSprite> sprites;
+
+        // Left, top, right, bottom of every sprite corner.
+        XMFLOAT4 bounds;
+
+        ComPtr<ID3D11Buffer> vertexBuffer;
+        size_t vertexBufferSprites;
+
+        bool dirty;
+    };
+
+    static const size_t VerticesPerSprite = SpriteVertices::VerticesPerSprite;
+    static const size_t IndicesPerSprite = 6;
+
+    LayerSprite& GetSprite(size_t index, _Out_ Chunk** chunk);
+    void RebuildChunk(_In_ ID3D11DeviceContext* deviceContext, Chunk& chunk);
+
+    ComPtr<ID3D11Device> mDevice;
+    ComPtr<ID3D11ShaderResourceView> mTexture;
+    XMFLOAT2 mTextureSize;
+
+    SpriteChunkGrid<Chunk> mChunks;
+
+    // Indexed by the values Add returns.
+    std::vector<SpriteChunkGrid<Chunk>::Location> mLocations;
+
+    // Scratch space for rebuilding a chunk, kept to avoid reallocating.
+    std::vector<VertexPositionColorTexture> mVertices;
+};
+
+
+// Constants.
+const XMFLOAT2 SpriteLayer::Float2Zero(0, 0);
+
+
+_Use_decl_annotations_
+SpriteLayer::Impl::Impl(ID3D11Device* device, ID3D11ShaderResourceView* texture, float chunkSize)
+    : mDevice(device),
+    mTexture(texture),
+    mTextureSize{},
+    mChunks(chunkSize)
+{
+    if (!device)
+        throw std::invalid_argument("Direct3D device is null");
+
+    if (!texture)
+        throw std::invalid_argument("Texture cannot be null");
+
+    if (!(chunkSize > 0))
+        throw std::invalid_argument("Chunk size must be greater than zero");
+
+    mTextureSize = GetTextureSize(texture);
+}
+
+
+_Use_decl_annotations_
+size_t XM_CALLCONV SpriteLayer::Impl::Add(FXMVECTOR destination,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    FXMVECTOR originRotationDepth,
+    unsigned int flags)
+{
+    XMVECTOR textureSize = XMLoadFloat2(&mTextureSize);
+    XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+
+    // Without an explicit source region, use the entire texture.
+    XMVECTOR source = sourceRectangle ? LoadRect(sourceRectangle) : XMVectorPermute<0, 1, 4, 5>(g_XMZero, textureSize);
+
+    // If the destination size is relative to the source region, convert it to pixels.
+    XMVECTOR dest = destination;
+
+    if (!(flags & LayerSprite::DestSizeInPixels))
+    {
+        dest = XMVectorPermute<0, 1, 6, 7>(dest, XMVectorMultiply(dest, source)); // dest.zw *= source.zw
+    }
+
+    LayerSprite sprite;
+
+    XMStoreFloat4A(&sprite.source, source);
+    XMStoreFloat4A(&sprite.destination, dest);
+    XMStoreFloat4A(&sprite.color, color);
+    XMStoreFloat4A(&sprite.originRotationDepth, originRotationDepth);
+
+    sprite.flags = flags | LayerSprite::SourceInTexels | LayerSprite::DestSizeInPixels;
+
+    mLocations.push_back(mChunks.Add(sprite, textureSize, inverseTextureSize));
+
+    return mLocations.size() - 1;
+}
+
+
+_Use_decl_annotations_
+LayerSprite& SpriteLayer::Impl::GetSprite(size_t index, Chunk** chunk)
+{
+    if (index >= mLocations.size())
+        throw std::out_of_range("Invalid sprite index");
+
+    auto& location = mLocations[index];
+
+    *chunk = &mChunks[location.chunk];
+
+    return (*chunk)->sprites[location.sprite];
+}
+
+
+// Replaces the source region, keeping the sprite's position and size.
+void SpriteLayer::Impl::SetSourceRectangle(size_t index, RECT const& sourceRectangle)
+{
+    Chunk* chunk;
+
+    auto& sprite = GetSprite(index, &chunk);
+
+    XMStoreFloat4A(&sprite.source, LoadRect(&sourceRectangle));
+
+    chunk->dirty = true;
+}
+
+
+void XM_CALLCONV SpriteLayer::Impl::SetColor(size_t index, FXMVECTOR color)
+{
+    Chunk* chunk;
+
+    auto& sprite = GetSprite(index, &chunk);
+
+    XMStoreFloat4A(&sprite.color, color);
+
+    chunk->dirty = true;
+}
+
+
+void SpriteLayer::Impl::Clear() noexcept
+{
+    mChunks.Clear();
+    mLocations.clear();
+}
+
+
+// Draws the visible chunks. SpriteBatch has already bound its shaders, states, and the
+// index buffer, which covers maxSpritesPerDraw sprites.
+_Use_decl_annotations_
+void SpriteLayer::Impl::Render(ID3D11DeviceContext* deviceContext, CXMMATRIX transform, size_t maxSpritesPerDraw)
+{
+    auto texture = mTexture.Get();
+
+    deviceContext->PSSetShaderResources(0, 1, &texture);
+
+    auto rebuild = [&](Chunk& chunk)
+    {
+        RebuildChunk(deviceContext, chunk);
+    };
+
+    auto draw = [&](Chunk& chunk)
+    {
+        auto vertexBuffer = chunk.vertexBuffer.Get();
+        UINT vertexStride = sizeof(VertexPositionColorTexture);
+        UINT vertexOffset = 0;
+
+        deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vertexOffset);
+
+        // Chunks longer than the index buffer are drawn in pieces, offset by the base vertex.
+        size_t count = chunk.sprites.size();
+
+        for (size_t start = 0; start < count; start += maxSpritesPerDraw)
+        {
+            size_t batchSize = std::min(count - start, maxSpritesPerDraw);
+
+            deviceContext->DrawIndexed(static_cast<UINT>(batchSize * IndicesPerSprite), 0, static_cast<INT>(start * VerticesPerSprite));
+        }
+    };
+
+    mChunks.Render(transform, rebuild, draw);
+}
+
+
+// Regenerates a chunk's vertices, updating its buffer in place when the sprite count is unchanged.
+_Use_decl_annotations_
+void SpriteLayer::Impl::RebuildChunk(ID3D11DeviceContext* deviceContext, Chunk& chunk)
+{
+    XMVECTOR textureSize = XMLoadFloat2(&mTextureSize);
+    XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+
+    size_t count = chunk.sprites.size();
+
+    mVertices.resize(count * VerticesPerSprite);
+
+    // The scalar path uses ordinary stores, as UpdateSubresource reads this straight back.
+    for (size_t i = 0; i < count; i++)
+    {
+        SpriteVertices::RenderSprite(&chunk.sprites[i], &mVertices[i * VerticesPerSprite], textureSize, inverseTextureSize);
+    }
+
+    if (chunk.vertexBuffer && chunk.vertexBufferSprites == count)
+    {
+        deviceContext->UpdateSubresource(chunk.vertexBuffer.Get(), 0, nullptr, mVertices.data(), 0, 0);
+    }
+    else
+    {
+        ThrowIfFailed(
+            CreateStaticBuffer(mDevice.Get(), mVertices, D3D11_BIND_VERTEX_BUFFER, chunk.vertexBuffer.ReleaseAndGetAddressOf())
+        );
+
+        SetDebugObjectName(chunk.vertexBuffer.Get(), "DirectXTK:SpriteLayer");
+
+        chunk.vertexBufferSprites = count;
+    }
+}
+
+
+// Public constructor.
+_Use_decl_annotations_
+SpriteLayer::SpriteLayer(ID3D11Device* device, ID3D11ShaderResourceView* texture, float chunkSize)
+  : pImpl(std::make_unique<Impl>(device, texture, chunkSize))
+{
+}
+
+
+// Move constructor.
+SpriteLayer::SpriteLayer(SpriteLayer&& moveFrom) noexcept
+  : pImpl(std::move(moveFrom.pImpl))
+{
+}
+
+
+// Move assignment.
+SpriteLayer& SpriteLayer::operator= (SpriteLayer&& moveFrom) noexcept
+{
+    pImpl = std::move(moveFrom.pImpl);
+    return *this;
+}
+
+
+// Public destructor.
+SpriteLayer::~SpriteLayer()
+{
+}
+
+
+_Use_decl_annotations_
+size_t XM_CALLCONV SpriteLayer::Add(XMFLOAT2 const& position,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    XMFLOAT2 const& origin,
+    float scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 4>(XMLoadFloat2(&position), XMLoadFloat(&scale)); // x, y, scale, scale
+
+    XMVECTOR originRotationDepth = XMVectorSet(origin.x, origin.y, rotation, layerDepth);
+
+    return pImpl->Add(destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+_Use_decl_annotations_
+size_t XM_CALLCONV SpriteLayer::Add(XMFLOAT2 const& position,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    XMFLOAT2 const& origin,
+    XMFLOAT2 const& scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(XMLoadFloat2(&position), XMLoadFloat2(&scale)); // x, y, scale.x, scale.y
+
+    XMVECTOR originRotationDepth = XMVectorSet(origin.x, origin.y, rotation, layerDepth);
+
+    return pImpl->Add(destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects));
+}
+
+
+_Use_decl_annotations_
+size_t XM_CALLCONV SpriteLayer::Add(RECT const& destinationRectangle,
+    RECT const* sourceRectangle,
+    FXMVECTOR color,
+    float rotation,
+    XMFLOAT2 const& origin,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = LoadRect(&destinationRectangle); // x, y, w, h
+
+    XMVECTOR originRotationDepth = XMVectorSet(origin.x, origin.y, rotation, layerDepth);
+
+    return pImpl->Add(destination, sourceRectangle, color, originRotationDepth, static_cast<unsigned int>(effects) | LayerSprite::DestSizeInPixels);
+}
+
+
+void SpriteLayer::SetSourceRectangle(size_t index, RECT const& sourceRectangle)
+{
+    pImpl->SetSourceRectangle(index, sourceRectangle);
+}
+
+
+void XM_CALLCONV SpriteLayer::SetColor(size_t index, FXMVECTOR color)
+{
+    pImpl->SetColor(index, color);
+}
+
+
+void SpriteLayer::Clear()
+{
+    pImpl->Clear();
+}
+
+
+size_t SpriteLayer::GetSpriteCount() const noexcept
+{
+    return pImpl->GetSpriteCount();
+}
+
+
+size_t SpriteLayer::GetChunkCount() const noexcept
+{
+    return pImpl->GetChunkCount();
+}
+
+
+size_t SpriteLayer::GetDrawnChunkCount() const noexcept
+{
+    return pImpl->GetDrawnChunkCount();
+}
+
+
+size_t SpriteLayer::GetRebuiltChunkCount() const noexcept
+{
+    return pImpl->GetRebuiltChunkCount();
+}
+
+
+_Use_decl_annotations_
+void SpriteLayer::Render(ID3D11DeviceContext* deviceContext, CXMMATRIX transform, size_t maxSpritesPerDraw)
+{
+    pImpl->Render(deviceContext, transform, maxSpritesPerDraw);
+}
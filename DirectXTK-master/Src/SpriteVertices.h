@@ -0,0 +1,437 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteVertices.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DirectX
+{
+    // Sprite queueing and vertex generation for SpriteBatch. TSprite needs XMFLOAT4A source,
+    // destination, color and originRotationDepth members, a flags field whose low two bits are
+    // the SpriteEffects, and the SourceInTexels and DestSizeInPixels flag constants. TVertex is
+    // laid out like VertexPositionColorTexture. Nothing here needs Direct3D, so it can be tested
+    // without a device.
+    namespace SpriteVertices
+    {
+        constexpr size_t VerticesPerSprite = 4;
+
+        // Four vertices of 36 bytes, so a sprite is exactly nine 16 byte stores.
+        constexpr size_t VertexBytes = 36;
+        constexpr size_t VectorsPerSprite = VerticesPerSprite * VertexBytes / sizeof(XMFLOAT4A);
+
+        static_assert(VectorsPerSprite * sizeof(XMFLOAT4A) == VerticesPerSprite * VertexBytes, "Sprites must be a whole number of vectors");
+
+
+        // Fills in a queued sprite from the Draw parameters, for a source region given as
+        // (x, y, width, height) in texels. The caller sets the texture.
+        template<typename TSprite>
+        void XM_CALLCONV SetSprite(_Out_ TSprite* sprite,
+            FXMVECTOR destination,
+            FXMVECTOR source,
+            FXMVECTOR color,
+            GXMVECTOR originRotationDepth,
+            unsigned int flags) noexcept
+        {
+            XMVECTOR dest = destination;
+
+            // If the destination size is relative to the source region, convert it to pixels.
+            if (!(flags & TSprite::DestSizeInPixels))
+            {
+                dest = XMVectorPermute<0, 1, 6, 7>(dest, XMVectorMultiply(dest, source)); // dest.zw *= source.zw
+            }
+
+            XMStoreFloat4A(&sprite->source, source);
+            XMStoreFloat4A(&sprite->destination, dest);
+            XMStoreFloat4A(&sprite->color, color);
+            XMStoreFloat4A(&sprite->originRotationDepth, originRotationDepth);
+
+            sprite->flags = flags | TSprite::SourceInTexels | TSprite::DestSizeInPixels;
+        }
+
+
+        // Returns the origin that draws a SpriteFont glyph with the given source region (x, y,
+        // width, height in texels) at offset along a string whose origin is baseOrigin. Mirroring
+        // reverses the axes the string runs along, and moves each glyph's origin to its bottom
+        // and/or right instead of top left. Used by both DrawString and DrawGlyphRun, so the two
+        // place glyphs the same.
+        inline XMVECTOR XM_CALLCONV GlyphOrigin(FXMVECTOR source, FXMVECTOR offset, FXMVECTOR baseOrigin, unsigned int effects) noexcept
+        {
+            // Which way to move along each axis, and which axes are mirrored, per SpriteEffects value.
+            static const XMVECTORF32 axisDirectionTable[4] =
+            {
+                { { { -1, -1, 0, 0 } } },
+                { { {  1, -1, 0, 0 } } },
+                { { { -1,  1, 0, 0 } } },
+                { { {  1,  1, 0, 0 } } },
+            };
+
+            static const XMVECTORF32 axisIsMirroredTable[4] =
+            {
+                { { { 0, 0, 0, 0 } } },
+                { { { 1, 0, 0, 0 } } },
+                { { { 0, 1, 0, 0 } } },
+                { { { 1, 1, 0, 0 } } },
+            };
+
+            const unsigned int mirrorBits = effects & 3u;
+
+            XMVECTOR origin = XMVectorMultiplyAdd(offset, axisDirectionTable[mirrorBits], baseOrigin);
+
+            if (mirrorBits)
+            {
+                origin = XMVectorMultiplyAdd(XMVectorSwizzle<2, 3, 2, 3>(source), axisIsMirroredTable[mirrorBits], origin);
+            }
+
+            return origin;
+        }
+
+
+        // Generates vertex data for drawing a single sprite.
+        template<typename TSprite, typename TVertex>
+        void XM_CALLCONV RenderSprite(_In_ TSprite const* sprite,
+            _Out_writes_(VerticesPerSprite) TVertex* vertices,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize) noexcept
+        {
+            static_assert(sizeof(TVertex) == VertexBytes, "Vertex layout does not match the batched path");
+
+            // Load sprite parameters into SIMD registers.
+            XMVECTOR source = XMLoadFloat4A(&sprite->source);
+            XMVECTOR destination = XMLoadFloat4A(&sprite->destination);
+            XMVECTOR color = XMLoadFloat4A(&sprite->color);
+            XMVECTOR originRotationDepth = XMLoadFloat4A(&sprite->originRotationDepth);
+
+            float rotation = sprite->originRotationDepth.z;
+            unsigned int flags = sprite->flags;
+
+            // Extract the source and destination sizes into separate vectors.
+            XMVECTOR sourceSize = XMVectorSwizzle<2, 3, 2, 3>(source);
+            XMVECTOR destinationSize = XMVectorSwizzle<2, 3, 2, 3>(destination);
+
+            // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
+            XMVECTOR isZeroMask = XMVectorEqual(sourceSize, XMVectorZero());
+            XMVECTOR nonZeroSourceSize = XMVectorSelect(sourceSize, g_XMEpsilon, isZeroMask);
+
+            XMVECTOR origin = XMVectorDivide(originRotationDepth, nonZeroSourceSize);
+
+            // Convert the source region from texels to mod-1 texture coordinate format.
+            if (flags & TSprite::SourceInTexels)
+            {
+                source = XMVectorMultiply(source, inverseTextureSize);
+                sourceSize = XMVectorMultiply(sourceSize, inverseTextureSize);
+            }
+            else
+            {
+                origin = XMVectorMultiply(origin, inverseTextureSize);
+            }
+
+            // If the destination size is relative to the source region, convert it to pixels.
+            if (!(flags & TSprite::DestSizeInPixels))
+            {
+                destinationSize = XMVectorMultiply(destinationSize, textureSize);
+            }
+
+            // Compute a 2x2 rotation matrix.
+            XMVECTOR rotationMatrix1;
+            XMVECTOR rotationMatrix2;
+
+            if (rotation != 0)
+            {
+                float sin, cos;
+
+                XMScalarSinCos(&sin, &cos, rotation);
+
+                XMVECTOR sinV = XMLoadFloat(&sin);
+                XMVECTOR cosV = XMLoadFloat(&cos);
+
+                rotationMatrix1 = XMVectorMergeXY(cosV, sinV);
+                rotationMatrix2 = XMVectorMergeXY(XMVectorNegate(sinV), cosV);
+            }
+            else
+            {
+                rotationMatrix1 = g_XMIdentityR0;
+                rotationMatrix2 = g_XMIdentityR1;
+            }
+
+            // The four corner vertices are computed by transforming these unit-square positions.
+            static const XMVECTORF32 cornerOffsets[VerticesPerSprite] =
+            {
+                { { { 0, 0, 0, 0 } } },
+                { { { 1, 0, 0, 0 } } },
+                { { { 0, 1, 0, 0 } } },
+                { { { 1, 1, 0, 0 } } },
+            };
+
+            // Tricksy alert! Texture coordinates are computed from the same cornerOffsets
+            // table as vertex positions, but if the sprite is mirrored, this table
+            // must be indexed in a different order. This is done as follows:
+            //
+            //    position = cornerOffsets[i]
+            //    texcoord = cornerOffsets[i ^ SpriteEffects]
+
+            const unsigned int mirrorBits = flags & 3u;
+
+            // Generate the four output vertices.
+            for (size_t i = 0; i < VerticesPerSprite; i++)
+            {
+                // Calculate position.
+                XMVECTOR cornerOffset = XMVectorMultiply(XMVectorSubtract(cornerOffsets[i], origin), destinationSize);
+
+                // Apply 2x2 rotation matrix.
+                XMVECTOR position1 = XMVectorMultiplyAdd(XMVectorSplatX(cornerOffset), rotationMatrix1, destination);
+                XMVECTOR position2 = XMVectorMultiplyAdd(XMVectorSplatY(cornerOffset), rotationMatrix2, position1);
+
+                // Set z = depth.
+                XMVECTOR position = XMVectorPermute<0, 1, 7, 6>(position2, originRotationDepth);
+
+                // Write position as a Float4, even though VertexPositionColor::position is an XMFLOAT3.
+                // This is faster, and harmless as we are just clobbering the first element of the
+                // following color field, which will immediately be overwritten with its correct value.
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertices[i].position), position);
+
+                // Write the color.
+                XMStoreFloat4(&vertices[i].color, color);
+
+                // Compute and write the texture coordinate.
+                XMVECTOR textureCoordinate = XMVectorMultiplyAdd(cornerOffsets[static_cast<unsigned int>(i) ^ mirrorBits], sourceSize, source);
+
+                XMStoreFloat2(&vertices[i].textureCoordinate, textureCoordinate);
+            }
+        }
+
+
+        // Generates vertex data for four sprites at once. Each vector lane holds one sprite, so
+        // the per-sprite flags become lane masks rather than branches. Every lane goes through
+        // exactly the same operations as RenderSprite, so the output is bit-identical to it.
+        // vertices must be 16 byte aligned.
+        template<typename TSprite, typename TVertex>
+        void XM_CALLCONV RenderSprites4(_In_reads_(4) TSprite const* const* sprites,
+            _Out_writes_(4 * VerticesPerSprite) TVertex* vertices,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize) noexcept
+        {
+            static_assert(sizeof(TVertex) == VertexBytes, "Vertex layout does not match the batched path");
+
+            assert((reinterpret_cast<uintptr_t>(vertices) & 15) == 0);
+
+            // Load the four sprites and transpose into one vector per field.
+            XMMATRIX source = XMMatrixTranspose(XMMATRIX(
+                XMLoadFloat4A(&sprites[0]->source),
+                XMLoadFloat4A(&sprites[1]->source),
+                XMLoadFloat4A(&sprites[2]->source),
+                XMLoadFloat4A(&sprites[3]->source)));
+
+            XMMATRIX destination = XMMatrixTranspose(XMMATRIX(
+                XMLoadFloat4A(&sprites[0]->destination),
+                XMLoadFloat4A(&sprites[1]->destination),
+                XMLoadFloat4A(&sprites[2]->destination),
+                XMLoadFloat4A(&sprites[3]->destination)));
+
+            XMMATRIX originRotationDepth = XMMatrixTranspose(XMMATRIX(
+                XMLoadFloat4A(&sprites[0]->originRotationDepth),
+                XMLoadFloat4A(&sprites[1]->originRotationDepth),
+                XMLoadFloat4A(&sprites[2]->originRotationDepth),
+                XMLoadFloat4A(&sprites[3]->originRotationDepth)));
+
+            const unsigned int flags[4] = { sprites[0]->flags, sprites[1]->flags, sprites[2]->flags, sprites[3]->flags };
+
+            XMVECTOR sourceX = source.r[0];
+            XMVECTOR sourceY = source.r[1];
+            XMVECTOR sourceWidth = source.r[2];
+            XMVECTOR sourceHeight = source.r[3];
+
+            XMVECTOR destinationWidth = destination.r[2];
+            XMVECTOR destinationHeight = destination.r[3];
+
+            // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
+            XMVECTOR zero = XMVectorZero();
+
+            XMVECTOR originX = XMVectorDivide(originRotationDepth.r[0], XMVectorSelect(sourceWidth, g_XMEpsilon, XMVectorEqual(sourceWidth, zero)));
+            XMVECTOR originY = XMVectorDivide(originRotationDepth.r[1], XMVectorSelect(sourceHeight, g_XMEpsilon, XMVectorEqual(sourceHeight, zero)));
+
+            XMVECTOR textureWidth = XMVectorSplatX(textureSize);
+            XMVECTOR textureHeight = XMVectorSplatY(textureSize);
+            XMVECTOR inverseTextureWidth = XMVectorSplatX(inverseTextureSize);
+            XMVECTOR inverseTextureHeight = XMVectorSplatY(inverseTextureSize);
+
+            // Convert the source region from texels to mod-1 texture coordinate format, or
+            // the origin for sprites whose source is already in that format.
+            XMVECTOR sourceInTexels = XMVectorSelectControl(
+                (flags[0] & TSprite::SourceInTexels) ? 1u : 0u,
+                (flags[1] & TSprite::SourceInTexels) ? 1u : 0u,
+                (flags[2] & TSprite::SourceInTexels) ? 1u : 0u,
+                (flags[3] & TSprite::SourceInTexels) ? 1u : 0u);
+
+            sourceX = XMVectorSelect(sourceX, XMVectorMultiply(sourceX, inverseTextureWidth), sourceInTexels);
+            sourceY = XMVectorSelect(sourceY, XMVectorMultiply(sourceY, inverseTextureHeight), sourceInTexels);
+            sourceWidth = XMVectorSelect(sourceWidth, XMVectorMultiply(sourceWidth, inverseTextureWidth), sourceInTexels);
+            sourceHeight = XMVectorSelect(sourceHeight, XMVectorMultiply(sourceHeight, inverseTextureHeight), sourceInTexels);
+
+            originX = XMVectorSelect(XMVectorMultiply(originX, inverseTextureWidth), originX, sourceInTexels);
+            originY = XMVectorSelect(XMVectorMultiply(originY, inverseTextureHeight), originY, sourceInTexels);
+
+            // If the destination size is relative to the source region, convert it to pixels.
+            XMVECTOR destSizeInPixels = XMVectorSelectControl(
+                (flags[0] & TSprite::DestSizeInPixels) ? 1u : 0u,
+                (flags[1] & TSprite::DestSizeInPixels) ? 1u : 0u,
+                (flags[2] & TSprite::DestSizeInPixels) ? 1u : 0u,
+                (flags[3] & TSprite::DestSizeInPixels) ? 1u : 0u);
+
+            destinationWidth = XMVectorSelect(XMVectorMultiply(destinationWidth, textureWidth), destinationWidth, destSizeInPixels);
+            destinationHeight = XMVectorSelect(XMVectorMultiply(destinationHeight, textureHeight), destinationHeight, destSizeInPixels);
+
+            // Rotation columns. Unrotated sprites use exactly the identity values, like RenderSprite.
+            XMVECTOR cos = g_XMOne;
+            XMVECTOR sin = zero;
+            XMVECTOR negativeSin = zero;
+
+            XMVECTOR isRotated = XMVectorNotEqual(originRotationDepth.r[2], zero);
+
+            if (!XMVector4EqualInt(isRotated, XMVectorFalseInt()))
+            {
+                float sinLanes[4];
+                float cosLanes[4];
+
+                for (size_t j = 0; j < 4; j++)
+                {
+                    float rotation = sprites[j]->originRotationDepth.z;
+
+                    if (rotation != 0)
+                    {
+                        XMScalarSinCos(&sinLanes[j], &cosLanes[j], rotation);
+                    }
+                    else
+                    {
+                        sinLanes[j] = 0;
+                        cosLanes[j] = 1;
+                    }
+                }
+
+                // Built from registers rather than loaded, which would stall on the scalar stores.
+                cos = XMVectorSet(cosLanes[0], cosLanes[1], cosLanes[2], cosLanes[3]);
+                sin = XMVectorSet(sinLanes[0], sinLanes[1], sinLanes[2], sinLanes[3]);
+                negativeSin = XMVectorSelect(zero, XMVectorNegate(sin), isRotated);
+            }
+
+            // Mirrored sprites index the corner table with i ^ SpriteEffects for their texture
+            // coordinates, see RenderSprite. Per lane that is a choice between 0 and 1.
+            XMVECTOR flipHorizontally = XMVectorSelectControl(flags[0] & 1u, flags[1] & 1u, flags[2] & 1u, flags[3] & 1u);
+            XMVECTOR flipVertically = XMVectorSelectControl((flags[0] >> 1) & 1u, (flags[1] >> 1) & 1u, (flags[2] >> 1) & 1u, (flags[3] >> 1) & 1u);
+
+            const XMVECTOR textureCornerX[2] = { XMVectorSelect(zero, g_XMOne, flipHorizontally), XMVectorSelect(g_XMOne, zero, flipHorizontally) };
+            const XMVECTOR textureCornerY[2] = { XMVectorSelect(zero, g_XMOne, flipVertically), XMVectorSelect(g_XMOne, zero, flipVertically) };
+
+            const XMVECTOR cornerOffsets[2] = { zero, g_XMOne };
+
+            XMVECTOR positionX[VerticesPerSprite];
+            XMVECTOR positionY[VerticesPerSprite];
+            XMVECTOR textureCoordinateU[VerticesPerSprite];
+            XMVECTOR textureCoordinateV[VerticesPerSprite];
+
+            for (size_t i = 0; i < VerticesPerSprite; i++)
+            {
+                XMVECTOR cornerOffsetX = XMVectorMultiply(XMVectorSubtract(cornerOffsets[i & 1], originX), destinationWidth);
+                XMVECTOR cornerOffsetY = XMVectorMultiply(XMVectorSubtract(cornerOffsets[i >> 1], originY), destinationHeight);
+
+                // Apply 2x2 rotation matrix.
+                XMVECTOR position1X = XMVectorMultiplyAdd(cornerOffsetX, cos, destination.r[0]);
+                XMVECTOR position1Y = XMVectorMultiplyAdd(cornerOffsetX, sin, destination.r[1]);
+
+                positionX[i] = XMVectorMultiplyAdd(cornerOffsetY, negativeSin, position1X);
+                positionY[i] = XMVectorMultiplyAdd(cornerOffsetY, cos, position1Y);
+
+                textureCoordinateU[i] = XMVectorMultiplyAdd(textureCornerX[i & 1], sourceWidth, sourceX);
+                textureCoordinateV[i] = XMVectorMultiplyAdd(textureCornerY[i >> 1], sourceHeight, sourceY);
+            }
+
+            // A sprite's four vertices are 36 floats, or nine whole vectors:
+            //
+            //    x0 y0 z  r | g  b  a  u0 | v0 x1 y1 z  | r  g  b  a  | u1 v1 x2 y2 |
+            //    z  r  g  b | a  u2 v2 x3 | y3 z  r  g  | b  a  u3 v3
+            //
+            // Each of those is four per-sprite values, so transposing the matching four lane
+            // vectors yields that output vector for all four sprites at once.
+            XMMATRIX colors(
+                XMLoadFloat4A(&sprites[0]->color),
+                XMLoadFloat4A(&sprites[1]->color),
+                XMLoadFloat4A(&sprites[2]->color),
+                XMLoadFloat4A(&sprites[3]->color));
+
+            XMMATRIX colorLanes = XMMatrixTranspose(colors);
+
+            XMVECTOR depth = originRotationDepth.r[3];
+            XMVECTOR red = colorLanes.r[0];
+            XMVECTOR green = colorLanes.r[1];
+            XMVECTOR blue = colorLanes.r[2];
+            XMVECTOR alpha = colorLanes.r[3];
+
+            const XMMATRIX vectors[VectorsPerSprite] =
+            {
+                XMMatrixTranspose(XMMATRIX(positionX[0], positionY[0], depth, red)),
+                XMMatrixTranspose(XMMATRIX(green, blue, alpha, textureCoordinateU[0])),
+                XMMatrixTranspose(XMMATRIX(textureCoordinateV[0], positionX[1], positionY[1], depth)),
+                colors,
+                XMMatrixTranspose(XMMATRIX(textureCoordinateU[1], textureCoordinateV[1], positionX[2], positionY[2])),
+                XMMatrixTranspose(XMMATRIX(depth, red, green, blue)),
+                XMMatrixTranspose(XMMATRIX(alpha, textureCoordinateU[2], textureCoordinateV[2], positionX[3])),
+                XMMatrixTranspose(XMMATRIX(positionY[3], depth, red, green)),
+                XMMatrixTranspose(XMMATRIX(blue, alpha, textureCoordinateU[3], textureCoordinateV[3])),
+            };
+
+            // Write the sprites out in memory order so each one fills whole write-combining lines.
+            // Plain stores rather than streaming ones: a mapped buffer in write-combined memory
+            // combines them just the same, and streaming stores are much slower when the buffer
+            // is ordinary cached memory, as it can be with WARP or a shared memory GPU.
+            auto output = reinterpret_cast<XMFLOAT4A*>(vertices);
+
+            for (size_t j = 0; j < 4; j++)
+            {
+                for (size_t k = 0; k < VectorsPerSprite; k++)
+                {
+                    XMStoreFloat4A(output++, vectors[k].r[j]);
+                }
+            }
+        }
+
+
+        // Generates vertex data for a run of sprites, four at a time where the output is
+        // aligned.
+        template<typename TSprite, typename TVertex>
+        void XM_CALLCONV RenderSprites(_In_reads_(count) TSprite const* const* sprites,
+            size_t count,
+            _Out_writes_(count * VerticesPerSprite) TVertex* vertices,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize) noexcept
+        {
+            static_assert(sizeof(TVertex) == VertexBytes, "Vertex layout does not match the batched path");
+
+            size_t i = 0;
+
+            // A sprite is a whole number of vectors, so if the first one is aligned they all are.
+            if (count >= 4 && (reinterpret_cast<uintptr_t>(vertices) & 15) == 0)
+            {
+                for (; i + 4 <= count; i += 4)
+                {
+                    RenderSprites4(sprites + i, vertices + i * VerticesPerSprite, textureSize, inverseTextureSize);
+                }
+            }
+
+            for (; i < count; i++)
+            {
+                RenderSprite(sprites[i], vertices + i * VerticesPerSprite, textureSize, inverseTextureSize);
+            }
+        }
+    }
+}
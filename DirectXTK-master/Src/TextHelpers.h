@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------
+// File: TextHelpers.h
+//
+// Character decoding shared by SpriteFont and DynamicSpriteFont
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+
+
+namespace DirectX
+{
+    namespace TextHelpers
+    {
+        constexpr uint32_t ReplacementCharacter = 0xFFFD;
+
+        // Decodes the next code point of a UTF-16 string, combining surrogate pairs. A surrogate
+        // without its other half becomes U+FFFD.
+        inline uint32_t NextCharacter(_Inout_ wchar_t const*& text) noexcept
+        {
+            const auto character = static_cast<uint32_t>(*text++);
+
+            if (character < 0xD800 || character > 0xDFFF)
+                return character;
+
+            if (character <= 0xDBFF)
+            {
+                const auto low = static_cast<uint32_t>(*text);
+
+                // A null terminator fails this test, so decoding never reads past the string.
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    text++;
+                    return 0x10000 + ((character - 0xD800) << 10) + (low - 0xDC00);
+                }
+            }
+
+            return ReplacementCharacter;
+        }
+
+        // Decodes the next code point of a UTF-8 string. Malformed input becomes U+FFFD, one for
+        // each maximal invalid subpart, which is what MultiByteToWideChar produced before.
+        inline uint32_t NextCharacter(_Inout_ char const*& text) noexcept
+        {
+            auto bytes = reinterpret_cast<uint8_t const*>(text);
+            uint32_t character = bytes[0];
+
+            if (character < 0x80)
+            {
+                text++;
+                return character;
+            }
+
+            size_t length;
+
+            if (character >= 0xC2 && character <= 0xDF)
+            {
+                length = 2;
+                character &= 0x1F;
+            }
+            else if (character >= 0xE0 && character <= 0xEF)
+            {
+                length = 3;
+                character &= 0x0F;
+            }
+            else if (character >= 0xF0 && character <= 0xF4)
+            {
+                length = 4;
+                character &= 0x07;
+            }
+            else
+            {
+                text++;
+                return ReplacementCharacter;
+            }
+
+            // The second byte range is narrower after some lead bytes, which rules out overlong
+            // forms, surrogates, and values above U+10FFFF.
+            uint8_t lower = 0x80;
+            uint8_t upper = 0xBF;
+
+            switch (bytes[0])
+            {
+                case 0xE0: lower = 0xA0; break;
+                case 0xED: upper = 0x9F; break;
+                case 0xF0: lower = 0x90; break;
+                case 0xF4: upper = 0x8F; break;
+                default: break;
+            }
+
+            for (size_t i = 1; i < length; i++)
+            {
+                // A null terminator fails this test, so decoding never reads past the string.
+                if (bytes[i] < lower || bytes[i] > upper)
+                {
+                    text += i;
+                    return ReplacementCharacter;
+                }
+
+                character = (character << 6) | (bytes[i] & 0x3Fu);
+
+                lower = 0x80;
+                upper = 0xBF;
+            }
+
+            text += length;
+            return character;
+        }
+
+        // SpriteFont's decoding, which passes UTF-16 surrogates through one at a time as it always
+        // has, so fonts that map each half to a glyph keep drawing the same. UTF-8 is decoded as
+        // NextCharacter does.
+        inline uint32_t NextCharacterUnpaired(_Inout_ wchar_t const*& text) noexcept
+        {
+            return static_cast<uint32_t>(*text++);
+        }
+
+        inline uint32_t NextCharacterUnpaired(_Inout_ char const*& text) noexcept
+        {
+            return NextCharacter(text);
+        }
+
+        inline bool IsWhitespace(uint32_t character) noexcept
+        {
+            return character <= 0xFFFF && iswspace(static_cast<wchar_t>(character));
+        }
+    }
+}
@@ -0,0 +1,288 @@
+//--------------------------------------------------------------------------------------
+// File: TextLayout.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "TextHelpers.h"
+
+#include <DirectXMath.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Glyph layout for SpriteFont, and its cache of the most recently used strings. Holds the
+    // line spacing and default glyph, the font settings a layout depends on, so changing either
+    // drops the cache. TGlyph is laid out like SpriteFont::Glyph. Nothing here needs Direct3D,
+    // so it can be tested without a device.
+    template<typename TGlyph>
+    class TextLayout
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            uint64_t glyphsReused;          // Glyphs of the strings found in the cache
+            uint64_t glyphsLaidOut;         // Glyphs of the strings laid out on a miss
+            double layoutMilliseconds;      // Time spent laying out those
+            size_t strings;
+            size_t glyphs;
+        };
+
+        // One glyph of a string: what the layout action is passed, and whether it is
+        // whitespace that gets skipped when ignoring whitespace.
+        struct Glyph
+        {
+            TGlyph const* glyph;
+            float x;
+            float y;
+            float advance;
+            bool skippable;
+        };
+
+        struct Layout
+        {
+            std::string text;       // The string's bytes, UTF-8 or UTF-16
+            size_t encoding;
+            std::vector<Glyph> glyphs;
+
+            // The glyphs DrawString draws, as SpriteBatch::DrawGlyphRun takes them: source
+            // rectangles in texels, and top left offsets from the start of the string.
+            std::vector<XMFLOAT4> sources;
+            std::vector<XMFLOAT2> offsets;
+        };
+
+        TextLayout() noexcept
+            : mLineSpacing(0),
+            mDefaultGlyph(nullptr),
+            mCapacity(0),
+            mStatistics{}
+        {
+        }
+
+        TextLayout(TextLayout const&) = delete;
+        TextLayout& operator= (TextLayout const&) = delete;
+
+        float GetLineSpacing() const noexcept { return mLineSpacing; }
+
+        void SetLineSpacing(float spacing) noexcept
+        {
+            if (spacing != mLineSpacing)
+            {
+                Clear();
+            }
+
+            mLineSpacing = spacing;
+        }
+
+        TGlyph const* GetDefaultGlyph() const noexcept { return mDefaultGlyph; }
+
+        void SetDefaultGlyph(_In_opt_ TGlyph const* glyph) noexcept
+        {
+            if (glyph != mDefaultGlyph)
+            {
+                Clear();
+            }
+
+            mDefaultGlyph = glyph;
+        }
+
+        // The core glyph layout algorithm, shared between DrawString and MeasureString. Calls
+        // action(glyph, x, y, advance, skippable) for each glyph, with the glyphs findGlyph
+        // returns for each code point.
+        template<typename TChar, typename TFindGlyph, typename TAction>
+        void LayoutGlyphs(_In_z_ TChar const* text, TFindGlyph&& findGlyph, TAction&& action) const
+        {
+            float x = 0;
+            float y = 0;
+
+            while (*text)
+            {
+                const uint32_t character = TextHelpers::NextCharacterUnpaired(text);
+
+                switch (character)
+                {
+                    case '\r':
+                        // Skip carriage returns.
+                        continue;
+
+                    case '\n':
+                        // New line.
+                        x = 0;
+                        y += mLineSpacing;
+                        break;
+
+                    default:
+                        // Output this character.
+                        TGlyph const* glyph = findGlyph(character);
+
+                        x += glyph->XOffset;
+
+                        if (x < 0)
+                            x = 0;
+
+                        float advance = float(glyph->Subrect.right) - float(glyph->Subrect.left) + glyph->XAdvance;
+
+                        bool skippable = TextHelpers::IsWhitespace(character)
+                            && ((glyph->Subrect.right - glyph->Subrect.left) <= 1)
+                            && ((glyph->Subrect.bottom - glyph->Subrect.top) <= 1);
+
+                        action(glyph, x, y, advance, skippable);
+
+                        x += advance;
+                        break;
+                }
+            }
+        }
+
+        // Returns the cached layout of a string, laying it out on a miss and evicting the least
+        // recently used, or nullptr while the cache is off.
+        template<typename TChar, typename TFindGlyph>
+        Layout const* Find(_In_z_ TChar const* text, TFindGlyph&& findGlyph)
+        {
+            if (!mCapacity)
+                return nullptr;
+
+            const size_t encoding = (sizeof(TChar) == 1) ? 0 : 1;
+
+            std::string_view key(reinterpret_cast<char const*>(text), std::char_traits<TChar>::length(text) * sizeof(TChar));
+
+            auto& lookup = mLookup[encoding];
+
+            auto it = lookup.find(key);
+
+            if (it != lookup.end())
+            {
+                mStatistics.hits++;
+                mStatistics.glyphsReused += it->second->glyphs.size();
+
+                mLayouts.splice(mLayouts.begin(), mLayouts, it->second);
+
+                return &mLayouts.front();
+            }
+
+            mStatistics.misses++;
+
+            // Lay out before touching the cache, so a character that is not in the font leaves it unchanged.
+            auto start = std::chrono::steady_clock::now();
+
+            Layout layout;
+
+            layout.text.assign(key);
+            layout.encoding = encoding;
+
+            LayoutGlyphs(text, findGlyph, [&](TGlyph const* glyph, float x, float y, float advance, bool skippable)
+            {
+                layout.glyphs.push_back(Glyph{ glyph, x, y, advance, skippable });
+
+                if (!skippable)
+                {
+                    // Converted as SpriteBatch converts a source RECT, right/bottom to width/height.
+                    XMVECTOR source = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&glyph->Subrect)), 0);
+
+                    source = XMVectorSubtract(source, XMVectorPermute<0, 1, 4, 5>(g_XMZero, source));
+
+                    layout.sources.emplace_back();
+                    XMStoreFloat4(&layout.sources.back(), source);
+
+                    layout.offsets.emplace_back(x, y + glyph->YOffset);
+                }
+            });
+
+            mStatistics.glyphsLaidOut += layout.glyphs.size();
+            mStatistics.layoutMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            Trim(mCapacity - 1);
+
+            mLayouts.push_front(std::move(layout));
+
+            auto& added = mLayouts.front();
+
+            lookup.emplace(std::string_view(added.text), mLayouts.begin());
+
+            mStatistics.strings = mLayouts.size();
+            mStatistics.glyphs += added.glyphs.size();
+
+            return &added;
+        }
+
+        // Resizes the cache, zero turns it off.
+        void SetCapacity(size_t strings) noexcept
+        {
+            mCapacity = strings;
+
+            Trim(strings);
+        }
+
+        size_t GetCapacity() const noexcept { return mCapacity; }
+
+        void Clear() noexcept
+        {
+            mLayouts.clear();
+            mLookup[0].clear();
+            mLookup[1].clear();
+
+            mStatistics.strings = 0;
+            mStatistics.glyphs = 0;
+        }
+
+        Statistics const& GetStatistics() const noexcept { return mStatistics; }
+
+        // Zeroes the counters, leaving the cache contents.
+        void ResetStatistics() noexcept
+        {
+            mStatistics.hits = 0;
+            mStatistics.misses = 0;
+            mStatistics.evictions = 0;
+            mStatistics.glyphsReused = 0;
+            mStatistics.glyphsLaidOut = 0;
+            mStatistics.layoutMilliseconds = 0;
+        }
+
+    private:
+        // Evicts least recently used layouts until at most count remain.
+        void Trim(size_t count) noexcept
+        {
+            while (mLayouts.size() > count)
+            {
+                auto& oldest = mLayouts.back();
+
+                mLookup[oldest.encoding].erase(std::string_view(oldest.text));
+                mStatistics.glyphs -= oldest.glyphs.size();
+                mStatistics.evictions++;
+
+                mLayouts.pop_back();
+            }
+
+            mStatistics.strings = mLayouts.size();
+        }
+
+        float mLineSpacing;
+        TGlyph const* mDefaultGlyph;
+
+        size_t mCapacity;
+        Statistics mStatistics;
+
+        // Most recently used first. The lookups are per encoding, as a UTF-16 string can have
+        // the same bytes as a different UTF-8 one, and view the text held by each layout.
+        std::list<Layout> mLayouts;
+        std::unordered_map<std::string_view, typename std::list<Layout>::iterator> mLookup[2];
+    };
+}
@@ -0,0 +1,297 @@
+//--------------------------------------------------------------------------------------
+// File: DDSStreamLayoutTests.cpp
+//
+// Tests for the mip level offsets DDSTextureStreamer reads a DDS file with. Files are
+// generated in memory for the legacy and DX10 headers, compressed and uncompressed formats,
+// arrays and cubemaps, and every offset is checked against an independent computation.
+// Needs no Direct3D device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "DDSStreamLayout.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::DDSStreaming;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    struct FileDesc
+    {
+        uint32_t    width = 1;
+        uint32_t    height = 1;
+        uint32_t    mipCount = 1;
+        uint32_t    fourCC = 0;                     // Legacy header when not 0
+        bool        rgba = false;                   // Legacy 32 bit RGBA masks
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;   // DX10 header when not UNKNOWN
+        uint32_t    arraySize = 1;
+        bool        cubeMap = false;
+        bool        volume = false;
+        size_t      payload = 0;
+    };
+
+    std::vector<uint8_t> MakeDDS(const FileDesc& desc)
+    {
+        const bool dx10 = desc.format != DXGI_FORMAT_UNKNOWN;
+        std::vector<uint8_t> file(sizeof(uint32_t) + sizeof(DDS_HEADER) + (dx10 ? sizeof(DDS_HEADER_DXT10) : 0) + desc.payload, 0xcd);
+
+        memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+
+        DDS_HEADER header = {};
+        header.size = sizeof(DDS_HEADER);
+        header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+        header.width = desc.width;
+        header.height = desc.height;
+        header.mipMapCount = desc.mipCount;
+        if (desc.volume)
+        {
+            header.flags |= DDS_HEADER_FLAGS_VOLUME;
+            header.depth = 4;
+        }
+        if (desc.rgba)
+        {
+            header.ddspf.flags = DDS_RGBA;
+            header.ddspf.RGBBitCount = 32;
+            header.ddspf.RBitMask = 0x000000ff;
+            header.ddspf.GBitMask = 0x0000ff00;
+            header.ddspf.BBitMask = 0x00ff0000;
+            header.ddspf.ABitMask = 0xff000000;
+        }
+        else
+        {
+            header.ddspf.flags = DDS_FOURCC;
+            header.ddspf.fourCC = dx10 ? MakeFourCC('D', 'X', '1', '0') : desc.fourCC;
+        }
+        if (desc.cubeMap && !dx10)
+        {
+            header.caps2 = DDS_CUBEMAP | DDS_CUBEMAP_ALLFACES;
+        }
+        memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+
+        if (dx10)
+        {
+            DDS_HEADER_DXT10 ext = {};
+            ext.dxgiFormat = desc.format;
+            ext.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+            ext.arraySize = desc.arraySize;
+            ext.miscFlag = desc.cubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0u;
+            memcpy(file.data() + sizeof(uint32_t) + sizeof(header), &ext, sizeof(ext));
+        }
+
+        return file;
+    }
+
+    size_t LevelBytes(size_t width, size_t height, size_t elementBytes, bool compressed)
+    {
+        if (compressed)
+            return std::max<size_t>(1, (width + 3) / 4) * std::max<size_t>(1, (height + 3) / 4) * elementBytes;
+
+        return width * height * elementBytes;
+    }
+
+    size_t ChainBytes(size_t width, size_t height, size_t mipCount, size_t elementBytes, bool compressed)
+    {
+        size_t bytes = 0;
+        for (size_t mip = 0; mip < mipCount; ++mip)
+        {
+            bytes += LevelBytes(width, height, elementBytes, compressed);
+            width = std::max<size_t>(width / 2, 1);
+            height = std::max<size_t>(height / 2, 1);
+        }
+        return bytes;
+    }
+
+    // items is the number of 2D surfaces in the file, 6 per cubemap
+    void TestLayout(const char* name, FileDesc desc, size_t items, size_t elementBytes, bool compressed)
+    {
+        const size_t chain = ChainBytes(desc.width, desc.height, desc.mipCount, elementBytes, compressed);
+        desc.payload = chain * items;
+        auto file = MakeDDS(desc);
+
+        const int failures = g_failures;
+
+        DDSTextureLayout layout;
+        const DDSLayoutResult result = GetDDSTextureLayout(file.data(), file.size(), layout);
+        CHECK(result == DDSLayoutResult::Ok);
+        if (result != DDSLayoutResult::Ok)
+        {
+            printf("  %s: result %d\n", name, static_cast<int>(result));
+            return;
+        }
+
+        CHECK(layout.width == desc.width);
+        CHECK(layout.height == desc.height);
+        CHECK(layout.arraySize == items);
+        CHECK(layout.mipCount == desc.mipCount);
+        CHECK(layout.isCubeMap == desc.cubeMap);
+        CHECK(layout.compressed == compressed);
+        CHECK(layout.itemBytes == chain);
+
+        const size_t base = sizeof(uint32_t) + sizeof(DDS_HEADER)
+            + (desc.format != DXGI_FORMAT_UNKNOWN ? sizeof(DDS_HEADER_DXT10) : 0);
+        size_t expected = base;
+        for (size_t item = 0; item < items; ++item)
+        {
+            size_t width = desc.width;
+            size_t height = desc.height;
+            for (size_t mip = 0; mip < desc.mipCount; ++mip)
+            {
+                const DDSMipLayout& level = layout.mips[mip];
+                const size_t bytes = LevelBytes(width, height, elementBytes, compressed);
+
+                CHECK(layout.GetOffset(item, mip) == expected);
+                CHECK(level.width == width && level.height == height);
+                CHECK(level.numBytes == bytes);
+                CHECK(level.rowBytes * level.numRows == level.numBytes);
+
+                expected += bytes;
+                width = std::max<size_t>(width / 2, 1);
+                height = std::max<size_t>(height / 2, 1);
+            }
+        }
+        CHECK(expected == file.size());
+
+        // One byte short of the last mip
+        file.pop_back();
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::Truncated);
+
+        printf("%-32s %4zu items %2u mips %9zu bytes %s\n",
+            name, items, desc.mipCount, chain * items, failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestRejected()
+    {
+        DDSTextureLayout layout;
+
+        FileDesc volume;
+        volume.width = volume.height = 16;
+        volume.rgba = true;
+        volume.volume = true;
+        volume.payload = 4096;
+        auto file = MakeDDS(volume);
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::NotSupported);
+
+        // Planar and packed video formats have no fixed element size
+        FileDesc nv12;
+        nv12.width = nv12.height = 16;
+        nv12.format = DXGI_FORMAT_NV12;
+        nv12.payload = 4096;
+        file = MakeDDS(nv12);
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::NotSupported);
+
+        FileDesc yuy2;
+        yuy2.width = yuy2.height = 16;
+        yuy2.fourCC = MakeFourCC('Y', 'U', 'Y', '2');
+        yuy2.payload = 4096;
+        file = MakeDDS(yuy2);
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::NotSupported);
+
+        FileDesc tooManyMips;
+        tooManyMips.width = tooManyMips.height = 16;
+        tooManyMips.mipCount = 16;
+        tooManyMips.format = DXGI_FORMAT_R8_UNORM;
+        tooManyMips.payload = 4096;
+        file = MakeDDS(tooManyMips);
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::NotSupported);
+
+        FileDesc emptyArray;
+        emptyArray.width = emptyArray.height = 16;
+        emptyArray.format = DXGI_FORMAT_R8_UNORM;
+        emptyArray.arraySize = 0;
+        emptyArray.payload = 256;
+        file = MakeDDS(emptyArray);
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::InvalidData);
+
+        FileDesc badMagic;
+        badMagic.width = badMagic.height = 4;
+        badMagic.rgba = true;
+        badMagic.payload = 64;
+        file = MakeDDS(badMagic);
+        file[0] = 'X';
+        CHECK(GetDDSTextureLayout(file.data(), file.size(), layout) == DDSLayoutResult::InvalidData);
+
+        // Cut off inside the header
+        file = MakeDDS(nv12);
+        CHECK(GetDDSTextureLayout(file.data(), 64, layout) == DDSLayoutResult::InvalidData);
+        CHECK(GetDDSTextureLayout(nullptr, 0, layout) == DDSLayoutResult::InvalidData);
+
+        printf("%-32s %s\n", "rejected files", g_failures ? "FAILED" : "ok");
+    }
+}
+
+int main()
+{
+    FileDesc desc;
+
+    desc = {};
+    desc.width = 256;
+    desc.height = 128;
+    desc.mipCount = 9;
+    desc.rgba = true;
+    TestLayout("legacy RGBA 256x128", desc, 1, 4, false);
+
+    desc = {};
+    desc.width = 100;
+    desc.height = 60;
+    desc.mipCount = 7;
+    desc.fourCC = MakeFourCC('D', 'X', 'T', '1');
+    TestLayout("legacy DXT1 100x60", desc, 1, 8, true);
+
+    desc = {};
+    desc.width = desc.height = 64;
+    desc.mipCount = 7;
+    desc.fourCC = MakeFourCC('D', 'X', 'T', '5');
+    desc.cubeMap = true;
+    TestLayout("legacy DXT5 cubemap 64", desc, 6, 16, true);
+
+    desc = {};
+    desc.width = desc.height = 64;
+    desc.mipCount = 7;
+    desc.format = DXGI_FORMAT_BC3_UNORM;
+    desc.arraySize = 3;
+    TestLayout("DX10 BC3 array of 3, 64", desc, 3, 16, true);
+
+    desc = {};
+    desc.width = desc.height = 32;
+    desc.mipCount = 6;
+    desc.format = DXGI_FORMAT_BC7_UNORM;
+    desc.arraySize = 2;
+    desc.cubeMap = true;
+    TestLayout("DX10 BC7 cubemap array of 2, 32", desc, 12, 16, true);
+
+    desc = {};
+    desc.width = 33;
+    desc.height = 17;
+    desc.mipCount = 3;
+    desc.format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    TestLayout("DX10 RGBA16F 33x17", desc, 1, 8, false);
+
+    desc = {};
+    desc.format = DXGI_FORMAT_R8_UNORM;
+    TestLayout("DX10 R8 1x1", desc, 1, 1, false);
+
+    TestRejected();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
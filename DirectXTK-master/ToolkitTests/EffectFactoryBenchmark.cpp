@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------
+// File: EffectFactoryBenchmark.cpp
+//
+// Contention benchmark for the EffectFactory texture cache. Worker threads request every
+// texture of a generated set in their own order, so most textures are asked for by several
+// threads at once. Runs once with a single lock held across each CreateTexture call, the way
+// the cache used to serialize loads, and once with the factory called directly.
+//
+// Usage: effectfactorybenchmark [textures] [size]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "Effects.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    // 24 bit uncompressed BMP, decoded through WIC like any non-DDS texture
+    bool WriteBitmap(const std::filesystem::path& path, int size, uint32_t seed)
+    {
+        const uint32_t rowBytes = (static_cast<uint32_t>(size) * 3 + 3) & ~3u;
+        const uint32_t imageBytes = rowBytes * static_cast<uint32_t>(size);
+
+        BITMAPFILEHEADER fileHeader = {};
+        fileHeader.bfType = 0x4D42;
+        fileHeader.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+        fileHeader.bfSize = fileHeader.bfOffBits + imageBytes;
+
+        BITMAPINFOHEADER infoHeader = {};
+        infoHeader.biSize = sizeof(BITMAPINFOHEADER);
+        infoHeader.biWidth = size;
+        infoHeader.biHeight = size;
+        infoHeader.biPlanes = 1;
+        infoHeader.biBitCount = 24;
+        infoHeader.biCompression = BI_RGB;
+        infoHeader.biSizeImage = imageBytes;
+
+        std::vector<uint8_t> pixels(imageBytes);
+        std::mt19937 random(seed);
+        for (auto& value : pixels)
+        {
+            value = static_cast<uint8_t>(random());
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+        file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+        return file.good();
+    }
+
+    struct RunResult
+    {
+        double milliseconds;
+        DirectX::EffectFactory::TextureCacheStats stats;
+    };
+
+    RunResult Run(DirectX::EffectFactory& factory, const std::vector<std::wstring>& names, unsigned int threadCount, bool singleLock)
+    {
+        factory.ReleaseCache();
+        const auto before = factory.GetTextureCacheStats();
+
+        std::mutex lock;
+        std::vector<std::thread> threads;
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+                std::vector<size_t> order(names.size());
+                for (size_t i = 0; i < order.size(); ++i)
+                    order[i] = i;
+                std::shuffle(order.begin(), order.end(), std::mt19937(t + 1));
+
+                for (size_t i : order)
+                {
+                    ComPtr<ID3D11ShaderResourceView> view;
+                    if (singleLock)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        factory.CreateTexture(names[i].c_str(), nullptr, view.GetAddressOf());
+                    }
+                    else
+                    {
+                        factory.CreateTexture(names[i].c_str(), nullptr, view.GetAddressOf());
+                    }
+                }
+
+                if (SUCCEEDED(com))
+                    CoUninitialize();
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        RunResult result = {};
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const auto after = factory.GetTextureCacheStats();
+        result.stats.requests = after.requests - before.requests;
+        result.stats.hits = after.hits - before.hits;
+        result.stats.waits = after.waits - before.waits;
+        result.stats.loads = after.loads - before.loads;
+        result.stats.failures = after.failures - before.failures;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int textureCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 64;
+    const int size = argc > 2 ? std::max(1, std::atoi(argv[2])) : 512;
+
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED)))
+        return 1;
+
+    // WARP, so the benchmark runs without a GPU; texture creation cost is small next to decoding
+    ComPtr<ID3D11Device> device;
+    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0,
+        D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed creating a WARP device (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    const auto directory = std::filesystem::temp_directory_path() / "EffectFactoryBenchmark";
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::wstring> names;
+    for (int i = 0; i < textureCount; ++i)
+    {
+        const std::wstring name = L"texture" + std::to_wstring(i) + L".bmp";
+        if (!WriteBitmap(directory / name, size, static_cast<uint32_t>(i)))
+        {
+            printf("ERROR: Failed writing %ls\n", (directory / name).c_str());
+            return 1;
+        }
+        names.push_back(name);
+    }
+
+    DirectX::EffectFactory factory(device.Get());
+    const std::wstring path = directory.wstring() + L"\\";
+    factory.SetDirectory(path.c_str());
+
+    printf("%d textures of %dx%d, every thread requests each once\n", textureCount, size, size);
+
+    bool failed = false;
+    const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        const RunResult serialized = Run(factory, names, threads, true);
+        const RunResult concurrent = Run(factory, names, threads, false);
+
+        printf("%2u threads: single lock %9.2f ms, concurrent %9.2f ms, speedup %5.2fx (loads %zu, hits %zu, waits %zu)\n",
+            threads, serialized.milliseconds, concurrent.milliseconds, serialized.milliseconds / concurrent.milliseconds,
+            concurrent.stats.loads, concurrent.stats.hits, concurrent.stats.waits);
+
+        // Each texture must be decoded exactly once however many threads asked for it
+        if (concurrent.stats.loads != names.size() || concurrent.stats.failures != 0
+            || concurrent.stats.requests != names.size() * threads)
+        {
+            printf("ERROR: Expected %zu loads and no failures\n", names.size());
+            failed = true;
+        }
+    }
+
+    factory.ReleaseCache();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    CoUninitialize();
+    return failed ? 1 : 0;
+}
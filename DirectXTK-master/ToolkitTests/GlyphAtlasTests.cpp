@@ -0,0 +1,315 @@
+//--------------------------------------------------------------------------------------
+// File: GlyphAtlasTests.cpp
+//
+// Checks the slot allocation and eviction DynamicSpriteFont uses for its atlas. A random
+// workload draws a skewed mix of glyphs of many sizes into a two page atlas too small for
+// all of them, and after every frame's Update the atlas must hold no two glyphs in the same
+// slot, keep every slot inside its region, list exactly the regions with free slots as
+// partly used, and have every resident glyph on the least recently used list. Needs no
+// Direct3D device.
+//
+// Usage: glyphatlastests [frames]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "GlyphAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    constexpr uint32_t c_pageSize = 256;
+    constexpr uint32_t c_regionSize = 64;
+    constexpr uint32_t c_maxPages = 2;
+
+    // The glyph states DynamicSpriteFont keeps alongside the atlas
+    enum class State
+    {
+        Unrequested,
+        Pending,
+        Resident,
+    };
+
+    struct Glyph
+    {
+        uint32_t slotWidth;
+        uint32_t slotHeight;
+        State state;
+        GlyphAtlas::Location location;
+    };
+
+    // Slot sizes as DynamicSpriteFont rounds them: padded by a texel each side, then up to a
+    // multiple of four. Mostly text sized, with some tall ones.
+    std::vector<Glyph> MakeGlyphs(size_t count, std::mt19937& random)
+    {
+        std::vector<Glyph> glyphs(count);
+
+        for (auto& glyph : glyphs)
+        {
+            const uint32_t width = 2 + random() % 20;
+            const uint32_t height = (random() % 4) ? 12 + random() % 8 : 2 + random() % 40;
+
+            glyph.slotWidth = (width + 2 + 3) & ~3u;
+            glyph.slotHeight = (height + 2 + 3) & ~3u;
+            glyph.state = State::Unrequested;
+            glyph.location = {};
+        }
+
+        return glyphs;
+    }
+
+    // Returns false, after reporting what is wrong, unless the atlas is consistent with the
+    // glyphs marked resident.
+    bool CheckInvariants(GlyphAtlas const& atlas, std::vector<Glyph> const& glyphs)
+    {
+        const int failures = g_failures;
+
+        // No two resident glyphs share a slot, and each slot is inside its region.
+        std::set<std::pair<uint32_t, uint32_t>> slots;
+        size_t resident = 0;
+
+        for (uint32_t index = 0; index < glyphs.size(); index++)
+        {
+            auto& glyph = glyphs[index];
+
+            CHECK(atlas.IsResident(index) == (glyph.state == State::Resident));
+
+            if (glyph.state != State::Resident)
+                continue;
+
+            resident++;
+
+            auto& placed = atlas.GetGlyph(index);
+            auto& region = atlas.GetRegion(placed.region);
+
+            CHECK(slots.insert(std::make_pair(placed.region, placed.slot)).second);
+            CHECK(region.slotWidth == glyph.slotWidth && region.slotHeight == glyph.slotHeight);
+            CHECK(glyph.location.page == region.page);
+            CHECK(glyph.location.x >= region.x && glyph.location.x + glyph.slotWidth <= region.x + c_regionSize);
+            CHECK(glyph.location.y >= region.y && glyph.location.y + glyph.slotHeight <= region.y + c_regionSize);
+            CHECK(region.x + c_regionSize <= c_pageSize && region.y + c_regionSize <= c_pageSize);
+        }
+
+        CHECK(resident == atlas.GetResidentCount());
+
+        // The least recently used list holds every resident glyph once, linked both ways.
+        size_t listed = 0;
+        uint32_t newer = GlyphAtlas::None;
+
+        for (uint32_t index = atlas.GetNewest(); index != GlyphAtlas::None && listed <= resident; index = atlas.GetGlyph(index).older)
+        {
+            CHECK(glyphs[index].state == State::Resident);
+            CHECK(atlas.GetGlyph(index).newer == newer);
+
+            newer = index;
+            listed++;
+        }
+
+        CHECK(listed == resident);
+        CHECK(atlas.GetOldest() == newer);
+
+        // Regions in use account for every slot, and are partly used exactly when a slot is free.
+        for (uint32_t index = 0; index < atlas.GetRegionCount(); index++)
+        {
+            auto& region = atlas.GetRegion(index);
+            auto& free = atlas.GetFreeRegions();
+
+            const bool isFree = std::count(free.begin(), free.end(), index) == 1;
+
+            if (!region.slotWidth)
+            {
+                CHECK(isFree);
+                CHECK(region.used == 0 && region.freeSlots.empty());
+                continue;
+            }
+
+            CHECK(!isFree);
+            CHECK(region.used > 0);
+            CHECK(region.used + region.freeSlots.size() == region.columns * (c_regionSize / region.slotHeight));
+
+            auto partial = atlas.GetPartialRegions(region.slotWidth, region.slotHeight);
+
+            const bool isPartial = partial && std::count(partial->begin(), partial->end(), index) == 1;
+
+            CHECK(isPartial == !region.freeSlots.empty());
+        }
+
+        return failures == g_failures;
+    }
+
+    // Frames of drawing a few dozen glyphs each, mostly the common ones, with an Update after
+    // each that allocates for the glyphs requested, as DynamicSpriteFont does.
+    void TestWorkload(int frames)
+    {
+        const int failures = g_failures;
+
+        std::mt19937 random(1);
+
+        uint64_t evictions = 0;
+        uint64_t atlasFull = 0;
+
+        for (int trial = 0; trial < 20; trial++)
+        {
+            std::vector<Glyph> glyphs = MakeGlyphs(3000, random);
+
+            GlyphAtlas atlas(c_pageSize, c_maxPages);
+            atlas.SetRegionSize(c_regionSize);
+
+            uint32_t pages = 0;
+            uint64_t frame = 1;
+
+            for (int drawn = 0; drawn < frames; drawn++)
+            {
+                // DrawString
+                std::set<uint32_t> used;
+
+                const int count = 20 + random() % 60;
+
+                for (int i = 0; i < count; i++)
+                {
+                    const double skew = std::pow(double(random() % 10000) / 10000.0, 3);
+
+                    used.insert(static_cast<uint32_t>(skew * double(glyphs.size())));
+                }
+
+                for (auto index : used)
+                {
+                    if (glyphs[index].state == State::Unrequested)
+                    {
+                        glyphs[index].state = State::Pending;
+                    }
+                    else if (glyphs[index].state == State::Resident)
+                    {
+                        atlas.Touch(index, frame);
+                    }
+                }
+
+                // Update
+                for (uint32_t index = 0; index < glyphs.size(); index++)
+                {
+                    auto& glyph = glyphs[index];
+
+                    if (glyph.state != State::Pending)
+                        continue;
+
+                    const bool allocated = atlas.Allocate(index, glyph.slotWidth, glyph.slotHeight, frame,
+                        [&](uint32_t page)
+                        {
+                            CHECK(page == pages);
+                            pages++;
+                        },
+                        [&](uint32_t evicted)
+                        {
+                            // Never a glyph drawn since the previous Update
+                            CHECK(glyphs[evicted].state == State::Resident);
+                            CHECK(used.count(evicted) == 0);
+
+                            glyphs[evicted].state = State::Unrequested;
+                            evictions++;
+                        },
+                        glyph.location);
+
+                    if (!allocated)
+                    {
+                        atlasFull++;
+                        break;
+                    }
+
+                    glyph.state = State::Resident;
+                }
+
+                frame++;
+
+                if (!CheckInvariants(atlas, glyphs))
+                {
+                    printf("Trial %d frame %d\n", trial, drawn);
+                    break;
+                }
+            }
+
+            CHECK(pages == c_maxPages && atlas.GetPageCount() == c_maxPages);
+        }
+
+        // The workload must actually fill the atlas, or the eviction paths go untested.
+        CHECK(evictions > 0);
+        CHECK(atlasFull > 0);
+
+        printf("%-28s %s\n", "Random workload", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    // Glyphs drawn this frame are never evicted, even when that leaves a glyph without a slot,
+    // and a region whose last glyph goes can take another size class.
+    void TestEviction()
+    {
+        const int failures = g_failures;
+
+        GlyphAtlas atlas(c_regionSize, 1);
+        atlas.SetRegionSize(c_regionSize);
+
+        std::vector<uint32_t> evicted;
+
+        auto addPage = [](uint32_t) {};
+        auto onEvicted = [&](uint32_t glyph) { evicted.push_back(glyph); };
+
+        GlyphAtlas::Location location;
+
+        // One region of four 32x32 slots, filled on frame 1
+        for (uint32_t glyph = 0; glyph < 4; glyph++)
+        {
+            CHECK(atlas.Allocate(glyph, 32, 32, 1, addPage, onEvicted, location));
+        }
+
+        CHECK(!atlas.Allocate(4, 32, 32, 1, addPage, onEvicted, location));
+        CHECK(evicted.empty());
+
+        // On frame 2, with glyph 0 drawn again, the oldest of the others goes.
+        atlas.Touch(0, 2);
+
+        CHECK(atlas.Allocate(4, 32, 32, 2, addPage, onEvicted, location));
+        CHECK(evicted.size() == 1 && evicted[0] == 1);
+        CHECK(!atlas.IsResident(1) && atlas.IsResident(4));
+
+        // A 64x64 glyph needs the whole region, so every glyph not drawn this frame goes.
+        CHECK(!atlas.Allocate(5, 64, 64, 2, addPage, onEvicted, location));
+        CHECK(atlas.Allocate(5, 64, 64, 3, addPage, onEvicted, location));
+        CHECK(atlas.GetResidentCount() == 1 && atlas.GetEvictionCount() == 5);
+        CHECK(location.page == 0 && location.x == 0 && location.y == 0);
+
+        printf("%-28s %s\n", "Eviction", failures == g_failures ? "ok" : "FAILED");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 400;
+
+    TestWorkload(frames);
+    TestEviction();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
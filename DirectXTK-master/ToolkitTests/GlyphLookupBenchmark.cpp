@@ -0,0 +1,324 @@
+//--------------------------------------------------------------------------------------
+// File: GlyphLookupBenchmark.cpp
+//
+// Compares the GlyphTable SpriteFont looks glyphs up in with the binary search it replaced,
+// on ASCII, Cyrillic and CJK text, for wide strings and for UTF-8 strings. The UTF-8 runs
+// compare widening the whole string into a buffer before the lookups, as the char overloads
+// used to do, with decoding each character in place. The font has about 21,500 glyphs:
+// ASCII, Latin-1, Cyrillic, CJK symbols and ideographs, and emoji. Every code point up to
+// U+1FFFF is checked against the binary search, and the UTF-8 and UTF-16 decoders against
+// known input.
+//
+// Usage: glyphlookupbenchmark [characters]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// TextHelpers.h relies on the precompiled header for SAL
+#include <sal.h>
+
+#include "GlyphTable.h"
+#include "TextHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    // The binary search SpriteFont::Impl::FindGlyph used before the glyph table
+    size_t BinarySearch(const std::vector<uint32_t>& glyphsIndex, uint32_t character)
+    {
+        size_t lower = 0;
+        size_t higher = glyphsIndex.size() - 1;
+        size_t index = higher / 2;
+        const size_t size = glyphsIndex.size();
+
+        while (index < size)
+        {
+            const auto curChar = glyphsIndex[index];
+            if (curChar == character) { return index; }
+            if (curChar < character)
+            {
+                lower = index + 1;
+            }
+            else
+            {
+                higher = index - 1;
+            }
+            if (higher < lower) { break; }
+            else if (higher - lower <= 4)
+            {
+                for (index = lower; index <= higher; index++)
+                {
+                    if (glyphsIndex[index] == character)
+                    {
+                        return index;
+                    }
+                }
+            }
+            index = lower + ((higher - lower) / 2);
+        }
+
+        return GlyphTable::NotFound;
+    }
+
+    std::string EncodeUTF8(const std::vector<uint32_t>& text)
+    {
+        std::string result;
+        for (uint32_t character : text)
+        {
+            if (character < 0x80)
+            {
+                result += static_cast<char>(character);
+            }
+            else if (character < 0x800)
+            {
+                result += static_cast<char>(0xC0 | (character >> 6));
+                result += static_cast<char>(0x80 | (character & 0x3F));
+            }
+            else if (character < 0x10000)
+            {
+                result += static_cast<char>(0xE0 | (character >> 12));
+                result += static_cast<char>(0x80 | ((character >> 6) & 0x3F));
+                result += static_cast<char>(0x80 | (character & 0x3F));
+            }
+            else
+            {
+                result += static_cast<char>(0xF0 | (character >> 18));
+                result += static_cast<char>(0x80 | ((character >> 12) & 0x3F));
+                result += static_cast<char>(0x80 | ((character >> 6) & 0x3F));
+                result += static_cast<char>(0x80 | (character & 0x3F));
+            }
+        }
+        return result;
+    }
+
+    std::vector<uint32_t> DecodeUTF8(const char* text)
+    {
+        std::vector<uint32_t> result;
+        while (*text)
+        {
+            result.push_back(TextHelpers::NextCharacter(text));
+        }
+        return result;
+    }
+
+    std::vector<uint32_t> DecodeUTF16(const wchar_t* text)
+    {
+        std::vector<uint32_t> result;
+        while (*text)
+        {
+            result.push_back(TextHelpers::NextCharacter(text));
+        }
+        return result;
+    }
+
+    bool CheckDecoder()
+    {
+        const uint32_t R = TextHelpers::ReplacementCharacter;
+
+        struct Case
+        {
+            const char* text;
+            std::vector<uint32_t> expected;
+        };
+
+        const Case cases[] =
+        {
+            { "A\xC3\xA9\xD0\x96\xE4\xB8\xAD\xF0\x9F\x98\x80", { 0x41, 0xE9, 0x416, 0x4E2D, 0x1F600 } },
+            { "\xC0\xAF", { R, R } },                       // Overlong
+            { "\xE0\x80\xAF", { R, R, R } },                // Overlong
+            { "\xED\xA0\x80", { R, R, R } },                // Surrogate
+            { "\xF4\x90\x80\x80", { R, R, R, R } },         // Above U+10FFFF
+            { "\xE4\xB8", { R } },                          // Truncated by the terminator
+            { "\xE4\xB8" "A", { R, 0x41 } },                // Truncated by another character
+            { "\x80\xBF", { R, R } },                       // Lone continuation bytes
+            { "\xF8\x88\x80\x80\x80", { R, R, R, R, R } },  // Five byte form
+        };
+
+        for (const Case& test : cases)
+        {
+            if (DecodeUTF8(test.text) != test.expected)
+                return false;
+        }
+
+        struct WideCase
+        {
+            const wchar_t* text;
+            std::vector<uint32_t> expected;
+        };
+
+        const WideCase wideCases[] =
+        {
+            { L"A\xD83D\xDE00" L"B", { 0x41, 0x1F600, 0x42 } }, // Surrogate pair
+            { L"\xDBFF\xDFFF", { 0x10FFFF } },                  // Highest pair
+            { L"\xD83D", { R } },                               // High surrogate truncated by the terminator
+            { L"\xD83D" L"A", { R, 0x41 } },                    // High surrogate followed by another character
+            { L"\xDE00\xD83D", { R, R } },                      // Halves in the wrong order
+        };
+
+        for (const WideCase& test : wideCases)
+        {
+            if (DecodeUTF16(test.text) != test.expected)
+                return false;
+        }
+
+        // SpriteFont still looks up each half on its own
+        const wchar_t* pair = L"\xD83D\xDE00";
+        if (TextHelpers::NextCharacterUnpaired(pair) != 0xD83D || TextHelpers::NextCharacterUnpaired(pair) != 0xDE00)
+            return false;
+
+        return true;
+    }
+
+    template<typename TFunction>
+    double BestNanosecondsPerCharacter(size_t characters, TFunction&& function)
+    {
+        double best = 1e30;
+        for (int trial = 0; trial < 7; trial++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(characters));
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const size_t length = argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 100000;
+
+    std::vector<uint32_t> glyphsIndex;
+    auto addRange = [&](uint32_t first, uint32_t last)
+    {
+        for (uint32_t character = first; character <= last; character++)
+        {
+            glyphsIndex.push_back(character);
+        }
+    };
+    addRange(0x20, 0x7E);
+    addRange(0xA0, 0xFF);
+    addRange(0x400, 0x4FF);
+    addRange(0x3000, 0x303F);
+    addRange(0x4E00, 0x9FFF);
+    addRange(0x1F600, 0x1F64F);
+
+    GlyphTable table;
+    for (size_t i = 0; i < glyphsIndex.size(); i++)
+    {
+        table.Insert(glyphsIndex[i], static_cast<uint32_t>(i));
+    }
+
+    bool failed = false;
+
+    for (uint32_t character = 0; character < 0x20000; character++)
+    {
+        if (table.Find(character) != BinarySearch(glyphsIndex, character))
+        {
+            printf("ERROR: Glyph table and binary search disagree on U+%04X\n", character);
+            failed = true;
+            break;
+        }
+    }
+
+    if (!CheckDecoder())
+    {
+        printf("ERROR: UTF-8 or UTF-16 decoder returned the wrong code points\n");
+        failed = true;
+    }
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint32_t> ascii(0x20, 0x7E);
+    std::uniform_int_distribution<uint32_t> cyrillic(0x410, 0x44F);
+    std::uniform_int_distribution<uint32_t> cjk(0x4E00, 0x9FFF);
+    std::uniform_int_distribution<int> word(0, 4);
+
+    struct Text
+    {
+        const char* name;
+        std::vector<uint32_t> characters;
+        std::string utf8;
+    };
+
+    Text texts[] = { { "ASCII", {}, {} }, { "Cyrillic", {}, {} }, { "CJK", {}, {} } };
+    for (size_t i = 0; i < length; i++)
+    {
+        texts[0].characters.push_back(ascii(random));
+        texts[1].characters.push_back(word(random) ? cyrillic(random) : 0x20);
+        texts[2].characters.push_back(cjk(random));
+    }
+
+    printf("%zu glyphs, %zu characters per string, ns per character, best of 7\n", glyphsIndex.size(), length);
+    printf("%-10s %14s %10s %8s %18s %16s %8s\n", "text", "binary search", "table", "speedup", "UTF-8 widen+search", "decode+table", "speedup");
+
+    for (Text& text : texts)
+    {
+        text.utf8 = EncodeUTF8(text.characters);
+
+        if (DecodeUTF8(text.utf8.c_str()) != text.characters)
+        {
+            printf("ERROR: %s did not survive a UTF-8 round trip\n", text.name);
+            failed = true;
+        }
+
+        const size_t count = text.characters.size();
+        volatile size_t sink = 0;
+
+        const double search = BestNanosecondsPerCharacter(count, [&]()
+        {
+            size_t sum = 0;
+            for (uint32_t character : text.characters)
+                sum += BinarySearch(glyphsIndex, character);
+            sink = sum;
+        });
+
+        const double lookup = BestNanosecondsPerCharacter(count, [&]()
+        {
+            size_t sum = 0;
+            for (uint32_t character : text.characters)
+                sum += table.Find(character);
+            sink = sum;
+        });
+
+        // The old char overloads converted the whole string into a shared buffer first
+        std::vector<uint32_t> wide(text.utf8.size() + 1);
+
+        const double widenSearch = BestNanosecondsPerCharacter(count, [&]()
+        {
+            size_t used = 0;
+            for (const char* p = text.utf8.c_str(); *p; )
+                wide[used++] = TextHelpers::NextCharacter(p);
+
+            size_t sum = 0;
+            for (size_t i = 0; i < used; i++)
+                sum += BinarySearch(glyphsIndex, wide[i]);
+            sink = sum;
+        });
+
+        const double decodeLookup = BestNanosecondsPerCharacter(count, [&]()
+        {
+            size_t sum = 0;
+            for (const char* p = text.utf8.c_str(); *p; )
+                sum += table.Find(TextHelpers::NextCharacter(p));
+            sink = sum;
+        });
+
+        printf("%-10s %14.2f %10.2f %7.1fx %18.2f %16.2f %7.1fx\n", text.name,
+            search, lookup, search / lookup, widenSearch, decodeLookup, widenSearch / decodeLookup);
+    }
+
+    return failed ? 1 : 0;
+}
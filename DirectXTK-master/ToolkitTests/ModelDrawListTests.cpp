@@ -0,0 +1,281 @@
+//--------------------------------------------------------------------------------------
+// File: ModelDrawListTests.cpp
+//
+// Model::PrepareDrawList and Model::Submit against Model::Draw on a WARP device. A scene of
+// models sharing a few effects and buffers is drawn both ways; the baseline Submit reports
+// must match a count of the calls Model::Draw makes, and Submit must make fewer. Reports the
+// state changes and CPU time per frame of each.
+//
+// Usage: modeldrawlisttests [models] [frames]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "BufferHelpers.h"
+#include "CommonStates.h"
+#include "DirectXHelpers.h"
+#include "Effects.h"
+#include "Model.h"
+#include "VertexTypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    void ThrowIfFailed(HRESULT hr, const char* what)
+    {
+        if (FAILED(hr))
+            throw std::runtime_error(what);
+    }
+
+    constexpr uint32_t c_meshesPerModel = 3;
+    constexpr uint32_t c_partsPerMesh = 4;
+    constexpr uint32_t c_materials = 6;
+    constexpr uint32_t c_buffers = 2;
+
+    // A unit cube, each part of a mesh draws some of its faces
+    struct SharedResources
+    {
+        ComPtr<ID3D11Buffer> vertexBuffers[c_buffers];
+        ComPtr<ID3D11Buffer> indexBuffers[c_buffers];
+        std::shared_ptr<IEffect> effects[c_materials];
+        ComPtr<ID3D11InputLayout> inputLayouts[c_materials];
+        std::shared_ptr<std::vector<D3D11_INPUT_ELEMENT_DESC>> vbDecl;
+    };
+
+    void CreateResources(ID3D11Device* device, SharedResources& resources)
+    {
+        const XMFLOAT3 normals[6] =
+        {
+            { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 },
+        };
+
+        std::vector<VertexPositionNormalTexture> vertices;
+        std::vector<uint16_t> indices;
+        for (const XMFLOAT3& n : normals)
+        {
+            const XMVECTOR normal = XMLoadFloat3(&n);
+            const XMVECTOR side1 = XMVectorSet(n.y, n.z, n.x, 0);
+            const XMVECTOR side2 = XMVector3Cross(normal, side1);
+
+            const auto base = static_cast<uint16_t>(vertices.size());
+            indices.insert(indices.end(), { base, uint16_t(base + 1), uint16_t(base + 2), base, uint16_t(base + 2), uint16_t(base + 3) });
+
+            const XMVECTOR corners[4] =
+            {
+                XMVectorSubtract(XMVectorSubtract(normal, side1), side2),
+                XMVectorAdd(XMVectorSubtract(normal, side1), side2),
+                XMVectorAdd(XMVectorAdd(normal, side1), side2),
+                XMVectorSubtract(XMVectorAdd(normal, side1), side2),
+            };
+            for (const XMVECTOR& corner : corners)
+            {
+                vertices.emplace_back(XMVectorScale(corner, 0.5f), normal, XMVectorZero());
+            }
+        }
+
+        for (uint32_t i = 0; i < c_buffers; ++i)
+        {
+            ThrowIfFailed(CreateStaticBuffer(device, vertices, D3D11_BIND_VERTEX_BUFFER, resources.vertexBuffers[i].ReleaseAndGetAddressOf()), "CreateStaticBuffer");
+            ThrowIfFailed(CreateStaticBuffer(device, indices, D3D11_BIND_INDEX_BUFFER, resources.indexBuffers[i].ReleaseAndGetAddressOf()), "CreateStaticBuffer");
+        }
+
+        for (uint32_t i = 0; i < c_materials; ++i)
+        {
+            auto effect = std::make_shared<BasicEffect>(device);
+            effect->EnableDefaultLighting();
+            effect->SetDiffuseColor(XMVectorSet(float(i % 2), float(i % 3) * 0.5f, 1.0f, 1.0f));
+            ThrowIfFailed(CreateInputLayoutFromEffect<VertexPositionNormalTexture>(device, effect.get(), resources.inputLayouts[i].ReleaseAndGetAddressOf()), "CreateInputLayoutFromEffect");
+            resources.effects[i] = effect;
+        }
+
+        resources.vbDecl = std::make_shared<std::vector<D3D11_INPUT_ELEMENT_DESC>>(
+            VertexPositionNormalTexture::InputElements,
+            VertexPositionNormalTexture::InputElements + VertexPositionNormalTexture::InputElementCount);
+    }
+
+    // Meshes pick their materials and buffers from the shared sets, the last part of every
+    // other mesh is alpha blended
+    std::unique_ptr<Model> CreateModel(const SharedResources& resources, uint32_t index)
+    {
+        auto model = std::make_unique<Model>();
+        for (uint32_t m = 0; m < c_meshesPerModel; ++m)
+        {
+            auto mesh = std::make_shared<ModelMesh>();
+            mesh->ccw = (index + m) % 5 != 0;
+            mesh->boundingSphere = BoundingSphere(XMFLOAT3(0, 0, 0), 0.9f);
+
+            for (uint32_t p = 0; p < c_partsPerMesh; ++p)
+            {
+                const uint32_t material = (index * 7 + m * 3 + p) % c_materials;
+                const uint32_t buffer = (index + p) % c_buffers;
+
+                auto part = std::make_unique<ModelMeshPart>();
+                part->indexCount = 6;
+                part->startIndex = p * 6;
+                part->vertexStride = sizeof(VertexPositionNormalTexture);
+                part->vertexBuffer = resources.vertexBuffers[buffer];
+                part->indexBuffer = resources.indexBuffers[buffer];
+                part->effect = resources.effects[material];
+                part->inputLayout = resources.inputLayouts[material];
+                part->vbDecl = resources.vbDecl;
+                part->isAlpha = p + 1 == c_partsPerMesh && m % 2 == 1;
+                mesh->meshParts.push_back(std::move(part));
+            }
+            model->meshes.push_back(mesh);
+        }
+        return model;
+    }
+
+    XMMATRIX World(uint32_t index, uint32_t modelCount)
+    {
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(double(modelCount))));
+        return XMMatrixTranslation(float(index % side) * 1.5f - float(side) * 0.75f, float(index / side) * 1.5f - float(side) * 0.75f, float(side) * 1.2f);
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t modelCount = argc > 1 ? static_cast<uint32_t>(std::max(1, std::atoi(argv[1]))) : 500;
+    const int frames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED)))
+        return 1;
+
+    ComPtr<ID3D11Device> device;
+    ComPtr<ID3D11DeviceContext> context;
+    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0,
+        D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, context.GetAddressOf());
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed creating a WARP device (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    try
+    {
+        CD3D11_TEXTURE2D_DESC colorDesc(DXGI_FORMAT_B8G8R8A8_UNORM, 256, 256, 1, 1, D3D11_BIND_RENDER_TARGET);
+        CD3D11_TEXTURE2D_DESC depthDesc(DXGI_FORMAT_D24_UNORM_S8_UINT, 256, 256, 1, 1, D3D11_BIND_DEPTH_STENCIL);
+        ComPtr<ID3D11Texture2D> color, depth;
+        ComPtr<ID3D11RenderTargetView> rtv;
+        ComPtr<ID3D11DepthStencilView> dsv;
+        ThrowIfFailed(device->CreateTexture2D(&colorDesc, nullptr, color.GetAddressOf()), "CreateTexture2D");
+        ThrowIfFailed(device->CreateTexture2D(&depthDesc, nullptr, depth.GetAddressOf()), "CreateTexture2D");
+        ThrowIfFailed(device->CreateRenderTargetView(color.Get(), nullptr, rtv.GetAddressOf()), "CreateRenderTargetView");
+        ThrowIfFailed(device->CreateDepthStencilView(depth.Get(), nullptr, dsv.GetAddressOf()), "CreateDepthStencilView");
+
+        context->OMSetRenderTargets(1, rtv.GetAddressOf(), dsv.Get());
+        CD3D11_VIEWPORT viewport(0.0f, 0.0f, 256.0f, 256.0f);
+        context->RSSetViewports(1, &viewport);
+
+        SharedResources resources;
+        CreateResources(device.Get(), resources);
+        CommonStates states(device.Get());
+
+        std::vector<std::unique_ptr<Model>> models;
+        for (uint32_t i = 0; i < modelCount; ++i)
+        {
+            models.push_back(CreateModel(resources, i));
+        }
+
+        const XMMATRIX view = XMMatrixIdentity();
+        const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 1000.0f);
+
+        // Model::Draw prepares every mesh once per pass, four calls each, and every part sets its
+        // layout, vertex buffer, index buffer, effect and topology
+        size_t drawCalls = 0;
+        size_t parts = 0;
+        for (const auto& model : models)
+        {
+            for (const auto& mesh : model->meshes)
+            {
+                drawCalls += 2 * 4 + mesh->meshParts.size() * 5;
+                parts += mesh->meshParts.size();
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            for (uint32_t i = 0; i < modelCount; ++i)
+            {
+                models[i]->Draw(context.Get(), states, World(i, modelCount), view, projection);
+            }
+            context->Flush();
+        }
+        const double drawTime = MillisecondsSince(start) / frames;
+
+        ModelDrawList list;
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            list.Clear();
+            for (uint32_t i = 0; i < modelCount; ++i)
+            {
+                models[i]->PrepareDrawList(list, World(i, modelCount), view);
+            }
+            Model::Submit(context.Get(), states, list, view, projection);
+            context->Flush();
+        }
+        const double submitTime = MillisecondsSince(start) / frames;
+
+        const ModelDrawList::Stats& stats = list.GetStats();
+        CHECK(list.GetCount() == parts);
+        CHECK(stats.draws == parts);
+        CHECK(stats.baselineStateChanges == drawCalls);
+        CHECK(stats.stateChanges < stats.baselineStateChanges);
+
+        // Submitting the same sorted list again does not count the baseline twice
+        Model::Submit(context.Get(), states, list, view, projection, true);
+        CHECK(list.GetStats().baselineStateChanges == drawCalls);
+
+        printf("%u models, %zu parts: Model::Draw %zu state changes %8.3f ms per frame, Submit %zu state changes %8.3f ms per frame (%.1fx fewer changes, %.2fx time)\n",
+            modelCount, parts, stats.baselineStateChanges, drawTime, stats.stateChanges, submitTime,
+            double(stats.baselineStateChanges) / double(std::max<size_t>(stats.stateChanges, 1)), drawTime / std::max(submitTime, 1e-6));
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: %s\n", e.what());
+        ++g_failures;
+    }
+
+    context.Reset();
+    device.Reset();
+    CoUninitialize();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,263 @@
+//--------------------------------------------------------------------------------------
+// File: RadixSortBenchmark.cpp
+//
+// Compares the radix sort SpriteBatch uses for its sort modes with the std::sort
+// comparisons it replaced, on 1,000 to 100,000 queued sprites with random depths and
+// textures. Keys are built the same way SpriteBatch::Impl::SortSprites builds them, and
+// every radix sorted order is checked: depth modes must match std::stable_sort exactly,
+// texture mode must group each texture once and keep submission order within it.
+//
+// Usage: radixsortbenchmark [textures]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// RadixSort.h relies on the precompiled header for SAL
+#include <sal.h>
+
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    struct Float4
+    {
+        float x, y, z, w;
+    };
+
+    struct Texture
+    {
+        uint8_t data[64];
+    };
+
+    // Same size and layout as SpriteBatch::Impl::SpriteInfo
+    struct alignas(16) SpriteInfo
+    {
+        Float4 source;
+        Float4 destination;
+        Float4 color;
+        Float4 originRotationDepth;
+        const Texture* texture;
+        unsigned int flags;
+    };
+
+    enum class SortMode
+    {
+        Texture,
+        BackToFront,
+        FrontToBack,
+    };
+
+    const char* ModeName(SortMode mode)
+    {
+        switch (mode)
+        {
+            case SortMode::Texture:     return "Texture";
+            case SortMode::BackToFront: return "BackToFront";
+            default:                    return "FrontToBack";
+        }
+    }
+
+    // The comparison sort SortSprites used before the radix sort
+    void ComparisonSort(SortMode mode, std::vector<const SpriteInfo*>& sprites)
+    {
+        switch (mode)
+        {
+            case SortMode::Texture:
+                std::sort(sprites.begin(), sprites.end(), [](const SpriteInfo* x, const SpriteInfo* y) noexcept
+                    {
+                        return x->texture < y->texture;
+                    });
+                break;
+
+            case SortMode::BackToFront:
+                std::sort(sprites.begin(), sprites.end(), [](const SpriteInfo* x, const SpriteInfo* y) noexcept
+                    {
+                        return x->originRotationDepth.w > y->originRotationDepth.w;
+                    });
+                break;
+
+            default:
+                std::sort(sprites.begin(), sprites.end(), [](const SpriteInfo* x, const SpriteInfo* y) noexcept
+                    {
+                        return x->originRotationDepth.w < y->originRotationDepth.w;
+                    });
+                break;
+        }
+    }
+
+    // The radix sort as SortSprites runs it, with the item buffers kept between calls
+    void RadixSortSprites(SortMode mode, const std::vector<SpriteInfo>& queue, std::vector<uint64_t>& items,
+        std::vector<uint64_t>& scratch, std::vector<const SpriteInfo*>& sorted)
+    {
+        const size_t count = queue.size();
+        items.resize(count);
+        scratch.resize(count);
+
+        switch (mode)
+        {
+            case SortMode::Texture:
+                for (size_t i = 0; i < count; i++)
+                {
+                    auto texture = reinterpret_cast<uintptr_t>(queue[i].texture);
+                    items[i] = RadixSort::MakeItem(static_cast<uint32_t>(texture >> 4), static_cast<uint32_t>(i));
+                }
+                break;
+
+            case SortMode::BackToFront:
+                for (size_t i = 0; i < count; i++)
+                {
+                    items[i] = RadixSort::MakeItem(~RadixSort::FloatKey(queue[i].originRotationDepth.w), static_cast<uint32_t>(i));
+                }
+                break;
+
+            default:
+                for (size_t i = 0; i < count; i++)
+                {
+                    items[i] = RadixSort::MakeItem(RadixSort::FloatKey(queue[i].originRotationDepth.w), static_cast<uint32_t>(i));
+                }
+                break;
+        }
+
+        const uint64_t* result = RadixSort::SortByKey(items.data(), scratch.data(), count);
+
+        sorted.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            sorted[i] = &queue[RadixSort::GetPayload(result[i])];
+        }
+    }
+
+    bool Verify(SortMode mode, std::vector<const SpriteInfo*> reference, const std::vector<const SpriteInfo*>& sorted)
+    {
+        if (mode != SortMode::Texture)
+        {
+            // Sprites are queued in address order, so a stable sort of that order is the one answer
+            std::stable_sort(reference.begin(), reference.end(), [mode](const SpriteInfo* x, const SpriteInfo* y) noexcept
+                {
+                    return mode == SortMode::BackToFront
+                        ? x->originRotationDepth.w > y->originRotationDepth.w
+                        : x->originRotationDepth.w < y->originRotationDepth.w;
+                });
+            return reference == sorted;
+        }
+
+        // Textures may come in any order, but each one in a single run in submission order
+        std::unordered_set<const Texture*> seen;
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            if (i > 0 && sorted[i]->texture == sorted[i - 1]->texture)
+            {
+                if (sorted[i] < sorted[i - 1])
+                    return false;
+            }
+            else if (!seen.insert(sorted[i]->texture).second)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CheckFloatKeyOrder()
+    {
+        const float values[] = { -INFINITY, -3.5f, -1.0f, -1e-30f, -0.0f, 0.0f, 1e-30f, 1.0f, 2.0f, INFINITY };
+        for (size_t i = 1; i < std::size(values); i++)
+        {
+            if (RadixSort::FloatKey(values[i - 1]) > RadixSort::FloatKey(values[i]))
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int textureCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 24;
+
+    if (!CheckFloatKeyOrder())
+    {
+        printf("ERROR: FloatKey does not preserve the order of floats\n");
+        return 1;
+    }
+
+    auto textures = std::make_unique<Texture[]>(static_cast<size_t>(textureCount));
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> pickTexture(0, textureCount - 1);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+    printf("%d textures, random depths with some repeated\n", textureCount);
+    printf("%8s  %-12s %12s %12s %8s\n", "sprites", "mode", "std::sort", "radix", "speedup");
+
+    bool failed = false;
+    for (size_t count : { size_t(1000), size_t(10000), size_t(100000) })
+    {
+        std::vector<SpriteInfo> queue(count);
+        for (auto& sprite : queue)
+        {
+            sprite = {};
+            sprite.texture = &textures[static_cast<size_t>(pickTexture(random))];
+
+            // Quantized like a UI layer value, so equal depths exercise stability
+            sprite.originRotationDepth.w = std::floor(depth(random) * 256.0f) / 256.0f;
+        }
+
+        std::vector<const SpriteInfo*> unsorted(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            unsorted[i] = &queue[i];
+        }
+
+        std::vector<const SpriteInfo*> reference;
+        std::vector<const SpriteInfo*> sorted;
+        std::vector<uint64_t> items;
+        std::vector<uint64_t> scratch;
+
+        const int repeats = static_cast<int>(std::max<size_t>(5, 2000000 / count));
+
+        for (SortMode mode : { SortMode::Texture, SortMode::BackToFront, SortMode::FrontToBack })
+        {
+            double comparisonMicroseconds = 0.0;
+            double radixMicroseconds = 0.0;
+            for (int repeat = 0; repeat < repeats; repeat++)
+            {
+                reference = unsorted;
+
+                auto start = std::chrono::steady_clock::now();
+                ComparisonSort(mode, reference);
+                auto middle = std::chrono::steady_clock::now();
+                RadixSortSprites(mode, queue, items, scratch, sorted);
+                auto end = std::chrono::steady_clock::now();
+
+                comparisonMicroseconds += std::chrono::duration<double, std::micro>(middle - start).count();
+                radixMicroseconds += std::chrono::duration<double, std::micro>(end - middle).count();
+            }
+            comparisonMicroseconds /= repeats;
+            radixMicroseconds /= repeats;
+
+            const bool ok = Verify(mode, unsorted, sorted);
+            failed |= !ok;
+
+            printf("%8zu  %-12s %9.1f us %9.1f us %7.2fx%s\n", count, ModeName(mode),
+                comparisonMicroseconds, radixMicroseconds, comparisonMicroseconds / radixMicroseconds, ok ? "" : "  WRONG ORDER");
+        }
+    }
+
+    return failed ? 1 : 0;
+}
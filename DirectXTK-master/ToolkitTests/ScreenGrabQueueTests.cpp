@@ -0,0 +1,468 @@
+//--------------------------------------------------------------------------------------
+// File: ScreenGrabQueueTests.cpp
+//
+// Tests for ScreenGrabQueue with synthetic images. CPU images go through Submit to
+// callbacks, DDS and raw files, including callbacks that throw, and textures filled on a
+// WARP device go through Capture while another thread polls GetStatistics, and again
+// while the capture size and format change. Every image that comes back is compared with
+// what was sent.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "ScreenGrabQueue.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    constexpr uint32_t c_width = 37;
+    constexpr uint32_t c_height = 19;
+
+    uint8_t Expected(uint32_t frame, uint32_t x, uint32_t y, uint32_t channel)
+    {
+        return static_cast<uint8_t>(frame * 31 + x * 7 + y * 13 + channel * 64);
+    }
+
+    // RGBA8 rows with padding after each, as a mapped texture would have
+    std::vector<uint8_t> MakePixels(uint32_t frame, size_t rowPitch)
+    {
+        std::vector<uint8_t> pixels(rowPitch * c_height, 0xcd);
+        for (uint32_t y = 0; y < c_height; ++y)
+        {
+            for (uint32_t x = 0; x < c_width; ++x)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    pixels[y * rowPitch + x * 4 + c] = Expected(frame, x, y, c);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    bool Matches(const ScreenGrabImage& image, uint32_t frame)
+    {
+        if (image.format != DXGI_FORMAT_R8G8B8A8_UNORM || image.width != c_width || image.height != c_height)
+            return false;
+
+        for (uint32_t y = 0; y < c_height; ++y)
+        {
+            for (uint32_t x = 0; x < c_width; ++x)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    if (image.pixels[y * image.rowPitch + x * 4 + c] != Expected(frame, x, y, c))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Records which frames came back, in order, and whether their pixels were right
+    struct Receiver
+    {
+        std::mutex lock;
+        std::vector<uint32_t> frames;
+        bool packed = true;
+        bool correct = true;
+
+        ScreenGrabQueue::Target MakeTarget(uint32_t frame, bool throws = false)
+        {
+            ScreenGrabQueue::Target target = {};
+            target.encoding = ScreenGrabQueue::Encoding::Callback;
+            target.callback = [this, frame, throws](const ScreenGrabImage& image)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    frames.push_back(frame);
+                    packed = packed && image.rowPitch == c_width * 4;
+                    correct = correct && Matches(image, frame);
+                }
+                if (throws)
+                {
+                    if (frame % 4 == 0)
+                        throw std::runtime_error("callback failure");
+                    throw frame;
+                }
+            };
+            return target;
+        }
+    };
+
+    void TestSubmitCallbacks(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const int failures = g_failures;
+        constexpr uint32_t frameCount = 64;
+
+        // Two pending encodes at most, so Submit has to wait on the encode thread
+        ScreenGrabQueue queue(device, 2, 4, 2);
+        Receiver receiver;
+
+        const size_t rowPitch = c_width * 4 + 12;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            const auto pixels = MakePixels(frame, rowPitch);
+            const ScreenGrabImage image = { DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, rowPitch, pixels.data() };
+            queue.Submit(image, receiver.MakeTarget(frame));
+        }
+        queue.Flush(context);
+
+        CHECK(receiver.frames.size() == frameCount);
+        for (uint32_t frame = 0; frame < receiver.frames.size(); ++frame)
+        {
+            CHECK(receiver.frames[frame] == frame);
+        }
+        CHECK(receiver.packed);
+        CHECK(receiver.correct);
+
+        const auto stats = queue.GetStatistics();
+        CHECK(stats.captured == frameCount);
+        CHECK(stats.written == frameCount);
+        CHECK(stats.failed == 0);
+        CHECK(stats.readbacksInFlight == 0);
+        CHECK(stats.encodesPending == 0);
+
+        printf("%-28s %s (%llu encode waits)\n", "Submit to callbacks", failures == g_failures ? "ok" : "FAILED",
+            static_cast<unsigned long long>(stats.encodeWaits));
+    }
+
+    void TestThrowingCallbacks(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const int failures = g_failures;
+        constexpr uint32_t frameCount = 16;
+
+        ScreenGrabQueue queue(device);
+        Receiver receiver;
+
+        uint64_t throwing = 0;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            // Every other callback throws, half of them something that is not a std::exception
+            const bool throws = (frame & 1) == 0;
+            if (throws)
+                ++throwing;
+
+            const auto pixels = MakePixels(frame, c_width * 4);
+            const ScreenGrabImage image = { DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, c_width * 4, pixels.data() };
+            queue.Submit(image, receiver.MakeTarget(frame, throws));
+        }
+        queue.Flush(context);
+
+        // The encode thread survives and keeps going after each throw
+        CHECK(receiver.frames.size() == frameCount);
+        CHECK(receiver.correct);
+
+        const auto stats = queue.GetStatistics();
+        CHECK(stats.failed == throwing);
+        CHECK(stats.written == frameCount - throwing);
+        CHECK(stats.encodesPending == 0);
+
+        printf("%-28s %s\n", "Throwing callbacks", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    bool ReadBytes(const std::filesystem::path& path, std::vector<uint8_t>& bytes)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool EndsWithPixels(const std::vector<uint8_t>& bytes, uint32_t frame)
+    {
+        const size_t imageBytes = c_width * 4 * c_height;
+        if (bytes.size() < imageBytes)
+            return false;
+
+        const ScreenGrabImage image = { DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, c_width * 4, bytes.data() + bytes.size() - imageBytes };
+        return Matches(image, frame);
+    }
+
+    void TestFiles(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const int failures = g_failures;
+        constexpr uint32_t frameCount = 8;
+
+        const auto directory = std::filesystem::temp_directory_path() / "ScreenGrabQueueTests";
+        std::filesystem::create_directories(directory);
+
+        ScreenGrabQueue queue(device);
+        const size_t rowPitch = c_width * 4 + 4;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            const auto pixels = MakePixels(frame, rowPitch);
+            const ScreenGrabImage image = { DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, rowPitch, pixels.data() };
+
+            ScreenGrabQueue::Target target = {};
+            target.encoding = ScreenGrabQueue::Encoding::Raw;
+            target.fileName = (directory / (L"frame" + std::to_wstring(frame) + L".raw")).wstring();
+            queue.Submit(image, target);
+
+            target.encoding = ScreenGrabQueue::Encoding::DDS;
+            target.fileName = (directory / (L"frame" + std::to_wstring(frame) + L".dds")).wstring();
+            queue.Submit(image, target);
+        }
+
+        // A folder that does not exist fails the write, not the queue
+        ScreenGrabQueue::Target missing = {};
+        missing.encoding = ScreenGrabQueue::Encoding::Raw;
+        missing.fileName = (directory / L"missing" / L"frame.raw").wstring();
+        const auto pixels = MakePixels(0, c_width * 4);
+        queue.Submit({ DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, c_width * 4, pixels.data() }, missing);
+
+        queue.Flush(context);
+
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            std::vector<uint8_t> raw;
+            CHECK(ReadBytes(directory / (L"frame" + std::to_wstring(frame) + L".raw"), raw));
+            CHECK(raw.size() == c_width * 4 * c_height);
+            CHECK(EndsWithPixels(raw, frame));
+
+            std::vector<uint8_t> dds;
+            CHECK(ReadBytes(directory / (L"frame" + std::to_wstring(frame) + L".dds"), dds));
+            CHECK(dds.size() > 128 && memcmp(dds.data(), "DDS ", 4) == 0);
+            CHECK(EndsWithPixels(dds, frame));
+        }
+
+        const auto stats = queue.GetStatistics();
+        CHECK(stats.written == frameCount * 2);
+        CHECK(stats.failed == 1);
+
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+
+        printf("%-28s %s\n", "Submit to files", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestCapture(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const int failures = g_failures;
+        constexpr uint32_t frameCount = 100;
+        constexpr uint32_t maxInFlight = 4;
+
+        CD3D11_TEXTURE2D_DESC desc(DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, 1, 1, D3D11_BIND_SHADER_RESOURCE);
+        ComPtr<ID3D11Texture2D> texture;
+        HRESULT hr = device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf());
+        CHECK(SUCCEEDED(hr));
+        if (FAILED(hr))
+            return;
+
+        ScreenGrabQueue queue(device, 2, maxInFlight);
+        Receiver receiver;
+
+        // Statistics are read while the render thread captures, as a UI overlay would
+        std::atomic<bool> done(false);
+        std::atomic<size_t> maxReadbacks(0);
+        std::thread poller([&]()
+        {
+            while (!done)
+            {
+                const auto stats = queue.GetStatistics();
+                if (stats.readbacksInFlight > maxReadbacks)
+                    maxReadbacks = stats.readbacksInFlight;
+                std::this_thread::yield();
+            }
+        });
+
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            const auto pixels = MakePixels(frame, c_width * 4);
+            context->UpdateSubresource(texture.Get(), 0, nullptr, pixels.data(), c_width * 4, 0);
+
+            hr = queue.Capture(context, texture.Get(), receiver.MakeTarget(frame));
+            CHECK(SUCCEEDED(hr));
+            queue.Update(context);
+        }
+        queue.Flush(context);
+
+        done = true;
+        poller.join();
+
+        CHECK(receiver.frames.size() == frameCount);
+        for (uint32_t frame = 0; frame < receiver.frames.size(); ++frame)
+        {
+            CHECK(receiver.frames[frame] == frame);
+        }
+        CHECK(receiver.packed);
+        CHECK(receiver.correct);
+        CHECK(maxReadbacks <= maxInFlight);
+
+        const auto stats = queue.GetStatistics();
+        CHECK(stats.captured == frameCount);
+        CHECK(stats.written == frameCount);
+        CHECK(stats.failed == 0);
+        CHECK(stats.readbacksInFlight == 0);
+
+        printf("%-28s %s (%llu GPU waits, at most %zu in flight)\n", "Capture on WARP", failures == g_failures ? "ok" : "FAILED",
+            static_cast<unsigned long long>(stats.gpuWaits), maxReadbacks.load());
+    }
+
+    // The capture size and format change while earlier captures are still in flight, as when a
+    // window is resized during a recording. Every frame comes back with the size and format it
+    // was captured with, and the staging pool only creates new textures after each change.
+    void TestCaptureResize(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const int failures = g_failures;
+        constexpr uint32_t framesPerSize = 24;
+        constexpr uint32_t maxInFlight = 4;
+
+        struct Size
+        {
+            DXGI_FORMAT format;
+            uint32_t width;
+            uint32_t height;
+        };
+        const Size sizes[] =
+        {
+            { DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height },
+            { DXGI_FORMAT_R8G8B8A8_UNORM, c_width * 2, c_height + 5 },
+            { DXGI_FORMAT_B8G8R8A8_UNORM, c_width * 2, c_height + 5 },
+            { DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height },
+        };
+        constexpr uint32_t sizeCount = static_cast<uint32_t>(std::size(sizes));
+
+        ScreenGrabQueue queue(device, 2, maxInFlight);
+
+        std::mutex lock;
+        std::vector<uint32_t> frames;
+        bool correct = true;
+
+        uint64_t created = 0;
+        for (uint32_t s = 0; s < sizeCount; ++s)
+        {
+            const Size size = sizes[s];
+
+            CD3D11_TEXTURE2D_DESC desc(size.format, size.width, size.height, 1, 1, D3D11_BIND_SHADER_RESOURCE);
+            ComPtr<ID3D11Texture2D> texture;
+            HRESULT hr = device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf());
+            CHECK(SUCCEEDED(hr));
+            if (FAILED(hr))
+                return;
+
+            for (uint32_t i = 0; i < framesPerSize; ++i)
+            {
+                // Each frame is filled with its own number
+                const uint32_t frame = s * framesPerSize + i;
+                const std::vector<uint8_t> pixels(size_t(size.width) * 4 * size.height, static_cast<uint8_t>(frame));
+                context->UpdateSubresource(texture.Get(), 0, nullptr, pixels.data(), size.width * 4, 0);
+
+                ScreenGrabQueue::Target target = {};
+                target.encoding = ScreenGrabQueue::Encoding::Callback;
+                target.callback = [&, size, frame](const ScreenGrabImage& image)
+                {
+                    const size_t last = (size_t(image.height) - 1) * image.rowPitch + size_t(image.width) * 4 - 1;
+
+                    std::lock_guard<std::mutex> guard(lock);
+                    frames.push_back(frame);
+                    correct = correct && image.format == size.format && image.width == size.width && image.height == size.height
+                        && image.pixels[0] == static_cast<uint8_t>(frame) && image.pixels[last] == static_cast<uint8_t>(frame);
+                };
+
+                hr = queue.Capture(context, texture.Get(), target);
+                CHECK(SUCCEEDED(hr));
+                queue.Update(context);
+            }
+
+            // Textures of the previous size still in flight are neither reused nor pooled
+            const uint64_t stagingCreated = queue.GetStatistics().stagingCreated;
+            CHECK(stagingCreated - created <= maxInFlight);
+            created = stagingCreated;
+        }
+        queue.Flush(context);
+
+        CHECK(frames.size() == framesPerSize * sizeCount);
+        for (uint32_t frame = 0; frame < frames.size(); ++frame)
+        {
+            CHECK(frames[frame] == frame);
+        }
+        CHECK(correct);
+
+        const auto stats = queue.GetStatistics();
+        CHECK(stats.written == framesPerSize * sizeCount);
+        CHECK(stats.failed == 0);
+        CHECK(stats.readbacksInFlight == 0);
+
+        printf("%-28s %s (%llu staging textures for %u sizes)\n", "Capture while resizing", failures == g_failures ? "ok" : "FAILED",
+            static_cast<unsigned long long>(stats.stagingCreated), sizeCount);
+    }
+
+    void TestInvalidSubmit(ID3D11Device* device)
+    {
+        ScreenGrabQueue queue(device);
+        bool threw = false;
+        try
+        {
+            queue.Submit({ DXGI_FORMAT_R8G8B8A8_UNORM, c_width, c_height, c_width * 4, nullptr }, ScreenGrabQueue::Target{});
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(queue.GetStatistics().captured == 0);
+    }
+}
+
+int main()
+{
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED)))
+        return 1;
+
+    ComPtr<ID3D11Device> device;
+    ComPtr<ID3D11DeviceContext> context;
+    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0,
+        D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, context.GetAddressOf());
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed creating a WARP device (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    TestSubmitCallbacks(device.Get(), context.Get());
+    TestThrowingCallbacks(device.Get(), context.Get());
+    TestFiles(device.Get(), context.Get());
+    TestCapture(device.Get(), context.Get());
+    TestCaptureResize(device.Get(), context.Get());
+    TestInvalidSubmit(device.Get());
+
+    context.Reset();
+    device.Reset();
+    CoUninitialize();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
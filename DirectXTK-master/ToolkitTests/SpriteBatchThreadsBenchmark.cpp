@@ -0,0 +1,319 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteBatchThreadsBenchmark.cpp
+//
+// Thread scaling benchmark for SpriteBatch::ThreadQueue. The same list of sprites is
+// recorded once with SpriteBatch::Draw on one thread, and once split into contiguous runs
+// that worker threads record into their own queues, for 1 thread up to the number of cores.
+// Reports the time to record, and to End, which merges, sorts and draws. Every threaded
+// frame is also rendered on WARP and read back, and must match the single threaded image.
+//
+// Usage: spritebatchthreadsbenchmark [sprites] [textures]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "SpriteBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr UINT c_targetSize = 256;
+
+    struct Sprite
+    {
+        ID3D11ShaderResourceView* texture;
+        XMFLOAT2 position;
+        XMFLOAT4 color;
+        float rotation;
+        float scale;
+        float depth;
+    };
+
+    struct Timing
+    {
+        double record;
+        double end;
+    };
+
+    const char* ModeName(SpriteSortMode mode)
+    {
+        switch (mode)
+        {
+            case SpriteSortMode_Deferred:    return "Deferred";
+            case SpriteSortMode_Texture:     return "Texture";
+            case SpriteSortMode_BackToFront: return "BackToFront";
+            default:                         return "FrontToBack";
+        }
+    }
+
+    ComPtr<ID3D11ShaderResourceView> MakeTexture(ID3D11Device* device, uint32_t seed)
+    {
+        constexpr UINT size = 8;
+
+        std::mt19937 random(seed);
+        std::vector<uint32_t> texels(size * size);
+        for (auto& texel : texels)
+        {
+            texel = random() | 0xff000000;
+        }
+
+        CD3D11_TEXTURE2D_DESC desc(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+        D3D11_SUBRESOURCE_DATA data = { texels.data(), static_cast<UINT>(size * sizeof(uint32_t)), 0 };
+
+        ComPtr<ID3D11Texture2D> texture;
+        ComPtr<ID3D11ShaderResourceView> view;
+        if (FAILED(device->CreateTexture2D(&desc, &data, texture.GetAddressOf()))
+            || FAILED(device->CreateShaderResourceView(texture.Get(), nullptr, view.GetAddressOf())))
+        {
+            return nullptr;
+        }
+        return view;
+    }
+
+    // Textures are picked at random, like glyphs and UI parts mixed in one layer. Depths are
+    // distinct, so every sort mode has a single correct order.
+    std::vector<Sprite> MakeSprites(size_t count, const std::vector<ComPtr<ID3D11ShaderResourceView>>& textures)
+    {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<size_t> pickTexture(0, textures.size() - 1);
+        std::uniform_real_distribution<float> position(-8.0f, c_targetSize + 8.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<Sprite> sprites(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            Sprite& sprite = sprites[i];
+            sprite.texture = textures[pickTexture(random)].Get();
+            sprite.position = XMFLOAT2(position(random), position(random));
+            sprite.color = XMFLOAT4(unit(random), unit(random), unit(random), 1.0f);
+            sprite.rotation = (i % 4) ? unit(random) * XM_2PI : 0.0f;
+            sprite.scale = 0.5f + unit(random) * 2.0f;
+            sprite.depth = static_cast<float>(i) / static_cast<float>(count);
+        }
+
+        std::shuffle(sprites.begin(), sprites.end(), random);
+        return sprites;
+    }
+
+    template<typename TTarget>
+    void DrawRange(TTarget& target, const Sprite* sprites, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const Sprite& sprite = sprites[i];
+            target.Draw(sprite.texture, sprite.position, nullptr, XMLoadFloat4(&sprite.color),
+                sprite.rotation, XMFLOAT2(4, 4), sprite.scale, SpriteEffects_None, sprite.depth);
+        }
+    }
+
+    // threadCount 0 draws directly on this thread, otherwise each worker records one
+    // contiguous run into its own queue.
+    Timing RecordFrame(SpriteBatch& spriteBatch, SpriteSortMode mode, const std::vector<Sprite>& sprites, unsigned int threadCount)
+    {
+        spriteBatch.Begin(mode);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        if (threadCount == 0)
+        {
+            DrawRange(spriteBatch, sprites.data(), sprites.size());
+        }
+        else
+        {
+            // Queues must be fetched on the thread that called Begin
+            std::vector<SpriteBatch::ThreadQueue*> queues;
+            for (unsigned int t = 0; t < threadCount; t++)
+            {
+                queues.push_back(&spriteBatch.GetThreadQueue(t));
+            }
+
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < threadCount; t++)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    const size_t first = sprites.size() * t / threadCount;
+                    const size_t last = sprites.size() * (t + 1) / threadCount;
+                    DrawRange(*queues[t], sprites.data() + first, last - first);
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        const auto middle = std::chrono::steady_clock::now();
+
+        spriteBatch.End();
+
+        const auto end = std::chrono::steady_clock::now();
+
+        Timing timing;
+        timing.record = std::chrono::duration<double, std::milli>(middle - start).count();
+        timing.end = std::chrono::duration<double, std::milli>(end - middle).count();
+        return timing;
+    }
+
+    class Target
+    {
+    public:
+        bool Initialize(ID3D11Device* device, ID3D11DeviceContext* context)
+        {
+            mContext = context;
+
+            CD3D11_TEXTURE2D_DESC desc(DXGI_FORMAT_R8G8B8A8_UNORM, c_targetSize, c_targetSize, 1, 1, D3D11_BIND_RENDER_TARGET);
+            if (FAILED(device->CreateTexture2D(&desc, nullptr, mTexture.GetAddressOf()))
+                || FAILED(device->CreateRenderTargetView(mTexture.Get(), nullptr, mView.GetAddressOf())))
+            {
+                return false;
+            }
+
+            desc.BindFlags = 0;
+            desc.Usage = D3D11_USAGE_STAGING;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            if (FAILED(device->CreateTexture2D(&desc, nullptr, mStaging.GetAddressOf())))
+                return false;
+
+            CD3D11_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(c_targetSize), static_cast<float>(c_targetSize));
+            context->RSSetViewports(1, &viewport);
+            context->OMSetRenderTargets(1, mView.GetAddressOf(), nullptr);
+            return true;
+        }
+
+        void Clear()
+        {
+            const float black[4] = { 0, 0, 0, 1 };
+            mContext->ClearRenderTargetView(mView.Get(), black);
+        }
+
+        std::vector<uint8_t> Read()
+        {
+            std::vector<uint8_t> pixels;
+
+            mContext->CopyResource(mStaging.Get(), mTexture.Get());
+
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            if (SUCCEEDED(mContext->Map(mStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
+            {
+                auto source = static_cast<const uint8_t*>(mapped.pData);
+                for (UINT y = 0; y < c_targetSize; y++)
+                {
+                    pixels.insert(pixels.end(), source + y * mapped.RowPitch, source + y * mapped.RowPitch + c_targetSize * 4);
+                }
+                mContext->Unmap(mStaging.Get(), 0);
+            }
+            return pixels;
+        }
+
+    private:
+        ID3D11DeviceContext* mContext = nullptr;
+        ComPtr<ID3D11Texture2D> mTexture;
+        ComPtr<ID3D11Texture2D> mStaging;
+        ComPtr<ID3D11RenderTargetView> mView;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const size_t spriteCount = argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 100000;
+    const int textureCount = argc > 2 ? std::max(1, std::atoi(argv[2])) : 16;
+
+    // WARP, so the benchmark runs without a GPU; the recording being measured is all on the CPU
+    ComPtr<ID3D11Device> device;
+    ComPtr<ID3D11DeviceContext> context;
+    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0,
+        D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, context.GetAddressOf());
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed creating a WARP device (%08X)\n", static_cast<unsigned int>(hr));
+        return 1;
+    }
+
+    std::vector<ComPtr<ID3D11ShaderResourceView>> textures;
+    for (int i = 0; i < textureCount; i++)
+    {
+        textures.push_back(MakeTexture(device.Get(), static_cast<uint32_t>(i)));
+        if (!textures.back())
+        {
+            printf("ERROR: Failed creating textures\n");
+            return 1;
+        }
+    }
+
+    Target target;
+    if (!target.Initialize(device.Get(), context.Get()))
+    {
+        printf("ERROR: Failed creating the render target\n");
+        return 1;
+    }
+
+    const std::vector<Sprite> sprites = MakeSprites(spriteCount, textures);
+
+    SpriteBatch spriteBatch(context.Get());
+
+    const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    const int repeats = static_cast<int>(std::max<size_t>(3, 2000000 / spriteCount));
+
+    printf("%zu sprites, %d textures, %u cores\n", spriteCount, textureCount, maxThreads);
+    printf("%-12s %7s %12s %10s %12s\n", "mode", "threads", "record", "speedup", "End");
+
+    bool failed = false;
+    for (SpriteSortMode mode : { SpriteSortMode_Deferred, SpriteSortMode_Texture, SpriteSortMode_BackToFront })
+    {
+        target.Clear();
+        RecordFrame(spriteBatch, mode, sprites, 0);
+        const std::vector<uint8_t> expected = target.Read();
+
+        double serialRecord = 0;
+        double serialEnd = 0;
+        for (int repeat = 0; repeat < repeats; repeat++)
+        {
+            const Timing timing = RecordFrame(spriteBatch, mode, sprites, 0);
+            serialRecord += timing.record / repeats;
+            serialEnd += timing.end / repeats;
+        }
+        printf("%-12s %7s %9.2f ms %10s %9.2f ms\n", ModeName(mode), "direct", serialRecord, "", serialEnd);
+
+        for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            // Each worker's run goes in whole and in index order, so the image must not change
+            target.Clear();
+            RecordFrame(spriteBatch, mode, sprites, threads);
+            const bool same = target.Read() == expected;
+            failed |= !same;
+
+            double record = 0;
+            double end = 0;
+            for (int repeat = 0; repeat < repeats; repeat++)
+            {
+                const Timing timing = RecordFrame(spriteBatch, mode, sprites, threads);
+                record += timing.record / repeats;
+                end += timing.end / repeats;
+            }
+
+            printf("%-12s %7u %9.2f ms %9.2fx %9.2f ms%s\n", ModeName(mode), threads, record, serialRecord / record, end,
+                same ? "" : "  IMAGE DIFFERS");
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,370 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteChunkGridTests.cpp
+//
+// Checks the chunk culling SpriteLayer uses, with a tilemap of 1024x1024 tiles in
+// SpriteLayer's default 512 pixel chunks. For viewports the camera pans, zooms and rotates
+// through, the chunks drawn must be exactly those not wholly beyond one edge of the view,
+// which takes in every chunk whose sprites reach into it, and only the dirty ones among
+// them may be rebuilt. Needs no Direct3D device.
+//
+// Usage: spritechunkgridtests [tiles per side]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// SpriteChunkGrid.h relies on the precompiled header for SAL
+#include <sal.h>
+
+#include "SpriteChunkGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    constexpr float c_tileSize = 16;
+    constexpr float c_chunkSize = 512;
+
+    // Same layout and flags as the sprites SpriteLayer stores
+    struct alignas(16) LayerSprite
+    {
+        XMFLOAT4A source;
+        XMFLOAT4A destination;
+        XMFLOAT4A color;
+        XMFLOAT4A originRotationDepth;
+        unsigned int flags;
+
+        static constexpr unsigned int SourceInTexels = 4;
+        static constexpr unsigned int DestSizeInPixels = 8;
+    };
+
+    struct Chunk
+    {
+        std::vector<LayerSprite> sprites;
+        XMFLOAT4 bounds;
+        bool dirty;
+
+        // Where the chunk is in the grid, from the position of its first sprite
+        int cellX;
+        int cellY;
+    };
+
+    using Grid = SpriteChunkGrid<Chunk>;
+
+    const XMVECTORF32 c_textureSize = { { { 256.0f, 256.0f, 0.0f, 0.0f } } };
+
+    LayerSprite MakeSprite(float x, float y, float width, float height, float rotation = 0, float originX = 0, float originY = 0)
+    {
+        LayerSprite sprite = {};
+        sprite.source = XMFLOAT4A(0, 0, c_tileSize, c_tileSize);
+        sprite.destination = XMFLOAT4A(x, y, width, height);
+        sprite.color = XMFLOAT4A(1, 1, 1, 1);
+        sprite.originRotationDepth = XMFLOAT4A(originX, originY, rotation, 0);
+        sprite.flags = LayerSprite::SourceInTexels | LayerSprite::DestSizeInPixels;
+        return sprite;
+    }
+
+    Grid::Location Add(Grid& grid, LayerSprite const& sprite)
+    {
+        const Grid::Location location = grid.Add(sprite, c_textureSize, XMVectorReciprocal(c_textureSize));
+
+        Chunk& chunk = grid[location.chunk];
+        if (location.sprite == 0)
+        {
+            chunk.cellX = static_cast<int>(std::floor(sprite.destination.x / c_chunkSize));
+            chunk.cellY = static_cast<int>(std::floor(sprite.destination.y / c_chunkSize));
+        }
+        return location;
+    }
+
+    // The transform SpriteBatch::DrawLayer passes with the default rotation: the camera
+    // transform, then the viewport's pixels to clip space
+    XMMATRIX ViewTransform(XMMATRIX camera, float viewportWidth, float viewportHeight)
+    {
+        const XMMATRIX viewport(
+            XMVectorSet(2.0f / viewportWidth, 0, 0, 0),
+            XMVectorSet(0, -2.0f / viewportHeight, 0, 0),
+            XMVectorSet(0, 0, 1, 0),
+            XMVectorSet(-1, 1, 0, 1));
+        return XMMatrixMultiply(camera, viewport);
+    }
+
+    // True when every corner of the bounds is beyond the same edge of the view, a convex
+    // quad in layer space. That is when IsVisible culls, worked out without the clip volume.
+    bool BeyondAnEdge(XMFLOAT4 const& bounds, XMFLOAT2 const (&view)[4])
+    {
+        const XMFLOAT2 corners[4] = { { bounds.x, bounds.y }, { bounds.z, bounds.y }, { bounds.z, bounds.w }, { bounds.x, bounds.w } };
+        for (size_t i = 0; i < 4; i++)
+        {
+            const XMFLOAT2& a = view[i];
+            const XMFLOAT2& b = view[(i + 1) % 4];
+            const XMFLOAT2& c = view[(i + 2) % 4];
+
+            const double nx = double(a.y) - b.y;
+            const double ny = double(b.x) - a.x;
+            const double inside = nx * (c.x - a.x) + ny * (c.y - a.y);
+
+            bool beyond = true;
+            for (const XMFLOAT2& corner : corners)
+            {
+                if ((nx * (corner.x - a.x) + ny * (corner.y - a.y)) * inside >= 0)
+                    beyond = false;
+            }
+            if (beyond)
+                return true;
+        }
+        return false;
+    }
+
+    // Whether the bounds and the view overlap at all. Near the corners of a rotated view,
+    // bounds can miss it without being beyond any one edge, so IsVisible keeps a few more.
+    bool Overlaps(XMFLOAT4 const& bounds, XMFLOAT2 const (&view)[4])
+    {
+        float minX = view[0].x, maxX = view[0].x, minY = view[0].y, maxY = view[0].y;
+        for (const XMFLOAT2& corner : view)
+        {
+            minX = std::min(minX, corner.x);
+            maxX = std::max(maxX, corner.x);
+            minY = std::min(minY, corner.y);
+            maxY = std::max(maxY, corner.y);
+        }
+        if (maxX < bounds.x || minX > bounds.z || maxY < bounds.y || minY > bounds.w)
+            return false;
+
+        return !BeyondAnEdge(bounds, view);
+    }
+
+    // The layer space corners of the viewport, found by inverting the camera transform
+    void ViewCorners(XMMATRIX camera, float viewportWidth, float viewportHeight, XMFLOAT2 (&view)[4])
+    {
+        XMVECTOR determinant;
+        const XMMATRIX inverse = XMMatrixInverse(&determinant, camera);
+        const XMFLOAT2 screen[4] = { { 0, 0 }, { viewportWidth, 0 }, { viewportWidth, viewportHeight }, { 0, viewportHeight } };
+        for (size_t i = 0; i < 4; i++)
+        {
+            XMStoreFloat2(&view[i], XMVector2Transform(XMLoadFloat2(&screen[i]), inverse));
+        }
+    }
+
+    struct Frame
+    {
+        std::set<std::pair<int, int>> drawn;
+        std::set<std::pair<int, int>> rebuilt;
+    };
+
+    Frame Render(Grid& grid, XMMATRIX camera, float viewportWidth, float viewportHeight)
+    {
+        Frame frame;
+        grid.Render(ViewTransform(camera, viewportWidth, viewportHeight),
+            [&](Chunk& chunk)
+            {
+                CHECK(chunk.dirty);
+                frame.rebuilt.emplace(chunk.cellX, chunk.cellY);
+            },
+            [&](Chunk& chunk)
+            {
+                frame.drawn.emplace(chunk.cellX, chunk.cellY);
+            });
+
+        CHECK(grid.GetDrawnChunkCount() == frame.drawn.size());
+        CHECK(grid.GetRebuiltChunkCount() == frame.rebuilt.size());
+        return frame;
+    }
+
+    // The chunks that should be drawn, and the ones that actually overlap the view
+    std::set<std::pair<int, int>> Expected(const Grid& grid, XMMATRIX camera, float viewportWidth, float viewportHeight, bool overlapping = false)
+    {
+        XMFLOAT2 view[4];
+        ViewCorners(camera, viewportWidth, viewportHeight, view);
+
+        std::set<std::pair<int, int>> visible;
+        for (size_t i = 0; i < grid.GetChunkCount(); i++)
+        {
+            if (overlapping ? Overlaps(grid[i].bounds, view) : !BeyondAnEdge(grid[i].bounds, view))
+                visible.emplace(grid[i].cellX, grid[i].cellY);
+        }
+        return visible;
+    }
+
+    std::set<std::pair<int, int>> Cells(int left, int top, int right, int bottom)
+    {
+        std::set<std::pair<int, int>> cells;
+        for (int y = top; y <= bottom; y++)
+        {
+            for (int x = left; x <= right; x++)
+            {
+                cells.emplace(x, y);
+            }
+        }
+        return cells;
+    }
+
+    void TestIsVisible()
+    {
+        const int failures = g_failures;
+
+        // A 100x100 viewport over layer space
+        const XMMATRIX transform = ViewTransform(XMMatrixIdentity(), 100, 100);
+
+        CHECK(Grid::IsVisible(XMFLOAT4(10, 10, 20, 20), transform));
+        CHECK(Grid::IsVisible(XMFLOAT4(-50, -50, 150, 150), transform));     // Covers the view
+        CHECK(Grid::IsVisible(XMFLOAT4(-50, 40, 150, 60), transform));       // Crosses it
+        CHECK(Grid::IsVisible(XMFLOAT4(90, 90, 110, 110), transform));       // Overlaps a corner
+        CHECK(Grid::IsVisible(XMFLOAT4(100, 0, 120, 10), transform));        // Touches an edge
+        CHECK(!Grid::IsVisible(XMFLOAT4(101, 0, 120, 10), transform));
+        CHECK(!Grid::IsVisible(XMFLOAT4(-20, 0, -1, 100), transform));
+        CHECK(!Grid::IsVisible(XMFLOAT4(0, -20, 100, -1), transform));
+        CHECK(!Grid::IsVisible(XMFLOAT4(0, 101, 100, 200), transform));
+
+        printf("%-28s %s\n", "IsVisible", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestTilemap(int tiles)
+    {
+        const int failures = g_failures;
+
+        Grid grid(c_chunkSize);
+
+        std::vector<Grid::Location> locations;
+        locations.reserve(size_t(tiles) * size_t(tiles));
+        for (int y = 0; y < tiles; y++)
+        {
+            for (int x = 0; x < tiles; x++)
+            {
+                locations.push_back(Add(grid, MakeSprite(float(x) * c_tileSize, float(y) * c_tileSize, c_tileSize, c_tileSize)));
+            }
+        }
+
+        // Every chunk holds a square of tiles, and its bounds are exactly that square
+        const int tilesPerChunk = static_cast<int>(c_chunkSize / c_tileSize);
+        const int chunksPerSide = (tiles + tilesPerChunk - 1) / tilesPerChunk;
+        CHECK(grid.GetChunkCount() == size_t(chunksPerSide) * size_t(chunksPerSide));
+        for (size_t i = 0; i < grid.GetChunkCount(); i++)
+        {
+            const Chunk& chunk = grid[i];
+            const float left = float(chunk.cellX) * c_chunkSize;
+            const float top = float(chunk.cellY) * c_chunkSize;
+            const float right = std::min(left + c_chunkSize, float(tiles) * c_tileSize);
+            const float bottom = std::min(top + c_chunkSize, float(tiles) * c_tileSize);
+            CHECK(chunk.bounds.x == left && chunk.bounds.y == top && chunk.bounds.z == right && chunk.bounds.w == bottom);
+            CHECK(chunk.dirty);
+        }
+
+        // FindChunk maps every point in a chunk's square to that chunk, and nothing else does
+        for (int i = 0; i < 50; i++)
+        {
+            const float x = float(i * 331 % tiles) * c_tileSize + 7.5f;
+            const float y = float(i * 137 % tiles) * c_tileSize + 0.25f;
+            const uint32_t chunk = grid.FindChunk(XMVectorSet(x, y, 0, 0));
+            CHECK(grid[chunk].cellX == int(std::floor(x / c_chunkSize)) && grid[chunk].cellY == int(std::floor(y / c_chunkSize)));
+        }
+        CHECK(grid.GetChunkCount() == size_t(chunksPerSide) * size_t(chunksPerSide));
+
+        // A 1280x720 view with its corners inside chunks (1, 3) and (4, 5)
+        XMMATRIX camera = XMMatrixTranslation(-1000, -2000, 0);
+        Frame frame = Render(grid, camera, 1280, 720);
+        if (tiles == 1024)
+        {
+            CHECK(frame.drawn == Cells(1, 3, 4, 5));
+        }
+        CHECK(frame.drawn == Expected(grid, camera, 1280, 720));
+        CHECK(frame.rebuilt == frame.drawn);
+
+        // Nothing changed, so nothing is rebuilt
+        frame = Render(grid, camera, 1280, 720);
+        CHECK(frame.drawn == Expected(grid, camera, 1280, 720));
+        CHECK(frame.rebuilt.empty());
+
+        // Changing a tile in view and one out of view only rebuilds the first
+        auto touch = [&](int x, int y)
+        {
+            const Grid::Location& location = locations[size_t(y) * size_t(tiles) + size_t(x)];
+            grid[location.chunk].sprites[location.sprite].color = XMFLOAT4A(1, 0, 0, 1);
+            grid[location.chunk].dirty = true;
+        };
+        touch(100, 150);    // Chunk (3, 4)
+        touch(5, 5);        // Chunk (0, 0)
+        frame = Render(grid, camera, 1280, 720);
+        CHECK(frame.rebuilt == Cells(3, 4, 3, 4));
+
+        // Panning to the origin rebuilds chunk (0, 0) and the ones never drawn before
+        camera = XMMatrixIdentity();
+        frame = Render(grid, camera, 1280, 720);
+        CHECK(frame.drawn == Expected(grid, camera, 1280, 720));
+        if (tiles == 1024)
+        {
+            CHECK(frame.drawn == Cells(0, 0, 2, 1));
+            CHECK(frame.rebuilt == Cells(0, 0, 2, 1));
+        }
+
+        // Zoomed out and rotated about the view center
+        camera = XMMatrixTranslation(-4000, -3000, 0) * XMMatrixRotationZ(0.6f) * XMMatrixScaling(0.25f, 0.25f, 1) * XMMatrixTranslation(640, 360, 0);
+        frame = Render(grid, camera, 1280, 720);
+        CHECK(frame.drawn == Expected(grid, camera, 1280, 720));
+
+        const auto overlapping = Expected(grid, camera, 1280, 720, true);
+        CHECK(std::includes(frame.drawn.begin(), frame.drawn.end(), overlapping.begin(), overlapping.end()));
+
+        // Past the end of the map
+        camera = XMMatrixTranslation(-float(tiles) * c_tileSize - 10, 0, 0);
+        frame = Render(grid, camera, 1280, 720);
+        CHECK(frame.drawn.empty());
+        CHECK(frame.rebuilt.empty());
+
+        printf("%-28s %s (%dx%d tiles, %zu chunks)\n", "Tilemap", failures == g_failures ? "ok" : "FAILED", tiles, tiles, grid.GetChunkCount());
+    }
+
+    // A sprite rotated out of its chunk's square still makes the chunk visible
+    void TestRotatedSprite()
+    {
+        const int failures = g_failures;
+
+        Grid grid(c_chunkSize);
+
+        // Positioned in chunk (1, 0) but pointing left, back across chunk (0, 0)
+        Add(grid, MakeSprite(600, 100, 400, 16, XM_PI));
+        const Chunk& chunk = grid[0];
+        CHECK(chunk.bounds.x < 201 && chunk.bounds.z > 599);
+
+        // A view of chunk (0, 0) only
+        const XMMATRIX camera = XMMatrixIdentity();
+        const Frame frame = Render(grid, camera, 400, 400);
+        CHECK(frame.drawn == Cells(1, 0, 1, 0));
+        CHECK(frame.drawn == Expected(grid, camera, 400, 400));
+
+        printf("%-28s %s\n", "Rotated sprite", failures == g_failures ? "ok" : "FAILED");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int tiles = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1024;
+
+    TestIsVisible();
+    TestTilemap(tiles);
+    TestRotatedSprite();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
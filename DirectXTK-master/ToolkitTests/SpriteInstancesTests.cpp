@@ -0,0 +1,311 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteInstancesTests.cpp
+//
+// Tests for the instance records SpriteRenderMode_Instanced draws with. Each packed sprite
+// is expanded the way SpriteInstancedVertexShader does and compared with the four vertices
+// SpriteVertices generates for it: corner 0 and the depth must match exactly, the other
+// corners to float rounding, and the color to half precision. Also walks the instance
+// buffer ring through appends, wraps, growth and resets. Needs no Direct3D device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// The sprite headers rely on the precompiled header for SAL
+#include <sal.h>
+
+#include "SpriteInstances.h"
+#include "SpriteVertices.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    // Same layout as VertexPositionColorTexture
+    struct Vertex
+    {
+        XMFLOAT3 position;
+        XMFLOAT4 color;
+        XMFLOAT2 textureCoordinate;
+    };
+
+    // Same layout and flags as SpriteBatch::Impl::SpriteInfo
+    struct alignas(16) SpriteInfo
+    {
+        XMFLOAT4A source;
+        XMFLOAT4A destination;
+        XMFLOAT4A color;
+        XMFLOAT4A originRotationDepth;
+        const void* texture;
+        unsigned int flags;
+
+        static constexpr unsigned int SourceInTexels = 4;
+        static constexpr unsigned int DestSizeInPixels = 8;
+    };
+
+    std::vector<SpriteInfo> MakeSprites(size_t count, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> value(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_int_distribution<unsigned int> flags(0, 15);
+
+        std::vector<SpriteInfo> sprites(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            SpriteInfo& sprite = sprites[i];
+            sprite = {};
+
+            // Zero sized sources take the epsilon path for the origin
+            sprite.source = XMFLOAT4A(value(random), value(random), (i % 13) ? std::fabs(value(random)) : 0.0f, std::fabs(value(random)));
+            sprite.destination = XMFLOAT4A(value(random), value(random), value(random) / 100, value(random) / 100);
+            sprite.color = XMFLOAT4A(unit(random), unit(random), unit(random), unit(random));
+
+            const float rotation = (i % 3) ? value(random) / 50 : ((i % 2) ? -0.0f : 0.0f);
+            sprite.originRotationDepth = XMFLOAT4A(value(random) / 10, value(random) / 10, rotation, unit(random));
+            sprite.flags = flags(random);
+        }
+        return sprites;
+    }
+
+    // Results are copied out with memcpy, as SpriteBatch copies them into the mapped buffer.
+    // XMStoreFloat2 stores through a double pointer on SSE, which GCC does not order before
+    // later float reads of the same memory.
+    SpriteInstance Pack(const SpriteInfo& sprite, FXMVECTOR textureSize, FXMVECTOR inverseTextureSize)
+    {
+        SpriteInstance packed;
+        SpriteInstances::PackSprite(&sprite, &packed, textureSize, inverseTextureSize);
+
+        SpriteInstance result;
+        memcpy(&result, &packed, sizeof(result));
+        return result;
+    }
+
+    void Render(const SpriteInfo& sprite, Vertex* vertices, FXMVECTOR textureSize, FXMVECTOR inverseTextureSize)
+    {
+        Vertex rendered[SpriteVertices::VerticesPerSprite];
+        SpriteVertices::RenderSprite(&sprite, rendered, textureSize, inverseTextureSize);
+
+        memcpy(vertices, rendered, sizeof(rendered));
+    }
+
+    bool SameBits(float a, float b)
+    {
+        return memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    // Relative to scale, or absolute below 1
+    float Error(float actual, float expected, float scale)
+    {
+        return std::fabs(actual - expected) / std::max(1.0f, scale);
+    }
+
+    void TestMatchesVertices(const char* name, FXMVECTOR textureSize)
+    {
+        const size_t count = 20000;
+        const std::vector<SpriteInfo> sprites = MakeSprites(count, 3);
+
+        const XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+        const int failures = g_failures;
+
+        float positionError = 0;
+        float textureError = 0;
+        float colorError = 0;
+        size_t exactCorners = 0;
+
+        for (const SpriteInfo& sprite : sprites)
+        {
+            Vertex vertices[SpriteVertices::VerticesPerSprite];
+            Render(sprite, vertices, textureSize, inverseTextureSize);
+
+            const SpriteInstance instance = Pack(sprite, textureSize, inverseTextureSize);
+
+            if (SameBits(instance.position.x, vertices[0].position.x)
+                && SameBits(instance.position.y, vertices[0].position.y)
+                && SameBits(instance.textureRect.x, vertices[0].textureCoordinate.x)
+                && SameBits(instance.textureRect.y, vertices[0].textureCoordinate.y))
+            {
+                exactCorners++;
+            }
+
+            const float color[4] =
+            {
+                XMConvertHalfToFloat(instance.color.x),
+                XMConvertHalfToFloat(instance.color.y),
+                XMConvertHalfToFloat(instance.color.z),
+                XMConvertHalfToFloat(instance.color.w),
+            };
+
+            // Corners are sums of the position and axes, so rounding scales with their size
+            const float scale = std::fabs(instance.position.x) + std::fabs(instance.position.y)
+                + std::fabs(instance.axisX.x) + std::fabs(instance.axisX.y)
+                + std::fabs(instance.axisY.x) + std::fabs(instance.axisY.y);
+
+            for (size_t i = 0; i < SpriteVertices::VerticesPerSprite; i++)
+            {
+                // What SpriteInstancedVertexShader computes for corner (u, v)
+                const float u = static_cast<float>(i & 1);
+                const float v = static_cast<float>(i >> 1);
+
+                const Vertex& vertex = vertices[i];
+
+                positionError = std::max(positionError, Error(instance.position.x + u * instance.axisX.x + v * instance.axisY.x, vertex.position.x, scale));
+                positionError = std::max(positionError, Error(instance.position.y + u * instance.axisX.y + v * instance.axisY.y, vertex.position.y, scale));
+                textureError = std::max(textureError, Error(instance.textureRect.x + u * instance.textureRect.z, vertex.textureCoordinate.x, std::fabs(instance.textureRect.x) + std::fabs(instance.textureRect.z)));
+                textureError = std::max(textureError, Error(instance.textureRect.y + v * instance.textureRect.w, vertex.textureCoordinate.y, std::fabs(instance.textureRect.y) + std::fabs(instance.textureRect.w)));
+
+                CHECK(SameBits(instance.depth, vertex.position.z));
+
+                const float* expected = &vertex.color.x;
+                for (size_t j = 0; j < 4; j++)
+                {
+                    colorError = std::max(colorError, Error(color[j], expected[j], std::fabs(expected[j])));
+                }
+            }
+        }
+
+        CHECK(exactCorners == count);
+        CHECK(positionError < 1e-6f);
+        CHECK(textureError < 1e-6f);
+        CHECK(colorError <= 1.0f / 2048);
+
+        printf("%-36s %zu sprites, corner 0 exact %zu, position %.2g, uv %.2g, color %.2g %s\n",
+            name, count, exactCorners, positionError, textureError, colorError, failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestPackSprites()
+    {
+        const std::vector<SpriteInfo> sprites = MakeSprites(1001, 5);
+
+        std::vector<SpriteInfo const*> pointers;
+        for (const SpriteInfo& sprite : sprites)
+        {
+            pointers.push_back(&sprite);
+        }
+
+        const XMVECTORF32 textureSize = { { { 256.0f, 64.0f, 256.0f, 64.0f } } };
+        const XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+
+        std::vector<SpriteInstance> batched(sprites.size());
+        SpriteInstances::PackSprites(pointers.data(), pointers.size(), batched.data(), textureSize, inverseTextureSize);
+
+        const int failures = g_failures;
+
+        for (size_t i = 0; i < sprites.size(); i++)
+        {
+            const SpriteInstance single = Pack(sprites[i], textureSize, inverseTextureSize);
+
+            CHECK(memcmp(&single, &batched[i], sizeof(SpriteInstance)) == 0);
+        }
+
+        printf("%-36s %s\n", "PackSprites matches PackSprite", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestColorRange()
+    {
+        SpriteInfo sprite = {};
+        sprite.source = XMFLOAT4A(0, 0, 1, 1);
+        sprite.destination = XMFLOAT4A(0, 0, 1, 1);
+        sprite.color = XMFLOAT4A(4.5f, -1.0f, 0.25f, 1000.0f);
+
+        const XMVECTORF32 textureSize = { { { 1.0f, 1.0f, 1.0f, 1.0f } } };
+
+        const SpriteInstance instance = Pack(sprite, textureSize, textureSize);
+
+        const int failures = g_failures;
+
+        // HDR and negative colors pass through at half precision rather than being clamped
+        CHECK(XMConvertHalfToFloat(instance.color.x) == 4.5f);
+        CHECK(XMConvertHalfToFloat(instance.color.y) == -1.0f);
+        CHECK(XMConvertHalfToFloat(instance.color.z) == 0.25f);
+        CHECK(XMConvertHalfToFloat(instance.color.w) == 1000.0f);
+
+        printf("%-36s %s\n", "colors outside [0, 1]", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void CheckAllocation(SpriteInstanceRing::Allocation allocation, size_t offset, bool discard, bool resized)
+    {
+        CHECK(allocation.offset == offset);
+        CHECK(allocation.discard == discard);
+        CHECK(allocation.resized == resized);
+    }
+
+    void TestRing()
+    {
+        const int failures = g_failures;
+
+        SpriteInstanceRing ring;
+        CHECK(ring.GetCapacity() == 0);
+
+        // The first run creates the buffer
+        CheckAllocation(ring.Allocate(100), 0, true, true);
+        CHECK(ring.GetCapacity() == SpriteInstanceRing::InitialCapacity);
+
+        // Runs that fit are appended without a discard
+        CheckAllocation(ring.Allocate(1900), 100, false, false);
+
+        // One that does not fit starts again at the front
+        CheckAllocation(ring.Allocate(100), 0, true, false);
+
+        // One longer than the whole buffer grows it by doubling
+        CheckAllocation(ring.Allocate(5000), 0, true, true);
+        CHECK(ring.GetCapacity() == 4 * SpriteInstanceRing::InitialCapacity);
+
+        CheckAllocation(ring.Allocate(3000), 5000, false, false);
+        CheckAllocation(ring.Allocate(3000), 0, true, false);
+
+        // Exactly filling the rest of the buffer still appends
+        CheckAllocation(ring.Allocate(ring.GetCapacity() - 3000), 3000, false, false);
+        CheckAllocation(ring.Allocate(1), 0, true, false);
+
+        // Growth stops at MaxCapacity
+        CheckAllocation(ring.Allocate(SpriteInstanceRing::MaxCapacity - 1), 0, true, true);
+        CHECK(ring.GetCapacity() == SpriteInstanceRing::MaxCapacity);
+
+        CheckAllocation(ring.Allocate(SpriteInstanceRing::MaxCapacity), 0, true, false);
+
+        // Reset makes the next run discard even though there is room after the last one
+        ring.Reset();
+        CheckAllocation(ring.Allocate(10), 0, true, false);
+        CheckAllocation(ring.Allocate(10), 10, false, false);
+
+        printf("%-36s %s\n", "instance buffer ring", failures == g_failures ? "ok" : "FAILED");
+    }
+}
+
+int main()
+{
+    const XMVECTORF32 texture = { { { 512.0f, 256.0f, 512.0f, 256.0f } } };
+    const XMVECTORF32 oddTexture = { { { 37.0f, 19.0f, 37.0f, 19.0f } } };
+
+    TestMatchesVertices("512x256 texture", texture);
+    TestMatchesVertices("37x19 texture", oddTexture);
+    TestPackSprites();
+    TestColorRange();
+    TestRing();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,181 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteVerticesBenchmark.cpp
+//
+// Compares SpriteVertices::RenderSprites, which SpriteBatch uses to fill its vertex
+// buffer, with calling the scalar RenderSprite once per sprite. Runs from 16 to 65,536
+// sprites, unrotated and rotated, so the output goes from fitting in the cache to well
+// beyond it, and checks that both write the same bytes. Reports sprites per millisecond,
+// best of several alternating passes.
+//
+// Usage: spriteverticesbenchmark [milliseconds per pass]
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// SpriteVertices.h relies on the precompiled header for SAL
+#include <sal.h>
+
+#include "SpriteVertices.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    // Same layout as VertexPositionColorTexture
+    struct Vertex
+    {
+        XMFLOAT3 position;
+        XMFLOAT4 color;
+        XMFLOAT2 textureCoordinate;
+    };
+
+    // Same layout and flags as SpriteBatch::Impl::SpriteInfo
+    struct alignas(16) SpriteInfo
+    {
+        XMFLOAT4A source;
+        XMFLOAT4A destination;
+        XMFLOAT4A color;
+        XMFLOAT4A originRotationDepth;
+        const void* texture;
+        unsigned int flags;
+
+        static constexpr unsigned int SourceInTexels = 4;
+        static constexpr unsigned int DestSizeInPixels = 8;
+    };
+
+    constexpr size_t VerticesPerSprite = SpriteVertices::VerticesPerSprite;
+
+    // 16 byte aligned, as the mapped vertex buffer is
+    struct VertexBuffer
+    {
+        explicit VertexBuffer(size_t spriteCount) :
+            storage(new XMFLOAT4A[spriteCount * SpriteVertices::VectorsPerSprite]),
+            vertices(reinterpret_cast<Vertex*>(storage.get()))
+        {
+            memset(storage.get(), 0, spriteCount * VerticesPerSprite * sizeof(Vertex));
+        }
+
+        std::unique_ptr<XMFLOAT4A[]> storage;
+        Vertex* vertices;
+    };
+
+    // Text and UI sized sprites with a mix of flags, as SpriteBatch::Draw queues them
+    std::vector<SpriteInfo> MakeSprites(size_t count, bool rotated)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(0.0f, 1920.0f);
+        std::uniform_real_distribution<float> size(8.0f, 64.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+
+        std::vector<SpriteInfo> sprites(count);
+        for (auto& sprite : sprites)
+        {
+            sprite = {};
+            sprite.source = XMFLOAT4A(size(random), size(random), size(random), size(random));
+            sprite.destination = XMFLOAT4A(position(random), position(random), 1.0f, 1.0f);
+            sprite.color = XMFLOAT4A(unit(random), unit(random), unit(random), 1.0f);
+            sprite.originRotationDepth = XMFLOAT4A(unit(random) * 8.0f, unit(random) * 8.0f, rotated ? angle(random) : 0.0f, unit(random));
+            sprite.flags = SpriteInfo::SourceInTexels | (random() & 3u);
+        }
+        return sprites;
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Best sprites per millisecond of each over passes of about the given length. The passes
+    // alternate, so clock changes and other load hit both the same.
+    template<typename TScalar, typename TBatched>
+    void SpritesPerMillisecond(size_t count, double milliseconds, TScalar&& scalar, TBatched&& batched, double& scalarRate, double& batchedRate)
+    {
+        // Size the passes from one timed run
+        auto start = std::chrono::steady_clock::now();
+        scalar();
+        const int repeats = static_cast<int>(std::max(1.0, milliseconds / std::max(MillisecondsSince(start), 1e-6)));
+
+        scalarRate = 0.0;
+        batchedRate = 0.0;
+        for (int pass = 0; pass < 7; pass++)
+        {
+            start = std::chrono::steady_clock::now();
+            for (int repeat = 0; repeat < repeats; repeat++)
+            {
+                scalar();
+            }
+            scalarRate = std::max(scalarRate, double(count) * repeats / std::max(MillisecondsSince(start), 1e-6));
+
+            start = std::chrono::steady_clock::now();
+            for (int repeat = 0; repeat < repeats; repeat++)
+            {
+                batched();
+            }
+            batchedRate = std::max(batchedRate, double(count) * repeats / std::max(MillisecondsSince(start), 1e-6));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const double milliseconds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+    const XMVECTORF32 textureSize = { { { 512.0f, 256.0f, 512.0f, 256.0f } } };
+    const XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+
+    printf("%8s  %-9s %10s %10s %8s\n", "sprites", "rotation", "scalar", "batched", "speedup");
+
+    bool failed = false;
+    for (size_t count : { size_t(16), size_t(64), size_t(256), size_t(2048), size_t(65536) })
+    {
+        for (bool rotated : { false, true })
+        {
+            const std::vector<SpriteInfo> sprites = MakeSprites(count, rotated);
+
+            std::vector<SpriteInfo const*> pointers(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                pointers[i] = &sprites[i];
+            }
+
+            VertexBuffer scalar(count);
+            VertexBuffer batched(count);
+
+            double scalarRate, batchedRate;
+            SpritesPerMillisecond(count, milliseconds,
+                [&]()
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        SpriteVertices::RenderSprite(pointers[i], scalar.vertices + i * VerticesPerSprite, textureSize, inverseTextureSize);
+                    }
+                },
+                [&]()
+                {
+                    SpriteVertices::RenderSprites(pointers.data(), count, batched.vertices, textureSize, inverseTextureSize);
+                },
+                scalarRate, batchedRate);
+
+            const bool ok = memcmp(scalar.vertices, batched.vertices, count * VerticesPerSprite * sizeof(Vertex)) == 0;
+            failed |= !ok;
+
+            printf("%8zu  %-9s %7.0f/ms %7.0f/ms %7.2fx%s\n", count, rotated ? "rotated" : "none",
+                scalarRate, batchedRate, batchedRate / scalarRate, ok ? "" : "  DIFFERENT VERTICES");
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,277 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteVerticesTests.cpp
+//
+// Checks that the vertex generation SpriteBatch uses produces exactly the same bytes as
+// the scalar SpriteBatch::Impl::RenderSprite it replaced, which is copied here unchanged
+// as the reference. Sprites cover every flag combination, zero sized sources, and zero,
+// negative zero, tiny and infinite rotations; output goes to aligned and unaligned
+// buffers and to runs that do not fill a group of four. Needs no Direct3D device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// SpriteVertices.h relies on the precompiled header for SAL
+#include <sal.h>
+
+#include "SpriteVertices.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    // Same layout as VertexPositionColorTexture
+    struct Vertex
+    {
+        XMFLOAT3 position;
+        XMFLOAT4 color;
+        XMFLOAT2 textureCoordinate;
+    };
+
+    // Same layout and flags as SpriteBatch::Impl::SpriteInfo
+    struct alignas(16) SpriteInfo
+    {
+        XMFLOAT4A source;
+        XMFLOAT4A destination;
+        XMFLOAT4A color;
+        XMFLOAT4A originRotationDepth;
+        const void* texture;
+        unsigned int flags;
+
+        static constexpr unsigned int SourceInTexels = 4;
+        static constexpr unsigned int DestSizeInPixels = 8;
+    };
+
+    constexpr size_t VerticesPerSprite = SpriteVertices::VerticesPerSprite;
+    constexpr size_t SpriteBytes = VerticesPerSprite * sizeof(Vertex);
+
+    // SpriteBatch::Impl::RenderSprite before vertex generation moved to SpriteVertices.h
+    void XM_CALLCONV ReferenceRenderSprite(SpriteInfo const* sprite,
+        Vertex* vertices,
+        FXMVECTOR textureSize,
+        FXMVECTOR inverseTextureSize)
+    {
+        // Load sprite parameters into SIMD registers.
+        XMVECTOR source = XMLoadFloat4A(&sprite->source);
+        XMVECTOR destination = XMLoadFloat4A(&sprite->destination);
+        XMVECTOR color = XMLoadFloat4A(&sprite->color);
+        XMVECTOR originRotationDepth = XMLoadFloat4A(&sprite->originRotationDepth);
+
+        float rotation = sprite->originRotationDepth.z;
+        unsigned int flags = sprite->flags;
+
+        // Extract the source and destination sizes into separate vectors.
+        XMVECTOR sourceSize = XMVectorSwizzle<2, 3, 2, 3>(source);
+        XMVECTOR destinationSize = XMVectorSwizzle<2, 3, 2, 3>(destination);
+
+        // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
+        XMVECTOR isZeroMask = XMVectorEqual(sourceSize, XMVectorZero());
+        XMVECTOR nonZeroSourceSize = XMVectorSelect(sourceSize, g_XMEpsilon, isZeroMask);
+
+        XMVECTOR origin = XMVectorDivide(originRotationDepth, nonZeroSourceSize);
+
+        // Convert the source region from texels to mod-1 texture coordinate format.
+        if (flags & SpriteInfo::SourceInTexels)
+        {
+            source = XMVectorMultiply(source, inverseTextureSize);
+            sourceSize = XMVectorMultiply(sourceSize, inverseTextureSize);
+        }
+        else
+        {
+            origin = XMVectorMultiply(origin, inverseTextureSize);
+        }
+
+        // If the destination size is relative to the source region, convert it to pixels.
+        if (!(flags & SpriteInfo::DestSizeInPixels))
+        {
+            destinationSize = XMVectorMultiply(destinationSize, textureSize);
+        }
+
+        // Compute a 2x2 rotation matrix.
+        XMVECTOR rotationMatrix1;
+        XMVECTOR rotationMatrix2;
+
+        if (rotation != 0)
+        {
+            float sin, cos;
+
+            XMScalarSinCos(&sin, &cos, rotation);
+
+            XMVECTOR sinV = XMLoadFloat(&sin);
+            XMVECTOR cosV = XMLoadFloat(&cos);
+
+            rotationMatrix1 = XMVectorMergeXY(cosV, sinV);
+            rotationMatrix2 = XMVectorMergeXY(XMVectorNegate(sinV), cosV);
+        }
+        else
+        {
+            rotationMatrix1 = g_XMIdentityR0;
+            rotationMatrix2 = g_XMIdentityR1;
+        }
+
+        // The four corner vertices are computed by transforming these unit-square positions.
+        static XMVECTORF32 cornerOffsets[VerticesPerSprite] =
+        {
+            { { { 0, 0, 0, 0 } } },
+            { { { 1, 0, 0, 0 } } },
+            { { { 0, 1, 0, 0 } } },
+            { { { 1, 1, 0, 0 } } },
+        };
+
+        const unsigned int mirrorBits = flags & 3u;
+
+        // Generate the four output vertices.
+        for (size_t i = 0; i < VerticesPerSprite; i++)
+        {
+            // Calculate position.
+            XMVECTOR cornerOffset = XMVectorMultiply(XMVectorSubtract(cornerOffsets[i], origin), destinationSize);
+
+            // Apply 2x2 rotation matrix.
+            XMVECTOR position1 = XMVectorMultiplyAdd(XMVectorSplatX(cornerOffset), rotationMatrix1, destination);
+            XMVECTOR position2 = XMVectorMultiplyAdd(XMVectorSplatY(cornerOffset), rotationMatrix2, position1);
+
+            // Set z = depth.
+            XMVECTOR position = XMVectorPermute<0, 1, 7, 6>(position2, originRotationDepth);
+
+            // Write position as a Float4, even though VertexPositionColor::position is an XMFLOAT3.
+            // This is faster, and harmless as we are just clobbering the first element of the
+            // following color field, which will immediately be overwritten with its correct value.
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertices[i].position), position);
+
+            // Write the color.
+            XMStoreFloat4(&vertices[i].color, color);
+
+            // Compute and write the texture coordinate.
+            XMVECTOR textureCoordinate = XMVectorMultiplyAdd(cornerOffsets[static_cast<unsigned int>(i) ^ mirrorBits], sourceSize, source);
+
+            XMStoreFloat2(&vertices[i].textureCoordinate, textureCoordinate);
+        }
+    }
+
+    std::vector<SpriteInfo> MakeSprites(size_t count, bool rotate, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> value(-500.0f, 500.0f);
+        std::uniform_int_distribution<unsigned int> flags(0, 15);
+
+        const float rotations[] = { 0.0f, -0.0f, 1e-30f, -1.0f, INFINITY };
+
+        std::vector<SpriteInfo> sprites(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            SpriteInfo& sprite = sprites[i];
+            sprite = {};
+
+            // Zero sized sources take the epsilon path for the origin
+            sprite.source = XMFLOAT4A(value(random), value(random), (i % 13) ? value(random) : 0.0f, (i % 17) ? value(random) : 0.0f);
+            sprite.destination = XMFLOAT4A(value(random), value(random), value(random) / 100, value(random) / 100);
+            sprite.color = XMFLOAT4A(value(random), value(random), value(random), value(random));
+
+            float rotation = 0.0f;
+            if (rotate)
+            {
+                rotation = (i % 3) ? value(random) / 10 : rotations[(i / 3) % std::size(rotations)];
+            }
+            sprite.originRotationDepth = XMFLOAT4A(value(random), value(random), rotation, value(random));
+            sprite.flags = flags(random);
+        }
+        return sprites;
+    }
+
+    size_t FirstDifference(const uint8_t* expected, const uint8_t* actual, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; i++)
+        {
+            if (expected[i] != actual[i])
+                return i;
+        }
+        return bytes;
+    }
+
+    // Buffers are 64 byte aligned plus offset, and filled with a pattern so untouched bytes show
+    std::unique_ptr<uint8_t[]> MakeBuffer(size_t bytes, size_t offset, uint8_t*& data)
+    {
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[bytes + 64 + offset]);
+        data = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(buffer.get()) + 63) & ~uintptr_t(63)) + offset;
+        memset(data, 0xcd, bytes);
+        return buffer;
+    }
+
+    bool Test(const char* name, size_t count, bool rotate, size_t offset, FXMVECTOR textureSize)
+    {
+        const std::vector<SpriteInfo> sprites = MakeSprites(count, rotate, static_cast<uint32_t>(count));
+
+        std::vector<SpriteInfo const*> pointers(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            pointers[i] = &sprites[i];
+        }
+
+        const XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+        const size_t bytes = count * SpriteBytes;
+
+        uint8_t* expected;
+        uint8_t* single;
+        uint8_t* batched;
+        auto expectedBuffer = MakeBuffer(bytes, 0, expected);
+        auto singleBuffer = MakeBuffer(bytes, offset, single);
+        auto batchedBuffer = MakeBuffer(bytes, offset, batched);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            ReferenceRenderSprite(pointers[i], reinterpret_cast<Vertex*>(expected + i * SpriteBytes), textureSize, inverseTextureSize);
+            SpriteVertices::RenderSprite(pointers[i], reinterpret_cast<Vertex*>(single + i * SpriteBytes), textureSize, inverseTextureSize);
+        }
+
+        SpriteVertices::RenderSprites(pointers.data(), count, reinterpret_cast<Vertex*>(batched), textureSize, inverseTextureSize);
+
+        const size_t singleDifference = FirstDifference(expected, single, bytes);
+        const size_t batchedDifference = FirstDifference(expected, batched, bytes);
+        const bool ok = singleDifference == bytes && batchedDifference == bytes;
+
+        printf("%-36s %6zu sprites %s\n", name, count, ok ? "ok" : "FAILED");
+
+        if (singleDifference != bytes)
+            printf("  RenderSprite differs at sprite %zu byte %zu\n", singleDifference / SpriteBytes, singleDifference % SpriteBytes);
+
+        if (batchedDifference != bytes)
+            printf("  RenderSprites differs at sprite %zu byte %zu\n", batchedDifference / SpriteBytes, batchedDifference % SpriteBytes);
+
+        return ok;
+    }
+}
+
+int main()
+{
+    const XMVECTORF32 texture = { { { 512.0f, 256.0f, 512.0f, 256.0f } } };
+    const XMVECTORF32 oddTexture = { { { 37.0f, 19.0f, 37.0f, 19.0f } } };
+
+    bool ok = true;
+    ok &= Test("aligned, unrotated", 2048, false, 0, texture);
+    ok &= Test("aligned, rotated", 2048, true, 0, texture);
+    ok &= Test("aligned, rotated, 37x19 texture", 2048, true, 0, oddTexture);
+    ok &= Test("aligned, 4n + 3 sprites", 2047, true, 0, texture);
+    ok &= Test("aligned, fewer than 4 sprites", 3, true, 0, texture);
+    ok &= Test("4 byte offset", 2048, true, 4, texture);
+    ok &= Test("16 byte offset", 2045, true, 16, texture);
+
+    if (!ok)
+    {
+        printf("Vertices differ from the scalar SpriteBatch path\n");
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,496 @@
+//--------------------------------------------------------------------------------------
+// File: TextLayoutTests.cpp
+//
+// Checks SpriteFont's layout cache: least recently used strings are evicted first, UTF-8
+// and UTF-16 strings are cached apart even when their bytes match, changing the line
+// spacing or default glyph drops the cached layouts, and a string drawn from its cached
+// layout with SpriteBatch::DrawGlyphRun queues the same sprites as drawing it one glyph at
+// a time. Needs no Direct3D device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+// TextLayout.h and SpriteVertices.h rely on the precompiled header for SAL
+#include <sal.h>
+
+#include "SpriteVertices.h"
+#include "TextLayout.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    int g_failures = 0;
+
+    #define CHECK(x) \
+        do { if (!(x)) { printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #x); ++g_failures; } } while (false)
+
+    constexpr float c_lineSpacing = 14;
+
+    // Same layout as SpriteFont::Glyph
+    struct Glyph
+    {
+        uint32_t Character;
+        struct
+        {
+            int32_t left;
+            int32_t top;
+            int32_t right;
+            int32_t bottom;
+        } Subrect;
+        float XOffset;
+        float YOffset;
+        float XAdvance;
+    };
+
+    // Same layout and flags as SpriteBatch::Impl::SpriteInfo
+    struct alignas(16) SpriteInfo
+    {
+        XMFLOAT4A source;
+        XMFLOAT4A destination;
+        XMFLOAT4A color;
+        XMFLOAT4A originRotationDepth;
+        const void* texture;
+        unsigned int flags;
+
+        static constexpr unsigned int SourceInTexels = 4;
+        static constexpr unsigned int DestSizeInPixels = 8;
+    };
+
+    // Letters of varied widths laid out on a 256 pixel sheet, lower case ones sitting lower
+    // and 'j' hanging back into the previous letter. Space is the usual one texel glyph.
+    class Font
+    {
+    public:
+        Font()
+        {
+            Add(' ', 1, 1, 0, 0, 3);
+            Add('?', 7, 12, 0, 0, 1);
+
+            for (uint32_t c = 'A'; c <= 'Z'; c++)
+            {
+                Add(c, 6 + (c % 4), 12, 0, 0, 1);
+            }
+
+            for (uint32_t c = 'a'; c <= 'z'; c++)
+            {
+                Add(c, 5 + (c % 3), 9, (c == 'j') ? -2.0f : 0.0f, 3, 1);
+            }
+
+            Add(0xE9, 6, 11, 0, 1, 1);      // e with acute
+            Add(0x4241, 11, 12, 0, 0, 1);   // A CJK ideograph
+        }
+
+        // Finds a glyph as SpriteFont::Impl::FindGlyph does.
+        Glyph const* Find(uint32_t character) const
+        {
+            auto it = mGlyphs.find(character);
+
+            if (it != mGlyphs.end())
+                return &it->second;
+
+            if (layout.GetDefaultGlyph())
+                return layout.GetDefaultGlyph();
+
+            throw std::runtime_error("Character not in font");
+        }
+
+        template<typename TChar>
+        TextLayout<Glyph>::Layout const* FindLayout(TChar const* text)
+        {
+            return layout.Find(text, [this](uint32_t character) { return Find(character); });
+        }
+
+        TextLayout<Glyph> layout;
+
+    private:
+        void Add(uint32_t character, int32_t width, int32_t height, float xOffset, float yOffset, float xAdvance)
+        {
+            Glyph glyph = {};
+            glyph.Character = character;
+            glyph.Subrect.left = mX;
+            glyph.Subrect.top = mY;
+            glyph.Subrect.right = mX + width;
+            glyph.Subrect.bottom = mY + height;
+            glyph.XOffset = xOffset;
+            glyph.YOffset = yOffset;
+            glyph.XAdvance = xAdvance;
+
+            mGlyphs[character] = glyph;
+
+            mX += width + 1;
+
+            if (mX > 240)
+            {
+                mX = 0;
+                mY += 16;
+            }
+        }
+
+        std::map<uint32_t, Glyph> mGlyphs;
+        int32_t mX = 0;
+        int32_t mY = 0;
+    };
+
+    bool SameGlyphs(TextLayout<Glyph>::Layout const* a, TextLayout<Glyph>::Layout const* b)
+    {
+        if (!a || !b || a->glyphs.size() != b->glyphs.size())
+            return false;
+
+        for (size_t i = 0; i < a->glyphs.size(); i++)
+        {
+            auto& x = a->glyphs[i];
+            auto& y = b->glyphs[i];
+
+            if (x.glyph != y.glyph || x.x != y.x || x.y != y.y || x.advance != y.advance || x.skippable != y.skippable)
+                return false;
+        }
+
+        return a->sources.size() == b->sources.size()
+            && memcmp(a->sources.data(), b->sources.data(), a->sources.size() * sizeof(XMFLOAT4)) == 0
+            && memcmp(a->offsets.data(), b->offsets.data(), a->offsets.size() * sizeof(XMFLOAT2)) == 0;
+    }
+
+    void TestEvictionOrder()
+    {
+        const int failures = g_failures;
+
+        Font font;
+        font.layout.SetLineSpacing(c_lineSpacing);
+
+        auto& statistics = font.layout.GetStatistics();
+
+        // Off until given a capacity
+        CHECK(font.FindLayout("one") == nullptr);
+        CHECK(statistics.misses == 0);
+
+        font.layout.SetCapacity(3);
+
+        auto one = font.FindLayout("one");
+        font.FindLayout("two");
+        font.FindLayout("three");
+
+        CHECK(statistics.misses == 3);
+        CHECK(statistics.strings == 3);
+        CHECK(statistics.glyphs == 11);
+        CHECK(statistics.glyphsLaidOut == 11);
+
+        // A hit returns the same layout and makes it the most recently used, leaving two the oldest
+        CHECK(font.FindLayout("one") == one);
+        CHECK(statistics.hits == 1);
+        CHECK(statistics.glyphsReused == 3);
+
+        font.FindLayout("four");
+        CHECK(statistics.evictions == 1);
+        CHECK(statistics.strings == 3);
+        CHECK(statistics.glyphs == 12);
+
+        // So four evicted two, and kept one and three
+        font.FindLayout("three");
+        font.FindLayout("one");
+        CHECK(statistics.hits == 3);
+        CHECK(statistics.misses == 4);
+
+        // Now one, three, four, so adding two evicts four
+        font.FindLayout("two");
+        CHECK(statistics.misses == 5);
+        CHECK(statistics.evictions == 2);
+
+        // Then two, one, three, and using three and one before adding four evicts two again
+        font.FindLayout("three");
+        font.FindLayout("one");
+        CHECK(statistics.hits == 5);
+        CHECK(statistics.misses == 5);
+
+        font.FindLayout("four");
+        CHECK(statistics.misses == 6);
+        CHECK(statistics.evictions == 3);
+
+        // Now four, one, three: shrinking keeps the most recently used
+        font.layout.SetCapacity(1);
+        CHECK(statistics.strings == 1);
+        CHECK(statistics.glyphs == 4);
+        CHECK(statistics.evictions == 5);
+
+        font.FindLayout("four");
+        CHECK(statistics.hits == 6);
+
+        // Turning the cache off empties it
+        font.layout.SetCapacity(0);
+        CHECK(statistics.strings == 0);
+        CHECK(statistics.glyphs == 0);
+        CHECK(font.FindLayout("four") == nullptr);
+        CHECK(statistics.hits == 6);
+        CHECK(statistics.misses == 6);
+
+        // Resetting the counters leaves the cached strings
+        font.layout.SetCapacity(2);
+        font.FindLayout("one");
+        font.layout.ResetStatistics();
+        CHECK(statistics.strings == 1);
+        CHECK(statistics.hits == 0 && statistics.misses == 0 && statistics.evictions == 0);
+        CHECK(statistics.glyphsReused == 0 && statistics.glyphsLaidOut == 0 && statistics.layoutMilliseconds == 0);
+        font.FindLayout("one");
+        CHECK(statistics.hits == 1);
+
+        // A string with a character the font lacks throws, and leaves the cache as it was
+        bool threw = false;
+        try
+        {
+            font.FindLayout("a\x01");
+        }
+        catch (std::runtime_error const&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(statistics.strings == 1);
+        CHECK(statistics.evictions == 0);
+
+        printf("%-28s %s\n", "Eviction order", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestEncodings()
+    {
+        const int failures = g_failures;
+
+        Font font;
+        font.layout.SetLineSpacing(c_lineSpacing);
+        font.layout.SetCapacity(16);
+
+        auto& statistics = font.layout.GetStatistics();
+
+        // The same text in each encoding is cached twice, with the same glyphs
+        auto narrow = font.FindLayout("Caf\xC3\xA9 jam\r\nja va");
+        auto wide = font.FindLayout(L"Caf\x00E9 jam\r\nja va");
+
+        CHECK(statistics.misses == 2);
+        CHECK(statistics.strings == 2);
+        CHECK(narrow->encoding != wide->encoding);
+        CHECK(SameGlyphs(narrow, wide));
+        CHECK(font.FindLayout("Caf\xC3\xA9 jam\r\nja va") == narrow);
+        CHECK(font.FindLayout(L"Caf\x00E9 jam\r\nja va") == wide);
+        CHECK(statistics.hits == 2);
+
+        // Both match laying the string out as it goes, the first 'j' of a line clamped to the margin
+        std::vector<TextLayout<Glyph>::Glyph> expected;
+        font.layout.LayoutGlyphs(L"Caf\x00E9 jam\r\nja va", [&](uint32_t character) { return font.Find(character); },
+            [&](Glyph const* glyph, float x, float y, float advance, bool skippable)
+            {
+                expected.push_back(TextLayout<Glyph>::Glyph{ glyph, x, y, advance, skippable });
+            });
+
+        CHECK(narrow->glyphs.size() == 13);
+        CHECK(expected.size() == narrow->glyphs.size());
+        for (size_t i = 0; i < expected.size() && i < narrow->glyphs.size(); i++)
+        {
+            CHECK(narrow->glyphs[i].glyph == expected[i].glyph);
+            CHECK(narrow->glyphs[i].x == expected[i].x);
+            CHECK(narrow->glyphs[i].y == expected[i].y);
+            CHECK(narrow->glyphs[i].skippable == expected[i].skippable);
+        }
+        CHECK(narrow->glyphs[3].glyph->Character == 0xE9);
+        CHECK(narrow->glyphs[4].skippable);
+        CHECK(narrow->glyphs[8].glyph->Character == 'j');
+        CHECK(narrow->glyphs[8].x == 0 && narrow->glyphs[8].y == c_lineSpacing);
+        CHECK(narrow->sources.size() == 11);
+
+        // With two byte wchar_t, U+4241 has the same bytes as "AB", which must not share a layout
+        if (sizeof(wchar_t) == 2)
+        {
+            auto ab = font.FindLayout("AB");
+            auto ideograph = font.FindLayout(L"\x4241");
+
+            CHECK(ab != ideograph);
+            CHECK(ab->glyphs.size() == 2);
+            CHECK(ideograph->glyphs.size() == 1 && ideograph->glyphs[0].glyph->Character == 0x4241);
+            CHECK(statistics.strings == 4);
+        }
+
+        printf("%-28s %s\n", "UTF-8 and UTF-16 keys", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    void TestInvalidation()
+    {
+        const int failures = g_failures;
+
+        Font font;
+        font.layout.SetLineSpacing(c_lineSpacing);
+        font.layout.SetCapacity(16);
+
+        auto& statistics = font.layout.GetStatistics();
+
+        auto layout = font.FindLayout("ab\ncd");
+        CHECK(layout->glyphs[2].y == c_lineSpacing);
+
+        // Setting the spacing it already has keeps the cache
+        font.layout.SetLineSpacing(c_lineSpacing);
+        CHECK(statistics.strings == 1);
+        CHECK(font.FindLayout("ab\ncd") == layout);
+        CHECK(statistics.hits == 1);
+
+        // A new spacing drops it, and the string is laid out again
+        font.layout.SetLineSpacing(20);
+        CHECK(statistics.strings == 0);
+        CHECK(statistics.glyphs == 0);
+
+        layout = font.FindLayout("ab\ncd");
+        CHECK(statistics.misses == 2);
+        CHECK(layout->glyphs[2].y == 20);
+
+        // So does a new default glyph, after which missing characters use it
+        font.FindLayout(L"ab");
+        CHECK(statistics.strings == 2);
+
+        Glyph const* question = font.Find('?');
+        font.layout.SetDefaultGlyph(question);
+        CHECK(statistics.strings == 0);
+
+        layout = font.FindLayout("a\x01");
+        CHECK(layout->glyphs.size() == 2 && layout->glyphs[1].glyph == question);
+
+        font.layout.SetDefaultGlyph(question);
+        CHECK(statistics.strings == 1);
+
+        font.layout.SetDefaultGlyph(font.Find('A'));
+        CHECK(statistics.strings == 0);
+
+        layout = font.FindLayout("a\x01");
+        CHECK(layout->glyphs[1].glyph->Character == 'A');
+
+        font.layout.SetDefaultGlyph(nullptr);
+        CHECK(statistics.strings == 0);
+        CHECK(statistics.evictions == 0);
+
+        printf("%-28s %s\n", "Line spacing, default glyph", failures == g_failures ? "ok" : "FAILED");
+    }
+
+    // SpriteBatch::Draw, as SpriteFont::Impl::DrawString calls it for each glyph.
+    void XM_CALLCONV Draw(std::vector<SpriteInfo>& sprites, FXMVECTOR position, Glyph const& glyph, FXMVECTOR color, float rotation, GXMVECTOR origin, HXMVECTOR scale, unsigned int effects, float layerDepth)
+    {
+        XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(position, scale);
+        XMVECTOR rotationDepth = XMVectorMergeXY(XMVectorReplicate(rotation), XMVectorReplicate(layerDepth));
+        XMVECTOR originRotationDepth = XMVectorPermute<0, 1, 4, 5>(origin, rotationDepth);
+
+        // LoadRect
+        XMVECTOR source = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&glyph.Subrect)), 0);
+        source = XMVectorSubtract(source, XMVectorPermute<0, 1, 4, 5>(g_XMZero, source));
+
+        sprites.emplace_back();
+        SpriteVertices::SetSprite(&sprites.back(), destination, source, color, originRotationDepth, effects);
+    }
+
+    // SpriteBatch::DrawGlyphRun and its Impl, as SpriteFont::Impl::DrawString calls it for a cached layout.
+    void XM_CALLCONV DrawGlyphRun(std::vector<SpriteInfo>& sprites, TextLayout<Glyph>::Layout const& layout, FXMVECTOR position, FXMVECTOR color, float rotation, GXMVECTOR origin, HXMVECTOR scale, unsigned int effects, float layerDepth)
+    {
+        XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(position, scale);
+        XMVECTOR rotationDepth = XMVectorMergeXY(XMVectorReplicate(rotation), XMVectorReplicate(layerDepth));
+        XMVECTOR originRotationDepth = XMVectorPermute<0, 1, 4, 5>(origin, rotationDepth);
+
+        for (size_t i = 0; i < layout.sources.size(); i++)
+        {
+            XMVECTOR source = XMLoadFloat4(&layout.sources[i]);
+
+            XMVECTOR glyphOrigin = SpriteVertices::GlyphOrigin(source, XMLoadFloat2(&layout.offsets[i]), originRotationDepth, effects);
+
+            sprites.emplace_back();
+            SpriteVertices::SetSprite(&sprites.back(), destination, source, color, XMVectorPermute<0, 1, 6, 7>(glyphOrigin, originRotationDepth), effects);
+        }
+    }
+
+    void TestGlyphRun()
+    {
+        const int failures = g_failures;
+
+        Font font;
+        font.layout.SetLineSpacing(c_lineSpacing);
+        font.layout.SetCapacity(4);
+
+        const char text[] = "Jumpy  jackal\r\nquiz \xC3\xA9tude";
+
+        auto layout = font.FindLayout(text);
+        CHECK(layout != nullptr);
+
+        const XMVECTORF32 color = { { { 1.0f, 0.5f, 0.25f, 0.75f } } };
+
+        size_t compared = 0;
+
+        for (unsigned int effects = 0; effects < 4; effects++)
+        {
+            for (float rotation : { 0.0f, 0.7f })
+            {
+                const XMVECTOR position = XMVectorSet(100.5f, 37.0f, 0, 0);
+                const XMVECTOR scale = XMVectorSet(1.5f, 0.75f, 0, 0);
+
+                // DrawString mirrors from the measured size, which both paths share
+                const XMVECTOR baseOffset = XMVectorSet(effects & 1 ? -90.0f : 3.0f, effects & 2 ? -30.0f : 2.0f, 0, 0);
+
+                std::vector<SpriteInfo> perGlyph;
+
+                font.layout.LayoutGlyphs(text, [&](uint32_t character) { return font.Find(character); },
+                    [&](Glyph const* glyph, float x, float y, float, bool skippable)
+                    {
+                        if (skippable)
+                            return;
+
+                        XMVECTOR glyphRect = g_XMZero;
+
+                        if (effects)
+                        {
+                            glyphRect = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&glyph->Subrect)), 0);
+                            glyphRect = XMVectorSubtract(glyphRect, XMVectorPermute<0, 1, 4, 5>(g_XMZero, glyphRect));
+                        }
+
+                        XMVECTOR offset = SpriteVertices::GlyphOrigin(glyphRect, XMVectorSet(x, y + glyph->YOffset, 0, 0), baseOffset, effects);
+
+                        Draw(perGlyph, position, *glyph, color, rotation, offset, scale, effects, 0.25f);
+                    });
+
+                std::vector<SpriteInfo> run;
+
+                DrawGlyphRun(run, *layout, position, color, rotation, baseOffset, scale, effects, 0.25f);
+
+                CHECK(perGlyph.size() == 20);
+                CHECK(run.size() == perGlyph.size());
+
+                for (size_t i = 0; i < run.size() && i < perGlyph.size(); i++)
+                {
+                    CHECK(memcmp(&run[i].source, &perGlyph[i].source, sizeof(XMFLOAT4A)) == 0);
+                    CHECK(memcmp(&run[i].destination, &perGlyph[i].destination, sizeof(XMFLOAT4A)) == 0);
+                    CHECK(memcmp(&run[i].color, &perGlyph[i].color, sizeof(XMFLOAT4A)) == 0);
+                    CHECK(memcmp(&run[i].originRotationDepth, &perGlyph[i].originRotationDepth, sizeof(XMFLOAT4A)) == 0);
+                    CHECK(run[i].flags == perGlyph[i].flags);
+                    compared++;
+                }
+            }
+        }
+
+        printf("%-28s %s (%zu sprites)\n", "Glyph run", failures == g_failures ? "ok" : "FAILED", compared);
+    }
+}
+
+int main()
+{
+    TestEvictionOrder();
+    TestEncodings();
+    TestInvalidation();
+    TestGlyphRun();
+
+    if (g_failures)
+    {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,480 @@
+#include "AssetCooker.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+const char* AssetCooker::MANIFEST_NAME = "cook.manifest";
+
+namespace
+{
+	const char* MANIFEST_HEADER = "AssetCookerManifest 1";
+
+	std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		const size_t length = std::strlen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+
+	std::string Key(const fs::path& path)
+	{
+		return PathToUtf8(path);
+	}
+
+	std::vector<std::string> SplitTabs(const std::string& line)
+	{
+		std::vector<std::string> fields;
+		size_t start = 0;
+		while (true)
+		{
+			const size_t tab = line.find('\t', start);
+			fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+			if (tab == std::string::npos)
+				break;
+			start = tab + 1;
+		}
+		return fields;
+	}
+
+	void ForEach(JobSystem& jobSystem, size_t count, const std::function<void(size_t index)>& job)
+	{
+		jobSystem.ParallelFor(static_cast<uint32_t>(count), 1, [&job](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				job(i);
+			}
+		});
+	}
+}
+
+const AssetCooker::Rule* AssetCooker::FindRule(const fs::path& source, std::string& settings)
+{
+	static const Rule textureRule = { ".png", ".dds", CookTexture, 2 };
+	static const Rule shaderRule = { ".hlsl", ".cso", CookShader, 1 };
+	static const Rule meshRule = { ".obj", ".vbo", CookMesh, 1 };
+	static const Rule copyRule = { "", nullptr, CookCopy, 1 };
+
+	const std::string extension = ToLower(PathToUtf8(source.extension()));
+	const std::string stem = ToLower(PathToUtf8(source.stem()));
+
+	if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp"
+		|| extension == ".tif" || extension == ".tiff" || extension == ".gif")
+	{
+		settings = (EndsWith(stem, "_normal") || EndsWith(stem, "_n")) ? "normal" : "auto";
+		return &textureRule;
+	}
+
+	if (extension == ".hlsl")
+	{
+		//The stage comes from the file name, anything else is treated as an include and only cooked through its users
+		if (EndsWith(stem, "_vs") || stem.find("vertexshader") != std::string::npos)
+			settings = "vs_5_0";
+		else if (EndsWith(stem, "_ps") || stem.find("pixelshader") != std::string::npos)
+			settings = "ps_5_0";
+		else if (EndsWith(stem, "_cs") || stem.find("computeshader") != std::string::npos)
+			settings = "cs_5_0";
+		else if (EndsWith(stem, "_gs") || stem.find("geometryshader") != std::string::npos)
+			settings = "gs_5_0";
+		else
+			return nullptr;
+		return &shaderRule;
+	}
+
+	if (extension == ".obj")
+	{
+		settings.clear();
+		return &meshRule;
+	}
+
+	//Already in a runtime format
+	if (extension == ".spritefont" || extension == ".dds" || extension == ".cmo" || extension == ".sdkmesh"
+		|| extension == ".vbo" || extension == ".wav" || extension == ".xwb")
+	{
+		settings.clear();
+		return &copyRule;
+	}
+
+	return nullptr;
+}
+
+void AssetCooker::LoadManifest()
+{
+	this->fileStates.clear();
+	this->manifestOutputs.clear();
+
+	std::ifstream file(this->settings.outputRoot / MANIFEST_NAME);
+	std::string line;
+	if (!file || !std::getline(file, line) || line != MANIFEST_HEADER)
+		return;
+
+	while (std::getline(file, line))
+	{
+		const std::vector<std::string> fields = SplitTabs(line);
+		if (fields[0] == "F" && fields.size() == 5)
+		{
+			FileState state;
+			state.size = std::strtoull(fields[1].c_str(), nullptr, 10);
+			state.writeTime = std::strtoll(fields[2].c_str(), nullptr, 10);
+			state.hash = std::strtoull(fields[3].c_str(), nullptr, 16);
+			state.exists = true;
+			this->fileStates[fields[4]] = state;
+		}
+		else if (fields[0] == "O" && fields.size() >= 4)
+		{
+			ManifestOutput& output = this->manifestOutputs[fields[3]];
+			output.key = std::strtoull(fields[1].c_str(), nullptr, 16);
+			output.size = std::strtoull(fields[2].c_str(), nullptr, 10);
+			for (size_t i = 4; i < fields.size(); i++)
+			{
+				output.dependencies.push_back(fs::u8path(fields[i]));
+			}
+		}
+	}
+}
+
+bool AssetCooker::SaveManifest() const
+{
+	std::ostringstream text;
+	text << MANIFEST_HEADER << '\n';
+
+	//Only files seen this run are kept, so deleted sources drop out of the cache
+	char number[32];
+	for (const auto& entry : this->fileStates)
+	{
+		const FileState& state = entry.second;
+		if (!state.checked || !state.exists)
+			continue;
+		std::snprintf(number, sizeof(number), "%016" PRIx64, state.hash);
+		text << "F\t" << state.size << '\t' << state.writeTime << '\t' << number << '\t' << entry.first << '\n';
+	}
+
+	//Failed items are left out so the next run cooks them again
+	std::error_code code;
+	for (const Item& item : this->items)
+	{
+		if (item.stale && !item.result.success)
+			continue;
+		const uint64_t size = fs::file_size(this->settings.outputRoot / item.output, code);
+		if (code)
+			continue;
+		std::snprintf(number, sizeof(number), "%016" PRIx64, item.key);
+		text << "O\t" << number << '\t' << size << '\t' << Key(item.output);
+		for (const fs::path& dependency : item.dependencies)
+		{
+			text << '\t' << Key(dependency);
+		}
+		text << '\n';
+	}
+
+	const std::string bytes = text.str();
+	std::string error;
+	if (!WriteFileAtomic(this->settings.outputRoot / MANIFEST_NAME, bytes.data(), bytes.size(), error))
+	{
+		std::fprintf(stderr, "error: %s\n", error.c_str());
+		return false;
+	}
+	return true;
+}
+
+void AssetCooker::ScanSources()
+{
+	this->items.clear();
+
+	std::error_code code;
+	const fs::path outputRoot = fs::weakly_canonical(this->settings.outputRoot, code);
+
+	fs::recursive_directory_iterator iterator(this->settings.sourceRoot, fs::directory_options::skip_permission_denied, code);
+	for (const fs::recursive_directory_iterator end; !code && iterator != end; iterator.increment(code))
+	{
+		const fs::path& path = iterator->path();
+		if (iterator->is_directory(code))
+		{
+			//Never cook our own outputs, or hidden folders like .vs and .git
+			const std::string name = PathToUtf8(path.filename());
+			if ((!name.empty() && name[0] == '.') || fs::weakly_canonical(path, code) == outputRoot)
+				iterator.disable_recursion_pending();
+			continue;
+		}
+		if (!iterator->is_regular_file(code))
+			continue;
+
+		Item item;
+		item.rule = FindRule(path, item.settings);
+		if (item.rule == nullptr)
+			continue;
+
+		item.source = path.lexically_relative(this->settings.sourceRoot);
+		item.output = item.source;
+		if (item.rule->outputExtension != nullptr)
+			item.output.replace_extension(item.rule->outputExtension);
+
+		//Dependencies found by the last cook, checked again below
+		const auto previous = this->manifestOutputs.find(Key(item.output));
+		if (previous != this->manifestOutputs.end())
+			item.dependencies = previous->second.dependencies;
+
+		this->items.push_back(std::move(item));
+	}
+
+	//Directory order differs between runs and file systems, the manifest should not
+	std::sort(this->items.begin(), this->items.end(), [](const Item& a, const Item& b) { return a.output < b.output; });
+}
+
+//foo.png and foo.jpg both cook to foo.dds. Names are compared without case, as the file
+//system does on Windows. Every source involved fails, since cooking either one would make the
+//output depend on which finished last.
+void AssetCooker::FindConflicts()
+{
+	std::unordered_map<std::string, size_t> firstByOutput;
+	for (size_t i = 0; i < this->items.size(); i++)
+	{
+		Item& item = this->items[i];
+		const auto inserted = firstByOutput.emplace(ToLower(Key(item.output)), i);
+		if (inserted.second)
+			continue;
+
+		Item& first = this->items[inserted.first->second];
+		item.conflict = first.source;
+		if (first.conflict.empty())
+			first.conflict = item.source;
+	}
+}
+
+void AssetCooker::UpdateFileStates(const std::vector<fs::path>& paths)
+{
+	//Stat every file, only the ones whose size or write time changed are read and hashed
+	std::vector<std::pair<fs::path, FileState*>> changed;
+	for (const fs::path& path : paths)
+	{
+		FileState& state = this->fileStates[Key(path)];
+		if (state.checked)
+			continue;
+		state.checked = true;
+		this->stats.filesChecked++;
+
+		std::error_code code;
+		const uint64_t size = fs::file_size(path, code);
+		const fs::file_time_type writeTime = fs::last_write_time(path, code);
+		if (code)
+		{
+			state = FileState();
+			state.checked = true;
+			continue;
+		}
+
+		const int64_t time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+		if (state.exists && state.size == size && state.writeTime == time)
+			continue;
+
+		state.exists = true;
+		state.size = size;
+		state.writeTime = time;
+		changed.emplace_back(path, &state);
+	}
+
+	ForEach(this->jobSystem, changed.size(), [&changed](size_t index)
+	{
+		std::vector<uint8_t> bytes;
+		std::string error;
+		FileState& state = *changed[index].second;
+		if (ReadFileBytes(changed[index].first, bytes, error))
+			state.hash = HashBytes(bytes.data(), bytes.size());
+		else
+			state = FileState();
+		state.checked = true;
+	});
+
+	this->stats.filesHashed += changed.size();
+	for (const auto& file : changed)
+	{
+		this->stats.bytesHashed += file.second->size;
+	}
+}
+
+uint64_t AssetCooker::ComputeKey(const Item& item) const
+{
+	uint64_t key = HashString(item.rule->extension, item.rule->version);
+	key = HashString(item.settings, key);
+
+	const auto source = this->fileStates.find(Key(this->settings.sourceRoot / item.source));
+	const uint64_t sourceHash = source != this->fileStates.end() ? source->second.hash : 0;
+	key = HashBytes(&sourceHash, sizeof(sourceHash), key);
+
+	//Missing dependencies hash as 0, so one appearing or vanishing changes the key
+	for (const fs::path& dependency : item.dependencies)
+	{
+		const auto state = this->fileStates.find(Key(dependency));
+		const uint64_t hash = (state != this->fileStates.end() && state->second.exists) ? state->second.hash : 0;
+		key = HashBytes(&hash, sizeof(hash), key);
+	}
+	return key;
+}
+
+void AssetCooker::CookItem(Item& item) const
+{
+	Timer timer;
+	timer.Start();
+	item.result = item.rule->cook(this->settings.sourceRoot / item.source, this->settings.outputRoot / item.output, item.settings);
+	item.milliseconds = timer.GetMillisecondsElapsed();
+}
+
+void AssetCooker::RemoveOrphans()
+{
+	std::vector<std::string> current;
+	for (const Item& item : this->items)
+	{
+		current.push_back(Key(item.output));
+	}
+	std::sort(current.begin(), current.end());
+
+	for (const auto& entry : this->manifestOutputs)
+	{
+		if (std::binary_search(current.begin(), current.end(), entry.first))
+			continue;
+
+		std::error_code code;
+		if (fs::remove(this->settings.outputRoot / fs::u8path(entry.first), code))
+		{
+			this->stats.removed++;
+			if (this->settings.verbose)
+				std::printf("removed %s\n", entry.first.c_str());
+		}
+	}
+}
+
+bool AssetCooker::Cook(const CookSettings& settings)
+{
+	this->settings = settings;
+	this->stats = CookStats();
+
+	Timer totalTimer;
+	totalTimer.Start();
+
+	std::error_code code;
+	if (!fs::is_directory(settings.sourceRoot, code))
+	{
+		std::fprintf(stderr, "error: source folder %s does not exist\n", PathToUtf8(settings.sourceRoot).c_str());
+		return false;
+	}
+	fs::create_directories(settings.outputRoot, code);
+
+	if (!this->jobSystem.Initialize(settings.threadCount > 1 ? settings.threadCount - 1 : settings.threadCount))
+		return false;
+
+	this->LoadManifest();
+	this->ScanSources();
+	this->FindConflicts();
+
+	std::vector<fs::path> inputs;
+	for (const Item& item : this->items)
+	{
+		inputs.push_back(settings.sourceRoot / item.source);
+		inputs.insert(inputs.end(), item.dependencies.begin(), item.dependencies.end());
+	}
+	this->UpdateFileStates(inputs);
+
+	std::vector<Item*> stale;
+	std::vector<Item*> conflicts;
+	for (Item& item : this->items)
+	{
+		item.key = this->ComputeKey(item);
+
+		if (!item.conflict.empty())
+		{
+			item.stale = true;
+			item.result.error = "Output " + PathToUtf8(item.output) + " is also cooked from " + PathToUtf8(item.conflict);
+			conflicts.push_back(&item);
+			continue;
+		}
+
+		const auto previous = this->manifestOutputs.find(Key(item.output));
+		const uint64_t outputSize = fs::file_size(settings.outputRoot / item.output, code);
+		item.stale = settings.force || code || previous == this->manifestOutputs.end()
+			|| previous->second.key != item.key || previous->second.size != outputSize;
+
+		if (item.stale)
+			stale.push_back(&item);
+		else
+			this->stats.upToDate++;
+	}
+	this->stats.items = this->items.size();
+	this->stats.scanMilliseconds = totalTimer.GetMillisecondsElapsed();
+
+	//Items never depend on each other's outputs, so every stale item can cook at once
+	Timer cookTimer;
+	cookTimer.Start();
+	ForEach(this->jobSystem, stale.size(), [this, &stale](size_t index)
+	{
+		this->CookItem(*stale[index]);
+	});
+	this->stats.cookMilliseconds = cookTimer.GetMillisecondsElapsed();
+
+	//The key stored for a cooked item covers the dependencies this cook found
+	std::vector<fs::path> discovered;
+	for (Item* item : stale)
+	{
+		if (!item->result.success)
+			continue;
+		item->dependencies = item->result.dependencies;
+		discovered.insert(discovered.end(), item->dependencies.begin(), item->dependencies.end());
+	}
+	this->UpdateFileStates(discovered);
+
+	for (Item* item : stale)
+	{
+		if (item->result.success)
+		{
+			item->key = this->ComputeKey(*item);
+			this->stats.cooked++;
+			if (settings.verbose)
+			{
+				std::printf("cooked %s (%.1f ms%s%s)\n", PathToUtf8(item->output).c_str(), item->milliseconds,
+					item->result.detail.empty() ? "" : ", ", item->result.detail.c_str());
+			}
+		}
+		else
+		{
+			this->stats.failed++;
+			std::fprintf(stderr, "error: %s: %s\n", PathToUtf8(item->source).c_str(), item->result.error.c_str());
+		}
+	}
+
+	for (Item* item : conflicts)
+	{
+		this->stats.failed++;
+		std::fprintf(stderr, "error: %s: %s\n", PathToUtf8(item->source).c_str(), item->result.error.c_str());
+	}
+
+	this->RemoveOrphans();
+	const bool saved = this->SaveManifest();
+
+	this->jobSystem.Shutdown();
+	this->stats.totalMilliseconds = totalTimer.GetMillisecondsElapsed();
+	return saved && this->stats.failed == 0;
+}
+
+const CookStats& AssetCooker::GetStats() const
+{
+	return this->stats;
+}
+
+CookResult CookCopy(const fs::path& source, const fs::path& output, const std::string& settings)
+{
+	CookResult result;
+	std::vector<uint8_t> bytes;
+	if (ReadFileBytes(source, bytes, result.error))
+		result.success = WriteFileAtomic(output, bytes.data(), bytes.size(), result.error);
+	return result;
+}
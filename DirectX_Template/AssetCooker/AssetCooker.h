@@ -0,0 +1,102 @@
+#pragma once
+#include "CookFiles.h"
+#include "Cookers.h"
+#include "JobSystem.h"
+#include <unordered_map>
+
+struct CookSettings
+{
+	fs::path sourceRoot;
+	fs::path outputRoot;
+	unsigned int threadCount = 0;	//0 uses every hardware thread
+	bool force = false;				//Ignore the manifest and cook everything
+	bool verbose = false;
+};
+
+struct CookStats
+{
+	size_t items = 0;
+	size_t upToDate = 0;
+	size_t cooked = 0;
+	size_t failed = 0;				//Includes sources that share an output with another
+	size_t removed = 0;				//Outputs whose source no longer exists
+	size_t filesChecked = 0;
+	size_t filesHashed = 0;			//Files whose size or time changed and had to be read
+	uint64_t bytesHashed = 0;
+	double scanMilliseconds = 0.0;
+	double cookMilliseconds = 0.0;
+	double totalMilliseconds = 0.0;
+};
+
+//Cooks everything under sourceRoot that a rule matches into outputRoot, mirroring the folders.
+//Each output is keyed by a hash of its rule, settings, source content and the dependencies the
+//last cook found. Content hashes are cached in a manifest next to the outputs together with
+//the file size and write time, so a rebuild only reads files that changed and only cooks the
+//outputs whose key changed. Stale items are cooked in parallel on the job system.
+class AssetCooker
+{
+public:
+	bool Cook(const CookSettings& settings);
+	const CookStats& GetStats() const;
+
+	static const char* MANIFEST_NAME;
+
+private:
+	typedef CookResult (*CookFunction)(const fs::path& source, const fs::path& output, const std::string& settings);
+
+	struct Rule
+	{
+		const char* extension;
+		const char* outputExtension;	//Null keeps the source extension
+		CookFunction cook;
+		uint32_t version;				//Bump to recook everything a cooker produced
+	};
+
+	struct FileState
+	{
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+		uint64_t hash = 0;
+		bool checked = false;
+		bool exists = false;
+	};
+
+	struct Item
+	{
+		fs::path source;				//Relative to sourceRoot
+		fs::path output;				//Relative to outputRoot
+		const Rule* rule = nullptr;
+		std::string settings;
+		std::vector<fs::path> dependencies;	//Absolute
+		uint64_t key = 0;
+		bool stale = false;
+		fs::path conflict;				//Another source with the same output, neither is cooked
+		CookResult result;
+		double milliseconds = 0.0;
+	};
+
+	struct ManifestOutput
+	{
+		uint64_t key = 0;
+		uint64_t size = 0;
+		std::vector<fs::path> dependencies;
+	};
+
+	static const Rule* FindRule(const fs::path& source, std::string& settings);
+
+	void LoadManifest();
+	bool SaveManifest() const;
+	void ScanSources();
+	void FindConflicts();
+	void UpdateFileStates(const std::vector<fs::path>& paths);
+	uint64_t ComputeKey(const Item& item) const;
+	void CookItem(Item& item) const;
+	void RemoveOrphans();
+
+	CookSettings settings;
+	CookStats stats;
+	JobSystem jobSystem;
+	std::vector<Item> items;
+	std::unordered_map<std::string, FileState> fileStates;		//By absolute generic path
+	std::unordered_map<std::string, ManifestOutput> manifestOutputs;	//By relative output path
+};
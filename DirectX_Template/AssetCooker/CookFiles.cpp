@@ -0,0 +1,100 @@
+#include "CookFiles.h"
+#include <cstring>
+#include <fstream>
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+
+	uint64_t h = seed ^ (size * m);
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + (size / 8) * 8;
+	for (; bytes != end; bytes += 8)
+	{
+		uint64_t k;
+		std::memcpy(&k, bytes, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	const size_t remaining = size & 7;
+	if (remaining != 0)
+	{
+		uint64_t k = 0;
+		for (size_t i = 0; i < remaining; i++)
+		{
+			k |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+		}
+		h ^= k;
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+uint64_t HashString(const std::string& text, uint64_t seed)
+{
+	return HashBytes(text.data(), text.size(), seed);
+}
+
+bool ReadFileBytes(const fs::path& path, std::vector<uint8_t>& bytes, std::string& error)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		error = "Failed to open " + PathToUtf8(path);
+		return false;
+	}
+
+	const std::streamoff size = file.tellg();
+	bytes.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	if (size > 0 && !file.read(reinterpret_cast<char*>(bytes.data()), size))
+	{
+		error = "Failed to read " + PathToUtf8(path);
+		return false;
+	}
+	return true;
+}
+
+bool WriteFileAtomic(const fs::path& path, const void* data, size_t size, std::string& error)
+{
+	std::error_code code;
+	fs::create_directories(path.parent_path(), code);
+
+	fs::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file || !file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)))
+		{
+			error = "Failed to write " + PathToUtf8(temporary);
+			return false;
+		}
+	}
+
+	fs::rename(temporary, path, code);
+	if (code)
+	{
+		fs::remove(temporary, code);
+		error = "Failed to replace " + PathToUtf8(path);
+		return false;
+	}
+	return true;
+}
+
+std::string PathToUtf8(const fs::path& path)
+{
+	const auto text = path.generic_u8string();
+	return std::string(text.begin(), text.end());
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//64 bit content hash (MurmurHash64A), seeded so different inputs to one key can be chained
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+uint64_t HashString(const std::string& text, uint64_t seed = 0);
+
+bool ReadFileBytes(const fs::path& path, std::vector<uint8_t>& bytes, std::string& error);
+
+//Writes next to the destination and renames over it, so a cancelled cook never leaves a
+//truncated output that looks up to date
+bool WriteFileAtomic(const fs::path& path, const void* data, size_t size, std::string& error);
+
+std::string PathToUtf8(const fs::path& path);
@@ -0,0 +1,25 @@
+#pragma once
+#include "CookFiles.h"
+
+struct CookResult
+{
+	bool success = false;
+	std::string error;
+	std::string detail;					//Short note for verbose output, for example the chosen format
+	std::vector<fs::path> dependencies;	//Inputs found while cooking besides the source (shader includes)
+};
+
+//Every cooker reads source and writes output in a form the runtime loads as is. settings comes
+//from the rule that matched the source and is part of the output's key.
+CookResult CookCopy(const fs::path& source, const fs::path& output, const std::string& settings);
+
+//WIC image to a BC compressed DDS with mips. settings: "auto" picks BC1, or BC3 when the image
+//has alpha, "normal" writes BC5. Images whose width or height is not a multiple of 4 are written
+//as R8G8B8A8 instead, which Direct3D 11 can create.
+CookResult CookTexture(const fs::path& source, const fs::path& output, const std::string& settings);
+
+//HLSL to .cso, settings is the target profile (vs_5_0, ps_5_0, ...), the entry point is main
+CookResult CookShader(const fs::path& source, const fs::path& output, const std::string& settings);
+
+//Wavefront OBJ to the DirectXTK VBO format (position, normal, texcoord and 16 bit indices)
+CookResult CookMesh(const fs::path& source, const fs::path& output, const std::string& settings);
@@ -0,0 +1,183 @@
+#include "Cookers.h"
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+	struct Float2 { float x, y; };
+	struct Float3 { float x, y, z; };
+
+	//Same layout as DirectX::VertexPositionNormalTexture, which CreateFromVBO reads directly
+	struct VBOVertex
+	{
+		Float3 position;
+		Float3 normal;
+		Float2 texcoord;
+	};
+	static_assert(sizeof(VBOVertex) == 32, "VBO vertex size mismatch");
+
+	struct VBOHeader
+	{
+		uint32_t numVertices;
+		uint32_t numIndices;
+	};
+
+	//A face corner after its indices are resolved. Negative OBJ indices are relative to the lists
+	//read so far, so the same text can name different vertices on different lines.
+	struct Corner
+	{
+		int position;
+		int texcoord;
+		int normal;
+
+		bool operator==(const Corner& other) const
+		{
+			return this->position == other.position && this->texcoord == other.texcoord && this->normal == other.normal;
+		}
+	};
+
+	struct CornerHash
+	{
+		size_t operator()(const Corner& corner) const
+		{
+			return static_cast<size_t>(corner.position) * 73856093u
+				^ static_cast<size_t>(corner.texcoord) * 19349663u
+				^ static_cast<size_t>(corner.normal) * 83492791u;
+		}
+	};
+
+	//OBJ indices are 1 based, negative ones count back from the end of the list so far
+	int ResolveIndex(const char* text, size_t count)
+	{
+		const int index = std::atoi(text);
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+			return static_cast<int>(count) + index;
+		return -1;
+	}
+}
+
+CookResult CookMesh(const fs::path& source, const fs::path& output, const std::string& settings)
+{
+	CookResult result;
+
+	std::vector<uint8_t> bytes;
+	if (!ReadFileBytes(source, bytes, result.error))
+		return result;
+
+	std::vector<Float3> positions;
+	std::vector<Float3> normals;
+	std::vector<Float2> texcoords;
+	std::vector<VBOVertex> vertices;
+	std::vector<uint16_t> indices;
+	std::unordered_map<Corner, uint16_t, CornerHash> vertexCache;	//Face corners already emitted
+
+	std::istringstream stream(std::string(bytes.begin(), bytes.end()));
+	std::string line;
+	size_t lineNumber = 0;
+	while (std::getline(stream, line))
+	{
+		lineNumber++;
+		std::istringstream tokens(line);
+		std::string command;
+		tokens >> command;
+
+		//Converted to left handed by mirroring z. The mirrored mesh seen through a left handed
+		//camera looks the same as the original through a right handed one, so the OBJ front faces
+		//are still counter clockwise and each triangle is flipped below to the clockwise D3D uses
+		if (command == "v")
+		{
+			Float3 position = {};
+			tokens >> position.x >> position.y >> position.z;
+			position.z = -position.z;
+			positions.push_back(position);
+		}
+		else if (command == "vn")
+		{
+			Float3 normal = {};
+			tokens >> normal.x >> normal.y >> normal.z;
+			normal.z = -normal.z;
+			normals.push_back(normal);
+		}
+		else if (command == "vt")
+		{
+			Float2 texcoord = {};
+			tokens >> texcoord.x >> texcoord.y;
+			texcoord.y = 1.0f - texcoord.y;
+			texcoords.push_back(texcoord);
+		}
+		else if (command == "f")
+		{
+			std::vector<uint16_t> face;
+			std::string corner;
+			while (tokens >> corner)
+			{
+				//v, v/vt, v//vn or v/vt/vn
+				const size_t slash = corner.find('/');
+				const size_t secondSlash = slash == std::string::npos ? std::string::npos : corner.find('/', slash + 1);
+				const int position = ResolveIndex(corner.c_str(), positions.size());
+				const int texcoord = (slash != std::string::npos && slash + 1 != secondSlash) ? ResolveIndex(corner.c_str() + slash + 1, texcoords.size()) : -1;
+				const int normal = secondSlash != std::string::npos ? ResolveIndex(corner.c_str() + secondSlash + 1, normals.size()) : -1;
+				if (position < 0 || position >= static_cast<int>(positions.size())
+					|| texcoord >= static_cast<int>(texcoords.size()) || normal >= static_cast<int>(normals.size()))
+				{
+					result.error = "Invalid face index on line " + std::to_string(lineNumber);
+					return result;
+				}
+
+				const Corner key = { position, texcoord, normal };
+				const auto cached = vertexCache.find(key);
+				if (cached != vertexCache.end())
+				{
+					face.push_back(cached->second);
+					continue;
+				}
+
+				if (vertices.size() >= 0xFFFF)
+				{
+					result.error = "More than 65535 vertices, VBO only has 16 bit indices";
+					return result;
+				}
+
+				VBOVertex vertex = {};
+				vertex.position = positions[position];
+				if (normal >= 0)
+					vertex.normal = normals[normal];
+				if (texcoord >= 0)
+					vertex.texcoord = texcoords[texcoord];
+
+				const uint16_t index = static_cast<uint16_t>(vertices.size());
+				vertices.push_back(vertex);
+				vertexCache.emplace(key, index);
+				face.push_back(index);
+			}
+
+			//Polygons are split into a fan, in reverse to make the front faces clockwise
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[i]);
+				indices.push_back(face[i - 1]);
+			}
+		}
+	}
+
+	if (indices.empty())
+	{
+		result.error = "No faces";
+		return result;
+	}
+
+	VBOHeader header = { static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()) };
+	std::vector<uint8_t> file(sizeof(header) + vertices.size() * sizeof(VBOVertex) + indices.size() * sizeof(uint16_t));
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + sizeof(header), vertices.data(), vertices.size() * sizeof(VBOVertex));
+	std::memcpy(file.data() + sizeof(header) + vertices.size() * sizeof(VBOVertex), indices.data(), indices.size() * sizeof(uint16_t));
+
+	result.detail = std::to_string(vertices.size()) + " vertices, " + std::to_string(indices.size() / 3) + " triangles";
+	result.success = WriteFileAtomic(output, file.data(), file.size(), result.error);
+	return result;
+}
@@ -0,0 +1,77 @@
+#include "Cookers.h"
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+#include <list>
+#include <map>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+namespace
+{
+	//Resolves #include "file" against the including file's folder and records every file opened,
+	//so editing a shared header recooks the shaders that use it
+	class IncludeHandler : public ID3DInclude
+	{
+	public:
+		explicit IncludeHandler(const fs::path& source) : sourceFolder(source.parent_path()) {}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+		{
+			const auto parent = this->folders.find(parentData);
+			const fs::path folder = parent != this->folders.end() ? parent->second : this->sourceFolder;
+			const fs::path path = (folder / fs::u8path(fileName)).lexically_normal();
+
+			std::vector<uint8_t> contents;
+			std::string error;
+			if (!ReadFileBytes(path, contents, error))
+				return E_FAIL;
+
+			this->dependencies.push_back(path);
+			this->files.push_back(std::move(contents));
+			const std::vector<uint8_t>& file = this->files.back();
+			*data = file.data();
+			*bytes = static_cast<UINT>(file.size());
+			this->folders[file.data()] = path.parent_path();
+			return S_OK;
+		}
+
+		HRESULT __stdcall Close(LPCVOID data) override
+		{
+			return S_OK;
+		}
+
+		std::vector<fs::path> dependencies;
+
+	private:
+		fs::path sourceFolder;
+		std::list<std::vector<uint8_t>> files;
+		std::map<LPCVOID, fs::path> folders;
+	};
+}
+
+CookResult CookShader(const fs::path& source, const fs::path& output, const std::string& settings)
+{
+	CookResult result;
+
+	std::vector<uint8_t> text;
+	if (!ReadFileBytes(source, text, result.error))
+		return result;
+
+	const std::string sourceName = PathToUtf8(source);
+	IncludeHandler includeHandler(source);
+	Microsoft::WRL::ComPtr<ID3DBlob> code;
+	Microsoft::WRL::ComPtr<ID3DBlob> errors;
+	const HRESULT hr = D3DCompile(text.data(), text.size(), sourceName.c_str(), nullptr, &includeHandler, "main", settings.c_str(),
+		D3DCOMPILE_OPTIMIZATION_LEVEL3 | D3DCOMPILE_ENABLE_STRICTNESS, 0, code.GetAddressOf(), errors.GetAddressOf());
+
+	if (FAILED(hr))
+	{
+		result.error = errors ? std::string(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize()) : "D3DCompile failed";
+		return result;
+	}
+
+	result.dependencies = includeHandler.dependencies;
+	result.detail = settings;
+	result.success = WriteFileAtomic(output, code->GetBufferPointer(), code->GetBufferSize(), result.error);
+	return result;
+}
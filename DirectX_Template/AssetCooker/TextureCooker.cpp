@@ -0,0 +1,115 @@
+#include "Cookers.h"
+#include "Graphics/BlockCompression.h"
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+namespace
+{
+	//Cookers run on job system threads, each call joins the multithreaded apartment for its own duration
+	class ComScope
+	{
+	public:
+		ComScope() : hr(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {}
+		~ComScope() { if (SUCCEEDED(this->hr)) CoUninitialize(); }
+	private:
+		HRESULT hr;
+	};
+
+	bool DecodeImage(const fs::path& source, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height, std::string& error)
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			error = "Failed to create WIC imaging factory";
+			return false;
+		}
+
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		hr = factory->CreateDecoderFromFilename(source.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		if (SUCCEEDED(hr))
+			hr = decoder->GetFrame(0, frame.GetAddressOf());
+		if (FAILED(hr))
+		{
+			error = "Failed to decode image";
+			return false;
+		}
+
+		UINT frameWidth = 0;
+		UINT frameHeight = 0;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		hr = frame->GetSize(&frameWidth, &frameHeight);
+		if (SUCCEEDED(hr))
+			hr = factory->CreateFormatConverter(converter.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+		if (SUCCEEDED(hr))
+		{
+			rgba.resize(static_cast<size_t>(frameWidth) * frameHeight * 4);
+			hr = converter->CopyPixels(nullptr, frameWidth * 4, static_cast<UINT>(rgba.size()), rgba.data());
+		}
+		if (FAILED(hr))
+		{
+			error = "Failed to convert image to RGBA";
+			return false;
+		}
+
+		width = frameWidth;
+		height = frameHeight;
+		return true;
+	}
+
+	bool HasAlpha(const std::vector<uint8_t>& rgba)
+	{
+		for (size_t i = 3; i < rgba.size(); i += 4)
+		{
+			if (rgba[i] != 255)
+				return true;
+		}
+		return false;
+	}
+}
+
+CookResult CookTexture(const fs::path& source, const fs::path& output, const std::string& settings)
+{
+	CookResult result;
+	ComScope com;
+
+	std::vector<uint8_t> rgba;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	if (!DecodeImage(source, rgba, width, height, result.error))
+		return result;
+
+	BlockCompressionOptions options;
+	if (settings == "normal")
+		options.format = BlockFormat::BC5;
+	else
+		options.format = HasAlpha(rgba) ? BlockFormat::BC3 : BlockFormat::BC1;
+
+	//Items already cook in parallel, so each texture is compressed on its own thread
+	BlockCompressor compressor;
+	compressor.Initialize(nullptr);
+
+	//Direct3D 11 only creates block compressed textures whose top level is a multiple of 4, other
+	//sizes are written uncompressed so the output always loads
+	std::vector<uint8_t> ddsFile;
+	static const char* formatNames[] = { "BC1", "BC3", "BC4", "BC5" };
+	if ((width % 4) != 0 || (height % 4) != 0)
+	{
+		if (!compressor.WriteUncompressedDDS(rgba.data(), width, height, width * 4, options, ddsFile, &result.error))
+			return result;
+		result.detail = "R8G8B8A8, " + std::to_string(width) + "x" + std::to_string(height) + " is not a multiple of 4";
+	}
+	else
+	{
+		if (!compressor.CompressToDDS(rgba.data(), width, height, width * 4, options, ddsFile, nullptr, &result.error))
+			return result;
+		result.detail = formatNames[static_cast<int>(options.format)];
+	}
+	result.success = WriteFileAtomic(output, ddsFile.data(), ddsFile.size(), result.error);
+	return result;
+}
@@ -0,0 +1,47 @@
+#include "AssetCooker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//AssetCooker <sourceFolder> <outputFolder> [-j threads] [-force] [-v]
+int main(int argc, char* argv[])
+{
+	CookSettings settings;
+	std::vector<const char*> folders;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			settings.threadCount = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "-force") == 0)
+			settings.force = true;
+		else if (std::strcmp(argv[i], "-v") == 0)
+			settings.verbose = true;
+		else
+			folders.push_back(argv[i]);
+	}
+
+	if (folders.size() != 2)
+	{
+		std::fprintf(stderr, "usage: AssetCooker <sourceFolder> <outputFolder> [-j threads] [-force] [-v]\n");
+		return 2;
+	}
+
+	//Absolute paths key the file state cache, so relative and absolute invocations share it
+	settings.sourceRoot = fs::absolute(fs::u8path(folders[0])).lexically_normal();
+	settings.outputRoot = fs::absolute(fs::u8path(folders[1])).lexically_normal();
+	if (!settings.sourceRoot.has_filename())
+		settings.sourceRoot = settings.sourceRoot.parent_path();
+	if (!settings.outputRoot.has_filename())
+		settings.outputRoot = settings.outputRoot.parent_path();
+
+	AssetCooker cooker;
+	const bool success = cooker.Cook(settings);
+
+	const CookStats& stats = cooker.GetStats();
+	std::printf("%zu items: %zu cooked, %zu up to date, %zu failed, %zu removed\n",
+		stats.items, stats.cooked, stats.upToDate, stats.failed, stats.removed);
+	std::printf("%zu files checked, %zu hashed (%.2f MB), scan %.1f ms, cook %.1f ms, total %.1f ms\n",
+		stats.filesChecked, stats.filesHashed, stats.bytesHashed / (1024.0 * 1024.0),
+		stats.scanMilliseconds, stats.cookMilliseconds, stats.totalMilliseconds);
+	return success ? 0 : 1;
+}
@@ -23,6 +23,8 @@ void Engine::Update()
 	double deltaTime = timer.GetMillisecondsElapsed();
 	timer.Restart();
 
+	this->gfx.debugDraw.Update(static_cast<float>(deltaTime / 1000.0));
+
 	while (!keyboard.CharBufferIsEmpty())
 	{
 		unsigned char ch = keyboard.ReadChar();
@@ -37,6 +39,15 @@ void Engine::Update()
 	while (!mouse.EventBufferIsEmpty())
 	{
 		MouseEvent me = mouse.ReadEvent();
+		if (me.GetType() == MouseEvent::EventType::LPress)
+		{
+			PickResult pick;
+			if (this->gfx.Pick(me.GetPosX(), me.GetPosY(), pick))
+			{
+				this->gfx.debugDraw.AddSphere(BoundingSphere(pick.position, 0.02f), Colors::Yellow, 2.0f, false);
+				this->gfx.debugDraw.AddText(pick.position, L"Triangle " + std::to_wstring(pick.triangle), Colors::Yellow, 2.0f);
+			}
+		}
 		if (mouse.IsRightDown())
 		{
 			if (me.GetType() == MouseEvent::EventType::RAW_MOVE)
@@ -0,0 +1,551 @@
+#include "Animation.h"
+#include "AnimationCompression.h"
+#include "../ErrorLogger.h"
+#include "../Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cwchar>
+
+namespace
+{
+	//Up to four tracks sampled together: keys found for each, interpolated side by side
+	struct TrackLanes
+	{
+		uint32_t count = 0;
+		uint32_t bones[4] = {};
+		uint32_t keys0[4] = {};
+		uint32_t keys1[4] = {};
+		float weights[4] = {};
+	};
+
+	//Lane layout: four quaternions or vectors are transposed so row i holds component i of every
+	//lane, which lets normalization and hemisphere checks run on all four without horizontal adds.
+	//Lanes past count repeat the first one and are never stored.
+	XMMATRIX LoadLanes(const XMFLOAT4* values, size_t count)
+	{
+		XMMATRIX lanes;
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			lanes.r[lane] = XMLoadFloat4(&values[lane < count ? lane : 0]);
+		}
+		return XMMatrixTranspose(lanes);
+	}
+
+	XMMATRIX LoadLanes(const XMFLOAT3* values, size_t count)
+	{
+		XMMATRIX lanes;
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			lanes.r[lane] = XMLoadFloat3(&values[lane < count ? lane : 0]);
+		}
+		return XMMatrixTranspose(lanes);
+	}
+
+	void StoreLanes(XMFLOAT4* values, size_t count, const XMMATRIX& lanes)
+	{
+		const XMMATRIX transposed = XMMatrixTranspose(lanes);
+		for (size_t lane = 0; lane < count; lane++)
+		{
+			XMStoreFloat4(&values[lane], transposed.r[lane]);
+		}
+	}
+
+	void StoreLanes(XMFLOAT3* values, size_t count, const XMMATRIX& lanes)
+	{
+		const XMMATRIX transposed = XMMatrixTranspose(lanes);
+		for (size_t lane = 0; lane < count; lane++)
+		{
+			XMStoreFloat3(&values[lane], transposed.r[lane]);
+		}
+	}
+
+	XMMATRIX XM_CALLCONV LerpLanes(FXMVECTOR t, const XMMATRIX& a, const XMMATRIX& b)
+	{
+		XMMATRIX result;
+		for (int component = 0; component < 4; component++)
+		{
+			result.r[component] = XMVectorLerpV(a.r[component], b.r[component], t);
+		}
+		return result;
+	}
+
+	//Normalized lerp of four quaternions, a zero length result stays zero like XMQuaternionNormalize
+	XMMATRIX XM_CALLCONV NLerpLanes(FXMVECTOR t, const XMMATRIX& a, const XMMATRIX& b)
+	{
+		XMMATRIX result = LerpLanes(t, a, b);
+		XMVECTOR lengthSq = XMVectorMultiply(result.r[0], result.r[0]);
+		lengthSq = XMVectorMultiplyAdd(result.r[1], result.r[1], lengthSq);
+		lengthSq = XMVectorMultiplyAdd(result.r[2], result.r[2], lengthSq);
+		lengthSq = XMVectorMultiplyAdd(result.r[3], result.r[3], lengthSq);
+		const XMVECTOR zero = XMVectorEqual(lengthSq, XMVectorZero());
+		const XMVECTOR inverseLength = XMVectorSelect(XMVectorReciprocal(XMVectorSqrt(lengthSq)), XMVectorZero(), zero);
+		for (int component = 0; component < 4; component++)
+		{
+			result.r[component] = XMVectorMultiply(result.r[component], inverseLength);
+		}
+		return result;
+	}
+
+	void InterpolateKeys(const DirectX::ModelAnimationClip& clip, const TrackLanes& lanes, AnimationPose& pose)
+	{
+		XMMATRIX rotations0, rotations1, translations0, translations1, scales0, scales1;
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			const uint32_t source = lane < lanes.count ? lane : 0;
+			rotations0.r[lane] = XMLoadFloat4(&clip.keyRotations[lanes.keys0[source]]);
+			rotations1.r[lane] = XMLoadFloat4(&clip.keyRotations[lanes.keys1[source]]);
+			translations0.r[lane] = XMLoadFloat3(&clip.keyTranslations[lanes.keys0[source]]);
+			translations1.r[lane] = XMLoadFloat3(&clip.keyTranslations[lanes.keys1[source]]);
+			scales0.r[lane] = XMLoadFloat3(&clip.keyScales[lanes.keys0[source]]);
+			scales1.r[lane] = XMLoadFloat3(&clip.keyScales[lanes.keys1[source]]);
+		}
+		const XMVECTOR t = XMVectorSet(lanes.weights[0], lanes.weights[1], lanes.weights[2], lanes.weights[3]);
+
+		//Keys were put in the same hemisphere at load time, so a normalized lerp is enough
+		const XMMATRIX rotations = XMMatrixTranspose(NLerpLanes(t, XMMatrixTranspose(rotations0), XMMatrixTranspose(rotations1)));
+		const XMMATRIX translations = XMMatrixTranspose(LerpLanes(t, XMMatrixTranspose(translations0), XMMatrixTranspose(translations1)));
+		const XMMATRIX scales = XMMatrixTranspose(LerpLanes(t, XMMatrixTranspose(scales0), XMMatrixTranspose(scales1)));
+		for (uint32_t lane = 0; lane < lanes.count; lane++)
+		{
+			const uint32_t bone = lanes.bones[lane];
+			XMStoreFloat4(&pose.rotations[bone], rotations.r[lane]);
+			XMStoreFloat3(&pose.translations[bone], translations.r[lane]);
+			XMStoreFloat3(&pose.scales[bone], scales.r[lane]);
+		}
+	}
+}
+
+void AnimationPose::Resize(size_t boneCount)
+{
+	this->rotations.resize(boneCount);
+	this->translations.resize(boneCount);
+	this->scales.resize(boneCount);
+}
+
+bool AnimationRig::Initialize(const DirectX::Model& model)
+{
+	this->model = &model;
+	const size_t boneCount = model.bones.size();
+	if (boneCount == 0)
+	{
+		ErrorLogger::Log("Model has no bones. Load it with ModelLoader_IncludeBones.");
+		return false;
+	}
+
+	this->parents.resize(boneCount);
+	this->inverseBindPoses.resize(boneCount);
+	this->bindPose.Resize(boneCount);
+	for (size_t i = 0; i < boneCount; i++)
+	{
+		const ModelBone& bone = model.bones[i];
+		this->parents[i] = bone.parentIndex < boneCount ? bone.parentIndex : ModelBone::c_Invalid;
+		this->inverseBindPoses[i] = bone.invBindPose;
+
+		XMVECTOR scale, rotation, translation;
+		const XMMATRIX local = XMLoadFloat4x4(&bone.localTransform);
+		if (!XMMatrixDecompose(&scale, &rotation, &translation, local))
+		{
+			scale = XMVectorSplatOne();
+			rotation = XMQuaternionIdentity();
+			translation = local.r[3];
+		}
+		XMStoreFloat4(&this->bindPose.rotations[i], rotation);
+		XMStoreFloat3(&this->bindPose.translations[i], translation);
+		XMStoreFloat3(&this->bindPose.scales[i], scale);
+	}
+
+	//Order bones by depth so every parent is concatenated before its children
+	std::vector<uint32_t> depth(boneCount, 0);
+	for (size_t i = 0; i < boneCount; i++)
+	{
+		uint32_t parent = this->parents[i];
+		uint32_t steps = 0;
+		while (parent != ModelBone::c_Invalid && steps <= boneCount)
+		{
+			parent = this->parents[parent];
+			steps++;
+		}
+		if (steps > boneCount)
+		{
+			ErrorLogger::Log("Model bone hierarchy contains a cycle.");
+			return false;
+		}
+		depth[i] = steps;
+	}
+	this->evaluationOrder.resize(boneCount);
+	for (uint32_t i = 0; i < boneCount; i++)
+	{
+		this->evaluationOrder[i] = i;
+	}
+	std::stable_sort(this->evaluationOrder.begin(), this->evaluationOrder.end(), [&depth](uint32_t a, uint32_t b) { return depth[a] < depth[b]; });
+
+	//Skinning effects only have room for MaxBones matrices per draw
+	this->skinnedMeshes.clear();
+	for (const auto& mesh : model.meshes)
+	{
+		if (mesh->boneInfluences.empty())
+			continue;
+
+		if (mesh->boneInfluences.size() > static_cast<size_t>(IEffectSkinning::MaxBones))
+		{
+			ErrorLogger::Log("Mesh references more bones than SkinnedEffect::MaxBones.");
+			return false;
+		}
+
+		SkinnedMesh skinnedMesh;
+		skinnedMesh.bones = mesh->boneInfluences;
+		for (const auto& part : mesh->meshParts)
+		{
+			IEffectSkinning* skinning = dynamic_cast<IEffectSkinning*>(part->effect.get());
+			if (skinning != nullptr && std::find(skinnedMesh.effects.begin(), skinnedMesh.effects.end(), skinning) == skinnedMesh.effects.end())
+				skinnedMesh.effects.push_back(skinning);
+		}
+		if (!skinnedMesh.effects.empty())
+			this->skinnedMeshes.push_back(std::move(skinnedMesh));
+	}
+	return true;
+}
+
+uint32_t AnimationRig::GetBoneCount() const
+{
+	return static_cast<uint32_t>(this->parents.size());
+}
+
+const AnimationPose& AnimationRig::GetBindPose() const
+{
+	return this->bindPose;
+}
+
+const DirectX::ModelAnimationClip* AnimationRig::FindClip(const wchar_t* name) const
+{
+	if (this->model == nullptr || name == nullptr)
+		return nullptr;
+
+	for (const ModelAnimationClip& clip : this->model->animations)
+	{
+		//CMO names keep their null terminator, so compare as C strings
+		if (wcscmp(clip.name.c_str(), name) == 0)
+			return &clip;
+	}
+	return nullptr;
+}
+
+void AnimationRig::SampleClip(const DirectX::ModelAnimationClip& clip, float time, AnimationPose& pose) const
+{
+	//Keys are looked up one track at a time, then interpolated four tracks at a time
+	const uint32_t boneCount = this->GetBoneCount();
+	TrackLanes lanes;
+	for (const ModelAnimationClip::Track& track : clip.tracks)
+	{
+		if (track.boneIndex >= boneCount || track.keyCount == 0)
+			continue;
+
+		const uint32_t first = track.firstKey;
+		const float* times = clip.keyTimes.data() + first;
+		const uint32_t next = static_cast<uint32_t>(std::upper_bound(times, times + track.keyCount, time) - times);
+
+		//Clamp outside the keyed range, otherwise interpolate between the surrounding keys
+		uint32_t key0, key1;
+		float t = 0.0f;
+		if (next == 0)
+		{
+			key0 = key1 = first;
+		}
+		else if (next == track.keyCount)
+		{
+			key0 = key1 = first + track.keyCount - 1;
+		}
+		else
+		{
+			key0 = first + next - 1;
+			key1 = first + next;
+			const float span = clip.keyTimes[key1] - clip.keyTimes[key0];
+			t = span > 0.0f ? (time - clip.keyTimes[key0]) / span : 0.0f;
+		}
+
+		const uint32_t lane = lanes.count++;
+		lanes.bones[lane] = track.boneIndex;
+		lanes.keys0[lane] = key0;
+		lanes.keys1[lane] = key1;
+		lanes.weights[lane] = t;
+		if (lanes.count == 4)
+		{
+			InterpolateKeys(clip, lanes, pose);
+			lanes.count = 0;
+		}
+	}
+	if (lanes.count > 0)
+		InterpolateKeys(clip, lanes, pose);
+}
+
+void AnimationRig::BlendPoses(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& result)
+{
+	//Four bones at a time, loaded before anything is stored so result may be a or b
+	const size_t boneCount = std::min(a.rotations.size(), b.rotations.size());
+	result.Resize(boneCount);
+	const XMVECTOR weights = XMVectorReplicate(weight);
+	for (size_t first = 0; first < boneCount; first += 4)
+	{
+		const size_t count = std::min<size_t>(boneCount - first, 4);
+
+		const XMMATRIX rotationsA = LoadLanes(a.rotations.data() + first, count);
+		XMMATRIX rotationsB = LoadLanes(b.rotations.data() + first, count);
+		const XMMATRIX translationsA = LoadLanes(a.translations.data() + first, count);
+		const XMMATRIX translationsB = LoadLanes(b.translations.data() + first, count);
+		const XMMATRIX scalesA = LoadLanes(a.scales.data() + first, count);
+		const XMMATRIX scalesB = LoadLanes(b.scales.data() + first, count);
+
+		//Take the short way around: flip b where it is in the other hemisphere from a
+		XMVECTOR dot = XMVectorMultiply(rotationsA.r[0], rotationsB.r[0]);
+		dot = XMVectorMultiplyAdd(rotationsA.r[1], rotationsB.r[1], dot);
+		dot = XMVectorMultiplyAdd(rotationsA.r[2], rotationsB.r[2], dot);
+		dot = XMVectorMultiplyAdd(rotationsA.r[3], rotationsB.r[3], dot);
+		const XMVECTOR flip = XMVectorLess(dot, XMVectorZero());
+		for (int component = 0; component < 4; component++)
+		{
+			rotationsB.r[component] = XMVectorSelect(rotationsB.r[component], XMVectorNegate(rotationsB.r[component]), flip);
+		}
+
+		StoreLanes(result.rotations.data() + first, count, NLerpLanes(weights, rotationsA, rotationsB));
+		StoreLanes(result.translations.data() + first, count, LerpLanes(weights, translationsA, translationsB));
+		StoreLanes(result.scales.data() + first, count, LerpLanes(weights, scalesA, scalesB));
+	}
+}
+
+void AnimationRig::ComputeModelTransforms(const AnimationPose& pose, XMFLOAT4X4* transforms) const
+{
+	const XMVECTOR zero = XMVectorZero();
+	for (uint32_t bone : this->evaluationOrder)
+	{
+		XMMATRIX transform = XMMatrixAffineTransformation(XMLoadFloat3(&pose.scales[bone]), zero, XMLoadFloat4(&pose.rotations[bone]), XMLoadFloat3(&pose.translations[bone]));
+		const uint32_t parent = this->parents[bone];
+		if (parent != ModelBone::c_Invalid)
+			transform = XMMatrixMultiply(transform, XMLoadFloat4x4(&transforms[parent]));
+		XMStoreFloat4x4(&transforms[bone], transform);
+	}
+}
+
+void AnimationRig::ComputeSkinPalette(const AnimationPose& pose, XMFLOAT4X4* palette) const
+{
+	//palette first holds the model space bone transforms, then they are turned into skin matrices.
+	//Model space transforms are needed by children, so the inverse bind pose goes in afterwards.
+	this->ComputeModelTransforms(pose, palette);
+
+	const size_t boneCount = this->parents.size();
+	for (size_t bone = 0; bone < boneCount; bone++)
+	{
+		XMStoreFloat4x4(&palette[bone], XMMatrixMultiply(XMLoadFloat4x4(&this->inverseBindPoses[bone]), XMLoadFloat4x4(&palette[bone])));
+	}
+}
+
+void AnimationRig::ApplyPalette(const XMFLOAT4X4* palette) const
+{
+	XMMATRIX meshPalette[IEffectSkinning::MaxBones];
+	for (const SkinnedMesh& mesh : this->skinnedMeshes)
+	{
+		const size_t count = mesh.bones.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			meshPalette[i] = XMLoadFloat4x4(&palette[mesh.bones[i]]);
+		}
+		for (IEffectSkinning* effect : mesh.effects)
+		{
+			effect->SetBoneTransforms(meshPalette, count);
+		}
+	}
+}
+
+void AnimationSystem::Initialize(JobSystem* jobSystem)
+{
+	this->jobSystem = jobSystem;
+}
+
+bool AnimationSystem::ClipSource::IsSet() const
+{
+	return this->raw != nullptr || this->compressed != nullptr;
+}
+
+float AnimationSystem::ClipSource::GetStartTime() const
+{
+	if (this->compressed != nullptr)
+		return this->compressed->GetStartTime();
+	return this->raw != nullptr ? this->raw->startTime : 0.0f;
+}
+
+float AnimationSystem::ClipSource::GetEndTime() const
+{
+	if (this->compressed != nullptr)
+		return this->compressed->GetEndTime();
+	return this->raw != nullptr ? this->raw->endTime : 0.0f;
+}
+
+void AnimationSystem::ClipSource::Sample(const AnimationRig& rig, float time, AnimationPose& pose) const
+{
+	if (this->compressed != nullptr)
+		this->compressed->Sample(time, pose);
+	else if (this->raw != nullptr)
+		rig.SampleClip(*this->raw, time, pose);
+}
+
+uint32_t AnimationSystem::AddCharacter(const AnimationRig* rig, const DirectX::ModelAnimationClip* clip)
+{
+	return this->AddCharacter(rig, ClipSource(clip));
+}
+
+uint32_t AnimationSystem::AddCharacter(const AnimationRig* rig, const CompressedAnimationClip* clip)
+{
+	return this->AddCharacter(rig, ClipSource(clip));
+}
+
+uint32_t AnimationSystem::AddCharacter(const AnimationRig* rig, const ClipSource& clip)
+{
+	Character character;
+	character.rig = rig;
+	character.clip = clip;
+	character.time = clip.GetStartTime();
+	character.palette.resize(rig->GetBoneCount());
+	rig->ComputeSkinPalette(rig->GetBindPose(), character.palette.data());
+
+	this->characters.push_back(std::move(character));
+	return static_cast<uint32_t>(this->characters.size() - 1);
+}
+
+void AnimationSystem::Clear()
+{
+	this->characters.clear();
+	this->stats = AnimationStats();
+}
+
+void AnimationSystem::SetClips(uint32_t character, const DirectX::ModelAnimationClip* clip, const DirectX::ModelAnimationClip* blendClip, float blendWeight)
+{
+	this->SetClips(character, ClipSource(clip), ClipSource(blendClip), blendWeight);
+}
+
+void AnimationSystem::SetClips(uint32_t character, const CompressedAnimationClip* clip, const CompressedAnimationClip* blendClip, float blendWeight)
+{
+	this->SetClips(character, ClipSource(clip), ClipSource(blendClip), blendWeight);
+}
+
+void AnimationSystem::SetClips(uint32_t character, const ClipSource& clip, const ClipSource& blendClip, float blendWeight)
+{
+	if (character >= this->characters.size())
+		return;
+
+	Character& c = this->characters[character];
+	c.clip = clip;
+	c.blendClip = blendClip;
+	c.blendWeight = std::min(std::max(blendWeight, 0.0f), 1.0f);
+}
+
+void AnimationSystem::SetPlayback(uint32_t character, float time, float speed, bool loop)
+{
+	if (character >= this->characters.size())
+		return;
+
+	Character& c = this->characters[character];
+	c.time = time;
+	c.speed = speed;
+	c.loop = loop;
+}
+
+float AnimationSystem::AdvanceTime(const ClipSource& clip, float time, float delta, bool loop)
+{
+	if (!clip.IsSet())
+		return time + delta;
+
+	const float startTime = clip.GetStartTime();
+	const float endTime = clip.GetEndTime();
+	const float duration = endTime - startTime;
+	time += delta;
+	if (duration <= 0.0f)
+		return startTime;
+
+	if (loop)
+	{
+		time = std::fmod(time - startTime, duration);
+		if (time < 0.0f)
+			time += duration;
+		return startTime + time;
+	}
+	return std::min(std::max(time, startTime), endTime);
+}
+
+void AnimationSystem::Update(float deltaSeconds)
+{
+	Timer timer;
+	timer.Start();
+
+	auto updateRange = [this, deltaSeconds](uint32_t begin, uint32_t end)
+	{
+		//Scratch poses are reused by every character of the batch
+		AnimationPose pose, blendPose;
+		for (uint32_t i = begin; i < end; i++)
+		{
+			Character& c = this->characters[i];
+			c.time = AdvanceTime(c.clip, c.time, deltaSeconds * c.speed, c.loop);
+
+			const AnimationPose& bindPose = c.rig->GetBindPose();
+			pose = bindPose;
+			if (c.clip.IsSet() && c.blendWeight < 1.0f)
+				c.clip.Sample(*c.rig, c.time, pose);
+
+			if (c.blendClip.IsSet() && c.blendWeight > 0.0f)
+			{
+				//The blend clip plays at the same phase, so cycles of different lengths stay in step
+				float blendTime = c.blendClip.GetStartTime();
+				const float clipStart = c.clip.GetStartTime();
+				const float clipEnd = c.clip.GetEndTime();
+				if (c.clip.IsSet() && clipEnd > clipStart)
+				{
+					const float phase = (c.time - clipStart) / (clipEnd - clipStart);
+					blendTime += phase * (c.blendClip.GetEndTime() - c.blendClip.GetStartTime());
+				}
+				blendPose = bindPose;
+				c.blendClip.Sample(*c.rig, blendTime, blendPose);
+
+				if (c.clip.IsSet() && c.blendWeight < 1.0f)
+					AnimationRig::BlendPoses(pose, blendPose, c.blendWeight, pose);
+				else
+					std::swap(pose, blendPose);
+			}
+
+			c.rig->ComputeSkinPalette(pose, c.palette.data());
+		}
+	};
+
+	const uint32_t count = static_cast<uint32_t>(this->characters.size());
+	if (this->jobSystem != nullptr)
+		this->jobSystem->ParallelFor(count, 16, updateRange);
+	else
+		updateRange(0, count);
+
+	this->stats.characters = this->characters.size();
+	this->stats.bonesSampled = 0;
+	for (const Character& c : this->characters)
+	{
+		this->stats.bonesSampled += c.palette.size();
+	}
+	this->stats.updateMilliseconds = timer.GetMillisecondsElapsed();
+}
+
+void AnimationSystem::ApplyPalette(uint32_t character) const
+{
+	if (character >= this->characters.size())
+		return;
+
+	const Character& c = this->characters[character];
+	c.rig->ApplyPalette(c.palette.data());
+}
+
+const XMFLOAT4X4* AnimationSystem::GetSkinPalette(uint32_t character) const
+{
+	if (character >= this->characters.size())
+		return nullptr;
+
+	return this->characters[character].palette.data();
+}
+
+const AnimationStats& AnimationSystem::GetStats() const
+{
+	return this->stats;
+}
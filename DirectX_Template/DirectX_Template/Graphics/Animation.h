@@ -0,0 +1,127 @@
+#pragma once
+#include <Model.h>
+#include <Effects.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "../JobSystem.h"
+
+using namespace DirectX;
+
+class CompressedAnimationClip;
+
+//Note: DirectX::Model is always written out in full here, the engine has its own Model class
+
+struct AnimationStats
+{
+	size_t characters = 0;
+	size_t bonesSampled = 0;
+	double updateMilliseconds = 0.0;	//Wall time of the last Update, sampling included
+};
+
+//Local bone transforms (scale, rotation quaternion, translation) indexed by model bone
+struct AnimationPose
+{
+	void Resize(size_t boneCount);
+
+	std::vector<XMFLOAT4> rotations;
+	std::vector<XMFLOAT3> translations;
+	std::vector<XMFLOAT3> scales;
+};
+
+//Skeleton of a DirectX::Model loaded with ModelLoader_IncludeBones, prepared for sampling:
+//bind pose split into TRS, bones ordered so parents come before children, and the skinning
+//effects of every mesh with the bones its vertices reference (at most SkinnedEffect::MaxBones).
+//The model must outlive the rig.
+class AnimationRig
+{
+public:
+	bool Initialize(const DirectX::Model& model);
+
+	uint32_t GetBoneCount() const;
+	const AnimationPose& GetBindPose() const;
+	const DirectX::ModelAnimationClip* FindClip(const wchar_t* name) const;
+
+	//Overwrites the bones the clip animates, other bones keep the values already in pose
+	void SampleClip(const DirectX::ModelAnimationClip& clip, float time, AnimationPose& pose) const;
+	//weight 0 gives a, weight 1 gives b
+	static void BlendPoses(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& result);
+	//Concatenates the hierarchy, transforms are indexed by model bone
+	void ComputeModelTransforms(const AnimationPose& pose, XMFLOAT4X4* transforms) const;
+	//Model transforms with the inverse bind pose multiplied in, palette is indexed by model bone
+	void ComputeSkinPalette(const AnimationPose& pose, XMFLOAT4X4* palette) const;
+	//Uploads the palette to the skinning effects of every skinned mesh
+	void ApplyPalette(const XMFLOAT4X4* palette) const;
+
+private:
+	struct SkinnedMesh
+	{
+		std::vector<uint32_t> bones;
+		std::vector<IEffectSkinning*> effects;
+	};
+
+	const DirectX::Model* model = nullptr;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> evaluationOrder;
+	std::vector<XMFLOAT4X4> inverseBindPoses;
+	std::vector<SkinnedMesh> skinnedMeshes;
+	AnimationPose bindPose;
+};
+
+//Plays clips on many characters. Update samples every character on the job system, each
+//character blends between two clips and ends up with a skin palette ready for ApplyPalette.
+class AnimationSystem
+{
+public:
+	void Initialize(JobSystem* jobSystem);
+
+	uint32_t AddCharacter(const AnimationRig* rig, const DirectX::ModelAnimationClip* clip);
+	uint32_t AddCharacter(const AnimationRig* rig, const CompressedAnimationClip* clip);
+	void Clear();
+	//blendClip may be null, blendWeight 1 plays blendClip only
+	void SetClips(uint32_t character, const DirectX::ModelAnimationClip* clip, const DirectX::ModelAnimationClip* blendClip, float blendWeight);
+	void SetClips(uint32_t character, const CompressedAnimationClip* clip, const CompressedAnimationClip* blendClip, float blendWeight);
+	void SetPlayback(uint32_t character, float time, float speed, bool loop = true);
+
+	void Update(float deltaSeconds);
+	void ApplyPalette(uint32_t character) const;
+	const XMFLOAT4X4* GetSkinPalette(uint32_t character) const;
+	const AnimationStats& GetStats() const;
+
+private:
+	//Either a raw or a compressed clip, characters can play both
+	struct ClipSource
+	{
+		ClipSource() = default;
+		ClipSource(const DirectX::ModelAnimationClip* raw) : raw(raw) {}
+		ClipSource(const CompressedAnimationClip* compressed) : compressed(compressed) {}
+
+		bool IsSet() const;
+		float GetStartTime() const;
+		float GetEndTime() const;
+		void Sample(const AnimationRig& rig, float time, AnimationPose& pose) const;
+
+		const DirectX::ModelAnimationClip* raw = nullptr;
+		const CompressedAnimationClip* compressed = nullptr;
+	};
+
+	struct Character
+	{
+		const AnimationRig* rig = nullptr;
+		ClipSource clip;
+		ClipSource blendClip;
+		float blendWeight = 0.0f;
+		float time = 0.0f;
+		float speed = 1.0f;
+		bool loop = true;
+		std::vector<XMFLOAT4X4> palette;
+	};
+
+	uint32_t AddCharacter(const AnimationRig* rig, const ClipSource& clip);
+	void SetClips(uint32_t character, const ClipSource& clip, const ClipSource& blendClip, float blendWeight);
+	static float AdvanceTime(const ClipSource& clip, float time, float delta, bool loop);
+
+	JobSystem* jobSystem = nullptr;
+	std::vector<Character> characters;
+	AnimationStats stats;
+};
@@ -0,0 +1,377 @@
+#include "AnimationCompression.h"
+#include "../ErrorLogger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float QUANTIZE_16 = 65535.0f;
+	const float QUANTIZE_15 = 32767.0f;
+	const float SQRT2 = 1.41421356f;
+	const size_t CMO_KEYFRAME_SIZE = 72;	//UINT bone, float time, XMFLOAT4X4 transform
+
+	inline uint16_t Quantize(float value, float minimum, float scale, float levels)
+	{
+		if (scale <= 0.0f)
+			return 0;
+		const float q = std::round((value - minimum) / scale);
+		return static_cast<uint16_t>(std::min(std::max(q, 0.0f), levels));
+	}
+
+	//Smallest-three: the largest component is dropped (and made positive), the other three fit in +-1/sqrt(2)
+	void EncodeRotation(const XMFLOAT4& rotation, uint16_t* out)
+	{
+		float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < 4; i++)
+		{
+			if (std::fabs(q[i]) > std::fabs(q[largest]))
+				largest = i;
+		}
+		const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+		uint32_t component = 0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			out[component++] = Quantize((q[i] * sign * SQRT2 + 1.0f) * 0.5f, 0.0f, 1.0f / QUANTIZE_15, QUANTIZE_15);
+		}
+
+		//The dropped component's index lives in the spare top bits of the first two words
+		out[0] |= static_cast<uint16_t>((largest & 1) << 15);
+		out[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+	}
+
+	XMVECTOR XM_CALLCONV DecodeRotation(const uint16_t* in)
+	{
+		const uint32_t largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+		const float scale = 2.0f / (QUANTIZE_15 * SQRT2);
+		const float offset = 1.0f / SQRT2;
+		const float a = (in[0] & 0x7FFF) * scale - offset;
+		const float b = (in[1] & 0x7FFF) * scale - offset;
+		const float c = (in[2] & 0x7FFF) * scale - offset;
+		const float d = std::sqrt(std::max(0.0f, 1.0f - a * a - b * b - c * c));
+
+		switch (largest)
+		{
+		case 0: return XMVectorSet(d, a, b, c);
+		case 1: return XMVectorSet(a, d, b, c);
+		case 2: return XMVectorSet(a, b, d, c);
+		default: return XMVectorSet(a, b, c, d);
+		}
+	}
+
+	inline XMVECTOR XM_CALLCONV DecodeVector(const uint16_t* in, const XMFLOAT3& minimum, const XMFLOAT3& scale)
+	{
+		return XMVectorMultiplyAdd(XMVectorSet(in[0], in[1], in[2], 0.0f), XMLoadFloat3(&scale), XMLoadFloat3(&minimum));
+	}
+
+	inline XMVECTOR XM_CALLCONV InterpolateRotation(FXMVECTOR a, FXMVECTOR b, float t)
+	{
+		//Smallest-three flips signs freely, so pick the short arc when decoding
+		const XMVECTOR end = XMVectorGetX(XMVector4Dot(a, b)) < 0.0f ? XMVectorNegate(b) : b;
+		return XMQuaternionNormalize(XMVectorLerp(a, end, t));
+	}
+
+	float RotationError(FXMVECTOR a, FXMVECTOR b)
+	{
+		const float dot = std::min(std::fabs(XMVectorGetX(XMVector4Dot(a, b))), 1.0f);
+		return 2.0f * std::acos(dot);
+	}
+
+	float VectorError(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b)));
+	}
+
+	//Greedy piecewise linear fit: every segment is stretched as far as the keys it skips can still be
+	//rebuilt from its (quantized) end points within the tolerance. Returns the indices of kept keys.
+	std::vector<uint32_t> ReduceKeys(const float* times, const std::vector<XMFLOAT4>& source, const std::vector<XMFLOAT4>& decoded, bool rotation, float tolerance)
+	{
+		const uint32_t count = static_cast<uint32_t>(source.size());
+		auto error = [rotation](FXMVECTOR a, FXMVECTOR b) { return rotation ? RotationError(a, b) : VectorError(a, b); };
+
+		//Constant channels keep a single key
+		bool constant = true;
+		const XMVECTOR first = XMLoadFloat4(&decoded[0]);
+		for (uint32_t k = 1; k < count && constant; k++)
+		{
+			constant = error(first, XMLoadFloat4(&source[k])) <= tolerance;
+		}
+		if (constant)
+			return std::vector<uint32_t>(1, 0);
+
+		auto segmentFits = [&](uint32_t begin, uint32_t end)
+		{
+			const XMVECTOR a = XMLoadFloat4(&decoded[begin]);
+			const XMVECTOR b = XMLoadFloat4(&decoded[end]);
+			const float span = times[end] - times[begin];
+			for (uint32_t k = begin + 1; k < end; k++)
+			{
+				const float t = span > 0.0f ? (times[k] - times[begin]) / span : 0.0f;
+				const XMVECTOR value = rotation ? InterpolateRotation(a, b, t) : XMVectorLerp(a, b, t);
+				if (error(value, XMLoadFloat4(&source[k])) > tolerance)
+					return false;
+			}
+			return true;
+		};
+
+		std::vector<uint32_t> kept(1, 0);
+		uint32_t anchor = 0;
+		while (anchor + 1 < count)
+		{
+			uint32_t end = anchor + 1;
+			while (end + 1 < count && segmentFits(anchor, end + 1))
+			{
+				end++;
+			}
+			kept.push_back(end);
+			anchor = end;
+		}
+		return kept;
+	}
+}
+
+bool CompressedAnimationClip::Compress(const DirectX::ModelAnimationClip& clip, const AnimationCompressionSettings& settings)
+{
+	const size_t keyCount = clip.keyTimes.size();
+	if (clip.keyRotations.size() != keyCount || clip.keyTranslations.size() != keyCount || clip.keyScales.size() != keyCount)
+	{
+		ErrorLogger::Log("Animation clip key arrays have different sizes.");
+		return false;
+	}
+
+	this->name = clip.name;
+	this->startTime = clip.startTime;
+	this->endTime = clip.endTime;
+	for (const ModelAnimationClip::Track& track : clip.tracks)
+	{
+		if (track.keyCount == 0 || static_cast<size_t>(track.firstKey) + track.keyCount > keyCount)
+		{
+			ErrorLogger::Log("Animation clip track references keys outside the clip.");
+			return false;
+		}
+		this->startTime = std::min(this->startTime, clip.keyTimes[track.firstKey]);
+		this->endTime = std::max(this->endTime, clip.keyTimes[track.firstKey + track.keyCount - 1]);
+	}
+
+	this->tracks.clear();
+	this->keyTimes.clear();
+	this->rotations.clear();
+	this->translations.clear();
+	this->scales.clear();
+
+	const float duration = this->endTime - this->startTime;
+	const float timeScale = duration > 0.0f ? duration / QUANTIZE_16 : 0.0f;
+
+	std::vector<XMFLOAT4> source, decoded;
+	for (const ModelAnimationClip::Track& sourceTrack : clip.tracks)
+	{
+		Track track;
+		track.boneIndex = sourceTrack.boneIndex;
+		const uint32_t first = sourceTrack.firstKey;
+		const uint32_t count = sourceTrack.keyCount;
+		const float* times = clip.keyTimes.data() + first;
+
+		//Translation and scale are quantized inside the track's own range
+		XMVECTOR translationMin = XMLoadFloat3(&clip.keyTranslations[first]), translationMax = translationMin;
+		XMVECTOR scaleMin = XMLoadFloat3(&clip.keyScales[first]), scaleMax = scaleMin;
+		for (uint32_t k = 1; k < count; k++)
+		{
+			translationMin = XMVectorMin(translationMin, XMLoadFloat3(&clip.keyTranslations[first + k]));
+			translationMax = XMVectorMax(translationMax, XMLoadFloat3(&clip.keyTranslations[first + k]));
+			scaleMin = XMVectorMin(scaleMin, XMLoadFloat3(&clip.keyScales[first + k]));
+			scaleMax = XMVectorMax(scaleMax, XMLoadFloat3(&clip.keyScales[first + k]));
+		}
+		const XMVECTOR levels = XMVectorReplicate(1.0f / QUANTIZE_16);
+		XMStoreFloat3(&track.translationMin, translationMin);
+		XMStoreFloat3(&track.translationScale, XMVectorMultiply(XMVectorSubtract(translationMax, translationMin), levels));
+		XMStoreFloat3(&track.scaleMin, scaleMin);
+		XMStoreFloat3(&track.scaleScale, XMVectorMultiply(XMVectorSubtract(scaleMax, scaleMin), levels));
+
+		//Each channel: quantize every key, pick the keys to keep using the decoded values, then store them
+		//vectors is null for the rotation channel
+		auto addChannel = [&](Channel& channel, std::vector<uint16_t>& values, const std::vector<XMFLOAT3>* vectors, const XMFLOAT3& minimum, const XMFLOAT3& scale, float tolerance)
+		{
+			const bool rotation = vectors == nullptr;
+			source.resize(count);
+			decoded.resize(count);
+			std::vector<uint16_t> encoded(count * 3);
+			for (uint32_t k = 0; k < count; k++)
+			{
+				uint16_t* word = &encoded[k * 3];
+				if (rotation)
+				{
+					source[k] = clip.keyRotations[first + k];
+					EncodeRotation(source[k], word);
+					XMStoreFloat4(&decoded[k], DecodeRotation(word));
+				}
+				else
+				{
+					const XMFLOAT3& value = (*vectors)[first + k];
+					source[k] = XMFLOAT4(value.x, value.y, value.z, 0.0f);
+					word[0] = Quantize(value.x, minimum.x, scale.x, QUANTIZE_16);
+					word[1] = Quantize(value.y, minimum.y, scale.y, QUANTIZE_16);
+					word[2] = Quantize(value.z, minimum.z, scale.z, QUANTIZE_16);
+					XMStoreFloat4(&decoded[k], DecodeVector(word, minimum, scale));
+				}
+			}
+
+			const std::vector<uint32_t> kept = ReduceKeys(times, source, decoded, rotation, tolerance);
+			channel.firstTime = static_cast<uint32_t>(this->keyTimes.size());
+			channel.firstValue = static_cast<uint32_t>(values.size() / 3);
+			channel.keyCount = static_cast<uint32_t>(kept.size());
+			for (uint32_t k : kept)
+			{
+				this->keyTimes.push_back(Quantize(times[k], this->startTime, timeScale, QUANTIZE_16));
+				values.insert(values.end(), &encoded[k * 3], &encoded[k * 3] + 3);
+			}
+		};
+
+		const XMFLOAT3 unused(0.0f, 0.0f, 0.0f);
+		addChannel(track.rotation, this->rotations, nullptr, unused, unused, settings.rotationTolerance);
+		addChannel(track.translation, this->translations, &clip.keyTranslations, track.translationMin, track.translationScale, settings.translationTolerance);
+		addChannel(track.scale, this->scales, &clip.keyScales, track.scaleMin, track.scaleScale, settings.scaleTolerance);
+		this->tracks.push_back(track);
+	}
+	return true;
+}
+
+uint32_t CompressedAnimationClip::FindKeys(const Channel& channel, float time, uint32_t& key1, float& t) const
+{
+	t = 0.0f;
+	const float duration = this->endTime - this->startTime;
+	const float quantizedTime = duration > 0.0f ? (time - this->startTime) * (QUANTIZE_16 / duration) : 0.0f;
+
+	const uint16_t* times = this->keyTimes.data() + channel.firstTime;
+	uint32_t low = 0, high = channel.keyCount;
+	while (low < high)
+	{
+		const uint32_t middle = (low + high) / 2;
+		if (times[middle] <= quantizedTime)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if (low == 0)
+	{
+		key1 = 0;
+		return 0;
+	}
+	if (low == channel.keyCount)
+	{
+		key1 = channel.keyCount - 1;
+		return key1;
+	}
+
+	key1 = low;
+	const float span = static_cast<float>(times[low] - times[low - 1]);
+	t = (quantizedTime - times[low - 1]) / span;
+	return low - 1;
+}
+
+void CompressedAnimationClip::Sample(float time, AnimationPose& pose) const
+{
+	const size_t boneCount = pose.rotations.size();
+	for (const Track& track : this->tracks)
+	{
+		if (track.boneIndex >= boneCount)
+			continue;
+
+		uint32_t key0, key1;
+		float t;
+
+		key0 = this->FindKeys(track.rotation, time, key1, t);
+		const uint16_t* rotation = &this->rotations[track.rotation.firstValue * 3];
+		XMStoreFloat4(&pose.rotations[track.boneIndex], InterpolateRotation(DecodeRotation(rotation + key0 * 3), DecodeRotation(rotation + key1 * 3), t));
+
+		key0 = this->FindKeys(track.translation, time, key1, t);
+		const uint16_t* translation = &this->translations[track.translation.firstValue * 3];
+		XMStoreFloat3(&pose.translations[track.boneIndex], XMVectorLerp(DecodeVector(translation + key0 * 3, track.translationMin, track.translationScale),
+			DecodeVector(translation + key1 * 3, track.translationMin, track.translationScale), t));
+
+		key0 = this->FindKeys(track.scale, time, key1, t);
+		const uint16_t* scale = &this->scales[track.scale.firstValue * 3];
+		XMStoreFloat3(&pose.scales[track.boneIndex], XMVectorLerp(DecodeVector(scale + key0 * 3, track.scaleMin, track.scaleScale),
+			DecodeVector(scale + key1 * 3, track.scaleMin, track.scaleScale), t));
+	}
+}
+
+const std::wstring& CompressedAnimationClip::GetName() const
+{
+	return this->name;
+}
+
+float CompressedAnimationClip::GetStartTime() const
+{
+	return this->startTime;
+}
+
+float CompressedAnimationClip::GetEndTime() const
+{
+	return this->endTime;
+}
+
+size_t CompressedAnimationClip::GetSizeInBytes() const
+{
+	return sizeof(CompressedAnimationClip)
+		+ this->name.size() * sizeof(wchar_t)
+		+ this->tracks.size() * sizeof(Track)
+		+ (this->keyTimes.size() + this->rotations.size() + this->translations.size() + this->scales.size()) * sizeof(uint16_t);
+}
+
+AnimationCompressionReport CompressedAnimationClip::Measure(const AnimationRig& rig, const DirectX::ModelAnimationClip& source, const CompressedAnimationClip& compressed, const AnimationCompressionSettings& settings)
+{
+	AnimationCompressionReport report;
+	report.sourceKeys = source.keyTimes.size();
+	for (const Track& track : compressed.tracks)
+	{
+		report.keptRotationKeys += track.rotation.keyCount;
+		report.keptTranslationKeys += track.translation.keyCount;
+		report.keptScaleKeys += track.scale.keyCount;
+	}
+	report.cmoBytes = report.sourceKeys * CMO_KEYFRAME_SIZE;
+	report.decomposedBytes = source.tracks.size() * sizeof(ModelAnimationClip::Track)
+		+ report.sourceKeys * (sizeof(float) + sizeof(XMFLOAT4) + 2 * sizeof(XMFLOAT3));
+	report.compressedBytes = compressed.GetSizeInBytes();
+	report.compressionRatio = report.compressedBytes > 0 ? static_cast<float>(report.cmoBytes) / report.compressedBytes : 0.0f;
+
+	//Every time at which the source has a key is where the two can differ the most
+	std::vector<float> times(source.keyTimes);
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	const uint32_t boneCount = rig.GetBoneCount();
+	std::vector<XMFLOAT4X4> sourceTransforms(boneCount), compressedTransforms(boneCount);
+	AnimationPose sourcePose, compressedPose;
+	const float d = settings.virtualVertexDistance;
+	const XMVECTOR vertices[4] = { XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(d, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, d, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, d, 1.0f) };
+	for (float time : times)
+	{
+		sourcePose = rig.GetBindPose();
+		compressedPose = rig.GetBindPose();
+		rig.SampleClip(source, time, sourcePose);
+		compressed.Sample(time, compressedPose);
+		rig.ComputeModelTransforms(sourcePose, sourceTransforms.data());
+		rig.ComputeModelTransforms(compressedPose, compressedTransforms.data());
+
+		for (uint32_t bone = 0; bone < boneCount; bone++)
+		{
+			const XMMATRIX a = XMLoadFloat4x4(&sourceTransforms[bone]);
+			const XMMATRIX b = XMLoadFloat4x4(&compressedTransforms[bone]);
+			for (const XMVECTOR& vertex : vertices)
+			{
+				const float error = VectorError(XMVector4Transform(vertex, a), XMVector4Transform(vertex, b));
+				if (error > report.maxBoneError)
+				{
+					report.maxBoneError = error;
+					report.maxErrorBone = bone;
+					report.maxErrorTime = time;
+				}
+			}
+		}
+	}
+	return report;
+}
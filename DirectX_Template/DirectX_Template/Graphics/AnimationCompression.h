@@ -0,0 +1,80 @@
+#pragma once
+#include "Animation.h"
+#include <string>
+
+struct AnimationCompressionSettings
+{
+	float rotationTolerance = 0.001f;		//Radians
+	float translationTolerance = 0.0005f;	//Model units
+	float scaleTolerance = 0.0005f;
+	float virtualVertexDistance = 1.0f;		//Distance from each bone at which the report measures error
+};
+
+struct AnimationCompressionReport
+{
+	size_t sourceKeys = 0;
+	size_t keptRotationKeys = 0;
+	size_t keptTranslationKeys = 0;
+	size_t keptScaleKeys = 0;
+	size_t cmoBytes = 0;			//Size of the keyframes as stored in the CMO file
+	size_t decomposedBytes = 0;		//Size of the uncompressed ModelAnimationClip key data
+	size_t compressedBytes = 0;
+	float compressionRatio = 0.0f;	//cmoBytes / compressedBytes
+	float maxBoneError = 0.0f;		//Largest model space distance between source and compressed virtual vertices
+	uint32_t maxErrorBone = 0;
+	float maxErrorTime = 0.0f;
+};
+
+//Compressed form of a ModelAnimationClip. Every track keeps separate rotation, translation and
+//scale channels, and each channel only keeps the keys that linear interpolation cannot rebuild
+//within the tolerance. Rotations are stored smallest-three (three 15 bit components plus the
+//index of the dropped one), translations and scales as 16 bit values in the track's range and
+//key times as 16 bit fractions of the clip duration.
+class CompressedAnimationClip
+{
+public:
+	bool Compress(const DirectX::ModelAnimationClip& clip, const AnimationCompressionSettings& settings = AnimationCompressionSettings());
+
+	//Same contract as AnimationRig::SampleClip: only the bones with a track are written
+	void Sample(float time, AnimationPose& pose) const;
+
+	const std::wstring& GetName() const;
+	float GetStartTime() const;
+	float GetEndTime() const;
+	size_t GetSizeInBytes() const;
+
+	//Samples both clips at every source key time and compares virtual vertices in model space
+	static AnimationCompressionReport Measure(const AnimationRig& rig, const DirectX::ModelAnimationClip& source, const CompressedAnimationClip& compressed, const AnimationCompressionSettings& settings = AnimationCompressionSettings());
+
+private:
+	struct Channel
+	{
+		uint32_t firstTime = 0;		//Into keyTimes
+		uint32_t firstValue = 0;	//Key index into the channel's value array
+		uint32_t keyCount = 0;
+	};
+
+	struct Track
+	{
+		uint32_t boneIndex = 0;
+		Channel rotation;
+		Channel translation;
+		Channel scale;
+		XMFLOAT3 translationMin;
+		XMFLOAT3 translationScale;	//Range / 65535
+		XMFLOAT3 scaleMin;
+		XMFLOAT3 scaleScale;
+	};
+
+	//Finds the pair of keys around time, returns the first and sets key1 and the blend factor between them
+	uint32_t FindKeys(const Channel& channel, float time, uint32_t& key1, float& t) const;
+
+	std::wstring name;
+	float startTime = 0.0f;
+	float endTime = 0.0f;
+	std::vector<Track> tracks;
+	std::vector<uint16_t> keyTimes;
+	std::vector<uint16_t> rotations;		//3 per key
+	std::vector<uint16_t> translations;		//3 per key
+	std::vector<uint16_t> scales;			//3 per key
+};
@@ -0,0 +1,713 @@
+#include "BVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	const int SAH_BIN_COUNT = 16;
+
+	inline uint32_t XM_CALLCONV MoveMask(FXMVECTOR v)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		return static_cast<uint32_t>(_mm_movemask_ps(v));
+#else
+		XMUINT4 m;
+		XMStoreUInt4(&m, v);
+		return (m.x >> 31) | ((m.y >> 31) << 1) | ((m.z >> 31) << 2) | ((m.w >> 31) << 3);
+#endif
+	}
+
+	inline float SurfaceArea(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		const float dx = max.x - min.x;
+		const float dy = max.y - min.y;
+		const float dz = max.z - min.z;
+		if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+			return 0.0f;
+		return 2.0f * (dx * dy + dy * dz + dz * dx);
+	}
+
+	inline void Grow(XMFLOAT3& min, XMFLOAT3& max, const XMFLOAT3& otherMin, const XMFLOAT3& otherMax)
+	{
+		min.x = std::min(min.x, otherMin.x);
+		min.y = std::min(min.y, otherMin.y);
+		min.z = std::min(min.z, otherMin.z);
+		max.x = std::max(max.x, otherMax.x);
+		max.y = std::max(max.y, otherMax.y);
+		max.z = std::max(max.z, otherMax.z);
+	}
+
+	inline float Component(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	struct FrustumPlanes
+	{
+		XMVECTOR a[6];
+		XMVECTOR b[6];
+		XMVECTOR c[6];
+		XMVECTOR d[6];
+		XMVECTOR absA[6];
+		XMVECTOR absB[6];
+		XMVECTOR absC[6];
+	};
+
+	//DirectXCollision planes point outwards: a box is outside when its nearest point is in front of any plane
+	void LoadFrustumPlanes(const BoundingFrustum& frustum, FrustumPlanes& planes)
+	{
+		XMVECTOR p[6];
+		frustum.GetPlanes(&p[0], &p[1], &p[2], &p[3], &p[4], &p[5]);
+		for (int i = 0; i < 6; i++)
+		{
+			planes.a[i] = XMVectorSplatX(p[i]);
+			planes.b[i] = XMVectorSplatY(p[i]);
+			planes.c[i] = XMVectorSplatZ(p[i]);
+			planes.d[i] = XMVectorSplatW(p[i]);
+			planes.absA[i] = XMVectorAbs(planes.a[i]);
+			planes.absB[i] = XMVectorAbs(planes.b[i]);
+			planes.absC[i] = XMVectorAbs(planes.c[i]);
+		}
+	}
+
+	//Returns masks of boxes that are outside of, and fully inside, the frustum
+	inline void XM_CALLCONV TestFrustum4(const FrustumPlanes& planes, FXMVECTOR minX, FXMVECTOR minY, FXMVECTOR minZ, GXMVECTOR maxX, HXMVECTOR maxY, HXMVECTOR maxZ, uint32_t& outside, uint32_t& inside)
+	{
+		const XMVECTOR half = XMVectorReplicate(0.5f);
+		const XMVECTOR cx = XMVectorMultiply(XMVectorAdd(minX, maxX), half);
+		const XMVECTOR cy = XMVectorMultiply(XMVectorAdd(minY, maxY), half);
+		const XMVECTOR cz = XMVectorMultiply(XMVectorAdd(minZ, maxZ), half);
+		const XMVECTOR ex = XMVectorMultiply(XMVectorSubtract(maxX, minX), half);
+		const XMVECTOR ey = XMVectorMultiply(XMVectorSubtract(maxY, minY), half);
+		const XMVECTOR ez = XMVectorMultiply(XMVectorSubtract(maxZ, minZ), half);
+
+		XMVECTOR anyOutside = XMVectorFalseInt();
+		XMVECTOR anyIntersect = XMVectorFalseInt();
+		for (int i = 0; i < 6; i++)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(planes.a[i], cx, planes.d[i]);
+			distance = XMVectorMultiplyAdd(planes.b[i], cy, distance);
+			distance = XMVectorMultiplyAdd(planes.c[i], cz, distance);
+
+			XMVECTOR radius = XMVectorMultiply(planes.absA[i], ex);
+			radius = XMVectorMultiplyAdd(planes.absB[i], ey, radius);
+			radius = XMVectorMultiplyAdd(planes.absC[i], ez, radius);
+
+			anyOutside = XMVectorOrInt(anyOutside, XMVectorGreater(distance, radius));
+			anyIntersect = XMVectorOrInt(anyIntersect, XMVectorGreater(distance, XMVectorNegate(radius)));
+		}
+
+		outside = MoveMask(anyOutside);
+		inside = ~MoveMask(anyIntersect) & 0xF;
+	}
+
+	inline uint32_t ValidMask(const uint32_t child[4])
+	{
+		uint32_t mask = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (child[i] != BVH::INVALID_INDEX)
+				mask |= 1u << i;
+		}
+		return mask;
+	}
+}
+
+const uint32_t BVH::INVALID_INDEX;
+const uint32_t BVH::MAX_LEAF_SIZE;
+
+void BVH::Build(const BoundingBox* bounds, uint32_t objectCount)
+{
+	this->Clear();
+	if (bounds == nullptr || objectCount == 0)
+		return;
+
+	this->objectBounds.resize(objectCount);
+	this->centroids.resize(objectCount);
+	this->primIndices.resize(objectCount);
+	this->objectNode.resize(objectCount, INVALID_INDEX);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		const XMVECTOR center = XMLoadFloat3(&bounds[i].Center);
+		const XMVECTOR extents = XMLoadFloat3(&bounds[i].Extents);
+		XMStoreFloat3(&this->objectBounds[i].min, XMVectorSubtract(center, extents));
+		XMStoreFloat3(&this->objectBounds[i].max, XMVectorAdd(center, extents));
+		this->centroids[i] = bounds[i].Center;
+		this->primIndices[i] = i;
+	}
+
+	this->nodes.reserve(objectCount / 2 + 1);
+	this->root = this->AllocateNode();
+	this->BuildNode(this->root, 0, objectCount, INVALID_INDEX);
+	this->stats.nodeCount = this->nodes.size() - this->freeNodes.size();
+}
+
+void BVH::Clear()
+{
+	this->nodes.clear();
+	this->freeNodes.clear();
+	this->objectBounds.clear();
+	this->primIndices.clear();
+	this->objectNode.clear();
+	this->centroids.clear();
+	this->root = INVALID_INDEX;
+	this->maxDepth = 0;
+	this->stats = BVHStats();
+}
+
+uint32_t BVH::AllocateNode()
+{
+	if (!this->freeNodes.empty())
+	{
+		uint32_t index = this->freeNodes.back();
+		this->freeNodes.pop_back();
+		this->nodes[index] = Node();
+		return index;
+	}
+	this->nodes.push_back(Node());
+	return static_cast<uint32_t>(this->nodes.size() - 1);
+}
+
+void BVH::FreeSubtree(uint32_t nodeIndex)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		const Node& node = this->nodes[nodeIndex];
+		if (node.child[i] != INVALID_INDEX && node.count[i] == 0)
+		{
+			uint32_t child = node.child[i];
+			this->FreeSubtree(child);
+			this->freeNodes.push_back(child);
+		}
+	}
+}
+
+BVH::AABB BVH::RangeBounds(uint32_t first, uint32_t count) const
+{
+	AABB result = { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const AABB& bounds = this->objectBounds[this->primIndices[i]];
+		Grow(result.min, result.max, bounds.min, bounds.max);
+	}
+	return result;
+}
+
+BVH::AABB BVH::NodeBounds(const Node& node) const
+{
+	AABB result = { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+	for (int i = 0; i < 4; i++)
+	{
+		if (node.child[i] == INVALID_INDEX)
+			continue;
+		Grow(result.min, result.max, XMFLOAT3(node.minX[i], node.minY[i], node.minZ[i]), XMFLOAT3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+	}
+	return result;
+}
+
+void BVH::SetSlot(Node& node, int slot, const AABB& bounds) const
+{
+	node.minX[slot] = bounds.min.x;
+	node.minY[slot] = bounds.min.y;
+	node.minZ[slot] = bounds.min.z;
+	node.maxX[slot] = bounds.max.x;
+	node.maxY[slot] = bounds.max.y;
+	node.maxZ[slot] = bounds.max.z;
+}
+
+uint32_t BVH::SplitRange(uint32_t first, uint32_t count)
+{
+	//Binned SAH along the axis with the widest centroid spread. Returns the size of the left half.
+	XMFLOAT3 cmin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 cmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const XMFLOAT3& c = this->centroids[this->primIndices[i]];
+		Grow(cmin, cmax, c, c);
+	}
+
+	int axis = 0;
+	float extent = cmax.x - cmin.x;
+	if (cmax.y - cmin.y > extent) { axis = 1; extent = cmax.y - cmin.y; }
+	if (cmax.z - cmin.z > extent) { axis = 2; extent = cmax.z - cmin.z; }
+
+	if (extent <= 0.0f)
+		return count / 2;
+
+	struct Bin
+	{
+		XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		uint32_t count = 0;
+	};
+	Bin bins[SAH_BIN_COUNT];
+
+	const float axisMin = Component(cmin, axis);
+	const float scale = static_cast<float>(SAH_BIN_COUNT) * 0.9999f / extent;
+	auto binOf = [&](uint32_t object)
+	{
+		return std::min(static_cast<int>((Component(this->centroids[object], axis) - axisMin) * scale), SAH_BIN_COUNT - 1);
+	};
+
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const uint32_t object = this->primIndices[i];
+		Bin& bin = bins[binOf(object)];
+		Grow(bin.min, bin.max, this->objectBounds[object].min, this->objectBounds[object].max);
+		bin.count += 1;
+	}
+
+	//Sweep from the right to get suffix areas, then from the left to evaluate each split plane
+	float rightArea[SAH_BIN_COUNT];
+	uint32_t rightCount[SAH_BIN_COUNT];
+	XMFLOAT3 rmin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 rmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	uint32_t accumulated = 0;
+	for (int i = SAH_BIN_COUNT - 1; i > 0; i--)
+	{
+		Grow(rmin, rmax, bins[i].min, bins[i].max);
+		accumulated += bins[i].count;
+		rightArea[i] = SurfaceArea(rmin, rmax);
+		rightCount[i] = accumulated;
+	}
+
+	XMFLOAT3 lmin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 lmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	uint32_t leftCount = 0;
+	float bestCost = FLT_MAX;
+	int bestSplit = -1;
+	for (int i = 0; i < SAH_BIN_COUNT - 1; i++)
+	{
+		Grow(lmin, lmax, bins[i].min, bins[i].max);
+		leftCount += bins[i].count;
+		if (leftCount == 0 || rightCount[i + 1] == 0)
+			continue;
+		const float cost = SurfaceArea(lmin, lmax) * leftCount + rightArea[i + 1] * rightCount[i + 1];
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = i;
+		}
+	}
+
+	if (bestSplit < 0)
+		return count / 2;
+
+	uint32_t* begin = this->primIndices.data() + first;
+	uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t object) { return binOf(object) <= bestSplit; });
+	return static_cast<uint32_t>(middle - begin);
+}
+
+void BVH::BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t parent)
+{
+	//Split the range twice with SAH so each node gets up to four children
+	uint32_t rangeFirst[4] = { first, 0, 0, 0 };
+	uint32_t rangeCount[4] = { count, 0, 0, 0 };
+	int ranges = 1;
+	while (ranges < 4)
+	{
+		int largest = -1;
+		for (int i = 0; i < ranges; i++)
+		{
+			if (rangeCount[i] > MAX_LEAF_SIZE && (largest < 0 || rangeCount[i] > rangeCount[largest]))
+				largest = i;
+		}
+		if (largest < 0)
+			break;
+
+		uint32_t leftCount = this->SplitRange(rangeFirst[largest], rangeCount[largest]);
+		if (leftCount == 0 || leftCount == rangeCount[largest])
+			leftCount = rangeCount[largest] / 2;
+
+		rangeFirst[ranges] = rangeFirst[largest] + leftCount;
+		rangeCount[ranges] = rangeCount[largest] - leftCount;
+		rangeCount[largest] = leftCount;
+		ranges++;
+	}
+
+	{
+		Node& node = this->nodes[nodeIndex];
+		node.parent = parent;
+		node.depth = parent == INVALID_INDEX ? 0 : this->nodes[parent].depth + 1;
+		this->maxDepth = std::max(this->maxDepth, node.depth);
+		node.primFirst = first;
+		node.primCount = count;
+		node.dirty = false;
+		for (int i = 0; i < 4; i++)
+		{
+			node.child[i] = INVALID_INDEX;
+			node.count[i] = 0;
+			SetSlot(node, i, { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX) });
+		}
+	}
+
+	for (int i = 0; i < ranges; i++)
+	{
+		const AABB bounds = this->RangeBounds(rangeFirst[i], rangeCount[i]);
+		if (rangeCount[i] <= MAX_LEAF_SIZE)
+		{
+			Node& node = this->nodes[nodeIndex];
+			node.child[i] = rangeFirst[i];
+			node.count[i] = rangeCount[i];
+			SetSlot(node, i, bounds);
+			for (uint32_t p = rangeFirst[i]; p < rangeFirst[i] + rangeCount[i]; p++)
+			{
+				this->objectNode[this->primIndices[p]] = nodeIndex;
+			}
+			continue;
+		}
+
+		//AllocateNode may grow the node array, so the parent is looked up again afterwards
+		const uint32_t childIndex = this->AllocateNode();
+		this->BuildNode(childIndex, rangeFirst[i], rangeCount[i], nodeIndex);
+		Node& node = this->nodes[nodeIndex];
+		node.child[i] = childIndex;
+		node.count[i] = 0;
+		SetSlot(node, i, bounds);
+	}
+
+	Node& node = this->nodes[nodeIndex];
+	const AABB bounds = this->NodeBounds(node);
+	node.buildArea = SurfaceArea(bounds.min, bounds.max);
+}
+
+void BVH::UpdateObject(uint32_t object, const BoundingBox& bounds)
+{
+	if (object >= this->objectBounds.size())
+		return;
+
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	const XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+	XMStoreFloat3(&this->objectBounds[object].min, XMVectorSubtract(center, extents));
+	XMStoreFloat3(&this->objectBounds[object].max, XMVectorAdd(center, extents));
+	this->centroids[object] = bounds.Center;
+
+	//Mark the path to the root, stopping at the first node that is already dirty
+	uint32_t nodeIndex = this->objectNode[object];
+	while (nodeIndex != INVALID_INDEX && !this->nodes[nodeIndex].dirty)
+	{
+		this->nodes[nodeIndex].dirty = true;
+		nodeIndex = this->nodes[nodeIndex].parent;
+	}
+}
+
+void BVH::RefitNode(uint32_t nodeIndex, uint32_t& candidate, float& candidateRatio)
+{
+	if (!this->nodes[nodeIndex].dirty)
+		return;
+
+	for (int i = 0; i < 4; i++)
+	{
+		const Node& node = this->nodes[nodeIndex];
+		if (node.child[i] == INVALID_INDEX)
+			continue;
+
+		if (node.count[i] > 0)
+		{
+			const AABB bounds = this->RangeBounds(node.child[i], node.count[i]);
+			SetSlot(this->nodes[nodeIndex], i, bounds);
+		}
+		else
+		{
+			const uint32_t child = node.child[i];
+			this->RefitNode(child, candidate, candidateRatio);
+			const AABB bounds = this->NodeBounds(this->nodes[child]);
+			SetSlot(this->nodes[nodeIndex], i, bounds);
+		}
+	}
+
+	Node& node = this->nodes[nodeIndex];
+	node.dirty = false;
+	this->stats.nodesRefit += 1;
+
+	const AABB bounds = this->NodeBounds(node);
+	const float ratio = SurfaceArea(bounds.min, bounds.max) / std::max(node.buildArea, FLT_MIN);
+	if (ratio > this->rebuildThreshold && ratio > candidateRatio)
+	{
+		candidate = nodeIndex;
+		candidateRatio = ratio;
+	}
+}
+
+void BVH::Refit()
+{
+	if (this->root == INVALID_INDEX)
+		return;
+
+	this->stats.nodesRefit = 0;
+	this->stats.subtreesRebuilt = 0;
+
+	uint32_t candidate = INVALID_INDEX;
+	float candidateRatio = 0.0f;
+	this->RefitNode(this->root, candidate, candidateRatio);
+
+	//Partial rebuild of the most degraded subtree. Its primitives occupy a contiguous range of
+	//primIndices, so it is rebuilt in place and its parent slot bounds stay valid.
+	if (candidate != INVALID_INDEX)
+	{
+		this->FreeSubtree(candidate);
+		const Node& node = this->nodes[candidate];
+		this->BuildNode(candidate, node.primFirst, node.primCount, node.parent);
+		this->stats.subtreesRebuilt += 1;
+		this->stats.nodeCount = this->nodes.size() - this->freeNodes.size();
+	}
+}
+
+void BVH::SetRebuildThreshold(float areaRatio)
+{
+	this->rebuildThreshold = areaRatio;
+}
+
+void BVH::QueryFrustum(const BoundingFrustum& frustum, std::vector<uint32_t>& results, size_t* nodesVisited) const
+{
+	if (this->root == INVALID_INDEX)
+		return;
+
+	FrustumPlanes planes;
+	LoadFrustumPlanes(frustum, planes);
+
+	TraversalStack<uint32_t> stack(this->maxDepth);
+	stack.Push(this->root);
+
+	size_t visited = 0;
+	while (!stack.Empty())
+	{
+		const Node& node = this->nodes[stack.Pop()];
+		visited += 1;
+
+		uint32_t outside, inside;
+		TestFrustum4(planes,
+			XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minX)),
+			XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minY)),
+			XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minZ)),
+			XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxX)),
+			XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxY)),
+			XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxZ)),
+			outside, inside);
+
+		const uint32_t mask = ValidMask(node.child) & ~outside;
+		for (int i = 0; i < 4; i++)
+		{
+			if ((mask & (1u << i)) == 0)
+				continue;
+
+			if ((inside & (1u << i)) != 0)
+			{
+				//Fully inside: every primitive below this slot is visible
+				const uint32_t first = node.count[i] > 0 ? node.child[i] : this->nodes[node.child[i]].primFirst;
+				const uint32_t count = node.count[i] > 0 ? node.count[i] : this->nodes[node.child[i]].primCount;
+				results.insert(results.end(), this->primIndices.begin() + first, this->primIndices.begin() + first + count);
+			}
+			else if (node.count[i] == 0)
+			{
+				stack.Push(node.child[i]);
+			}
+			else
+			{
+				for (uint32_t p = node.child[i]; p < node.child[i] + node.count[i]; p++)
+				{
+					const uint32_t object = this->primIndices[p];
+					const AABB& bounds = this->objectBounds[object];
+					uint32_t objectOutside, objectInside;
+					TestFrustum4(planes,
+						XMVectorReplicate(bounds.min.x), XMVectorReplicate(bounds.min.y), XMVectorReplicate(bounds.min.z),
+						XMVectorReplicate(bounds.max.x), XMVectorReplicate(bounds.max.y), XMVectorReplicate(bounds.max.z),
+						objectOutside, objectInside);
+					if (objectOutside == 0)
+						results.push_back(object);
+				}
+			}
+		}
+	}
+
+	if (nodesVisited)
+		*nodesVisited += visited;
+}
+
+void BVH::QueryAABB(const BoundingBox& box, std::vector<uint32_t>& results, size_t* nodesVisited) const
+{
+	if (this->root == INVALID_INDEX)
+		return;
+
+	XMFLOAT3 queryMin, queryMax;
+	XMStoreFloat3(&queryMin, XMVectorSubtract(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+	XMStoreFloat3(&queryMax, XMVectorAdd(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)));
+
+	const XMVECTOR qminX = XMVectorReplicate(queryMin.x);
+	const XMVECTOR qminY = XMVectorReplicate(queryMin.y);
+	const XMVECTOR qminZ = XMVectorReplicate(queryMin.z);
+	const XMVECTOR qmaxX = XMVectorReplicate(queryMax.x);
+	const XMVECTOR qmaxY = XMVectorReplicate(queryMax.y);
+	const XMVECTOR qmaxZ = XMVectorReplicate(queryMax.z);
+
+	TraversalStack<uint32_t> stack(this->maxDepth);
+	stack.Push(this->root);
+
+	size_t visited = 0;
+	while (!stack.Empty())
+	{
+		const Node& node = this->nodes[stack.Pop()];
+		visited += 1;
+
+		XMVECTOR overlap = XMVectorLessOrEqual(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minX)), qmaxX);
+		overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minY)), qmaxY));
+		overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minZ)), qmaxZ));
+		overlap = XMVectorAndInt(overlap, XMVectorGreaterOrEqual(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxX)), qminX));
+		overlap = XMVectorAndInt(overlap, XMVectorGreaterOrEqual(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxY)), qminY));
+		overlap = XMVectorAndInt(overlap, XMVectorGreaterOrEqual(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxZ)), qminZ));
+
+		const uint32_t mask = ValidMask(node.child) & MoveMask(overlap);
+		for (int i = 0; i < 4; i++)
+		{
+			if ((mask & (1u << i)) == 0)
+				continue;
+
+			if (node.count[i] == 0)
+			{
+				stack.Push(node.child[i]);
+				continue;
+			}
+
+			for (uint32_t p = node.child[i]; p < node.child[i] + node.count[i]; p++)
+			{
+				const uint32_t object = this->primIndices[p];
+				const AABB& bounds = this->objectBounds[object];
+				if (bounds.min.x <= queryMax.x && bounds.max.x >= queryMin.x &&
+					bounds.min.y <= queryMax.y && bounds.max.y >= queryMin.y &&
+					bounds.min.z <= queryMax.z && bounds.max.z >= queryMin.z)
+				{
+					results.push_back(object);
+				}
+			}
+		}
+	}
+
+	if (nodesVisited)
+		*nodesVisited += visited;
+}
+
+BVH::RayData BVH::MakeRayData(const SimpleMath::Ray& ray) const
+{
+	//Clamp tiny direction components so the slab test never multiplies 0 by infinity
+	const float epsilon = 1e-20f;
+	XMFLOAT3 invDirection;
+	invDirection.x = 1.0f / (std::fabs(ray.direction.x) > epsilon ? ray.direction.x : std::copysign(epsilon, ray.direction.x));
+	invDirection.y = 1.0f / (std::fabs(ray.direction.y) > epsilon ? ray.direction.y : std::copysign(epsilon, ray.direction.y));
+	invDirection.z = 1.0f / (std::fabs(ray.direction.z) > epsilon ? ray.direction.z : std::copysign(epsilon, ray.direction.z));
+
+	RayData data;
+	data.originScalar = ray.position;
+	data.invDirectionScalar = invDirection;
+	data.origin[0] = XMVectorReplicate(ray.position.x);
+	data.origin[1] = XMVectorReplicate(ray.position.y);
+	data.origin[2] = XMVectorReplicate(ray.position.z);
+	data.invDirection[0] = XMVectorReplicate(invDirection.x);
+	data.invDirection[1] = XMVectorReplicate(invDirection.y);
+	data.invDirection[2] = XMVectorReplicate(invDirection.z);
+	return data;
+}
+
+uint32_t BVH::IntersectRayNode(const Node& node, const RayData& ray, float maxDistance, float entry[4]) const
+{
+	const XMVECTOR t0x = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minX)), ray.origin[0]), ray.invDirection[0]);
+	const XMVECTOR t1x = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxX)), ray.origin[0]), ray.invDirection[0]);
+	const XMVECTOR t0y = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minY)), ray.origin[1]), ray.invDirection[1]);
+	const XMVECTOR t1y = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxY)), ray.origin[1]), ray.invDirection[1]);
+	const XMVECTOR t0z = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.minZ)), ray.origin[2]), ray.invDirection[2]);
+	const XMVECTOR t1z = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(node.maxZ)), ray.origin[2]), ray.invDirection[2]);
+
+	XMVECTOR tEnter = XMVectorMax(XMVectorMax(XMVectorMin(t0x, t1x), XMVectorMin(t0y, t1y)), XMVectorMax(XMVectorMin(t0z, t1z), XMVectorZero()));
+	XMVECTOR tExit = XMVectorMin(XMVectorMin(XMVectorMax(t0x, t1x), XMVectorMax(t0y, t1y)), XMVectorMin(XMVectorMax(t0z, t1z), XMVectorReplicate(maxDistance)));
+
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(entry), tEnter);
+	return ValidMask(node.child) & MoveMask(XMVectorLessOrEqual(tEnter, tExit));
+}
+
+bool BVH::IntersectRayObject(uint32_t object, const RayData& ray, float maxDistance, float& entry) const
+{
+	const AABB& bounds = this->objectBounds[object];
+
+	float t0 = (bounds.min.x - ray.originScalar.x) * ray.invDirectionScalar.x;
+	float t1 = (bounds.max.x - ray.originScalar.x) * ray.invDirectionScalar.x;
+	float tEnter = std::min(t0, t1);
+	float tExit = std::max(t0, t1);
+
+	t0 = (bounds.min.y - ray.originScalar.y) * ray.invDirectionScalar.y;
+	t1 = (bounds.max.y - ray.originScalar.y) * ray.invDirectionScalar.y;
+	tEnter = std::max(tEnter, std::min(t0, t1));
+	tExit = std::min(tExit, std::max(t0, t1));
+
+	t0 = (bounds.min.z - ray.originScalar.z) * ray.invDirectionScalar.z;
+	t1 = (bounds.max.z - ray.originScalar.z) * ray.invDirectionScalar.z;
+	tEnter = std::max(tEnter, std::min(t0, t1));
+	tExit = std::min(tExit, std::max(t0, t1));
+
+	tEnter = std::max(tEnter, 0.0f);
+	tExit = std::min(tExit, maxDistance);
+	entry = tEnter;
+	return tEnter <= tExit;
+}
+
+void BVH::QueryRay(const SimpleMath::Ray& ray, float maxDistance, std::vector<BVHRayHit>& results, size_t* nodesVisited) const
+{
+	if (this->root == INVALID_INDEX)
+		return;
+
+	const RayData rayData = this->MakeRayData(ray);
+	const size_t firstResult = results.size();
+
+	TraversalStack<uint32_t> stack(this->maxDepth);
+	stack.Push(this->root);
+
+	size_t visited = 0;
+	while (!stack.Empty())
+	{
+		const Node& node = this->nodes[stack.Pop()];
+		visited += 1;
+
+		float entry[4];
+		const uint32_t mask = this->IntersectRayNode(node, rayData, maxDistance, entry);
+		for (int i = 0; i < 4; i++)
+		{
+			if ((mask & (1u << i)) == 0)
+				continue;
+
+			if (node.count[i] == 0)
+			{
+				stack.Push(node.child[i]);
+				continue;
+			}
+
+			for (uint32_t p = node.child[i]; p < node.child[i] + node.count[i]; p++)
+			{
+				BVHRayHit hit;
+				hit.object = this->primIndices[p];
+				if (this->IntersectRayObject(hit.object, rayData, maxDistance, hit.distance))
+					results.push_back(hit);
+			}
+		}
+	}
+
+	if (nodesVisited)
+		*nodesVisited += visited;
+
+	std::sort(results.begin() + firstResult, results.end(), [](const BVHRayHit& a, const BVHRayHit& b) { return a.distance < b.distance; });
+}
+
+uint32_t BVH::GetObjectCount() const
+{
+	return static_cast<uint32_t>(this->objectBounds.size());
+}
+
+BoundingBox BVH::GetObjectBounds(uint32_t object) const
+{
+	BoundingBox box;
+	BoundingBox::CreateFromPoints(box, XMLoadFloat3(&this->objectBounds[object].min), XMLoadFloat3(&this->objectBounds[object].max));
+	return box;
+}
+
+const BVHStats& BVH::GetStats() const
+{
+	return this->stats;
+}
@@ -0,0 +1,240 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <SimpleMath.h>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+struct BVHRayHit
+{
+	uint32_t object = 0;
+	float distance = 0.0f;
+};
+
+struct BVHStats
+{
+	size_t nodeCount = 0;
+	size_t nodesRefit = 0;
+	size_t subtreesRebuilt = 0;
+};
+
+//Bounding volume hierarchy over object AABBs. Built top-down with a binned SAH, stored as a
+//4-wide tree (child bounds laid out SoA so one node test covers four boxes with SIMD).
+//Moving objects only refit the dirty path to the root; subtrees whose surface area has grown
+//past the rebuild threshold since they were built are rebuilt in place, one per Refit call.
+//Queries only read the tree, so any number of threads can run them at once between updates.
+//Each query adds the nodes it visited to nodesVisited when one is passed.
+class BVH
+{
+public:
+	static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+	static const uint32_t MAX_LEAF_SIZE = 4;
+
+	void Build(const BoundingBox* bounds, uint32_t objectCount);
+	void Clear();
+
+	void UpdateObject(uint32_t object, const BoundingBox& bounds);
+	void Refit();
+	void SetRebuildThreshold(float areaRatio);
+
+	void QueryFrustum(const BoundingFrustum& frustum, std::vector<uint32_t>& results, size_t* nodesVisited = nullptr) const;
+	void QueryAABB(const BoundingBox& box, std::vector<uint32_t>& results, size_t* nodesVisited = nullptr) const;
+	//Every object whose AABB the ray enters before maxDistance, sorted by entry distance
+	void QueryRay(const SimpleMath::Ray& ray, float maxDistance, std::vector<BVHRayHit>& results, size_t* nodesVisited = nullptr) const;
+
+	//Closest hit traversal, children are visited front to back. intersectObject(object, distance)
+	//performs the exact test for one object and shortens distance when it finds a closer hit.
+	template<typename IntersectFunc>
+	bool Raycast(const SimpleMath::Ray& ray, float& distance, uint32_t& hitObject, IntersectFunc&& intersectObject, size_t* nodesVisited = nullptr) const;
+	//Same traversal, but intersectLeaf(objects, count, distance) receives a whole leaf (up to
+	//MAX_LEAF_SIZE objects) so callers can test its primitives together. Returns true on a closer hit.
+	template<typename IntersectFunc>
+	bool RaycastLeaves(const SimpleMath::Ray& ray, float& distance, IntersectFunc&& intersectLeaf, size_t* nodesVisited = nullptr) const;
+
+	uint32_t GetObjectCount() const;
+	BoundingBox GetObjectBounds(uint32_t object) const;
+	const BVHStats& GetStats() const;
+
+private:
+	struct Node
+	{
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+		uint32_t child[4];			//Node index for internal slots, first primitive for leaf slots
+		uint32_t count[4];			//Primitive count for leaf slots, 0 for internal slots
+		uint32_t parent = INVALID_INDEX;
+		uint32_t primFirst = 0;		//Range of primIndices covered by this subtree
+		uint32_t primCount = 0;
+		uint32_t depth = 0;			//Root is 0
+		float buildArea = 0.0f;
+		bool dirty = false;
+	};
+
+	//Nodes waiting to be visited during a traversal. Visiting a node pushes at most four children
+	//and pops one, so the stack never holds more than three entries per level plus four, and is
+	//sized from the deepest level built. Only unusually deep trees spill out of the local array.
+	template<typename T>
+	class TraversalStack
+	{
+	public:
+		explicit TraversalStack(uint32_t maxDepth) : capacity(3 * maxDepth + 4)
+		{
+			if (this->capacity > LOCAL_CAPACITY)
+			{
+				this->heap.resize(this->capacity);
+				this->entries = this->heap.data();
+			}
+		}
+		TraversalStack(const TraversalStack&) = delete;
+		TraversalStack& operator=(const TraversalStack&) = delete;
+
+		void Push(const T& entry)
+		{
+			assert(this->size < this->capacity);
+			this->entries[this->size++] = entry;
+		}
+		T Pop() { return this->entries[--this->size]; }
+		bool Empty() const { return this->size == 0; }
+
+	private:
+		static const uint32_t LOCAL_CAPACITY = 256;
+		T local[LOCAL_CAPACITY];
+		std::vector<T> heap;
+		T* entries = local;
+		uint32_t capacity;
+		uint32_t size = 0;
+	};
+
+	struct AABB
+	{
+		XMFLOAT3 min;
+		XMFLOAT3 max;
+	};
+
+	struct RayData
+	{
+		XMVECTOR origin[3];
+		XMVECTOR invDirection[3];
+		XMFLOAT3 originScalar;
+		XMFLOAT3 invDirectionScalar;
+	};
+
+	uint32_t AllocateNode();
+	void FreeSubtree(uint32_t nodeIndex);
+	void BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t parent);
+	uint32_t SplitRange(uint32_t first, uint32_t count);
+	AABB RangeBounds(uint32_t first, uint32_t count) const;
+	AABB NodeBounds(const Node& node) const;
+	void SetSlot(Node& node, int slot, const AABB& bounds) const;
+	void RefitNode(uint32_t nodeIndex, uint32_t& candidate, float& candidateRatio);
+
+	RayData MakeRayData(const SimpleMath::Ray& ray) const;
+	uint32_t IntersectRayNode(const Node& node, const RayData& ray, float maxDistance, float entry[4]) const;
+	bool IntersectRayObject(uint32_t object, const RayData& ray, float maxDistance, float& entry) const;
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> freeNodes;
+	std::vector<AABB> objectBounds;
+	std::vector<uint32_t> primIndices;
+	std::vector<uint32_t> objectNode;
+	std::vector<XMFLOAT3> centroids;
+	uint32_t root = INVALID_INDEX;
+	uint32_t maxDepth = 0;			//Deepest level built since Build, an upper bound after partial rebuilds
+	float rebuildThreshold = 1.5f;
+	BVHStats stats;
+};
+
+template<typename IntersectFunc>
+bool BVH::Raycast(const SimpleMath::Ray& ray, float& distance, uint32_t& hitObject, IntersectFunc&& intersectObject, size_t* nodesVisited) const
+{
+	hitObject = INVALID_INDEX;
+	const RayData rayData = this->MakeRayData(ray);
+	return this->RaycastLeaves(ray, distance, [&](const uint32_t* objects, uint32_t count, float& leafDistance)
+	{
+		bool hit = false;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float objectEntry;
+			if (!this->IntersectRayObject(objects[i], rayData, leafDistance, objectEntry))
+				continue;
+			if (intersectObject(objects[i], leafDistance))
+			{
+				hitObject = objects[i];
+				hit = true;
+			}
+		}
+		return hit;
+	}, nodesVisited);
+}
+
+template<typename IntersectFunc>
+bool BVH::RaycastLeaves(const SimpleMath::Ray& ray, float& distance, IntersectFunc&& intersectLeaf, size_t* nodesVisited) const
+{
+	if (this->root == INVALID_INDEX)
+		return false;
+
+	const RayData rayData = this->MakeRayData(ray);
+
+	struct StackEntry
+	{
+		uint32_t node;
+		float entry;
+	};
+	TraversalStack<StackEntry> stack(this->maxDepth);
+	stack.Push({ this->root, 0.0f });
+
+	bool hit = false;
+	size_t visited = 0;
+	while (!stack.Empty())
+	{
+		const StackEntry current = stack.Pop();
+		if (current.entry > distance)
+			continue;
+
+		const Node& node = this->nodes[current.node];
+		visited += 1;
+
+		float entry[4];
+		uint32_t mask = this->IntersectRayNode(node, rayData, distance, entry);
+
+		//Sort hit slots far to near so the nearest child is popped first
+		int order[4];
+		int hits = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if ((mask & (1u << i)) == 0)
+				continue;
+			int j = hits++;
+			while (j > 0 && entry[order[j - 1]] < entry[i])
+			{
+				order[j] = order[j - 1];
+				j--;
+			}
+			order[j] = i;
+		}
+
+		for (int h = 0; h < hits; h++)
+		{
+			const int i = order[h];
+			if (node.count[i] == 0)
+			{
+				stack.Push({ node.child[i], entry[i] });
+				continue;
+			}
+
+			if (entry[i] <= distance && intersectLeaf(&this->primIndices[node.child[i]], node.count[i], distance))
+				hit = true;
+		}
+	}
+
+	if (nodesVisited)
+		*nodesVisited += visited;
+	return hit;
+}
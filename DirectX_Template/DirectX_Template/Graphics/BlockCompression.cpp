@@ -0,0 +1,953 @@
+#include "BlockCompression.h"
+#include "../Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	const uint32_t DDS_MAGIC_NUMBER = 0x20534444;	//"DDS "
+	const uint32_t DDS_FOURCC_DX10 = 0x30315844;	//"DX10"
+
+	//DDS file layout as documented for DDS_HEADER, DDS_PIXELFORMAT and DDS_HEADER_DXT10
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header size mismatch");
+	static_assert(sizeof(DDSHeaderDXT10) == 20, "DDS DX10 header size mismatch");
+
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_PITCH = 0x8;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+	const uint32_t DIMENSION_TEXTURE2D = 3;
+
+	//Magic number, DDS header and DX10 header. pitchFlag is DDSD_PITCH or DDSD_LINEARSIZE.
+	void WriteDDSHeaders(uint8_t* file, uint32_t width, uint32_t height, uint32_t mipCount, DXGI_FORMAT format, uint32_t pitchFlag, uint32_t pitchOrLinearSize)
+	{
+		std::memcpy(file, &DDS_MAGIC_NUMBER, sizeof(uint32_t));
+
+		DDSHeader header = {};
+		header.size = sizeof(DDSHeader);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | pitchFlag;
+		header.height = height;
+		header.width = width;
+		header.pitchOrLinearSize = pitchOrLinearSize;
+		header.mipMapCount = mipCount;
+		header.ddspf.size = sizeof(DDSPixelFormat);
+		header.ddspf.flags = DDPF_FOURCC;
+		header.ddspf.fourCC = DDS_FOURCC_DX10;
+		header.caps = DDSCAPS_TEXTURE | (mipCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+		std::memcpy(file + sizeof(uint32_t), &header, sizeof(header));
+
+		DDSHeaderDXT10 extension = {};
+		extension.dxgiFormat = static_cast<uint32_t>(format);
+		extension.resourceDimension = DIMENSION_TEXTURE2D;
+		extension.arraySize = 1;
+		std::memcpy(file + sizeof(uint32_t) + sizeof(header), &extension, sizeof(extension));
+	}
+
+	uint32_t CountMips(uint32_t width, uint32_t height, MipFilter filter)
+	{
+		uint32_t mipCount = 1;
+		if (filter != MipFilter::None)
+		{
+			for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+			{
+				mipCount++;
+			}
+		}
+		return mipCount;
+	}
+
+	//Index of the palette entry for each step from endpoint 0 to endpoint 1
+	const uint32_t COLOR_STEP_TO_INDEX[4] = { 0, 2, 3, 1 };
+
+	//16 pixels of one block, split per channel so four pixels load into one vector
+	struct ColorBlock
+	{
+		XMFLOAT4 r[4];
+		XMFLOAT4 g[4];
+		XMFLOAT4 b[4];
+	};
+
+	inline uint16_t PackRGB565(const XMFLOAT3& color)
+	{
+		const int r = std::min(std::max(static_cast<int>(color.x * (31.0f / 255.0f) + 0.5f), 0), 31);
+		const int g = std::min(std::max(static_cast<int>(color.y * (63.0f / 255.0f) + 0.5f), 0), 63);
+		const int b = std::min(std::max(static_cast<int>(color.z * (31.0f / 255.0f) + 0.5f), 0), 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	inline void UnpackRGB565(uint16_t color, int* rgb)
+	{
+		const int r = (color >> 11) & 31;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	//Picks the nearest of the four palette colors for every pixel by projecting it on the line
+	//between the endpoints, four pixels per step. Returns the squared error of the block.
+	float SelectColorIndices(const ColorBlock& block, uint16_t color0, uint16_t color1, uint32_t& indices, float* steps)
+	{
+		int p0[3];
+		int p1[3];
+		UnpackRGB565(color0, p0);
+		UnpackRGB565(color1, p1);
+
+		const float dr = static_cast<float>(p1[0] - p0[0]);
+		const float dg = static_cast<float>(p1[1] - p0[1]);
+		const float db = static_cast<float>(p1[2] - p0[2]);
+		const float lengthSq = dr * dr + dg * dg + db * db;
+		const float scale = lengthSq > 0.0f ? 3.0f / lengthSq : 0.0f;
+
+		const XMVECTOR start[3] = { XMVectorReplicate(static_cast<float>(p0[0])), XMVectorReplicate(static_cast<float>(p0[1])), XMVectorReplicate(static_cast<float>(p0[2])) };
+		const XMVECTOR direction[3] = { XMVectorReplicate(dr), XMVectorReplicate(dg), XMVectorReplicate(db) };
+		const XMVECTOR thirds = XMVectorReplicate(1.0f / 3.0f);
+		const XMVECTOR lastStep = XMVectorReplicate(3.0f);
+
+		XMVECTOR error = XMVectorZero();
+		indices = 0;
+		for (uint32_t group = 0; group < 4; group++)
+		{
+			const XMVECTOR r = XMVectorSubtract(XMLoadFloat4(&block.r[group]), start[0]);
+			const XMVECTOR g = XMVectorSubtract(XMLoadFloat4(&block.g[group]), start[1]);
+			const XMVECTOR b = XMVectorSubtract(XMLoadFloat4(&block.b[group]), start[2]);
+
+			XMVECTOR t = XMVectorMultiply(r, direction[0]);
+			t = XMVectorMultiplyAdd(g, direction[1], t);
+			t = XMVectorMultiplyAdd(b, direction[2], t);
+			t = XMVectorClamp(XMVectorRound(XMVectorScale(t, scale)), XMVectorZero(), lastStep);
+
+			//Error against the palette color the step decodes to
+			const XMVECTOR weight = XMVectorMultiply(t, thirds);
+			const XMVECTOR er = XMVectorNegativeMultiplySubtract(weight, direction[0], r);
+			const XMVECTOR eg = XMVectorNegativeMultiplySubtract(weight, direction[1], g);
+			const XMVECTOR eb = XMVectorNegativeMultiplySubtract(weight, direction[2], b);
+			error = XMVectorMultiplyAdd(er, er, error);
+			error = XMVectorMultiplyAdd(eg, eg, error);
+			error = XMVectorMultiplyAdd(eb, eb, error);
+
+			XMFLOAT4 groupSteps;
+			XMStoreFloat4(&groupSteps, t);
+			const float laneSteps[4] = { groupSteps.x, groupSteps.y, groupSteps.z, groupSteps.w };
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				const uint32_t pixel = group * 4 + lane;
+				steps[pixel] = laneSteps[lane];
+				indices |= COLOR_STEP_TO_INDEX[static_cast<uint32_t>(laneSteps[lane])] << (pixel * 2);
+			}
+		}
+
+		XMFLOAT4 errors;
+		XMStoreFloat4(&errors, error);
+		return errors.x + errors.y + errors.z + errors.w;
+	}
+
+	//Four color mode needs color0 > color1, equal endpoints only work with every index at 0
+	void OrderEndpoints(uint16_t& color0, uint16_t& color1)
+	{
+		if (color0 < color1)
+			std::swap(color0, color1);
+	}
+
+	void EncodeColorBlock(const uint8_t* pixels, uint8_t* out, bool refine)
+	{
+		ColorBlock block;
+		float mean[3] = {};
+		float minimum[3] = { 255.0f, 255.0f, 255.0f };
+		float maximum[3] = {};
+		float* channels[3] = { &block.r[0].x, &block.g[0].x, &block.b[0].x };
+		for (uint32_t pixel = 0; pixel < 16; pixel++)
+		{
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				const float value = static_cast<float>(pixels[pixel * 4 + c]);
+				channels[c][pixel] = value;
+				mean[c] += value;
+				minimum[c] = std::min(minimum[c], value);
+				maximum[c] = std::max(maximum[c], value);
+			}
+		}
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			mean[c] /= 16.0f;
+		}
+
+		uint16_t color0;
+		uint16_t color1;
+		uint32_t indices = 0;
+		float steps[16];
+
+		if (maximum[0] == minimum[0] && maximum[1] == minimum[1] && maximum[2] == minimum[2])
+		{
+			//Solid block, both endpoints are the color and every index is 0
+			color0 = color1 = PackRGB565(XMFLOAT3(mean[0], mean[1], mean[2]));
+		}
+		else
+		{
+			float covariance[6] = {};	//rr, rg, rb, gg, gb, bb
+			for (uint32_t pixel = 0; pixel < 16; pixel++)
+			{
+				const float r = channels[0][pixel] - mean[0];
+				const float g = channels[1][pixel] - mean[1];
+				const float b = channels[2][pixel] - mean[2];
+				covariance[0] += r * r;
+				covariance[1] += r * g;
+				covariance[2] += r * b;
+				covariance[3] += g * g;
+				covariance[4] += g * b;
+				covariance[5] += b * b;
+			}
+
+			//Principal axis by power iteration, starting from the bounding box diagonal
+			float axis[3] = { maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] };
+			for (int iteration = 0; iteration < 4; iteration++)
+			{
+				const float x = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+				const float y = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+				const float z = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+				const float largest = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+				if (largest <= 0.0f)
+					break;
+				axis[0] = x / largest;
+				axis[1] = y / largest;
+				axis[2] = z / largest;
+			}
+			const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				axis[c] /= axisLength;
+			}
+
+			float low = std::numeric_limits<float>::max();
+			float high = -std::numeric_limits<float>::max();
+			for (uint32_t pixel = 0; pixel < 16; pixel++)
+			{
+				const float projection = (channels[0][pixel] - mean[0]) * axis[0] + (channels[1][pixel] - mean[1]) * axis[1] + (channels[2][pixel] - mean[2]) * axis[2];
+				low = std::min(low, projection);
+				high = std::max(high, projection);
+			}
+
+			//Pull the endpoints in a little, the extremes are rarely worth a whole palette step
+			const float inset = (high - low) / 16.0f;
+			low += inset;
+			high -= inset;
+
+			color0 = PackRGB565(XMFLOAT3(mean[0] + axis[0] * high, mean[1] + axis[1] * high, mean[2] + axis[2] * high));
+			color1 = PackRGB565(XMFLOAT3(mean[0] + axis[0] * low, mean[1] + axis[1] * low, mean[2] + axis[2] * low));
+			OrderEndpoints(color0, color1);
+		}
+
+		if (color0 != color1)
+		{
+			float error = SelectColorIndices(block, color0, color1, indices, steps);
+
+			//Least squares fit of the endpoints to the chosen steps, kept while it lowers the error
+			for (int iteration = 0; refine && iteration < 2; iteration++)
+			{
+				float aa = 0.0f;
+				float ab = 0.0f;
+				float bb = 0.0f;
+				float xa[3] = {};
+				float xb[3] = {};
+				for (uint32_t pixel = 0; pixel < 16; pixel++)
+				{
+					const float beta = steps[pixel] / 3.0f;
+					const float alpha = 1.0f - beta;
+					aa += alpha * alpha;
+					ab += alpha * beta;
+					bb += beta * beta;
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						xa[c] += alpha * channels[c][pixel];
+						xb[c] += beta * channels[c][pixel];
+					}
+				}
+
+				const float determinant = aa * bb - ab * ab;
+				if (std::fabs(determinant) < 1e-6f)
+					break;
+
+				const float inverse = 1.0f / determinant;
+				XMFLOAT3 end0;
+				XMFLOAT3 end1;
+				end0.x = (bb * xa[0] - ab * xb[0]) * inverse;
+				end0.y = (bb * xa[1] - ab * xb[1]) * inverse;
+				end0.z = (bb * xa[2] - ab * xb[2]) * inverse;
+				end1.x = (aa * xb[0] - ab * xa[0]) * inverse;
+				end1.y = (aa * xb[1] - ab * xa[1]) * inverse;
+				end1.z = (aa * xb[2] - ab * xa[2]) * inverse;
+
+				uint16_t refined0 = PackRGB565(end0);
+				uint16_t refined1 = PackRGB565(end1);
+				OrderEndpoints(refined0, refined1);
+				if (refined0 == refined1 || (refined0 == color0 && refined1 == color1))
+					break;
+
+				uint32_t refinedIndices;
+				float refinedSteps[16];
+				const float refinedError = SelectColorIndices(block, refined0, refined1, refinedIndices, refinedSteps);
+				if (refinedError >= error)
+					break;
+
+				error = refinedError;
+				color0 = refined0;
+				color1 = refined1;
+				indices = refinedIndices;
+				std::copy(refinedSteps, refinedSteps + 16, steps);
+			}
+		}
+
+		out[0] = static_cast<uint8_t>(color0 & 0xFF);
+		out[1] = static_cast<uint8_t>(color0 >> 8);
+		out[2] = static_cast<uint8_t>(color1 & 0xFF);
+		out[3] = static_cast<uint8_t>(color1 >> 8);
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	void DecodeColorBlock(const uint8_t* block, uint8_t* pixels, bool forceFourColors)
+	{
+		const uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+		const uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+		int palette[4][4];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			if (forceFourColors || color0 > color1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		if (!forceFourColors && color0 <= color1)
+			palette[3][3] = 0;
+
+		const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+		for (uint32_t pixel = 0; pixel < 16; pixel++)
+		{
+			const int* color = palette[(indices >> (pixel * 2)) & 3];
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				pixels[pixel * 4 + c] = static_cast<uint8_t>(color[c]);
+			}
+		}
+	}
+
+	//BC4 style block for one channel of the 16 pixels: min and max endpoints, 8 interpolated values
+	void EncodeChannelBlock(const uint8_t* pixels, uint32_t channel, uint8_t* out)
+	{
+		uint8_t values[16];
+		uint8_t low = 255;
+		uint8_t high = 0;
+		for (uint32_t pixel = 0; pixel < 16; pixel++)
+		{
+			values[pixel] = pixels[pixel * 4 + channel];
+			low = std::min(low, values[pixel]);
+			high = std::max(high, values[pixel]);
+		}
+
+		out[0] = high;
+		out[1] = low;
+
+		uint64_t indices = 0;
+		if (high != low)
+		{
+			const float scale = 7.0f / static_cast<float>(high - low);
+			for (uint32_t pixel = 0; pixel < 16; pixel++)
+			{
+				const uint32_t step = static_cast<uint32_t>(static_cast<float>(values[pixel] - low) * scale + 0.5f);
+				const uint64_t index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+				indices |= index << (pixel * 3);
+			}
+		}
+
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	void DecodeChannelBlock(const uint8_t* block, uint8_t* pixels, uint32_t channel)
+	{
+		const int value0 = block[0];
+		const int value1 = block[1];
+
+		int palette[8] = { value0, value1 };
+		if (value0 > value1)
+		{
+			for (int i = 2; i < 8; i++)
+			{
+				palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+			{
+				palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		}
+		for (uint32_t pixel = 0; pixel < 16; pixel++)
+		{
+			pixels[pixel * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (pixel * 3)) & 7]);
+		}
+	}
+
+	//Copies the 4x4 block at (blockX, blockY). Blocks that run past the right or bottom edge repeat
+	//the last column and row, so the padding does not pull the endpoints toward colors the level lacks.
+	void GatherBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t blockX, uint32_t blockY, uint8_t* pixels)
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			const uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				const uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+				std::memcpy(pixels + (y * 4 + x) * 4, rgba + sourceY * rowPitch + sourceX * 4, 4);
+			}
+		}
+	}
+
+	void ForEachRow(JobSystem* jobSystem, uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& job)
+	{
+		if (jobSystem != nullptr)
+			jobSystem->ParallelFor(count, batchSize, job);
+		else
+			job(0, count);
+	}
+
+	float SRGBToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSRGB(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	inline uint32_t AddressTexel(int coordinate, uint32_t size, bool wrap)
+	{
+		const int extent = static_cast<int>(size);
+		if (wrap)
+			return static_cast<uint32_t>(((coordinate % extent) + extent) % extent);
+		return static_cast<uint32_t>(std::min(std::max(coordinate, 0), extent - 1));
+	}
+
+	//Zeroth order modified Bessel function of the first kind, for the Kaiser window
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	const int KAISER_TAPS = 8;			//Source texels per destination texel, centered on the 2x2 footprint
+	const double KAISER_ALPHA = 4.0;
+
+	//Weights for halving along one axis. Destination texel i covers source texels 2i and 2i+1,
+	//tap k samples source texel 2i + k - 3.
+	void ComputeKaiserWeights(float* weights)
+	{
+		const double pi = 3.14159265358979323846;
+		const double halfWidth = KAISER_TAPS / 2.0;
+		double total = 0.0;
+		double raw[KAISER_TAPS];
+		for (int k = 0; k < KAISER_TAPS; k++)
+		{
+			const double x = (k - 3) - 0.5;		//Distance from the destination texel center, in source texels
+			const double u = x / halfWidth;
+			const double window = BesselI0(KAISER_ALPHA * std::sqrt(std::max(0.0, 1.0 - u * u))) / BesselI0(KAISER_ALPHA);
+			const double sincX = pi * x * 0.5;
+			const double sinc = std::fabs(sincX) < 1e-9 ? 1.0 : std::sin(sincX) / sincX;
+			raw[k] = sinc * window;
+			total += raw[k];
+		}
+		for (int k = 0; k < KAISER_TAPS; k++)
+		{
+			weights[k] = static_cast<float>(raw[k] / total);
+		}
+	}
+}
+
+void BlockCompressor::Initialize(JobSystem* jobSystem)
+{
+	this->jobSystem = jobSystem;
+}
+
+void BlockCompressor::EncodeBlock(BlockFormat format, const uint8_t* pixels, uint8_t* block, bool refine)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		EncodeColorBlock(pixels, block, refine);
+		break;
+	case BlockFormat::BC3:
+		EncodeChannelBlock(pixels, 3, block);
+		EncodeColorBlock(pixels, block + 8, refine);
+		break;
+	case BlockFormat::BC4:
+		EncodeChannelBlock(pixels, 0, block);
+		break;
+	case BlockFormat::BC5:
+		EncodeChannelBlock(pixels, 0, block);
+		EncodeChannelBlock(pixels, 1, block + 8);
+		break;
+	}
+}
+
+void BlockCompressor::DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		DecodeColorBlock(block, pixels, false);
+		break;
+	case BlockFormat::BC3:
+		DecodeColorBlock(block + 8, pixels, true);
+		DecodeChannelBlock(block, pixels, 3);
+		break;
+	case BlockFormat::BC4:
+		std::memset(pixels, 0, 64);
+		DecodeChannelBlock(block, pixels, 0);
+		for (uint32_t pixel = 0; pixel < 16; pixel++)
+		{
+			pixels[pixel * 4 + 3] = 255;
+		}
+		break;
+	case BlockFormat::BC5:
+		std::memset(pixels, 0, 64);
+		DecodeChannelBlock(block, pixels, 0);
+		DecodeChannelBlock(block + 8, pixels, 1);
+		for (uint32_t pixel = 0; pixel < 16; pixel++)
+		{
+			pixels[pixel * 4 + 3] = 255;
+		}
+		break;
+	}
+}
+
+DXGI_FORMAT BlockCompressor::GetDXGIFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case BlockFormat::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case BlockFormat::BC4: return DXGI_FORMAT_BC4_UNORM;
+	case BlockFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+size_t BlockCompressor::GetBlockBytes(BlockFormat format)
+{
+	return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+double BlockCompressor::ComputePSNR(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, const uint8_t* blocks)
+{
+	uint32_t channels = 3;
+	if (format == BlockFormat::BC3)
+		channels = 4;
+	else if (format == BlockFormat::BC4)
+		channels = 1;
+	else if (format == BlockFormat::BC5)
+		channels = 2;
+
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const size_t blockBytes = GetBlockBytes(format);
+
+	double squaredError = 0.0;
+	uint8_t decoded[64];
+	for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+		{
+			DecodeBlock(format, blocks + (blockY * blocksWide + blockX) * blockBytes, decoded);
+			for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+				{
+					const uint8_t* source = rgba + (blockY * 4 + y) * rowPitch + (blockX * 4 + x) * 4;
+					for (uint32_t c = 0; c < channels; c++)
+					{
+						const double difference = static_cast<double>(source[c]) - static_cast<double>(decoded[(y * 4 + x) * 4 + c]);
+						squaredError += difference * difference;
+					}
+				}
+			}
+		}
+	}
+
+	const double meanSquaredError = squaredError / (static_cast<double>(width) * height * channels);
+	if (meanSquaredError <= 0.0)
+		return std::numeric_limits<double>::infinity();
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+void BlockCompressor::GenerateMips(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch,
+	const BlockCompressionOptions& options, uint32_t mipCount, std::vector<std::vector<uint8_t>>& levels) const
+{
+	levels.resize(mipCount);
+
+	float toLinear[256];
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		const float value = i / 255.0f;
+		toLinear[i] = options.srgb ? SRGBToLinear(value) : value;
+	}
+
+	//Every level is filtered from the float copy of the one above, so rounding does not pile up
+	std::vector<XMFLOAT4> current(static_cast<size_t>(width) * height);
+	ForEachRow(this->jobSystem, height, 16, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t y = begin; y < end; y++)
+		{
+			const uint8_t* row = rgba + static_cast<size_t>(y) * rowPitch;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const uint8_t* texel = row + x * 4;
+				current[static_cast<size_t>(y) * width + x] = XMFLOAT4(toLinear[texel[0]], toLinear[texel[1]], toLinear[texel[2]], texel[3] / 255.0f);
+			}
+		}
+	});
+
+	float kaiser[KAISER_TAPS];
+	ComputeKaiserWeights(kaiser);
+
+	std::vector<XMFLOAT4> next;
+	std::vector<XMFLOAT4> horizontal;
+	uint32_t sourceWidth = width;
+	uint32_t sourceHeight = height;
+	for (uint32_t level = 1; level < mipCount; level++)
+	{
+		const uint32_t levelWidth = std::max(sourceWidth / 2, 1u);
+		const uint32_t levelHeight = std::max(sourceHeight / 2, 1u);
+		next.resize(static_cast<size_t>(levelWidth) * levelHeight);
+
+		if (options.mipFilter == MipFilter::Kaiser)
+		{
+			//Separable: halve the width into horizontal, then the height into next. An axis that
+			//is already 1 texel is copied through.
+			horizontal.resize(static_cast<size_t>(levelWidth) * sourceHeight);
+			ForEachRow(this->jobSystem, sourceHeight, 16, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					const XMFLOAT4* sourceRow = current.data() + static_cast<size_t>(y) * sourceWidth;
+					for (uint32_t x = 0; x < levelWidth; x++)
+					{
+						XMVECTOR sum = XMVectorZero();
+						if (sourceWidth == 1)
+						{
+							sum = XMLoadFloat4(&sourceRow[0]);
+						}
+						else
+						{
+							for (int k = 0; k < KAISER_TAPS; k++)
+							{
+								const uint32_t sourceX = AddressTexel(static_cast<int>(x * 2) + k - 3, sourceWidth, options.wrap);
+								sum = XMVectorMultiplyAdd(XMLoadFloat4(&sourceRow[sourceX]), XMVectorReplicate(kaiser[k]), sum);
+							}
+						}
+						XMStoreFloat4(&horizontal[static_cast<size_t>(y) * levelWidth + x], sum);
+					}
+				}
+			});
+
+			ForEachRow(this->jobSystem, levelHeight, 16, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					for (uint32_t x = 0; x < levelWidth; x++)
+					{
+						XMVECTOR sum = XMVectorZero();
+						if (sourceHeight == 1)
+						{
+							sum = XMLoadFloat4(&horizontal[x]);
+						}
+						else
+						{
+							for (int k = 0; k < KAISER_TAPS; k++)
+							{
+								const uint32_t sourceY = AddressTexel(static_cast<int>(y * 2) + k - 3, sourceHeight, options.wrap);
+								sum = XMVectorMultiplyAdd(XMLoadFloat4(&horizontal[static_cast<size_t>(sourceY) * levelWidth + x]), XMVectorReplicate(kaiser[k]), sum);
+							}
+						}
+						//The negative lobes can overshoot
+						XMStoreFloat4(&next[static_cast<size_t>(y) * levelWidth + x], XMVectorSaturate(sum));
+					}
+				}
+			});
+		}
+		else
+		{
+			const XMVECTOR quarter = XMVectorReplicate(0.25f);
+			ForEachRow(this->jobSystem, levelHeight, 16, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					const uint32_t y0 = std::min(y * 2, sourceHeight - 1);
+					const uint32_t y1 = std::min(y * 2 + 1, sourceHeight - 1);
+					for (uint32_t x = 0; x < levelWidth; x++)
+					{
+						const uint32_t x0 = std::min(x * 2, sourceWidth - 1);
+						const uint32_t x1 = std::min(x * 2 + 1, sourceWidth - 1);
+						XMVECTOR sum = XMLoadFloat4(&current[static_cast<size_t>(y0) * sourceWidth + x0]);
+						sum = XMVectorAdd(sum, XMLoadFloat4(&current[static_cast<size_t>(y0) * sourceWidth + x1]));
+						sum = XMVectorAdd(sum, XMLoadFloat4(&current[static_cast<size_t>(y1) * sourceWidth + x0]));
+						sum = XMVectorAdd(sum, XMLoadFloat4(&current[static_cast<size_t>(y1) * sourceWidth + x1]));
+						XMStoreFloat4(&next[static_cast<size_t>(y) * levelWidth + x], XMVectorMultiply(sum, quarter));
+					}
+				}
+			});
+		}
+
+		std::vector<uint8_t>& bytes = levels[level];
+		bytes.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+		ForEachRow(this->jobSystem, levelHeight, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; y++)
+			{
+				for (uint32_t x = 0; x < levelWidth; x++)
+				{
+					const size_t index = static_cast<size_t>(y) * levelWidth + x;
+					const XMFLOAT4& texel = next[index];
+					float rgb[3] = { texel.x, texel.y, texel.z };
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						const float value = options.srgb ? LinearToSRGB(rgb[c]) : rgb[c];
+						bytes[index * 4 + c] = static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+					}
+					bytes[index * 4 + 3] = static_cast<uint8_t>(std::min(std::max(texel.w, 0.0f), 1.0f) * 255.0f + 0.5f);
+				}
+			}
+		});
+
+		current.swap(next);
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+	}
+}
+
+bool BlockCompressor::CompressToDDS(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch,
+	const BlockCompressionOptions& options, std::vector<uint8_t>& ddsFile, BlockCompressionStats* stats, std::string* error) const
+{
+	if (rgba == nullptr || width == 0 || height == 0 || rowPitch < width * 4)
+	{
+		if (error != nullptr)
+			*error = "BlockCompressor::CompressToDDS called with an invalid image.";
+		return false;
+	}
+	const uint32_t mipCount = CountMips(width, height, options.mipFilter);
+
+	Timer timer;
+	timer.Start();
+
+	std::vector<std::vector<uint8_t>> generated;
+	if (mipCount > 1)
+		this->GenerateMips(rgba, width, height, rowPitch, options, mipCount, generated);
+	const double mipMilliseconds = timer.GetMillisecondsElapsed();
+
+	struct Level
+	{
+		const uint8_t* pixels;
+		uint32_t width;
+		uint32_t height;
+		uint32_t rowPitch;
+		uint32_t blocksWide;
+		size_t offset;
+	};
+	struct BlockRow
+	{
+		uint32_t level;
+		uint32_t row;
+	};
+
+	const size_t blockBytes = GetBlockBytes(options.format);
+	const size_t headerBytes = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDXT10);
+
+	std::vector<Level> levels(mipCount);
+	std::vector<BlockRow> rows;
+	size_t fileBytes = headerBytes;
+	uint64_t pixelCount = 0;
+	for (uint32_t i = 0; i < mipCount; i++)
+	{
+		Level& level = levels[i];
+		level.width = std::max(width >> i, 1u);
+		level.height = std::max(height >> i, 1u);
+		level.pixels = i == 0 ? rgba : generated[i].data();
+		level.rowPitch = i == 0 ? rowPitch : level.width * 4;
+		level.blocksWide = (level.width + 3) / 4;
+		level.offset = fileBytes;
+
+		const uint32_t blocksHigh = (level.height + 3) / 4;
+		fileBytes += level.blocksWide * blocksHigh * blockBytes;
+		pixelCount += static_cast<uint64_t>(level.width) * level.height;
+		for (uint32_t row = 0; row < blocksHigh; row++)
+		{
+			rows.push_back({ i, row });
+		}
+	}
+
+	ddsFile.assign(fileBytes, 0);
+
+	uint8_t* file = ddsFile.data();
+	WriteDDSHeaders(file, width, height, mipCount, GetDXGIFormat(options.format, options.srgb), DDSD_LINEARSIZE,
+		static_cast<uint32_t>(levels[0].blocksWide * ((height + 3) / 4) * blockBytes));
+
+	timer.Restart();
+
+	//Block rows of every level in one pass, so the small levels do not each wait on the pool
+	ForEachRow(this->jobSystem, static_cast<uint32_t>(rows.size()), 4, [&](uint32_t begin, uint32_t end)
+	{
+		uint8_t pixels[64];
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const Level& level = levels[rows[i].level];
+			uint8_t* out = file + level.offset + static_cast<size_t>(rows[i].row) * level.blocksWide * blockBytes;
+			for (uint32_t blockX = 0; blockX < level.blocksWide; blockX++)
+			{
+				GatherBlock(level.pixels, level.width, level.height, level.rowPitch, blockX, rows[i].row, pixels);
+				EncodeBlock(options.format, pixels, out + blockX * blockBytes, options.refine);
+			}
+		}
+	});
+
+	const double encodeMilliseconds = timer.GetMillisecondsElapsed();
+
+	if (stats != nullptr)
+	{
+		stats->width = width;
+		stats->height = height;
+		stats->mipCount = mipCount;
+		stats->uncompressedBytes = static_cast<size_t>(pixelCount * 4);
+		stats->compressedBytes = fileBytes - headerBytes;
+		stats->mipMilliseconds = mipMilliseconds;
+		stats->encodeMilliseconds = encodeMilliseconds;
+		stats->megapixelsPerSecond = encodeMilliseconds > 0.0 ? static_cast<double>(pixelCount) / (encodeMilliseconds * 1000.0) : 0.0;
+		stats->psnr = ComputePSNR(options.format, rgba, width, height, rowPitch, file + levels[0].offset);
+	}
+
+	return true;
+}
+
+bool BlockCompressor::WriteUncompressedDDS(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch,
+	const BlockCompressionOptions& options, std::vector<uint8_t>& ddsFile, std::string* error) const
+{
+	if (rgba == nullptr || width == 0 || height == 0 || rowPitch < width * 4)
+	{
+		if (error != nullptr)
+			*error = "BlockCompressor::WriteUncompressedDDS called with an invalid image.";
+		return false;
+	}
+	const uint32_t mipCount = CountMips(width, height, options.mipFilter);
+
+	std::vector<std::vector<uint8_t>> generated;
+	if (mipCount > 1)
+		this->GenerateMips(rgba, width, height, rowPitch, options, mipCount, generated);
+
+	const size_t headerBytes = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDXT10);
+	size_t fileBytes = headerBytes;
+	for (uint32_t i = 0; i < mipCount; i++)
+	{
+		fileBytes += static_cast<size_t>(std::max(width >> i, 1u)) * std::max(height >> i, 1u) * 4;
+	}
+
+	ddsFile.assign(fileBytes, 0);
+	uint8_t* file = ddsFile.data();
+	const DXGI_FORMAT format = options.srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	WriteDDSHeaders(file, width, height, mipCount, format, DDSD_PITCH, width * 4);
+
+	//Levels are stored tightly packed, one after the other
+	uint8_t* out = file + headerBytes;
+	for (uint32_t i = 0; i < mipCount; i++)
+	{
+		const uint32_t levelWidth = std::max(width >> i, 1u);
+		const uint32_t levelHeight = std::max(height >> i, 1u);
+		const uint8_t* pixels = i == 0 ? rgba : generated[i].data();
+		const uint32_t pitch = i == 0 ? rowPitch : levelWidth * 4;
+		for (uint32_t y = 0; y < levelHeight; y++)
+		{
+			std::memcpy(out, pixels + static_cast<size_t>(y) * pitch, levelWidth * 4);
+			out += levelWidth * 4;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <DirectXMath.h>
+#include <dxgiformat.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../JobSystem.h"
+
+using namespace DirectX;
+
+enum class BlockFormat
+{
+	BC1,	//RGB, alpha is dropped. 8 bytes per block
+	BC3,	//RGB plus interpolated alpha. 16 bytes per block
+	BC4,	//Red only, for height and mask maps. 8 bytes per block
+	BC5,	//Red and green, for tangent space normal maps. 16 bytes per block
+};
+
+enum class MipFilter
+{
+	None,
+	Box,	//2x2 average
+	Kaiser,	//8 tap Kaiser windowed sinc, sharper than the box filter
+};
+
+struct BlockCompressionOptions
+{
+	BlockFormat format = BlockFormat::BC1;
+	MipFilter mipFilter = MipFilter::Box;
+	bool srgb = false;		//Color data is sRGB: mips are filtered in linear space and BC1/BC3 get the _SRGB format
+	bool wrap = false;		//Mip filtering samples across the edges, for tiling textures
+	bool refine = true;		//Least squares refit of the BC1/BC3 color endpoints, slower but higher PSNR
+};
+
+struct BlockCompressionStats
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipCount = 0;
+	size_t uncompressedBytes = 0;	//RGBA8 with the same mips
+	size_t compressedBytes = 0;
+	double mipMilliseconds = 0.0;
+	double encodeMilliseconds = 0.0;
+	double megapixelsPerSecond = 0.0;	//Encode throughput over all mips
+	double psnr = 0.0;				//Top mip, over the channels the format stores
+};
+
+//CPU block compressor for textures that are not already in DDS form. Colors are fit along their
+//principal axis and the palette indices are picked four pixels at a time with DirectXMath, mips
+//are generated in float, and block rows are spread over the job system. The output is a complete
+//DDS file (DX10 header) that CreateDDSTextureFromMemory loads as is.
+class BlockCompressor
+{
+public:
+	//jobSystem may be null
+	void Initialize(JobSystem* jobSystem);
+
+	//rgba is 8 bits per channel, rowPitch in bytes. Any width and height is accepted, partial blocks on
+	//the right and bottom edges are padded with the edge pixels. Direct3D 11 only creates block
+	//compressed textures whose top level is a multiple of 4 though, see CompressedTextureLoader::Load.
+	//stats is optional. PSNR is only computed when it is given.
+	//Nothing is logged, on failure the reason is written to error when it is given.
+	bool CompressToDDS(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch,
+		const BlockCompressionOptions& options, std::vector<uint8_t>& ddsFile, BlockCompressionStats* stats = nullptr, std::string* error = nullptr) const;
+
+	//Same mips and DDS layout as CompressToDDS but stored as R8G8B8A8, which Direct3D 11 creates at
+	//any size. options.format and options.refine are ignored.
+	bool WriteUncompressedDDS(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch,
+		const BlockCompressionOptions& options, std::vector<uint8_t>& ddsFile, std::string* error = nullptr) const;
+
+	//pixels is a 4x4 block of RGBA8, row by row
+	static void EncodeBlock(BlockFormat format, const uint8_t* pixels, uint8_t* block, bool refine = true);
+	static void DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels);
+
+	static DXGI_FORMAT GetDXGIFormat(BlockFormat format, bool srgb);
+	static size_t GetBlockBytes(BlockFormat format);
+
+	//Compares an image against its compressed top mip, over the channels the format stores
+	static double ComputePSNR(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch, const uint8_t* blocks);
+
+private:
+	void GenerateMips(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t rowPitch,
+		const BlockCompressionOptions& options, uint32_t mipCount, std::vector<std::vector<uint8_t>>& levels) const;
+
+	JobSystem* jobSystem = nullptr;
+};
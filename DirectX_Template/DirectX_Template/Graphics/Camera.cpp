@@ -153,6 +153,15 @@ const XMVECTOR& Camera::GetBackVector()
 	return this->vec_back;
 }
 
+void Camera::ScreenToRay(float screenX, float screenY, float screenWidth, float screenHeight, XMVECTOR& rayOrigin, XMVECTOR& rayDirection) const
+{
+	//Unproject the cursor onto the near and far planes and build a unit length ray between them
+	XMVECTOR nearPoint = XMVector3Unproject(XMVectorSet(screenX, screenY, 0.0f, 0.0f), 0.0f, 0.0f, screenWidth, screenHeight, 0.0f, 1.0f, this->projectionMatrix, this->viewMatrix, XMMatrixIdentity());
+	XMVECTOR farPoint = XMVector3Unproject(XMVectorSet(screenX, screenY, 1.0f, 0.0f), 0.0f, 0.0f, screenWidth, screenHeight, 0.0f, 1.0f, this->projectionMatrix, this->viewMatrix, XMMatrixIdentity());
+
+	rayOrigin = nearPoint;
+	rayDirection = XMVector3Normalize(farPoint - nearPoint);
+}
 
 void Camera::UpdateViewMatrix()
 {
@@ -29,6 +29,7 @@ public:
 	const XMVECTOR& GetRightVector();
 	const XMVECTOR& GetLeftVector();
 	const XMVECTOR& GetBackVector();
+	void ScreenToRay(float screenX, float screenY, float screenWidth, float screenHeight, XMVECTOR& rayOrigin, XMVECTOR& rayDirection) const;
 
 private:
 	void UpdateViewMatrix();
@@ -0,0 +1,144 @@
+#include "CompressedTextureLoader.h"
+#include "../ErrorLogger.h"
+#include <DDSTextureLoader.h>
+#include <WICTextureLoader.h>
+#include <wincodec.h>
+#include <fstream>
+
+bool CompressedTextureLoader::Initialize(ID3D11Device* device, JobSystem* jobSystem)
+{
+	if (device == nullptr)
+	{
+		ErrorLogger::Log("CompressedTextureLoader needs a device.");
+		return false;
+	}
+
+	this->device = device;
+	this->compressor.Initialize(jobSystem);
+	return true;
+}
+
+bool CompressedTextureLoader::LoadPixels(const std::wstring& fileName, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)
+{
+	try
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()));
+		COM_ERROR_IF_FAILED(hr, "Failed to create WIC imaging factory.");
+
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		hr = factory->CreateDecoderFromFilename(fileName.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+		if (FAILED(hr))
+		{
+			ErrorLogger::Log(hr, L"Failed to open image " + fileName);
+			return false;
+		}
+
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		hr = decoder->GetFrame(0, frame.GetAddressOf());
+		COM_ERROR_IF_FAILED(hr, "Failed to decode image frame.");
+
+		UINT frameWidth = 0;
+		UINT frameHeight = 0;
+		hr = frame->GetSize(&frameWidth, &frameHeight);
+		COM_ERROR_IF_FAILED(hr, "Failed to get image size.");
+
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		hr = factory->CreateFormatConverter(converter.GetAddressOf());
+		COM_ERROR_IF_FAILED(hr, "Failed to create WIC format converter.");
+
+		hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+		COM_ERROR_IF_FAILED(hr, "Failed to convert image to RGBA.");
+
+		rgba.resize(static_cast<size_t>(frameWidth) * frameHeight * 4);
+		hr = converter->CopyPixels(nullptr, frameWidth * 4, static_cast<UINT>(rgba.size()), rgba.data());
+		COM_ERROR_IF_FAILED(hr, "Failed to copy image pixels.");
+
+		width = frameWidth;
+		height = frameHeight;
+	}
+	catch (COMException& exception)
+	{
+		ErrorLogger::Log(exception);
+		return false;
+	}
+	return true;
+}
+
+bool CompressedTextureLoader::Compress(const std::wstring& fileName, const BlockCompressionOptions& options, std::vector<uint8_t>& ddsFile, BlockCompressionStats* stats)
+{
+	std::vector<uint8_t> rgba;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	if (!LoadPixels(fileName, rgba, width, height))
+		return false;
+
+	std::string error;
+	if (!this->compressor.CompressToDDS(rgba.data(), width, height, width * 4, options, ddsFile, stats, &error))
+	{
+		ErrorLogger::Log(error);
+		return false;
+	}
+	return true;
+}
+
+bool CompressedTextureLoader::Load(const std::wstring& fileName, const BlockCompressionOptions& options, ID3D11ShaderResourceView** textureView, BlockCompressionStats* stats)
+{
+	if (this->device == nullptr)
+	{
+		ErrorLogger::Log("CompressedTextureLoader used before Initialize.");
+		return false;
+	}
+
+	std::vector<uint8_t> rgba;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	if (!LoadPixels(fileName, rgba, width, height))
+		return false;
+
+	//Direct3D 11 refuses block compressed textures whose top level is not a multiple of 4
+	if ((width % 4) != 0 || (height % 4) != 0)
+	{
+		if (stats != nullptr)
+			*stats = BlockCompressionStats();
+
+		HRESULT hr = DirectX::CreateWICTextureFromFile(this->device.Get(), fileName.c_str(), nullptr, textureView);
+		if (FAILED(hr))
+		{
+			ErrorLogger::Log(hr, L"Failed to create texture for " + fileName);
+			return false;
+		}
+		return true;
+	}
+
+	std::vector<uint8_t> ddsFile;
+	std::string error;
+	if (!this->compressor.CompressToDDS(rgba.data(), width, height, width * 4, options, ddsFile, stats, &error))
+	{
+		ErrorLogger::Log(error);
+		return false;
+	}
+
+	HRESULT hr = DirectX::CreateDDSTextureFromMemory(this->device.Get(), ddsFile.data(), ddsFile.size(), nullptr, textureView);
+	if (FAILED(hr))
+	{
+		ErrorLogger::Log(hr, L"Failed to create compressed texture for " + fileName);
+		return false;
+	}
+	return true;
+}
+
+bool CompressedTextureLoader::CompressFile(const std::wstring& fileName, const std::wstring& ddsFileName, const BlockCompressionOptions& options, BlockCompressionStats* stats)
+{
+	std::vector<uint8_t> ddsFile;
+	if (!this->Compress(fileName, options, ddsFile, stats))
+		return false;
+
+	std::ofstream file(ddsFileName, std::ios::binary | std::ios::trunc);
+	if (!file.write(reinterpret_cast<const char*>(ddsFile.data()), static_cast<std::streamsize>(ddsFile.size())))
+	{
+		ErrorLogger::Log(E_FAIL, L"Failed to write " + ddsFileName);
+		return false;
+	}
+	return true;
+}
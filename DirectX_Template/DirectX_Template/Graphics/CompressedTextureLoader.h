@@ -0,0 +1,29 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+
+//Loads images through WIC and turns them into block compressed textures with mips, as a
+//replacement for CreateWICTextureFromFile on color, mask and normal maps. CompressFile does the
+//same work offline and writes the DDS to disk for CreateDDSTextureFromFile. Images whose size is
+//not a multiple of 4 cannot be block compressed textures in Direct3D 11, Load creates those with
+//CreateWICTextureFromFile instead and leaves stats zeroed.
+class CompressedTextureLoader
+{
+public:
+	bool Initialize(ID3D11Device* device, JobSystem* jobSystem);
+
+	bool Load(const std::wstring& fileName, const BlockCompressionOptions& options, ID3D11ShaderResourceView** textureView, BlockCompressionStats* stats = nullptr);
+	bool CompressFile(const std::wstring& fileName, const std::wstring& ddsFileName, const BlockCompressionOptions& options, BlockCompressionStats* stats = nullptr);
+
+	//Decodes any WIC supported image to tightly packed RGBA8
+	static bool LoadPixels(const std::wstring& fileName, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height);
+
+private:
+	bool Compress(const std::wstring& fileName, const BlockCompressionOptions& options, std::vector<uint8_t>& ddsFile, BlockCompressionStats* stats);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	BlockCompressor compressor;
+};
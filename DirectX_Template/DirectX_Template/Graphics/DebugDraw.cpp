@@ -0,0 +1,367 @@
+#include "DebugDraw.h"
+#include <DirectXHelpers.h>
+#include <algorithm>
+
+namespace
+{
+	//Edge list shared by BoundingBox/BoundingOrientedBox/BoundingFrustum::GetCorners ordering
+	const size_t cornerEdges[12][2] =
+	{
+		{ 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+		{ 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+	};
+
+	void WriteCornerEdges(VertexPositionColor* vertices, const XMFLOAT3* corners, const XMFLOAT4& color)
+	{
+		for (size_t i = 0; i < 12; i++)
+		{
+			vertices[i * 2] = VertexPositionColor(corners[cornerEdges[i][0]], color);
+			vertices[i * 2 + 1] = VertexPositionColor(corners[cornerEdges[i][1]], color);
+		}
+	}
+}
+
+bool DebugDraw::Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext, size_t maxLinesPerFrame)
+{
+	this->deviceContext = deviceContext;
+	this->lineBudget = maxLinesPerFrame;
+
+	try
+	{
+		//Non-indexed line lists only, but PrimitiveBatch::Draw rejects every call when maxIndices is 0,
+		//so it gets a token index buffer. Draw requires fewer vertices than the buffer holds, and chunks
+		//stay even so a line is never split, giving 65534 vertices per flush. That keeps 100K+ lines
+		//down to a handful of draw calls.
+		this->batchVertices = 65534;
+		this->batch = std::make_unique<PrimitiveBatch<VertexPositionColor>>(deviceContext, 2, this->batchVertices + 2);
+
+		this->states = std::make_unique<CommonStates>(device);
+
+		this->effect = std::make_unique<BasicEffect>(device);
+		this->effect->SetVertexColorEnabled(true);
+
+		HRESULT hr = CreateInputLayoutFromEffect<VertexPositionColor>(device, this->effect.get(), this->inputLayout.ReleaseAndGetAddressOf());
+		COM_ERROR_IF_FAILED(hr, "Failed to create debug draw input layout.");
+	}
+	catch (COMException& exception)
+	{
+		ErrorLogger::Log(exception);
+		return false;
+	}
+	catch (std::exception& exception)
+	{
+		ErrorLogger::Log(exception.what());
+		return false;
+	}
+
+	this->visibleVertices.reserve(this->batchVertices);
+	return true;
+}
+
+VertexPositionColor* DebugDraw::BeginShape(bool depthTest, size_t vertexCount, float lifetime)
+{
+	ShapeList& list = this->lists[depthTest ? CATEGORY_DEPTH : CATEGORY_OVERLAY];
+
+	Shape shape;
+	shape.firstVertex = list.vertices.size();
+	shape.vertexCount = vertexCount;
+	shape.expireTime = this->currentTime + std::max(lifetime, 0.0f);
+	list.shapes.push_back(shape);
+
+	list.vertices.resize(shape.firstVertex + vertexCount);
+	return &list.vertices[shape.firstVertex];
+}
+
+void DebugDraw::EndShape(bool depthTest)
+{
+	ShapeList& list = this->lists[depthTest ? CATEGORY_DEPTH : CATEGORY_OVERLAY];
+	Shape& shape = list.shapes.back();
+	BoundingSphere::CreateFromPoints(shape.bounds, shape.vertexCount, &list.vertices[shape.firstVertex].position, sizeof(VertexPositionColor));
+}
+
+void DebugDraw::AddLine(const XMFLOAT3& from, const XMFLOAT3& to, FXMVECTOR color, float lifetime, bool depthTest)
+{
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, color);
+
+	VertexPositionColor* vertices = this->BeginShape(depthTest, 2, lifetime);
+	vertices[0] = VertexPositionColor(from, c);
+	vertices[1] = VertexPositionColor(to, c);
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddBox(const BoundingBox& box, FXMVECTOR color, float lifetime, bool depthTest)
+{
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, color);
+
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	box.GetCorners(corners);
+
+	WriteCornerEdges(this->BeginShape(depthTest, 24, lifetime), corners, c);
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddBox(const BoundingOrientedBox& box, FXMVECTOR color, float lifetime, bool depthTest)
+{
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, color);
+
+	XMFLOAT3 corners[BoundingOrientedBox::CORNER_COUNT];
+	box.GetCorners(corners);
+
+	WriteCornerEdges(this->BeginShape(depthTest, 24, lifetime), corners, c);
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddSphere(const BoundingSphere& sphere, FXMVECTOR color, float lifetime, bool depthTest, int segments)
+{
+	segments = std::max(segments, 4);
+
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, color);
+
+	//One ring around each axis
+	VertexPositionColor* vertices = this->BeginShape(depthTest, static_cast<size_t>(segments) * 6, lifetime);
+	const XMVECTOR center = XMLoadFloat3(&sphere.Center);
+	const XMVECTOR axes[3][2] =
+	{
+		{ XMVectorSet(sphere.Radius, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, sphere.Radius, 0.0f, 0.0f) },
+		{ XMVectorSet(sphere.Radius, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 0.0f, sphere.Radius, 0.0f) },
+		{ XMVectorSet(0.0f, sphere.Radius, 0.0f, 0.0f), XMVectorSet(0.0f, 0.0f, sphere.Radius, 0.0f) },
+	};
+
+	const float step = XM_2PI / static_cast<float>(segments);
+	for (int ring = 0; ring < 3; ring++)
+	{
+		XMVECTOR previous = center + axes[ring][0];
+		for (int i = 1; i <= segments; i++)
+		{
+			float s, cs;
+			XMScalarSinCos(&s, &cs, step * static_cast<float>(i));
+			XMVECTOR next = center + axes[ring][0] * cs + axes[ring][1] * s;
+
+			XMStoreFloat3(&vertices->position, previous);
+			vertices->color = c;
+			vertices++;
+			XMStoreFloat3(&vertices->position, next);
+			vertices->color = c;
+			vertices++;
+
+			previous = next;
+		}
+	}
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddFrustum(const BoundingFrustum& frustum, FXMVECTOR color, float lifetime, bool depthTest)
+{
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, color);
+
+	XMFLOAT3 corners[BoundingFrustum::CORNER_COUNT];
+	frustum.GetCorners(corners);
+
+	WriteCornerEdges(this->BeginShape(depthTest, 24, lifetime), corners, c);
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddAxes(const XMMATRIX& transform, float size, float lifetime, bool depthTest)
+{
+	XMFLOAT3 origin, x, y, z;
+	XMStoreFloat3(&origin, transform.r[3]);
+	XMStoreFloat3(&x, transform.r[3] + transform.r[0] * size);
+	XMStoreFloat3(&y, transform.r[3] + transform.r[1] * size);
+	XMStoreFloat3(&z, transform.r[3] + transform.r[2] * size);
+
+	VertexPositionColor* vertices = this->BeginShape(depthTest, 6, lifetime);
+	vertices[0] = VertexPositionColor(origin, XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f));
+	vertices[1] = VertexPositionColor(x, XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f));
+	vertices[2] = VertexPositionColor(origin, XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f));
+	vertices[3] = VertexPositionColor(y, XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f));
+	vertices[4] = VertexPositionColor(origin, XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f));
+	vertices[5] = VertexPositionColor(z, XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f));
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddPath(const XMFLOAT3* points, size_t count, FXMVECTOR color, float lifetime, bool depthTest)
+{
+	if (points == nullptr || count < 2)
+		return;
+
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, color);
+
+	VertexPositionColor* vertices = this->BeginShape(depthTest, (count - 1) * 2, lifetime);
+	for (size_t i = 0; i + 1 < count; i++)
+	{
+		vertices[i * 2] = VertexPositionColor(points[i], c);
+		vertices[i * 2 + 1] = VertexPositionColor(points[i + 1], c);
+	}
+	this->EndShape(depthTest);
+}
+
+void DebugDraw::AddText(const XMFLOAT3& position, const std::wstring& text, FXMVECTOR color, float lifetime)
+{
+	Label label;
+	label.position = position;
+	label.text = text;
+	XMStoreFloat4(&label.color, color);
+	label.expireTime = this->currentTime + std::max(lifetime, 0.0f);
+	this->labels.push_back(std::move(label));
+}
+
+void DebugDraw::Update(float deltaSeconds)
+{
+	//Anything whose lifetime has run out (including single frame shapes that were already drawn) is dropped
+	this->currentTime += deltaSeconds;
+
+	for (ShapeList& list : this->lists)
+	{
+		this->Purge(list);
+	}
+
+	const float now = this->currentTime;
+	this->labels.erase(std::remove_if(this->labels.begin(), this->labels.end(),
+		[now](const Label& label) { return label.expireTime <= now; }), this->labels.end());
+}
+
+void DebugDraw::Purge(ShapeList& list)
+{
+	//Stable in-place compaction so persistent shapes keep their submission order
+	size_t writeShape = 0;
+	size_t writeVertex = 0;
+	for (size_t i = 0; i < list.shapes.size(); i++)
+	{
+		Shape shape = list.shapes[i];
+		if (shape.expireTime <= this->currentTime)
+			continue;
+
+		if (shape.firstVertex != writeVertex)
+		{
+			std::copy(list.vertices.begin() + shape.firstVertex, list.vertices.begin() + shape.firstVertex + shape.vertexCount, list.vertices.begin() + writeVertex);
+			shape.firstVertex = writeVertex;
+		}
+		list.shapes[writeShape++] = shape;
+		writeVertex += shape.vertexCount;
+	}
+	list.shapes.resize(writeShape);
+	list.vertices.resize(writeVertex);
+}
+
+size_t DebugDraw::Gather(const ShapeList& list, const BoundingFrustum& frustum, size_t lineBudget)
+{
+	this->visibleVertices.clear();
+
+	size_t lines = 0;
+	for (const Shape& shape : list.shapes)
+	{
+		const size_t shapeLines = shape.vertexCount / 2;
+		if (!frustum.Intersects(shape.bounds))
+		{
+			this->stats.linesCulled += shapeLines;
+			continue;
+		}
+		if (lines + shapeLines > lineBudget)
+		{
+			this->stats.linesOverBudget += shapeLines;
+			continue;
+		}
+
+		this->visibleVertices.insert(this->visibleVertices.end(), list.vertices.begin() + shape.firstVertex, list.vertices.begin() + shape.firstVertex + shape.vertexCount);
+		lines += shapeLines;
+	}
+	return lines;
+}
+
+void DebugDraw::Submit(ID3D11DepthStencilState* depthState)
+{
+	if (this->visibleVertices.empty())
+		return;
+
+	this->deviceContext->OMSetBlendState(this->states->Opaque(), nullptr, 0xFFFFFFFF);
+	this->deviceContext->OMSetDepthStencilState(depthState, 0);
+	this->deviceContext->RSSetState(this->states->CullNone());
+	this->effect->Apply(this->deviceContext);
+	this->deviceContext->IASetInputLayout(this->inputLayout.Get());
+
+	//PrimitiveBatch flushes whenever its vertex buffer fills, so a full chunk equals one draw call
+	this->batch->Begin();
+	for (size_t offset = 0; offset < this->visibleVertices.size(); offset += this->batchVertices)
+	{
+		const size_t count = std::min(this->batchVertices, this->visibleVertices.size() - offset);
+		this->batch->Draw(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, &this->visibleVertices[offset], count);
+		this->stats.drawCalls += 1;
+	}
+	this->batch->End();
+}
+
+void DebugDraw::Draw(const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, SpriteBatch* spriteBatch, SpriteFont* spriteFont)
+{
+	this->stats = DebugDrawStats();
+
+	BoundingFrustum viewFrustum(projectionMatrix);
+	BoundingFrustum worldFrustum;
+	viewFrustum.Transform(worldFrustum, XMMatrixInverse(nullptr, viewMatrix));
+
+	this->effect->SetWorld(XMMatrixIdentity());
+	this->effect->SetView(viewMatrix);
+	this->effect->SetProjection(projectionMatrix);
+
+	//The line budget is shared by both categories, depth tested shapes get first pick
+	size_t remaining = this->lineBudget;
+
+	size_t lines = this->Gather(this->lists[CATEGORY_DEPTH], worldFrustum, remaining);
+	this->stats.linesSubmitted += lines;
+	remaining -= lines;
+	this->Submit(this->states->DepthDefault());
+
+	lines = this->Gather(this->lists[CATEGORY_OVERLAY], worldFrustum, remaining);
+	this->stats.linesSubmitted += lines;
+	this->Submit(this->states->DepthNone());
+
+	if (this->labels.empty() || spriteBatch == nullptr || spriteFont == nullptr)
+		return;
+
+	UINT numViewports = 1;
+	D3D11_VIEWPORT viewport;
+	this->deviceContext->RSGetViewports(&numViewports, &viewport);
+	if (numViewports == 0)
+		return;
+
+	spriteBatch->Begin();
+	for (const Label& label : this->labels)
+	{
+		XMVECTOR position = XMLoadFloat3(&label.position);
+		if (worldFrustum.Contains(position) == DISJOINT)
+			continue;
+
+		XMVECTOR screen = XMVector3Project(position, viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height,
+			viewport.MinDepth, viewport.MaxDepth, projectionMatrix, viewMatrix, XMMatrixIdentity());
+		XMVECTOR origin = spriteFont->MeasureString(label.text.c_str()) * 0.5f;
+		spriteFont->DrawString(spriteBatch, label.text.c_str(), screen, XMLoadFloat4(&label.color), 0.0f, origin);
+		this->stats.labelsSubmitted += 1;
+	}
+	spriteBatch->End();
+}
+
+void DebugDraw::Clear()
+{
+	for (ShapeList& list : this->lists)
+	{
+		list.vertices.clear();
+		list.shapes.clear();
+	}
+	this->labels.clear();
+}
+
+void DebugDraw::SetLineBudget(size_t maxLinesPerFrame)
+{
+	this->lineBudget = maxLinesPerFrame;
+}
+
+const DebugDrawStats& DebugDraw::GetStats() const
+{
+	return this->stats;
+}
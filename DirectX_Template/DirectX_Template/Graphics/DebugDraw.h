@@ -0,0 +1,102 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXCollision.h>
+#include <PrimitiveBatch.h>
+#include <VertexTypes.h>
+#include <Effects.h>
+#include <CommonStates.h>
+#include <SpriteBatch.h>
+#include <SpriteFont.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ErrorLogger.h"
+
+using namespace DirectX;
+
+struct DebugDrawStats
+{
+	size_t linesSubmitted = 0;
+	size_t linesCulled = 0;
+	size_t linesOverBudget = 0;
+	size_t labelsSubmitted = 0;
+	size_t drawCalls = 0;
+};
+
+//Immediate/persistent debug visualization. Shapes are expanded into line lists when added,
+//culled against the camera frustum on the CPU and submitted through one PrimitiveBatch
+//Begin/End per category (depth tested / overlay) each frame.
+class DebugDraw
+{
+public:
+	bool Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext, size_t maxLinesPerFrame = 262144);
+
+	//lifetime is in seconds, 0 means the shape is drawn for a single frame
+	void AddLine(const XMFLOAT3& from, const XMFLOAT3& to, FXMVECTOR color, float lifetime = 0.0f, bool depthTest = true);
+	void AddBox(const BoundingBox& box, FXMVECTOR color, float lifetime = 0.0f, bool depthTest = true);
+	void AddBox(const BoundingOrientedBox& box, FXMVECTOR color, float lifetime = 0.0f, bool depthTest = true);
+	void AddSphere(const BoundingSphere& sphere, FXMVECTOR color, float lifetime = 0.0f, bool depthTest = true, int segments = 24);
+	void AddFrustum(const BoundingFrustum& frustum, FXMVECTOR color, float lifetime = 0.0f, bool depthTest = true);
+	void AddAxes(const XMMATRIX& transform, float size, float lifetime = 0.0f, bool depthTest = true);
+	void AddPath(const XMFLOAT3* points, size_t count, FXMVECTOR color, float lifetime = 0.0f, bool depthTest = true);
+	void AddText(const XMFLOAT3& position, const std::wstring& text, FXMVECTOR color, float lifetime = 0.0f);
+
+	void Update(float deltaSeconds);
+	void Draw(const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, SpriteBatch* spriteBatch, SpriteFont* spriteFont);
+	void Clear();
+
+	void SetLineBudget(size_t maxLinesPerFrame);
+	const DebugDrawStats& GetStats() const;
+
+private:
+	enum Category
+	{
+		CATEGORY_DEPTH = 0,
+		CATEGORY_OVERLAY,
+		CATEGORY_COUNT
+	};
+
+	struct Shape
+	{
+		BoundingSphere bounds;
+		size_t firstVertex = 0;
+		size_t vertexCount = 0;
+		float expireTime = 0.0f;
+	};
+
+	struct Label
+	{
+		XMFLOAT3 position;
+		std::wstring text;
+		XMFLOAT4 color;
+		float expireTime = 0.0f;
+	};
+
+	struct ShapeList
+	{
+		std::vector<VertexPositionColor> vertices;
+		std::vector<Shape> shapes;
+	};
+
+	VertexPositionColor* BeginShape(bool depthTest, size_t vertexCount, float lifetime);
+	void EndShape(bool depthTest);
+	void Purge(ShapeList& list);
+	size_t Gather(const ShapeList& list, const BoundingFrustum& frustum, size_t lineBudget);
+	void Submit(ID3D11DepthStencilState* depthState);
+
+	ID3D11DeviceContext* deviceContext = nullptr;
+	std::unique_ptr<PrimitiveBatch<VertexPositionColor>> batch;
+	std::unique_ptr<BasicEffect> effect;
+	std::unique_ptr<CommonStates> states;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+
+	ShapeList lists[CATEGORY_COUNT];
+	std::vector<Label> labels;
+	std::vector<VertexPositionColor> visibleVertices;
+
+	size_t batchVertices = 0;		//Vertices per PrimitiveBatch::Draw, even so lines stay whole
+	size_t lineBudget = 0;
+	float currentTime = 0.0f;
+	DebugDrawStats stats;
+};
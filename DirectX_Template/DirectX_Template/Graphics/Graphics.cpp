@@ -6,6 +6,9 @@ bool Graphics::Initialize(HWND hwnd, int width, int height)
 	this->windowWidth = width;
 	this->windowHeight = height;
 
+	if (!jobSystem.Initialize())
+		return false;
+
 	if (!InitializeDirectX(hwnd))
 		return false;
 
@@ -23,6 +26,9 @@ bool Graphics::Initialize(HWND hwnd, int width, int height)
 	ImGui_ImplDX11_Init(this->device.Get(), this->deviceContext.Get());
 	ImGui::StyleColorsDark();
 
+	if (!imguiLayer.Initialize(this->device.Get(), this->deviceContext.Get(), this->windowWidth, this->windowHeight))
+		return false;
+
 	return true;
 }
 
@@ -152,6 +158,7 @@ bool Graphics::InitializeDirectX(HWND hwnd)
 		//INIT TEXT AND FONT
 		spriteBatch = std::make_unique<SpriteBatch>(this->deviceContext.Get());
 		spriteFont = std::make_unique<SpriteFont>(this->device.Get(), L"Data/Fonts/consolas_16.spritefont");
+		spriteFont->SetLayoutCacheCapacity(256); //Labels and the FPS counter rarely change between frames
 
 		//CREATE SAMPLER STATE
 		CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
@@ -214,15 +221,22 @@ bool Graphics::InitializeScene()
 	try
 	{
 		//LOAD TEXTURES
-		HRESULT hr = CreateWICTextureFromFile(this->device.Get(), L"Data\\Textures\\seamless_grass.png", nullptr, seamless_grass.GetAddressOf());
-		COM_ERROR_IF_FAILED(hr, "Failed to create WIC texture from file.");
+		//The tiling textures are BC1 compressed with a full mip chain at load
+		if (!textureLoader.Initialize(this->device.Get(), &this->jobSystem))
+			return false;
 
-		hr = CreateWICTextureFromFile(this->device.Get(), L"Data\\Textures\\missing_texture.png", nullptr, pink_texture.GetAddressOf());
-		COM_ERROR_IF_FAILED(hr, "Failed to create WIC texture from file.");
+		BlockCompressionOptions tilingTextureOptions;
+		tilingTextureOptions.wrap = true;
+
+		if (!textureLoader.Load(L"Data\\Textures\\seamless_grass.png", tilingTextureOptions, seamless_grass.GetAddressOf()))
+			return false;
 
-		hr = CreateWICTextureFromFile(this->device.Get(), L"Data\\Textures\\ground_pavement_brick_01.png", nullptr, seamless_tile.GetAddressOf());
+		HRESULT hr = CreateWICTextureFromFile(this->device.Get(), L"Data\\Textures\\missing_texture.png", nullptr, pink_texture.GetAddressOf());
 		COM_ERROR_IF_FAILED(hr, "Failed to create WIC texture from file.");
 
+		if (!textureLoader.Load(L"Data\\Textures\\ground_pavement_brick_01.png", tilingTextureOptions, seamless_tile.GetAddressOf()))
+			return false;
+
 		//INIT SHADERS
 		hr = this->cb_vs_vertexShader.Initialize(this->device.Get(), this->deviceContext.Get());
 		COM_ERROR_IF_FAILED(hr, "Failed to initialize vertex shader.");
@@ -235,6 +249,19 @@ bool Graphics::InitializeScene()
 		{
 			return false;
 		}
+		picker.AddObject(&model.GetTriangleMesh(), model.GetWorldMatrix());
+
+		//INIT DEBUG DRAW
+		if (!debugDraw.Initialize(this->device.Get(), this->deviceContext.Get()))
+		{
+			return false;
+		}
+
+		//INIT OCCLUSION CULLING
+		if (!occlusionCuller.Initialize(&this->jobSystem))
+		{
+			return false;
+		}
 
 		camera.SetPosition(0.0f, 0.0f, -2.0f);
 		camera.SetProjectionValues(90.0f, static_cast<float>(windowWidth) / static_cast<float>(windowHeight), 0.1f, 1000.0f);
@@ -247,6 +274,11 @@ bool Graphics::InitializeScene()
 	return true;
 }
 
+bool Graphics::Pick(int mouseX, int mouseY, PickResult& result)
+{
+	return this->picker.PickFromScreen(this->camera, mouseX, mouseY, this->windowWidth, this->windowHeight, result);
+}
+
 void Graphics::RenderFrame()
 {
 	float color[] = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -268,24 +300,64 @@ void Graphics::RenderFrame()
 
 	UINT offset = 0;
 
+	const XMMATRIX viewProjectionMatrix = camera.GetViewMatrix() * camera.GetProjectionMatrix();
+
+	{ //Occlusion
+		//Occluders are rasterized first, then every object is tested before it is drawn. Testing an
+		//occluder against its own depth is safe, its bounds are never behind its surface.
+		this->occlusionCuller.BeginFrame(viewProjectionMatrix);
+		this->occlusionCuller.AddOccluder(this->model.GetOccluderMesh(), this->model.GetWorldMatrix());
+		this->occlusionCuller.RasterizeOccluders();
+	}
+
 	{ //Tile
-		this->model.Draw(camera.GetViewMatrix() * camera.GetProjectionMatrix());
+		if (this->occlusionCuller.IsVisible(this->model.GetBounds()))
+		{
+			this->model.Draw(viewProjectionMatrix);
+		}
 	}
 
+	this->debugDraw.Draw(camera.GetViewMatrix(), camera.GetProjectionMatrix(), spriteBatch.get(), spriteFont.get());
+
 	//Draw Text
 	static int fpsCounter = 0;
 	static std::string fpsString = "FPS: 0";
+	static SpriteFont::LayoutCacheStatistics layoutStats = {};
+	static size_t layoutStrings = 0;
+	static double layoutHitRate = 0.0;
+	static double layoutMillisecondsSaved = 0.0;
+	static ImGuiLayerStats layerStats;
+	bool sampleStats = false;
 	fpsCounter += 1;
 	if (fpsTimer.GetMillisecondsElapsed() >= 1000.0)
 	{
 		fpsString = "FPS: " + std::to_string(fpsCounter);
 		fpsCounter = 0;
 		fpsTimer.Restart();
+
+		//The UI shows statistics sampled once a second rather than every frame, which would keep it from ever going idle
+		sampleStats = true;
+		layerStats = imguiLayer.GetStats();
+		imguiLayer.Invalidate();
 	}
 	spriteBatch->Begin();
-	spriteFont->DrawString(spriteBatch.get(), StringConverter::StringToWide(fpsString).c_str(), XMFLOAT2(0.0f, 0.0f), Colors::White, 0.0f, XMFLOAT2(0.0f, 0.0f), XMFLOAT2(1.0f, 1.0f));
+	spriteFont->DrawString(spriteBatch.get(), fpsString.c_str(), XMFLOAT2(0.0f, 0.0f), Colors::White, 0.0f, XMFLOAT2(0.0f, 0.0f), XMFLOAT2(1.0f, 1.0f));
 	spriteBatch->End();
 
+	{ //Text layout cache, this frame's lookups are the difference from the last frame's totals
+		const SpriteFont::LayoutCacheStatistics frameEnd = spriteFont->GetLayoutCacheStatistics();
+		if (sampleStats)
+		{
+			const uint64_t hits = frameEnd.hits - layoutStats.hits;
+			const uint64_t lookups = hits + frameEnd.misses - layoutStats.misses;
+			layoutStrings = frameEnd.strings;
+			layoutHitRate = lookups ? 100.0 * hits / lookups : 0.0;
+			//Each reused glyph saves what laying out a glyph has cost on average
+			layoutMillisecondsSaved = frameEnd.glyphsLaidOut ? (frameEnd.glyphsReused - layoutStats.glyphsReused) * frameEnd.layoutMilliseconds / frameEnd.glyphsLaidOut : 0.0;
+		}
+		layoutStats = frameEnd;
+	}
+
 #pragma region ImGui
 
 	///////////////////////////////////////
@@ -294,29 +366,40 @@ void Graphics::RenderFrame()
 
 	static int counter = 0;
 
-	//Start the Dear ImGui frame
-	ImGui_ImplDX11_NewFrame();
+	//Start the Dear ImGui frame. With the layer cache enabled, idle frames skip building the UI.
 	ImGui_ImplWin32_NewFrame();
-	ImGui::NewFrame();
-
-	//Create ImGui Test Window
-	ImGui::Begin("Test");
-	ImGui::Text("This is example text.");
-	if (ImGui::Button("CLICK ME!"))
+	if (imguiLayer.BeginFrame())
 	{
-		counter += 1;
-	}
-	ImGui::SameLine();
-	std::string clickCount = "Click Count: " + std::to_string(counter);
-	ImGui::Text(clickCount.c_str());
+		ImGui_ImplDX11_NewFrame();
+		ImGui::NewFrame();
+
+		//Create ImGui Test Window
+		ImGui::Begin("Test");
+		ImGui::Text("This is example text.");
+		if (ImGui::Button("CLICK ME!"))
+		{
+			counter += 1;
+		}
+		ImGui::SameLine();
+		std::string clickCount = "Click Count: " + std::to_string(counter);
+		ImGui::Text(clickCount.c_str());
+		ImGui::Text("Text layout cache: %zu strings, %.1f%% hits and %.4f ms saved per frame", layoutStrings, layoutHitRate, layoutMillisecondsSaved);
+		bool cacheUI = imguiLayer.IsEnabled();
+		if (ImGui::Checkbox("Cache UI when idle", &cacheUI))
+		{
+			imguiLayer.SetEnabled(cacheUI);
+		}
+		ImGui::Text("UI frames built: %llu, skipped: %llu", layerStats.framesBuilt, layerStats.framesSkipped);
 
-	ImGui::End();
+		ImGui::End();
 
-	//Assemble draw data
-	ImGui::Render();
+		//Assemble draw data
+		ImGui::Render();
 
-	//Render draw data
-	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		//Render draw data, into the cached layer texture when it is enabled
+		imguiLayer.Render(ImGui::GetDrawData());
+	}
+	imguiLayer.Composite(spriteBatch.get());
 
 	///////////////////////////////////////
 	///////////////////////////////////////
@@ -10,13 +10,21 @@
 #include "imgui/imgui_impl_win32.h"
 #include "imgui/imgui_impl_dx11.h"
 #include "Model.h"
+#include "DebugDraw.h"
+#include "ScenePicker.h"
+#include "OcclusionCuller.h"
+#include "CompressedTextureLoader.h"
+#include "ImGuiLayerCache.h"
 
 class Graphics
 {
 public:
 	bool Initialize(HWND hwnd, int width, int height);
 	void RenderFrame();
+	bool Pick(int mouseX, int mouseY, PickResult& result);
 	Camera												camera;
+	DebugDraw											debugDraw;
+	ImGuiLayerCache										imguiLayer;
 
 private:
 
@@ -41,6 +49,11 @@ private:
 
 //Models
 	Model												model;
+	ScenePicker											picker;
+
+//Culling
+	JobSystem											jobSystem;
+	OcclusionCuller										occlusionCuller;
 
 //Buffers
 	ConstantBuffer<CB_VS_VertexShader>					cb_vs_vertexShader;
@@ -59,6 +72,7 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11BlendState>			blendState;
 
 //Textures
+	CompressedTextureLoader								textureLoader;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	pink_texture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	seamless_grass;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	seamless_tile;
@@ -0,0 +1,190 @@
+#include "ImGuiLayerCache.h"
+#include "imgui/imgui_impl_dx11.h"
+#include <cstring>
+
+bool ImGuiLayerCache::InputState::operator==(const InputState& other) const
+{
+	return this->displaySize.x == other.displaySize.x && this->displaySize.y == other.displaySize.y
+		&& this->mousePos.x == other.mousePos.x && this->mousePos.y == other.mousePos.y
+		&& memcmp(this->mouseDown, other.mouseDown, sizeof(this->mouseDown)) == 0
+		&& memcmp(this->keysDown, other.keysDown, sizeof(this->keysDown)) == 0
+		&& memcmp(this->keyModifiers, other.keyModifiers, sizeof(this->keyModifiers)) == 0
+		&& memcmp(this->navInputs, other.navInputs, sizeof(this->navInputs)) == 0;
+}
+
+bool ImGuiLayerCache::Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int width, int height)
+{
+	this->deviceContext = deviceContext;
+
+	try
+	{
+		//ImGui blends with SRC_ALPHA/INV_SRC_ALPHA for color and ONE/INV_SRC_ALPHA for alpha, so drawing
+		//it over transparent black leaves premultiplied color and coverage, ready for SpriteBatch's
+		//default premultiplied alpha blending.
+		CD3D11_TEXTURE2D_DESC textureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+		HRESULT hr = device->CreateTexture2D(&textureDesc, NULL, this->texture.ReleaseAndGetAddressOf());
+		COM_ERROR_IF_FAILED(hr, "Failed to create ImGui layer texture.");
+
+		hr = device->CreateRenderTargetView(this->texture.Get(), NULL, this->renderTargetView.ReleaseAndGetAddressOf());
+		COM_ERROR_IF_FAILED(hr, "Failed to create ImGui layer render target view.");
+
+		hr = device->CreateShaderResourceView(this->texture.Get(), NULL, this->shaderResourceView.ReleaseAndGetAddressOf());
+		COM_ERROR_IF_FAILED(hr, "Failed to create ImGui layer shader resource view.");
+	}
+	catch (COMException& exception)
+	{
+		ErrorLogger::Log(exception);
+		return false;
+	}
+
+	this->invalid = true;
+	return true;
+}
+
+void ImGuiLayerCache::SetEnabled(bool enabled)
+{
+	if (enabled && !this->enabled)
+	{
+		this->invalid = true;
+	}
+	this->enabled = enabled;
+}
+
+bool ImGuiLayerCache::IsEnabled() const
+{
+	return this->enabled;
+}
+
+void ImGuiLayerCache::Invalidate()
+{
+	if (!this->invalid)
+	{
+		this->stats.invalidations++;
+	}
+	this->invalid = true;
+}
+
+bool ImGuiLayerCache::BeginFrame()
+{
+	ImGuiIO& io = ImGui::GetIO();
+
+	InputState input;
+	CaptureInput(input);
+
+	//Wheel and character input are only cleared by ImGui::EndFrame, so while frames are skipped
+	//they accumulate and are still delivered by the next build
+	const bool newInput = io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f || io.InputQueueCharacters.Size > 0 || !(input == this->builtInput);
+
+	if (this->enabled && !this->invalid && this->settled && !newInput && !IsHeld(input))
+	{
+		this->skippedTime += io.DeltaTime;
+		this->stats.framesSkipped++;
+		return false;
+	}
+
+	//ImGui timers (double clicks, key repeat, cursor blink) carry on as if no frame had been skipped
+	io.DeltaTime += this->skippedTime;
+	this->skippedTime = 0.0f;
+	this->builtInput = input;
+	this->invalid = false;
+	this->stats.framesBuilt++;
+	return true;
+}
+
+void ImGuiLayerCache::Render(ImDrawData* drawData)
+{
+	if (!this->enabled)
+	{
+		ImGui_ImplDX11_RenderDrawData(drawData);
+		this->settled = false;
+		return;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> previousTarget;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> previousDepthStencil;
+	this->deviceContext->OMGetRenderTargets(1, previousTarget.GetAddressOf(), previousDepthStencil.GetAddressOf());
+
+	//The texture is still bound as a shader resource from the last Composite
+	ID3D11ShaderResourceView* nullView = nullptr;
+	this->deviceContext->PSSetShaderResources(0, 1, &nullView);
+
+	const float clearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	this->deviceContext->OMSetRenderTargets(1, this->renderTargetView.GetAddressOf(), NULL);
+	this->deviceContext->ClearRenderTargetView(this->renderTargetView.Get(), clearColor);
+	ImGui_ImplDX11_RenderDrawData(drawData);
+	this->deviceContext->OMSetRenderTargets(1, previousTarget.GetAddressOf(), previousDepthStencil.Get());
+
+	//The backend only uploads draw lists that differ from what it already holds, so a build that
+	//uploaded nothing and has the same totals as the previous one drew the same thing. Items being
+	//dragged or edited can change with time alone (key repeat, cursor blink), so they keep building.
+	ImGui_ImplDX11_Stats uploadStats;
+	ImGui_ImplDX11_GetStats(&uploadStats);
+	const bool unchanged = uploadStats.ListsUploaded == 0 && drawData->CmdListsCount == this->builtLists
+		&& drawData->TotalVtxCount == this->builtVertices && drawData->TotalIdxCount == this->builtIndices;
+	const ImGuiIO& io = ImGui::GetIO();
+	this->settled = unchanged && !ImGui::IsAnyItemActive() && !io.WantTextInput;
+	this->capturedMouse = io.WantCaptureMouse;
+	this->capturedKeyboard = io.WantCaptureKeyboard;
+
+	this->builtLists = drawData->CmdListsCount;
+	this->builtVertices = drawData->TotalVtxCount;
+	this->builtIndices = drawData->TotalIdxCount;
+}
+
+void ImGuiLayerCache::Composite(SpriteBatch* spriteBatch)
+{
+	if (!this->enabled)
+		return;
+
+	spriteBatch->Begin();
+	spriteBatch->Draw(this->shaderResourceView.Get(), XMFLOAT2(0.0f, 0.0f));
+	spriteBatch->End();
+}
+
+const ImGuiLayerStats& ImGuiLayerCache::GetStats() const
+{
+	return this->stats;
+}
+
+void ImGuiLayerCache::CaptureInput(InputState& state) const
+{
+	const ImGuiIO& io = ImGui::GetIO();
+
+	state.displaySize = io.DisplaySize;
+	state.mousePos = io.MousePos;
+	memcpy(state.mouseDown, io.MouseDown, sizeof(state.mouseDown));
+	memcpy(state.keysDown, io.KeysDown, sizeof(state.keysDown));
+	state.keyModifiers[0] = io.KeyCtrl;
+	state.keyModifiers[1] = io.KeyShift;
+	state.keyModifiers[2] = io.KeyAlt;
+	state.keyModifiers[3] = io.KeySuper;
+	memcpy(state.navInputs, io.NavInputs, sizeof(state.navInputs));
+}
+
+//Held buttons and keys act over time (drags, key repeat) without any new input arriving. Only
+//those ImGui took for itself count, so keys held to move the camera do not keep the UI building.
+bool ImGuiLayerCache::IsHeld(const InputState& state) const
+{
+	if (this->capturedMouse)
+	{
+		for (bool down : state.mouseDown)
+		{
+			if (down)
+				return true;
+		}
+	}
+	if (this->capturedKeyboard)
+	{
+		for (bool down : state.keysDown)
+		{
+			if (down)
+				return true;
+		}
+		for (float value : state.navInputs)
+		{
+			if (value > 0.0f)
+				return true;
+		}
+	}
+	return false;
+}
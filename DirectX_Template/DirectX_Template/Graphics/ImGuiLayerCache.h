@@ -0,0 +1,79 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <SpriteBatch.h>
+#include <cstdint>
+#include "imgui/imgui.h"
+#include "../ErrorLogger.h"
+
+using namespace DirectX;
+
+struct ImGuiLayerStats
+{
+	uint64_t framesBuilt = 0;			//Frames that ran ImGui::NewFrame/Render
+	uint64_t framesSkipped = 0;			//Idle frames that only composited the cached texture
+	uint64_t invalidations = 0;
+};
+
+//Opt-in caching of the ImGui layer. While enabled, the UI is rendered into an offscreen texture
+//that is composited over the scene every frame, and frames where the UI is idle skip building it
+//altogether. The UI is idle when no input arrived since it was last built, nothing was held or
+//being edited, and the last build produced the same draw data as the one before it, which is how
+//animations and other frame to frame changes are told apart from a settled UI.
+//Changes the application makes to what the UI shows are not seen without a build, so call
+//Invalidate when that data changes.
+class ImGuiLayerCache
+{
+public:
+	bool Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int width, int height);
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const;
+
+	//Forces the next frame to build the UI
+	void Invalidate();
+
+	//Call every frame after ImGui_ImplWin32_NewFrame. Returns true when the UI has to be built this
+	//frame, in which case the caller runs ImGui::NewFrame, its widgets and ImGui::Render, then Render.
+	bool BeginFrame();
+	void Render(ImDrawData* drawData);
+	//Draws the cached UI over the bound render target. Does nothing while disabled.
+	void Composite(SpriteBatch* spriteBatch);
+
+	const ImGuiLayerStats& GetStats() const;
+
+private:
+	//Input as the Win32 backend leaves it in ImGuiIO between frames. Wheel and character input are
+	//consumed by every build, so those are checked directly.
+	struct InputState
+	{
+		ImVec2 displaySize;
+		ImVec2 mousePos;
+		bool mouseDown[5] = {};
+		bool keysDown[512] = {};
+		bool keyModifiers[4] = {};
+		float navInputs[ImGuiNavInput_COUNT] = {};
+
+		bool operator==(const InputState& other) const;
+	};
+
+	void CaptureInput(InputState& state) const;
+	bool IsHeld(const InputState& state) const;
+
+	ID3D11DeviceContext* deviceContext = nullptr;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+
+	bool enabled = false;
+	bool invalid = true;
+	bool settled = false;			//The last build matched the one before it, and nothing was active in it
+	bool capturedMouse = false;		//ImGui wanted the mouse/keyboard in the last build
+	bool capturedKeyboard = false;
+	float skippedTime = 0.0f;		//Seconds since the last build, handed to ImGui as DeltaTime when it resumes
+	InputState builtInput;
+	int builtLists = -1;
+	int builtVertices = -1;
+	int builtIndices = -1;
+	ImGuiLayerStats stats;
+};
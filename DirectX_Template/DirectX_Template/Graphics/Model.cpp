@@ -39,6 +39,11 @@ bool Model::Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext,
 		hr = this->indexBuffer.Initialize(this->device, indicies, ARRAYSIZE(indicies));
 		COM_ERROR_IF_FAILED(hr, "Failed to initalize index buffer.");
 
+		//Keep a CPU copy of the triangles for picking and occlusion culling
+		this->triangleMesh.Build(&rectangle[0].pos, sizeof(Vertex), ARRAYSIZE(rectangle), indicies, ARRAYSIZE(indicies));
+		static_assert(sizeof(DWORD) == sizeof(uint32_t), "Index buffer indices are handed to the occluder as uint32_t");
+		this->occluderMesh.Build(&rectangle[0].pos, sizeof(Vertex), ARRAYSIZE(rectangle), reinterpret_cast<const uint32_t*>(indicies), ARRAYSIZE(indicies));
+		BoundingBox::CreateFromPoints(this->bounds, ARRAYSIZE(rectangle), &rectangle[0].pos, sizeof(Vertex));
 	}
 	catch (COMException& exception)
 	{
@@ -70,6 +75,28 @@ void Model::Draw(const XMMATRIX& viewProjectionMatrix)
 	this->deviceContext->DrawIndexed(this->indexBuffer.BufferSize(), 0, 0);
 }
 
+const TriangleMesh& Model::GetTriangleMesh() const
+{
+	return this->triangleMesh;
+}
+
+const OccluderMesh& Model::GetOccluderMesh() const
+{
+	return this->occluderMesh;
+}
+
+BoundingBox Model::GetBounds() const
+{
+	BoundingBox worldBounds;
+	this->bounds.Transform(worldBounds, this->worldMatrix);
+	return worldBounds;
+}
+
+const XMMATRIX& Model::GetWorldMatrix() const
+{
+	return this->worldMatrix;
+}
+
 void Model::UpdateWorldMatrix()
 {
 	this->worldMatrix = XMMatrixIdentity();
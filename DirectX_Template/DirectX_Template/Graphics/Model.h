@@ -3,6 +3,8 @@
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 #include "ConstantBuffer.h"
+#include "TriangleMesh.h"
+#include "OcclusionCuller.h"
 
 using namespace DirectX;
 
@@ -12,6 +14,11 @@ public:
 	bool Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* texture, ConstantBuffer<CB_VS_VertexShader>& cb_vs_vertexshader);
 	void SetTexture(ID3D11ShaderResourceView* texture);
 	void Draw(const XMMATRIX& viewProjectionMatrix);
+	const TriangleMesh& GetTriangleMesh() const;
+	const OccluderMesh& GetOccluderMesh() const;
+	//World space bounds
+	BoundingBox GetBounds() const;
+	const XMMATRIX& GetWorldMatrix() const;
 
 private:
 	void UpdateWorldMatrix();
@@ -23,6 +30,9 @@ private:
 
 	VertexBuffer<Vertex> vertexBuffer;
 	IndexBuffer indexBuffer;
+	TriangleMesh triangleMesh;
+	OccluderMesh occluderMesh;
+	BoundingBox bounds;		//Model space
 
 	XMMATRIX worldMatrix = XMMatrixIdentity();
 };
\ No newline at end of file
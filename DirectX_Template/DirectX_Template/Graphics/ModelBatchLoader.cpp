@@ -0,0 +1,159 @@
+#include "ModelBatchLoader.h"
+#include "../ErrorLogger.h"
+#include "../Timer.h"
+#include <cwctype>
+
+void ModelBatchLoader::Initialize(ID3D11Device* device, JobSystem* jobSystem, DirectX::IEffectFactory* effectFactory)
+{
+	this->device = device;
+	this->jobSystem = jobSystem;
+	this->effectFactory = effectFactory;
+}
+
+uint32_t ModelBatchLoader::Add(const std::wstring& fileName, uint32_t extraFlags)
+{
+	Request request;
+	request.fileName = fileName;
+	request.extraFlags = extraFlags;
+	this->requests.push_back(std::move(request));
+	return static_cast<uint32_t>(this->requests.size() - 1);
+}
+
+void ModelBatchLoader::Clear()
+{
+	this->requests.clear();
+	this->stats = ModelLoadStats();
+}
+
+void ModelBatchLoader::Load(Request& request) const
+{
+	Timer timer;
+	timer.Start();
+
+	std::wstring extension;
+	const size_t dot = request.fileName.find_last_of(L'.');
+	if (dot != std::wstring::npos)
+	{
+		for (size_t i = dot + 1; i < request.fileName.size(); i++)
+		{
+			extension += static_cast<wchar_t>(std::towlower(request.fileName[i]));
+		}
+	}
+
+	//Loaders throw on bad files, errors are kept and logged on the calling thread
+	try
+	{
+		if (extension == L"cmo")
+		{
+			request.model = DirectX::Model::CreateFromCMO(this->device, request.fileName.c_str(), *this->effectFactory,
+				static_cast<ModelLoaderFlags>(ModelLoader_CounterClockwise | request.extraFlags));
+		}
+		else if (extension == L"sdkmesh")
+		{
+			request.model = DirectX::Model::CreateFromSDKMESH(this->device, request.fileName.c_str(), *this->effectFactory,
+				static_cast<ModelLoaderFlags>(ModelLoader_Clockwise | request.extraFlags));
+		}
+		else if (extension == L"vbo")
+		{
+			request.model = DirectX::Model::CreateFromVBO(this->device, request.fileName.c_str(), nullptr,
+				static_cast<ModelLoaderFlags>(ModelLoader_Clockwise | request.extraFlags));
+		}
+		else
+		{
+			request.error = "Unsupported model file extension.";
+		}
+	}
+	catch (std::exception& exception)
+	{
+		request.model.reset();
+		request.error = exception.what();
+	}
+
+	request.milliseconds = timer.GetMillisecondsElapsed();
+}
+
+bool ModelBatchLoader::LoadAll()
+{
+	if (this->device == nullptr || this->effectFactory == nullptr)
+	{
+		ErrorLogger::Log("ModelBatchLoader used before Initialize.");
+		return false;
+	}
+
+	Timer timer;
+	timer.Start();
+
+	std::vector<uint32_t> pending;
+	for (uint32_t i = 0; i < this->requests.size(); i++)
+	{
+		if (!this->requests[i].done)
+			pending.push_back(i);
+	}
+
+	//One file per job, file sizes vary too much for bigger batches to balance
+	auto loadRange = [this, &pending](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			this->Load(this->requests[pending[i]]);
+		}
+	};
+
+	const uint32_t count = static_cast<uint32_t>(pending.size());
+	if (this->jobSystem != nullptr)
+		this->jobSystem->ParallelFor(count, 1, loadRange);
+	else
+		loadRange(0, count);
+
+	this->stats = ModelLoadStats();
+	this->stats.requested = pending.size();
+	this->stats.totalMilliseconds = timer.GetMillisecondsElapsed();
+
+	bool success = true;
+	for (uint32_t i : pending)
+	{
+		Request& request = this->requests[i];
+		request.done = true;
+		this->stats.summedMilliseconds += request.milliseconds;
+		if (request.model)
+		{
+			this->stats.loaded++;
+		}
+		else
+		{
+			this->stats.failed++;
+			success = false;
+			ErrorLogger::Log(E_FAIL, L"Failed to load model " + request.fileName + L": " + StringConverter::StringToWide(request.error));
+		}
+	}
+	return success;
+}
+
+const DirectX::Model* ModelBatchLoader::GetModel(uint32_t index) const
+{
+	if (index >= this->requests.size())
+		return nullptr;
+
+	return this->requests[index].model.get();
+}
+
+std::unique_ptr<DirectX::Model> ModelBatchLoader::TakeModel(uint32_t index)
+{
+	if (index >= this->requests.size())
+		return nullptr;
+
+	return std::move(this->requests[index].model);
+}
+
+double ModelBatchLoader::GetLoadMilliseconds(uint32_t index) const
+{
+	if (index >= this->requests.size())
+		return 0.0;
+
+	return this->requests[index].milliseconds;
+}
+
+const ModelLoadStats& ModelBatchLoader::GetStats() const
+{
+	return this->stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <Model.h>
+#include <Effects.h>
+#include <d3d11.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../JobSystem.h"
+
+using namespace DirectX;
+
+//Note: like Animation.h this names DirectX::Model in full, the engine has its own Model class
+
+//Covers the last LoadAll only, files loaded by earlier calls are not counted again
+struct ModelLoadStats
+{
+	size_t requested = 0;				//Files LoadAll had left to load
+	size_t loaded = 0;
+	size_t failed = 0;
+	double totalMilliseconds = 0.0;		//Wall time
+	double summedMilliseconds = 0.0;	//Sum of the per-file load times, totalMilliseconds would be this without threads
+};
+
+//Loads many CMO/SDKMESH/VBO files at once on the job system, for example at level start.
+//The format is picked from the file extension and the DirectXTK loaders map the files instead
+//of reading them, so buffers are created straight from the file data.
+class ModelBatchLoader
+{
+public:
+	//effectFactory is shared by all loads and must be thread-safe (EffectFactory and DGSLEffectFactory are)
+	void Initialize(ID3D11Device* device, JobSystem* jobSystem, DirectX::IEffectFactory* effectFactory);
+
+	//extraFlags are added to the format's default winding, returns the index for GetModel/TakeModel
+	uint32_t Add(const std::wstring& fileName, uint32_t extraFlags = DirectX::ModelLoader_PackSmallBuffers);
+	void Clear();
+
+	//Loads every added file that has not been loaded yet, returns false if any of them failed
+	bool LoadAll();
+
+	const DirectX::Model* GetModel(uint32_t index) const;
+	std::unique_ptr<DirectX::Model> TakeModel(uint32_t index);
+	double GetLoadMilliseconds(uint32_t index) const;
+	const ModelLoadStats& GetStats() const;
+
+private:
+	struct Request
+	{
+		std::wstring fileName;
+		uint32_t extraFlags = 0;
+		bool done = false;
+		std::unique_ptr<DirectX::Model> model;
+		std::string error;
+		double milliseconds = 0.0;
+	};
+
+	void Load(Request& request) const;
+
+	ID3D11Device* device = nullptr;
+	JobSystem* jobSystem = nullptr;
+	DirectX::IEffectFactory* effectFactory = nullptr;
+	std::vector<Request> requests;
+	ModelLoadStats stats;
+};
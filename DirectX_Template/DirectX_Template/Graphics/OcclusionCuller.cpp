@@ -0,0 +1,444 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+const int OcclusionCuller::TILE_SIZE;
+
+namespace
+{
+	inline uint32_t XM_CALLCONV MoveMask(FXMVECTOR v)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		return static_cast<uint32_t>(_mm_movemask_ps(v));
+#else
+		XMUINT4 m;
+		XMStoreUInt4(&m, v);
+		return (m.x >> 31) | ((m.y >> 31) << 1) | ((m.z >> 31) << 2) | ((m.w >> 31) << 3);
+#endif
+	}
+
+	inline XMVECTOR XM_CALLCONV ColumnMask(FXMVECTOR columns, int minX, int maxX)
+	{
+		return XMVectorAndInt(XMVectorGreaterOrEqual(columns, XMVectorReplicate(static_cast<float>(minX))),
+			XMVectorLessOrEqual(columns, XMVectorReplicate(static_cast<float>(maxX))));
+	}
+
+	//Clip space w below this is treated as touching the eye plane
+	const float MIN_CLIP_W = 1e-6f;
+}
+
+void OccluderMesh::Build(const XMFLOAT3* positions, size_t positionStride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	this->Clear();
+	if (positions == nullptr || indices == nullptr)
+		return;
+
+	this->positions.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		this->positions[i] = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + positionStride * i);
+	}
+	this->indices.assign(indices, indices + indexCount - indexCount % 3);
+}
+
+void OccluderMesh::Clear()
+{
+	this->positions.clear();
+	this->indices.clear();
+}
+
+const std::vector<XMFLOAT3>& OccluderMesh::GetPositions() const
+{
+	return this->positions;
+}
+
+const std::vector<uint32_t>& OccluderMesh::GetIndices() const
+{
+	return this->indices;
+}
+
+bool OcclusionCuller::Initialize(JobSystem* jobSystem, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	this->jobSystem = jobSystem;
+	this->tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	this->tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	this->width = this->tilesX * TILE_SIZE;
+	this->height = this->tilesY * TILE_SIZE;
+
+	this->depth.assign(static_cast<size_t>(this->width) * this->height, 1.0f);
+	this->tileMaxDepth.assign(static_cast<size_t>(this->tilesX) * this->tilesY, 1.0f);
+	XMStoreFloat4x4(&this->viewProjection, XMMatrixIdentity());
+	return true;
+}
+
+void OcclusionCuller::BeginFrame(const XMMATRIX& viewProjectionMatrix)
+{
+	XMStoreFloat4x4(&this->viewProjection, viewProjectionMatrix);
+	this->triangles.clear();
+	this->occluderTriangles = 0;
+	this->occludeesTested = 0;
+	this->occludeesCulled = 0;
+}
+
+void OcclusionCuller::AddOccluder(const XMFLOAT3* positions, size_t positionStride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const XMMATRIX& worldMatrix)
+{
+	if (positions == nullptr || indices == nullptr || vertexCount == 0)
+		return;
+
+	const XMMATRIX worldViewProjection = worldMatrix * XMLoadFloat4x4(&this->viewProjection);
+
+	//Transform every vertex once, triangles then only gather
+	std::vector<XMFLOAT4> clipPositions(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3* position = reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + positionStride * i);
+		XMStoreFloat4(&clipPositions[i], XMVector4Transform(XMVectorSet(position->x, position->y, position->z, 1.0f), worldViewProjection));
+	}
+
+	const uint32_t triangleCount = indexCount / 3;
+	this->occluderTriangles += triangleCount;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t i0 = indices[t * 3];
+		const uint32_t i1 = indices[t * 3 + 1];
+		const uint32_t i2 = indices[t * 3 + 2];
+		if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+			continue;
+
+		this->SetupTriangle(XMLoadFloat4(&clipPositions[i0]), XMLoadFloat4(&clipPositions[i1]), XMLoadFloat4(&clipPositions[i2]));
+	}
+}
+
+void OcclusionCuller::AddOccluder(const OccluderMesh& mesh, const XMMATRIX& worldMatrix)
+{
+	const std::vector<XMFLOAT3>& positions = mesh.GetPositions();
+	const std::vector<uint32_t>& indices = mesh.GetIndices();
+	if (positions.empty() || indices.empty())
+		return;
+
+	this->AddOccluder(positions.data(), sizeof(XMFLOAT3), static_cast<uint32_t>(positions.size()), indices.data(), static_cast<uint32_t>(indices.size()), worldMatrix);
+}
+
+void OcclusionCuller::SetupTriangle(FXMVECTOR clip0, FXMVECTOR clip1, FXMVECTOR clip2)
+{
+	XMFLOAT4 clip[3];
+	XMStoreFloat4(&clip[0], clip0);
+	XMStoreFloat4(&clip[1], clip1);
+	XMStoreFloat4(&clip[2], clip2);
+
+	//Occluders are not clipped, triangles reaching in front of the near plane are dropped.
+	//Losing an occluder only makes the result less tight, never wrong.
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; i++)
+	{
+		if (clip[i].z < 0.0f || clip[i].w <= MIN_CLIP_W)
+			return;
+
+		const float invW = 1.0f / clip[i].w;
+		x[i] = (clip[i].x * invW * 0.5f + 0.5f) * this->width;
+		y[i] = (0.5f - clip[i].y * invW * 0.5f) * this->height;
+		z[i] = clip[i].z * invW;
+	}
+
+	if (z[0] > 1.0f && z[1] > 1.0f && z[2] > 1.0f)
+		return;
+
+	const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (std::fabs(area) < 1e-8f)
+		return;
+
+	//Pixels are sampled at their centers, bounds are the first and last covered centers
+	Triangle triangle;
+	triangle.minX = std::max(0, static_cast<int>(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f)));
+	triangle.minY = std::max(0, static_cast<int>(std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f)));
+	triangle.maxX = std::min(this->width - 1, static_cast<int>(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f)));
+	triangle.maxY = std::min(this->height - 1, static_cast<int>(std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f)));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	//Edge i runs from vertex i to vertex i + 1, oriented so the inside is positive for either winding,
+	//and offset so evaluating it at integer pixel coordinates samples the pixel center.
+	//Top-left fill rule: centers exactly on a top or left edge belong to the triangle, so meshes are watertight.
+	const float orientation = area > 0.0f ? 1.0f : -1.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		const int j = (i + 1) % 3;
+		const float a = (y[i] - y[j]) * orientation;
+		const float b = (x[j] - x[i]) * orientation;
+		const float c = (x[i] * y[j] - y[i] * x[j]) * orientation;
+		const bool topLeft = a > 0.0f || (a == 0.0f && b > 0.0f);
+		triangle.edgeA[i] = a;
+		triangle.edgeB[i] = b;
+		triangle.edgeC[i] = c + 0.5f * (a + b);
+		triangle.edgeMin[i] = topLeft ? 0.0f : FLT_MIN;
+	}
+
+	//Depth plane, evaluated at integer pixel coordinates as the farthest depth the triangle can reach inside
+	//that pixel, so occludees that really are in front of the occluder never test behind it
+	const float invArea = 1.0f / area;
+	triangle.depthDx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invArea;
+	triangle.depthDy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invArea;
+	triangle.depthBase = z[0] + triangle.depthDx * (0.5f - x[0]) + triangle.depthDy * (0.5f - y[0])
+		+ 0.5f * (std::fabs(triangle.depthDx) + std::fabs(triangle.depthDy));
+	triangle.depthMax = std::max({ z[0], z[1], z[2] });
+
+	this->triangles.push_back(triangle);
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+	if (this->jobSystem != nullptr)
+	{
+		this->jobSystem->ParallelFor(static_cast<uint32_t>(this->tilesY), 1, [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t tileY = begin; tileY < end; tileY++)
+			{
+				this->RasterizeTileRow(static_cast<int>(tileY));
+			}
+		});
+	}
+	else
+	{
+		for (int tileY = 0; tileY < this->tilesY; tileY++)
+		{
+			this->RasterizeTileRow(tileY);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTileRow(int tileY)
+{
+	//Each job owns a full row of tiles, so no two jobs write the same pixels
+	const size_t rowSize = static_cast<size_t>(this->tilesX) * TILE_SIZE * TILE_SIZE;
+	std::fill(this->depth.begin() + rowSize * tileY, this->depth.begin() + rowSize * (tileY + 1), 1.0f);
+
+	const int rowMinY = tileY * TILE_SIZE;
+	const int rowMaxY = rowMinY + TILE_SIZE - 1;
+	for (const Triangle& triangle : this->triangles)
+	{
+		if (triangle.maxY < rowMinY || triangle.minY > rowMaxY)
+			continue;
+
+		const int lastTileX = triangle.maxX / TILE_SIZE;
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= lastTileX; tileX++)
+		{
+			this->RasterizeTriangleTile(triangle, tileX, tileY);
+		}
+	}
+
+	//Hierarchical Z: the farthest depth in each tile
+	for (int tileX = 0; tileX < this->tilesX; tileX++)
+	{
+		const float* tile = this->TileDepth(tileX, tileY);
+		XMVECTOR maxDepth = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(tile));
+		for (int i = 4; i < TILE_SIZE * TILE_SIZE; i += 4)
+		{
+			maxDepth = XMVectorMax(maxDepth, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(tile + i)));
+		}
+		XMFLOAT4 lanes;
+		XMStoreFloat4(&lanes, maxDepth);
+		this->tileMaxDepth[tileY * this->tilesX + tileX] = std::max(std::max(lanes.x, lanes.y), std::max(lanes.z, lanes.w));
+	}
+}
+
+void OcclusionCuller::RasterizeTriangleTile(const Triangle& triangle, int tileX, int tileY)
+{
+	const int tileMinX = tileX * TILE_SIZE;
+	const int tileMinY = tileY * TILE_SIZE;
+	const int minX = std::max(triangle.minX, tileMinX);
+	const int maxX = std::min(triangle.maxX, tileMinX + TILE_SIZE - 1);
+	const int minY = std::max(triangle.minY, tileMinY);
+	const int maxY = std::min(triangle.maxY, tileMinY + TILE_SIZE - 1);
+	if (minX > maxX || minY > maxY)
+		return;
+
+	//Skip the tile when every covered pixel position is outside one of the edges
+	for (int i = 0; i < 3; i++)
+	{
+		const float a = triangle.edgeA[i];
+		const float b = triangle.edgeB[i];
+		const float best = triangle.edgeC[i] + a * (a > 0.0f ? maxX : minX) + b * (b > 0.0f ? maxY : minY);
+		if (best < triangle.edgeMin[i])
+			return;
+	}
+
+	const XMVECTOR edgeB0 = XMVectorReplicate(triangle.edgeB[0]);
+	const XMVECTOR edgeB1 = XMVectorReplicate(triangle.edgeB[1]);
+	const XMVECTOR edgeB2 = XMVectorReplicate(triangle.edgeB[2]);
+	const XMVECTOR edgeMin0 = XMVectorReplicate(triangle.edgeMin[0]);
+	const XMVECTOR edgeMin1 = XMVectorReplicate(triangle.edgeMin[1]);
+	const XMVECTOR edgeMin2 = XMVectorReplicate(triangle.edgeMin[2]);
+	const XMVECTOR depthDy = XMVectorReplicate(triangle.depthDy);
+	const XMVECTOR depthMax = XMVectorReplicate(triangle.depthMax);
+
+	float* tile = this->TileDepth(tileX, tileY);
+	for (int half = 0; half < TILE_SIZE; half += 4)
+	{
+		const XMVECTOR columns = XMVectorAdd(XMVectorReplicate(static_cast<float>(tileMinX + half)), XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f));
+		const XMVECTOR columnMask = ColumnMask(columns, minX, maxX);
+		if (MoveMask(columnMask) == 0)
+			continue;
+
+		//Row invariant part of the edge and depth equations for these four columns
+		const XMVECTOR edgeX0 = XMVectorMultiplyAdd(XMVectorReplicate(triangle.edgeA[0]), columns, XMVectorReplicate(triangle.edgeC[0]));
+		const XMVECTOR edgeX1 = XMVectorMultiplyAdd(XMVectorReplicate(triangle.edgeA[1]), columns, XMVectorReplicate(triangle.edgeC[1]));
+		const XMVECTOR edgeX2 = XMVectorMultiplyAdd(XMVectorReplicate(triangle.edgeA[2]), columns, XMVectorReplicate(triangle.edgeC[2]));
+		const XMVECTOR depthX = XMVectorMultiplyAdd(XMVectorReplicate(triangle.depthDx), columns, XMVectorReplicate(triangle.depthBase));
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			const XMVECTOR row = XMVectorReplicate(static_cast<float>(y));
+			XMVECTOR inside = XMVectorAndInt(columnMask, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeB0, row, edgeX0), edgeMin0));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeB1, row, edgeX1), edgeMin1));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeB2, row, edgeX2), edgeMin2));
+			if (MoveMask(inside) == 0)
+				continue;
+
+			XMFLOAT4* pixels = reinterpret_cast<XMFLOAT4*>(tile + (y - tileMinY) * TILE_SIZE + half);
+			const XMVECTOR current = XMLoadFloat4(pixels);
+			const XMVECTOR triangleDepth = XMVectorMin(XMVectorMultiplyAdd(depthDy, row, depthX), depthMax);
+			XMStoreFloat4(pixels, XMVectorSelect(current, XMVectorMin(current, triangleDepth), inside));
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const BoundingBox& box) const
+{
+	this->occludeesTested.fetch_add(1, std::memory_order_relaxed);
+
+	const XMMATRIX viewProjectionMatrix = XMLoadFloat4x4(&this->viewProjection);
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		const XMVECTOR position = XMVectorSet(
+			box.Center.x + ((corner & 1) ? box.Extents.x : -box.Extents.x),
+			box.Center.y + ((corner & 2) ? box.Extents.y : -box.Extents.y),
+			box.Center.z + ((corner & 4) ? box.Extents.z : -box.Extents.z),
+			1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(position, viewProjectionMatrix));
+
+		//Boxes crossing the near plane cannot be projected safely, treat them as visible
+		if (clip.z < 0.0f || clip.w <= MIN_CLIP_W)
+			return true;
+
+		const float invW = 1.0f / clip.w;
+		const float x = (clip.x * invW * 0.5f + 0.5f) * this->width;
+		const float y = (0.5f - clip.y * invW * 0.5f) * this->height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	//Entirely outside the view
+	if (maxX < 0.0f || maxY < 0.0f || minX > this->width || minY > this->height || minZ > 1.0f)
+	{
+		this->occludeesCulled.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	//Every pixel the projected box touches, grown by one pixel. Occluder coverage is sampled at pixel
+	//centers, so a box can peek past an occluder edge by up to a pixel; the neighbour beyond the edge catches it.
+	const int pixelMinX = std::max(0, static_cast<int>(std::floor(minX)) - 1);
+	const int pixelMinY = std::max(0, static_cast<int>(std::floor(minY)) - 1);
+	const int pixelMaxX = std::min(this->width - 1, std::max(pixelMinX, static_cast<int>(std::ceil(maxX))));
+	const int pixelMaxY = std::min(this->height - 1, std::max(pixelMinY, static_cast<int>(std::ceil(maxY))));
+
+	const XMVECTOR boxDepth = XMVectorReplicate(minZ);
+	for (int tileY = pixelMinY / TILE_SIZE; tileY <= pixelMaxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = pixelMinX / TILE_SIZE; tileX <= pixelMaxX / TILE_SIZE; tileX++)
+		{
+			//The box is behind the farthest occluder depth of the whole tile
+			if (minZ > this->tileMaxDepth[tileY * this->tilesX + tileX])
+				continue;
+
+			const int tileMinX = tileX * TILE_SIZE;
+			const int tileMinY = tileY * TILE_SIZE;
+			const int rowBegin = std::max(pixelMinY, tileMinY);
+			const int rowEnd = std::min(pixelMaxY, tileMinY + TILE_SIZE - 1);
+			const float* tile = this->TileDepth(tileX, tileY);
+			for (int half = 0; half < TILE_SIZE; half += 4)
+			{
+				const XMVECTOR columns = XMVectorAdd(XMVectorReplicate(static_cast<float>(tileMinX + half)), XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f));
+				const XMVECTOR columnMask = ColumnMask(columns, pixelMinX, pixelMaxX);
+				if (MoveMask(columnMask) == 0)
+					continue;
+
+				for (int y = rowBegin; y <= rowEnd; y++)
+				{
+					const XMVECTOR pixels = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(tile + (y - tileMinY) * TILE_SIZE + half));
+					if (MoveMask(XMVectorAndInt(columnMask, XMVectorLessOrEqual(boxDepth, pixels))) != 0)
+						return true;
+				}
+			}
+		}
+	}
+
+	this->occludeesCulled.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void OcclusionCuller::TestVisibility(const BoundingBox* boxes, uint32_t count, bool* visible)
+{
+	if (boxes == nullptr || visible == nullptr)
+		return;
+
+	auto testRange = [this, boxes, visible](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			visible[i] = this->IsVisible(boxes[i]);
+		}
+	};
+
+	if (this->jobSystem != nullptr)
+		this->jobSystem->ParallelFor(count, 64, testRange);
+	else
+		testRange(0, count);
+}
+
+float OcclusionCuller::GetDepth(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= this->width || y >= this->height)
+		return 1.0f;
+
+	return this->TileDepth(x / TILE_SIZE, y / TILE_SIZE)[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+}
+
+int OcclusionCuller::GetWidth() const
+{
+	return this->width;
+}
+
+int OcclusionCuller::GetHeight() const
+{
+	return this->height;
+}
+
+OcclusionStats OcclusionCuller::GetStats() const
+{
+	OcclusionStats stats;
+	stats.occluderTriangles = this->occluderTriangles;
+	stats.trianglesRasterized = this->triangles.size();
+	stats.occludeesTested = this->occludeesTested.load(std::memory_order_relaxed);
+	stats.occludeesCulled = this->occludeesCulled.load(std::memory_order_relaxed);
+	return stats;
+}
+
+float* OcclusionCuller::TileDepth(int tileX, int tileY)
+{
+	return this->depth.data() + (static_cast<size_t>(tileY) * this->tilesX + tileX) * TILE_SIZE * TILE_SIZE;
+}
+
+const float* OcclusionCuller::TileDepth(int tileX, int tileY) const
+{
+	return this->depth.data() + (static_cast<size_t>(tileY) * this->tilesX + tileX) * TILE_SIZE * TILE_SIZE;
+}
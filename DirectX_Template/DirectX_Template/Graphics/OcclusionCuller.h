@@ -0,0 +1,100 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "../JobSystem.h"
+
+using namespace DirectX;
+
+struct OcclusionStats
+{
+	size_t occluderTriangles = 0;		//Triangles submitted through AddOccluder
+	size_t trianglesRasterized = 0;		//Triangles that survived clipping and setup
+	size_t occludeesTested = 0;
+	size_t occludeesCulled = 0;
+};
+
+//CPU copy of a mesh that is used as an occluder. Occluders are usually simplified versions of
+//large opaque geometry (walls, floors, terrain), not the render mesh itself.
+class OccluderMesh
+{
+public:
+	void Build(const XMFLOAT3* positions, size_t positionStride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	void Clear();
+
+	const std::vector<XMFLOAT3>& GetPositions() const;
+	const std::vector<uint32_t>& GetIndices() const;
+
+private:
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+};
+
+//Software occlusion culling. Occluder triangles are rasterized into a low resolution depth
+//buffer (stored in 8x8 pixel tiles) with half-space edge functions, four pixels per SIMD step.
+//Each tile keeps its farthest depth as a hierarchical Z value, so most occludee tests resolve
+//against the tile without touching pixels.
+//Occluders write the farthest depth they reach inside each covered pixel, occludees are tested
+//against every pixel they touch plus a one pixel border, and occludees crossing the near plane
+//are always visible, so errors only ever go towards drawing too much.
+class OcclusionCuller
+{
+public:
+	static const int TILE_SIZE = 8;
+
+	//width and height are rounded up to multiples of TILE_SIZE. jobSystem may be null.
+	bool Initialize(JobSystem* jobSystem, int width = 256, int height = 128);
+
+	void BeginFrame(const XMMATRIX& viewProjectionMatrix);
+	void AddOccluder(const XMFLOAT3* positions, size_t positionStride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const XMMATRIX& worldMatrix);
+	void AddOccluder(const OccluderMesh& mesh, const XMMATRIX& worldMatrix);
+	void RasterizeOccluders();
+
+	//box is in world space. Must be called after RasterizeOccluders.
+	bool IsVisible(const BoundingBox& box) const;
+	void TestVisibility(const BoundingBox* boxes, uint32_t count, bool* visible);
+
+	float GetDepth(int x, int y) const;
+	int GetWidth() const;
+	int GetHeight() const;
+	OcclusionStats GetStats() const;
+
+private:
+	//Screen space triangle prepared for rasterization. Edge functions are oriented so the
+	//inside is positive, edge and depth planes are relative to the center of pixel (0, 0).
+	struct Triangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float edgeMin[3];		//0 for top-left edges, smallest positive float otherwise
+		float depthBase;
+		float depthDx;
+		float depthDy;
+		float depthMax;
+		int minX, minY, maxX, maxY;		//Inclusive pixel bounds, clamped to the buffer
+	};
+
+	void SetupTriangle(FXMVECTOR clip0, FXMVECTOR clip1, FXMVECTOR clip2);
+	void RasterizeTileRow(int tileY);
+	void RasterizeTriangleTile(const Triangle& triangle, int tileX, int tileY);
+	float* TileDepth(int tileX, int tileY);
+	const float* TileDepth(int tileX, int tileY) const;
+
+	JobSystem* jobSystem = nullptr;
+	int width = 0;
+	int height = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+
+	XMFLOAT4X4 viewProjection;
+	std::vector<Triangle> triangles;
+	std::vector<float> depth;		//Tile major, TILE_SIZE * TILE_SIZE floats per tile
+	std::vector<float> tileMaxDepth;
+
+	size_t occluderTriangles = 0;
+	mutable std::atomic<size_t> occludeesTested{ 0 };
+	mutable std::atomic<size_t> occludeesCulled{ 0 };
+};
@@ -0,0 +1,99 @@
+#include "ScenePicker.h"
+#include <cfloat>
+
+uint32_t ScenePicker::AddObject(const TriangleMesh* mesh, const XMMATRIX& worldMatrix)
+{
+	Object object;
+	object.mesh = mesh;
+	this->UpdateBounds(object, worldMatrix);
+	this->objects.push_back(object);
+
+	//New objects change the object set, so the BVH is rebuilt before the next pick
+	this->needsBuild = true;
+	return static_cast<uint32_t>(this->objects.size() - 1);
+}
+
+void ScenePicker::SetTransform(uint32_t object, const XMMATRIX& worldMatrix)
+{
+	if (object >= this->objects.size())
+		return;
+
+	this->UpdateBounds(this->objects[object], worldMatrix);
+	if (!this->needsBuild)
+		this->bvh.UpdateObject(object, this->objects[object].worldBounds);
+}
+
+void ScenePicker::Clear()
+{
+	this->objects.clear();
+	this->bvh.Clear();
+	this->needsBuild = false;
+}
+
+void ScenePicker::UpdateBounds(Object& object, const XMMATRIX& worldMatrix)
+{
+	XMStoreFloat4x4(&object.inverseWorld, XMMatrixInverse(nullptr, worldMatrix));
+	object.mesh->GetBounds().Transform(object.worldBounds, worldMatrix);
+}
+
+bool ScenePicker::Pick(FXMVECTOR rayOrigin, FXMVECTOR rayDirection, float maxDistance, PickResult& result)
+{
+	result = PickResult();
+	if (this->objects.empty())
+		return false;
+
+	if (this->needsBuild)
+	{
+		std::vector<BoundingBox> bounds;
+		bounds.reserve(this->objects.size());
+		for (const Object& object : this->objects)
+		{
+			bounds.push_back(object.worldBounds);
+		}
+		this->bvh.Build(bounds.data(), static_cast<uint32_t>(bounds.size()));
+		this->needsBuild = false;
+	}
+	else
+	{
+		this->bvh.Refit();
+	}
+
+	SimpleMath::Ray ray;
+	XMStoreFloat3(&ray.position, rayOrigin);
+	XMStoreFloat3(&ray.direction, rayDirection);
+
+	float distance = maxDistance;
+	uint32_t hitObject = BVH::INVALID_INDEX;
+	this->bvh.Raycast(ray, distance, hitObject, [&](uint32_t index, float& objectDistance)
+	{
+		//Direction is transformed without renormalizing, so distances stay in world units
+		const Object& object = this->objects[index];
+		const XMMATRIX inverseWorld = XMLoadFloat4x4(&object.inverseWorld);
+		const XMVECTOR localOrigin = XMVector3TransformCoord(rayOrigin, inverseWorld);
+		const XMVECTOR localDirection = XMVector3TransformNormal(rayDirection, inverseWorld);
+
+		uint32_t triangle;
+		XMFLOAT2 barycentrics;
+		if (!object.mesh->Intersect(localOrigin, localDirection, objectDistance, triangle, barycentrics))
+			return false;
+
+		result.triangle = triangle;
+		result.barycentrics = barycentrics;
+		return true;
+	});
+
+	if (hitObject == BVH::INVALID_INDEX)
+		return false;
+
+	result.object = hitObject;
+	result.distance = distance;
+	XMStoreFloat3(&result.position, XMVectorMultiplyAdd(rayDirection, XMVectorReplicate(distance), rayOrigin));
+	return true;
+}
+
+bool ScenePicker::PickFromScreen(const Camera& camera, int mouseX, int mouseY, int screenWidth, int screenHeight, PickResult& result)
+{
+	XMVECTOR rayOrigin, rayDirection;
+	camera.ScreenToRay(static_cast<float>(mouseX), static_cast<float>(mouseY), static_cast<float>(screenWidth), static_cast<float>(screenHeight), rayOrigin, rayDirection);
+	return this->Pick(rayOrigin, rayDirection, FLT_MAX, result);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "TriangleMesh.h"
+#include "Camera.h"
+
+struct PickResult
+{
+	uint32_t object = BVH::INVALID_INDEX;
+	uint32_t triangle = BVH::INVALID_INDEX;
+	float distance = 0.0f;
+	XMFLOAT2 barycentrics = XMFLOAT2(0.0f, 0.0f);	//Weights of the triangle's second and third vertices
+	XMFLOAT3 position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+};
+
+//Mouse/ray picking against placed triangle meshes. A BVH over the objects' world bounds finds
+//candidates front to back, then the ray is moved into each candidate's model space and tested
+//against that mesh's own triangle BVH.
+class ScenePicker
+{
+public:
+	uint32_t AddObject(const TriangleMesh* mesh, const XMMATRIX& worldMatrix);
+	void SetTransform(uint32_t object, const XMMATRIX& worldMatrix);
+	void Clear();
+
+	bool Pick(FXMVECTOR rayOrigin, FXMVECTOR rayDirection, float maxDistance, PickResult& result);
+	bool PickFromScreen(const Camera& camera, int mouseX, int mouseY, int screenWidth, int screenHeight, PickResult& result);
+
+private:
+	struct Object
+	{
+		const TriangleMesh* mesh = nullptr;
+		XMFLOAT4X4 inverseWorld;
+		BoundingBox worldBounds;
+	};
+
+	void UpdateBounds(Object& object, const XMMATRIX& worldMatrix);
+
+	std::vector<Object> objects;
+	BVH bvh;
+	bool needsBuild = false;
+};
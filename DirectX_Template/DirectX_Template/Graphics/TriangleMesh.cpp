@@ -0,0 +1,179 @@
+#include "TriangleMesh.h"
+#include <cfloat>
+
+void TriangleMesh::Build(const XMFLOAT3* positions, size_t positionStride, uint32_t vertexCount, const DWORD* indices, uint32_t indexCount)
+{
+	this->Clear();
+	if (positions == nullptr || indices == nullptr || vertexCount == 0)
+		return;
+
+	auto position = [&](DWORD index)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + positionStride * index));
+	};
+
+	const uint32_t triangleCount = indexCount / 3;
+	this->vertex0.reserve(triangleCount);
+	this->edge1.reserve(triangleCount);
+	this->edge2.reserve(triangleCount);
+	this->sourceTriangle.reserve(triangleCount);
+
+	std::vector<BoundingBox> triangleBounds;
+	triangleBounds.reserve(triangleCount);
+
+	XMVECTOR meshMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR meshMax = XMVectorReplicate(-FLT_MAX);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const DWORD i0 = indices[t * 3];
+		const DWORD i1 = indices[t * 3 + 1];
+		const DWORD i2 = indices[t * 3 + 2];
+		if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+			continue;
+
+		const XMVECTOR p0 = position(i0);
+		const XMVECTOR p1 = position(i1);
+		const XMVECTOR p2 = position(i2);
+
+		XMFLOAT3 v;
+		XMStoreFloat3(&v, p0);
+		this->vertex0.push_back(v);
+		XMStoreFloat3(&v, XMVectorSubtract(p1, p0));
+		this->edge1.push_back(v);
+		XMStoreFloat3(&v, XMVectorSubtract(p2, p0));
+		this->edge2.push_back(v);
+		this->sourceTriangle.push_back(t);
+
+		const XMVECTOR triMin = XMVectorMin(XMVectorMin(p0, p1), p2);
+		const XMVECTOR triMax = XMVectorMax(XMVectorMax(p0, p1), p2);
+		BoundingBox box;
+		BoundingBox::CreateFromPoints(box, triMin, triMax);
+		triangleBounds.push_back(box);
+
+		meshMin = XMVectorMin(meshMin, triMin);
+		meshMax = XMVectorMax(meshMax, triMax);
+	}
+
+	if (triangleBounds.empty())
+		return;
+
+	BoundingBox::CreateFromPoints(this->bounds, meshMin, meshMax);
+	this->bvh.Build(triangleBounds.data(), static_cast<uint32_t>(triangleBounds.size()));
+}
+
+void TriangleMesh::Clear()
+{
+	this->vertex0.clear();
+	this->edge1.clear();
+	this->edge2.clear();
+	this->sourceTriangle.clear();
+	this->bvh.Clear();
+	this->bounds = BoundingBox();
+}
+
+bool TriangleMesh::Intersect(FXMVECTOR origin, FXMVECTOR direction, float& distance, uint32_t& triangle, XMFLOAT2& barycentrics) const
+{
+	triangle = BVH::INVALID_INDEX;
+
+	SimpleMath::Ray ray;
+	XMStoreFloat3(&ray.position, origin);
+	XMStoreFloat3(&ray.direction, direction);
+
+	const XMVECTOR dirX = XMVectorSplatX(direction);
+	const XMVECTOR dirY = XMVectorSplatY(direction);
+	const XMVECTOR dirZ = XMVectorSplatZ(direction);
+	const XMVECTOR originX = XMVectorSplatX(origin);
+	const XMVECTOR originY = XMVectorSplatY(origin);
+	const XMVECTOR originZ = XMVectorSplatZ(origin);
+	const XMVECTOR epsilon = XMVectorReplicate(1e-12f);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+
+	this->bvh.RaycastLeaves(ray, distance, [&](const uint32_t* tris, uint32_t count, float& leafDistance)
+	{
+		//Gather the leaf into SoA registers, padding short leaves with the last triangle
+		XMFLOAT4 v0x, v0y, v0z, e1x, e1y, e1z, e2x, e2y, e2z;
+		float* lanes[9] = { &v0x.x, &v0y.x, &v0z.x, &e1x.x, &e1y.x, &e1z.x, &e2x.x, &e2y.x, &e2z.x };
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			const uint32_t t = tris[lane < count ? lane : count - 1];
+			lanes[0][lane] = this->vertex0[t].x;
+			lanes[1][lane] = this->vertex0[t].y;
+			lanes[2][lane] = this->vertex0[t].z;
+			lanes[3][lane] = this->edge1[t].x;
+			lanes[4][lane] = this->edge1[t].y;
+			lanes[5][lane] = this->edge1[t].z;
+			lanes[6][lane] = this->edge2[t].x;
+			lanes[7][lane] = this->edge2[t].y;
+			lanes[8][lane] = this->edge2[t].z;
+		}
+
+		const XMVECTOR edge1X = XMLoadFloat4(&e1x), edge1Y = XMLoadFloat4(&e1y), edge1Z = XMLoadFloat4(&e1z);
+		const XMVECTOR edge2X = XMLoadFloat4(&e2x), edge2Y = XMLoadFloat4(&e2y), edge2Z = XMLoadFloat4(&e2z);
+
+		//Moller-Trumbore, two sided, four triangles per pass
+		const XMVECTOR pX = XMVectorSubtract(XMVectorMultiply(dirY, edge2Z), XMVectorMultiply(dirZ, edge2Y));
+		const XMVECTOR pY = XMVectorSubtract(XMVectorMultiply(dirZ, edge2X), XMVectorMultiply(dirX, edge2Z));
+		const XMVECTOR pZ = XMVectorSubtract(XMVectorMultiply(dirX, edge2Y), XMVectorMultiply(dirY, edge2X));
+
+		const XMVECTOR det = XMVectorMultiplyAdd(edge1X, pX, XMVectorMultiplyAdd(edge1Y, pY, XMVectorMultiply(edge1Z, pZ)));
+		const XMVECTOR invDet = XMVectorReciprocal(det);
+
+		const XMVECTOR tX = XMVectorSubtract(originX, XMLoadFloat4(&v0x));
+		const XMVECTOR tY = XMVectorSubtract(originY, XMLoadFloat4(&v0y));
+		const XMVECTOR tZ = XMVectorSubtract(originZ, XMLoadFloat4(&v0z));
+
+		const XMVECTOR u = XMVectorMultiply(XMVectorMultiplyAdd(tX, pX, XMVectorMultiplyAdd(tY, pY, XMVectorMultiply(tZ, pZ))), invDet);
+
+		const XMVECTOR qX = XMVectorSubtract(XMVectorMultiply(tY, edge1Z), XMVectorMultiply(tZ, edge1Y));
+		const XMVECTOR qY = XMVectorSubtract(XMVectorMultiply(tZ, edge1X), XMVectorMultiply(tX, edge1Z));
+		const XMVECTOR qZ = XMVectorSubtract(XMVectorMultiply(tX, edge1Y), XMVectorMultiply(tY, edge1X));
+
+		const XMVECTOR v = XMVectorMultiply(XMVectorMultiplyAdd(dirX, qX, XMVectorMultiplyAdd(dirY, qY, XMVectorMultiply(dirZ, qZ))), invDet);
+		const XMVECTOR t = XMVectorMultiply(XMVectorMultiplyAdd(edge2X, qX, XMVectorMultiplyAdd(edge2Y, qY, XMVectorMultiply(edge2Z, qZ))), invDet);
+
+		XMVECTOR valid = XMVectorGreater(XMVectorAbs(det), epsilon);
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(u, zero));
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(v, zero));
+		valid = XMVectorAndInt(valid, XMVectorLessOrEqual(XMVectorAdd(u, v), one));
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(t, zero));
+		valid = XMVectorAndInt(valid, XMVectorLess(t, XMVectorReplicate(leafDistance)));
+
+		XMUINT4 mask;
+		XMStoreUInt4(&mask, valid);
+		XMFLOAT4 tHit, uHit, vHit;
+		XMStoreFloat4(&tHit, t);
+		XMStoreFloat4(&uHit, u);
+		XMStoreFloat4(&vHit, v);
+
+		const uint32_t* maskLanes = &mask.x;
+		const float* tLanes = &tHit.x;
+		bool hit = false;
+		for (uint32_t lane = 0; lane < count; lane++)
+		{
+			if (maskLanes[lane] == 0 || tLanes[lane] >= leafDistance)
+				continue;
+			leafDistance = tLanes[lane];
+			triangle = tris[lane];
+			barycentrics = XMFLOAT2((&uHit.x)[lane], (&vHit.x)[lane]);
+			hit = true;
+		}
+		return hit;
+	});
+
+	if (triangle == BVH::INVALID_INDEX)
+		return false;
+
+	triangle = this->sourceTriangle[triangle];
+	return true;
+}
+
+const BoundingBox& TriangleMesh::GetBounds() const
+{
+	return this->bounds;
+}
+
+uint32_t TriangleMesh::GetTriangleCount() const
+{
+	return static_cast<uint32_t>(this->vertex0.size());
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <Windows.h>
+#include "BVH.h"
+
+//CPU copy of a mesh's triangles with a BVH over them, used for triangle accurate picking.
+//Rays are tested against a whole BVH leaf (up to four triangles) at once.
+class TriangleMesh
+{
+public:
+	void Build(const XMFLOAT3* positions, size_t positionStride, uint32_t vertexCount, const DWORD* indices, uint32_t indexCount);
+	void Clear();
+
+	//direction does not need to be normalized, distance is in units of the direction's length
+	bool Intersect(FXMVECTOR origin, FXMVECTOR direction, float& distance, uint32_t& triangle, XMFLOAT2& barycentrics) const;
+
+	const BoundingBox& GetBounds() const;
+	uint32_t GetTriangleCount() const;
+
+private:
+	//Per triangle data precomputed for Moller-Trumbore: first vertex and the two edges from it
+	std::vector<XMFLOAT3> vertex0;
+	std::vector<XMFLOAT3> edge1;
+	std::vector<XMFLOAT3> edge2;
+	std::vector<uint32_t> sourceTriangle;		//Index of the triangle in the source index buffer
+	BVH bvh;
+	BoundingBox bounds;
+};
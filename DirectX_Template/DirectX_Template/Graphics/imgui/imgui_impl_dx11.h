@@ -4,6 +4,7 @@
 // Implemented features:
 //  [X] Renderer: User texture binding. Use 'ID3D11ShaderResourceView*' as ImTextureID. Read the FAQ about ImTextureID!
 //  [X] Renderer: Support for large meshes (64k+ vertices) with 16-bit indices.
+//  [X] Renderer: Vertex/index data is appended to persistent ring buffers with NO_OVERWRITE, and draw lists whose content did not change since the previous frame are not uploaded again. See ImGui_ImplDX11_GetStats().
 
 // You can use unmodified imgui_impl_* files in your project. See examples/ folder for examples of using this. 
 // Prefer including the entire imgui/ repository into your project (either as a copy or as a submodule), and only build the backends you need.
@@ -16,10 +17,22 @@
 struct ID3D11Device;
 struct ID3D11DeviceContext;
 
+// Upload counters. The per-frame fields describe the last ImGui_ImplDX11_RenderDrawData() call.
+struct ImGui_ImplDX11_Stats
+{
+    int                 ListsUploaded;      // Draw lists whose vertices/indices were copied to the GPU this frame
+    int                 ListsReused;        // Draw lists drawn from data uploaded in an earlier frame
+    size_t              BytesUploaded;      // Vertex and index bytes copied this frame
+    unsigned long long  TotalBytesUploaded;
+    unsigned int        Discards;           // Times the ring buffers were full and restarted with WRITE_DISCARD
+    unsigned int        Reallocations;      // Times the ring buffers were created or grown
+};
+
 IMGUI_IMPL_API bool     ImGui_ImplDX11_Init(ID3D11Device* device, ID3D11DeviceContext* device_context);
 IMGUI_IMPL_API void     ImGui_ImplDX11_Shutdown();
 IMGUI_IMPL_API void     ImGui_ImplDX11_NewFrame();
 IMGUI_IMPL_API void     ImGui_ImplDX11_RenderDrawData(ImDrawData* draw_data);
+IMGUI_IMPL_API void     ImGui_ImplDX11_GetStats(ImGui_ImplDX11_Stats* out_stats);
 
 // Use if you want to reset your rendering device without losing Dear ImGui state.
 IMGUI_IMPL_API void     ImGui_ImplDX11_InvalidateDeviceObjects();
@@ -36,6 +36,7 @@ namespace DirectX
     class IEffectFactory;
     class CommonStates;
     class ModelMesh;
+    class Model;
 
     //----------------------------------------------------------------------------------
     // Model loading options
@@ -46,6 +47,57 @@ namespace DirectX
         ModelLoader_PremultipledAlpha   = 0x2,
         ModelLoader_MaterialColorsSRGB  = 0x4,
         ModelLoader_AllowLargeModels    = 0x8,
+        ModelLoader_IncludeBones        = 0x10,
+        ModelLoader_PackSmallBuffers    = 0x20,
+    };
+
+    //----------------------------------------------------------------------------------
+    // Skeleton bone (bind pose and hierarchy)
+    class ModelBone
+    {
+    public:
+        ModelBone() noexcept :
+            parentIndex(c_Invalid),
+            localTransform{},
+            invBindPose{} {}
+
+        uint32_t                parentIndex;
+        XMFLOAT4X4              localTransform;     // Bind pose relative to the parent bone
+        XMFLOAT4X4              invBindPose;        // Model space to bone space at bind time
+        std::wstring            name;
+
+        using Collection = std::vector<ModelBone>;
+
+        static constexpr uint32_t c_Invalid = uint32_t(-1);
+    };
+
+    //----------------------------------------------------------------------------------
+    // Animation clip stored as decomposed local bone transforms (scale, rotation quaternion, translation)
+    class ModelAnimationClip
+    {
+    public:
+        ModelAnimationClip() noexcept :
+            startTime(0.f),
+            endTime(0.f) {}
+
+        // Keys of one bone, sorted by time. Bones without a track stay at their bind pose.
+        struct Track
+        {
+            uint32_t boneIndex;
+            uint32_t firstKey;
+            uint32_t keyCount;
+        };
+
+        std::wstring            name;
+        float                   startTime;
+        float                   endTime;
+        std::vector<Track>      tracks;
+        std::vector<float>      keyTimes;
+        std::vector<XMFLOAT4>   keyRotations;
+        std::vector<XMFLOAT3>   keyTranslations;
+        std::vector<XMFLOAT3>   keyScales;
+
+        using Collection = std::vector<ModelAnimationClip>;
     };
 
     //----------------------------------------------------------------------------------
@@ -122,6 +174,7 @@ namespace DirectX
         std::wstring                name;
         bool                        ccw;
         bool                        pmalpha;
+        std::vector<uint32_t>       boneInfluences;     // Model bone index for each skinning vertex bone index
 
         using Collection = std::vector<std::shared_ptr<ModelMesh>>;
 
@@ -137,6 +190,53 @@ namespace DirectX
     };
 
 
+    //----------------------------------------------------------------------------------
+    // Mesh parts of any number of models, flattened for Model::Submit. Opaque parts are sorted
+    // by render state, effect, input layout and buffers so that runs of equal state are set once;
+    // alpha parts are sorted back to front. The models must outlive the list.
+    class ModelDrawList
+    {
+    public:
+        ModelDrawList() noexcept : mSorted(true), mBaseline(0), mStats{} {}
+
+        ModelDrawList(ModelDrawList&&) = default;
+        ModelDrawList& operator= (ModelDrawList&&) = default;
+
+        ModelDrawList(ModelDrawList const&) = default;
+        ModelDrawList& operator= (ModelDrawList const&) = default;
+
+        struct Stats
+        {
+            size_t draws;
+            size_t stateChanges;            // Context calls made by the last Submit, draws excluded
+            size_t baselineStateChanges;    // Context calls Model::Draw makes for the same models
+        };
+
+        void __cdecl Clear() noexcept;
+        size_t __cdecl GetCount() const noexcept { return mOpaque.size() + mAlpha.size(); }
+        const Stats& __cdecl GetStats() const noexcept { return mStats; }
+
+    private:
+        friend class Model;
+
+        struct Item
+        {
+            const ModelMeshPart*    part;
+            const ModelMesh*        mesh;
+            uint32_t                worldIndex;
+            float                   viewDistance;
+        };
+
+        std::vector<Item>       mOpaque;
+        std::vector<Item>       mAlpha;
+        std::vector<XMFLOAT4X4> mWorlds;
+        std::vector<const Model*> mModels;  // In PrepareDrawList order, for counting the baseline
+        bool                    mSorted;
+        size_t                  mBaseline;
+        Stats                   mStats;
+    };
+
+
     //----------------------------------------------------------------------------------
     // A model consists of one or more meshes
     class Model
@@ -152,8 +252,10 @@ namespace DirectX
 
         virtual ~Model();
 
-        ModelMesh::Collection   meshes;
-        std::wstring            name;
+        ModelMesh::Collection           meshes;
+        ModelBone::Collection           bones;
+        ModelAnimationClip::Collection  animations;
+        std::wstring                    name;
 
         // Draw all the meshes in the model
         void XM_CALLCONV Draw(
@@ -163,13 +265,31 @@ namespace DirectX
             bool wireframe = false,
             _In_opt_ std::function<void __cdecl()> setCustomState = nullptr) const;
 
+        // Add all mesh parts to a draw list; view is only used to order the alpha parts
+        void XM_CALLCONV PrepareDrawList(ModelDrawList& list, FXMMATRIX world, CXMMATRIX view) const;
+
+        // Draw a prepared list, only setting the state that differs from the previous part
+        static void XM_CALLCONV Submit(
+            _In_ ID3D11DeviceContext* deviceContext,
+            const CommonStates& states,
+            ModelDrawList& list,
+            FXMMATRIX view, CXMMATRIX projection,
+            bool wireframe = false,
+            _In_opt_ std::function<void __cdecl()> setCustomState = nullptr);
+
         // Notify model that effects, parts list, or mesh list has changed
         void __cdecl Modified() noexcept { mEffectCache.clear(); }
 
         // Update all effects used by the model
         void __cdecl UpdateEffects(_In_ std::function<void __cdecl(IEffect*)> setEffect);
 
+        // The file name overloads memory map the file instead of reading it into a heap copy.
+        // ModelLoader_PackSmallBuffers packs small vertex/index buffers of CMO and SDKMESH
+        // models into shared buffers, with mesh parts addressing them through startIndex and
+        // vertexOffset. Models can be loaded from several threads at once.
+
         // Loads a model from a Visual Studio Starter Kit .CMO file
+        // Bones and animation clips are only kept when ModelLoader_IncludeBones is set
         static std::unique_ptr<Model> __cdecl CreateFromCMO(
             _In_ ID3D11Device* device,
             _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
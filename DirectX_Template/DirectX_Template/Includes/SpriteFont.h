@@ -21,6 +21,18 @@ namespace DirectX
     public:
         struct Glyph;
 
+        struct LayoutCacheStatistics
+        {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            uint64_t glyphsReused;      // Glyphs of the strings found in the cache
+            uint64_t glyphsLaidOut;     // Glyphs of the strings laid out on a miss
+            double layoutMilliseconds;  // Time spent laying out those
+            size_t strings;             // Layouts currently cached
+            size_t glyphs;              // Glyphs across those layouts
+        };
+
         SpriteFont(_In_ ID3D11Device* device, _In_z_ wchar_t const* fileName, bool forceSRGB = false);
         SpriteFont(_In_ ID3D11Device* device, _In_reads_bytes_(dataSize) uint8_t const* dataBlob, _In_ size_t dataSize, bool forceSRGB = false);
         SpriteFont(_In_ ID3D11ShaderResourceView* texture, _In_reads_(glyphCount) Glyph const* glyphs, _In_ size_t glyphCount, _In_ float lineSpacing);
@@ -69,6 +81,21 @@ namespace DirectX
         Glyph const* __cdecl FindGlyph(wchar_t character) const;
         void __cdecl GetSpriteSheet(ID3D11ShaderResourceView** texture) const;
 
+        // Distance field fonts stay sharp at any scale, and are drawn with a SpriteBatch in
+        // SpriteBatch::SetDistanceFieldMode. Their glyphs include the field's margin, so
+        // MeasureString reports slightly larger bounds than for a plain font.
+        bool __cdecl IsDistanceField() const noexcept;
+
+        // Layout cache. Keeps the glyph positions of the most recently used strings, so drawing
+        // or measuring unchanged text skips glyph lookup and pen advancement. Off by default,
+        // and while it is on, calls on one font must not overlap across threads. The time a hit
+        // saves can be estimated from the statistics, as glyphsReused * layoutMilliseconds / glyphsLaidOut.
+        void __cdecl SetLayoutCacheCapacity(size_t strings);
+        size_t __cdecl GetLayoutCacheCapacity() const noexcept;
+
+        LayoutCacheStatistics __cdecl GetLayoutCacheStatistics() const noexcept;
+        void __cdecl ResetLayoutCacheStatistics() noexcept;
+
         // Describes a single character glyph.
         struct Glyph
         {
@@ -0,0 +1,128 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+	this->Shutdown();
+}
+
+bool JobSystem::Initialize(unsigned int threadCount)
+{
+	this->Shutdown();
+
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	this->stopping = false;
+	try
+	{
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			this->workers.emplace_back(&JobSystem::WorkerLoop, this);
+		}
+	}
+	catch (const std::system_error&)
+	{
+		this->Shutdown();
+		return false;
+	}
+	return true;
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->jobMutex);
+		this->stopping = true;
+	}
+	this->jobAvailable.notify_all();
+
+	for (std::thread& worker : this->workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	this->workers.clear();
+	this->jobs.clear();
+}
+
+unsigned int JobSystem::GetThreadCount() const
+{
+	return static_cast<unsigned int>(this->workers.size());
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(this->jobMutex);
+			this->jobAvailable.wait(lock, [this]() { return this->stopping || !this->jobs.empty(); });
+			if (this->stopping && this->jobs.empty())
+				return;
+			job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+		}
+		job();
+	}
+}
+
+bool JobSystem::RunOneJob()
+{
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(this->jobMutex);
+		if (this->jobs.empty())
+			return false;
+		job = std::move(this->jobs.front());
+		this->jobs.pop_front();
+	}
+	job();
+	return true;
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& job)
+{
+	if (count == 0)
+		return;
+
+	batchSize = std::max(batchSize, 1u);
+	const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+
+	//Without workers (or with a single batch) there is nothing to gain from queueing
+	if (this->workers.empty() || batchCount == 1)
+	{
+		job(0, count);
+		return;
+	}
+
+	std::atomic<uint32_t> remaining(batchCount);
+	{
+		std::lock_guard<std::mutex> lock(this->jobMutex);
+		for (uint32_t batch = 0; batch < batchCount; batch++)
+		{
+			const uint32_t begin = batch * batchSize;
+			const uint32_t end = std::min(begin + batchSize, count);
+			this->jobs.emplace_back([&job, &remaining, begin, end]()
+			{
+				job(begin, end);
+				remaining.fetch_sub(1, std::memory_order_release);
+			});
+		}
+	}
+	this->jobAvailable.notify_all();
+
+	while (remaining.load(std::memory_order_acquire) != 0)
+	{
+		if (!this->RunOneJob())
+			std::this_thread::yield();
+	}
+}
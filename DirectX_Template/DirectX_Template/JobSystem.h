@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Small fixed-size worker pool. The calling thread helps execute queued jobs while it waits,
+//so ParallelFor can also be used from inside a job without deadlocking.
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	//threadCount of 0 uses one worker per hardware thread, minus the calling thread
+	bool Initialize(unsigned int threadCount = 0);
+	void Shutdown();
+
+	//Splits [0, count) into batches of batchSize and runs job(begin, end) for each, returning once all are done
+	void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& job);
+	unsigned int GetThreadCount() const;
+
+private:
+	void WorkerLoop();
+	bool RunOneJob();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	bool stopping = false;
+};
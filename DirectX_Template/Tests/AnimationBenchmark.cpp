@@ -0,0 +1,211 @@
+//Animation update timings for a crowd of characters sharing a synthetic 60 bone rig, each blending
+//two clips. Clip sampling is also timed against the one track at a time reference it replaced,
+//and the results of both, and of serial and job system updates, are compared.
+//Usage: AnimationBenchmark [characters] [frames]
+#include "Graphics/Animation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+	const uint32_t BONE_COUNT = 60;
+	const uint32_t KEY_COUNT = 31;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	XMVECTOR RandomRotation(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+		return XMQuaternionNormalize(XMVectorSet(component(random), component(random), component(random), component(random) + 2.0f));
+	}
+
+	//Chain of spines with limbs branching off, every bone keyed at 30 frames per second
+	void BuildModel(DirectX::Model& model, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> offset(-0.2f, 0.2f);
+
+		model.bones.resize(BONE_COUNT);
+		for (uint32_t i = 0; i < BONE_COUNT; i++)
+		{
+			model.bones[i].parentIndex = i == 0 ? ModelBone::c_Invalid : (i % 5 == 0 ? i / 2 : i - 1);
+			XMStoreFloat4x4(&model.bones[i].localTransform, XMMatrixTranslation(offset(random), 1.0f, offset(random)));
+			XMStoreFloat4x4(&model.bones[i].invBindPose, XMMatrixIdentity());
+		}
+
+		for (int c = 0; c < 2; c++)
+		{
+			ModelAnimationClip clip;
+			clip.name = c == 0 ? L"walk" : L"run";
+			clip.startTime = 0.0f;
+			clip.endTime = static_cast<float>(KEY_COUNT - 1) / 30.0f;
+			for (uint32_t bone = 0; bone < BONE_COUNT; bone++)
+			{
+				ModelAnimationClip::Track track;
+				track.boneIndex = bone;
+				track.firstKey = static_cast<uint32_t>(clip.keyTimes.size());
+				track.keyCount = KEY_COUNT;
+				clip.tracks.push_back(track);
+
+				XMVECTOR previous = XMQuaternionIdentity();
+				for (uint32_t key = 0; key < KEY_COUNT; key++)
+				{
+					XMVECTOR rotation = RandomRotation(random);
+					if (XMVectorGetX(XMVector4Dot(rotation, previous)) < 0.0f)
+						rotation = XMVectorNegate(rotation);
+					previous = rotation;
+
+					XMFLOAT4 keyRotation;
+					XMStoreFloat4(&keyRotation, rotation);
+					clip.keyTimes.push_back(static_cast<float>(key) / 30.0f);
+					clip.keyRotations.push_back(keyRotation);
+					clip.keyTranslations.push_back(XMFLOAT3(offset(random), 1.0f + offset(random), offset(random)));
+					clip.keyScales.push_back(XMFLOAT3(1.0f, 1.0f, 1.0f));
+				}
+			}
+			model.animations.push_back(std::move(clip));
+		}
+	}
+
+	//One track at a time, the way SampleClip used to work
+	void ReferenceSample(const DirectX::ModelAnimationClip& clip, float time, AnimationPose& pose)
+	{
+		for (const ModelAnimationClip::Track& track : clip.tracks)
+		{
+			const float* times = clip.keyTimes.data() + track.firstKey;
+			const uint32_t next = static_cast<uint32_t>(std::upper_bound(times, times + track.keyCount, time) - times);
+			uint32_t key0 = track.firstKey + (next == 0 ? 0 : next - 1);
+			uint32_t key1 = track.firstKey + (next == track.keyCount ? track.keyCount - 1 : next);
+			float t = 0.0f;
+			if (key0 != key1)
+				t = (time - clip.keyTimes[key0]) / (clip.keyTimes[key1] - clip.keyTimes[key0]);
+
+			XMStoreFloat4(&pose.rotations[track.boneIndex], XMQuaternionNormalize(XMVectorLerp(XMLoadFloat4(&clip.keyRotations[key0]), XMLoadFloat4(&clip.keyRotations[key1]), t)));
+			XMStoreFloat3(&pose.translations[track.boneIndex], XMVectorLerp(XMLoadFloat3(&clip.keyTranslations[key0]), XMLoadFloat3(&clip.keyTranslations[key1]), t));
+			XMStoreFloat3(&pose.scales[track.boneIndex], XMVectorLerp(XMLoadFloat3(&clip.keyScales[key0]), XMLoadFloat3(&clip.keyScales[key1]), t));
+		}
+	}
+
+	float MaxDifference(const AnimationPose& a, const AnimationPose& b)
+	{
+		float difference = 0.0f;
+		for (size_t i = 0; i < a.rotations.size(); i++)
+		{
+			const XMVECTOR rotation = XMVectorAbs(XMVectorSubtract(XMLoadFloat4(&a.rotations[i]), XMLoadFloat4(&b.rotations[i])));
+			const XMVECTOR translation = XMVectorAbs(XMVectorSubtract(XMLoadFloat3(&a.translations[i]), XMLoadFloat3(&b.translations[i])));
+			XMFLOAT4 r, t;
+			XMStoreFloat4(&r, rotation);
+			XMStoreFloat4(&t, translation);
+			difference = std::max({ difference, r.x, r.y, r.z, r.w, t.x, t.y, t.z });
+		}
+		return difference;
+	}
+
+	void AddCrowd(AnimationSystem& system, const AnimationRig& rig, const DirectX::Model& model, uint32_t characters)
+	{
+		for (uint32_t i = 0; i < characters; i++)
+		{
+			const uint32_t character = system.AddCharacter(&rig, &model.animations[0]);
+			system.SetClips(character, &model.animations[0], &model.animations[1], static_cast<float>(i % 11) / 10.0f);
+			system.SetPlayback(character, static_cast<float>(i) * 0.013f, 0.8f + static_cast<float>(i % 5) * 0.1f);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t characters = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000;
+	const int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+	bool failed = false;
+
+	std::mt19937 random(30);
+	DirectX::Model model;
+	BuildModel(model, random);
+	AnimationRig rig;
+	if (!rig.Initialize(model))
+		return 1;
+
+	{ //Sampling alone
+		const DirectX::ModelAnimationClip& clip = model.animations[0];
+		AnimationPose pose = rig.GetBindPose();
+		AnimationPose reference = rig.GetBindPose();
+		const int samples = static_cast<int>(characters) * frames;
+		float difference = 0.0f;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < samples; i++)
+		{
+			ReferenceSample(clip, std::fmod(static_cast<float>(i) * 0.0071f, clip.endTime), reference);
+		}
+		const double referenceMilliseconds = MillisecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < samples; i++)
+		{
+			rig.SampleClip(clip, std::fmod(static_cast<float>(i) * 0.0071f, clip.endTime), pose);
+		}
+		const double sampleMilliseconds = MillisecondsSince(start);
+
+		for (int i = 0; i < 100; i++)
+		{
+			const float time = clip.endTime * static_cast<float>(i) / 99.0f;
+			ReferenceSample(clip, time, reference);
+			rig.SampleClip(clip, time, pose);
+			difference = std::max(difference, MaxDifference(pose, reference));
+		}
+
+		std::printf("SampleClip, %d samples of %u bones: %8.3f ms, one track at a time %8.3f ms, speedup %.2fx, max difference %g\n",
+			samples, BONE_COUNT, sampleMilliseconds, referenceMilliseconds, referenceMilliseconds / sampleMilliseconds, difference);
+		if (difference > 1e-5f)
+		{
+			std::printf("FAILED: SampleClip differs from the reference\n");
+			failed = true;
+		}
+	}
+
+	{ //Whole updates: two clips sampled, blended and turned into palettes per character
+		AnimationSystem serial;
+		serial.Initialize(nullptr);
+		AddCrowd(serial, rig, model, characters);
+
+		JobSystem jobSystem;
+		jobSystem.Initialize();
+		AnimationSystem threaded;
+		threaded.Initialize(&jobSystem);
+		AddCrowd(threaded, rig, model, characters);
+
+		double serialMilliseconds = 0.0;
+		double threadedMilliseconds = 0.0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			serial.Update(1.0f / 60.0f);
+			threaded.Update(1.0f / 60.0f);
+			serialMilliseconds += serial.GetStats().updateMilliseconds;
+			threadedMilliseconds += threaded.GetStats().updateMilliseconds;
+		}
+
+		size_t mismatches = 0;
+		for (uint32_t i = 0; i < characters; i++)
+		{
+			const XMFLOAT4X4* a = serial.GetSkinPalette(i);
+			const XMFLOAT4X4* b = threaded.GetSkinPalette(i);
+			mismatches += std::equal(&a[0].m[0][0], &a[BONE_COUNT].m[0][0], &b[0].m[0][0]) ? 0 : 1;
+		}
+
+		std::printf("Update, %u characters: %8.3f ms per frame serial, %8.3f ms with %u workers\n",
+			characters, serialMilliseconds / frames, threadedMilliseconds / frames, jobSystem.GetThreadCount());
+		if (mismatches != 0)
+		{
+			std::printf("FAILED: %zu characters differ between serial and job system updates\n", mismatches);
+			failed = true;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
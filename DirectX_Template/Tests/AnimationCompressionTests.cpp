@@ -0,0 +1,199 @@
+//CompressedAnimationClip on synthetic clips for a branching 40 bone rig: smooth motion, noisy
+//motion, a clip that never moves and one that animates scale. Measure's largest virtual vertex
+//error must stay within what the channel tolerances allow once they add up down the hierarchy.
+//Reports the kept keys, compression ratio and largest bone error of each clip.
+#include "Graphics/AnimationCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+namespace
+{
+	const uint32_t BONE_COUNT = 40;
+	const float FRAME_RATE = 30.0f;
+
+	struct KeyValue
+	{
+		XMVECTOR rotation;
+		XMFLOAT3 translation;
+		XMFLOAT3 scale;
+	};
+
+	//Limbs branch off a spine every fifth bone, every bone is one unit from its parent
+	void BuildRig(DirectX::Model& model)
+	{
+		model.bones.resize(BONE_COUNT);
+		for (uint32_t i = 0; i < BONE_COUNT; i++)
+		{
+			model.bones[i].parentIndex = i == 0 ? ModelBone::c_Invalid : (i % 5 == 0 ? i / 2 : i - 1);
+			XMStoreFloat4x4(&model.bones[i].localTransform, XMMatrixTranslation(0.0f, 1.0f, 0.0f));
+			XMStoreFloat4x4(&model.bones[i].invBindPose, XMMatrixIdentity());
+		}
+	}
+
+	//key(bone, time) gives the bone's local transform at each key of a clip keyed at 30 frames per second
+	ModelAnimationClip BuildClip(const wchar_t* name, float duration, const std::function<KeyValue(uint32_t, float)>& key)
+	{
+		ModelAnimationClip clip;
+		clip.name = name;
+		clip.startTime = 0.0f;
+		clip.endTime = duration;
+		const uint32_t keyCount = static_cast<uint32_t>(duration * FRAME_RATE) + 1;
+		for (uint32_t bone = 0; bone < BONE_COUNT; bone++)
+		{
+			ModelAnimationClip::Track track;
+			track.boneIndex = bone;
+			track.firstKey = static_cast<uint32_t>(clip.keyTimes.size());
+			track.keyCount = keyCount;
+			clip.tracks.push_back(track);
+
+			XMVECTOR previous = XMQuaternionIdentity();
+			for (uint32_t k = 0; k < keyCount; k++)
+			{
+				const float time = static_cast<float>(k) / FRAME_RATE;
+				const KeyValue value = key(bone, time);
+
+				//Keep neighbouring keys on the same hemisphere, as exporters do
+				XMVECTOR rotation = XMQuaternionNormalize(value.rotation);
+				if (XMVectorGetX(XMVector4Dot(rotation, previous)) < 0.0f)
+					rotation = XMVectorNegate(rotation);
+				previous = rotation;
+
+				XMFLOAT4 keyRotation;
+				XMStoreFloat4(&keyRotation, rotation);
+				clip.keyTimes.push_back(time);
+				clip.keyRotations.push_back(keyRotation);
+				clip.keyTranslations.push_back(value.translation);
+				clip.keyScales.push_back(value.scale);
+			}
+		}
+		return clip;
+	}
+
+	//Every joint up the hierarchy can be off by the rotation tolerance, which swings everything
+	//below it, and by the translation and scale tolerances. Scales stay near one in these clips,
+	//so a bone's vertices are off by at most the sum of those over its ancestors.
+	std::vector<float> ErrorBounds(const DirectX::Model& model, const AnimationCompressionSettings& settings, float maxScale)
+	{
+		std::vector<float> angle(BONE_COUNT), position(BONE_COUNT), bounds(BONE_COUNT);
+		const float offset = 1.0f + settings.translationTolerance;
+		for (uint32_t bone = 0; bone < BONE_COUNT; bone++)
+		{
+			const uint32_t parent = model.bones[bone].parentIndex;
+			const float parentAngle = parent == ModelBone::c_Invalid ? 0.0f : angle[parent];
+			const float parentPosition = parent == ModelBone::c_Invalid ? 0.0f : position[parent];
+			const float reach = offset * maxScale;
+			position[bone] = parentPosition + parentAngle * reach + settings.scaleTolerance * offset + settings.translationTolerance * maxScale;
+			angle[bone] = parentAngle + settings.rotationTolerance;
+			bounds[bone] = position[bone] + (angle[bone] * maxScale + settings.scaleTolerance) * settings.virtualVertexDistance;
+		}
+		return bounds;
+	}
+
+	bool TestClip(const AnimationRig& rig, const DirectX::Model& model, const ModelAnimationClip& clip, const AnimationCompressionSettings& settings, float maxScale)
+	{
+		CompressedAnimationClip compressed;
+		if (!compressed.Compress(clip, settings))
+		{
+			std::printf("FAILED %ls: Compress returned false\n", clip.name.c_str());
+			return false;
+		}
+		const AnimationCompressionReport report = CompressedAnimationClip::Measure(rig, clip, compressed, settings);
+
+		//Single precision sampling and hierarchy concatenation add a little on top
+		const std::vector<float> bounds = ErrorBounds(model, settings, maxScale);
+		const float allowed = bounds[report.maxErrorBone] * 1.01f + 1e-5f;
+		const bool ok = report.maxBoneError <= allowed;
+
+		std::printf("%-8ls %5zu keys, kept %5zu rotation %5zu translation %5zu scale, %7zu -> %6zu bytes, ratio %5.1fx, max error %.6f (bone %2u at %.3f s, allowed %.6f) %s\n",
+			clip.name.c_str(), report.sourceKeys, report.keptRotationKeys, report.keptTranslationKeys, report.keptScaleKeys,
+			report.cmoBytes, report.compressedBytes, report.compressionRatio, report.maxBoneError, report.maxErrorBone, report.maxErrorTime, allowed,
+			ok ? "ok" : "FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	DirectX::Model model;
+	BuildRig(model);
+	AnimationRig rig;
+	if (!rig.Initialize(model))
+	{
+		std::printf("FAILED: AnimationRig::Initialize\n");
+		return 1;
+	}
+
+	const AnimationCompressionSettings settings;
+	bool ok = true;
+
+	//Slow swings and a bobbing root, which linear keys rebuild well
+	const ModelAnimationClip smooth = BuildClip(L"smooth", 4.0f, [](uint32_t bone, float time)
+	{
+		const float phase = static_cast<float>(bone) * 0.37f;
+		KeyValue value;
+		value.rotation = XMQuaternionRotationRollPitchYaw(0.4f * std::sin(time * 2.1f + phase), 0.3f * std::sin(time * 1.3f + phase), 0.2f * std::cos(time * 0.7f));
+		value.translation = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		if (bone == 0)
+			value.translation = XMFLOAT3(time * 0.5f, 1.0f + 0.1f * std::sin(time * 6.0f), 0.0f);
+		value.scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		return value;
+	});
+	ok &= TestClip(rig, model, smooth, settings, 1.0f);
+
+	//Every key random, so almost nothing can be dropped
+	std::mt19937 random(31);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const ModelAnimationClip noisy = BuildClip(L"noisy", 1.0f, [&](uint32_t, float)
+	{
+		KeyValue value;
+		value.rotation = XMVectorSet(unit(random), unit(random), unit(random), unit(random) + 2.0f);
+		value.translation = XMFLOAT3(0.2f * unit(random), 1.0f + 0.2f * unit(random), 0.2f * unit(random));
+		value.scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		return value;
+	});
+	ok &= TestClip(rig, model, noisy, settings, 1.0f);
+
+	//A held pose must come down to one key per channel
+	const ModelAnimationClip still = BuildClip(L"still", 2.0f, [](uint32_t bone, float)
+	{
+		KeyValue value;
+		value.rotation = XMQuaternionRotationRollPitchYaw(0.1f * static_cast<float>(bone % 3), 0.0f, 0.2f);
+		value.translation = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		value.scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		return value;
+	});
+	ok &= TestClip(rig, model, still, settings, 1.0f);
+	{
+		CompressedAnimationClip compressed;
+		compressed.Compress(still, settings);
+		const AnimationCompressionReport report = CompressedAnimationClip::Measure(rig, still, compressed, settings);
+		if (report.keptRotationKeys != BONE_COUNT || report.keptTranslationKeys != BONE_COUNT || report.keptScaleKeys != BONE_COUNT)
+		{
+			std::printf("FAILED still: held channels kept more than one key\n");
+			ok = false;
+		}
+	}
+
+	//Squash and stretch, with scales between 0.8 and 1.2
+	const ModelAnimationClip squash = BuildClip(L"squash", 2.0f, [](uint32_t bone, float time)
+	{
+		const float stretch = 1.0f + 0.2f * std::sin(time * 4.0f + static_cast<float>(bone) * 0.5f);
+		KeyValue value;
+		value.rotation = XMQuaternionRotationRollPitchYaw(0.0f, 0.5f * std::sin(time * 1.7f), 0.0f);
+		value.translation = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		value.scale = XMFLOAT3(1.0f / stretch, stretch, 1.0f / stretch);
+		return value;
+	});
+	ok &= TestClip(rig, model, squash, settings, 1.25f);
+
+	if (!ok)
+	{
+		std::printf("Compressed clips are outside the tolerance\n");
+		return 1;
+	}
+	std::printf("All animation compression tests passed\n");
+	return 0;
+}
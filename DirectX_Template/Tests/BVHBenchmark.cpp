@@ -0,0 +1,224 @@
+//BVH build, refit and query timings on random box scenes of 10K to 1M objects, against testing
+//every box. Query results are checked against the brute force answers as they are timed, and
+//rays cast from several threads at once on the same tree must match the single threaded results.
+//Usage: BVHBenchmark [maxObjects]
+#include "Graphics/BVH.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+namespace
+{
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//Same plane test the BVH uses, one box at a time
+	bool OutsideFrustum(const XMVECTOR planes[6], const BoundingBox& box)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			XMFLOAT4 p;
+			XMStoreFloat4(&p, planes[i]);
+			const float distance = p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w;
+			const float radius = std::fabs(p.x) * box.Extents.x + std::fabs(p.y) * box.Extents.y + std::fabs(p.z) * box.Extents.z;
+			if (distance > radius)
+				return true;
+		}
+		return false;
+	}
+
+	bool Overlaps(const BoundingBox& a, const BoundingBox& b)
+	{
+		return std::fabs(a.Center.x - b.Center.x) <= a.Extents.x + b.Extents.x
+			&& std::fabs(a.Center.y - b.Center.y) <= a.Extents.y + b.Extents.y
+			&& std::fabs(a.Center.z - b.Center.z) <= a.Extents.z + b.Extents.z;
+	}
+
+	bool RayEntry(const SimpleMath::Ray& ray, const BoundingBox& box, float maxDistance, float& entry)
+	{
+		const float* origin = &ray.position.x;
+		const float* direction = &ray.direction.x;
+		const float* center = &box.Center.x;
+		const float* extents = &box.Extents.x;
+		float t0 = 0.0f;
+		float t1 = maxDistance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float inverse = 1.0f / direction[axis];
+			const float a = (center[axis] - extents[axis] - origin[axis]) * inverse;
+			const float b = (center[axis] + extents[axis] - origin[axis]) * inverse;
+			t0 = std::max(t0, std::min(a, b));
+			t1 = std::min(t1, std::max(a, b));
+		}
+		entry = t0;
+		return t0 <= t1;
+	}
+
+	int RunScene(uint32_t objectCount)
+	{
+		//Boxes spread over a cube whose volume grows with the count, so density stays constant
+		const float extent = 10.0f * std::cbrt(static_cast<float>(objectCount));
+		std::mt19937 rng(objectCount);
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::uniform_real_distribution<float> size(0.25f, 2.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<BoundingBox> boxes(objectCount);
+		for (BoundingBox& box : boxes)
+		{
+			box.Center = XMFLOAT3(position(rng), position(rng), position(rng));
+			box.Extents = XMFLOAT3(size(rng), size(rng), size(rng));
+		}
+
+		BVH bvh;
+		auto start = std::chrono::steady_clock::now();
+		bvh.Build(boxes.data(), objectCount);
+		const double buildTime = MillisecondsSince(start);
+
+		//Move a tenth of the objects a little, as a frame of gameplay would
+		const uint32_t moved = objectCount / 10;
+		start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < moved; i++)
+		{
+			BoundingBox& box = boxes[rng() % objectCount];
+			box.Center.x += unit(rng);
+			box.Center.z += unit(rng);
+			bvh.UpdateObject(static_cast<uint32_t>(&box - boxes.data()), box);
+		}
+		bvh.Refit();
+		const double refitTime = MillisecondsSince(start);
+
+		int errors = 0;
+		const int queries = 100;
+		double bvhTime[3] = {};
+		double bruteTime[3] = {};
+		size_t visited[3] = {};
+		std::vector<uint32_t> results;
+		std::vector<BVHRayHit> hits;
+		std::vector<SimpleMath::Ray> rays;
+		std::vector<size_t> rayHits;
+
+		for (int q = 0; q < queries; q++)
+		{
+			//Frustum looking from a random point towards the origin
+			const XMVECTOR eye = XMVectorSet(position(rng), position(rng), position(rng), 0.0f);
+			const XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			BoundingFrustum frustum(XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, extent));
+			frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+			XMVECTOR planes[6];
+			frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+			results.clear();
+			start = std::chrono::steady_clock::now();
+			bvh.QueryFrustum(frustum, results, &visited[0]);
+			bvhTime[0] += MillisecondsSince(start);
+
+			size_t expected = 0;
+			start = std::chrono::steady_clock::now();
+			for (const BoundingBox& box : boxes)
+			{
+				if (!OutsideFrustum(planes, box))
+					expected++;
+			}
+			bruteTime[0] += MillisecondsSince(start);
+			errors += results.size() != expected;
+
+			//Ray across the scene
+			const SimpleMath::Ray ray(SimpleMath::Vector3(position(rng), position(rng), -extent), SimpleMath::Vector3(0.1f * unit(rng), 0.1f * unit(rng), 1.0f));
+			hits.clear();
+			start = std::chrono::steady_clock::now();
+			bvh.QueryRay(ray, 4.0f * extent, hits, &visited[1]);
+			bvhTime[1] += MillisecondsSince(start);
+			rays.push_back(ray);
+			rayHits.push_back(hits.size());
+
+			expected = 0;
+			start = std::chrono::steady_clock::now();
+			for (const BoundingBox& box : boxes)
+			{
+				float entry;
+				if (RayEntry(ray, box, 4.0f * extent, entry))
+					expected++;
+			}
+			bruteTime[1] += MillisecondsSince(start);
+			errors += hits.size() != expected;
+
+			//Box the size of a small room
+			const BoundingBox area(XMFLOAT3(position(rng), position(rng), position(rng)), XMFLOAT3(8.0f, 8.0f, 8.0f));
+			results.clear();
+			start = std::chrono::steady_clock::now();
+			bvh.QueryAABB(area, results, &visited[2]);
+			bvhTime[2] += MillisecondsSince(start);
+
+			expected = 0;
+			start = std::chrono::steady_clock::now();
+			for (const BoundingBox& box : boxes)
+			{
+				if (Overlaps(box, area))
+					expected++;
+			}
+			bruteTime[2] += MillisecondsSince(start);
+			errors += results.size() != expected;
+		}
+
+		//The same rays again from several threads sharing the tree, each counting its own visits
+		const unsigned int threadCount = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+		std::vector<int> threadErrors(threadCount, 0);
+		std::vector<size_t> threadVisited(threadCount, 0);
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.emplace_back([&, t]()
+			{
+				std::vector<BVHRayHit> threadHits;
+				for (int repeat = 0; repeat < 4; repeat++)
+				{
+					for (size_t r = 0; r < rays.size(); r++)
+					{
+						threadHits.clear();
+						bvh.QueryRay(rays[r], 4.0f * extent, threadHits, &threadVisited[t]);
+						threadErrors[t] += threadHits.size() != rayHits[r];
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		int concurrentErrors = 0;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			concurrentErrors += threadErrors[t];
+			concurrentErrors += threadVisited[t] != 4 * visited[1];
+		}
+
+		printf("%8u boxes: build %8.2f ms, move %u + refit %7.2f ms\n", objectCount, buildTime, moved, refitTime);
+		const char* names[3] = { "frustum", "ray", "aabb" };
+		for (int i = 0; i < 3; i++)
+		{
+			printf("    %-8s bvh %9.4f ms  brute force %9.4f ms  speedup %7.1fx  %7.1f nodes visited\n", names[i], bvhTime[i] / queries, bruteTime[i] / queries,
+				bruteTime[i] / std::max(bvhTime[i], 1e-6), static_cast<double>(visited[i]) / queries);
+		}
+		if (errors)
+			printf("    %d queries disagreed with brute force\n", errors);
+		if (concurrentErrors)
+			printf("    %d results differed when %u threads cast the same rays\n", concurrentErrors, threadCount);
+		return errors + concurrentErrors;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t maxObjects = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1000000;
+
+	int errors = 0;
+	for (uint32_t count = 10000; count <= maxObjects; count *= 10)
+	{
+		errors += RunScene(count);
+	}
+	return errors ? 1 : 0;
+}
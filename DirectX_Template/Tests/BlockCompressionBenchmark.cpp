@@ -0,0 +1,234 @@
+//Block compression throughput and quality on generated images, including sizes that are not a
+//multiple of 4, and on any image files given on the command line. Every format is encoded with
+//all mips on one thread and on the job system; the two outputs are compared and the top mip PSNR
+//and encode MPix/s of each are reported.
+//Usage: BlockCompressionBenchmark [image files...]
+#include "Graphics/CompressedTextureLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace
+{
+	struct Image
+	{
+		std::string name;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> rgba;
+	};
+
+	//Smooth value noise over a few octaves, which compresses like a photograph, with alpha falling
+	//off from the center
+	Image MakeNoiseImage(uint32_t width, uint32_t height, uint32_t seed)
+	{
+		const uint32_t lattice = 64;
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> value(0.0f, 1.0f);
+		std::vector<float> grid(lattice * lattice * 3);
+		for (float& v : grid)
+		{
+			v = value(random);
+		}
+
+		auto sample = [&](float x, float y, uint32_t channel)
+		{
+			const int x0 = static_cast<int>(std::floor(x));
+			const int y0 = static_cast<int>(std::floor(y));
+			const float fx = x - x0;
+			const float fy = y - y0;
+			auto at = [&](int gx, int gy) { return grid[((gy & (lattice - 1)) * lattice + (gx & (lattice - 1))) * 3 + channel]; };
+			const float top = at(x0, y0) + (at(x0 + 1, y0) - at(x0, y0)) * fx;
+			const float bottom = at(x0, y0 + 1) + (at(x0 + 1, y0 + 1) - at(x0, y0 + 1)) * fx;
+			return top + (bottom - top) * fy;
+		};
+
+		Image image;
+		image.name = "noise " + std::to_string(width) + "x" + std::to_string(height);
+		image.width = width;
+		image.height = height;
+		image.rgba.resize(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint8_t* texel = &image.rgba[(static_cast<size_t>(y) * width + x) * 4];
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					float sum = 0.0f;
+					float amplitude = 0.5f;
+					float frequency = 1.0f / 48.0f;
+					for (int octave = 0; octave < 4; octave++)
+					{
+						sum += amplitude * sample(x * frequency, y * frequency, c);
+						amplitude *= 0.5f;
+						frequency *= 2.0f;
+					}
+					texel[c] = static_cast<uint8_t>(std::min(sum / 0.9375f, 1.0f) * 255.0f + 0.5f);
+				}
+				const float dx = (x + 0.5f) / width - 0.5f;
+				const float dy = (y + 0.5f) / height - 0.5f;
+				texel[3] = static_cast<uint8_t>(std::max(0.0f, 1.0f - 2.0f * std::sqrt(dx * dx + dy * dy)) * 255.0f + 0.5f);
+			}
+		}
+		return image;
+	}
+
+	//Flat two color tiles with hard edges, like UI and pixel art
+	Image MakeTileImage(uint32_t width, uint32_t height)
+	{
+		Image image;
+		image.name = "tiles " + std::to_string(width) + "x" + std::to_string(height);
+		image.width = width;
+		image.height = height;
+		image.rgba.resize(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const bool odd = ((x / 13) + (y / 7)) & 1;
+				uint8_t* texel = &image.rgba[(static_cast<size_t>(y) * width + x) * 4];
+				texel[0] = odd ? 200 : 30;
+				texel[1] = odd ? 60 : 140;
+				texel[2] = odd ? 40 : 220;
+				texel[3] = odd ? 255 : 0;
+			}
+		}
+		return image;
+	}
+
+	size_t ExpectedFileBytes(BlockFormat format, uint32_t width, uint32_t height, uint32_t& mipCount)
+	{
+		size_t bytes = 4 + 124 + 20;
+		mipCount = 0;
+		for (;;)
+		{
+			bytes += static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockCompressor::GetBlockBytes(format);
+			mipCount++;
+			if (width == 1 && height == 1)
+				break;
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+		}
+		return bytes;
+	}
+
+	const char* FormatName(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return "BC1";
+		case BlockFormat::BC3: return "BC3";
+		case BlockFormat::BC4: return "BC4";
+		case BlockFormat::BC5: return "BC5";
+		}
+		return "?";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	JobSystem jobSystem;
+	if (!jobSystem.Initialize())
+	{
+		printf("Failed to start the job system\n");
+		return 1;
+	}
+
+	std::vector<Image> images;
+	images.push_back(MakeNoiseImage(1024, 1024, 1));
+	images.push_back(MakeNoiseImage(1334, 834, 2));		//Same size as doge.png
+	images.push_back(MakeNoiseImage(37, 19, 3));
+	images.push_back(MakeTileImage(1024, 1024));
+	images.push_back(MakeTileImage(1022, 1021));
+
+	if (argc > 1)
+	{
+		const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		bool loaded = true;
+		for (int i = 1; i < argc && loaded; i++)
+		{
+			Image image;
+			image.name = argv[i];
+			const std::string path(argv[i]);
+			loaded = CompressedTextureLoader::LoadPixels(std::wstring(path.begin(), path.end()), image.rgba, image.width, image.height);
+			if (loaded)
+				images.push_back(std::move(image));
+			else
+				printf("Failed to load %s\n", argv[i]);
+		}
+		if (SUCCEEDED(com))
+			CoUninitialize();
+		if (!loaded)
+			return 1;
+	}
+
+	struct Configuration
+	{
+		BlockFormat format;
+		bool refine;
+	};
+	const Configuration configurations[] =
+	{
+		{ BlockFormat::BC1, true },
+		{ BlockFormat::BC1, false },
+		{ BlockFormat::BC3, true },
+		{ BlockFormat::BC4, true },
+		{ BlockFormat::BC5, true },
+	};
+
+	BlockCompressor serial;
+	serial.Initialize(nullptr);
+	BlockCompressor parallel;
+	parallel.Initialize(&jobSystem);
+
+	int failures = 0;
+	printf("%-24s %-10s %5s %10s %12s %12s %9s\n", "image", "format", "mips", "bytes", "1 thread", "job system", "PSNR");
+	for (const Image& image : images)
+	{
+		for (const Configuration& configuration : configurations)
+		{
+			BlockCompressionOptions options;
+			options.format = configuration.format;
+			options.refine = configuration.refine;
+
+			std::vector<uint8_t> serialFile;
+			std::vector<uint8_t> parallelFile;
+			BlockCompressionStats serialStats;
+			BlockCompressionStats parallelStats;
+			const bool compressed = serial.CompressToDDS(image.rgba.data(), image.width, image.height, image.width * 4, options, serialFile, &serialStats)
+				&& parallel.CompressToDDS(image.rgba.data(), image.width, image.height, image.width * 4, options, parallelFile, &parallelStats);
+
+			uint32_t mipCount = 0;
+			const size_t expectedBytes = ExpectedFileBytes(configuration.format, image.width, image.height, mipCount);
+			uint32_t fileWidth = 0;
+			uint32_t fileHeight = 0;
+			if (compressed && serialFile.size() >= 20)
+			{
+				std::memcpy(&fileHeight, &serialFile[12], sizeof(uint32_t));
+				std::memcpy(&fileWidth, &serialFile[16], sizeof(uint32_t));
+			}
+
+			const bool ok = compressed && serialFile.size() == expectedBytes && serialFile == parallelFile
+				&& fileWidth == image.width && fileHeight == image.height && serialStats.mipCount == mipCount;
+			if (!ok)
+				failures++;
+
+			const std::string format = std::string(FormatName(configuration.format)) + (configuration.refine ? "" : " fast");
+			printf("%-24s %-10s %5u %10zu %7.1f MP/s %7.1f MP/s %6.2f dB%s\n", image.name.c_str(), format.c_str(), serialStats.mipCount,
+				serialFile.size(), serialStats.megapixelsPerSecond, parallelStats.megapixelsPerSecond, serialStats.psnr, ok ? "" : "  FAILED");
+		}
+	}
+
+	jobSystem.Shutdown();
+
+	if (failures)
+	{
+		printf("%d encode(s) failed or produced a malformed file\n", failures);
+		return 1;
+	}
+	return 0;
+}
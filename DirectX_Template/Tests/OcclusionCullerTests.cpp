@@ -0,0 +1,181 @@
+//Reference scenes for OcclusionCuller: a camera at the origin looking down +z at walls of known
+//size and depth, with boxes placed where the right answer is obvious.
+#include "Graphics/OcclusionCuller.h"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void Check(bool condition, const char* scene, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED %s: %s\n", scene, what);
+			failures++;
+		}
+	}
+
+	BoundingBox Box(float x, float y, float z, float extent)
+	{
+		return BoundingBox(XMFLOAT3(x, y, z), XMFLOAT3(extent, extent, extent));
+	}
+
+	//Axis aligned wall facing the camera, counterClockwise flips its winding
+	struct Wall
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+
+		Wall(float x0, float y0, float x1, float y1, float z, bool counterClockwise = false)
+		{
+			this->positions = { XMFLOAT3(x0, y1, z), XMFLOAT3(x1, y1, z), XMFLOAT3(x0, y0, z), XMFLOAT3(x1, y0, z) };
+			if (counterClockwise)
+				this->indices = { 0, 2, 1, 2, 3, 1 };
+			else
+				this->indices = { 0, 1, 2, 2, 1, 3 };
+		}
+	};
+
+	const XMMATRIX& ViewProjection()
+	{
+		//90 degrees vertically at 2:1, so a wall at depth z covers |x| < 2z and |y| < z
+		static const XMMATRIX viewProjection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 2.0f, 0.1f, 1000.0f);
+		return viewProjection;
+	}
+
+	void Rasterize(OcclusionCuller& culler, const std::vector<Wall>& walls)
+	{
+		culler.BeginFrame(ViewProjection());
+		for (const Wall& wall : walls)
+		{
+			culler.AddOccluder(wall.positions.data(), sizeof(XMFLOAT3), static_cast<uint32_t>(wall.positions.size()),
+				wall.indices.data(), static_cast<uint32_t>(wall.indices.size()), XMMatrixIdentity());
+		}
+		culler.RasterizeOccluders();
+	}
+
+	void TestEmpty()
+	{
+		OcclusionCuller culler;
+		culler.Initialize(nullptr);
+		Rasterize(culler, {});
+
+		Check(culler.IsVisible(Box(0.0f, 0.0f, 10.0f, 1.0f)), "empty", "box with no occluders is visible");
+		Check(culler.IsVisible(Box(0.0f, 0.0f, 900.0f, 1.0f)), "empty", "distant box with no occluders is visible");
+	}
+
+	void TestWall(bool counterClockwise)
+	{
+		const char* scene = counterClockwise ? "wall, counter clockwise" : "wall, clockwise";
+
+		OcclusionCuller culler;
+		culler.Initialize(nullptr);
+		//Covers the middle half of the view in both directions
+		Rasterize(culler, { Wall(-10.0f, -5.0f, 10.0f, 5.0f, 10.0f, counterClockwise) });
+
+		Check(!culler.IsVisible(Box(0.0f, 0.0f, 20.0f, 1.0f)), scene, "box straight behind the wall is culled");
+		Check(!culler.IsVisible(Box(15.0f, 7.0f, 40.0f, 2.0f)), scene, "box behind a corner of the wall is culled");
+		Check(culler.IsVisible(Box(0.0f, 0.0f, 5.0f, 1.0f)), scene, "box in front of the wall is visible");
+		Check(culler.IsVisible(Box(0.0f, 0.0f, 10.5f, 1.0f)), scene, "box cutting through the wall is visible");
+		Check(culler.IsVisible(Box(30.0f, 0.0f, 20.0f, 1.0f)), scene, "box beside the wall is visible");
+		Check(culler.IsVisible(Box(20.0f, 0.0f, 20.0f, 1.5f)), scene, "box reaching past the wall edge is visible");
+		Check(culler.IsVisible(Box(0.0f, 0.0f, 0.0f, 1.0f)), scene, "box around the camera is visible");
+
+		const float centerDepth = culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() / 2);
+		Check(centerDepth < 1.0f, scene, "wall writes depth at the center of the view");
+		Check(culler.GetDepth(0, 0) == 1.0f, scene, "corner of the view stays at the far plane");
+	}
+
+	void TestNearPlane()
+	{
+		OcclusionCuller culler;
+		culler.Initialize(nullptr);
+		//Reaches in front of the near plane, so it is dropped rather than clipped
+		Rasterize(culler, { Wall(-10.0f, -5.0f, 10.0f, 5.0f, 0.05f) });
+
+		Check(culler.IsVisible(Box(0.0f, 0.0f, 20.0f, 1.0f)), "near plane", "occluder in front of the near plane hides nothing");
+	}
+
+	void TestNested()
+	{
+		OcclusionCuller culler;
+		culler.Initialize(nullptr);
+		//A small wall in front of a large one, the box sits between them
+		Rasterize(culler, { Wall(-1.0f, -1.0f, 1.0f, 1.0f, 4.0f), Wall(-40.0f, -20.0f, 40.0f, 20.0f, 30.0f) });
+
+		Check(!culler.IsVisible(Box(0.0f, 0.0f, 10.0f, 0.5f)), "nested", "box behind the small wall is culled");
+		Check(culler.IsVisible(Box(6.0f, 0.0f, 10.0f, 0.5f)), "nested", "box beside the small wall, in front of the large one, is visible");
+		Check(!culler.IsVisible(Box(30.0f, 0.0f, 50.0f, 2.0f)), "nested", "box behind the large wall is culled");
+
+		OcclusionStats stats = culler.GetStats();
+		Check(stats.occluderTriangles == 4, "nested", "every occluder triangle is counted");
+		Check(stats.occludeesTested == 3 && stats.occludeesCulled == 2, "nested", "occludee statistics match the tests made");
+	}
+
+	//Job system rasterization and batch tests must match the single threaded results exactly
+	void TestThreaded()
+	{
+		std::vector<Wall> walls;
+		for (int i = 0; i < 40; i++)
+		{
+			const float x = static_cast<float>(i % 8) * 6.0f - 24.0f;
+			const float y = static_cast<float>(i / 8) * 4.0f - 10.0f;
+			walls.emplace_back(x, y, x + 5.0f, y + 3.0f, 12.0f + static_cast<float>(i % 5) * 3.0f, i % 2 == 0);
+		}
+
+		std::vector<BoundingBox> boxes;
+		for (int i = 0; i < 500; i++)
+		{
+			boxes.push_back(Box(static_cast<float>(i % 25) * 2.5f - 30.0f, static_cast<float>(i / 25) * 1.5f - 15.0f, 20.0f + static_cast<float>(i % 7) * 4.0f, 0.4f));
+		}
+
+		OcclusionCuller serial;
+		serial.Initialize(nullptr);
+		Rasterize(serial, walls);
+
+		JobSystem jobSystem;
+		jobSystem.Initialize(4);
+		OcclusionCuller threaded;
+		threaded.Initialize(&jobSystem);
+		Rasterize(threaded, walls);
+
+		bool sameDepth = true;
+		for (int y = 0; y < serial.GetHeight(); y++)
+		{
+			for (int x = 0; x < serial.GetWidth(); x++)
+			{
+				sameDepth = sameDepth && serial.GetDepth(x, y) == threaded.GetDepth(x, y);
+			}
+		}
+		Check(sameDepth, "threaded", "depth buffers match");
+
+		std::unique_ptr<bool[]> visible(new bool[boxes.size()]);
+		threaded.TestVisibility(boxes.data(), static_cast<uint32_t>(boxes.size()), visible.get());
+		size_t mismatches = 0;
+		size_t culled = 0;
+		for (size_t i = 0; i < boxes.size(); i++)
+		{
+			mismatches += visible[i] != serial.IsVisible(boxes[i]) ? 1 : 0;
+			culled += visible[i] ? 0 : 1;
+		}
+		Check(mismatches == 0, "threaded", "batch visibility matches single tests");
+		Check(culled > 0 && culled < boxes.size(), "threaded", "scene culls some boxes but not all");
+	}
+}
+
+int main()
+{
+	TestEmpty();
+	TestWall(false);
+	TestWall(true);
+	TestNearPlane();
+	TestNested();
+	TestThreaded();
+
+	if (failures == 0)
+		std::printf("All occlusion culling tests passed\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+//ScenePicker and TriangleMesh checked against a brute force Moller-Trumbore test of every triangle
+//of every object in world space: random rays must hit the same object and triangle at the same
+//distance and barycentrics, before and after objects move. Then times picks on one large mesh.
+//Usage: PickingTests [triangles]
+#include "Graphics/ScenePicker.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace
+{
+	int failures = 0;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	struct MeshData
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<DWORD> indices;
+	};
+
+	struct SceneObject
+	{
+		const MeshData* data;
+		XMFLOAT4X4 world;
+	};
+
+	//Square heightfield of size x size quads in [-0.5, 0.5], two triangles per quad
+	MeshData Grid(uint32_t size, float bumpiness, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> height(-bumpiness, bumpiness);
+		MeshData mesh;
+		for (uint32_t y = 0; y <= size; y++)
+		{
+			for (uint32_t x = 0; x <= size; x++)
+			{
+				mesh.positions.push_back(XMFLOAT3(static_cast<float>(x) / size - 0.5f, static_cast<float>(y) / size - 0.5f, height(random)));
+			}
+		}
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				const DWORD a = y * (size + 1) + x;
+				const DWORD c = a + size + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, a + 1, c, c, a + 1, c + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	//Small triangles scattered through the unit cube, overlapping each other at random
+	MeshData Soup(uint32_t count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> centre(-0.5f, 0.5f);
+		std::uniform_real_distribution<float> offset(-0.08f, 0.08f);
+		MeshData mesh;
+		for (uint32_t t = 0; t < count; t++)
+		{
+			const float x = centre(random), y = centre(random), z = centre(random);
+			for (int v = 0; v < 3; v++)
+			{
+				mesh.indices.push_back(static_cast<DWORD>(mesh.positions.size()));
+				mesh.positions.push_back(XMFLOAT3(x + offset(random), y + offset(random), z + offset(random)));
+			}
+		}
+		return mesh;
+	}
+
+	XMMATRIX RandomTransform(std::mt19937& random, float spread)
+	{
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		std::uniform_real_distribution<float> position(-spread, spread);
+		return XMMatrixScaling(scale(random), scale(random), scale(random)) *
+			XMMatrixRotationRollPitchYaw(angle(random), angle(random), angle(random)) *
+			XMMatrixTranslation(position(random), position(random), position(random));
+	}
+
+	//Two sided Moller-Trumbore in world space, the reference every pick is checked against.
+	//slack widens the triangle by that much in barycentric units.
+	bool IntersectTriangle(FXMVECTOR origin, FXMVECTOR direction, FXMVECTOR p0, GXMVECTOR p1, HXMVECTOR p2, float slack, float& distance, XMFLOAT2& barycentrics)
+	{
+		const XMVECTOR edge1 = XMVectorSubtract(p1, p0);
+		const XMVECTOR edge2 = XMVectorSubtract(p2, p0);
+		const XMVECTOR p = XMVector3Cross(direction, edge2);
+		const float det = XMVectorGetX(XMVector3Dot(edge1, p));
+		if (std::fabs(det) <= 1e-12f)
+			return false;
+
+		const float invDet = 1.0f / det;
+		const XMVECTOR t = XMVectorSubtract(origin, p0);
+		const float u = XMVectorGetX(XMVector3Dot(t, p)) * invDet;
+		if (u < -slack || u > 1.0f + slack)
+			return false;
+
+		const XMVECTOR q = XMVector3Cross(t, edge1);
+		const float v = XMVectorGetX(XMVector3Dot(direction, q)) * invDet;
+		if (v < -slack || u + v > 1.0f + slack)
+			return false;
+
+		distance = XMVectorGetX(XMVector3Dot(edge2, q)) * invDet;
+		barycentrics = XMFLOAT2(u, v);
+		return distance >= 0.0f;
+	}
+
+	bool IntersectTriangle(FXMVECTOR origin, FXMVECTOR direction, const SceneObject& object, uint32_t triangle, float slack, float& distance, XMFLOAT2& barycentrics)
+	{
+		const XMMATRIX world = XMLoadFloat4x4(&object.world);
+		const DWORD* indices = &object.data->indices[triangle * 3];
+		const XMVECTOR p0 = XMVector3TransformCoord(XMLoadFloat3(&object.data->positions[indices[0]]), world);
+		const XMVECTOR p1 = XMVector3TransformCoord(XMLoadFloat3(&object.data->positions[indices[1]]), world);
+		const XMVECTOR p2 = XMVector3TransformCoord(XMLoadFloat3(&object.data->positions[indices[2]]), world);
+		return IntersectTriangle(origin, direction, p0, p1, p2, slack, distance, barycentrics);
+	}
+
+	PickResult BruteForce(FXMVECTOR origin, FXMVECTOR direction, const std::vector<SceneObject>& objects)
+	{
+		PickResult best;
+		best.distance = FLT_MAX;
+		for (uint32_t o = 0; o < objects.size(); o++)
+		{
+			const uint32_t triangleCount = static_cast<uint32_t>(objects[o].data->indices.size() / 3);
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				float distance;
+				XMFLOAT2 barycentrics;
+				if (IntersectTriangle(origin, direction, objects[o], t, 0.0f, distance, barycentrics) && distance < best.distance)
+				{
+					best.object = o;
+					best.triangle = t;
+					best.distance = distance;
+					best.barycentrics = barycentrics;
+				}
+			}
+		}
+		return best;
+	}
+
+	//The picker works in each object's model space, so its answers differ from the world space
+	//reference by rounding. A different triangle is only accepted when the ray grazes it at the
+	//reference distance, as on a shared edge.
+	bool Matches(FXMVECTOR origin, FXMVECTOR direction, const std::vector<SceneObject>& objects, bool hit, const PickResult& result, const PickResult& expected)
+	{
+		if (hit != (expected.object != BVH::INVALID_INDEX))
+			return false;
+		if (!hit)
+			return true;
+
+		const float tolerance = 1e-4f * std::max(1.0f, expected.distance);
+		if (std::fabs(result.distance - expected.distance) > tolerance)
+			return false;
+		if (result.object == expected.object && result.triangle == expected.triangle)
+		{
+			return std::fabs(result.barycentrics.x - expected.barycentrics.x) <= 1e-3f &&
+				std::fabs(result.barycentrics.y - expected.barycentrics.y) <= 1e-3f;
+		}
+
+		if (result.object >= objects.size() || result.triangle >= objects[result.object].data->indices.size() / 3)
+			return false;
+		float distance;
+		XMFLOAT2 barycentrics;
+		return IntersectTriangle(origin, direction, objects[result.object], result.triangle, 1e-3f, distance, barycentrics) &&
+			std::fabs(distance - expected.distance) <= tolerance;
+	}
+
+	//Aims rays from outside the scene at random points inside it, some of which miss everything
+	void RandomRay(std::mt19937& random, float spread, XMVECTOR& origin, XMVECTOR& direction)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const XMVECTOR away = XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0.0f));
+		origin = XMVectorMultiplyAdd(away, XMVectorReplicate(spread * 4.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+		const XMVECTOR target = XMVectorSet(unit(random) * spread, unit(random) * spread, unit(random) * spread, 1.0f);
+		direction = XMVector3Normalize(XMVectorSubtract(target, origin));
+	}
+
+	int CheckRays(ScenePicker& picker, const std::vector<SceneObject>& objects, std::mt19937& random, float spread, int rays, const char* scene)
+	{
+		int hits = 0;
+		int errors = 0;
+		for (int r = 0; r < rays; r++)
+		{
+			XMVECTOR origin, direction;
+			RandomRay(random, spread, origin, direction);
+
+			PickResult result;
+			const bool hit = picker.Pick(origin, direction, FLT_MAX, result);
+			const PickResult expected = BruteForce(origin, direction, objects);
+			hits += hit;
+			if (!Matches(origin, direction, objects, hit, result, expected))
+			{
+				if (errors < 5)
+				{
+					std::printf("FAILED %s ray %d: object %u triangle %u at %f, expected object %u triangle %u at %f\n", scene, r,
+						result.object, result.triangle, result.distance, expected.object, expected.triangle, expected.distance);
+				}
+				errors++;
+			}
+		}
+		std::printf("%-24s %d rays, %d hits, %d wrong\n", scene, rays, hits, errors);
+		return errors;
+	}
+
+	void TestScene(const char* name, const std::vector<MeshData>& meshData, uint32_t objectCount, float spread, std::mt19937& random)
+	{
+		std::vector<TriangleMesh> meshes(meshData.size());
+		for (size_t i = 0; i < meshData.size(); i++)
+		{
+			meshes[i].Build(meshData[i].positions.data(), sizeof(XMFLOAT3), static_cast<uint32_t>(meshData[i].positions.size()),
+				meshData[i].indices.data(), static_cast<uint32_t>(meshData[i].indices.size()));
+		}
+
+		ScenePicker picker;
+		std::vector<SceneObject> objects;
+		for (uint32_t o = 0; o < objectCount; o++)
+		{
+			SceneObject object = { &meshData[o % meshData.size()], XMFLOAT4X4() };
+			const XMMATRIX world = RandomTransform(random, spread);
+			XMStoreFloat4x4(&object.world, world);
+			objects.push_back(object);
+			picker.AddObject(&meshes[o % meshes.size()], world);
+		}
+		failures += CheckRays(picker, objects, random, spread, 200, name);
+
+		//Moving objects refits the object BVH instead of rebuilding it
+		for (uint32_t o = 0; o < objectCount; o += 2)
+		{
+			const XMMATRIX world = RandomTransform(random, spread);
+			XMStoreFloat4x4(&objects[o].world, world);
+			picker.SetTransform(o, world);
+		}
+		const std::string moved = std::string(name) + " moved";
+		failures += CheckRays(picker, objects, random, spread, 200, moved.c_str());
+	}
+
+	//One large mesh, where the brute force test is too slow to run for every ray
+	void TimeLargeMesh(uint32_t triangles, std::mt19937& random)
+	{
+		const uint32_t size = std::max(1u, static_cast<uint32_t>(std::sqrt(triangles / 2.0)));
+		MeshData data = Grid(size, 0.02f, random);
+
+		auto start = std::chrono::steady_clock::now();
+		TriangleMesh mesh;
+		mesh.Build(data.positions.data(), sizeof(XMFLOAT3), static_cast<uint32_t>(data.positions.size()), data.indices.data(), static_cast<uint32_t>(data.indices.size()));
+		const double buildTime = MillisecondsSince(start);
+
+		ScenePicker picker;
+		const XMMATRIX world = XMMatrixRotationRollPitchYaw(0.3f, 0.2f, 0.1f);
+		std::vector<SceneObject> objects = { { &data, XMFLOAT4X4() } };
+		XMStoreFloat4x4(&objects[0].world, world);
+		picker.AddObject(&mesh, world);
+
+		const int rays = 10000;
+		const int checkedRays = 10;
+		std::vector<XMFLOAT3> origins(rays), directions(rays);
+		for (int r = 0; r < rays; r++)
+		{
+			XMVECTOR origin, direction;
+			RandomRay(random, 0.5f, origin, direction);
+			XMStoreFloat3(&origins[r], origin);
+			XMStoreFloat3(&directions[r], direction);
+		}
+
+		int hits = 0;
+		PickResult result;
+		picker.Pick(XMLoadFloat3(&origins[0]), XMLoadFloat3(&directions[0]), FLT_MAX, result);
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < rays; r++)
+		{
+			hits += picker.Pick(XMLoadFloat3(&origins[r]), XMLoadFloat3(&directions[r]), FLT_MAX, result);
+		}
+		const double pickTime = MillisecondsSince(start) / rays;
+
+		int errors = 0;
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < checkedRays; r++)
+		{
+			const XMVECTOR origin = XMLoadFloat3(&origins[r]);
+			const XMVECTOR direction = XMLoadFloat3(&directions[r]);
+			const PickResult expected = BruteForce(origin, direction, objects);
+			const bool hit = picker.Pick(origin, direction, FLT_MAX, result);
+			errors += !Matches(origin, direction, objects, hit, result, expected);
+		}
+		const double bruteTime = MillisecondsSince(start) / checkedRays;
+		failures += errors;
+
+		std::printf("%u triangles: build %.1f ms, pick %.2f us (%d of %d rays hit), brute force %.1f ms, speedup %.0fx, %d of %d wrong\n",
+			mesh.GetTriangleCount(), buildTime, pickTime * 1000.0, hits, rays, bruteTime, bruteTime / std::max(pickTime, 1e-6), errors, checkedRays);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t triangles = argc > 1 ? static_cast<uint32_t>(std::max(2, std::atoi(argv[1]))) : 1000000;
+
+	std::mt19937 random(7);
+
+	//Bumpy sheets crossing each other, with shared edges for rays to land on
+	std::vector<MeshData> sheets = { Grid(40, 0.05f, random), Grid(7, 0.2f, random) };
+	TestScene("sheets", sheets, 12, 1.5f, random);
+
+	//Unconnected, overlapping triangles inside and between objects
+	std::vector<MeshData> soup = { Soup(2000, random), Soup(3, random) };
+	TestScene("triangle soup", soup, 9, 1.0f, random);
+
+	TimeLargeMesh(triangles, random);
+
+	if (failures)
+	{
+		std::printf("%d picks disagreed with brute force\n", failures);
+		return 1;
+	}
+	std::printf("All picking tests passed\n");
+	return 0;
+}